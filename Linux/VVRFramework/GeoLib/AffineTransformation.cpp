@@ -0,0 +1,208 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file AffineTransformation.cpp
+\brief Implementation file for the CAffineTransformation class.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "AffineTransformation.h"
+#include <cmath>
+
+using namespace std;
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::CAffineTransformation
+\brief Constructor, for the identity.
+<P>---------------------------------------------------------------------------*/
+CAffineTransformation::CAffineTransformation(void)
+{
+	SetIdentity();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::CAffineTransformation
+\brief Constructor, for x' = a x + b y + c and y' = d x + e y + f.
+<P>---------------------------------------------------------------------------*/
+CAffineTransformation::CAffineTransformation(double a, double b, double c, double d, double e, double f)
+{
+	Set(a, b, c, d, e, f);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::~CAffineTransformation
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CAffineTransformation::~CAffineTransformation(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::SetIdentity
+\brief Sets to the identity.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::SetIdentity(void)
+{
+	Set(1, 0, 0, 0, 1, 0);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::Set
+\brief Sets to x' = a x + b y + c and y' = d x + e y + f.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::Set(double a, double b, double c, double d, double e, double f)
+{
+	m_Coeffs[0] = a;
+	m_Coeffs[1] = b;
+	m_Coeffs[2] = c;
+	m_Coeffs[3] = d;
+	m_Coeffs[4] = e;
+	m_Coeffs[5] = f;
+	MakeInverse();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::Translate
+\brief Adds a translation, applied after the transformation so far.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::Translate(double dx, double dy)
+{
+	Append(CAffineTransformation(1, 0, dx, 0, 1, dy));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::Scale
+\brief Adds a scale about the origin, applied after the transformation so far.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::Scale(double dScaleX, double dScaleY)
+{
+	Append(CAffineTransformation(dScaleX, 0, 0, 0, dScaleY, 0));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::Rotate
+\brief Adds an anticlockwise rotation about the origin by the angle in radians,
+applied after the transformation so far.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::Rotate(double dAngle)
+{
+	const double dCos = cos(dAngle);
+	const double dSin = sin(dAngle);
+	Append(CAffineTransformation(dCos, -dSin, 0, dSin, dCos, 0));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::Append
+\brief Adds the other transformation, applied after this.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::Append(const CAffineTransformation& Other)
+{
+	const double* m = m_Coeffs;
+	const double* o = Other.m_Coeffs;
+	Set(o[0] * m[0] + o[1] * m[3], o[0] * m[1] + o[1] * m[4], o[0] * m[2] + o[1] * m[5] + o[2],
+		o[3] * m[0] + o[4] * m[3], o[3] * m[1] + o[4] * m[4], o[3] * m[2] + o[4] * m[5] + o[5]);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::MakeInverse
+\brief Makes the inverse. If there is none it is left as the identity.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::MakeInverse(void)
+{
+	const double* m = m_Coeffs;
+	const double dDet = m[0] * m[4] - m[1] * m[3];
+	m_bInvertible = dDet != 0;
+	if (!m_bInvertible)
+	{
+		m_Inverse[0] = 1;
+		m_Inverse[1] = 0;
+		m_Inverse[2] = 0;
+		m_Inverse[3] = 0;
+		m_Inverse[4] = 1;
+		m_Inverse[5] = 0;
+		return;
+	}
+	m_Inverse[0] = m[4] / dDet;
+	m_Inverse[1] = -m[1] / dDet;
+	m_Inverse[3] = -m[3] / dDet;
+	m_Inverse[4] = m[0] / dDet;
+	m_Inverse[2] = -(m_Inverse[0] * m[2] + m_Inverse[1] * m[5]);
+	m_Inverse[5] = -(m_Inverse[3] * m[2] + m_Inverse[4] * m[5]);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::Apply
+\brief Applies the coefficients to the arrays. The loop has no calls or branches so
+the compiler can vectorise it.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::Apply(const double* pCoeffs, double* pX, double* pY, unsigned int nCount)
+{
+	const double a = pCoeffs[0], b = pCoeffs[1], c = pCoeffs[2];
+	const double d = pCoeffs[3], e = pCoeffs[4], f = pCoeffs[5];
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		const double x = pX[i];
+		const double y = pY[i];
+		pX[i] = a * x + b * y + c;
+		pY[i] = d * x + e * y + f;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::Transform
+\brief Transform the given point.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::Transform(double& dx, double& dy) const
+{
+	Apply(m_Coeffs, &dx, &dy, 1);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::InverseTransform
+\brief Inverse transform the given point. The point is unchanged if there is no inverse.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::InverseTransform(double& dx, double& dy) const
+{
+	assert(m_bInvertible);
+	Apply(m_Inverse, &dx, &dy, 1);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::TransformPoints
+\brief Transform the points given as arrays of x and y.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::TransformPoints(double* pX, double* pY, unsigned int nCount) const
+{
+	Apply(m_Coeffs, pX, pY, nCount);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CAffineTransformation::InverseTransformPoints
+\brief Inverse transform the points given as arrays of x and y. The points are
+unchanged if there is no inverse.
+<P>---------------------------------------------------------------------------*/
+void CAffineTransformation::InverseTransformPoints(double* pX, double* pY, unsigned int nCount) const
+{
+	assert(m_bInvertible);
+	Apply(m_Inverse, pX, pY, nCount);
+}
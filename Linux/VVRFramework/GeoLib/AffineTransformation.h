@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file AffineTransformation.h
+\brief Declaration file for the CAffineTransformation class.
+
+\class CAffineTransformation
+\brief An affine transformation, x' = a x + b y + c and y' = d x + e y + f.
+
+Translations, scales and rotations can be added in turn, each applied after those
+before. The inverse is kept up to date so that inverse transforms cost the same as
+forward ones. The points of a polygon are transformed in a single loop over the
+arrays of x and y which the compiler can vectorise.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CAFFINETRANSFORMATION_H
+#define _GEOLIB_CAFFINETRANSFORMATION_H
+
+#include "Transformation.h"
+
+class GeoLib_API CAffineTransformation : public CTransformation
+{
+public:
+	/// Constructor, for the identity.
+	CAffineTransformation(void);
+	/// Constructor, for x' = a x + b y + c and y' = d x + e y + f.
+	CAffineTransformation(double a, double b, double c, double d, double e, double f);
+	/// Destructor.
+	virtual ~CAffineTransformation(void);
+
+	/// Sets to the identity.
+	void SetIdentity(void);
+	/// Sets to x' = a x + b y + c and y' = d x + e y + f.
+	void Set(double a, double b, double c, double d, double e, double f);
+	/// Adds a translation.
+	void Translate(double dx, double dy);
+	/// Adds a scale about the origin.
+	void Scale(double dScaleX, double dScaleY);
+	/// Adds an anticlockwise rotation about the origin.
+	void Rotate(double dAngle);
+	/// Adds the other transformation, applied after this.
+	void Append(const CAffineTransformation& Other);
+	/// True if the transformation can be inverted.
+	bool IsInvertible(void) const {return m_bInvertible;}
+
+	/// Transform the given point.
+	virtual void Transform(double& dx, double& dy) const;
+	/// Inverse transform the given point.
+	virtual void InverseTransform(double& dx, double& dy) const;
+	/// Transform the points given as arrays of x and y.
+	virtual void TransformPoints(double* pX, double* pY, unsigned int nCount) const;
+	/// Inverse transform the points given as arrays of x and y.
+	virtual void InverseTransformPoints(double* pX, double* pY, unsigned int nCount) const;
+
+private:
+	/// Makes the inverse.
+	void MakeInverse(void);
+	/// Applies the coefficients to the arrays.
+	static void Apply(const double* pCoeffs, double* pX, double* pY, unsigned int nCount);
+
+	/// The coefficients a to f.
+	double m_Coeffs[6];
+	/// The coefficients of the inverse.
+	double m_Inverse[6];
+	/// True if the inverse exists.
+	bool m_bInvertible;
+};
+
+#endif
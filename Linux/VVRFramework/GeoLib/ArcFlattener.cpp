@@ -0,0 +1,421 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file ArcFlattener.cpp
+\brief Implementation file for the CFlatRing and CArcFlattener classes.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "ArcFlattener.h"
+#include "Predicates.h"
+#include "C2DPolyBase.h"
+#include "C2DHoledPolyBase.h"
+#include "C2DHoledPolyBaseSet.h"
+#include "C2DLineBaseSet.h"
+#include "C2DLine.h"
+#include "C2DArc.h"
+#include "Constants.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/// The angle by which a point may be beyond the ends of an arc and still be on it.
+const double conArcEndAngle = 1e-9;
+
+
+/**--------------------------------------------------------------------------<BR>
+SegmentDistanceSquared <BR>
+\brief The square of the distance of the point from the segment.
+<P>---------------------------------------------------------------------------*/
+static inline double SegmentDistanceSquared(const C2DPoint& pt, const C2DPoint& p1, const C2DPoint& p2)
+{
+	const double dx = p2.x - p1.x;
+	const double dy = p2.y - p1.y;
+	double px = pt.x - p1.x;
+	double py = pt.y - p1.y;
+	const double dLength = dx * dx + dy * dy;
+	if (dLength > 0)
+	{
+		const double t = max(0.0, min(1.0, (px * dx + py * dy) / dLength));
+		px -= t * dx;
+		py -= t * dy;
+	}
+	return px * px + py * py;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CFlatRing::CFlatRing
+\brief Constructor, flattening the polygon so that every chord is within the tolerance
+of its arc.
+<P>---------------------------------------------------------------------------*/
+CFlatRing::CFlatRing(const C2DPolyBase& Poly, double dTolerance)
+	: m_dTolerance(dTolerance), m_dMaxError(0)
+{
+	const unsigned int nLines = Poly.GetLineCount();
+	m_LineStarts.reserve(nLines + 1);
+	m_Points.reserve(nLines);
+	for (unsigned int i = 0; i < nLines; i++)
+	{
+		const C2DLineBase* pLine = Poly.GetLine(i);
+		m_LineStarts.push_back(m_Points.size());
+		m_Points.push_back(pLine->GetPointFrom());
+		if (pLine->GetType() != C2DBase::ArcedLine)
+			continue;
+
+		const C2DArc* pArc = static_cast<const C2DArc*>(pLine);
+		const double dRadius = pArc->GetRadius();
+		const double dAngle = pArc->GetLength() / dRadius;
+		const unsigned int nSteps = GetChordCount(dRadius, dAngle, dTolerance);
+		for (unsigned int s = 1; s < nSteps; s++)
+			m_Points.push_back(pArc->GetPointOn((double)s / nSteps));
+		m_dMaxError = max(m_dMaxError, GetChordError(dRadius, dAngle / nSteps));
+	}
+	m_LineStarts.push_back(m_Points.size());
+
+	if (!m_Points.empty())
+	{
+		m_BoundingRect.Set(m_Points[0]);
+		for (unsigned int i = 1; i < m_Points.size(); i++)
+			m_BoundingRect.ExpandToInclude(m_Points[i]);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CFlatRing::~CFlatRing
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CFlatRing::~CFlatRing(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CFlatRing::GetChordCount
+\brief The number of equal chords needed for an arc of the angle to be within the
+tolerance, at least 1 for each quarter turn. A tolerance of 0 or less, or of the
+radius or more, gives 1 for each quarter turn.
+<P>---------------------------------------------------------------------------*/
+unsigned int CFlatRing::GetChordCount(double dRadius, double dAngle, double dTolerance)
+{
+	double dChordAngle = conHALFPI;
+	if (dTolerance > 0 && dTolerance < dRadius)
+		dChordAngle = min(conHALFPI, 2 * acos(1 - dTolerance / dRadius));
+	return max(1u, (unsigned int)ceil(fabs(dAngle) / dChordAngle));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CFlatRing::GetChordError
+\brief The greatest distance of a chord of the angle from its arc.
+<P>---------------------------------------------------------------------------*/
+double CFlatRing::GetChordError(double dRadius, double dAngle)
+{
+	return dRadius * (1 - cos(dAngle / 2));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CFlatRing::Contains
+\brief True if the point is inside, by the number of edges crossed by a ray to the
+right of the point.
+<P>---------------------------------------------------------------------------*/
+bool CFlatRing::Contains(const C2DPoint& pt) const
+{
+	if (m_Points.size() < 3 || !m_BoundingRect.Contains(pt))
+		return false;
+
+	bool bInside = false;
+	const unsigned int nCount = m_Points.size();
+	for (unsigned int i = 0, j = nCount - 1; i < nCount; j = i++)
+	{
+		const C2DPoint& p1 = m_Points[i];
+		const C2DPoint& p2 = m_Points[j];
+		if ((p1.y > pt.y) != (p2.y > pt.y) &&
+			pt.x < p1.x + (p2.x - p1.x) * (pt.y - p1.y) / (p2.y - p1.y))
+		{
+			bInside = !bInside;
+		}
+	}
+	return bInside;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CFlatRing::Distance
+\brief The distance to the point, negative if inside.
+<P>---------------------------------------------------------------------------*/
+double CFlatRing::Distance(const C2DPoint& pt) const
+{
+	const unsigned int nCount = m_Points.size();
+	if (nCount == 0)
+		return 0;
+
+	double dMin = pt.Distance(m_Points[0]);
+	dMin *= dMin;
+	for (unsigned int i = 0, j = nCount - 1; i < nCount; j = i++)
+		dMin = min(dMin, SegmentDistanceSquared(pt, m_Points[j], m_Points[i]));
+
+	return Contains(pt) ? -sqrt(dMin) : sqrt(dMin);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CArcFlattener::CArcFlattener
+\brief Constructor, with the tolerance of the chords.
+<P>---------------------------------------------------------------------------*/
+CArcFlattener::CArcFlattener(double dTolerance) : m_dTolerance(dTolerance)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CArcFlattener::~CArcFlattener
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CArcFlattener::~CArcFlattener(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CArcFlattener::Add
+\brief Adds the points of the polygon, flattened to the tolerance, to the vector and
+remembers its arcs along with the points of their chords. The flattening cached by
+the polygon is used if it is fine enough.
+<P>---------------------------------------------------------------------------*/
+void CArcFlattener::Add(const C2DPolyBase& Poly, vector<C2DPoint>& Points)
+{
+	shared_ptr<const CFlatRing> pRing = Poly.GetFlattened(m_dTolerance);
+	const vector<C2DPoint>& RingPoints = pRing->GetPoints();
+	Points.insert(Points.end(), RingPoints.begin(), RingPoints.end());
+
+	const unsigned int nCount = RingPoints.size();
+	for (unsigned int i = 0; i < Poly.GetLineCount(); i++)
+	{
+		const C2DLineBase* pLine = Poly.GetLine(i);
+		if (pLine->GetType() != C2DBase::ArcedLine)
+			continue;
+
+		const C2DArc* pArc = static_cast<const C2DArc*>(pLine);
+		sArc Arc;
+		Arc.Centre = pArc->GetCircleCentre();
+		Arc.dRadius = pArc->GetRadius();
+		const C2DPoint PtFrom = pArc->GetPointFrom();
+		Arc.dStartAngle = atan2(PtFrom.y - Arc.Centre.y, PtFrom.x - Arc.Centre.x);
+		Arc.dSweep = pArc->GetLength() / Arc.dRadius;
+		if (!pArc->GetArcOnRight())
+			Arc.dSweep = -Arc.dSweep;
+
+		// The points of the chords, including the end which starts the next line.
+		const unsigned int nArc = m_Arcs.size();
+		m_Arcs.push_back(Arc);
+		for (unsigned int p = pRing->GetLineStart(i); p <= pRing->GetLineStart(i + 1); p++)
+		{
+			const C2DPoint& pt = RingPoints[p % nCount];
+			m_ArcOf.insert(make_pair(make_pair(pt.x, pt.y), nArc));
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CArcFlattener::Clear
+\brief Forgets the arcs.
+<P>---------------------------------------------------------------------------*/
+void CArcFlattener::Clear(void)
+{
+	m_Arcs.clear();
+	m_ArcOf.clear();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CArcFlattener::IsOnArc
+\brief True if the point is within the sector of the arc and no further inside the
+circle than the tolerance, as are the points of its chords and any point cut on them.
+<P>---------------------------------------------------------------------------*/
+bool CArcFlattener::IsOnArc(const sArc& Arc, const C2DPoint& pt) const
+{
+	const double dx = pt.x - Arc.Centre.x;
+	const double dy = pt.y - Arc.Centre.y;
+	const double dDist = sqrt(dx * dx + dy * dy);
+	const double dEps = Arc.dRadius * 1e-9;
+	if (dDist > Arc.dRadius + dEps || dDist < Arc.dRadius - m_dTolerance - dEps)
+		return false;
+
+	double dAngle = atan2(dy, dx) - Arc.dStartAngle;
+	if (Arc.dSweep < 0)
+		dAngle = -dAngle;
+	dAngle = fmod(dAngle, conTWOPI);
+	if (dAngle < 0)
+		dAngle += conTWOPI;
+	return dAngle <= fabs(Arc.dSweep) + conArcEndAngle || dAngle >= conTWOPI - conArcEndAngle;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CArcFlattener::IsEdgeOnArc
+\brief True if both ends of the edge are on the arc and its middle is within the
+tolerance of the circle, so that the arc between the ends replaces it.
+<P>---------------------------------------------------------------------------*/
+bool CArcFlattener::IsEdgeOnArc(const sArc& Arc, const C2DPoint& PtFrom, const C2DPoint& PtTo) const
+{
+	if (!IsOnArc(Arc, PtFrom) || !IsOnArc(Arc, PtTo))
+		return false;
+
+	const C2DPoint Mid((PtFrom.x + PtTo.x) / 2, (PtFrom.y + PtTo.y) / 2);
+	return Mid.Distance(Arc.Centre) >= Arc.dRadius * (1 - 1e-9) - m_dTolerance;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CArcFlattener::FitArcs
+\brief Replaces runs of edges on the arcs added by arcs in the shapes from the index
+given. An edge is on an arc if one of its ends is a point of the chords of the arc and
+the edge passes IsEdgeOnArc. Each run of edges on the same arc turning the same way
+becomes a single arc of the radius of the original. A run all the way round is split
+in 2.
+<P>---------------------------------------------------------------------------*/
+void CArcFlattener::FitArcs(C2DHoledPolyBaseSet& Shapes, unsigned int nFrom) const
+{
+	if (m_Arcs.empty())
+		return;
+
+	typedef multimap< pair<double, double>, unsigned int >::const_iterator ArcIt;
+	const unsigned int conNoArc = 0xFFFFFFFF;
+
+	for (unsigned int p = nFrom; p < Shapes.size(); p++)
+	{
+		C2DHoledPolyBase* pHoled = Shapes.GetAt(p);
+		const unsigned int nRings = pHoled->GetHoleCount() + 1;
+
+		// The points of each ring and the arc of each edge, if any.
+		vector< vector<C2DPoint> > Points(nRings);
+		vector< vector<unsigned int> > EdgeArcs(nRings);
+		bool bAnyArc = false;
+		for (unsigned int r = 0; r < nRings; r++)
+		{
+			const C2DPolyBase* pRing = (r == 0) ? pHoled->GetRim() : pHoled->GetHole(r - 1);
+			const unsigned int nCount = pRing ? pRing->GetLineCount() : 0;
+			vector<C2DPoint>& Ring = Points[r];
+			Ring.resize(nCount);
+			for (unsigned int i = 0; i < nCount; i++)
+				Ring[i] = pRing->GetLine(i)->GetPointFrom();
+
+			vector<unsigned int>& EdgeArc = EdgeArcs[r];
+			EdgeArc.assign(nCount, conNoArc);
+			for (unsigned int i = 0; i < nCount; i++)
+			{
+				const C2DPoint& PtFrom = Ring[i];
+				const C2DPoint& PtTo = Ring[(i + 1) % nCount];
+				for (unsigned int e = 0; e < 2 && EdgeArc[i] == conNoArc; e++)
+				{
+					const C2DPoint& pt = (e == 0) ? PtFrom : PtTo;
+					pair<ArcIt, ArcIt> Range = m_ArcOf.equal_range(make_pair(pt.x, pt.y));
+					for (ArcIt It = Range.first; It != Range.second; ++It)
+					{
+						if (IsEdgeOnArc(m_Arcs[It->second], PtFrom, PtTo))
+						{
+							EdgeArc[i] = It->second;
+							bAnyArc = true;
+							break;
+						}
+					}
+				}
+			}
+		}
+		if (!bAnyArc)
+			continue;
+
+		C2DHoledPolyBase* pNew = new C2DHoledPolyBase;
+		for (unsigned int r = 0; r < nRings; r++)
+		{
+			const vector<C2DPoint>& Ring = Points[r];
+			const vector<unsigned int>& EdgeArc = EdgeArcs[r];
+			const unsigned int nCount = Ring.size();
+			if (nCount == 0)
+				continue;
+
+			// The angle each edge turns about the centre of its arc.
+			vector<double> Turns(nCount, 0);
+			for (unsigned int i = 0; i < nCount; i++)
+			{
+				if (EdgeArc[i] == conNoArc)
+					continue;
+				const C2DPoint& Centre = m_Arcs[EdgeArc[i]].Centre;
+				const C2DPoint& PtFrom = Ring[i];
+				const C2DPoint& PtTo = Ring[(i + 1) % nCount];
+				const double ux = PtFrom.x - Centre.x, uy = PtFrom.y - Centre.y;
+				const double vx = PtTo.x - Centre.x, vy = PtTo.y - Centre.y;
+				Turns[i] = atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+			}
+
+			// Start at an edge which does not continue a run from the one before.
+			unsigned int nStart = 0;
+			while (nStart < nCount && EdgeArc[nStart] != conNoArc &&
+				   EdgeArc[(nStart + nCount - 1) % nCount] == EdgeArc[nStart] &&
+				   (Turns[(nStart + nCount - 1) % nCount] > 0) == (Turns[nStart] > 0))
+			{
+				nStart++;
+			}
+			if (nStart == nCount)
+				nStart = 0;
+
+			C2DLineBaseSet Lines;
+			unsigned int i = 0;
+			while (i < nCount)
+			{
+				const unsigned int e = (nStart + i) % nCount;
+				const C2DPoint& PtFrom = Ring[e];
+				if (EdgeArc[e] == conNoArc)
+				{
+					Lines.Add(new C2DLine(PtFrom, Ring[(e + 1) % nCount]));
+					i++;
+					continue;
+				}
+
+				unsigned int nRun = 1;
+				double dTurn = Turns[e];
+				while (i + nRun < nCount && EdgeArc[(e + nRun) % nCount] == EdgeArc[e] &&
+					   (Turns[(e + nRun) % nCount] > 0) == (Turns[e] > 0))
+				{
+					dTurn += Turns[(e + nRun) % nCount];
+					nRun++;
+				}
+				if (nRun == nCount && nRun > 1)
+				{
+					// The whole ring is the circle which one arc cannot start and end on.
+					nRun = nCount / 2;
+					dTurn = 0;
+					for (unsigned int k = 0; k < nRun; k++)
+						dTurn += Turns[(e + k) % nCount];
+				}
+
+				const C2DPoint& PtTo = Ring[(e + nRun) % nCount];
+				const sArc& Arc = m_Arcs[EdgeArc[e]];
+				const bool bCentreOnRight = GeoPredicates::Orient2D(PtFrom.x, PtFrom.y,
+										PtTo.x, PtTo.y, Arc.Centre.x, Arc.Centre.y) < 0;
+				const double dRadius = max(Arc.dRadius, PtFrom.Distance(PtTo) / 2);
+				Lines.Add(new C2DArc(PtFrom, PtTo, dRadius, bCentreOnRight, dTurn > 0));
+				i += nRun;
+			}
+
+			C2DPolyBase* pPoly = new C2DPolyBase;
+			pPoly->CreateDirect(Lines);
+			if (r == 0)
+				pNew->SetRimDirect(pPoly);
+			else
+				pNew->AddHoleDirect(pPoly);
+		}
+
+		Shapes.DeleteAndSet(p, pNew);
+	}
+}
@@ -0,0 +1,151 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file ArcFlattener.h
+\brief Declaration file for the CFlatRing and CArcFlattener classes.
+
+Declaration file for CFlatRing, a polygon with its arcs replaced by chords, and
+CArcFlattener which flattens polygons for the Boolean engine and fits arcs back to
+the result.
+
+\class CFlatRing
+\brief The points of a polygon with each arc replaced by chords.
+
+Each arc is split into the fewest equal chords which are all within the tolerance
+of the arc. A chord of angle a on a circle of radius r is at most r (1 - cos(a / 2))
+from the arc so the chords of an arc of angle A number ceil(A / (2 acos(1 - t / r))),
+never fewer than 1 per quarter turn. The greatest error of any chord is kept so the
+ring can report how far it is from the true shape. Straight lines keep their points.
+
+The ring is made once for a polygon by C2DPolyBase::GetFlattened and shared by all
+queries until the polygon changes. Point containment and distance are then a single
+loop over plain points rather than line by line with the arc geometry.
+
+\class CArcFlattener
+\brief Flattens polygons for the Boolean engine and fits arcs back to the result.
+
+The arcs of each polygon added are remembered with the points of their chords. After
+the operation a run of result edges lying on the same arc, each end either a point of
+its chords or a cut point on one of them and each edge within the tolerance of the
+circle, is replaced by a single arc of the same circle.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CARCFLATTENER_H
+#define _GEOLIB_CARCFLATTENER_H
+
+#include "C2DPoint.h"
+#include "C2DRect.h"
+#include <vector>
+#include <map>
+
+class C2DPolyBase;
+class C2DHoledPolyBaseSet;
+
+class GeoLib_API CFlatRing
+{
+public:
+	/// Constructor, flattening the polygon to within the tolerance.
+	CFlatRing(const C2DPolyBase& Poly, double dTolerance);
+	/// Destructor.
+	~CFlatRing(void);
+
+	/// The tolerance the ring was made with.
+	double GetTolerance(void) const {return m_dTolerance;}
+	/// The greatest distance of a chord from its arc.
+	double GetMaxError(void) const {return m_dMaxError;}
+	/// The points.
+	const std::vector<C2DPoint>& GetPoints(void) const {return m_Points;}
+	/// The index of the first point of the line of the polygon.
+	unsigned int GetLineStart(unsigned int nLine) const {return m_LineStarts[nLine];}
+	/// The bounding rectangle of the points.
+	const C2DRect& GetBoundingRect(void) const {return m_BoundingRect;}
+
+	/// True if the point is inside.
+	bool Contains(const C2DPoint& pt) const;
+	/// The distance to the point, negative if inside.
+	double Distance(const C2DPoint& pt) const;
+
+	/// The number of equal chords needed for an arc to be within the tolerance.
+	static unsigned int GetChordCount(double dRadius, double dAngle, double dTolerance);
+	/// The greatest distance of a chord of the angle from its arc.
+	static double GetChordError(double dRadius, double dAngle);
+
+private:
+	/// The tolerance.
+	double m_dTolerance;
+	/// The greatest error.
+	double m_dMaxError;
+	/// The points.
+	std::vector<C2DPoint> m_Points;
+	/// The index of the first point of each line, followed by the number of points.
+	std::vector<unsigned int> m_LineStarts;
+	/// The bounding rectangle.
+	C2DRect m_BoundingRect;
+
+	/// No copying.
+	CFlatRing(const CFlatRing& Other);
+	/// No assignment.
+	void operator=(const CFlatRing& Other);
+};
+
+
+class GeoLib_API CArcFlattener
+{
+public:
+	/// Constructor, with the tolerance of the chords.
+	CArcFlattener(double dTolerance = 0);
+	/// Destructor.
+	~CArcFlattener(void);
+
+	/// Sets the tolerance of the chords.
+	void SetTolerance(double dTolerance) {m_dTolerance = dTolerance;}
+	/// The tolerance of the chords.
+	double GetTolerance(void) const {return m_dTolerance;}
+	/// True if any arcs have been added.
+	bool HasArcs(void) const {return !m_Arcs.empty();}
+
+	/// Adds the points of the polygon, flattened, to the vector and remembers its arcs.
+	void Add(const C2DPolyBase& Poly, std::vector<C2DPoint>& Points);
+	/// Forgets the arcs.
+	void Clear(void);
+	/// Replaces runs of edges on the arcs by arcs in the shapes from the index given.
+	void FitArcs(C2DHoledPolyBaseSet& Shapes, unsigned int nFrom = 0) const;
+
+private:
+	/// An arc added.
+	struct sArc
+	{
+		/// The centre.
+		C2DPoint Centre;
+		/// The radius.
+		double dRadius;
+		/// The angle of the start from the centre.
+		double dStartAngle;
+		/// The angle turned, positive if anticlockwise.
+		double dSweep;
+	};
+
+	/// True if the point is on the arc, within the tolerance inside the circle.
+	bool IsOnArc(const sArc& Arc, const C2DPoint& pt) const;
+	/// True if the edge is on the arc.
+	bool IsEdgeOnArc(const sArc& Arc, const C2DPoint& PtFrom, const C2DPoint& PtTo) const;
+
+	/// The tolerance.
+	double m_dTolerance;
+	/// The arcs.
+	std::vector<sArc> m_Arcs;
+	/// The arcs each point of a chord belongs to, found by its exact position.
+	std::multimap< std::pair<double, double>, unsigned int > m_ArcOf;
+
+	/// No copying.
+	CArcFlattener(const CArcFlattener& Other);
+	/// No assignment.
+	void operator=(const CArcFlattener& Other);
+};
+
+#endif
@@ -96,27 +96,27 @@ public:
 
 	/// Returns the overlaps between this and the other complex polygon.
 	void GetOverlaps(const C2DHoledPolyArc& Other, C2DHoledPolyArcSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the overlaps between this and the other complex polygon.
 	void GetOverlaps(const C2DHoledPolyArc& Other, C2DHoledPolyBaseSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the difference between this and the other polygon.
 	void GetNonOverlaps(const C2DHoledPolyArc& Other, C2DHoledPolyArcSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the difference between this and the other polygon.
 	void GetNonOverlaps(const C2DHoledPolyArc& Other, C2DHoledPolyBaseSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the union of this and the other.
 	void GetUnion(const C2DHoledPolyArc& Other, C2DHoledPolyArcSet& HoledPolys,
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the union of this and the other.
 	void GetUnion(const C2DHoledPolyArc& Other, C2DHoledPolyBaseSet& HoledPolys,
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 };
 
@@ -131,6 +131,27 @@ void C2DHoledPolyArcSet::UnifyProgressive(CGrid::eDegenerateHandling eDegen)
 }
 
 
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolyArcSet::UnifyCascaded
+\brief Cascaded union, merging neighbouring groups of shapes up a tree in parallel. 
+See C2DHoledPolyBaseSet function also.
+<P>---------------------------------------------------------------------------*/
+void C2DHoledPolyArcSet::UnifyCascaded(CGrid::eDegenerateHandling eDegen, unsigned int nThreads)
+{
+	C2DHoledPolyBaseSet BaseSet;
+
+	while (size() > 0)
+		BaseSet.Add( ExtractLast());
+
+	BaseSet.UnifyCascaded(eDegen, nThreads);
+
+	for (unsigned int i = 0 ; i <  BaseSet.size(); i++)
+	{
+		Add(new C2DHoledPolyArc( BaseSet[i]));
+	}
+}
+
+
 // Makes all arc valid if not already by adjusting radius to minimum required.
 unsigned int C2DHoledPolyArcSet::MakeValidArcs(void)
 {
@@ -100,7 +100,9 @@ public:
 	/// Basic multiple unification.
 	void UnifyBasic(void);
 	/// Unification by growing shapes of fairly equal size (fastest for large groups).
-	void UnifyProgressive(CGrid::eDegenerateHandling eDegen = CGrid::None);
+	void UnifyProgressive(CGrid::eDegenerateHandling eDegen = CGrid::UseContext);
+	/// Unification by merging neighbouring groups up a tree in parallel (fastest for very large groups).
+	void UnifyCascaded(CGrid::eDegenerateHandling eDegen = CGrid::UseContext, unsigned int nThreads = 0);
 
 	// Makes all arc valid if not already by adjusting radius to minimum required.
 	unsigned int MakeValidArcs(void);
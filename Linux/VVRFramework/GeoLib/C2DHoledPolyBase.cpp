@@ -26,6 +26,7 @@ holes. The Rim and Holes are pointers to C2DPolyBase classes.
 #include "C2DArc.h"
 #include "C2DPointSet.h"
 #include "IndexSet.h"
+#include "PolygonTriangulator.h"
 
 using namespace std;
 
@@ -496,6 +497,27 @@ bool C2DHoledPolyBase::Contains(const C2DPoint& pt) const
 	return true;
 }
 
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolyBase::ContainsFlattened
+\brief Point inside test with the arcs of the rim and holes flattened to the tolerance.
+<P>---------------------------------------------------------------------------*/
+bool C2DHoledPolyBase::ContainsFlattened(const C2DPoint& pt, double dTolerance) const
+{
+	if (m_Rim == 0)
+		return false;
+
+	if (!m_Rim->ContainsFlattened(pt, dTolerance))
+		return false;
+
+	for (unsigned int i = 0 ; i < m_Holes.size(); i++)
+	{
+		if (m_Holes[i].ContainsFlattened(pt, dTolerance))
+			return false;
+	}
+
+	return true;
+}
+
 /**--------------------------------------------------------------------------<BR>
 C2DHoledPolyBase::Contains
 \brief Contains
@@ -1073,19 +1095,19 @@ C2DPolyBase::RandomPerturb <BR>
 \brief Perturbs the shape by a very small random amount so as to avoid degeneracies
 with another polygon caused by coincident lines or points.
 <P>---------------------------------------------------------------------------*/
-void C2DHoledPolyBase::RandomPerturb(void)
+void C2DHoledPolyBase::RandomPerturb(CRandomGenerator* pGenerator)
 {
 	if (m_Rim == 0)
 		return;
 
 	C2DPoint pt = m_Rim->GetBoundingRect().GetPointFurthestFromOrigin();
 	double dMinEq = max(pt.x, pt.y) * conEqualityTolerance;
-	CRandomNumber rn(dMinEq * 10, dMinEq * 100);
+	CRandomGenerator& Generator = pGenerator ? *pGenerator : CRandomGenerator::GetThreadGenerator();
 
-	C2DVector cVector( rn.Get(), rn.Get() );
-	if (CRandomNumber::GetBool())
+	C2DVector cVector( Generator.Get(dMinEq * 10, dMinEq * 100), Generator.Get(dMinEq * 10, dMinEq * 100) );
+	if (Generator.GetBool())
 		cVector.i = - cVector.i ;
-	if (CRandomNumber::GetBool())
+	if (Generator.GetBool())
 		cVector.j = - cVector.j ;
 
 	Move( cVector );
@@ -1256,7 +1278,7 @@ void C2DHoledPolyBase::GetBoolean(const C2DHoledPolyBase& Other, C2DHoledPolyBas
 
 	if (m_Rim->GetBoundingRect().Overlaps(Other.GetRim()->GetBoundingRect() ))
 	{
-		switch (eDegen)
+		switch (CGrid::Resolve(eDegen))
 		{
 		case CGrid::None:
 			{
@@ -1355,10 +1377,89 @@ void C2DHoledPolyBase::GetBoolean(const C2DHoledPolyBase& Other, C2DHoledPolyBas
 				HoledPolys.SnapToGrid();	
 			}
 			break;
+		case CGrid::UseContext:
+			// Resolved above.
+			break;
 		}// switch
 	}
 }
 
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolyBase::GetBooleanSweep
+\brief Gets the boolean result using the sweep line engine. If the arc tolerance is
+above 0 any arcs are flattened to it for the engine and fitted back to the result.
+Otherwise GetBoolean is used if either has arcs.
+<P>---------------------------------------------------------------------------*/
+void C2DHoledPolyBase::GetBooleanSweep(const C2DHoledPolyBase& Other, C2DHoledPolyBaseSet& HoledPolys,
+						CPolygonBoolean::eOperation eOp, double dArcTolerance) const
+{
+	if (dArcTolerance > 0 || (!HasArcs() && !Other.HasArcs()))
+	{
+		CPolygonBoolean Boolean;
+		Boolean.SetArcTolerance(dArcTolerance);
+		Boolean.AddSubject(*this);
+		Boolean.AddClip(Other);
+		Boolean.Execute(eOp, HoledPolys);
+		return;
+	}
+
+	switch (eOp)
+	{
+	case CPolygonBoolean::Intersection:
+		GetBoolean(Other, HoledPolys, true, true);
+		break;
+	case CPolygonBoolean::Union:
+		GetBoolean(Other, HoledPolys, false, false);
+		break;
+	case CPolygonBoolean::Difference:
+		GetBoolean(Other, HoledPolys, false, true);
+		break;
+	case CPolygonBoolean::Xor:
+		GetBoolean(Other, HoledPolys, false, true);
+		Other.GetBoolean(*this, HoledPolys, false, true);
+		break;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolyBase::Triangulate<BR>
+\brief Adds 3 point indexes for each triangle to the set, see CPolygonTriangulator.
+False if it failed.
+<P>---------------------------------------------------------------------------*/
+bool C2DHoledPolyBase::Triangulate(CIndexSet& Triangles) const
+{
+	return CPolygonTriangulator::Triangulate(*this, Triangles);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolyBase::GetOffset<BR>
+\brief Adds the shape offset by the distance, outwards if positive and inwards if
+negative, to the set, see CPolygonOffset.
+<P>---------------------------------------------------------------------------*/
+void C2DHoledPolyBase::GetOffset(double dDistance, C2DHoledPolyBaseSet& Result,
+						CPolygonOffset::eJoinType eJoin) const
+{
+	CPolygonOffset Offset(eJoin);
+	Offset.Execute(*this, dDistance, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolyBase::Simplify<BR>
+\brief Removes points within the tolerance, a distance for Douglas-Peucker and an
+area for Visvalingam, from the rim and holes together so that none of them cross.
+Rims or holes with arcs are left as they are. Returns the number of points removed.
+See CSimplifier.
+<P>---------------------------------------------------------------------------*/
+unsigned int C2DHoledPolyBase::Simplify(double dTolerance, CSimplifier::eMethod eMethod)
+{
+	CSimplifier Simplifier(eMethod, dTolerance);
+	return Simplifier.Simplify(*this);
+}
+
+
 /**--------------------------------------------------------------------------<BR>
 C2DPolyBase::IsValidArcs <BR>
 \brief IsValidArcs
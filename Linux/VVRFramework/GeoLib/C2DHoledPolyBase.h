@@ -29,12 +29,17 @@ as long as it is a valid area.
 #include "C2DPolyBaseSet.h"
 #include "Grid.h"
 #include "MemoryPool.h"
+#include "PolygonBoolean.h"
+#include "PolygonOffset.h"
+#include "Simplifier.h"
 
 
 class C2DLineBase;
 class C2DLineBaseSetSet;
 class C2DHoledPolyBaseSet;
 class C2DPointSet;
+class CIndexSet;
+class CRandomGenerator;
 
 #ifdef _POLY_EXPORTING
 	#define POLY_DECLSPEC		__declspec(dllexport)
@@ -153,6 +158,8 @@ public:
 
 	/// Point inside test.
 	bool Contains(const C2DPoint& pt) const ;
+	/// Point inside test with the arcs flattened to the tolerance, see C2DPolyBase::GetFlattened.
+	bool ContainsFlattened(const C2DPoint& pt, double dTolerance) const;
 	/// Line entirely inside test.
 	bool Contains(const C2DLineBase& Line) const;
 	/// Polygon entirely inside test.
@@ -183,16 +190,16 @@ public:
 
 	/// Returns the overlaps between this and the other complex polygon.
 	void GetOverlaps(const C2DHoledPolyBase& Other, C2DHoledPolyBaseSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 
 	/// Returns the difference between this and the other polygon.
 	void GetNonOverlaps(const C2DHoledPolyBase& Other, C2DHoledPolyBaseSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the union of this and the other.
 	void GetUnion(const C2DHoledPolyBase& Other, C2DHoledPolyBaseSet& HoledPolys,
-						CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+						CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the routes (multiple lines or part polygons) either inside or
 	/// outside the polygons provided. These are based on the intersections
@@ -202,15 +209,32 @@ public:
 				C2DLineBaseSetSet& Routes1, C2DLineBaseSetSet& Routes2, 
 				C2DPolyBaseSet& CompleteHoles1, C2DPolyBaseSet& CompleteHoles2);
 
-	/// Moves this by a small random amount.
-	void RandomPerturb(void);
+	/// Moves this by a small random amount from the generator, 0 for the thread's.
+	void RandomPerturb(CRandomGenerator* pGenerator = 0);
 	/// Snaps this to the conceptual grip.
 	void SnapToGrid(void);
 	/// Returns the boolean result (e.g. union) of 2 shapes. Boolean Operation defined by 
 	/// the inside / outside flags.
 	void GetBoolean(const C2DHoledPolyBase& Other, C2DHoledPolyBaseSet& HoledPolys,
 						bool bThisInside, bool bOtherInside, 
-						CGrid::eDegenerateHandling eDegen  = CGrid::None) const;
+						CGrid::eDegenerateHandling eDegen  = CGrid::UseContext) const;
+	/// Returns the boolean result of 2 shapes using the sweep line engine. Arcs are
+	/// flattened to the tolerance and fitted back if it is above 0, otherwise falls back
+	/// to GetBoolean if either has arcs.
+	void GetBooleanSweep(const C2DHoledPolyBase& Other, C2DHoledPolyBaseSet& HoledPolys,
+						CPolygonBoolean::eOperation eOp, double dArcTolerance = 0) const;
+
+	/// Adds 3 point indexes for each triangle to the set, the points of the holes following
+	/// on from those of the rim. Arcs are treated as their chords.
+	bool Triangulate(CIndexSet& Triangles) const;
+
+	/// Adds the shape offset by the distance, outwards if positive, to the set. The holes
+	/// shrink as the rim grows.
+	void GetOffset(double dDistance, C2DHoledPolyBaseSet& Result,
+						CPolygonOffset::eJoinType eJoin = CPolygonOffset::Round) const;
+	/// Removes points within the tolerance from the rim and holes, keeping the holes
+	/// inside the rim and apart. Returns the number removed.
+	unsigned int Simplify(double dTolerance, CSimplifier::eMethod eMethod = CSimplifier::DouglasPeucker);
 
 	/// Transform by the given operator.
 	virtual void Transform(CTransformation* pProject);
@@ -18,6 +18,12 @@ Implementation file for C2DHoledPolyBaseSet, a collection of holed polygons.
 #include "C2DHoledPolyBase.h"
 #include "C2DPolyBase.h"
 #include "C2DLineBase.h"
+#include "C2DRect.h"
+#include "PolygonBoolean.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
 
 using namespace std;
 
@@ -298,6 +304,8 @@ lines.
 <P>---------------------------------------------------------------------------*/
 void C2DHoledPolyBaseSet::UnifyProgressive(CGrid::eDegenerateHandling eDegen) 
 {
+	eDegen = CGrid::Resolve(eDegen);
+
 	switch( eDegen )
 	{
 	case CGrid::RandomPerturbation:
@@ -316,6 +324,9 @@ void C2DHoledPolyBaseSet::UnifyProgressive(CGrid::eDegenerateHandling eDegen)
 		break;
 	case CGrid::PreDefinedGridPreSnapped:
 
+		break;
+	case CGrid::None:
+	case CGrid::UseContext:
 		break;
 	}
 
@@ -426,6 +437,219 @@ void C2DHoledPolyBaseSet::UnifyProgressive(CGrid::eDegenerateHandling eDegen)
 	(*this) << NoUnionSet;
 }
 
+/**--------------------------------------------------------------------------<BR>
+RectsTouch <BR>
+\brief True if the rectangles overlap or touch.
+<P>---------------------------------------------------------------------------*/
+static bool RectsTouch(const C2DRect& Rect1, const C2DRect& Rect2)
+{
+	return !(Rect1.GetLeft() > Rect2.GetRight() || Rect1.GetRight() < Rect2.GetLeft() ||
+			 Rect1.GetBottom() > Rect2.GetTop() || Rect1.GetTop() < Rect2.GetBottom());
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CascadeMerge <BR>
+\brief Unifies the 2 distinct sets into the first, emptying the second. Without arcs
+only the shapes which could touch the other set are passed to the sweep line engine, 
+the rest are moved straight over.
+<P>---------------------------------------------------------------------------*/
+static void CascadeMerge(C2DHoledPolyBaseSet& Set, C2DHoledPolyBaseSet& Other, 
+						 bool bSweep, CGrid::eDegenerateHandling eDegen)
+{
+	if (!bSweep)
+	{
+		Set << Other;
+		Set.UnifyProgressive(eDegen);
+		return;
+	}
+
+	C2DRect SetRect;
+	C2DRect OtherRect;
+	Set.GetBoundingRect(SetRect);
+	Other.GetBoundingRect(OtherRect);
+
+	C2DHoledPolyBaseSet Subject;
+	C2DHoledPolyBaseSet Clip;
+	C2DHoledPolyBaseSet Result;
+	C2DRect Rect;
+
+	while (Set.size() > 0)
+	{
+		C2DHoledPolyBase* pPoly = Set.ExtractLast();
+		pPoly->GetBoundingRect(Rect);
+		if (RectsTouch(Rect, OtherRect))
+			Subject.Add(pPoly);
+		else
+			Result.Add(pPoly);
+	}
+
+	while (Other.size() > 0)
+	{
+		C2DHoledPolyBase* pPoly = Other.ExtractLast();
+		pPoly->GetBoundingRect(Rect);
+		if (RectsTouch(Rect, SetRect))
+			Clip.Add(pPoly);
+		else
+			Result.Add(pPoly);
+	}
+
+	if (Subject.size() == 0 || Clip.size() == 0)
+	{
+		Result << Subject;
+		Result << Clip;
+	}
+	else
+	{
+		CPolygonBoolean Boolean;
+		Boolean.AddSubject(Subject);
+		Boolean.AddClip(Clip);
+		Boolean.Execute(CPolygonBoolean::Union, Result);
+	}
+
+	Set << Result;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolyBaseSet::UnifyCascaded
+\brief Cascaded union. The shapes are first put in Sort-Tile-Recursive order of 
+their bounding rectangle centres (sorted by x, cut into vertical strips and each
+strip sorted by y) so that shapes which are next to each other in the order are 
+close in space. Starting from each shape on its own, neighbouring groups are then 
+unified pairwise up a binary tree so each union is of 2 small, nearby groups of 
+similar size. The unions at each level are independent and are shared between 
+nThreads threads (0 for one per hardware thread).
+
+Without arcs the unions use the sweep line engine, CPolygonBoolean, which needs no
+degenerate handling. With arcs each union is done by UnifyProgressive. Each thread
+works in a copy of the calling thread's grid context, so the dynamic grid can be 
+used, and the degenerate errors are added back to the caller's context.
+<P>---------------------------------------------------------------------------*/
+void C2DHoledPolyBaseSet::UnifyCascaded(CGrid::eDegenerateHandling eDegen, unsigned int nThreads) 
+{
+	eDegen = CGrid::Resolve(eDegen);
+
+	switch( eDegen )
+	{
+	case CGrid::RandomPerturbation:
+		for (unsigned int i = 0 ; i < size() ; i++)
+		{
+			GetAt(i)->RandomPerturb();
+		}
+		eDegen = CGrid::None;
+		break;
+	case CGrid::DynamicGrid:
+
+		break;
+	case CGrid::PreDefinedGrid:
+		SnapToGrid();
+		eDegen = CGrid::PreDefinedGridPreSnapped;
+		break;
+	case CGrid::PreDefinedGridPreSnapped:
+
+		break;
+	case CGrid::None:
+	case CGrid::UseContext:
+		break;
+	}
+
+	if (size() < 2)
+		return;
+
+	const bool bSweep = !HasArcs();
+
+	if (nThreads == 0)
+		nThreads = max(1u, thread::hardware_concurrency());
+
+	// The workers start from the caller's grid settings without its error count.
+	CGridContext& Context = CGridContext::GetCurrent();
+	CGridContext WorkerContext(Context);
+	WorkerContext.ResetDegenerateErrors();
+
+	// Sort-Tile-Recursive order of the centres.
+	const unsigned int nCount = size();
+	vector<C2DPoint> Centres(nCount);
+	vector<unsigned int> Order(nCount);
+	C2DRect Rect;
+	for (unsigned int i = 0 ; i < nCount; i++)
+	{
+		GetAt(i)->GetBoundingRect(Rect);
+		Centres[i] = Rect.GetCentre();
+		Order[i] = i;
+	}
+
+	sort(Order.begin(), Order.end(), [&Centres](unsigned int a, unsigned int b)
+		{ return Centres[a].x < Centres[b].x; });
+
+	const unsigned int nStrips = (unsigned int)ceil(sqrt((double)nCount));
+	const unsigned int nStripSize = (nCount + nStrips - 1) / nStrips;
+	for (unsigned int nStart = 0 ; nStart < nCount; nStart += nStripSize)
+	{
+		unsigned int nEnd = min(nStart + nStripSize, nCount);
+		sort(Order.begin() + nStart, Order.begin() + nEnd, [&Centres](unsigned int a, unsigned int b)
+			{ return Centres[a].y < Centres[b].y; });
+	}
+
+	// The leaves of the tree.
+	vector<C2DHoledPolyBase*> Polys(nCount);
+	for (unsigned int i = nCount ; i > 0; i--)
+		Polys[i - 1] = ExtractLast();
+
+	vector<C2DHoledPolyBaseSet*> Groups(nCount);
+	for (unsigned int i = 0 ; i < nCount; i++)
+	{
+		Groups[i] = new C2DHoledPolyBaseSet;
+		Groups[i]->Add(Polys[Order[i]]);
+	}
+
+	// Merge pairs of neighbours until there is 1 group.
+	while (Groups.size() > 1)
+	{
+		const unsigned int nPairs = Groups.size() / 2;
+		const unsigned int nWorkers = min(nThreads, nPairs);
+		vector<CGridContext> Contexts(nWorkers, WorkerContext);
+		atomic<unsigned int> nNext(0);
+
+		auto Worker = [&](unsigned int nWorker)
+		{
+			CGridContextScope Scope(Contexts[nWorker]);
+			unsigned int nPair;
+			while ((nPair = nNext++) < nPairs)
+			{
+				CascadeMerge(*Groups[2 * nPair], *Groups[2 * nPair + 1], bSweep, eDegen);
+			}
+		};
+
+		vector<thread> Threads;
+		for (unsigned int i = 1 ; i < nWorkers; i++)
+			Threads.push_back(thread(Worker, i));
+		Worker(0);
+		for (unsigned int i = 0 ; i < Threads.size(); i++)
+			Threads[i].join();
+
+		for (unsigned int i = 0 ; i < nWorkers; i++)
+			Context.LogDegenerateError(Contexts[i].GetDegenerateErrors());
+
+		vector<C2DHoledPolyBaseSet*> NextGroups;
+		for (unsigned int i = 0 ; i < nPairs; i++)
+		{
+			NextGroups.push_back(Groups[2 * i]);
+			delete Groups[2 * i + 1];
+		}
+		if (Groups.size() % 2 == 1)
+			NextGroups.push_back(Groups.back());
+
+		Groups.swap(NextGroups);
+	}
+
+	if (bSweep && eDegen == CGrid::PreDefinedGridPreSnapped)
+		Groups[0]->SnapToGrid();
+
+	(*this) << *Groups[0];
+	delete Groups[0];
+}
+
 /**--------------------------------------------------------------------------<BR>
 C2DHoledPolyBaseSet::AddKnownHoles
 \brief Adds the shapes provided assuming they are known holes - adds them as holes
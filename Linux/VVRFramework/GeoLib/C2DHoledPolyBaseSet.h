@@ -14,6 +14,14 @@ Declaration file for C2DHoledPolyBaseSet, a collection of holed polygons.
 \brief A collection of holed polygons.
 
 Class which represents a collection of holed polygons.
+
+UnifyCascaded should cover the same area as UnifyProgressive but, as it joins shapes
+without arcs with the sweep line engine, CPolygonBoolean, the rings may differ. Shapes
+which touch only at a vertex are kept as separate shapes by both. A hole which touches
+another hole, or the rim, at a vertex is joined to it, giving one ring which passes
+through the vertex twice. Shapes which share edges are always joined, with any holes
+they enclose, where UnifyProgressive depends on the degenerate handling. Points where
+edges crossed or touched are kept even if they are in line.
 <P>---------------------------------------------------------------------------*/
 
 #ifndef _GEOLIB_C2DHOLEDPOLYBASESET_H 
@@ -97,7 +105,9 @@ public:
 	/// Basic multiple unification.
 	void UnifyBasic(void);
 	/// Unification by growing shapes of fairly equal size (fastest for large groups).
-	void UnifyProgressive(CGrid::eDegenerateHandling eDegen = CGrid::None);
+	void UnifyProgressive(CGrid::eDegenerateHandling eDegen = CGrid::UseContext);
+	/// Unification by merging neighbouring groups up a tree in parallel (fastest for very large groups).
+	void UnifyCascaded(CGrid::eDegenerateHandling eDegen = CGrid::UseContext, unsigned int nThreads = 0);
 	/// Assumes current set is distinct.
 	void AddAndUnify(C2DHoledPolyBase* pPoly);
 	/// Assumes both sets are distinct.
@@ -111,27 +111,27 @@ public:
 
 	/// Returns the overlaps between this and the other complex polygon.
 	void GetOverlaps(const C2DHoledPolygon& Other, C2DHoledPolygonSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the overlaps between this and the other complex polygon.
 	void GetOverlaps(const C2DHoledPolygon& Other, C2DHoledPolyBaseSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the difference between this and the other polygon.
 	void GetNonOverlaps(const C2DHoledPolygon& Other, C2DHoledPolygonSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the difference between this and the other polygon.
 	void GetNonOverlaps(const C2DHoledPolygon& Other, C2DHoledPolyBaseSet& HoledPolys, 
-							CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+							CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the union of this and the other.
 	void GetUnion(const C2DHoledPolygon& Other, C2DHoledPolygonSet& HoledPolys,
-					CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+					CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 
 	/// Returns the union of this and the other.
 	void GetUnion(const C2DHoledPolygon& Other, C2DHoledPolyBaseSet& HoledPolys,
-					CGrid::eDegenerateHandling eDegen = CGrid::None) const;
+					CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const;
 	/// Removes null areas, will return true if the shape is no longer valid.
 	bool RemoveNullAreas(double dTolerance);
 
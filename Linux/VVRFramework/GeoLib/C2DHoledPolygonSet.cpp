@@ -136,6 +136,27 @@ void C2DHoledPolygonSet::UnifyProgressive(CGrid::eDegenerateHandling eDegen)
 	}
 }
 
+
+/**--------------------------------------------------------------------------<BR>
+C2DHoledPolygonSet::UnifyCascaded
+\brief Cascaded union, merging neighbouring groups of shapes up a tree in parallel. 
+See C2DHoledPolyBaseSet function also.
+<P>---------------------------------------------------------------------------*/
+void C2DHoledPolygonSet::UnifyCascaded(CGrid::eDegenerateHandling eDegen, unsigned int nThreads)
+{
+	C2DHoledPolyBaseSet BaseSet;
+
+	while (size() > 0)
+		BaseSet.Add( ExtractLast());
+
+	BaseSet.UnifyCascaded(eDegen, nThreads);
+
+	for (unsigned int i = 0 ; i <  BaseSet.size(); i++)
+	{
+		Add(new C2DHoledPolygon( BaseSet[i]));
+	}
+}
+
 /**--------------------------------------------------------------------------<BR>
 C2DHoledPolygonSet::operator<<
 \brief Adds a new item.
@@ -999,13 +999,15 @@ C2DLine::Transform
 <P>---------------------------------------------------------------------------*/
 void C2DLine::Transform(CTransformation* pProject)
 {
-	C2DPoint pt2(point.x + vector.i, point.y + vector.j);
+	double X[2] = {point.x, point.x + vector.i};
+	double Y[2] = {point.y, point.y + vector.j};
 
-	pProject->Transform(point.x, point.y);
-	pProject->Transform(pt2.x, pt2.y);
+	pProject->TransformPoints(X, Y, 2);
 
-	vector.i = pt2.x - point.x;
-	vector.j = pt2.y - point.y;
+	point.x = X[0];
+	point.y = Y[0];
+	vector.i = X[1] - X[0];
+	vector.j = Y[1] - Y[0];
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -1014,11 +1016,13 @@ C2DLine::InverseTransform
 <P>---------------------------------------------------------------------------*/
 void C2DLine::InverseTransform(CTransformation* pProject)
 {
-	C2DPoint pt2(point.x + vector.i, point.y + vector.j);
+	double X[2] = {point.x, point.x + vector.i};
+	double Y[2] = {point.y, point.y + vector.j};
 
-	pProject->InverseTransform(point.x, point.y);
-	pProject->InverseTransform(pt2.x, pt2.y);
+	pProject->InverseTransformPoints(X, Y, 2);
 
-	vector.i = pt2.x - point.x;
-	vector.j = pt2.y - point.y;
+	point.x = X[0];
+	point.y = Y[0];
+	vector.i = X[1] - X[0];
+	vector.j = Y[1] - Y[0];
 }
@@ -19,6 +19,13 @@ Implementation file for C2DPointSet, a class which represents a set of points.
 #include "C2DBaseSet.h"
 #include "C2DRect.h"
 #include "C2DCircle.h"
+#include "PointKdTree.h"
+#include "Delaunay.h"
+#include "IndexSet.h"
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <limits>
 
 using namespace std;
 
@@ -121,65 +128,152 @@ void C2DPointSet::SortByAngleFromNorth( const C2DPoint& Origin)
 }
 
 /**--------------------------------------------------------------------------<BR>
-C2DPointSet::ExtractConvexHull<BR>
-\brief Extracts the convex hull from the points given. Uses Graham's scan.
+struct sIndexedPoint
+\brief A point and its index in the set, held in a plain array by the convex hull,
+minimum enclosing circle and closest pair.
 <P>---------------------------------------------------------------------------*/
-void C2DPointSet::ExtractConvexHull( C2DPointSet& Other)
+struct sIndexedPoint
 {
-	DeleteAll();
+	double x;
+	double y;
+	unsigned int nIndex;
+};
 
-	if (Other.size() < 4)
+/// Below this number of points the hull is always found on one thread.
+const unsigned int conMinParallelHull = 100000;
+
+
+/**--------------------------------------------------------------------------<BR>
+IndexedPointLess<BR>
+\brief Orders points by x then y.
+<P>---------------------------------------------------------------------------*/
+static bool IndexedPointLess(const sIndexedPoint& A, const sIndexedPoint& B)
+{
+	return A.x < B.x || (A.x == B.x && A.y < B.y);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+HullCross<BR>
+\brief The cross product of OA and OB, positive if OAB turns left.
+<P>---------------------------------------------------------------------------*/
+static double HullCross(const sIndexedPoint& O, const sIndexedPoint& A, const sIndexedPoint& B)
+{
+	return (A.x - O.x) * (B.y - O.y) - (A.y - O.y) * (B.x - O.x);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MonotoneChain<BR>
+\brief Andrew's monotone chain. Sorts the range and sets the hull to be the convex
+hull of it, clockwise from the lowest, left most point. Collinear points are not
+included.
+<P>---------------------------------------------------------------------------*/
+static void MonotoneChain(sIndexedPoint* pBegin, sIndexedPoint* pEnd, vector<sIndexedPoint>& Hull)
+{
+	sort(pBegin, pEnd, IndexedPointLess);
+
+	const unsigned int nSize = pEnd - pBegin;
+	Hull.resize(2 * nSize);
+	if (nSize < 3)
 	{
-		*this << Other;
+		Hull.assign(pBegin, pEnd);
 		return;
 	}
 
-	C2DPoint ptLeftMost = Other[0];
-	int nLeftMost = 0;
-	
-	// Find left most
-	for (unsigned int i = 1 ; i < Other.size(); i++)
+	unsigned int k = 0;
+	// The upper chain from left to right.
+	for (unsigned int i = 0 ; i < nSize; i++)
 	{
-		C2DPoint pt = Other[i];
-		if (pt.x < ptLeftMost.x)
-		{
-			ptLeftMost = pt;
-			nLeftMost = i;
-		}
+		while (k >= 2 && HullCross(Hull[k - 2], Hull[k - 1], pBegin[i]) >= 0)
+			k--;
+		Hull[k++] = pBegin[i];
 	}
+	// The lower chain back from right to left.
+	const unsigned int nUpper = k + 1;
+	for (unsigned int i = nSize - 1 ; i > 0; i--)
+	{
+		while (k >= nUpper && HullCross(Hull[k - 2], Hull[k - 1], pBegin[i - 1]) >= 0)
+			k--;
+		Hull[k++] = pBegin[i - 1];
+	}
+	// The last is the first again.
+	Hull.resize(k - 1);
+}
 
-	this->Add(Other.ExtractAt(nLeftMost));
-
-	Other.SortByAngleFromNorth( (*this)[0]);
-
-	// Always add the left most and the first of the rest.
-	Add(Other.ExtractAt(0));
 
-	// Add others if needed.
-	unsigned int nIndx = 0;
+/**--------------------------------------------------------------------------<BR>
+C2DPointSet::ExtractConvexHull<BR>
+\brief Extracts the convex hull from the points given, clockwise from the left most
+point. Uses Andrew's monotone chain on a copy of the coordinates. For large sets the
+points are split into blocks whose hulls are found on separate threads and the hull
+of the block hulls is then found. nThreads of 0 uses the number of cores.
+<P>---------------------------------------------------------------------------*/
+void C2DPointSet::ExtractConvexHull( C2DPointSet& Other, unsigned int nThreads)
+{
+	DeleteAll();
 
-	C2DPointSet Unused;
+	if (Other.size() < 4)
+	{
+		*this << Other;
+		return;
+	}
 
-	while (nIndx < Other.size())
+	const unsigned int nSize = Other.size();
+	vector<sIndexedPoint> Points(nSize);
+	for (unsigned int i = 0 ; i < nSize; i++)
 	{
-			unsigned int nLast = size() - 1;
-			C2DLine LastLine( (*this)[nLast-1], (*this)[nLast]);
+		const C2DPoint& pt = Other[i];
+		Points[i].x = pt.x;
+		Points[i].y = pt.y;
+		Points[i].nIndex = i;
+	}
 
-			C2DVector Test((*this)[nLast], Other[nIndx]);
+	if (nThreads == 0)
+		nThreads = thread::hardware_concurrency();
+	if (nSize < conMinParallelHull)
+		nThreads = 1;
 
-			double dAng = Test.AngleFromNorth();
+	vector<sIndexedPoint> Hull;
+	if (nThreads <= 1)
+	{
+		MonotoneChain(&Points[0], &Points[0] + nSize, Hull);
+	}
+	else
+	{
+		vector< vector<sIndexedPoint> > BlockHulls(nThreads);
+		vector<thread> Threads;
+		for (unsigned int t = 0 ; t < nThreads; t++)
+		{
+			sIndexedPoint* pBegin = &Points[0] + (size_t)nSize * t / nThreads;
+			sIndexedPoint* pEnd = &Points[0] + (size_t)nSize * (t + 1) / nThreads;
+			Threads.push_back(thread(MonotoneChain, pBegin, pEnd, ref(BlockHulls[t])));
+		}
+		vector<sIndexedPoint> Merged;
+		for (unsigned int t = 0 ; t < nThreads; t++)
+		{
+			Threads[t].join();
+			Merged.insert(Merged.end(), BlockHulls[t].begin(), BlockHulls[t].end());
+		}
+		MonotoneChain(&Merged[0], &Merged[0] + Merged.size(), Hull);
+	}
 
-			if (dAng < LastLine.vector.AngleFromNorth())
-			{
-				Unused.Add( ExtractAt(nLast) );
-			}
-			else
-			{
-				Add(Other.ExtractAt(nIndx));
-			}
+	// Move the hull points to this and keep the rest in order in the other.
+	C2DBaseData& OtherData = *reinterpret_cast<C2DBaseData*>(Other.m_Data);
+	vector<bool> InHull(nSize, false);
+	for (unsigned int i = 0 ; i < Hull.size(); i++)
+	{
+		InHull[Hull[i].nIndex] = true;
+		C2DBaseSet::Add(OtherData[Hull[i].nIndex]);
 	}
 
-	Other << Unused;	
+	unsigned int nKept = 0;
+	for (unsigned int i = 0 ; i < nSize; i++)
+	{
+		if (!InHull[i])
+			OtherData[nKept++] = OtherData[i];
+	}
+	OtherData.resize(nKept);
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -290,6 +384,125 @@ void C2DPointSet::GetBoundingCircle(C2DCircle& Circle) const
 }
 
 
+/**--------------------------------------------------------------------------<BR>
+InCircle<BR>
+\brief True if the point is in the circle, allowing for rounding.
+<P>---------------------------------------------------------------------------*/
+static bool InCircle(const sIndexedPoint& Centre, double dRadiusSq, const sIndexedPoint& pt)
+{
+	double dx = pt.x - Centre.x;
+	double dy = pt.y - Centre.y;
+	return dx * dx + dy * dy <= dRadiusSq * (1 + conEqualityTolerance);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+SetCircle2<BR>
+\brief Sets the centre and squared radius to be the smallest circle through 2 points.
+<P>---------------------------------------------------------------------------*/
+static void SetCircle2(const sIndexedPoint& A, const sIndexedPoint& B, sIndexedPoint& Centre,
+					   double& dRadiusSq)
+{
+	Centre.x = (A.x + B.x) / 2;
+	Centre.y = (A.y + B.y) / 2;
+	double dx = A.x - Centre.x;
+	double dy = A.y - Centre.y;
+	dRadiusSq = dx * dx + dy * dy;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+SetCircle3<BR>
+\brief Sets the centre and squared radius to be the circle through 3 points. If they
+are collinear it is the circle on the 2 furthest apart.
+<P>---------------------------------------------------------------------------*/
+static void SetCircle3(const sIndexedPoint& A, const sIndexedPoint& B, const sIndexedPoint& C, 
+					   sIndexedPoint& Centre, double& dRadiusSq)
+{
+	double bx = B.x - A.x;
+	double by = B.y - A.y;
+	double cx = C.x - A.x;
+	double cy = C.y - A.y;
+	double d = 2 * (bx * cy - by * cx);
+	double dB = bx * bx + by * by;
+	double dC = cx * cx + cy * cy;
+
+	if (fabs(d) <= conEqualityTolerance * (dB + dC))
+	{
+		double dBC = (C.x - B.x) * (C.x - B.x) + (C.y - B.y) * (C.y - B.y);
+		if (dB >= dC && dB >= dBC)
+			SetCircle2(A, B, Centre, dRadiusSq);
+		else if (dC >= dBC)
+			SetCircle2(A, C, Centre, dRadiusSq);
+		else
+			SetCircle2(B, C, Centre, dRadiusSq);
+		return;
+	}
+
+	double ux = (cy * dB - by * dC) / d;
+	double uy = (bx * dC - cx * dB) / d;
+	Centre.x = A.x + ux;
+	Centre.y = A.y + uy;
+	dRadiusSq = ux * ux + uy * uy;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPointSet::GetMinimumEnclosingCircle<BR>
+\brief Gets the smallest circle containing all the points. Uses Welzl's algorithm,
+in its iterative form, on a shuffled copy of the coordinates which takes expected 
+linear time. The shuffle has a fixed seed so the result is repeatable.
+<P>---------------------------------------------------------------------------*/
+void C2DPointSet::GetMinimumEnclosingCircle(C2DCircle& Circle) const
+{
+	const unsigned int nSize = size();
+	if (nSize == 0)
+	{
+		assert(0);
+		return;
+	}
+
+	vector<sIndexedPoint> Points(nSize);
+	for (unsigned int i = 0 ; i < nSize; i++)
+	{
+		const C2DPoint* pt = GetAt(i);
+		Points[i].x = pt->x;
+		Points[i].y = pt->y;
+		Points[i].nIndex = i;
+	}
+
+	mt19937 Random;
+	shuffle(Points.begin(), Points.end(), Random);
+
+	sIndexedPoint Centre = Points[0];
+	double dRadiusSq = 0;
+	for (unsigned int i = 1 ; i < nSize; i++)
+	{
+		if (InCircle(Centre, dRadiusSq, Points[i]))
+			continue;
+
+		// Points[i] is on the circle of the first i + 1 points.
+		Centre = Points[i];
+		dRadiusSq = 0;
+		for (unsigned int j = 0 ; j < i; j++)
+		{
+			if (InCircle(Centre, dRadiusSq, Points[j]))
+				continue;
+
+			// So is Points[j].
+			SetCircle2(Points[i], Points[j], Centre, dRadiusSq);
+			for (unsigned int k = 0 ; k < j; k++)
+			{
+				if (!InCircle(Centre, dRadiusSq, Points[k]))
+					SetCircle3(Points[i], Points[j], Points[k], Centre, dRadiusSq);
+			}
+		}
+	}
+
+	Circle.Set(C2DPoint(Centre.x, Centre.y), sqrt(dRadiusSq));
+}
+
+
 /**--------------------------------------------------------------------------<BR>
 C2DPointSet::GetExtremePoints<BR>
 \brief Returns the indexes of the 2 points which are furthest from each other.
@@ -497,136 +710,178 @@ void C2DPointSet::SortByAngleToLeft( const C2DLine& Line)
 
 }
 
+/// Below this number of points the nearest neighbours are always found on one thread.
+const unsigned int conMinParallelNearest = 10000;
+
+
 /**--------------------------------------------------------------------------<BR>
-struct sPointIndex
-\brief Structure to hold a point reference and its corresponding index.
+IndexedPointLessY<BR>
+\brief Orders points by y.
 <P>---------------------------------------------------------------------------*/
-struct sPointIndex
+static bool IndexedPointLessY(const sIndexedPoint& A, const sIndexedPoint& B)
 {
-	const C2DPoint* pt;
-	unsigned int usIndex;
-};
+	return A.y < B.y;
+}
+
 
-class PointIndexSet : public vector<sPointIndex*>
+/**--------------------------------------------------------------------------<BR>
+TestPair<BR>
+\brief Records the pair if it is closer than the best so far.
+<P>---------------------------------------------------------------------------*/
+static void TestPair(const sIndexedPoint& A, const sIndexedPoint& B, double& dBestSq,
+					 unsigned int& nIndex1, unsigned int& nIndex2)
 {
-};
+	double dx = A.x - B.x;
+	double dy = A.y - B.y;
+	double dDistSq = dx * dx + dy * dy;
+	if (dDistSq < dBestSq)
+	{
+		dBestSq = dDistSq;
+		nIndex1 = A.nIndex;
+		nIndex2 = B.nIndex;
+	}
+}
 
 
 /**--------------------------------------------------------------------------<BR>
-C2DPointSet::GetClosestPair<BR>
-\brief Private function to help finding closest pair.
+ClosestPair<BR>
+\brief Divide and conquer closest pair on points sorted by x. The points are left 
+sorted by y, merging the halves as in a merge sort, so each level is linear. The 
+scratch array must be as long as the points and is used for the merge and strip.
 <P>---------------------------------------------------------------------------*/
-double C2DPointSet::GetClosestPair(PointIndexSet& Pts, unsigned int& nIndex1, unsigned int& nIndex2)
+static void ClosestPair(sIndexedPoint* pPoints, sIndexedPoint* pScratch, unsigned int nSize,
+						double& dBestSq, unsigned int& nIndex1, unsigned int& nIndex2)
 {
-	if (Pts.size() > 2)
+	if (nSize <= 3)
 	{
-		PointIndexSet Pts1;
-		PointIndexSet Pts2;
-		
-		unsigned int nHalfWay = Pts.size() / 2;
-		double dHalfWay = Pts[ nHalfWay ]->pt->x;
-		
-		for ( unsigned int i = 0; i <= nHalfWay ; i++)
-		{
-			Pts1.push_back( Pts[i] );
-		}
-		for ( unsigned int i = nHalfWay; i < Pts.size() ; i++)
+		for (unsigned int i = 0 ; i < nSize; i++)
 		{
-			Pts2.push_back( Pts[i] );
+			for (unsigned int j = i + 1 ; j < nSize; j++)
+				TestPair(pPoints[i], pPoints[j], dBestSq, nIndex1, nIndex2);
 		}
-		unsigned int n1_1;
-		unsigned int n1_2;	
-		unsigned int n2_1;
-		unsigned int n2_2;
+		sort(pPoints, pPoints + nSize, IndexedPointLessY);
+		return;
+	}
 
-		double d1 = C2DPointSet::GetClosestPair(Pts1, n1_1, n1_2);
-		double d2 = C2DPointSet::GetClosestPair(Pts2, n2_1, n2_2);
+	unsigned int nHalf = nSize / 2;
+	double dMidX = pPoints[nHalf].x;
 
-		double dMinDist;
-		if (d1 < d2)
-		{
-			dMinDist = d1;
-			nIndex1 = n1_1;
-			nIndex2 = n1_2;
-		}
-		else
-		{
-			dMinDist = d2;
-			nIndex1 = n2_1 + nHalfWay;
-			nIndex2 = n2_2 + nHalfWay;
-		}
+	ClosestPair(pPoints, pScratch, nHalf, dBestSq, nIndex1, nIndex2);
+	ClosestPair(pPoints + nHalf, pScratch, nSize - nHalf, dBestSq, nIndex1, nIndex2);
 
-		double dMin = dHalfWay - dMinDist;
-		double dMax = dHalfWay + dMinDist;
-		unsigned int i = Pts1.size() - 2; // don't start on last as that was included in the other set
-		while ( i >= 0 && Pts1[i]->pt->x > dMin)
-		{
-			unsigned int j = 1;	// don't start on last as that was included in the other set
-			while ( j < Pts2.size() && Pts2[j]->pt->x < dMax)
-			{
-				if ( abs( Pts2[j]->pt->y - Pts1[i]->pt->y ) < dMinDist )
-				{
-					double dDist = Pts2[j]->pt->Distance( *Pts1[i]->pt );
-					if (dDist < dMinDist)
-					{
-						dMinDist = dDist;
-						dMin = dHalfWay - dMinDist;
-						dMax = dHalfWay + dMinDist;
-						nIndex1 = i;
-						nIndex2 = j + nHalfWay;
-					}
-				}
-				j++;
-			}
-			i--;
-		}
-		return dMinDist;
+	merge(pPoints, pPoints + nHalf, pPoints + nHalf, pPoints + nSize, pScratch, IndexedPointLessY);
+	copy(pScratch, pScratch + nSize, pPoints);
 
-	}
-	else if (Pts.size() == 2)
+	// Check the points near the dividing line, each against those just above it.
+	unsigned int nStrip = 0;
+	for (unsigned int i = 0 ; i < nSize; i++)
 	{
-		nIndex1 = 0;
-		nIndex2 = 1;
-		return Pts[0]->pt->Distance( *Pts[1]->pt );
+		double dx = pPoints[i].x - dMidX;
+		if (dx * dx < dBestSq)
+			pScratch[nStrip++] = pPoints[i];
 	}
-	else
+	for (unsigned int i = 0 ; i < nStrip; i++)
 	{
-		assert(false);
-		return 0;
+		for (unsigned int j = i + 1 ; j < nStrip; j++)
+		{
+			double dy = pScratch[j].y - pScratch[i].y;
+			if (dy * dy >= dBestSq)
+				break;
+			TestPair(pScratch[i], pScratch[j], dBestSq, nIndex1, nIndex2);
+		}
 	}
 }
 
+
 /**--------------------------------------------------------------------------<BR>
 C2DPointSet::GetClosestPair<BR>
-\brief Gets the closest pair of points.
+\brief Gets the closest pair of points and returns the distance between them. Uses
+divide and conquer on a copy of the coordinates with one scratch array.
 <P>---------------------------------------------------------------------------*/
 double C2DPointSet::GetClosestPair(unsigned int& nIndex1, unsigned int& nIndex2) const
 {
-	PointIndexSet Pts;
-	std::vector<double> xValues;
+	nIndex1 = 0;
+	nIndex2 = 0;
+
+	const unsigned int nSize = size();
+	if (nSize < 2)
+	{
+		assert(false);
+		return 0;
+	}
 
-	for (unsigned int i = 0 ; i < size() ; i++)
+	vector<sIndexedPoint> Points(nSize);
+	for (unsigned int i = 0 ; i < nSize; i++)
 	{
-		sPointIndex* pPointIndex = new sPointIndex;
-		pPointIndex->pt = GetAt(i);
-		pPointIndex->usIndex = i;
-		Pts.push_back( pPointIndex );
-		xValues.push_back(pPointIndex->pt->x);
+		const C2DPoint* pt = GetAt(i);
+		Points[i].x = pt->x;
+		Points[i].y = pt->y;
+		Points[i].nIndex = i;
 	}
+	sort(Points.begin(), Points.end(), IndexedPointLess);
 
-	// Sort them all according to the left most point of the line rects.
-	GeoSort::PQuickSort< std::vector<double>, double, std::vector<sPointIndex*>, sPointIndex*>( xValues, Pts);
+	vector<sIndexedPoint> Scratch(nSize);
+	double dBestSq = numeric_limits<double>::max();
+	ClosestPair(&Points[0], &Scratch[0], nSize, dBestSq, nIndex1, nIndex2);
 
-	double dResult = C2DPointSet::GetClosestPair(Pts, nIndex1, nIndex2);
+	if (nIndex1 > nIndex2)
+		swap(nIndex1, nIndex2);
 
-	for (unsigned int i = 0 ; i < Pts.size() ; i++)
+	return sqrt(dBestSq);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPointSet::GetAllNearestNeighbours<BR>
+\brief Gets the index of the nearest other point to each point and, if required,
+the distance to it. A point on its own is given itself. Uses a kd-tree, queried on 
+nThreads threads for large sets, the number of cores if 0.
+<P>---------------------------------------------------------------------------*/
+void C2DPointSet::GetAllNearestNeighbours(std::vector<unsigned int>& Nearest, 
+			std::vector<double>* pDistances, unsigned int nThreads) const
+{
+	const unsigned int nSize = size();
+	Nearest.resize(nSize);
+	if (pDistances)
+		pDistances->resize(nSize);
+
+	vector<sKdPoint> Points(nSize);
+	for (unsigned int i = 0 ; i < nSize; i++)
 	{
-		delete Pts[i];
+		const C2DPoint* pt = GetAt(i);
+		Points[i].x = pt->x;
+		Points[i].y = pt->y;
 	}
+	CPointKdTree Tree(Points);
 
-	return dResult;
+	if (nThreads == 0)
+		nThreads = thread::hardware_concurrency();
+	if (nSize < conMinParallelNearest || nThreads == 0)
+		nThreads = 1;
 
+	auto Query = [&](unsigned int nBegin, unsigned int nEnd)
+	{
+		// Query in tree order as the search paths of neighbouring points are similar.
+		for (unsigned int nPosition = nBegin ; nPosition < nEnd; nPosition++)
+		{
+			unsigned int i = Tree.GetPointInTreeOrder(nPosition);
+			double dDist;
+			int nNearest = Tree.GetNearest(i, dDist);
+			Nearest[i] = nNearest < 0 ? i : nNearest;
+			if (pDistances)
+				(*pDistances)[i] = dDist;
+		}
+	};
+
+	vector<thread> Threads;
+	for (unsigned int t = 1 ; t < nThreads; t++)
+		Threads.push_back(thread(Query, (size_t)nSize * t / nThreads, (size_t)nSize * (t + 1) / nThreads));
+	Query(0, nSize / nThreads);
+	for (unsigned int t = 0 ; t < Threads.size(); t++)
+		Threads[t].join();
 }
+
+
 /**--------------------------------------------------------------------------<BR>
 C2DPointSet::SortLeftToRight<BR>
 \brief Sorts left to right.
@@ -645,3 +900,34 @@ void C2DPointSet::SortLeftToRight(void)
 	GeoSort::PQuickSort<std::vector<double>, double, C2DBaseData, C2DBase*>(dLefts, Data);
 
 }
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPointSet::GetDelaunayTriangles<BR>
+\brief Adds 3 point indexes for each Delaunay triangle to the set, anticlockwise.
+False if there are none e.g. the points are collinear. See CDelaunay.
+<P>---------------------------------------------------------------------------*/
+bool C2DPointSet::GetDelaunayTriangles(CIndexSet& Triangles) const
+{
+	CDelaunay Delaunay;
+	if (!Delaunay.Create(*this))
+		return false;
+
+	const std::vector<unsigned int>& Result = Delaunay.GetTriangles();
+	for (unsigned int i = 0; i < Result.size(); i++)
+		Triangles.Add(Result[i]);
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPointSet::GetVoronoiCells<BR>
+\brief Adds the Voronoi cells clipped to the rectangle to the set. See CDelaunay.
+<P>---------------------------------------------------------------------------*/
+void C2DPointSet::GetVoronoiCells(const C2DRect& Rect, C2DPolygonSet& Cells) const
+{
+	CDelaunay Delaunay;
+	if (Delaunay.Create(*this))
+		Delaunay.GetVoronoiCells(Rect, Cells);
+}
@@ -27,8 +27,9 @@ sorting functions and a convex hull algorithm.
 
 class C2DBaseSet;
 class C2DCircle;
-struct sPointIndex;
-class PointIndexSet;
+class C2DRect;
+class C2DPolygonSet;
+class CIndexSet;
 
 class GeoLib_API C2DPointSet :  public C2DBaseSet
 {
@@ -85,7 +86,7 @@ public:
 	void operator<<(C2DPoint* NewItem) {C2DBaseSet::operator <<(NewItem);};
 
 	/// Removes the convex hull from the point set given.
-	void ExtractConvexHull( C2DPointSet& Other);
+	void ExtractConvexHull( C2DPointSet& Other, unsigned int nThreads = 0);
 	/// Sorts by the angle from north relative to the origin given.
 	void SortByAngleFromNorth( const C2DPoint& Origin);
 	/// Sorts by the angle to the right of the line.
@@ -97,6 +98,8 @@ public:
 	void GetBoundingRect(C2DRect& Rect) const;
 	/// Gets the minimum bounding circle.
 	void GetBoundingCircle(C2DCircle& Circle) const;
+	/// Gets the smallest circle containing all the points.
+	void GetMinimumEnclosingCircle(C2DCircle& Circle) const;
 	/// Returns an estimate of the furthest points, usually correct.
 	void GetExtremePointsEst(unsigned int& nIndx1, unsigned int& nIndx2, 
 		double& dDist, unsigned int nStartEst = 0) const;
@@ -107,14 +110,19 @@ public:
 	void RemoveRepeatedPoints(void);
 	/// Gets the closts pair of points in the set.
 	double GetClosestPair(unsigned int& nIndex1, unsigned int& nIndex2) const;
+	/// Gets the nearest other point to every point.
+	void GetAllNearestNeighbours(std::vector<unsigned int>& Nearest, 
+		std::vector<double>* pDistances = 0, unsigned int nThreads = 0) const;
+	/// Adds 3 point indexes for each Delaunay triangle to the set.
+	bool GetDelaunayTriangles(CIndexSet& Triangles) const;
+	/// Adds the Voronoi cells clipped to the rectangle to the set.
+	void GetVoronoiCells(const C2DRect& Rect, C2DPolygonSet& Cells) const;
 	/// Sorts from left to right.
 	void SortLeftToRight(void);
 
 private:
 	/// Returns the furthest point from the one given.
 	unsigned int GetFurthestPoint(unsigned int nIndex, double& dDist) const;
-	/// Gets the closts pair of points in the set.
-	static double GetClosestPair(PointIndexSet& Pts, unsigned int& nIndex1, unsigned int& nIndex2);
 
 };
 
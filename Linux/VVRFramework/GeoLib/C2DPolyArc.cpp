@@ -101,6 +101,8 @@ void C2DPolyArc::LineTo(const C2DPoint& Point, double dRadius,
 	if (m_Lines.size() == 0)
 		return;
 
+	ClearFlattened();
+
 	C2DArc* pLine = new C2DArc( m_Lines.GetLast()->GetPointTo(), Point, 
 								dRadius, bCentreOnRight, bArcOnRight);
 
@@ -124,6 +126,8 @@ void C2DPolyArc::LineTo(const C2DPoint& Point)
 	if (m_Lines.size() == 0)
 		return;
 
+	ClearFlattened();
+
 	C2DLine* pLine = new C2DLine( m_Lines.GetLast()->GetPointTo(), Point );
 
 	if (m_Lines.size() == 1 && m_Lines[0].GetType() == C2DBase::StraightLine &&
@@ -181,13 +185,14 @@ void C2DPolyArc::Close(void)
 C2DPolygon::CreateRandom <BR>
 \brief .
 <P>---------------------------------------------------------------------------*/
-bool C2DPolyArc::CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints)
+bool C2DPolyArc::CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints,
+							  CRandomGenerator* pGenerator)
 {
 	C2DPolygon Poly;
-	if (!Poly.CreateRandom(cBoundary, nMinPoints, nMaxPoints))
+	if (!Poly.CreateRandom(cBoundary, nMinPoints, nMaxPoints, pGenerator))
 		return false;
 
-	CRandomNumber rCenOnRight(0, 1);
+	CRandomNumber rCenOnRight(0, 1, pGenerator);
 
 	this->Set( Poly );
 
@@ -197,7 +202,7 @@ bool C2DPolyArc::CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMax
 
 		bool bCenOnRight = (rCenOnRight.GetInt() > 0 );
 		double dLength = pLine->GetLength();
-		CRandomNumber Radius(dLength , dLength * 3);
+		CRandomNumber Radius(dLength , dLength * 3, pGenerator);
 
 
 		C2DArc* pNew = new C2DArc( pLine->GetPointFrom(), pLine->GetPointTo(), 
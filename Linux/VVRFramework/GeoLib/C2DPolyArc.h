@@ -30,6 +30,7 @@ or curved. Inherits most funcionality from the area base class.
 
 class C2DHoledPolyArcSet;
 class C2DPolyArcSet;
+class CRandomGenerator;
 
 #ifdef _POLY_EXPORTING
 	#define POLY_DECLSPEC		__declspec(dllexport)
@@ -74,8 +75,9 @@ public:
 	void Close(double dRadius, bool bCentreOnRight, bool bArcOnRight);
 	/// Close with a straight line. WILL AUTO JOIN TO THE FIRST POINT.
 	void Close(void);
-	/// Creates a random shape e.g. for testing.
-	bool CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints);
+	/// Creates a random shape e.g. for testing, from the generator, 0 for the thread's.
+	bool CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints,
+						CRandomGenerator* pGenerator = 0);
 
 	/// Clears.
 	void Clear(void);
@@ -83,23 +85,23 @@ public:
 	int GetPointsCount(void) const {return (int)m_Lines.size();}
 	/// Gets the non overlaps i.e. the parts of this that aren't in the other.
 	void GetNonOverlaps(const C2DPolyArc& Other, C2DHoledPolyArcSet& HoledPolygons, 
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 	/// Gets the non overlaps i.e. the parts of this that aren't in the other.
 	void GetNonOverlaps(const C2DPolyArc& Other, C2DHoledPolyBaseSet& HoledPolygons, 
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 	/// Gets the union of the 2 shapes.
 	void GetUnion(const C2DPolyArc& Other, C2DHoledPolyArcSet& HoledPolygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 	/// Gets the union of the 2 shapes.
 	void GetUnion(const C2DPolyArc& Other, C2DHoledPolyBaseSet& HoledPolygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// Gets the overlaps of the 2 shapes.
 	void GetOverlaps(const C2DPolyArc& Other, C2DHoledPolyArcSet& Polygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 	/// Gets the overlaps of the 2 shapes.	
 	void GetOverlaps(const C2DPolyArc& Other, C2DHoledPolyBaseSet& Polygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// Returns the centroid.
 	C2DPoint GetCentroid(void) const;
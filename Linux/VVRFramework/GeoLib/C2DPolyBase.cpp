@@ -27,6 +27,8 @@ is a closed set of lines of some sort.
 #include "C2DPointSet.h"
 #include "C2DSegment.h"
 #include "Sort.h"
+#include "PolygonTriangulator.h"
+#include "Transformation.h"
 
 using namespace std;
 
@@ -303,6 +305,8 @@ C2DPolyBase::MakeBoundingRect <BR>
 <P>---------------------------------------------------------------------------*/
 void C2DPolyBase::MakeBoundingRect(void)
 {
+	ClearFlattened();
+
 	if ( m_LineRects.size() == 0)
 	{
 		m_BoundingRect.Clear();
@@ -325,6 +329,7 @@ C2DPolyBase::MakeLineRects <BR>
 <P>---------------------------------------------------------------------------*/
 void C2DPolyBase::MakeLineRects(void)
 {
+	ClearFlattened();
 	m_LineRects.DeleteAll();
 
 	unsigned int nCount = m_Lines.size();
@@ -346,6 +351,7 @@ C2DPolyBase::Clear <BR>
 <P>---------------------------------------------------------------------------*/
 void C2DPolyBase::Clear(void)
 {
+	ClearFlattened();
 	m_BoundingRect.Clear();
 	m_Lines.DeleteAll();
 	m_LineRects.DeleteAll();
@@ -381,6 +387,58 @@ bool C2DPolyBase::IsWithinDistance(const C2DPoint& pt, double dRange) const
 	return false;
 }
 
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::GetFlattened <BR>
+\brief The shape with the arcs replaced by chords within the tolerance. The result is
+kept and returned again for any tolerance no finer than it was made for until the
+shape changes. It may be called from several threads at once.
+<P>---------------------------------------------------------------------------*/
+shared_ptr<const CFlatRing> C2DPolyBase::GetFlattened(double dTolerance) const
+{
+	shared_ptr<const CFlatRing> pRing = atomic_load(&m_Flattened);
+	if (pRing && pRing->GetTolerance() <= dTolerance)
+		return pRing;
+
+	pRing = make_shared<CFlatRing>(*this, dTolerance);
+	atomic_store(&m_Flattened, pRing);
+	return pRing;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::ContainsFlattened <BR>
+\brief True if the point is in the shape with its arcs flattened to the tolerance.
+<P>---------------------------------------------------------------------------*/
+bool C2DPolyBase::ContainsFlattened(const C2DPoint& pt, double dTolerance) const
+{
+	if (!m_BoundingRect.Contains(pt))
+		return false;
+
+	return GetFlattened(dTolerance)->Contains(pt);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::DistanceFlattened <BR>
+\brief Distance of the point from the shape with its arcs flattened to the tolerance.
+Returns -ve if inside.
+<P>---------------------------------------------------------------------------*/
+double C2DPolyBase::DistanceFlattened(const C2DPoint& pt, double dTolerance) const
+{
+	return GetFlattened(dTolerance)->Distance(pt);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::ClearFlattened <BR>
+\brief Drops the flattened shape after a change.
+<P>---------------------------------------------------------------------------*/
+void C2DPolyBase::ClearFlattened(void)
+{
+	atomic_store(&m_Flattened, shared_ptr<const CFlatRing>());
+}
+
+
 /**--------------------------------------------------------------------------<BR>
 C2DPolyBase::GetPerimeter <BR>
 \brief Returns the perimeter.
@@ -417,7 +475,7 @@ void C2DPolyBase::Move(const C2DVector& vector)
 	}
 
 	m_BoundingRect.Move(vector);
-
+	ClearFlattened();
 }
 
 
@@ -459,7 +517,7 @@ void C2DPolyBase::Grow(double dFactor, const C2DPoint& Origin)
 	}
 
 	m_BoundingRect.Grow(dFactor, Origin);
-
+	ClearFlattened();
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -675,6 +733,9 @@ void C2DPolyBase::Set(const C2DPolyBase& Other)
 	{
 		m_LineRects.Add(new C2DRect(*Other.GetLineRect(i)));
 	}
+
+	// The flattened shape cannot change so is shared with the other.
+	atomic_store(&m_Flattened, atomic_load(&Other.m_Flattened));
 }
 
 
@@ -822,18 +883,19 @@ void C2DPolyBase::Create(const C2DLineBaseSet& Lines)
 /**--------------------------------------------------------------------------<BR>
 C2DPolyBase::RandomPerturb <BR>
 \brief Perturbs the shape by a very small random amount so as to avoid degeneracies
-with another polygon caused by coincident lines or points.
+with another polygon caused by coincident lines or points. The generator given is used,
+or the thread's if none.
 <P>---------------------------------------------------------------------------*/
-void C2DPolyBase::RandomPerturb(void)
+void C2DPolyBase::RandomPerturb(CRandomGenerator* pGenerator)
 {
 	C2DPoint pt = m_BoundingRect.GetPointFurthestFromOrigin();
 	double dMinEq = max(pt.x, pt.y) * conEqualityTolerance;
-	CRandomNumber rn(dMinEq * 10, dMinEq * 100);
+	CRandomGenerator& Generator = pGenerator ? *pGenerator : CRandomGenerator::GetThreadGenerator();
 
-	C2DVector cVector( rn.Get(), rn.Get() );
-	if (CRandomNumber::GetBool())
+	C2DVector cVector( Generator.Get(dMinEq * 10, dMinEq * 100), Generator.Get(dMinEq * 10, dMinEq * 100) );
+	if (Generator.GetBool())
 		cVector.i = - cVector.i ;
-	if (CRandomNumber::GetBool())
+	if (Generator.GetBool())
 		cVector.j = - cVector.j ;
 	Move(cVector);
 }
@@ -887,7 +949,7 @@ void C2DPolyBase::GetBoolean(const C2DPolyBase& Other, C2DHoledPolyBaseSet& Hole
 {
 	if (m_BoundingRect.Overlaps(Other.GetBoundingRect() ))
 	{
-		switch (eDegen)
+		switch (CGrid::Resolve(eDegen))
 		{
 		case CGrid::None:
 			{
@@ -991,11 +1053,76 @@ void C2DPolyBase::GetBoolean(const C2DPolyBase& Other, C2DHoledPolyBaseSet& Hole
 				HoledPolys.SnapToGrid();	
 			}
 			break;
+		case CGrid::UseContext:
+			// Resolved above.
+			break;
 		}
 	}
 }
 
 
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::GetBooleanSweep <BR>
+\brief Gets the boolean result using the sweep line engine. If the arc tolerance is
+above 0 any arcs are flattened to it for the engine and fitted back to the result.
+Otherwise GetBoolean is used if either has arcs.
+<P>---------------------------------------------------------------------------*/
+void C2DPolyBase::GetBooleanSweep(const C2DPolyBase& Other, C2DHoledPolyBaseSet& HoledPolys,
+						CPolygonBoolean::eOperation eOp, double dArcTolerance) const
+{
+	if (dArcTolerance > 0 || (!HasArcs() && !Other.HasArcs()))
+	{
+		CPolygonBoolean Boolean;
+		Boolean.SetArcTolerance(dArcTolerance);
+		Boolean.AddSubject(*this);
+		Boolean.AddClip(Other);
+		Boolean.Execute(eOp, HoledPolys);
+		return;
+	}
+
+	switch (eOp)
+	{
+	case CPolygonBoolean::Intersection:
+		GetBoolean(Other, HoledPolys, true, true);
+		break;
+	case CPolygonBoolean::Union:
+		GetBoolean(Other, HoledPolys, false, false);
+		break;
+	case CPolygonBoolean::Difference:
+		GetBoolean(Other, HoledPolys, false, true);
+		break;
+	case CPolygonBoolean::Xor:
+		GetBoolean(Other, HoledPolys, false, true);
+		Other.GetBoolean(*this, HoledPolys, false, true);
+		break;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::Triangulate<BR>
+\brief Adds 3 point indexes for each triangle to the set, see CPolygonTriangulator.
+False if it failed.
+<P>---------------------------------------------------------------------------*/
+bool C2DPolyBase::Triangulate(CIndexSet& Triangles) const
+{
+	return CPolygonTriangulator::Triangulate(*this, Triangles);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::GetOffset<BR>
+\brief Adds the shape offset by the distance, outwards if positive and inwards if
+negative, to the set, see CPolygonOffset.
+<P>---------------------------------------------------------------------------*/
+void C2DPolyBase::GetOffset(double dDistance, C2DHoledPolyBaseSet& Result,
+						CPolygonOffset::eJoinType eJoin) const
+{
+	CPolygonOffset Offset(eJoin);
+	Offset.Execute(*this, dDistance, Result);
+}
+
+
 
 /**--------------------------------------------------------------------------<BR>
 C2DPolyBase::GetRoutes<BR>
@@ -1143,6 +1270,7 @@ void C2DPolyBase::SnapToGrid(void)
 	m_Lines.SnapToGrid();
 	m_LineRects.SnapToGrid();
 	m_BoundingRect.SnapToGrid();
+	ClearFlattened();
 }
 
 
@@ -1312,19 +1440,12 @@ void C2DPolyBase::MakeClockwise(void)
 
 /**--------------------------------------------------------------------------<BR>
 C2DPolyArc::Transform <BR>
-\brief Transform by the given operator.
+\brief Transform by the given operator. The points of straight lines are transformed
+together in one call, see TransformLines.
 <P>---------------------------------------------------------------------------*/
 void C2DPolyBase::Transform(CTransformation* pProject)
 {
-	for (unsigned int i = 0; i < m_Lines.size(); i++)	
-	{
-		C2DLineBase* pLine = m_Lines.GetAt(i);
-		pLine->Transform(pProject);
-		pLine->GetBoundingRect(m_LineRects[i]);
-	}
-
-	this->MakeBoundingRect();
-
+	TransformLines(pProject, false);
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -1333,12 +1454,79 @@ C2DPolyArc::InverseTransform <BR>
 <P>---------------------------------------------------------------------------*/
 void C2DPolyBase::InverseTransform(CTransformation* pProject)
 {
-	for (unsigned int i = 0; i < m_Lines.size(); i++)	
+	TransformLines(pProject, true);
+}
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolyBase::TransformLines <BR>
+\brief Transform by the given operator or its inverse. If the lines are all straight
+the start points, which are also the end points of the lines before, are put in arrays
+and transformed in one call, and the lines made again from them. Otherwise each line
+transforms itself.
+<P>---------------------------------------------------------------------------*/
+void C2DPolyBase::TransformLines(CTransformation* pProject, bool bInverse)
+{
+	ClearFlattened();
+
+	// The sets are only read through the base class here, without the casts of GetAt.
+	const C2DBaseSet& Lines = m_Lines;
+	const unsigned int nCount = Lines.size();
+	bool bStraight = nCount > 0;
+	for (unsigned int i = 0; i < nCount && bStraight; i++)
+		bStraight = Lines.GetAt(i)->GetType() == C2DBase::StraightLine;
+
+	if (!bStraight)
 	{
-		C2DLineBase* pLine = m_Lines.GetAt(i);
-		pLine->InverseTransform(pProject);
-		pLine->GetBoundingRect(m_LineRects[i]);
+		for (unsigned int i = 0; i < nCount; i++)	
+		{
+			C2DLineBase* pLine = m_Lines.GetAt(i);
+			if (bInverse)
+				pLine->InverseTransform(pProject);
+			else
+				pLine->Transform(pProject);
+			pLine->GetBoundingRect(m_LineRects[i]);
+		}
+		this->MakeBoundingRect();
+		return;
 	}
 
-	this->MakeBoundingRect();
+	std::vector<double> X(nCount);
+	std::vector<double> Y(nCount);
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		const C2DLine* pLine = static_cast<const C2DLine*>(Lines.GetAt(i));
+		X[i] = pLine->point.x;
+		Y[i] = pLine->point.y;
+	}
+
+	if (bInverse)
+		pProject->InverseTransformPoints(&X[0], &Y[0], nCount);
+	else
+		pProject->TransformPoints(&X[0], &Y[0], nCount);
+
+	C2DBaseSet& LineRects = m_LineRects;
+	double dMinX = X[0], dMaxX = X[0], dMinY = Y[0], dMaxY = Y[0];
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		const unsigned int nNext = i + 1 < nCount ? i + 1 : 0;
+		C2DLine* pLine = static_cast<C2DLine*>(m_Lines.C2DBaseSet::GetAt(i));
+		pLine->point.x = X[i];
+		pLine->point.y = Y[i];
+		pLine->vector.i = X[nNext] - X[i];
+		pLine->vector.j = Y[nNext] - Y[i];
+
+		// The rect of the line as GetBoundingRect would make it, from the point to.
+		const double dToX = X[i] + pLine->vector.i;
+		const double dToY = Y[i] + pLine->vector.j;
+		const double dLeft = std::min(X[i], dToX);
+		const double dRight = std::max(X[i], dToX);
+		const double dBottom = std::min(Y[i], dToY);
+		const double dTop = std::max(Y[i], dToY);
+		static_cast<C2DRect*>(LineRects.GetAt(i))->Set(dLeft, dTop, dRight, dBottom);
+		dMinX = std::min(dMinX, dLeft);
+		dMaxX = std::max(dMaxX, dRight);
+		dMinY = std::min(dMinY, dBottom);
+		dMaxY = std::max(dMaxY, dTop);
+	}
+	m_BoundingRect.Set(dMinX, dMaxY, dMaxX, dMinY);
 }
@@ -25,6 +25,10 @@ C2DLineBase. Lines can be of mixed type.
 #include "Grid.h"
 #include "C2DRectSet.h"
 #include "MemoryPool.h"
+#include "PolygonBoolean.h"
+#include "PolygonOffset.h"
+#include "ArcFlattener.h"
+#include <memory>
 
 
 
@@ -32,6 +36,7 @@ class C2DHoledPolyBase;
 class C2DHoledPolyBaseSet;
 class C2DPolyBaseSet;
 class C2DLineBaseSetSet;
+class CRandomGenerator;
 
 #ifdef _POLY_EXPORTING
 	#define POLY_DECLSPEC		__declspec(dllexport)
@@ -90,6 +95,15 @@ public:
 
 	/// True if the point is with the range given to the shape or inside.
 	bool IsWithinDistance(const C2DPoint& pt, double dRange) const;
+
+	/// The shape with the arcs replaced by chords within the tolerance, kept until the
+	/// shape changes.
+	std::shared_ptr<const CFlatRing> GetFlattened(double dTolerance) const;
+	/// True if the point is in the shape with its arcs flattened to the tolerance.
+	bool ContainsFlattened(const C2DPoint& pt, double dTolerance) const;
+	/// Distance of the point from the shape with its arcs flattened to the tolerance.
+	/// Returns -ve if inside.
+	double DistanceFlattened(const C2DPoint& pt, double dTolerance) const;
 	/// Returns the bounding rectangle.
 	void GetBoundingRect(C2DRect& Rect) const {Rect = m_BoundingRect; }
 	/// Returns the bournding rectangle.
@@ -165,15 +179,15 @@ public:
 
 	/// Returns the non-overlaps of this with another.
 	void GetNonOverlaps(const C2DPolyBase& Other, C2DHoledPolyBaseSet& Polygons, 
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// Returns the union of this with another.
 	void GetUnion(const C2DPolyBase& Other, C2DHoledPolyBaseSet& Polygons,
-									CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+									CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// Returns the overlaps of this with another.
 	void GetOverlaps(const C2DPolyBase& Other, C2DHoledPolyBaseSet& Polygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 	/// Returns the routes (collection of lines and sublines) either inside or outside another
 	/// Given the intersection points.
 	void GetRoutes(C2DPointSet& IntPts, CIndexSet& IntIndexes, 
@@ -182,14 +196,27 @@ public:
 	/// Gets the boolean operation with the other. e.g. union / intersection.
 	void GetBoolean(const C2DPolyBase& Other, C2DHoledPolyBaseSet& Polygons,
 						bool bThisInside, bool bOtherInside, 
-						CGrid::eDegenerateHandling eDegen  = CGrid::None) const;
+						CGrid::eDegenerateHandling eDegen  = CGrid::UseContext) const;
+
+	/// Gets the boolean operation with the other using the sweep line engine. Arcs are
+	/// flattened to the tolerance and fitted back if it is above 0, otherwise falls back
+	/// to GetBoolean if either has arcs.
+	void GetBooleanSweep(const C2DPolyBase& Other, C2DHoledPolyBaseSet& Polygons,
+						CPolygonBoolean::eOperation eOp, double dArcTolerance = 0) const;
+
+	/// Adds 3 point indexes for each triangle to the set. Arcs are treated as their chords.
+	bool Triangulate(CIndexSet& Triangles) const;
+
+	/// Adds the shape offset by the distance, outwards if positive, to the set.
+	void GetOffset(double dDistance, C2DHoledPolyBaseSet& Result,
+						CPolygonOffset::eJoinType eJoin = CPolygonOffset::Round) const;
 
 	/// Projection onto the line
 	void Project(const C2DLine& Line, CInterval& Interval) const;
 	/// Projection onto the vector
 	void Project(const C2DVector& Vector, CInterval& Interval) const;
-	/// Moves this by a tiny random amount.
-	void RandomPerturb(void);
+	/// Moves this by a tiny random amount from the generator, 0 for the thread's.
+	void RandomPerturb(CRandomGenerator* pGenerator = 0);
 
 	virtual void Transform(CTransformation* pProject);
 
@@ -212,12 +239,18 @@ protected:
 	void MakeBoundingRect(void);
 	/// Forms the bounding rectangle.
 	void MakeLineRects(void);
+	/// Transforms by the operator or its inverse.
+	void TransformLines(CTransformation* pProject, bool bInverse);
+	/// Drops the flattened shape after a change.
+	void ClearFlattened(void);
 	/// The lines
 	C2DLineBaseSet m_Lines;
 	/// The bounding rectangle.
 	C2DRect m_BoundingRect;
 	/// The LINE bounding rectangles.
 	C2DRectSet m_LineRects;
+	/// The flattened shape, if made since the last change.
+	mutable std::shared_ptr<const CFlatRing> m_Flattened;
 };
 
 
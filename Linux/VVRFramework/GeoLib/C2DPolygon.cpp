@@ -27,6 +27,9 @@ convex or concave but doesn't contain holes.
 #include "C2DRoute.h"
 #include "Interval.h"
 #include "C2DLine.h"
+#include "PolygonTriangulator.h"
+#include "Minkowski.h"
+#include <unordered_set>
 
 using namespace std;
 
@@ -138,9 +141,10 @@ bool C2DPolygon::Create(const C2DRoute& Route)
 
 /**--------------------------------------------------------------------------<BR>
 C2DPolygon::CreateRandom <BR>
-\brief Creates a random polygon.
+\brief Creates a random polygon from the generator given, or the thread's if none.
 <P>---------------------------------------------------------------------------*/
-bool C2DPolygon::CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints)
+bool C2DPolygon::CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints,
+							  CRandomGenerator* pGenerator)
 {
 	Clear();
 
@@ -151,12 +155,12 @@ bool C2DPolygon::CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMax
 	if (nMinPoints > nMaxPoints)
 		return false;
 
-	int nNumber = static_cast<int>(nMinPoints + (float) rand() / (float)RAND_MAX 
-		* (float)(nMaxPoints - nMinPoints) + 0.5);
+	CRandomGenerator& Generator = pGenerator ? *pGenerator : CRandomGenerator::GetThreadGenerator();
+	int nNumber = nMinPoints + Generator.GetInt(nMaxPoints - nMinPoints + 1);
 
 	C2DPoint pt;
-	CRandomNumber rnX(cBoundary.GetTopLeft().x, cBoundary.GetBottomRight().x);
-	CRandomNumber rnY(cBoundary.GetBottomRight().y, cBoundary.GetTopLeft().y);
+	CRandomNumber rnX(cBoundary.GetTopLeft().x, cBoundary.GetBottomRight().x, &Generator);
+	CRandomNumber rnY(cBoundary.GetBottomRight().y, cBoundary.GetTopLeft().y, &Generator);
 
 	C2DPointSet Points;
 
@@ -428,7 +432,7 @@ bool C2DPolygon::CreateRegular(const C2DPoint& Centre, double dDistanceToPoints,
 
 /**--------------------------------------------------------------------------<BR>
 C2DPolygon::CreateConvexHull <BR>
-\brief Creates a convex hull from the other polygon. Uses Graham's algorithm.
+\brief Creates a convex hull from the other polygon. Uses Andrew's monotone chain.
 <P>---------------------------------------------------------------------------*/
 bool C2DPolygon::CreateConvexHull(const C2DPolygon& Other)
 {
@@ -681,8 +685,9 @@ void C2DPolygon::GetConvexSubAreas(C2DPolygonSet& SubAreas) const
 
 /**--------------------------------------------------------------------------<BR>
 C2DPolygon::CreateConvexSubAreas <BR>
-\brief Creates convex sub areas by joining inflection if possible or joining
-inflected points with other points that will remove the inflection.
+\brief Creates convex sub areas by triangulating and merging the triangles into
+convex pieces (see CPolygonTriangulator). The pieces are then arranged as a tree
+by splitting along the diagonals between them, balancing the point counts.
 <P>---------------------------------------------------------------------------*/
 bool C2DPolygon::CreateConvexSubAreas(void)
 {
@@ -699,82 +704,123 @@ bool C2DPolygon::CreateConvexSubAreas(void)
 
 	unsigned int nLineCount = m_Lines.size();
 
-	if ( nLineCount < 4 )
+	if ( nLineCount < 4 || IsConvex())
 		return true;
 
-	bool bInflection = false;
-	for (unsigned int nStart = 0 ; nStart < nLineCount; nStart++)
+	std::vector< std::vector<unsigned int> > Pieces;
+	if (!CPolygonTriangulator::GetConvexPartition(*this, Pieces))
+		return false;
+
+	// The diagonals are the piece edges which are in 2 pieces.
+	unordered_set<unsigned long long> Edges;
+	for (unsigned int p = 0; p < Pieces.size(); p++)
 	{
-		if (IsPointInflected(nStart))
+		unsigned int nSize = Pieces[p].size();
+		for (unsigned int i = 0; i < nSize; i++)
 		{
-			bInflection = true;
+			unsigned long long a = Pieces[p][i];
+			unsigned long long b = Pieces[p][(i + 1) % nSize];
+			Edges.insert((a << 32) | b);
+		}
+	}
 
-			unsigned int nEnd = nStart + 2;
-			bool bContinue = true;
-			while (bContinue)
-			{
-				if (C2DTriangle::IsClockwise(*GetPoint(nEnd - 2),*GetPoint(nEnd - 1),*GetPoint(nEnd))
-					&& C2DTriangle::IsClockwise( *GetPoint(nEnd - 1), *GetPoint(nEnd), *GetPoint(nStart))
-					&& C2DTriangle::IsClockwise( *GetPoint(nEnd), *GetPoint(nStart), *GetPoint(nStart + 1)) 
-					&& CanPointsBeJoined(nStart, nEnd))
-				{
-					nEnd++;
-				}
-				else
-				{
-					nEnd--;
-					bContinue = false;
-				}
-			}
-			if (nEnd >= nStart + 2)
+	std::vector<unsigned int> Diagonals;
+	for (unsigned int p = 0; p < Pieces.size(); p++)
+	{
+		unsigned int nSize = Pieces[p].size();
+		for (unsigned int i = 0; i < nSize; i++)
+		{
+			unsigned long long a = Pieces[p][i];
+			unsigned long long b = Pieces[p][(i + 1) % nSize];
+			if (a < b && Edges.count((b << 32) | a) != 0 && 
+				b != a + 1 && !(a == 0 && b == nLineCount - 1))
 			{
-				bool bRes = CreateSubAreas(nStart, nEnd, m_SubArea[0], m_SubArea[1]);
-				bRes &= m_SubArea[0]->CreateConvexSubAreas();
-				bRes &= m_SubArea[1]->CreateConvexSubAreas();
-				return bRes;
+				Diagonals.push_back((unsigned int)a);
+				Diagonals.push_back((unsigned int)b);
 			}
 		}
 	}
 
-	if (!bInflection)
+	return SplitByDiagonals(Diagonals);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolygon::SplitByDiagonals <BR>
+\brief Creates 2 sub areas by splitting along the diagonal which best balances the 
+point counts then splits those along the other diagonals. The diagonals are pairs of
+point indexes, the lowest first.
+<P>---------------------------------------------------------------------------*/
+bool C2DPolygon::SplitByDiagonals(const std::vector<unsigned int>& Diagonals)
+{
+	unsigned int nCount = m_Lines.size();
+	unsigned int nDiagonals = Diagonals.size() / 2;
+
+	if (nDiagonals == 0)
 		return true;
 
-	for (unsigned int nStart = 2 * nLineCount - 1 ; nStart >= nLineCount; nStart--)
+	unsigned int nSplit = 0;
+	unsigned int nBestDiff = nCount;
+	for (unsigned int d = 0; d < nDiagonals; d++)
 	{
-		if (IsPointInflected(nStart))
+		unsigned int nSize1 = Diagonals[2 * d + 1] - Diagonals[2 * d];
+		unsigned int nSize2 = nCount - nSize1;
+		unsigned int nDiff = nSize1 > nSize2 ? nSize1 - nSize2 : nSize2 - nSize1;
+		if (nDiff < nBestDiff)
 		{
-			bInflection = true;
+			nBestDiff = nDiff;
+			nSplit = d;
+		}
+	}
 
-			unsigned int nEnd = nStart - 2;
-			bool bContinue = true;
-			while (bContinue)
-			{
-				if (!C2DTriangle::IsClockwise(*GetPoint(nEnd + 2),*GetPoint(nEnd + 1),*GetPoint(nEnd)) 
-					&& !C2DTriangle::IsClockwise( *GetPoint(nEnd + 1), *GetPoint(nEnd), *GetPoint(nStart)) 
-					&& !C2DTriangle::IsClockwise( *GetPoint(nEnd), *GetPoint(nStart), *GetPoint(nStart - 1)) 
-					&& CanPointsBeJoined(nStart, nEnd))
-				{
-					nEnd--;
-				}
-				else
-				{
-					nEnd++;
-					bContinue = false;
-				}
-			}
-			if (nEnd <= nStart - 2)
-			{
-				bool bRes = CreateSubAreas(nStart, nEnd, m_SubArea[0], m_SubArea[1]);
-				bRes &= m_SubArea[0]->CreateConvexSubAreas();
-				bRes &= m_SubArea[1]->CreateConvexSubAreas();
-				return bRes;
-			}
+	unsigned int nPt1 = Diagonals[2 * nSplit];
+	unsigned int nPt2 = Diagonals[2 * nSplit + 1];
+
+	// The points from nPt1 to nPt2 and from nPt2 round to nPt1. The order is kept.
+	std::vector<double> Points1, Points2;
+	for (unsigned int i = nPt1; i <= nPt2; i++)
+	{
+		Points1.push_back(GetPoint(i)->x);
+		Points1.push_back(GetPoint(i)->y);
+	}
+	for (unsigned int i = nPt2; i <= nPt1 + nCount; i++)
+	{
+		Points2.push_back(GetPoint(i)->x);
+		Points2.push_back(GetPoint(i)->y);
+	}
+
+	// The diagonals don't cross so each is on one side.
+	std::vector<unsigned int> Diagonals1, Diagonals2;
+	for (unsigned int d = 0; d < nDiagonals; d++)
+	{
+		if (d == nSplit)
+			continue;
+
+		unsigned int a = Diagonals[2 * d];
+		unsigned int b = Diagonals[2 * d + 1];
+		if (a >= nPt1 && b <= nPt2)
+		{
+			Diagonals1.push_back(a - nPt1);
+			Diagonals1.push_back(b - nPt1);
+		}
+		else
+		{
+			a = (a + nCount - nPt2) % nCount;
+			b = (b + nCount - nPt2) % nCount;
+			Diagonals2.push_back(min(a, b));
+			Diagonals2.push_back(max(a, b));
 		}
 	}
 
+	m_SubArea[0] = new C2DPolygon;
+	m_SubArea[1] = new C2DPolygon;
 
-	assert(0);
-	return false;
+	bool bRes = m_SubArea[0]->Create(&Points1[0], Points1.size() / 2);
+	bRes &= m_SubArea[1]->Create(&Points2[0], Points2.size() / 2);
+	bRes &= m_SubArea[0]->SplitByDiagonals(Diagonals1);
+	bRes &= m_SubArea[1]->SplitByDiagonals(Diagonals2);
+
+	return bRes;
 }
 
 
@@ -888,44 +934,6 @@ double C2DPolygon::GetAreaSigned()  const
 	return dArea;
 }
 
-/**--------------------------------------------------------------------------<BR>
-C2DPolygon::CreateSubAreas <BR>
-\brief Create 2 sub areas by splitting the points according to the indexes given.
-<P>---------------------------------------------------------------------------*/
-bool C2DPolygon::CreateSubAreas(unsigned int nPt1, unsigned int nPt2, C2DPolygon*& pNewArea1, C2DPolygon*& pNewArea2)
-{
-	for (int i = 0; i < MAX_SUB_AREAS ; i ++)
-	{
-		if (m_SubArea[i] != 0) delete m_SubArea[i];
-		m_SubArea[i] = 0;
-	}
-
-	pNewArea1 = new C2DPolygon;
-	pNewArea2 = new C2DPolygon;
-
-	while (nPt2 < nPt1) nPt2 += m_Lines.size();
-
-	C2DPointSet Points1;
-	for (unsigned int i = nPt1; i <= nPt2; i++)
-	{
-		Points1.AddCopy(*GetPoint(i));
-	}
-	bool bRes1 = pNewArea1->Create(Points1);
-
-	while (nPt1 < nPt2) nPt1 += m_Lines.size();
-
-	C2DPointSet Points2;
-	for (unsigned int j = nPt2; j <= nPt1; j++)
-	{
-		Points2.AddCopy(*GetPoint(j));
-	}
-	bool bRes2 = pNewArea2->Create(Points2);
-
-	return bRes1 && bRes2;
-}
-
-
-
 /**--------------------------------------------------------------------------<BR>
 C2DPolygon::CrossesRay <BR>
 \brief True if the ray crosses the polygon, records the points in order.
@@ -1082,6 +1090,8 @@ C2DPolygon::InsertPoint <BR>
 <P>---------------------------------------------------------------------------*/
 void C2DPolygon::InsertPoint( unsigned int nPointIndex, const C2DPoint& Point)
 {
+	ClearFlattened();
+
 	if (nPointIndex >=  m_Lines.size() )
 		nPointIndex -= m_Lines.size();
 
@@ -1117,6 +1127,8 @@ C2DPolygon::RemovePoint <BR>
 <P>---------------------------------------------------------------------------*/
 void C2DPolygon::RemovePoint(unsigned int nPointIndex)
 {
+	ClearFlattened();
+
 	if (nPointIndex >=  m_Lines.size() )
 		nPointIndex -= m_Lines.size();
 
@@ -1145,6 +1157,8 @@ C2DPolygon::SetPoint <BR>
 <P>---------------------------------------------------------------------------*/
 void C2DPolygon::SetPoint(const C2DPoint& Point, unsigned int nPointIndex)
 {
+	ClearFlattened();
+
 	if (nPointIndex >=  m_Lines.size() )
 		nPointIndex -= m_Lines.size();
 
@@ -1477,6 +1491,46 @@ void C2DPolygon::Avoid(const C2DPolygon& Other)
 }
 
 
+/**--------------------------------------------------------------------------<BR>
+C2DPolygon::OverlapsExact <BR>
+\brief True if this overlaps the other and if so the shortest move of this which leaves
+them touching. This overlaps if the origin is inside the no fit polygon of this about
+the other and the move is to the nearest point of its boundary. See CMinkowski.
+<P>---------------------------------------------------------------------------*/
+bool C2DPolygon::OverlapsExact(const C2DPolygon& Other, C2DVector& MinimumTranslationVector) const
+{
+	if (!m_BoundingRect.Overlaps(Other.GetBoundingRect()))
+		return false;
+
+	C2DHoledPolyBaseSet NoFit;
+	CMinkowski::GetNoFitPolygon(Other, *this, NoFit);
+	return CMinkowski::GetExit(NoFit, C2DPoint(0, 0), conEqualityTolerance, MinimumTranslationVector);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolygon::GetMinkowskiSum <BR>
+\brief Adds the Minkowski sum of this and the other to the set. See CMinkowski.
+<P>---------------------------------------------------------------------------*/
+void C2DPolygon::GetMinkowskiSum(const C2DPolygon& Other, C2DHoledPolyBaseSet& Result) const
+{
+	CMinkowski::GetSum(*this, Other, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+C2DPolygon::Simplify <BR>
+\brief Removes points within the tolerance, a distance for Douglas-Peucker and an
+area for Visvalingam, without the polygon crossing itself. At least 3 points are
+kept. Returns the number of points removed. See CSimplifier.
+<P>---------------------------------------------------------------------------*/
+unsigned int C2DPolygon::Simplify(double dTolerance, CSimplifier::eMethod eMethod)
+{
+	CSimplifier Simplifier(eMethod, dTolerance);
+	return Simplifier.Simplify(*this);
+}
+
+
 /**--------------------------------------------------------------------------<BR>
 C2DPolygon::Smooth <BR>
 \brief The polygon is smoothed so that no angle is less than the minimum angle provided 
@@ -2043,7 +2097,8 @@ void C2DPolygon::GetMinBoundingBox( C2DLine& Line, double& dWidthToRight) const
 /**--------------------------------------------------------------------------<BR>
 C2DPolygon::SimpleBuffer <BR>
 \brief Simple buffer around the polygon at a fixed amount. No attemp to ensure validity
-as intended for small buffer amounts.
+as intended for small buffer amounts. GetOffset gives a valid result with mitre, 
+round or square corners for any amount.
 <P>---------------------------------------------------------------------------*/
 void C2DPolygon::SimpleBuffer(double dBuffer)
 {
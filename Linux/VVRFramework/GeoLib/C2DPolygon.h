@@ -33,12 +33,14 @@ and non-intersection of two polygons.
 #include "C2DPolyBase.h"
 #include "Constants.h"
 #include "MemoryPool.h"
+#include "Simplifier.h"
 
 
 class C2DPolygonSet;
 class C2DHoledPolygonSet;
 class C2DRoute;
 class C2DCircle;
+class CRandomGenerator;
 
 
 #define MAX_SUB_AREAS 2
@@ -90,8 +92,9 @@ public:
 	bool CreateRegular(const C2DPoint& Centre, double dDistanceToPoints, int nNumberSides);
 	/// Creates a convex hull from another polygon. Uses Graham's algorithm.
 	bool CreateConvexHull(const C2DPolygon& Other);
-	/// Creates a randon polygon.
-	bool CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints);
+	/// Creates a randon polygon from the generator, 0 for the thread's.
+	bool CreateRandom(const C2DRect& cBoundary, int nMinPoints, int nMaxPoints,
+						CRandomGenerator* pGenerator = 0);
 
 	/// Mophs this polygon into another by the factor given.
 	bool CreateMorph(const C2DPolygon& OtherFrom, const C2DPolygon& OtherTo, double dFactor);
@@ -162,6 +165,11 @@ public:
 	bool Overlaps( const C2DPolygon& Other)  const  ;
 	/// Calls the Overlaps function and moves this away from the other.
 	void Avoid(const C2DPolygon& Other);
+	/// True if this overlaps the other and if so the shortest move of this which leaves
+	/// them touching. Exact for concave polygons too, from the no fit polygon.
+	bool OverlapsExact(const C2DPolygon& Other, C2DVector& MinimumTranslationVector) const;
+	/// Adds the Minkowski sum of this and the other to the set.
+	void GetMinkowskiSum(const C2DPolygon& Other, C2DHoledPolyBaseSet& Result) const;
 	/// Returns the number of points.
 	unsigned int GetPointsCount(void) const { return m_Lines.size();}
 	/// Returns the centroid.
@@ -180,30 +188,32 @@ public:
 	int GetLeftMostPoint(void) const;
 	/// Smooths the polygon. 
 	void Smooth(double dMinAngle = conPI * 0.8, double dCropFactor = 0.8);
+	/// Removes points within the tolerance. Returns the number removed.
+	unsigned int Simplify(double dTolerance, CSimplifier::eMethod eMethod = CSimplifier::DouglasPeucker);
 	/// Get the minimum bounding circle
 	void GetBoundingCircle(C2DCircle& Circle) const;
 
 	/// Returns the difference between this and the other.
 	void GetNonOverlaps(const C2DPolygon& Other, C2DHoledPolygonSet& HoledPolygons, 
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 	/// Returns the difference between this and the other. Access to base class.
 	void GetNonOverlaps(const C2DPolygon& Other, C2DHoledPolyBaseSet& HoledPolygons, 
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// Returns the union of tihis and the other.
 	void GetUnion(const C2DPolygon& Other, C2DHoledPolygonSet& HoledPolygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 	/// Returns the union of tihis and the other. Access to base class.
 	void GetUnion(const C2DPolygon& Other, C2DHoledPolyBaseSet& HoledPolygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// Returns the overlap between this and the other.
 	void GetOverlaps(const C2DPolygon& Other, C2DHoledPolygonSet& Polygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// Returns the overlap between this and the other. Access to base class.
 	void GetOverlaps(const C2DPolygon& Other, C2DHoledPolyBaseSet& Polygons,
-										CGrid::eDegenerateHandling eDegen = CGrid::None) const ;
+										CGrid::eDegenerateHandling eDegen = CGrid::UseContext) const ;
 
 	/// True if this polygon is above the other. 
 	bool OverlapsAbove( const C2DPolygon& Other, double& dVerticalDistance,
@@ -215,7 +225,7 @@ public:
 	/// Returns the minimum bounding box that is not necassarily horiztonal.
 	void GetMinBoundingBox( C2DLine& Line, double& dWidthToRight) const;
 	
-	// Simple buffer around the polygon at a fixed amount.
+	// Simple buffer around the polygon at a fixed amount. See GetOffset for a valid buffer.
 	void SimpleBuffer(double dBuffer);
 	/// Function to remove small areas of the polygon. E.g. when 3 point are or almost
 	/// are collinear.
@@ -235,8 +245,8 @@ private:
 	bool CanPointsBeJoined(unsigned int nStart, unsigned int nEnd);
 	/// True if joining the 2 point removes any inflection.
 	bool RemovesInflection(unsigned int nStart, unsigned int nEnd);
-	/// Creates to sub areas given 2 point indexes and pointers to the new areas.
-	bool CreateSubAreas(unsigned int nPt1, unsigned int nPt2, C2DPolygon*& pNewArea1, C2DPolygon*& pNewArea2);
+	/// Creates the sub areas by splitting along the diagonals given as pairs of point indexes.
+	bool SplitByDiagonals(const std::vector<unsigned int>& Diagonals);
 	/// Reorders the points.
 	bool Reorder(void);
 	/// Reorders to eliminate crossing lines.
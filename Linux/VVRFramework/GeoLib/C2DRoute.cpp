@@ -94,6 +94,19 @@ void C2DRoute::Clear(void)
 }
 
 
+/**--------------------------------------------------------------------------<BR>
+C2DRoute::Simplify
+\brief Removes points within the tolerance, a distance for Douglas-Peucker and an
+area for Visvalingam, keeping the ends and without the route crossing itself where
+it did not before. Returns the number of points removed. See CSimplifier.
+<P>---------------------------------------------------------------------------*/
+unsigned int C2DRoute::Simplify(double dTolerance, CSimplifier::eMethod eMethod)
+{
+	CSimplifier Simplifier(eMethod, dTolerance);
+	return Simplifier.Simplify(*this);
+}
+
+
 /**--------------------------------------------------------------------------<BR>
 C2DRoute::GetPoint
 \brief Returns a reference to the point at the given index.
@@ -24,6 +24,7 @@ Class representing a set of connected points i.e. a route.
 #include "C2DPointSet.h"
 #include "C2DBase.h"
 #include "MemoryPool.h"
+#include "Simplifier.h"
 
 class GeoLib_API C2DRoute : public C2DBase
 {
@@ -60,6 +61,8 @@ public:
 	void RemoveLast(void);
 	/// Clears the route.
 	void Clear(void);
+	/// Removes points within the tolerance, keeping the ends. Returns the number removed.
+	unsigned int Simplify(double dTolerance, CSimplifier::eMethod eMethod = CSimplifier::DouglasPeucker);
 	/// Returns a reference to the point required.
 	const C2DPoint& GetPoint(int nPointIndex) const;
 	/// Assignment to another.
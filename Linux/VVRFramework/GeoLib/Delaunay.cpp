@@ -0,0 +1,882 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Delaunay.cpp
+\brief Implementation file for the CDelaunay class.
+
+Implementation file for CDelaunay. The construction is the sweep hull method of
+D. Sinclair, "S-hull: a fast radial sweep-hull routine for Delaunay triangulation"
+as in the Delaunator library (V. Agafonkin, Mapbox) with exact predicates.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "Delaunay.h"
+#include "Predicates.h"
+#include "Sort.h"
+#include "C2DPointSet.h"
+#include "C2DRect.h"
+#include "C2DPolygon.h"
+#include "C2DPolygonSet.h"
+#include "C2DLine.h"
+#include "C2DLineSet.h"
+#include <limits>
+
+using namespace std;
+
+
+/**--------------------------------------------------------------------------<BR>
+CircumCentreOffset <BR>
+\brief The offset of the circumcentre of a, b and c from a. Not finite if they are
+collinear.
+<P>---------------------------------------------------------------------------*/
+static inline void CircumCentreOffset(double ax, double ay, double bx, double by,
+									  double cx, double cy, double& x, double& y)
+{
+	double dx = bx - ax;
+	double dy = by - ay;
+	double ex = cx - ax;
+	double ey = cy - ay;
+
+	double bl = dx * dx + dy * dy;
+	double cl = ex * ex + ey * ey;
+	double d = 0.5 / (dx * ey - dy * ex);
+
+	x = (ey * bl - dy * cl) * d;
+	y = (dx * cl - ex * bl) * d;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::CDelaunay
+\brief Constructor.
+<P>---------------------------------------------------------------------------*/
+CDelaunay::CDelaunay(void) : m_nHullStart(0), m_dCentreX(0), m_dCentreY(0)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::~CDelaunay
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CDelaunay::~CDelaunay(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::Create
+\brief Triangulates the points given as x and y for each. False if there are no
+triangles i.e. less than 3 distinct points or all collinear.
+<P>---------------------------------------------------------------------------*/
+bool CDelaunay::Create(const vector<double>& Coords)
+{
+	m_Coords = Coords;
+	return Build();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::Create
+\brief Triangulates the points. False if there are no triangles.
+<P>---------------------------------------------------------------------------*/
+bool CDelaunay::Create(const C2DPointSet& Points)
+{
+	m_Coords.resize(2 * Points.size());
+	for (unsigned int i = 0; i < Points.size(); i++)
+	{
+		m_Coords[2 * i] = Points[i].x;
+		m_Coords[2 * i + 1] = Points[i].y;
+	}
+	return Build();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::Build
+\brief Builds the triangulation from the coordinates.
+<P>---------------------------------------------------------------------------*/
+bool CDelaunay::Build(void)
+{
+	const vector<double>& c = m_Coords;
+	unsigned int nCount = c.size() / 2;
+
+	m_Triangles.clear();
+	m_HalfEdges.clear();
+	m_Hull.clear();
+	m_InEdges.clear();
+
+	if (nCount == 0)
+		return false;
+
+	double dMinX = c[0];
+	double dMinY = c[1];
+	double dMaxX = c[0];
+	double dMaxY = c[1];
+	for (unsigned int i = 1; i < nCount; i++)
+	{
+		dMinX = min(dMinX, c[2 * i]);
+		dMinY = min(dMinY, c[2 * i + 1]);
+		dMaxX = max(dMaxX, c[2 * i]);
+		dMaxY = max(dMaxY, c[2 * i + 1]);
+	}
+	double dMidX = (dMinX + dMaxX) / 2;
+	double dMidY = (dMinY + dMaxY) / 2;
+
+	// The seed is the point closest to the centre, then the closest to that and then
+	// the one making the smallest circumcircle with those.
+	unsigned int i0 = 0, i1 = 0, i2 = 0;
+	double dMin = numeric_limits<double>::infinity();
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		double dx = c[2 * i] - dMidX;
+		double dy = c[2 * i + 1] - dMidY;
+		double d = dx * dx + dy * dy;
+		if (d < dMin)
+		{
+			i0 = i;
+			dMin = d;
+		}
+	}
+
+	dMin = numeric_limits<double>::infinity();
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		if (i == i0)
+			continue;
+		double dx = c[2 * i] - c[2 * i0];
+		double dy = c[2 * i + 1] - c[2 * i0 + 1];
+		double d = dx * dx + dy * dy;
+		if (d < dMin && d > 0)
+		{
+			i1 = i;
+			dMin = d;
+		}
+	}
+
+	// Only points off the line of the first 2 are tested, exactly, as the circumcentre
+	// of 3 points may be finite when they are collinear and not when they are not.
+	bool bCollinear = true;
+	double dMinRadius = numeric_limits<double>::infinity();
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		if (i == i0 || i == i1)
+			continue;
+		if (GeoPredicates::Orient2D(c[2 * i0], c[2 * i0 + 1], c[2 * i1], c[2 * i1 + 1],
+			c[2 * i], c[2 * i + 1]) == 0)
+			continue;
+		double x, y;
+		CircumCentreOffset(c[2 * i0], c[2 * i0 + 1], c[2 * i1], c[2 * i1 + 1],
+			c[2 * i], c[2 * i + 1], x, y);
+		double r = x * x + y * y;
+		if (bCollinear || r < dMinRadius)
+		{
+			i2 = i;
+			dMinRadius = r;
+			bCollinear = false;
+		}
+	}
+
+	vector<double> Dists(nCount);
+	vector<unsigned int> Ids;
+
+	if (bCollinear)
+	{
+		// All collinear so the hull is the points in order along the line.
+		for (unsigned int i = 0; i < nCount; i++)
+		{
+			Dists[i] = c[2 * i] - c[0];
+			if (Dists[i] == 0)
+				Dists[i] = c[2 * i + 1] - c[1];
+		}
+		GeoSort::GetSortOrder(Dists, 0, nCount - 1, Ids);
+
+		double d0 = -numeric_limits<double>::infinity();
+		for (unsigned int i = 0; i < nCount; i++)
+		{
+			if (Dists[Ids[i]] > d0)
+			{
+				m_Hull.push_back(Ids[i]);
+				d0 = Dists[Ids[i]];
+			}
+		}
+		return false;
+	}
+
+	if (GeoPredicates::Orient2D(c[2 * i0], c[2 * i0 + 1], c[2 * i1], c[2 * i1 + 1],
+		c[2 * i2], c[2 * i2 + 1]) < 0)
+		swap(i1, i2);
+
+	double x, y;
+	CircumCentreOffset(c[2 * i0], c[2 * i0 + 1], c[2 * i1], c[2 * i1 + 1],
+		c[2 * i2], c[2 * i2 + 1], x, y);
+	m_dCentreX = c[2 * i0] + x;
+	m_dCentreY = c[2 * i0 + 1] + y;
+
+	// Sort the points by distance from the seed circumcentre.
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		double dx = c[2 * i] - m_dCentreX;
+		double dy = c[2 * i + 1] - m_dCentreY;
+		Dists[i] = dx * dx + dy * dy;
+	}
+	GeoSort::GetSortOrder(Dists, 0, nCount - 1, Ids);
+
+	// The seed triangle is the starting hull.
+	unsigned int nHashSize = (unsigned int)ceil(sqrt((double)nCount));
+	m_HullPrev.assign(nCount, 0);
+	m_HullNext.assign(nCount, 0);
+	m_HullTri.assign(nCount, 0);
+	m_HullHash.assign(nHashSize, conNoHalfEdge);
+
+	vector<unsigned int>& HullPrev = m_HullPrev;
+	vector<unsigned int>& HullNext = m_HullNext;
+	vector<unsigned int>& HullTri = m_HullTri;
+	vector<unsigned int>& HullHash = m_HullHash;
+
+	m_nHullStart = i0;
+	unsigned int nHullSize = 3;
+
+	HullNext[i0] = HullPrev[i2] = i1;
+	HullNext[i1] = HullPrev[i0] = i2;
+	HullNext[i2] = HullPrev[i1] = i0;
+
+	HullTri[i0] = 0;
+	HullTri[i1] = 1;
+	HullTri[i2] = 2;
+
+	HullHash[HashKey(c[2 * i0], c[2 * i0 + 1])] = i0;
+	HullHash[HashKey(c[2 * i1], c[2 * i1 + 1])] = i1;
+	HullHash[HashKey(c[2 * i2], c[2 * i2 + 1])] = i2;
+
+	unsigned int nMaxTriangles = nCount > 2 ? 2 * nCount - 5 : 1;
+	m_Triangles.reserve(3 * nMaxTriangles);
+	m_HalfEdges.reserve(3 * nMaxTriangles);
+
+	AddTriangle(i0, i1, i2, conNoHalfEdge, conNoHalfEdge, conNoHalfEdge);
+
+	double xp = 0, yp = 0;
+	for (unsigned int k = 0; k < nCount; k++)
+	{
+		unsigned int i = Ids[k];
+		double x = c[2 * i];
+		double y = c[2 * i + 1];
+
+		// Skip duplicates of the last point, other duplicates are found below.
+		if (k > 0 && x == xp && y == yp)
+			continue;
+		xp = x;
+		yp = y;
+
+		if (i == i0 || i == i1 || i == i2)
+			continue;
+
+		// Find a visible edge on the hull using the hash.
+		unsigned int nStart = 0;
+		unsigned int nKey = HashKey(x, y);
+		for (unsigned int j = 0; j < nHashSize; j++)
+		{
+			nStart = HullHash[(nKey + j) % nHashSize];
+			if (nStart != conNoHalfEdge && nStart != HullNext[nStart])
+				break;
+		}
+
+		nStart = HullPrev[nStart];
+		unsigned int e = nStart;
+		unsigned int q = HullNext[e];
+		while (GeoPredicates::Orient2D(x, y, c[2 * e], c[2 * e + 1], c[2 * q], c[2 * q + 1]) >= 0)
+		{
+			e = q;
+			if (e == nStart)
+			{
+				e = conNoHalfEdge;
+				break;
+			}
+			q = HullNext[e];
+		}
+
+		// Not outside the hull, which happens as the order by distance is rounded. Unless
+		// it is a duplicate the point is inserted into the triangle containing it.
+		if (e == conNoHalfEdge)
+		{
+			if (InsertInside(i, HullTri[nStart]))
+				nHullSize++;
+			continue;
+		}
+
+		// Add the first triangle from the point and make it Delaunay.
+		unsigned int t = AddTriangle(e, i, HullNext[e], conNoHalfEdge, conNoHalfEdge, HullTri[e]);
+
+		HullTri[i] = Legalize(t + 2);
+		HullTri[e] = t;
+		nHullSize++;
+
+		// Walk forward through the hull adding triangles.
+		unsigned int n = HullNext[e];
+		q = HullNext[n];
+		while (GeoPredicates::Orient2D(x, y, c[2 * n], c[2 * n + 1], c[2 * q], c[2 * q + 1]) < 0)
+		{
+			t = AddTriangle(n, i, q, HullTri[i], conNoHalfEdge, HullTri[n]);
+			HullTri[i] = Legalize(t + 2);
+			// Removed from the hull.
+			HullNext[n] = n;
+			nHullSize--;
+			n = q;
+			q = HullNext[n];
+		}
+
+		// Walk backward from the other side.
+		if (e == nStart)
+		{
+			q = HullPrev[e];
+			while (GeoPredicates::Orient2D(x, y, c[2 * q], c[2 * q + 1], c[2 * e], c[2 * e + 1]) < 0)
+			{
+				t = AddTriangle(q, i, e, conNoHalfEdge, HullTri[e], HullTri[q]);
+				Legalize(t + 2);
+				HullTri[q] = t;
+				HullNext[e] = e;
+				nHullSize--;
+				e = q;
+				q = HullPrev[e];
+			}
+		}
+
+		m_nHullStart = HullPrev[i] = e;
+		HullNext[e] = HullPrev[n] = i;
+		HullNext[i] = n;
+
+		HullHash[HashKey(x, y)] = i;
+		HullHash[HashKey(c[2 * e], c[2 * e + 1])] = e;
+	}
+
+	m_Hull.resize(nHullSize);
+	unsigned int e = m_nHullStart;
+	for (unsigned int i = 0; i < nHullSize; i++)
+	{
+		m_Hull[i] = e;
+		e = HullNext[e];
+	}
+
+	// The edge into each point, the hull edge for hull points.
+	m_InEdges.assign(nCount, conNoHalfEdge);
+	for (unsigned int e = 0; e < m_HalfEdges.size(); e++)
+	{
+		unsigned int p = m_Triangles[NextHalfEdge(e)];
+		if (m_HalfEdges[e] == conNoHalfEdge || m_InEdges[p] == conNoHalfEdge)
+			m_InEdges[p] = e;
+	}
+
+	vector<unsigned int>().swap(m_HullPrev);
+	vector<unsigned int>().swap(m_HullNext);
+	vector<unsigned int>().swap(m_HullTri);
+	vector<unsigned int>().swap(m_HullHash);
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::Locate
+\brief Finds the triangle containing the point, walking from the triangle of the
+half edge given to the neighbour across the first edge the point is beyond. Returns
+a half edge of the triangle, the one the point is on if it is on an edge. Returns
+conNoHalfEdge if the point is outside the triangulation.
+<P>---------------------------------------------------------------------------*/
+unsigned int CDelaunay::Locate(double x, double y, unsigned int nStart) const
+{
+	const vector<double>& c = m_Coords;
+	unsigned int t = nStart - nStart % 3;
+	unsigned int nFrom = conNoHalfEdge;
+
+	// Each step is to a triangle nearer the point in a Delaunay triangulation, so
+	// the walk ends, but it is bounded anyway.
+	for (unsigned int nStep = 0; nStep <= m_Triangles.size(); nStep++)
+	{
+		unsigned int nOn = conNoHalfEdge;
+		unsigned int nNext = conNoHalfEdge;
+		for (unsigned int j = 0; j < 3; j++)
+		{
+			// Start after the edge walked in through.
+			unsigned int e = nFrom == conNoHalfEdge ? t + j : t + (nFrom - t + 1 + j) % 3;
+			unsigned int p = m_Triangles[e];
+			unsigned int q = m_Triangles[NextHalfEdge(e)];
+			double dOrient = GeoPredicates::Orient2D(c[2 * p], c[2 * p + 1], c[2 * q], c[2 * q + 1], x, y);
+			if (dOrient < 0)
+			{
+				nNext = e;
+				break;
+			}
+			if (dOrient == 0)
+				nOn = e;
+		}
+
+		if (nNext == conNoHalfEdge)
+			return nOn != conNoHalfEdge ? nOn : t;
+
+		nFrom = m_HalfEdges[nNext];
+		if (nFrom == conNoHalfEdge)
+			return conNoHalfEdge;
+		t = nFrom - nFrom % 3;
+	}
+	return conNoHalfEdge;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::InsertInside
+\brief Inserts the point, which is not outside the hull, into the triangle containing
+it, found from the half edge given. The triangle is split in 3, or if the point is
+on an edge the 2 triangles either side are each split in 2, and the new triangles
+are made Delaunay. Returns true if the point was on a hull edge and so has been
+added to the hull. A duplicate point is not inserted.
+<P>---------------------------------------------------------------------------*/
+bool CDelaunay::InsertInside(unsigned int i, unsigned int nStart)
+{
+	const vector<double>& c = m_Coords;
+	const double x = c[2 * i];
+	const double y = c[2 * i + 1];
+
+	unsigned int e = Locate(x, y, nStart);
+	if (e == conNoHalfEdge)
+		return false;
+
+	unsigned int en = NextHalfEdge(e);
+	unsigned int ep = PrevHalfEdge(e);
+	unsigned int p0 = m_Triangles[e];
+	unsigned int p1 = m_Triangles[en];
+	unsigned int p2 = m_Triangles[ep];
+	for (unsigned int j = 0; j < 3; j++)
+	{
+		unsigned int p = m_Triangles[e - e % 3 + j];
+		if (c[2 * p] == x && c[2 * p + 1] == y)
+			return false;
+	}
+
+	bool bOnEdge = GeoPredicates::Orient2D(c[2 * p0], c[2 * p0 + 1], c[2 * p1], c[2 * p1 + 1], x, y) == 0;
+
+	if (!bOnEdge)
+	{
+		// Split into (p0, p1, i), reusing the triangle, (p1, p2, i) and (p2, p0, i).
+		unsigned int nOppN = m_HalfEdges[en];
+		unsigned int nOppP = m_HalfEdges[ep];
+		m_Triangles[ep] = i;
+		unsigned int t1 = AddTriangle(p1, p2, i, nOppN, conNoHalfEdge, en);
+		unsigned int t2 = AddTriangle(p2, p0, i, nOppP, ep, t1 + 1);
+		if (nOppN == conNoHalfEdge)
+			m_HullTri[p1] = t1;
+		if (nOppP == conNoHalfEdge)
+			m_HullTri[p2] = t2;
+
+		Legalize(e);
+		Legalize(t1);
+		Legalize(t2);
+		return false;
+	}
+
+	// On the edge from p0 to p1. The triangle becomes (i, p1, p2) and (p0, i, p2) is
+	// added.
+	unsigned int b = m_HalfEdges[e];
+	unsigned int nOppP = m_HalfEdges[ep];
+	m_Triangles[e] = i;
+	unsigned int tb = AddTriangle(p0, i, p2, conNoHalfEdge, ep, nOppP);
+	if (nOppP == conNoHalfEdge)
+		m_HullTri[p2] = tb + 2;
+
+	if (b == conNoHalfEdge)
+	{
+		// A hull edge so the point joins the hull between p0 and p1.
+		m_HullNext[p0] = m_HullPrev[p1] = i;
+		m_HullPrev[i] = p0;
+		m_HullNext[i] = p1;
+		m_HullTri[p0] = tb;
+		m_HullTri[i] = e;
+		m_HullHash[HashKey(x, y)] = i;
+
+		Legalize(en);
+		Legalize(tb + 2);
+		return true;
+	}
+
+	// The triangle beyond, (p1, p0, p3), becomes (i, p0, p3) and (p1, i, p3) is added.
+	unsigned int bn = NextHalfEdge(b);
+	unsigned int bp = PrevHalfEdge(b);
+	unsigned int p3 = m_Triangles[bp];
+	unsigned int nOppBP = m_HalfEdges[bp];
+	m_Triangles[b] = i;
+	unsigned int tc = AddTriangle(p1, i, p3, e, bp, nOppBP);
+	if (nOppBP == conNoHalfEdge)
+		m_HullTri[p3] = tc + 2;
+	Link(b, tb);
+
+	Legalize(en);
+	Legalize(tb + 2);
+	Legalize(bn);
+	Legalize(tc + 2);
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::HashKey
+\brief The hash key of the angle of the point from the centre. A pseudo angle
+which increases with the angle is used.
+<P>---------------------------------------------------------------------------*/
+unsigned int CDelaunay::HashKey(double x, double y) const
+{
+	double dx = x - m_dCentreX;
+	double dy = y - m_dCentreY;
+	double dSum = fabs(dx) + fabs(dy);
+	double p = dSum > 0 ? dx / dSum : 0;
+	double dAngle = (dy < 0 ? 3 - p : 1 + p) / 4;
+
+	unsigned int nSize = m_HullHash.size();
+	return (unsigned int)floor(dAngle * nSize) % nSize;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::AddTriangle
+\brief Adds a triangle linking its half edges to the opposite ones given. Returns
+the first half edge.
+<P>---------------------------------------------------------------------------*/
+unsigned int CDelaunay::AddTriangle(unsigned int i0, unsigned int i1, unsigned int i2,
+		unsigned int a, unsigned int b, unsigned int c)
+{
+	unsigned int t = m_Triangles.size();
+
+	m_Triangles.push_back(i0);
+	m_Triangles.push_back(i1);
+	m_Triangles.push_back(i2);
+	m_HalfEdges.resize(t + 3);
+
+	Link(t, a);
+	Link(t + 1, b);
+	Link(t + 2, c);
+
+	return t;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::Link
+\brief Links 2 opposite half edges.
+<P>---------------------------------------------------------------------------*/
+void CDelaunay::Link(unsigned int a, unsigned int b)
+{
+	m_HalfEdges[a] = b;
+	if (b != conNoHalfEdge)
+		m_HalfEdges[b] = a;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::Legalize
+\brief Flips the edge if the point opposite is within the circle of the triangle
+and then checks the 2 edges that replaces. Returns the edge which is before the
+one given in its triangle.
+<P>---------------------------------------------------------------------------*/
+unsigned int CDelaunay::Legalize(unsigned int a)
+{
+	unsigned int ar = 0;
+	m_EdgeStack.clear();
+	const vector<double>& c = m_Coords;
+
+	while (true)
+	{
+		unsigned int b = m_HalfEdges[a];
+
+		// If p1 is inside the circle of the triangle p0, pr, pl then flip the edge from pr
+		// to pl over to p0 to p1 and check the 2 edges beyond it in the other triangle.
+		unsigned int a0 = a - a % 3;
+		ar = a0 + (a + 2) % 3;
+
+		if (b == conNoHalfEdge)
+		{
+			// On the hull.
+			if (m_EdgeStack.empty())
+				break;
+			a = m_EdgeStack.back();
+			m_EdgeStack.pop_back();
+			continue;
+		}
+
+		unsigned int b0 = b - b % 3;
+		unsigned int al = a0 + (a + 1) % 3;
+		unsigned int bl = b0 + (b + 2) % 3;
+
+		unsigned int p0 = m_Triangles[ar];
+		unsigned int pr = m_Triangles[a];
+		unsigned int pl = m_Triangles[al];
+		unsigned int p1 = m_Triangles[bl];
+
+		bool bIllegal = GeoPredicates::InCircle(c[2 * p0], c[2 * p0 + 1], c[2 * pr], c[2 * pr + 1],
+			c[2 * pl], c[2 * pl + 1], c[2 * p1], c[2 * p1 + 1]) > 0;
+
+		if (bIllegal)
+		{
+			m_Triangles[a] = p1;
+			m_Triangles[b] = p0;
+
+			unsigned int hbl = m_HalfEdges[bl];
+
+			// The edge swapped on the other side of the hull (rare), fix the hull reference.
+			if (hbl == conNoHalfEdge)
+			{
+				unsigned int e = m_nHullStart;
+				do
+				{
+					if (m_HullTri[e] == bl)
+					{
+						m_HullTri[e] = a;
+						break;
+					}
+					e = m_HullPrev[e];
+				} while (e != m_nHullStart);
+			}
+
+			Link(a, hbl);
+			Link(b, m_HalfEdges[ar]);
+			Link(ar, bl);
+
+			unsigned int br = b0 + (b + 1) % 3;
+			m_EdgeStack.push_back(br);
+		}
+		else
+		{
+			if (m_EdgeStack.empty())
+				break;
+			a = m_EdgeStack.back();
+			m_EdgeStack.pop_back();
+		}
+	}
+
+	return ar;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::GetCircumCentre
+\brief The centre of the circle through the points of the triangle, which is a
+Voronoi vertex.
+<P>---------------------------------------------------------------------------*/
+C2DPoint CDelaunay::GetCircumCentre(unsigned int nTriangle) const
+{
+	const vector<double>& c = m_Coords;
+	unsigned int i0 = m_Triangles[3 * nTriangle];
+	unsigned int i1 = m_Triangles[3 * nTriangle + 1];
+	unsigned int i2 = m_Triangles[3 * nTriangle + 2];
+
+	double x, y;
+	CircumCentreOffset(c[2 * i0], c[2 * i0 + 1], c[2 * i1], c[2 * i1 + 1],
+		c[2 * i2], c[2 * i2 + 1], x, y);
+
+	return C2DPoint(c[2 * i0] + x, c[2 * i0 + 1] + y);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::GetCellPoints
+\brief Gets the polygon of the Voronoi cell, clockwise. The cells of the hull
+points are open so they are closed with points far enough outside the rectangle
+along the 2 open edges and between them.
+<P>---------------------------------------------------------------------------*/
+bool CDelaunay::GetCellPoints(unsigned int nPoint, const C2DRect& Rect, vector<C2DPoint>& Points) const
+{
+	Points.clear();
+
+	if (nPoint >= m_InEdges.size() || m_InEdges[nPoint] == conNoHalfEdge)
+		return false;
+
+	// Walk clockwise round the point through the triangles.
+	unsigned int e0 = m_InEdges[nPoint];
+	unsigned int e = e0;
+	unsigned int eOut = e0;
+	do
+	{
+		Points.push_back(GetCircumCentre(e / 3));
+		eOut = NextHalfEdge(e);
+		e = m_HalfEdges[eOut];
+	} while (e != e0 && e != conNoHalfEdge);
+
+	if (m_HalfEdges[e0] != conNoHalfEdge)
+		return true;
+
+	// The open edges are perpendicular to the hull edges in and out of the point.
+	C2DPoint Pt = GetPoint(nPoint);
+	C2DVector In(GetPoint(m_Triangles[e0]), Pt);
+	C2DVector Out(Pt, GetPoint(m_Triangles[NextHalfEdge(eOut)]));
+	C2DVector NormalIn(In.j, -In.i);
+	C2DVector NormalOut(Out.j, -Out.i);
+	NormalIn.MakeUnit();
+	NormalOut.MakeUnit();
+	C2DVector Mid = NormalIn + NormalOut;
+	Mid.MakeUnit();
+
+	C2DPoint Centre = Rect.GetCentre();
+	double dMax = Centre.Distance(Pt);
+	for (unsigned int i = 0; i < Points.size(); i++)
+		dMax = max(dMax, Centre.Distance(Points[i]));
+	dMax += Centre.Distance(Rect.GetTopLeft());
+	double dFar = 4 * dMax;
+
+	C2DPoint First = Points.front();
+	C2DPoint Last = Points.back();
+	Points.push_back(Last + NormalOut * dFar);
+	Points.push_back(Pt + Mid * dFar);
+	Points.push_back(First + NormalIn * dFar);
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::ClipToRect
+\brief Clips the polygon to the rectangle (Sutherland-Hodgman).
+<P>---------------------------------------------------------------------------*/
+void CDelaunay::ClipToRect(vector<C2DPoint>& Points, const C2DRect& Rect)
+{
+	vector<C2DPoint> Clipped;
+
+	for (unsigned int nSide = 0; nSide < 4 && !Points.empty(); nSide++)
+	{
+		// The signed distance inside the side.
+		auto Inside = [&](const C2DPoint& Pt)
+		{
+			switch (nSide)
+			{
+			case 0: return Pt.x - Rect.GetLeft();
+			case 1: return Rect.GetRight() - Pt.x;
+			case 2: return Pt.y - Rect.GetBottom();
+			default: return Rect.GetTop() - Pt.y;
+			}
+		};
+
+		Clipped.clear();
+		unsigned int nCount = Points.size();
+		for (unsigned int i = 0; i < nCount; i++)
+		{
+			const C2DPoint& From = Points[i];
+			const C2DPoint& To = Points[(i + 1) % nCount];
+			double dFrom = Inside(From);
+			double dTo = Inside(To);
+
+			if (dFrom >= 0)
+				Clipped.push_back(From);
+			if ((dFrom >= 0) != (dTo >= 0))
+			{
+				double t = dFrom / (dFrom - dTo);
+				Clipped.push_back(C2DPoint(From.x + (To.x - From.x) * t, From.y + (To.y - From.y) * t));
+			}
+		}
+		Points.swap(Clipped);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::GetVoronoiCell
+\brief Gets the Voronoi cell of the point clipped to the rectangle. False if the
+point is not in the triangulation or its cell misses the rectangle.
+<P>---------------------------------------------------------------------------*/
+bool CDelaunay::GetVoronoiCell(unsigned int nPoint, const C2DRect& Rect, C2DPolygon& Cell) const
+{
+	vector<C2DPoint> Points;
+	if (!GetCellPoints(nPoint, Rect, Points))
+		return false;
+
+	ClipToRect(Points, Rect);
+
+	if (Points.size() < 3)
+		return false;
+
+	return Cell.Create(&Points[0], Points.size());
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::GetVoronoiCells
+\brief Adds the Voronoi cells clipped to the rectangle to the set.
+<P>---------------------------------------------------------------------------*/
+void CDelaunay::GetVoronoiCells(const C2DRect& Rect, C2DPolygonSet& Cells) const
+{
+	for (unsigned int i = 0; i < GetPointCount(); i++)
+	{
+		C2DPolygon* pCell = new C2DPolygon;
+		if (GetVoronoiCell(i, Rect, *pCell))
+			Cells.Add(pCell);
+		else
+			delete pCell;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CDelaunay::GetVoronoiEdges
+\brief Adds the Voronoi edges clipped to the rectangle to the set. There is an edge
+between the circumcentres of each pair of adjacent triangles and an open edge going
+out from each triangle on the hull.
+<P>---------------------------------------------------------------------------*/
+void CDelaunay::GetVoronoiEdges(const C2DRect& Rect, C2DLineSet& Edges) const
+{
+	double dBounds[4] = {Rect.GetLeft(), Rect.GetRight(), Rect.GetBottom(), Rect.GetTop()};
+
+	for (unsigned int e = 0; e < m_HalfEdges.size(); e++)
+	{
+		unsigned int nOpposite = m_HalfEdges[e];
+		if (nOpposite != conNoHalfEdge && nOpposite < e)
+			continue;
+
+		C2DPoint From = GetCircumCentre(e / 3);
+		double dx, dy;
+		double t0 = 0;
+		double t1 = 1;
+		if (nOpposite != conNoHalfEdge)
+		{
+			C2DPoint To = GetCircumCentre(nOpposite / 3);
+			dx = To.x - From.x;
+			dy = To.y - From.y;
+		}
+		else
+		{
+			// Outwards, to the right of the hull edge.
+			C2DPoint Pt1 = GetPoint(m_Triangles[e]);
+			C2DPoint Pt2 = GetPoint(m_Triangles[NextHalfEdge(e)]);
+			dx = Pt2.y - Pt1.y;
+			dy = Pt1.x - Pt2.x;
+			t1 = numeric_limits<double>::infinity();
+		}
+
+		// Liang-Barsky clipping.
+		double p[4] = {-dx, dx, -dy, dy};
+		double q[4] = {From.x - dBounds[0], dBounds[1] - From.x, From.y - dBounds[2], dBounds[3] - From.y};
+		bool bInside = true;
+		for (unsigned int i = 0; i < 4 && bInside; i++)
+		{
+			if (p[i] == 0)
+			{
+				if (q[i] < 0)
+					bInside = false;
+			}
+			else
+			{
+				double r = q[i] / p[i];
+				if (p[i] < 0)
+					t0 = max(t0, r);
+				else
+					t1 = min(t1, r);
+				if (t0 > t1)
+					bInside = false;
+			}
+		}
+
+		if (bInside && t1 < numeric_limits<double>::infinity())
+		{
+			Edges.AddCopy(From.x + dx * t0, From.y + dy * t0, From.x + dx * t1, From.y + dy * t1);
+		}
+	}
+}
@@ -0,0 +1,140 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Delaunay.h
+\brief Declaration file for the CDelaunay class.
+
+Declaration file for CDelaunay, a Delaunay triangulation of a set of points with
+its Voronoi diagram.
+
+\class CDelaunay
+\brief A Delaunay triangulation held as half edges.
+
+The points are added in order of their distance from a seed triangle near the
+centre, each being joined to the visible edges of the convex hull so far, which
+are found with a hash of the hull by angle. As the distances are rounded a point
+may not be outside the hull so far, in which case it is inserted into the triangle
+containing it instead. The new triangles are then flipped until they are Delaunay.
+The orientation and in circle tests are the exact ones in Predicates.h.
+
+The triangles are held as 3 point indexes each, anticlockwise. Half edge e is the
+edge from the point at e to the next point of its triangle, i.e. half edges 3t,
+3t + 1 and 3t + 2 make up triangle t. The half edge opposite e is
+GetHalfEdges()[e], or conNoHalfEdge if e is on the convex hull. Duplicate points
+are not used. If all the points are collinear there are no triangles.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CDELAUNAY_H
+#define _GEOLIB_CDELAUNAY_H
+
+#include "C2DPoint.h"
+
+class C2DPointSet;
+class C2DRect;
+class C2DPolygon;
+class C2DPolygonSet;
+class C2DLineSet;
+
+/// The half edge value for no opposite half edge.
+const unsigned int conNoHalfEdge = 0xFFFFFFFF;
+
+class GeoLib_API CDelaunay
+{
+public:
+	/// Constructor
+	CDelaunay(void);
+	/// Destructor
+	~CDelaunay(void);
+
+	/// Triangulates the points given as x and y for each.
+	bool Create(const std::vector<double>& Coords);
+	/// Triangulates the points.
+	bool Create(const C2DPointSet& Points);
+
+	/// The point count.
+	unsigned int GetPointCount(void) const {return m_Coords.size() / 2;}
+	/// The triangle count.
+	unsigned int GetTriangleCount(void) const {return m_Triangles.size() / 3;}
+	/// The point indexes of the triangles, 3 for each.
+	const std::vector<unsigned int>& GetTriangles(void) const {return m_Triangles;}
+	/// The opposite of each half edge.
+	const std::vector<unsigned int>& GetHalfEdges(void) const {return m_HalfEdges;}
+	/// The point indexes of the convex hull, anticlockwise.
+	const std::vector<unsigned int>& GetHull(void) const {return m_Hull;}
+	/// The point.
+	C2DPoint GetPoint(unsigned int nPoint) const {return C2DPoint(m_Coords[2 * nPoint], m_Coords[2 * nPoint + 1]);}
+	/// The centre of the circle through the points of the triangle.
+	C2DPoint GetCircumCentre(unsigned int nTriangle) const;
+
+	/// Gets the Voronoi cell of the point clipped to the rectangle. False if it has none.
+	bool GetVoronoiCell(unsigned int nPoint, const C2DRect& Rect, C2DPolygon& Cell) const;
+	/// Adds the Voronoi cells clipped to the rectangle to the set, in point order. Points
+	/// with no cell within the rectangle are skipped.
+	void GetVoronoiCells(const C2DRect& Rect, C2DPolygonSet& Cells) const;
+	/// Adds the Voronoi edges clipped to the rectangle to the set.
+	void GetVoronoiEdges(const C2DRect& Rect, C2DLineSet& Edges) const;
+
+	/// The next half edge of the triangle.
+	static unsigned int NextHalfEdge(unsigned int e) {return e % 3 == 2 ? e - 2 : e + 1;}
+	/// The previous half edge of the triangle.
+	static unsigned int PrevHalfEdge(unsigned int e) {return e % 3 == 0 ? e + 2 : e - 1;}
+
+private:
+	/// Not copyable.
+	CDelaunay(const CDelaunay&);
+	/// Not copyable.
+	CDelaunay& operator=(const CDelaunay&);
+
+	/// Builds the triangulation from the coordinates.
+	bool Build(void);
+	/// The hash key of the angle of the point from the centre.
+	unsigned int HashKey(double x, double y) const;
+	/// Adds a triangle linking its half edges to those given.
+	unsigned int AddTriangle(unsigned int i0, unsigned int i1, unsigned int i2,
+		unsigned int a, unsigned int b, unsigned int c);
+	/// Links 2 opposite half edges.
+	void Link(unsigned int a, unsigned int b);
+	/// Flips the edge and the following edges until they are Delaunay.
+	unsigned int Legalize(unsigned int a);
+	/// Finds the triangle containing the point walking from the half edge given.
+	unsigned int Locate(double x, double y, unsigned int nStart) const;
+	/// Inserts a point not outside the hull into the triangle containing it.
+	bool InsertInside(unsigned int i, unsigned int nStart);
+	/// Gets the polygon of the cell before clipping, with far points for the open cells.
+	bool GetCellPoints(unsigned int nPoint, const C2DRect& Rect, std::vector<C2DPoint>& Points) const;
+	/// Clips the polygon to the rectangle.
+	static void ClipToRect(std::vector<C2DPoint>& Points, const C2DRect& Rect);
+
+	/// The coordinates, x and y for each point.
+	std::vector<double> m_Coords;
+	/// The point indexes of the triangles.
+	std::vector<unsigned int> m_Triangles;
+	/// The opposite half edges.
+	std::vector<unsigned int> m_HalfEdges;
+	/// The convex hull.
+	std::vector<unsigned int> m_Hull;
+	/// A half edge ending at each point, on the hull if the point is.
+	std::vector<unsigned int> m_InEdges;
+
+	/// The hull while building, as a linked list of point indexes.
+	std::vector<unsigned int> m_HullPrev;
+	std::vector<unsigned int> m_HullNext;
+	/// The triangle half edge on the hull after each hull point while building.
+	std::vector<unsigned int> m_HullTri;
+	/// The hash of the hull points by angle while building.
+	std::vector<unsigned int> m_HullHash;
+	/// The first hull point while building.
+	unsigned int m_nHullStart;
+	/// The centre for the hash.
+	double m_dCentreX;
+	double m_dCentreY;
+	/// The edges to be checked by Legalize.
+	std::vector<unsigned int> m_EdgeStack;
+};
+
+#endif
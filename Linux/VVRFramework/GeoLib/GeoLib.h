@@ -45,12 +45,24 @@ any modified versions of this cannot be resold to any other party.
 #include "C2DVector.h"
 #include "C3DPoint.h"
 #include "Constants.h"
+#include "Delaunay.h"
 //#include "Geodetic.h"
 #include "Grid.h"
 #include "IndexSet.h"
 #include "Interval.h"
+#include "PolygonBoolean.h"
+#include "PolygonOffset.h"
+#include "PolygonTriangulator.h"
+#include "Predicates.h"
+#include "PointKdTree.h"
+#include "RTree.h"
+#include "AffineTransformation.h"
+#include "ArcFlattener.h"
+#include "MapProjection.h"
+#include "Minkowski.h"
 //#include "MapProject.h"
 #include "RandomNumber.h"
+#include "Simplifier.h"
 #include "TravellingSalesman.h"
 
 #endif
\ No newline at end of file
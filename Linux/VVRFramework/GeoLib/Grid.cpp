@@ -17,8 +17,10 @@ any modified versions of this cannot be resold to any other party.
 
 using namespace std;
 
-static double ms_dGridSize = 0.0001;
-static unsigned int ms_nDegenerateErrors = 0;
+/// The default context of each thread.
+static thread_local CGridContext ms_DefaultContext;
+/// The context made current by a CGridContextScope, if any.
+static thread_local CGridContext* ms_pCurrentContext = NULL;
 
 const double const_dEqualityAvoidanceFactor = 1000.0;
 
@@ -28,10 +30,7 @@ CGeoLatLong::SetGridSize <BR>
 <P>---------------------------------------------------------------------------*/
 void CGrid::SetGridSize(double dGridSize)
 {
-	if (dGridSize != 0)
-	{
-		ms_dGridSize = fabs(dGridSize);
-	}
+	CGridContext::GetCurrent().SetGridSize(dGridSize);
 }
 
 
@@ -41,7 +40,7 @@ CGeoLatLong::ResetDegenerateErrors <BR>
 <P>---------------------------------------------------------------------------*/
 void CGrid::ResetDegenerateErrors(void)
 {
-	ms_nDegenerateErrors = 0 ;
+	CGridContext::GetCurrent().ResetDegenerateErrors();
 }
 
 
@@ -51,7 +50,7 @@ CGeoLatLong::GetDegenerateErrors <BR>
 <P>---------------------------------------------------------------------------*/
 unsigned int CGrid::GetDegenerateErrors(void) 
 {
-	return ms_nDegenerateErrors;
+	return CGridContext::GetCurrent().GetDegenerateErrors();
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -60,7 +59,20 @@ CGeoLatLong::GetDegenerateErrors <BR>
 <P>---------------------------------------------------------------------------*/
 void CGrid::LogDegenerateError(void) 
 {
-	ms_nDegenerateErrors ++;
+	CGridContext::GetCurrent().LogDegenerateError();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CGrid::Resolve <BR>
+\brief Returns the handling to use. UseContext gives the current context's.
+<P>---------------------------------------------------------------------------*/
+CGrid::eDegenerateHandling CGrid::Resolve(eDegenerateHandling eDegen)
+{
+	if (eDegen == UseContext)
+		return CGridContext::GetCurrent().GetDegenerateHandling();
+
+	return eDegen;
 }
 
 
@@ -70,7 +82,7 @@ CGeoLatLong::GetGridSize <BR>
 <P>---------------------------------------------------------------------------*/
 double CGrid::GetGridSize(void)
 {
-	return ms_dGridSize;
+	return CGridContext::GetCurrent().GetGridSize();
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -120,3 +132,86 @@ void CGrid::SetToMinGridSize(const C2DRect& cRect,
 	CGrid::SetGridSize( GetMinGridSize(cRect, bRoundToNearestDecimalFactor));
 
 }
+
+
+/**--------------------------------------------------------------------------<BR>
+CGridContext::CGridContext <BR>
+\brief Constructor with the default grid size.
+<P>---------------------------------------------------------------------------*/
+CGridContext::CGridContext(void) : m_dGridSize(0.0001), m_eDegenerateHandling(CGrid::None),
+	m_nDegenerateErrors(0)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CGridContext::CGridContext <BR>
+\brief Constructor with the grid size and degenerate handling.
+<P>---------------------------------------------------------------------------*/
+CGridContext::CGridContext(double dGridSize, CGrid::eDegenerateHandling eDegen) : 
+	m_dGridSize(0.0001), m_eDegenerateHandling(CGrid::None), m_nDegenerateErrors(0)
+{
+	SetGridSize(dGridSize);
+	SetDegenerateHandling(eDegen);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CGridContext::SetGridSize <BR>
+\brief Sets the grid size. Zero is ignored.
+<P>---------------------------------------------------------------------------*/
+void CGridContext::SetGridSize(double dGridSize)
+{
+	if (dGridSize != 0)
+	{
+		m_dGridSize = fabs(dGridSize);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CGridContext::SetDegenerateHandling <BR>
+\brief Sets the degenerate handling. UseContext would refer to itself so is taken
+as None.
+<P>---------------------------------------------------------------------------*/
+void CGridContext::SetDegenerateHandling(CGrid::eDegenerateHandling eDegen)
+{
+	if (eDegen == CGrid::UseContext)
+		m_eDegenerateHandling = CGrid::None;
+	else
+		m_eDegenerateHandling = eDegen;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CGridContext::GetCurrent <BR>
+\brief Returns the context made current by the innermost CGridContextScope of the
+calling thread or the thread's default context if there is none.
+<P>---------------------------------------------------------------------------*/
+CGridContext& CGridContext::GetCurrent(void)
+{
+	if (ms_pCurrentContext != NULL)
+		return *ms_pCurrentContext;
+
+	return ms_DefaultContext;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CGridContextScope::CGridContextScope <BR>
+\brief Constructor, makes the context current for the calling thread.
+<P>---------------------------------------------------------------------------*/
+CGridContextScope::CGridContextScope(CGridContext& Context) : m_pPrevious(ms_pCurrentContext)
+{
+	ms_pCurrentContext = &Context;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CGridContextScope::~CGridContextScope <BR>
+\brief Destructor, restores the previous context.
+<P>---------------------------------------------------------------------------*/
+CGridContextScope::~CGridContextScope(void)
+{
+	ms_pCurrentContext = m_pPrevious;
+}
@@ -15,7 +15,20 @@ any modified versions of this cannot be resold to any other party.
 The grid is simply a spacing between allowable points. When objects are "Snapped"
 to the grid, all points must then lie on the grid lines. This is used within 
 GeoLib to manage degenerate cases but has other applications. Also used to record
-degenerate errors. All functions are static. 
+degenerate errors. All functions are static and act on the current CGridContext of
+the calling thread.
+
+\class CGridContext
+\brief The grid settings and degenerate error count used by operations.
+
+Each thread has its own default context so threads using different grid sizes do 
+not affect each other. A context can be made current for a block of code with
+CGridContextScope. A context should only be current in one thread at a time.
+Operations given CGrid::UseContext, the default, use the degenerate handling of the
+current context, which is CGrid::None unless set.
+
+\class CGridContextScope
+\brief Makes a context current for the calling thread until it goes out of scope.
 <P>---------------------------------------------------------------------------*/
 
 #ifndef _GEOLIB_CGRID_H 
@@ -34,6 +47,7 @@ public:
 		DynamicGrid,
 		PreDefinedGrid,
 		PreDefinedGridPreSnapped,
+		UseContext,
 	};
 	/// Constructor
 	CGrid(void) {;}
@@ -55,7 +69,66 @@ public:
 	static unsigned int GetDegenerateErrors(void);
 	/// Used to log a degenerate error.
 	static void LogDegenerateError(void);
+	/// Returns the handling to use, resolving UseContext to the current context's.
+	static eDegenerateHandling Resolve(eDegenerateHandling eDegen);
+
+};
+
+
+class GeoLib_API CGridContext
+{
+public:
+	/// Constructor
+	CGridContext(void);
+	/// Constructor with the grid size and degenerate handling.
+	CGridContext(double dGridSize, CGrid::eDegenerateHandling eDegen = CGrid::None);
+	/// Destructor
+	~CGridContext(void) {;}
+
+	/// Sets the size of the grid.
+	void SetGridSize(double dGridSize);
+	/// Gets the grid size.
+	double GetGridSize(void) const {return m_dGridSize;}
+	/// Sets the degenerate handling used by operations passed CGrid::UseContext.
+	void SetDegenerateHandling(CGrid::eDegenerateHandling eDegen);
+	/// Gets the degenerate handling used by operations passed CGrid::UseContext.
+	CGrid::eDegenerateHandling GetDegenerateHandling(void) const {return m_eDegenerateHandling;}
+	/// Resets the degenerate count.
+	void ResetDegenerateErrors(void) {m_nDegenerateErrors = 0;}
+	/// Gets the degenerate errors.
+	unsigned int GetDegenerateErrors(void) const {return m_nDegenerateErrors;}
+	/// Used to log degenerate errors.
+	void LogDegenerateError(unsigned int nErrors = 1) {m_nDegenerateErrors += nErrors;}
+
+	/// Returns the current context of the calling thread.
+	static CGridContext& GetCurrent(void);
+
+private:
+	/// The grid size.
+	double m_dGridSize;
+	/// The degenerate handling.
+	CGrid::eDegenerateHandling m_eDegenerateHandling;
+	/// The degenerate error count.
+	unsigned int m_nDegenerateErrors;
+};
+
+
+class GeoLib_API CGridContextScope
+{
+public:
+	/// Constructor, makes the context current.
+	CGridContextScope(CGridContext& Context);
+	/// Destructor, restores the previous context.
+	~CGridContextScope(void);
+
+private:
+	/// Not copyable.
+	CGridContextScope(const CGridContextScope&);
+	/// Not copyable.
+	CGridContextScope& operator=(const CGridContextScope&);
 
+	/// The context that was current before.
+	CGridContext* m_pPrevious;
 };
 
 #endif
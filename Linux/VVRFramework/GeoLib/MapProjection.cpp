@@ -0,0 +1,164 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file MapProjection.cpp
+\brief Implementation file for the CMercatorProjection and CEquirectangularProjection classes.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "MapProjection.h"
+#include <cmath>
+
+using namespace std;
+
+/// The latitude limit of the Mercator projection, at which a web map is square.
+const double conMaxMercatorLatitude = 85.051128779806592;
+
+
+/**--------------------------------------------------------------------------<BR>
+CMercatorProjection::CMercatorProjection
+\brief Constructor, with the radius of the sphere and the central meridian in degrees.
+<P>---------------------------------------------------------------------------*/
+CMercatorProjection::CMercatorProjection(double dRadius, double dCentralMeridian)
+	: m_dRadius(dRadius), m_dCentralMeridian(dCentralMeridian)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMercatorProjection::~CMercatorProjection
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CMercatorProjection::~CMercatorProjection(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMercatorProjection::Transform
+\brief Projects the longitude and latitude given in degrees.
+<P>---------------------------------------------------------------------------*/
+void CMercatorProjection::Transform(double& dx, double& dy) const
+{
+	TransformPoints(&dx, &dy, 1);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMercatorProjection::InverseTransform
+\brief Gives the longitude and latitude in degrees of the projected point.
+<P>---------------------------------------------------------------------------*/
+void CMercatorProjection::InverseTransform(double& dx, double& dy) const
+{
+	InverseTransformPoints(&dx, &dy, 1);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMercatorProjection::TransformPoints
+\brief Projects the points given as arrays of longitude and latitude in degrees.
+<P>---------------------------------------------------------------------------*/
+void CMercatorProjection::TransformPoints(double* pX, double* pY, unsigned int nCount) const
+{
+	const double dScale = m_dRadius * conRadiansPerDegree;
+	const double dOffset = m_dCentralMeridian * dScale;
+	for (unsigned int i = 0; i < nCount; i++)
+		pX[i] = pX[i] * dScale - dOffset;
+
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		const double dLat = max(-conMaxMercatorLatitude, min(conMaxMercatorLatitude, pY[i]));
+		pY[i] = m_dRadius * log(tan(conQUARTPI + dLat * conRadiansPerDegree / 2));
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMercatorProjection::InverseTransformPoints
+\brief Gives the longitudes and latitudes in degrees of the projected points.
+<P>---------------------------------------------------------------------------*/
+void CMercatorProjection::InverseTransformPoints(double* pX, double* pY, unsigned int nCount) const
+{
+	const double dScale = 1 / (m_dRadius * conRadiansPerDegree);
+	for (unsigned int i = 0; i < nCount; i++)
+		pX[i] = pX[i] * dScale + m_dCentralMeridian;
+
+	for (unsigned int i = 0; i < nCount; i++)
+		pY[i] = (2 * atan(exp(pY[i] / m_dRadius)) - conHALFPI) * conDegreesPerRadian;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEquirectangularProjection::CEquirectangularProjection
+\brief Constructor, with the radius of the sphere, the standard parallel, the central
+meridian and the latitude of origin, in degrees.
+<P>---------------------------------------------------------------------------*/
+CEquirectangularProjection::CEquirectangularProjection(double dRadius, double dStandardParallel,
+							double dCentralMeridian, double dOriginLatitude)
+	: m_dCentralMeridian(dCentralMeridian), m_dOriginLatitude(dOriginLatitude)
+{
+	m_dScaleY = dRadius * conRadiansPerDegree;
+	m_dScaleX = m_dScaleY * cos(dStandardParallel * conRadiansPerDegree);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEquirectangularProjection::~CEquirectangularProjection
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CEquirectangularProjection::~CEquirectangularProjection(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEquirectangularProjection::Transform
+\brief Projects the longitude and latitude given in degrees.
+<P>---------------------------------------------------------------------------*/
+void CEquirectangularProjection::Transform(double& dx, double& dy) const
+{
+	TransformPoints(&dx, &dy, 1);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEquirectangularProjection::InverseTransform
+\brief Gives the longitude and latitude in degrees of the projected point.
+<P>---------------------------------------------------------------------------*/
+void CEquirectangularProjection::InverseTransform(double& dx, double& dy) const
+{
+	InverseTransformPoints(&dx, &dy, 1);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEquirectangularProjection::TransformPoints
+\brief Projects the points given as arrays of longitude and latitude in degrees.
+<P>---------------------------------------------------------------------------*/
+void CEquirectangularProjection::TransformPoints(double* pX, double* pY, unsigned int nCount) const
+{
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		pX[i] = (pX[i] - m_dCentralMeridian) * m_dScaleX;
+		pY[i] = (pY[i] - m_dOriginLatitude) * m_dScaleY;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEquirectangularProjection::InverseTransformPoints
+\brief Gives the longitudes and latitudes in degrees of the projected points.
+<P>---------------------------------------------------------------------------*/
+void CEquirectangularProjection::InverseTransformPoints(double* pX, double* pY, unsigned int nCount) const
+{
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		pX[i] = pX[i] / m_dScaleX + m_dCentralMeridian;
+		pY[i] = pY[i] / m_dScaleY + m_dOriginLatitude;
+	}
+}
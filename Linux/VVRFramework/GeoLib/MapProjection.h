@@ -0,0 +1,99 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file MapProjection.h
+\brief Declaration file for the CMercatorProjection and CEquirectangularProjection classes.
+
+Declaration file for 2 map projections from longitude and latitude in degrees, as x
+and y, to metres on the sphere. The inverse transforms go back to degrees.
+
+\class CMercatorProjection
+\brief The spherical Mercator projection, as used by web maps.
+
+x = R (longitude - central meridian) and y = R ln(tan(pi / 4 + latitude / 2)), the
+angles in radians. Latitudes are limited to those of a square web map, about 85.05
+degrees, beyond which y grows without bound.
+
+\class CEquirectangularProjection
+\brief The equirectangular projection.
+
+x = R (longitude - central meridian) cos(standard parallel) and
+y = R (latitude - latitude of origin), the angles in radians. Distances are true
+along the standard parallel and along the meridians.
+
+Both transform arrays of points in loops which keep the linear part apart from the
+trigonometry so that the compiler can vectorise it.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CMAPPROJECTION_H
+#define _GEOLIB_CMAPPROJECTION_H
+
+#include "Transformation.h"
+#include "Constants.h"
+
+class GeoLib_API CMercatorProjection : public CTransformation
+{
+public:
+	/// Constructor, with the radius of the sphere and the central meridian in degrees.
+	CMercatorProjection(double dRadius = conGeocent_Major, double dCentralMeridian = 0);
+	/// Destructor.
+	virtual ~CMercatorProjection(void);
+
+	/// The radius.
+	double GetRadius(void) const {return m_dRadius;}
+	/// The central meridian in degrees.
+	double GetCentralMeridian(void) const {return m_dCentralMeridian;}
+
+	/// Projects the longitude and latitude given in degrees.
+	virtual void Transform(double& dx, double& dy) const;
+	/// Gives the longitude and latitude in degrees of the projected point.
+	virtual void InverseTransform(double& dx, double& dy) const;
+	/// Projects the points given as arrays of longitude and latitude in degrees.
+	virtual void TransformPoints(double* pX, double* pY, unsigned int nCount) const;
+	/// Gives the longitudes and latitudes in degrees of the projected points.
+	virtual void InverseTransformPoints(double* pX, double* pY, unsigned int nCount) const;
+
+private:
+	/// The radius.
+	double m_dRadius;
+	/// The central meridian in degrees.
+	double m_dCentralMeridian;
+};
+
+
+class GeoLib_API CEquirectangularProjection : public CTransformation
+{
+public:
+	/// Constructor, with the radius of the sphere, the standard parallel, the central
+	/// meridian and the latitude of origin, in degrees.
+	CEquirectangularProjection(double dRadius = conGeocent_Major, double dStandardParallel = 0,
+				double dCentralMeridian = 0, double dOriginLatitude = 0);
+	/// Destructor.
+	virtual ~CEquirectangularProjection(void);
+
+	/// Projects the longitude and latitude given in degrees.
+	virtual void Transform(double& dx, double& dy) const;
+	/// Gives the longitude and latitude in degrees of the projected point.
+	virtual void InverseTransform(double& dx, double& dy) const;
+	/// Projects the points given as arrays of longitude and latitude in degrees.
+	virtual void TransformPoints(double* pX, double* pY, unsigned int nCount) const;
+	/// Gives the longitudes and latitudes in degrees of the projected points.
+	virtual void InverseTransformPoints(double* pX, double* pY, unsigned int nCount) const;
+
+private:
+	/// The metres per degree of longitude.
+	double m_dScaleX;
+	/// The metres per degree of latitude.
+	double m_dScaleY;
+	/// The central meridian in degrees.
+	double m_dCentralMeridian;
+	/// The latitude of origin in degrees.
+	double m_dOriginLatitude;
+};
+
+#endif
@@ -3,7 +3,11 @@
 \brief Declaration file for the CMemoryPool class.
 
 Declaration file for the CMemoryPool class which allocates large chuncks on the
-heap to speed things up.
+heap to speed things up. Each thread has its own list of free items per type so
+allocation and deallocation take no lock. An item freed on another thread than the
+one it was allocated on joins the list of the thread freeing it. The list of a thread
+that ends is shared with the other threads, a block at a time, and the blocks are kept
+until the process ends.
 <P>---------------------------------------------------------------------------*/
 
 #pragma once
@@ -11,6 +15,7 @@ heap to speed things up.
 
 #include <vector>
 #include <cstdio>
+#include <mutex>
 
 #define _MEMORY_POOL_DECLARATION_PURE	virtual void* operator new(unsigned int) = 0;\
 										virtual void* operator new(unsigned int, const char*,int) = 0;\
@@ -42,146 +47,158 @@ template <class TYPE>
 class CMemoryPool
 {
 public:
-	/// Constructor
-	CMemoryPool(void);
-	/// Destructor
-	~CMemoryPool(void);
 	/// Allocated
 	static void* Allocate(void);
 	/// Deallocate
 	static void Deallocate(void* pData);
 
-
-//	static CMemoryPool<TYPE>& GetInstance(void);
 private:
-
-	void Clear(void);
-
-	void* PAllocate(void);
-	/// Deallocate
-	void PDeallocate(void* pData);
-
 	struct sList
 	{
 		TYPE cObject;
 		sList* pNext;
 	};
 
-	sList* m_pList;
-
-	std::vector<char*> m_Blocks;
-
-	static CMemoryPool<TYPE>* m_spInstance;
+	/// Hands the free list of the thread to the shared list when the thread ends.
+	struct sThreadExit
+	{
+		~sThreadExit(void);
+		/// True once the thread has used the pool.
+		bool bUsed;
+	};
 
-	static unsigned int m_snCount;
+	/// Registers the thread to hand back its free list when it ends.
+	static void RegisterThread(void);
+	/// Fills the free list of the thread from the shared lists or a new block.
+	static void Refill(void);
+	/// Adds the list to the shared lists in lists of up to a block. Must hold the mutex.
+	static void Share(sList* pList);
+	/// Returns the shared lists, made on first use and kept until the process ends.
+	static std::vector<sList*>& GetShared(void);
+
+	/// The free items of this thread.
+	static thread_local sList* m_tpList;
+	/// True once the thread has registered to hand back its free list.
+	static thread_local bool m_tbRegistered;
+	/// True once the thread has handed back its free list, e.g. while it ends.
+	static thread_local bool m_tbEnded;
+	/// Hands back the free list when the thread ends.
+	static thread_local sThreadExit m_tExit;
+
+	/// The free items of threads that have ended, in lists of up to a block.
+	static std::vector<sList*>* m_spShared;
+	/// Guards the shared lists.
+	static std::mutex m_sMutex;
 };
 
 template<class TYPE>
-CMemoryPool<TYPE>* CMemoryPool<TYPE>::m_spInstance = NULL;
+thread_local typename CMemoryPool<TYPE>::sList* CMemoryPool<TYPE>::m_tpList = NULL;
 
 template<class TYPE>
-unsigned int CMemoryPool<TYPE>::m_snCount = 0;
+thread_local bool CMemoryPool<TYPE>::m_tbRegistered = false;
 
 template<class TYPE>
-/**--------------------------------------------------------------------------<BR>
-CMemoryPool<TYPE>::CMemoryPool <BR>
-Constructor.
-<P>---------------------------------------------------------------------------*/
-CMemoryPool<TYPE>::CMemoryPool(void)
-{
-	m_pList = NULL;
-}
+thread_local bool CMemoryPool<TYPE>::m_tbEnded = false;
 
+template<class TYPE>
+thread_local typename CMemoryPool<TYPE>::sThreadExit CMemoryPool<TYPE>::m_tExit;
 
 template<class TYPE>
-/**--------------------------------------------------------------------------<BR>
-CMemoryPool<TYPE>::CMemoryPool <BR>
-Constructor.
-<P>---------------------------------------------------------------------------*/
-CMemoryPool<TYPE>::~CMemoryPool(void)
-{
-	Clear();
-}
+std::vector<typename CMemoryPool<TYPE>::sList*>* CMemoryPool<TYPE>::m_spShared = NULL;
+
+template<class TYPE>
+std::mutex CMemoryPool<TYPE>::m_sMutex;
 
 
 template<class TYPE>
 /**--------------------------------------------------------------------------<BR>
-CMemoryPool<TYPE>::Clear <BR>
-Clear.
+CMemoryPool<TYPE>::Allocate <BR>
+Allocates memory.
 <P>---------------------------------------------------------------------------*/
-void CMemoryPool<TYPE>::Clear(void)
+void* CMemoryPool<TYPE>::Allocate(void)
 {
-	for (unsigned int i = 0; i < m_Blocks.size(); i++)
-	{
-		delete[] m_Blocks[i];
-	}
+	if (m_tpList == NULL)
+		Refill();
 
-	m_Blocks.clear();
-
-	m_pList = NULL;
+	// Take it off the top of the list
+	sList* pList = m_tpList;
+	m_tpList = pList->pNext;
+	return pList;
 }
 
 
 template<class TYPE>
 /**--------------------------------------------------------------------------<BR>
-CMemoryPool<TYPE>::Allocate <BR>
-Allocates memory.
+CMemoryPool<TYPE>::Deallocate <BR>
+Deallocates/recycles memory.
 <P>---------------------------------------------------------------------------*/
-void* CMemoryPool<TYPE>::Allocate(void)
+void CMemoryPool<TYPE>::Deallocate(void* pData)
 {
-	if (m_spInstance == NULL)
-		m_spInstance = new CMemoryPool<TYPE>;
+	if (pData == NULL)
+		return;
+
+	sList* pList = (sList*)pData;
+	if (m_tbEnded)
+	{
+		// The thread is ending so give it straight to the other threads.
+		std::lock_guard<std::mutex> Lock(m_sMutex);
+		pList->pNext = NULL;
+		GetShared().push_back(pList);
+		return;
+	}
 
-	m_snCount++;
+	if (!m_tbRegistered)
+		RegisterThread();
 
-	return m_spInstance->PAllocate();
+	// Insert it for reallocation.
+	pList->pNext = m_tpList;
+	m_tpList = pList;
 }
 
+
 template<class TYPE>
 /**--------------------------------------------------------------------------<BR>
-CMemoryPool<TYPE>::Allocate <BR>
-Allocates memory.
+CMemoryPool<TYPE>::RegisterThread <BR>
+Registers the thread to hand back its free list when it ends. Setting a member of the
+thread's sThreadExit constructs it, so it is destroyed with the thread.
 <P>---------------------------------------------------------------------------*/
-void CMemoryPool<TYPE>::Deallocate(void* pData)
+void CMemoryPool<TYPE>::RegisterThread(void)
 {
-	if (m_spInstance)
-	{
-		m_spInstance->PDeallocate(pData);
-		m_snCount--;
-		if (m_snCount == 0)
-		{
-			delete m_spInstance;
-			m_spInstance = NULL;
-		}
-	}
+	m_tExit.bUsed = true;
+	m_tbRegistered = true;
 }
 
 
 template<class TYPE>
 /**--------------------------------------------------------------------------<BR>
-CMemoryPool<TYPE>::Allocate <BR>
-Allocates memory.
+CMemoryPool<TYPE>::Refill <BR>
+Fills the free list of the thread. Takes a list of the items of threads that have
+ended if there are any, otherwise creates a new block. A thread that is ending only
+keeps one item so the rest stay shared.
 <P>---------------------------------------------------------------------------*/
-void* CMemoryPool<TYPE>::PAllocate(void)
+void CMemoryPool<TYPE>::Refill(void)
 {
+	if (!m_tbRegistered && !m_tbEnded)
+		RegisterThread();
 
-	// If we have no data then create some
-	if (m_pList == NULL)
-	{
-		// Create a load of items - just allocate the memory
-	//	sList* pData = new sList[_BLOCK_SIZE];
+	std::lock_guard<std::mutex> Lock(m_sMutex);
 
+	std::vector<sList*>& Shared = GetShared();
+	if (!Shared.empty())
+	{
+		m_tpList = Shared.back();
+		Shared.pop_back();
+	}
+	else
+	{
+		// Create a load of items - just allocate the memory. The blocks are kept for
+		// the life of the process as their items can be on the list of any thread.
 		char* pData = new char[sizeof(sList) * _BLOCK_SIZE];
-		// Record this for later deletion
-		m_Blocks.push_back(pData);
 		// Create a linked list for allocation
 		sList* pList = (sList*) pData;
-		// Initialise the head
-		m_pList = pList;
-		// Create the linked list
+		m_tpList = pList;
 		for (unsigned int i = 1; i < _BLOCK_SIZE; i++)
 		{
-		//	pData++;
 			pData += sizeof(sList);
 			pList->pNext = (sList*) pData;
 			pList = pList->pNext;
@@ -189,26 +206,62 @@ void* CMemoryPool<TYPE>::PAllocate(void)
 		// Terminate the list
 		pList->pNext = NULL;
 	}
-	// Get the return value
-	sList* pList = m_pList;
-	// Take it off the top of the list
-	m_pList = m_pList->pNext;
-	// Return it.
-	return pList;
+
+	if (m_tbEnded && m_tpList->pNext != NULL)
+	{
+		Shared.push_back(m_tpList->pNext);
+		m_tpList->pNext = NULL;
+	}
 }
 
 
 template<class TYPE>
 /**--------------------------------------------------------------------------<BR>
-CMemoryPool<TYPE>::Allocate <BR>
-Deallocates/recycles memory.
+CMemoryPool<TYPE>::Share <BR>
+Adds the list to the shared lists, split into lists of up to a block so a thread
+refilling takes no more than it would from a new block.
 <P>---------------------------------------------------------------------------*/
-void CMemoryPool<TYPE>::PDeallocate(void* pData)
+void CMemoryPool<TYPE>::Share(sList* pList)
 {
-	// Cast this to a list entry
-	sList* pList = (sList*)pData;
-	// Insert it for reallocation.
-	pList->pNext = m_pList;
+	std::vector<sList*>& Shared = GetShared();
+	while (pList != NULL)
+	{
+		Shared.push_back(pList);
+		for (unsigned int i = 1; i < _BLOCK_SIZE && pList->pNext != NULL; i++)
+			pList = pList->pNext;
+		sList* pNext = pList->pNext;
+		pList->pNext = NULL;
+		pList = pNext;
+	}
+}
+
+
+template<class TYPE>
+/**--------------------------------------------------------------------------<BR>
+CMemoryPool<TYPE>::GetShared <BR>
+Returns the shared lists. They are never deleted so items can still be freed while
+the process ends.
+<P>---------------------------------------------------------------------------*/
+std::vector<typename CMemoryPool<TYPE>::sList*>& CMemoryPool<TYPE>::GetShared(void)
+{
+	if (m_spShared == NULL)
+		m_spShared = new std::vector<sList*>;
+	return *m_spShared;
+}
+
+
+template<class TYPE>
+/**--------------------------------------------------------------------------<BR>
+CMemoryPool<TYPE>::sThreadExit::~sThreadExit <BR>
+Adds the free list of the ending thread to the shared lists.
+<P>---------------------------------------------------------------------------*/
+CMemoryPool<TYPE>::sThreadExit::~sThreadExit(void)
+{
+	m_tbEnded = true;
+	if (!bUsed || m_tpList == NULL)
+		return;
 
-	m_pList = pList;
+	std::lock_guard<std::mutex> Lock(m_sMutex);
+	Share(m_tpList);
+	m_tpList = NULL;
 }
@@ -0,0 +1,481 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Minkowski.cpp
+\brief Implementation file for the CMinkowski and CNoFitPolygonCache classes.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "Minkowski.h"
+#include "C2DPolygon.h"
+#include "C2DPolygonSet.h"
+#include "C2DHoledPolyBase.h"
+#include "C2DHoledPolyBaseSet.h"
+#include "C2DLineBase.h"
+#include "PolygonBoolean.h"
+#include "PolygonTriangulator.h"
+
+using namespace std;
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetConvexSum
+\brief Makes the sum of 2 convex polygons. False if either has fewer than 3 points.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::GetConvexSum(const C2DPolygon& A, const C2DPolygon& B, C2DPolygon& Result)
+{
+	if (A.GetPointsCount() < 3 || B.GetPointsCount() < 3)
+		return false;
+
+	vector<C2DPoint> PointsA, PointsB, Sum;
+	GetConvexPoints(A, false, PointsA);
+	GetConvexPoints(B, false, PointsB);
+	GetConvexSum(PointsA, PointsB, Sum);
+
+	if (Sum.size() < 3)
+		return false;
+
+	return Result.Create(&Sum[0], Sum.size());
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetSum
+\brief Adds the sum of the polygons, convex or not, to the set. False if either
+could not be split into convex pieces.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::GetSum(const C2DPolygon& A, const C2DPolygon& B, C2DHoledPolyBaseSet& Result)
+{
+	return GetSum(A, B, false, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetDifference
+\brief Adds the difference of the polygons, the sum of A and B reflected through the
+origin, to the set.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::GetDifference(const C2DPolygon& A, const C2DPolygon& B, C2DHoledPolyBaseSet& Result)
+{
+	return GetSum(A, B, true, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetNoFitPolygon
+\brief Adds the no fit polygon of the moving part about the fixed to the set. Both are
+given about their reference points.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::GetNoFitPolygon(const C2DPolygon& Fixed, const C2DPolygon& Moving,
+						C2DHoledPolyBaseSet& Result)
+{
+	return GetSum(Fixed, Moving, true, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::IsInside
+\brief True if the point is inside the shapes by more than the tolerance.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::IsInside(const C2DHoledPolyBaseSet& Shapes, const C2DPoint& pt, double dTolerance)
+{
+	return FindInside(Shapes, pt, dTolerance) >= 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetExit
+\brief True if the point is inside the shapes by more than the tolerance and if so the
+shortest vector which moves it onto their boundary. The shapes do not overlap so the
+nearest boundary is that of the shape the point is in.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::GetExit(const C2DHoledPolyBaseSet& Shapes, const C2DPoint& pt,
+						double dTolerance, C2DVector& Result)
+{
+	const int nShape = FindInside(Shapes, pt, dTolerance);
+	if (nShape < 0)
+		return false;
+
+	const C2DHoledPolyBase& Shape = Shapes[nShape];
+	double dMin = -1;
+	C2DPoint ptNearest;
+	for (int r = -1; r < (int)Shape.GetHoleCount(); r++)
+	{
+		const C2DPolyBase* pRing = r < 0 ? Shape.GetRim() : Shape.GetHole(r);
+		for (unsigned int i = 0; i < pRing->GetLineCount(); i++)
+		{
+			C2DPoint ptOnLine;
+			const double dDist = pRing->GetLine(i)->Distance(pt, &ptOnLine);
+			if (dMin < 0 || dDist < dMin)
+			{
+				dMin = dDist;
+				ptNearest = ptOnLine;
+			}
+		}
+	}
+
+	Result = C2DVector(pt, ptNearest);
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::FindInside
+\brief The index of the shape the point is inside by more than the tolerance, -1 if
+none. The bounding rectangle of each rim is tested first so most shapes cost nothing.
+<P>---------------------------------------------------------------------------*/
+int CMinkowski::FindInside(const C2DHoledPolyBaseSet& Shapes, const C2DPoint& pt, double dTolerance)
+{
+	for (unsigned int s = 0; s < Shapes.size(); s++)
+	{
+		const C2DPolyBase* pRim = Shapes[s].GetRim();
+		if (pRim == 0 || !pRim->GetBoundingRect().Contains(pt))
+			continue;
+
+		if (pRim->DistanceFlattened(pt, 0) >= -dTolerance)
+			continue;
+
+		bool bInside = true;
+		for (unsigned int h = 0; h < Shapes[s].GetHoleCount() && bInside; h++)
+		{
+			if (Shapes[s].GetHole(h)->DistanceFlattened(pt, 0) <= dTolerance)
+				bInside = false;
+		}
+
+		if (bInside)
+			return s;
+	}
+
+	return -1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetConvexPoints
+\brief The points of the convex polygon anticlockwise from the lowest, leftmost if
+several, reflected through the origin if required. Repeated points are dropped.
+<P>---------------------------------------------------------------------------*/
+void CMinkowski::GetConvexPoints(const C2DPolygon& Poly, bool bReflect, vector<C2DPoint>& Points)
+{
+	Points.clear();
+	const unsigned int nCount = Poly.GetPointsCount();
+	const bool bClockwise = Poly.IsClockwise();
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		C2DPoint pt = *Poly.GetPoint(bClockwise ? nCount - 1 - i : i);
+		if (bReflect)
+			pt.Set(-pt.x, -pt.y);
+		if (Points.empty() || pt.x != Points.back().x || pt.y != Points.back().y)
+			Points.push_back(pt);
+	}
+	while (Points.size() > 1 && Points.back().x == Points[0].x && Points.back().y == Points[0].y)
+		Points.pop_back();
+
+	unsigned int nLowest = 0;
+	for (unsigned int i = 1; i < Points.size(); i++)
+	{
+		if (Points[i].y < Points[nLowest].y ||
+			(Points[i].y == Points[nLowest].y && Points[i].x < Points[nLowest].x))
+			nLowest = i;
+	}
+	rotate(Points.begin(), Points.begin() + nLowest, Points.end());
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetConvexSum
+\brief Makes the sum of 2 convex point rings from GetConvexPoints. Both start at the
+lowest point so the edges of each are in order of angle from 0 and a single merge of
+the 2 lists of edges gives the edges of the sum. Straight runs are joined.
+<P>---------------------------------------------------------------------------*/
+void CMinkowski::GetConvexSum(const vector<C2DPoint>& A, const vector<C2DPoint>& B,
+						vector<C2DPoint>& Result)
+{
+	Result.clear();
+	const unsigned int nA = A.size();
+	const unsigned int nB = B.size();
+	if (nA == 0 || nB == 0)
+		return;
+
+	unsigned int i = 0;
+	unsigned int j = 0;
+	while (i < nA || j < nB)
+	{
+		const C2DPoint pt(A[i % nA].x + B[j % nB].x, A[i % nA].y + B[j % nB].y);
+
+		// Drops the middle of 3 points in line.
+		while (Result.size() >= 2)
+		{
+			const C2DPoint& p0 = Result[Result.size() - 2];
+			const C2DPoint& p1 = Result.back();
+			if ((p1.x - p0.x) * (pt.y - p0.y) - (p1.y - p0.y) * (pt.x - p0.x) != 0)
+				break;
+			Result.pop_back();
+		}
+		Result.push_back(pt);
+
+		if (i == nA)
+		{
+			j++;
+		}
+		else if (j == nB)
+		{
+			i++;
+		}
+		else
+		{
+			const C2DPoint& a0 = A[i];
+			const C2DPoint& a1 = A[(i + 1) % nA];
+			const C2DPoint& b0 = B[j];
+			const C2DPoint& b1 = B[(j + 1) % nB];
+			const double dCross = (a1.x - a0.x) * (b1.y - b0.y) - (a1.y - a0.y) * (b1.x - b0.x);
+			if (dCross > 0)
+				i++;
+			else if (dCross < 0)
+				j++;
+			else
+			{
+				i++;
+				j++;
+			}
+		}
+	}
+
+	// The last point may be in line with the first 2 or the first with the last 2.
+	while (Result.size() >= 3)
+	{
+		const C2DPoint& p0 = Result[Result.size() - 2];
+		const C2DPoint& p1 = Result.back();
+		const C2DPoint& p2 = Result[0];
+		if ((p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x) != 0)
+			break;
+		Result.pop_back();
+	}
+	while (Result.size() >= 3)
+	{
+		const C2DPoint& p0 = Result.back();
+		const C2DPoint& p1 = Result[0];
+		const C2DPoint& p2 = Result[1];
+		if ((p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x) != 0)
+			break;
+		Result.erase(Result.begin());
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetConvexPieces
+\brief Splits the polygon into convex point rings, reflected if required. A convex
+polygon is its own piece. False if it could not be split.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::GetConvexPieces(const C2DPolygon& Poly, bool bReflect,
+						vector< vector<C2DPoint> >& Pieces)
+{
+	if (Poly.GetPointsCount() < 3)
+		return false;
+
+	if (Poly.IsConvex())
+	{
+		Pieces.push_back(vector<C2DPoint>());
+		GetConvexPoints(Poly, bReflect, Pieces.back());
+		return true;
+	}
+
+	C2DPolygonSet Convex;
+	if (!CPolygonTriangulator::GetConvexPartition(Poly, Convex))
+		return false;
+
+	for (unsigned int i = 0; i < Convex.size(); i++)
+	{
+		Pieces.push_back(vector<C2DPoint>());
+		GetConvexPoints(Convex[i], bReflect, Pieces.back());
+	}
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CMinkowski::GetSum
+\brief Adds the sum of the polygons, the second reflected through the origin if
+required, to the set. Each convex piece of one is summed with each of the other and
+the sums are joined by the Boolean engine, which merges the points of different sums
+that differ only by rounding errors, e.g. from a part rotated by a quarter turn. False
+if either could not be split into convex pieces.
+<P>---------------------------------------------------------------------------*/
+bool CMinkowski::GetSum(const C2DPolygon& A, const C2DPolygon& B, bool bReflectB,
+						C2DHoledPolyBaseSet& Result)
+{
+	vector< vector<C2DPoint> > PiecesA, PiecesB;
+	if (!GetConvexPieces(A, false, PiecesA) || !GetConvexPieces(B, bReflectB, PiecesB))
+		return false;
+
+	vector<C2DPoint> Sum;
+	if (PiecesA.size() == 1 && PiecesB.size() == 1)
+	{
+		GetConvexSum(PiecesA[0], PiecesB[0], Sum);
+		if (Sum.size() >= 3)
+		{
+			C2DPolygon* pRim = new C2DPolygon;
+			pRim->Create(&Sum[0], Sum.size());
+			C2DHoledPolyBase* pShape = new C2DHoledPolyBase;
+			pShape->SetRimDirect(pRim);
+			Result.Add(pShape);
+		}
+		return true;
+	}
+
+	CPolygonBoolean Engine;
+	vector<double> Coords;
+	for (unsigned int a = 0; a < PiecesA.size(); a++)
+	{
+		for (unsigned int b = 0; b < PiecesB.size(); b++)
+		{
+			GetConvexSum(PiecesA[a], PiecesB[b], Sum);
+			if (Sum.size() < 3)
+				continue;
+
+			Coords.clear();
+			for (unsigned int i = 0; i < Sum.size(); i++)
+			{
+				Coords.push_back(Sum[i].x);
+				Coords.push_back(Sum[i].y);
+			}
+			Engine.AddSubject(Coords);
+		}
+	}
+
+	Engine.ExecutePositiveUnion(Result);
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::CNoFitPolygonCache
+\brief Constructor, with the distance within which parts are taken to touch.
+<P>---------------------------------------------------------------------------*/
+CNoFitPolygonCache::CNoFitPolygonCache(double dTolerance) : m_dTolerance(dTolerance)
+{
+	m_PartStarts.push_back(0);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::~CNoFitPolygonCache
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CNoFitPolygonCache::~CNoFitPolygonCache(void)
+{
+	Clear();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::AddPart
+\brief Adds a part, given about its reference point, which may take the number of
+orientations given equally spaced anticlockwise about it. Returns its index.
+<P>---------------------------------------------------------------------------*/
+unsigned int CNoFitPolygonCache::AddPart(const C2DPolygon& Part, unsigned int nOrientations)
+{
+	if (nOrientations == 0)
+		nOrientations = 1;
+
+	const C2DPoint Origin(0, 0);
+	for (unsigned int i = 0; i < nOrientations; i++)
+	{
+		C2DPolygon* pShape = new C2DPolygon(Part);
+		if (i != 0)
+			pShape->RotateToRight(-conTWOPI * i / nOrientations, Origin);
+		m_Shapes.push_back(pShape);
+	}
+	m_PartStarts.push_back(m_Shapes.size());
+
+	return m_PartStarts.size() - 2;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::GetNoFitPolygon
+\brief The no fit polygon of the moving part about the fixed, made if not already.
+<P>---------------------------------------------------------------------------*/
+const C2DHoledPolyBaseSet& CNoFitPolygonCache::GetNoFitPolygon(unsigned int nFixed,
+						unsigned int nFixedOrientation, unsigned int nMoving, unsigned int nMovingOrientation)
+{
+	assert(nFixedOrientation < GetOrientationCount(nFixed));
+	assert(nMovingOrientation < GetOrientationCount(nMoving));
+
+	const unsigned int nFixedShape = m_PartStarts[nFixed] + nFixedOrientation;
+	const unsigned int nMovingShape = m_PartStarts[nMoving] + nMovingOrientation;
+	const unsigned long long nKey = ((unsigned long long)nFixedShape << 32) | nMovingShape;
+
+	C2DHoledPolyBaseSet*& pResult = m_Cache[nKey];
+	if (pResult == 0)
+	{
+		pResult = new C2DHoledPolyBaseSet;
+		CMinkowski::GetNoFitPolygon(*m_Shapes[nFixedShape], *m_Shapes[nMovingShape], *pResult);
+	}
+	return *pResult;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::Overlaps
+\brief True if the parts overlap with their reference points at the positions given.
+Parts within the tolerance of touching do not overlap.
+<P>---------------------------------------------------------------------------*/
+bool CNoFitPolygonCache::Overlaps(unsigned int nFixed, unsigned int nFixedOrientation,
+						const C2DPoint& FixedPos, unsigned int nMoving, unsigned int nMovingOrientation,
+						const C2DPoint& MovingPos)
+{
+	const C2DHoledPolyBaseSet& NoFit = GetNoFitPolygon(nFixed, nFixedOrientation,
+						nMoving, nMovingOrientation);
+	const C2DPoint Relative(MovingPos.x - FixedPos.x, MovingPos.y - FixedPos.y);
+	return CMinkowski::IsInside(NoFit, Relative, m_dTolerance);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::Overlaps
+\brief True if the parts overlap and if so the shortest move of the moving part which
+leaves them touching. Exact for concave parts, unlike C2DPolygon::Overlaps.
+<P>---------------------------------------------------------------------------*/
+bool CNoFitPolygonCache::Overlaps(unsigned int nFixed, unsigned int nFixedOrientation,
+						const C2DPoint& FixedPos, unsigned int nMoving, unsigned int nMovingOrientation,
+						const C2DPoint& MovingPos, C2DVector& MinimumTranslationVector)
+{
+	const C2DHoledPolyBaseSet& NoFit = GetNoFitPolygon(nFixed, nFixedOrientation,
+						nMoving, nMovingOrientation);
+	const C2DPoint Relative(MovingPos.x - FixedPos.x, MovingPos.y - FixedPos.y);
+	return CMinkowski::GetExit(NoFit, Relative, m_dTolerance, MinimumTranslationVector);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::ClearCache
+\brief Drops the no fit polygons made, keeping the parts.
+<P>---------------------------------------------------------------------------*/
+void CNoFitPolygonCache::ClearCache(void)
+{
+	for (unordered_map<unsigned long long, C2DHoledPolyBaseSet*>::iterator it = m_Cache.begin();
+		it != m_Cache.end(); ++it)
+		delete it->second;
+	m_Cache.clear();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CNoFitPolygonCache::Clear
+\brief Drops everything.
+<P>---------------------------------------------------------------------------*/
+void CNoFitPolygonCache::Clear(void)
+{
+	ClearCache();
+	for (unsigned int i = 0; i < m_Shapes.size(); i++)
+		delete m_Shapes[i];
+	m_Shapes.clear();
+	m_PartStarts.assign(1, 0);
+}
@@ -0,0 +1,165 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Minkowski.h
+\brief Declaration file for the CMinkowski and CNoFitPolygonCache classes.
+
+Declaration file for CMinkowski, which makes Minkowski sums, differences and no fit
+polygons of polygons, and CNoFitPolygonCache which keeps the no fit polygons of a set
+of parts so that placing one part against another is a point in polygon test.
+
+\class CMinkowski
+\brief Minkowski sums, differences and no fit polygons of polygons.
+
+The sum of 2 convex polygons is made in one pass by merging their edges in order of
+angle, so it takes time in proportion to the number of points of both. Concave
+polygons are split into convex pieces by CPolygonTriangulator, the pieces are summed
+in pairs and the sums are joined by the Boolean engine, so the result may have holes.
+
+The difference A - B is the sum of A and B reflected through the origin. It holds
+every vector from a point of B to a point of A so the polygons overlap if and only if
+the origin is inside it, and the nearest point of its boundary to the origin is the
+shortest move of B which separates them.
+
+The no fit polygon of a moving part about a fixed one, both given about their own
+reference points, is the difference of the fixed and the moving. The parts overlap
+if and only if the position of the moving reference point relative to the fixed is
+inside it and touch if it is on the boundary.
+
+\class CNoFitPolygonCache
+\brief Keeps the no fit polygons of a set of parts in several orientations.
+
+Each part is added once with the number of orientations it may take. The no fit
+polygon of a pair of parts in a pair of orientations is made the first time it is
+needed and kept, so in a nesting or packing loop each placement test is a bounding
+rectangle and point in polygon test:
+
+	CNoFitPolygonCache Cache;
+	unsigned int nSheet = Cache.AddPart(Sheet);
+	unsigned int nPart = Cache.AddPart(Part, 4);
+	...
+	if (!Cache.Overlaps(nPlaced, nPlacedOrientation, PlacedPos, nPart, 2, TryPos))
+		...
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CMINKOWSKI_H
+#define _GEOLIB_CMINKOWSKI_H
+
+#include "C2DPoint.h"
+#include "C2DVector.h"
+#include "Constants.h"
+#include <vector>
+#include <unordered_map>
+
+class C2DPolygon;
+class C2DPolygonSet;
+class C2DHoledPolyBase;
+class C2DHoledPolyBaseSet;
+
+class GeoLib_API CMinkowski
+{
+public:
+	/// Makes the sum of 2 convex polygons. False if either has fewer than 3 points.
+	static bool GetConvexSum(const C2DPolygon& A, const C2DPolygon& B, C2DPolygon& Result);
+	/// Adds the sum of the polygons, convex or not, to the set. False if either could
+	/// not be split into convex pieces.
+	static bool GetSum(const C2DPolygon& A, const C2DPolygon& B, C2DHoledPolyBaseSet& Result);
+	/// Adds the difference of the polygons, the sum of A and B reflected, to the set.
+	static bool GetDifference(const C2DPolygon& A, const C2DPolygon& B, C2DHoledPolyBaseSet& Result);
+	/// Adds the no fit polygon of the moving part about the fixed to the set.
+	static bool GetNoFitPolygon(const C2DPolygon& Fixed, const C2DPolygon& Moving,
+						C2DHoledPolyBaseSet& Result);
+
+	/// True if the point is inside the shapes by more than the tolerance.
+	static bool IsInside(const C2DHoledPolyBaseSet& Shapes, const C2DPoint& pt, double dTolerance);
+	/// True if the point is inside the shapes by more than the tolerance and if so the
+	/// shortest vector which moves it onto their boundary.
+	static bool GetExit(const C2DHoledPolyBaseSet& Shapes, const C2DPoint& pt,
+						double dTolerance, C2DVector& Result);
+
+private:
+	/// Constructor, not used.
+	CMinkowski(void);
+
+	/// The points of the polygon anticlockwise from the lowest, reflected if required.
+	static void GetConvexPoints(const C2DPolygon& Poly, bool bReflect, std::vector<C2DPoint>& Points);
+	/// Adds the sum of the polygons, convex or not, to the set, the second reflected if required.
+	static bool GetSum(const C2DPolygon& A, const C2DPolygon& B, bool bReflectB,
+						C2DHoledPolyBaseSet& Result);
+	/// The index of the shape the point is inside by more than the tolerance, -1 if none.
+	static int FindInside(const C2DHoledPolyBaseSet& Shapes, const C2DPoint& pt, double dTolerance);
+	/// Makes the sum of 2 convex point rings from GetConvexPoints.
+	static void GetConvexSum(const std::vector<C2DPoint>& A, const std::vector<C2DPoint>& B,
+						std::vector<C2DPoint>& Result);
+	/// Splits the polygon into convex point rings, reflected if required.
+	static bool GetConvexPieces(const C2DPolygon& Poly, bool bReflect,
+						std::vector< std::vector<C2DPoint> >& Pieces);
+};
+
+
+class GeoLib_API CNoFitPolygonCache
+{
+public:
+	/// Constructor, with the distance within which parts are taken to touch.
+	CNoFitPolygonCache(double dTolerance = conEqualityTolerance);
+	/// Destructor.
+	~CNoFitPolygonCache(void);
+
+	/// Sets the distance within which parts are taken to touch.
+	void SetTolerance(double dTolerance) {m_dTolerance = dTolerance;}
+	/// The distance within which parts are taken to touch.
+	double GetTolerance(void) const {return m_dTolerance;}
+
+	/// Adds a part, given about its reference point, which may take the number of
+	/// orientations given equally spaced anticlockwise about it. Returns its index.
+	unsigned int AddPart(const C2DPolygon& Part, unsigned int nOrientations = 1);
+	/// The number of parts.
+	unsigned int GetPartCount(void) const {return m_PartStarts.size() - 1;}
+	/// The number of orientations of the part.
+	unsigned int GetOrientationCount(unsigned int nPart) const
+		{return m_PartStarts[nPart + 1] - m_PartStarts[nPart];}
+	/// The part in the orientation given, about its reference point.
+	const C2DPolygon& GetPart(unsigned int nPart, unsigned int nOrientation) const
+		{return *m_Shapes[m_PartStarts[nPart] + nOrientation];}
+
+	/// The no fit polygon of the moving part about the fixed, made if not already.
+	const C2DHoledPolyBaseSet& GetNoFitPolygon(unsigned int nFixed, unsigned int nFixedOrientation,
+						unsigned int nMoving, unsigned int nMovingOrientation);
+	/// True if the parts overlap with their reference points at the positions given.
+	bool Overlaps(unsigned int nFixed, unsigned int nFixedOrientation, const C2DPoint& FixedPos,
+						unsigned int nMoving, unsigned int nMovingOrientation, const C2DPoint& MovingPos);
+	/// True if the parts overlap and if so the shortest move of the moving part which
+	/// leaves them touching.
+	bool Overlaps(unsigned int nFixed, unsigned int nFixedOrientation, const C2DPoint& FixedPos,
+						unsigned int nMoving, unsigned int nMovingOrientation, const C2DPoint& MovingPos,
+						C2DVector& MinimumTranslationVector);
+
+	/// The number of no fit polygons made.
+	unsigned int GetCachedCount(void) const {return m_Cache.size();}
+	/// Drops the no fit polygons made, keeping the parts.
+	void ClearCache(void);
+	/// Drops everything.
+	void Clear(void);
+
+private:
+	/// The tolerance.
+	double m_dTolerance;
+	/// The parts in each orientation.
+	std::vector<C2DPolygon*> m_Shapes;
+	/// The index of the first shape of each part, followed by the number of shapes.
+	std::vector<unsigned int> m_PartStarts;
+	/// The no fit polygons made, by fixed and moving shape index.
+	std::unordered_map<unsigned long long, C2DHoledPolyBaseSet*> m_Cache;
+
+	/// No copying.
+	CNoFitPolygonCache(const CNoFitPolygonCache& Other);
+	/// No assignment.
+	void operator=(const CNoFitPolygonCache& Other);
+};
+
+#endif
@@ -0,0 +1,278 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PointKdTree.cpp
+\brief Implementation file for the CPointKdTree class.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "PointKdTree.h"
+#include <limits>
+
+using namespace std;
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::CPointKdTree
+\brief Constructor. Builds the tree.
+<P>---------------------------------------------------------------------------*/
+CPointKdTree::CPointKdTree(const vector<sKdPoint>& Points) : m_Points(Points)
+{
+	unsigned int nSize = Points.size();
+	m_Index.resize(nSize);
+	for (unsigned int i = 0 ; i < nSize; i++)
+		m_Index[i] = i;
+	m_Axis.resize(nSize, 0);
+	m_Remaining.resize(nSize, 0);
+	m_Removed.resize(nSize, false);
+
+	Build(0, nSize);
+
+	m_Position.resize(nSize);
+	for (unsigned int i = 0 ; i < nSize; i++)
+		m_Position[m_Index[i]] = i;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::Build
+\brief Builds the range splitting on the axis of greatest extent.
+<P>---------------------------------------------------------------------------*/
+void CPointKdTree::Build(unsigned int lo, unsigned int hi)
+{
+	if (lo >= hi)
+		return;
+
+	double dMinX = m_Points[m_Index[lo]].x;
+	double dMaxX = dMinX;
+	double dMinY = m_Points[m_Index[lo]].y;
+	double dMaxY = dMinY;
+	for (unsigned int i = lo + 1 ; i < hi; i++)
+	{
+		const sKdPoint& Pt = m_Points[m_Index[i]];
+		dMinX = min(dMinX, Pt.x);
+		dMaxX = max(dMaxX, Pt.x);
+		dMinY = min(dMinY, Pt.y);
+		dMaxY = max(dMaxY, Pt.y);
+	}
+	const unsigned char nAxis = (dMaxX - dMinX >= dMaxY - dMinY) ? 0 : 1;
+
+	unsigned int mid = (lo + hi) / 2;
+	nth_element(m_Index.begin() + lo, m_Index.begin() + mid, m_Index.begin() + hi,
+		[this, nAxis](unsigned int a, unsigned int b) { return Coord(a, nAxis) < Coord(b, nAxis); });
+
+	m_Axis[mid] = nAxis;
+	m_Remaining[mid] = hi - lo;
+
+	Build(lo, mid);
+	Build(mid + 1, hi);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::GetNearest
+\brief Finds the nearest other point to the point and its distance, -1 if there
+is none.
+<P>---------------------------------------------------------------------------*/
+int CPointKdTree::GetNearest(unsigned int nPoint, double& dDist) const
+{
+	double dBest = numeric_limits<double>::max();
+	int nBest = -1;
+	SearchNearest(0, m_Index.size(), nPoint, dBest, nBest);
+	dDist = nBest < 0 ? 0 : sqrt(dBest);
+	return nBest;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::SearchNearest
+\brief Searches the range for a point nearer the point than the best so far.
+<P>---------------------------------------------------------------------------*/
+void CPointKdTree::SearchNearest(unsigned int lo, unsigned int hi, unsigned int nPoint,
+								 double& dBest, int& nBest) const
+{
+	if (lo >= hi)
+		return;
+
+	unsigned int mid = (lo + hi) / 2;
+	unsigned int nNode = m_Index[mid];
+	const sKdPoint& Pt = m_Points[nPoint];
+
+	if (nNode != nPoint)
+	{
+		double dx = m_Points[nNode].x - Pt.x;
+		double dy = m_Points[nNode].y - Pt.y;
+		double dDist = dx * dx + dy * dy;
+		if (dDist < dBest)
+		{
+			dBest = dDist;
+			nBest = nNode;
+		}
+	}
+
+	double dSplit = Coord(nPoint, m_Axis[mid]) - Coord(nNode, m_Axis[mid]);
+	if (dSplit < 0)
+	{
+		SearchNearest(lo, mid, nPoint, dBest, nBest);
+		if (dSplit * dSplit < dBest)
+			SearchNearest(mid + 1, hi, nPoint, dBest, nBest);
+	}
+	else
+	{
+		SearchNearest(mid + 1, hi, nPoint, dBest, nBest);
+		if (dSplit * dSplit < dBest)
+			SearchNearest(lo, mid, nPoint, dBest, nBest);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::GetNearest
+\brief Finds the k nearest other points to the point, closest first.
+<P>---------------------------------------------------------------------------*/
+void CPointKdTree::GetNearest(unsigned int nPoint, unsigned int k, unsigned int* pResult) const
+{
+	vector< pair<double, unsigned int> > Heap;
+	Heap.reserve(k + 1);
+	SearchNearest(0, m_Index.size(), nPoint, k, Heap);
+
+	sort_heap(Heap.begin(), Heap.end());
+	for (unsigned int i = 0 ; i < Heap.size(); i++)
+		pResult[i] = Heap[i].second;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::SearchNearest
+\brief Adds the points in the range to the max heap of the k nearest.
+<P>---------------------------------------------------------------------------*/
+void CPointKdTree::SearchNearest(unsigned int lo, unsigned int hi, unsigned int nPoint, unsigned int k,
+								vector< pair<double, unsigned int> >& Heap) const
+{
+	if (lo >= hi)
+		return;
+
+	unsigned int mid = (lo + hi) / 2;
+	unsigned int nNode = m_Index[mid];
+	const sKdPoint& Pt = m_Points[nPoint];
+
+	if (nNode != nPoint)
+	{
+		double dx = m_Points[nNode].x - Pt.x;
+		double dy = m_Points[nNode].y - Pt.y;
+		double dDist = dx * dx + dy * dy;
+		if (Heap.size() < k)
+		{
+			Heap.push_back(make_pair(dDist, nNode));
+			push_heap(Heap.begin(), Heap.end());
+		}
+		else if (dDist < Heap.front().first)
+		{
+			pop_heap(Heap.begin(), Heap.end());
+			Heap.back() = make_pair(dDist, nNode);
+			push_heap(Heap.begin(), Heap.end());
+		}
+	}
+
+	double dSplit = Coord(nPoint, m_Axis[mid]) - Coord(nNode, m_Axis[mid]);
+	if (dSplit < 0)
+	{
+		SearchNearest(lo, mid, nPoint, k, Heap);
+		if (Heap.size() < k || dSplit * dSplit < Heap.front().first)
+			SearchNearest(mid + 1, hi, nPoint, k, Heap);
+	}
+	else
+	{
+		SearchNearest(mid + 1, hi, nPoint, k, Heap);
+		if (Heap.size() < k || dSplit * dSplit < Heap.front().first)
+			SearchNearest(lo, mid, nPoint, k, Heap);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::GetNearestRemaining
+\brief Finds the nearest point which has not been removed, -1 if there are none.
+<P>---------------------------------------------------------------------------*/
+int CPointKdTree::GetNearestRemaining(double x, double y) const
+{
+	double dBest = numeric_limits<double>::max();
+	int nBest = -1;
+	SearchRemaining(0, m_Index.size(), x, y, dBest, nBest);
+	return nBest;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::SearchRemaining
+\brief Searches the range for a nearer remaining point, skipping empty ranges.
+<P>---------------------------------------------------------------------------*/
+void CPointKdTree::SearchRemaining(unsigned int lo, unsigned int hi, double x, double y,
+								  double& dBest, int& nBest) const
+{
+	if (lo >= hi)
+		return;
+
+	unsigned int mid = (lo + hi) / 2;
+	if (m_Remaining[mid] == 0)
+		return;
+
+	unsigned int nNode = m_Index[mid];
+	if (!m_Removed[mid])
+	{
+		double dx = m_Points[nNode].x - x;
+		double dy = m_Points[nNode].y - y;
+		double dDist = dx * dx + dy * dy;
+		if (dDist < dBest)
+		{
+			dBest = dDist;
+			nBest = nNode;
+		}
+	}
+
+	double dSplit = (m_Axis[mid] == 0 ? x : y) - Coord(nNode, m_Axis[mid]);
+	if (dSplit < 0)
+	{
+		SearchRemaining(lo, mid, x, y, dBest, nBest);
+		if (dSplit * dSplit < dBest)
+			SearchRemaining(mid + 1, hi, x, y, dBest, nBest);
+	}
+	else
+	{
+		SearchRemaining(mid + 1, hi, x, y, dBest, nBest);
+		if (dSplit * dSplit < dBest)
+			SearchRemaining(lo, mid, x, y, dBest, nBest);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPointKdTree::Remove
+\brief Removes the point, updating the counts on the way down to its node.
+<P>---------------------------------------------------------------------------*/
+void CPointKdTree::Remove(unsigned int nPoint)
+{
+	unsigned int nPos = m_Position[nPoint];
+	if (m_Removed[nPos])
+		return;
+
+	unsigned int lo = 0;
+	unsigned int hi = m_Index.size();
+	while (lo < hi)
+	{
+		unsigned int mid = (lo + hi) / 2;
+		m_Remaining[mid]--;
+		if (nPos == mid)
+			break;
+		if (nPos < mid)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	m_Removed[nPos] = true;
+}
@@ -0,0 +1,92 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PointKdTree.h
+\brief Declaration file for the CPointKdTree class.
+
+\class CPointKdTree
+\brief A 2D kd-tree for nearest point queries on an array of points.
+
+The tree is held as a permutation of the point indices. The node of the range
+[lo, hi) is the point in the middle and it splits the range on the axis stored 
+for it. Points can be removed, which is used to build nearest neighbour routes.
+The array of points must stay the same while the tree is used. Queries which do 
+not remove points can be made from several threads at once.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CPOINTKDTREE_H
+#define _GEOLIB_CPOINTKDTREE_H
+
+#include "StdAfx.h"
+
+/**--------------------------------------------------------------------------<BR>
+struct sKdPoint
+\brief A plain point held in the array used by the tree.
+<P>---------------------------------------------------------------------------*/
+struct sKdPoint
+{
+	double x;
+	double y;
+};
+
+
+class GeoLib_API CPointKdTree
+{
+public:
+	/// Constructor, builds the tree.
+	CPointKdTree(const std::vector<sKdPoint>& Points);
+	/// Destructor.
+	~CPointKdTree(void) {;}
+
+	/// Finds the nearest other point to the point, -1 if there is none.
+	int GetNearest(unsigned int nPoint, double& dDist) const;
+	/// Finds the k nearest other points to the point, closest first.
+	void GetNearest(unsigned int nPoint, unsigned int k, unsigned int* pResult) const;
+	/// Finds the nearest point remaining, -1 if there are none.
+	int GetNearestRemaining(double x, double y) const;
+	/// Removes the point from the nearest remaining search.
+	void Remove(unsigned int nPoint);
+	/// Returns the point at the position in tree order, where neighbours are close.
+	unsigned int GetPointInTreeOrder(unsigned int nPosition) const {return m_Index[nPosition];}
+
+private:
+	/// Not copyable.
+	CPointKdTree(const CPointKdTree&);
+	/// Not copyable.
+	CPointKdTree& operator=(const CPointKdTree&);
+
+	/// Builds the range.
+	void Build(unsigned int lo, unsigned int hi);
+	/// Searches the range for a point nearer the point than the best.
+	void SearchNearest(unsigned int lo, unsigned int hi, unsigned int nPoint, 
+					   double& dBest, int& nBest) const;
+	/// Adds the points in the range to the heap of the k nearest.
+	void SearchNearest(unsigned int lo, unsigned int hi, unsigned int nPoint, unsigned int k, 
+					   std::vector< std::pair<double, unsigned int> >& Heap) const;
+	/// Searches the range for a remaining point nearer the position than the best.
+	void SearchRemaining(unsigned int lo, unsigned int hi, double x, double y, 
+						 double& dBest, int& nBest) const;
+	/// Returns the x or y of the point.
+	double Coord(unsigned int nPoint, unsigned char nAxis) const 
+		{ return nAxis == 0 ? m_Points[nPoint].x : m_Points[nPoint].y; }
+
+	/// The points.
+	const std::vector<sKdPoint>& m_Points;
+	/// The point indices in tree order.
+	std::vector<unsigned int> m_Index;
+	/// The position of each point in m_Index.
+	std::vector<unsigned int> m_Position;
+	/// The split axis of each node.
+	std::vector<unsigned char> m_Axis;
+	/// The number of points remaining in the range of each node.
+	std::vector<unsigned int> m_Remaining;
+	/// True if the point of the node has been removed.
+	std::vector<bool> m_Removed;
+};
+
+#endif
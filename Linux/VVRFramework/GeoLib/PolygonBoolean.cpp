@@ -0,0 +1,1646 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PolygonBoolean.cpp
+\brief Implementation file for the CPolygonBoolean class.
+
+Implementation file for CPolygonBoolean, a sweep line polygon Boolean engine based
+on F. Martinez, C. Ogayar, J. R. Jimenez and A. J. Rueda, "A simple algorithm for
+Boolean operations on polygons" (2013).
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "PolygonBoolean.h"
+#include "Predicates.h"
+#include "C2DPolyBase.h"
+#include "C2DHoledPolyBase.h"
+#include "C2DHoledPolyBaseSet.h"
+#include "C2DLineBaseSet.h"
+#include "C2DLine.h"
+#include "ArcFlattener.h"
+#include <deque>
+#include <queue>
+#include <set>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+/**--------------------------------------------------------------------------<BR>
+struct sBoolPoint
+\brief A plain point used by the engine.
+<P>---------------------------------------------------------------------------*/
+struct sBoolPoint
+{
+	double x;
+	double y;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+class CBooleanContours
+\brief The contours of the subject and clip, each a closed ring of points. Arcs are
+flattened by Arcs if its tolerance is above 0.
+<P>---------------------------------------------------------------------------*/
+class CBooleanContours
+{
+public:
+	/// Adds the points of the polygon as a new contour.
+	void Add(const C2DPolyBase& Poly, bool bSubject)
+	{
+		unsigned int nLines = Poly.GetLineCount();
+		const bool bFlatten = Arcs.GetTolerance() > 0 && Poly.HasArcs();
+		if (nLines == 0 || (nLines < 3 && !bFlatten))
+			return;
+
+		vector<sBoolPoint>& Contour = bSubject ? NewSubject() : NewClip();
+		if (bFlatten)
+		{
+			vector<C2DPoint> Points;
+			Arcs.Add(Poly, Points);
+			Contour.resize(Points.size());
+			for (unsigned int i = 0; i < Points.size(); i++)
+			{
+				Contour[i].x = Points[i].x;
+				Contour[i].y = Points[i].y;
+			}
+			return;
+		}
+
+		Contour.reserve(nLines);
+		for (unsigned int i = 0; i < nLines; i++)
+		{
+			// Use the start points only so that the ring closes exactly.
+			C2DPoint pt = Poly.GetLine(i)->GetPointFrom();
+			sBoolPoint Pt = { pt.x, pt.y };
+			Contour.push_back(Pt);
+		}
+	}
+	/// Adds the rim and holes as new contours.
+	void Add(const C2DHoledPolyBase& Poly, bool bSubject)
+	{
+		if (Poly.GetRim() != 0)
+			Add(*Poly.GetRim(), bSubject);
+		for (unsigned int i = 0; i < Poly.GetHoleCount(); i++)
+			Add(*Poly.GetHole(i), bSubject);
+	}
+
+	vector<sBoolPoint>& NewSubject(void) { Subject.push_back(vector<sBoolPoint>()); return Subject.back(); }
+	vector<sBoolPoint>& NewClip(void) { Clip.push_back(vector<sBoolPoint>()); return Clip.back(); }
+
+	/// The subject contours.
+	vector< vector<sBoolPoint> > Subject;
+	/// The clip contours.
+	vector< vector<sBoolPoint> > Clip;
+	/// The arcs of the shapes added, if flattened.
+	CArcFlattener Arcs;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+enum eEdgeType
+\brief The classification of an edge with respect to coincident edges.
+<P>---------------------------------------------------------------------------*/
+enum eEdgeType
+{
+	Normal,
+	NonContributing,
+	SameTransition,
+	DifferentTransition,
+};
+
+struct sSweepEvent;
+
+/**--------------------------------------------------------------------------<BR>
+struct sSegmentLess
+\brief Orders the segments in the sweep line from bottom to top.
+<P>---------------------------------------------------------------------------*/
+struct sSegmentLess
+{
+	bool operator()(const sSweepEvent* pLE1, const sSweepEvent* pLE2) const;
+};
+
+typedef set<sSweepEvent*, sSegmentLess> CStatusLine;
+
+/**--------------------------------------------------------------------------<BR>
+struct sSweepEvent
+\brief An end point of an edge. The left event is the first to be swept.
+<P>---------------------------------------------------------------------------*/
+struct sSweepEvent
+{
+	/// The point.
+	double x;
+	double y;
+	/// True if this is the left end of the edge.
+	bool bLeft;
+	/// True if the edge belongs to the subject.
+	bool bSubject;
+	/// The event at the other end of the edge.
+	sSweepEvent* pOther;
+	/// The coincident edge classification.
+	eEdgeType eType;
+	/// True if the edge is an inside-outside transition of its own polygon (looking up).
+	bool bInOut;
+	/// True if the edge is an inside-outside transition of the other polygon.
+	bool bOtherInOut;
+	/// The closest edge below this which is in the result.
+	sSweepEvent* pPrevInResult;
+	/// +1 if the area above the edge is in the result, -1 if below, 0 if not in the result.
+	int nResultTransition;
+	/// The index of the input contour.
+	unsigned int nContourId;
+	/// For the positive union, the change in the winding count crossing the edge upwards,
+	/// which is 1 if the contour runs from left to right along the edge and -1 if not.
+	int nWind;
+	/// For the positive union, the winding count just above the edge or, if vertical, to
+	/// its right.
+	int nWindAbove;
+	/// The index of the output contour.
+	int nOutputContourId;
+	/// The index in the result events.
+	unsigned int nPos;
+	/// Unique creation index used to make the ordering total.
+	unsigned int nId;
+	/// True whilst in the sweep line.
+	bool bInStatus;
+	/// The position in the sweep line.
+	CStatusLine::iterator PosSL;
+	/// The ends of the input edge this is part of, in the direction of this edge. The end
+	/// points made by splitting an edge are rounded so the side tests use the input edge.
+	sBoolPoint LineLeft;
+	sBoolPoint LineRight;
+
+	/// True if the edge is part of the result.
+	bool InResult(void) const { return nResultTransition != 0; }
+	/// True if the edge is vertical.
+	bool IsVertical(void) const { return x == pOther->x; }
+	/// Positive if the point is above the input edge, negative if below and zero if on it.
+	double Side(double px, double py) const
+	{
+		return GeoPredicates::Orient2D(LineLeft.x, LineLeft.y, LineRight.x, LineRight.y, px, py);
+	}
+	/// Positive if the event point is above the input edge, negative if below and zero if on it.
+	double Side(const sSweepEvent* pEvent) const { return Side(pEvent->x, pEvent->y); }
+	/// True if the edge is below the point.
+	bool IsBelow(double px, double py) const { return Side(px, py) > 0; }
+	/// True if the events are at the same point.
+	bool SamePoint(const sSweepEvent* pOtherEvent) const { return x == pOtherEvent->x && y == pOtherEvent->y; }
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+SignedArea <BR>
+\brief Orientation of the 3 event points. Exact sign.
+<P>---------------------------------------------------------------------------*/
+static inline double SignedArea(const sSweepEvent* p0, const sSweepEvent* p1, const sSweepEvent* p2)
+{
+	return GeoPredicates::Orient2D(p0->x, p0->y, p1->x, p1->y, p2->x, p2->y);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+IsCollinear <BR>
+\brief True if the 2 edges are part of input edges on the same line, or themselves lie
+on one line as pieces of different input edges split at the same points can.
+<P>---------------------------------------------------------------------------*/
+static inline bool IsCollinear(const sSweepEvent* e1, const sSweepEvent* e2)
+{
+	if (e1->Side(e2->LineLeft.x, e2->LineLeft.y) == 0 && e1->Side(e2->LineRight.x, e2->LineRight.y) == 0)
+		return true;
+	return SignedArea(e1, e1->pOther, e2) == 0 && SignedArea(e1, e1->pOther, e2->pOther) == 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+WithinEdge <BR>
+\brief True if the point, which is on the input line of the edge, is within the part
+of the line the edge covers. Split points are rounded so a point on the line can lie
+just beyond the end of an edge split near it.
+<P>---------------------------------------------------------------------------*/
+static inline bool WithinEdge(const sSweepEvent* pLE, const sSweepEvent* pPoint)
+{
+	// The offsets from the ends are taken first so that a point within a rounding error
+	// of an end is still placed on the correct side of it.
+	const double dx = pLE->LineRight.x - pLE->LineLeft.x;
+	const double dy = pLE->LineRight.y - pLE->LineLeft.y;
+	const double dFromStart = (pPoint->x - pLE->x) * dx + (pPoint->y - pLE->y) * dy;
+	const double dFromEnd = (pPoint->x - pLE->pOther->x) * dx + (pPoint->y - pLE->pOther->y) * dy;
+	return (dFromStart >= 0 && dFromEnd <= 0) || (dFromStart <= 0 && dFromEnd >= 0);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CompareFromSamePoint <BR>
+\brief Returns -1 if the edge of le1 is below that of le2 where both events are at the
+same point and the edges are not collinear. Split edges follow their input lines so
+the other point of each can lie on the line of the other. The earlier edge is
+therefore always the one tested against so that the order is the same both ways round.
+<P>---------------------------------------------------------------------------*/
+static int CompareFromSamePoint(const sSweepEvent* le1, const sSweepEvent* le2)
+{
+	if (le1->nId > le2->nId)
+		return -CompareFromSamePoint(le2, le1);
+
+	double dSide = le1->Side(le2->pOther);
+	if (dSide == 0)
+		dSide = -le2->Side(le1->pOther);
+	return dSide < 0 ? 1 : -1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CompareEvents <BR>
+\brief Returns 1 if e1 should be processed after e2, -1 otherwise.
+<P>---------------------------------------------------------------------------*/
+static int CompareEvents(const sSweepEvent* e1, const sSweepEvent* e2)
+{
+	if (e1 == e2)
+		return 0;
+	// Different x coordinate
+	if (e1->x > e2->x)
+		return 1;
+	if (e1->x < e2->x)
+		return -1;
+	// Different points, but same x coordinate. The event with lower y is processed first.
+	if (e1->y != e2->y)
+		return e1->y > e2->y ? 1 : -1;
+	// Same point, but one is a left endpoint and the other a right endpoint. The right is processed first.
+	if (e1->bLeft != e2->bLeft)
+		return e1->bLeft ? 1 : -1;
+	// Same point, both events are left or right endpoints. Not collinear. The lower is processed first.
+	if (!IsCollinear(e1, e2))
+		return CompareFromSamePoint(e1, e2);
+	// Collinear. The clip is processed after the subject.
+	if (e1->bSubject != e2->bSubject)
+		return e1->bSubject ? -1 : 1;
+
+	return e1->nId > e2->nId ? 1 : -1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+SideOfEdge <BR>
+\brief Returns 1 if the edge of pLE2 lies strictly above the input line of pLE1, -1 if
+strictly below and 0 if it crosses or touches the line.
+<P>---------------------------------------------------------------------------*/
+static int SideOfEdge(const sSweepEvent* pLE1, const sSweepEvent* pLE2)
+{
+	const double d1 = pLE1->Side(pLE2);
+	const double d2 = pLE1->Side(pLE2->pOther);
+	if (d1 > 0 && d2 > 0)
+		return 1;
+	if (d1 < 0 && d2 < 0)
+		return -1;
+	return 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CompareSegments <BR>
+\brief Returns -1 if le1 is below le2 in the sweep line, 1 if above.
+<P>---------------------------------------------------------------------------*/
+static int CompareSegments(const sSweepEvent* le1, const sSweepEvent* le2)
+{
+	if (le1 == le2)
+		return 0;
+
+	// Segments are not collinear
+	if (!IsCollinear(le1, le2))
+	{
+		// If they share their left endpoint use the right endpoint to sort
+		if (le1->SamePoint(le2))
+			return CompareFromSamePoint(le1, le2);
+		// Different left endpoint: use the left endpoint to sort
+		if (le1->x == le2->x)
+			return le1->y < le2->y ? -1 : 1;
+		// Edges which do not cross are in the same order all along. One of them then lies
+		// on one side of the line of the other, which holds even if a split point near
+		// the other line has been rounded across it. The later edge is tested first so
+		// that the order is the same both ways round.
+		const bool bLater = CompareEvents(le1, le2) == 1;
+		const sSweepEvent* pEarlier = bLater ? le2 : le1;
+		const sSweepEvent* pLater = bLater ? le1 : le2;
+		int nSide = SideOfEdge(pEarlier, pLater);
+		if (nSide == 0)
+			nSide = -SideOfEdge(pLater, pEarlier);
+		if (nSide != 0)
+			return bLater ? nSide : -nSide;
+		// Has the line segment associated to e1 been inserted into S after the line segment associated to e2?
+		// If the left end point lies on the other edge use the right end point.
+		// If it lies on the line of the other edge but beyond its right end use the y coordinate.
+		if (CompareEvents(le1, le2) == 1)
+		{
+			double dSide = le2->Side(le1);
+			if (dSide == 0)
+				dSide = WithinEdge(le2, le1) ? le2->Side(le1->pOther) : le1->y - le2->pOther->y;
+			return dSide > 0 ? 1 : -1;
+		}
+		// The line segment associated to e2 has been inserted into S after the line segment associated to e1
+		double dSide = le1->Side(le2);
+		if (dSide == 0)
+			dSide = WithinEdge(le1, le2) ? le1->Side(le2->pOther) : le2->y - le1->pOther->y;
+		return dSide > 0 ? -1 : 1;
+	}
+
+	// Segments are collinear
+	if (le1->bSubject == le2->bSubject)
+	{
+		if (le1->SamePoint(le2))
+		{
+			if (le1->nContourId != le2->nContourId)
+				return le1->nContourId > le2->nContourId ? 1 : -1;
+			return le1->nId > le2->nId ? 1 : -1;
+		}
+	}
+	else
+	{
+		return le1->bSubject ? -1 : 1;
+	}
+
+	// Pieces of the same line only meet beyond each other's ends due to rounding.
+	if (CompareEvents(le1, le2) == 1)
+		return (WithinEdge(le2, le1) || le1->y > le2->pOther->y) ? 1 : -1;
+	return (WithinEdge(le1, le2) || le2->y > le1->pOther->y) ? -1 : 1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+sSegmentLess::operator()
+\brief Orders the segments in the sweep line.
+<P>---------------------------------------------------------------------------*/
+bool sSegmentLess::operator()(const sSweepEvent* pLE1, const sSweepEvent* pLE2) const
+{
+	return CompareSegments(pLE1, pLE2) < 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+struct sEventGreater
+\brief Orders the event queue so that the first to be processed is on top.
+<P>---------------------------------------------------------------------------*/
+struct sEventGreater
+{
+	bool operator()(const sSweepEvent* e1, const sSweepEvent* e2) const
+	{
+		return CompareEvents(e1, e2) > 0;
+	}
+};
+
+typedef priority_queue<sSweepEvent*, vector<sSweepEvent*>, sEventGreater> CEventQueue;
+
+
+/**--------------------------------------------------------------------------<BR>
+class CSweep
+\brief The state of a single Boolean operation.
+<P>---------------------------------------------------------------------------*/
+class CSweep
+{
+public:
+	CSweep(CPolygonBoolean::eOperation eOp, bool bPositive = false) : m_eOp(eOp), m_bPositive(bPositive), m_pCurrent(0) {;}
+
+	/// Runs the operation.
+	void Run(const CBooleanContours& Contours, C2DHoledPolyBaseSet& Result);
+
+private:
+	/// Creates a new event.
+	sSweepEvent* NewEvent(double x, double y, bool bLeft, sSweepEvent* pOther, bool bSubject);
+	/// Adds the edges of the contour to the queue.
+	void ProcessContour(const vector<sBoolPoint>& Contour, bool bSubject, unsigned int nContourId,
+						double* dBox);
+	/// Sets the inside / outside flags of the event from the edge below.
+	void ComputeFields(sSweepEvent* pEvent, sSweepEvent* pPrev) const;
+	/// Sets the winding counts of the event from the edge below for the positive union.
+	void ComputeWinding(sSweepEvent* pEvent, sSweepEvent* pPrev) const;
+	/// Gives the winding of all the coincident edges to the lowest for the positive union.
+	void MergeCoincident(sSweepEvent* pLE);
+	/// True if the edge is part of the result.
+	bool InResult(const sSweepEvent* pEvent) const;
+	/// Returns the direction of the result area across the edge.
+	int DetermineResultTransition(const sSweepEvent* pEvent) const;
+	/// Finds and handles any intersection between the 2 edges.
+	int PossibleIntersection(sSweepEvent* pSE1, sSweepEvent* pSE2);
+	/// Splits the edge at the point given.
+	void DivideSegment(sSweepEvent* pSE, double x, double y);
+	/// Moves a point behind the sweep line to the point of the current event.
+	void KeepAhead(double& x, double& y) const;
+	/// Finds the input points to merge with others.
+	void MergeNearPoints(const CBooleanContours& Contours);
+	/// Returns the point the input point is merged with.
+	sBoolPoint Merged(const sBoolPoint& Pt) const;
+	/// Connects the result edges into contours and adds them to the result.
+	void ConnectEdges(C2DHoledPolyBaseSet& Result);
+
+	/// The operation.
+	CPolygonBoolean::eOperation m_eOp;
+	/// True for the positive union of the subject.
+	bool m_bPositive;
+	/// The event being processed. No edge is split behind its point.
+	const sSweepEvent* m_pCurrent;
+	/// Each input point within a few rounding errors of a lesser one paired with the
+	/// point it is merged with, sorted.
+	vector<pair<sBoolPoint, sBoolPoint> > m_Merged;
+	/// Storage for the events.
+	deque<sSweepEvent> m_Events;
+	/// The event queue.
+	CEventQueue m_Queue;
+	/// The sweep line.
+	CStatusLine m_Status;
+	/// The events in the order they were processed.
+	vector<sSweepEvent*> m_Sorted;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+NearTolerance <BR>
+\brief A few rounding errors at the point.
+<P>---------------------------------------------------------------------------*/
+static inline double NearTolerance(double x, double y)
+{
+	return 8 * numeric_limits<double>::epsilon() * max(fabs(x), fabs(y));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+FindIntersection <BR>
+\brief Finds the intersection of the segments a1-a2 and b1-b2 where a1 / b1 are the
+left end points. Returns the number of intersection points (0, 1 or 2 if they overlap).
+All decisions are made using exact predicates; only the crossing point of 2 properly
+crossing segments is rounded and then clamped to both bounding boxes.
+<P>---------------------------------------------------------------------------*/
+static int FindIntersection(const sSweepEvent* a1, const sSweepEvent* a2,
+							const sSweepEvent* b1, const sSweepEvent* b2, sBoolPoint* pPts)
+{
+	if (IsCollinear(a1, b1))
+	{
+		// Collinear. Split points are rounded so a piece of an edge can run back against
+		// its line by a rounding error and the end points are not always in the same
+		// order lexicographically as along the line. Order them by distance along the
+		// line instead. The overlap is from the greater of the starts to the lesser of
+		// the ends.
+		const double dx = a1->LineRight.x - a1->LineLeft.x;
+		const double dy = a1->LineRight.y - a1->LineLeft.y;
+		const sSweepEvent* Ends[4] = { a1, a2, b1, b2 };
+		double dAlong[4];
+		for (unsigned int i = 0; i < 4; i++)
+			dAlong[i] = (Ends[i]->x - a1->LineLeft.x) * dx + (Ends[i]->y - a1->LineLeft.y) * dy;
+
+		const unsigned int nStartA = dAlong[0] <= dAlong[1] ? 0 : 1;
+		const unsigned int nStartB = dAlong[2] <= dAlong[3] ? 2 : 3;
+		const unsigned int nStart = dAlong[nStartA] >= dAlong[nStartB] ? nStartA : nStartB;
+		const unsigned int nEnd = dAlong[1 - nStartA] <= dAlong[5 - nStartB] ? 1 - nStartA : 5 - nStartB;
+
+		if (dAlong[nStart] > dAlong[nEnd])
+			return 0;
+
+		const sSweepEvent* pStart = Ends[nStart];
+		const sSweepEvent* pEnd = Ends[nEnd];
+		pPts[0].x = pStart->x;
+		pPts[0].y = pStart->y;
+		if (pStart->SamePoint(pEnd) || dAlong[nStart] == dAlong[nEnd])
+			return 1;
+		pPts[1].x = pEnd->x;
+		pPts[1].y = pEnd->y;
+		return 2;
+	}
+
+	double o1 = a1->Side(b1);
+	double o2 = a1->Side(b2);
+
+	if ((o1 > 0 && o2 > 0) || (o1 < 0 && o2 < 0))
+		return 0;
+
+	double o3 = b1->Side(a1);
+	double o4 = b1->Side(a2);
+
+	if ((o3 > 0 && o4 > 0) || (o3 < 0 && o4 < 0))
+		return 0;
+
+	// A single intersection. Use an end point exactly if it lies on the other segment.
+	const sSweepEvent* pEndPoint = 0;
+	if (o1 == 0)
+		pEndPoint = b1;
+	else if (o2 == 0)
+		pEndPoint = b2;
+	else if (o3 == 0)
+		pEndPoint = a1;
+	else if (o4 == 0)
+		pEndPoint = a2;
+
+	if (pEndPoint)
+	{
+		pPts[0].x = pEndPoint->x;
+		pPts[0].y = pEndPoint->y;
+		return 1;
+	}
+
+	// Intersect the input edges as these are exact.
+	const sBoolPoint& pa = a1->LineLeft;
+	const sBoolPoint& pb = b1->LineLeft;
+	double vax = a1->LineRight.x - pa.x;
+	double vay = a1->LineRight.y - pa.y;
+	double vbx = b1->LineRight.x - pb.x;
+	double vby = b1->LineRight.y - pb.y;
+	double ex = pb.x - pa.x;
+	double ey = pb.y - pa.y;
+	double dKross = vax * vby - vay * vbx;
+	double s = (ex * vby - ey * vbx) / dKross;
+
+	double x = pa.x + s * vax;
+	double y = pa.y + s * vay;
+
+	// Clamp into the overlap of the 2 bounding boxes.
+	double dMinX = max(min(a1->x, a2->x), min(b1->x, b2->x));
+	double dMaxX = min(max(a1->x, a2->x), max(b1->x, b2->x));
+	double dMinY = max(min(a1->y, a2->y), min(b1->y, b2->y));
+	double dMaxY = min(max(a1->y, a2->y), max(b1->y, b2->y));
+
+	// Edges which are parallel in floating point give no crossing point. They then cross
+	// within a rounding error of both so use the centre of the overlap.
+	if (dKross == 0 || x != x || y != y)
+	{
+		x = (dMinX + dMaxX) / 2;
+		y = (dMinY + dMaxY) / 2;
+	}
+
+	x = min(max(x, dMinX), dMaxX);
+	y = min(max(y, dMinY), dMaxY);
+
+	// A crossing within a few rounding errors of an end point is taken to be at it so
+	// that no piece shorter than the error is made.
+	const double dTol = NearTolerance(x, y);
+	const sSweepEvent* Ends[4] = { a1, a2, b1, b2 };
+	double dBest = dTol;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		const double d = max(fabs(Ends[i]->x - x), fabs(Ends[i]->y - y));
+		if (d <= dBest)
+		{
+			dBest = d;
+			pEndPoint = Ends[i];
+		}
+	}
+	if (pEndPoint)
+	{
+		x = pEndPoint->x;
+		y = pEndPoint->y;
+	}
+
+	pPts[0].x = x;
+	pPts[0].y = y;
+
+	return 1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::NewEvent <BR>
+\brief Creates a new event.
+<P>---------------------------------------------------------------------------*/
+sSweepEvent* CSweep::NewEvent(double x, double y, bool bLeft, sSweepEvent* pOther, bool bSubject)
+{
+	m_Events.push_back(sSweepEvent());
+	sSweepEvent* pEvent = &m_Events.back();
+	pEvent->x = x;
+	pEvent->y = y;
+	pEvent->bLeft = bLeft;
+	pEvent->bSubject = bSubject;
+	pEvent->pOther = pOther;
+	pEvent->eType = Normal;
+	pEvent->bInOut = false;
+	pEvent->bOtherInOut = false;
+	pEvent->pPrevInResult = 0;
+	pEvent->nResultTransition = 0;
+	pEvent->nContourId = 0;
+	pEvent->nWind = 0;
+	pEvent->nWindAbove = 0;
+	pEvent->nOutputContourId = -1;
+	pEvent->nPos = 0;
+	pEvent->nId = (unsigned int)(m_Events.size() - 1);
+	pEvent->bInStatus = false;
+	return pEvent;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::ProcessContour <BR>
+\brief Adds the edges of the contour to the event queue, expanding the box given
+(min x, min y, max x, max y).
+<P>---------------------------------------------------------------------------*/
+void CSweep::ProcessContour(const vector<sBoolPoint>& Contour, bool bSubject,
+							unsigned int nContourId, double* dBox)
+{
+	unsigned int nCount = Contour.size();
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		const sBoolPoint s1 = Merged(Contour[i]);
+		const sBoolPoint s2 = Merged(Contour[(i + 1) % nCount]);
+
+		dBox[0] = min(dBox[0], s1.x);
+		dBox[1] = min(dBox[1], s1.y);
+		dBox[2] = max(dBox[2], s1.x);
+		dBox[3] = max(dBox[3], s1.y);
+
+		// Skip collapsed edges.
+		if (s1.x == s2.x && s1.y == s2.y)
+			continue;
+
+		sSweepEvent* e1 = NewEvent(s1.x, s1.y, false, 0, bSubject);
+		sSweepEvent* e2 = NewEvent(s2.x, s2.y, false, e1, bSubject);
+		e1->pOther = e2;
+		e1->nContourId = e2->nContourId = nContourId;
+
+		if (CompareEvents(e1, e2) > 0)
+			e2->bLeft = true;
+		else
+			e1->bLeft = true;
+		e1->nWind = e2->nWind = e1->bLeft ? 1 : -1;
+
+		sBoolPoint Left = e1->bLeft ? s1 : s2;
+		sBoolPoint Right = e1->bLeft ? s2 : s1;
+		e1->LineLeft = e2->LineLeft = Left;
+		e1->LineRight = e2->LineRight = Right;
+
+		m_Queue.push(e1);
+		m_Queue.push(e2);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+PointLess <BR>
+\brief Orders points by x then y.
+<P>---------------------------------------------------------------------------*/
+static inline bool PointLess(const sBoolPoint& p1, const sBoolPoint& p2)
+{
+	return p1.x < p2.x || (p1.x == p2.x && p1.y < p2.y);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MergedLess <BR>
+\brief Orders merged points by the input point.
+<P>---------------------------------------------------------------------------*/
+static inline bool MergedLess(const pair<sBoolPoint, sBoolPoint>& m1, const pair<sBoolPoint, sBoolPoint>& m2)
+{
+	return PointLess(m1.first, m2.first);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::MergeNearPoints <BR>
+\brief Finds the input points within a few rounding errors of a lesser point and
+merges each with the least of them. Edges from points this close cross within a
+rounding error of them, where the crossing points found cannot be ordered reliably
+against them, so the sweep is given one exact point instead.
+<P>---------------------------------------------------------------------------*/
+void CSweep::MergeNearPoints(const CBooleanContours& Contours)
+{
+	vector<sBoolPoint> Points;
+	for (unsigned int i = 0; i < Contours.Subject.size(); i++)
+		Points.insert(Points.end(), Contours.Subject[i].begin(), Contours.Subject[i].end());
+	for (unsigned int i = 0; i < Contours.Clip.size() && !m_bPositive; i++)
+		Points.insert(Points.end(), Contours.Clip[i].begin(), Contours.Clip[i].end());
+
+	sort(Points.begin(), Points.end(), PointLess);
+
+	vector<bool> Taken(Points.size(), false);
+	for (unsigned int i = 0; i < Points.size(); i++)
+	{
+		if (Taken[i])
+			continue;
+		const sBoolPoint& Pt = Points[i];
+		const double dTol = NearTolerance(Pt.x, Pt.y);
+		for (unsigned int j = i + 1; j < Points.size() && Points[j].x - Pt.x <= dTol; j++)
+		{
+			if (Taken[j] || fabs(Points[j].y - Pt.y) > dTol || (Points[j].x == Pt.x && Points[j].y == Pt.y))
+				continue;
+			Taken[j] = true;
+			m_Merged.push_back(make_pair(Points[j], Pt));
+		}
+	}
+
+	sort(m_Merged.begin(), m_Merged.end(), MergedLess);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::Merged <BR>
+\brief Returns the point the input point is merged with, which is the point itself if
+there is no other near it.
+<P>---------------------------------------------------------------------------*/
+sBoolPoint CSweep::Merged(const sBoolPoint& Pt) const
+{
+	if (m_Merged.empty())
+		return Pt;
+	vector<pair<sBoolPoint, sBoolPoint> >::const_iterator It =
+		lower_bound(m_Merged.begin(), m_Merged.end(), make_pair(Pt, Pt), MergedLess);
+	if (It != m_Merged.end() && It->first.x == Pt.x && It->first.y == Pt.y)
+		return It->second;
+	return Pt;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::InResult <BR>
+\brief True if the edge is part of the result.
+<P>---------------------------------------------------------------------------*/
+bool CSweep::InResult(const sSweepEvent* pEvent) const
+{
+	switch (pEvent->eType)
+	{
+	case Normal:
+		switch (m_eOp)
+		{
+		case CPolygonBoolean::Intersection:
+			return !pEvent->bOtherInOut;
+		case CPolygonBoolean::Union:
+			return pEvent->bOtherInOut;
+		case CPolygonBoolean::Difference:
+			return (pEvent->bSubject && pEvent->bOtherInOut) ||
+				   (!pEvent->bSubject && !pEvent->bOtherInOut);
+		case CPolygonBoolean::Xor:
+			return true;
+		}
+		break;
+	case SameTransition:
+		return m_eOp == CPolygonBoolean::Intersection || m_eOp == CPolygonBoolean::Union;
+	case DifferentTransition:
+		return m_eOp == CPolygonBoolean::Difference;
+	case NonContributing:
+		return false;
+	}
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::DetermineResultTransition <BR>
+\brief +1 if the result area is above the edge, -1 if below.
+<P>---------------------------------------------------------------------------*/
+int CSweep::DetermineResultTransition(const sSweepEvent* pEvent) const
+{
+	bool bThisIn = !pEvent->bInOut;
+	bool bThatIn = !pEvent->bOtherInOut;
+	bool bIsIn = false;
+
+	// For a coincident edge the other polygon changes across the edge too.
+	if (pEvent->eType == SameTransition)
+		bThatIn = bThisIn;
+	else if (pEvent->eType == DifferentTransition)
+		bThatIn = !bThisIn;
+
+	switch (m_eOp)
+	{
+	case CPolygonBoolean::Intersection:
+		bIsIn = bThisIn && bThatIn;
+		break;
+	case CPolygonBoolean::Union:
+		bIsIn = bThisIn || bThatIn;
+		break;
+	case CPolygonBoolean::Xor:
+		bIsIn = bThisIn != bThatIn;
+		break;
+	case CPolygonBoolean::Difference:
+		if (pEvent->bSubject)
+			bIsIn = bThisIn && !bThatIn;
+		else
+			bIsIn = bThatIn && !bThisIn;
+		break;
+	}
+	return bIsIn ? 1 : -1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::ComputeFields <BR>
+\brief Sets the inside / outside flags of the event from the edge immediately below.
+<P>---------------------------------------------------------------------------*/
+void CSweep::ComputeFields(sSweepEvent* pEvent, sSweepEvent* pPrev) const
+{
+	if (m_bPositive)
+	{
+		ComputeWinding(pEvent, pPrev);
+		return;
+	}
+
+	if (pPrev == 0)
+	{
+		pEvent->bInOut = false;
+		pEvent->bOtherInOut = true;
+	}
+	else
+	{
+		if (pEvent->bSubject == pPrev->bSubject)
+		{
+			pEvent->bInOut = !pPrev->bInOut;
+			pEvent->bOtherInOut = pPrev->bOtherInOut;
+		}
+		else
+		{
+			pEvent->bInOut = !pPrev->bOtherInOut;
+			pEvent->bOtherInOut = pPrev->IsVertical() ? !pPrev->bInOut : pPrev->bInOut;
+		}
+
+		pEvent->pPrevInResult = (!InResult(pPrev) || pPrev->IsVertical()) ?
+									pPrev->pPrevInResult : pPrev;
+	}
+
+	if (InResult(pEvent))
+		pEvent->nResultTransition = DetermineResultTransition(pEvent);
+	else
+		pEvent->nResultTransition = 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::ComputeWinding <BR>
+\brief Sets the winding counts of the event from the edge immediately below for the
+positive union. A vertical edge is only swept at its own x so the edges above it see
+the count to its right, which is the count below it. The edge is in the result if
+the count is positive on one side only.
+<P>---------------------------------------------------------------------------*/
+void CSweep::ComputeWinding(sSweepEvent* pEvent, sSweepEvent* pPrev) const
+{
+	int nBelow = 0;
+	if (pPrev != 0)
+	{
+		nBelow = pPrev->nWindAbove;
+		pEvent->pPrevInResult = (!pPrev->InResult() || pPrev->IsVertical()) ?
+									pPrev->pPrevInResult : pPrev;
+	}
+	else
+	{
+		pEvent->pPrevInResult = 0;
+	}
+
+	// The count above the edge, or to the left of a vertical edge.
+	const int nAcross = nBelow + pEvent->nWind;
+	pEvent->nWindAbove = pEvent->IsVertical() ? nBelow : nAcross;
+
+	if (pEvent->eType != NonContributing && (nBelow > 0) != (nAcross > 0))
+		pEvent->nResultTransition = nAcross > 0 ? 1 : -1;
+	else
+		pEvent->nResultTransition = 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::MergeCoincident <BR>
+\brief For the positive union, finds all the edges in the sweep line starting at the
+left point of the edge given along the same line, splits them to the shortest and 
+gives the total of their winding to the lowest. The others no longer contribute.
+<P>---------------------------------------------------------------------------*/
+void CSweep::MergeCoincident(sSweepEvent* pLE)
+{
+	CStatusLine::iterator First = pLE->PosSL;
+	while (First != m_Status.begin())
+	{
+		CStatusLine::iterator Below = First;
+		--Below;
+		if (!(*Below)->SamePoint(pLE) || !IsCollinear(*Below, pLE))
+			break;
+		First = Below;
+	}
+
+	vector<sSweepEvent*> Edges;
+	const sSweepEvent* pShortest = 0;
+	for (CStatusLine::iterator It = First; It != m_Status.end(); ++It)
+	{
+		sSweepEvent* pEdge = *It;
+		if (!pEdge->SamePoint(pLE) || !IsCollinear(pEdge, pLE))
+			break;
+		Edges.push_back(pEdge);
+		if (pShortest == 0 || CompareEvents(pShortest, pEdge->pOther) > 0)
+			pShortest = pEdge->pOther;
+	}
+
+	int nTotal = 0;
+	for (unsigned int i = 0; i < Edges.size(); i++)
+	{
+		if (!Edges[i]->pOther->SamePoint(pShortest))
+			DivideSegment(Edges[i], pShortest->x, pShortest->y);
+		nTotal += Edges[i]->nWind;
+	}
+
+	sSweepEvent* pPrev = 0;
+	if (First != m_Status.begin())
+	{
+		CStatusLine::iterator Below = First;
+		--Below;
+		pPrev = *Below;
+	}
+
+	for (unsigned int i = 0; i < Edges.size(); i++)
+	{
+		sSweepEvent* pEdge = Edges[i];
+		pEdge->nWind = pEdge->pOther->nWind = (i == 0) ? nTotal : 0;
+		pEdge->eType = (i == 0) ? Normal : NonContributing;
+		ComputeWinding(pEdge, pPrev);
+		pPrev = pEdge;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::KeepAhead <BR>
+\brief Moves a point behind the sweep line, which rounding can give where edges cross
+close to the current event, to the point of the current event. Splitting an edge
+behind it would make events that should already have been processed, which are
+then split again by the edges they pass and so on without end.
+<P>---------------------------------------------------------------------------*/
+void CSweep::KeepAhead(double& x, double& y) const
+{
+	if (m_pCurrent && (x < m_pCurrent->x || (x == m_pCurrent->x && y < m_pCurrent->y)))
+	{
+		x = m_pCurrent->x;
+		y = m_pCurrent->y;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::DivideSegment <BR>
+\brief Splits the edge of the left event given at the point, kept ahead of the sweep
+line. Nothing is done if that is an end point of the edge.
+<P>---------------------------------------------------------------------------*/
+void CSweep::DivideSegment(sSweepEvent* pSE, double x, double y)
+{
+	KeepAhead(x, y);
+	if ((x == pSE->x && y == pSE->y) || (x == pSE->pOther->x && y == pSE->pOther->y))
+		return;
+
+	sSweepEvent* r = NewEvent(x, y, false, pSE, pSE->bSubject);
+	sSweepEvent* l = NewEvent(x, y, true, pSE->pOther, pSE->bSubject);
+	r->nContourId = l->nContourId = pSE->nContourId;
+	r->nWind = l->nWind = pSE->nWind;
+	r->LineLeft = l->LineLeft = pSE->LineLeft;
+	r->LineRight = l->LineRight = pSE->LineRight;
+
+	// Avoid a rounding error. The left event would be processed after the right event.
+	// The new edge then runs against its input edge so the side tests must reverse it.
+	if (CompareEvents(l, pSE->pOther) > 0)
+	{
+		pSE->pOther->bLeft = true;
+		l->bLeft = false;
+		swap(pSE->pOther->LineLeft, pSE->pOther->LineRight);
+		swap(l->LineLeft, l->LineRight);
+		pSE->pOther->nWind = -pSE->pOther->nWind;
+		l->nWind = -l->nWind;
+	}
+
+	pSE->pOther->pOther = l;
+	pSE->pOther = r;
+
+	m_Queue.push(l);
+	m_Queue.push(r);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::PossibleIntersection <BR>
+\brief Finds and processes the intersection of 2 neighbouring edges. Returns 0 for
+no intersection, 1 for a single point, 2 if the edges overlap and share the left
+point and 3 for any other overlap.
+<P>---------------------------------------------------------------------------*/
+int CSweep::PossibleIntersection(sSweepEvent* pSE1, sSweepEvent* pSE2)
+{
+	sBoolPoint Inter[2];
+	int nIntersections = FindIntersection(pSE1, pSE1->pOther, pSE2, pSE2->pOther, Inter);
+
+	if (nIntersections == 0)
+		return 0;
+
+	// The edges intersect at an end point of both.
+	if (nIntersections == 1 && (pSE1->SamePoint(pSE2) || pSE1->pOther->SamePoint(pSE2->pOther)))
+		return 0;
+
+	// Overlapping edges of the same polygon are not supported except by the positive union.
+	if (nIntersections == 2 && pSE1->bSubject == pSE2->bSubject && !m_bPositive)
+		return 0;
+
+	if (nIntersections == 1)
+	{
+		double x = Inter[0].x;
+		double y = Inter[0].y;
+		KeepAhead(x, y);
+		// If the intersection point is not an end point of the first edge
+		if (!(pSE1->x == x && pSE1->y == y) && !(pSE1->pOther->x == x && pSE1->pOther->y == y))
+			DivideSegment(pSE1, x, y);
+		// If the intersection point is not an end point of the second edge
+		if (!(pSE2->x == x && pSE2->y == y) && !(pSE2->pOther->x == x && pSE2->pOther->y == y))
+			DivideSegment(pSE2, x, y);
+		return 1;
+	}
+
+	// The edges overlap.
+	sSweepEvent* Events[4];
+	unsigned int nEvents = 0;
+	bool bLeftCoincide = false;
+	bool bRightCoincide = false;
+
+	if (pSE1->SamePoint(pSE2))
+	{
+		bLeftCoincide = true;
+	}
+	else if (CompareEvents(pSE1, pSE2) == 1)
+	{
+		Events[nEvents++] = pSE2;
+		Events[nEvents++] = pSE1;
+	}
+	else
+	{
+		Events[nEvents++] = pSE1;
+		Events[nEvents++] = pSE2;
+	}
+
+	if (pSE1->pOther->SamePoint(pSE2->pOther))
+	{
+		bRightCoincide = true;
+	}
+	else if (CompareEvents(pSE1->pOther, pSE2->pOther) == 1)
+	{
+		Events[nEvents++] = pSE2->pOther;
+		Events[nEvents++] = pSE1->pOther;
+	}
+	else
+	{
+		Events[nEvents++] = pSE1->pOther;
+		Events[nEvents++] = pSE2->pOther;
+	}
+
+	if (bLeftCoincide && m_bPositive)
+	{
+		if (!bRightCoincide)
+			DivideSegment(Events[1]->pOther, Events[0]->x, Events[0]->y);
+		MergeCoincident(pSE1);
+		return 2;
+	}
+
+	if (bLeftCoincide)
+	{
+		// Both edges are equal or share the left end point.
+		pSE2->eType = NonContributing;
+		pSE1->eType = (pSE2->bInOut == pSE1->bInOut) ? SameTransition : DifferentTransition;
+
+		if (!bRightCoincide)
+			DivideSegment(Events[1]->pOther, Events[0]->x, Events[0]->y);
+
+		return 2;
+	}
+
+	// The edges share the right end point.
+	if (bRightCoincide)
+	{
+		DivideSegment(Events[0], Events[1]->x, Events[1]->y);
+		return 3;
+	}
+
+	// Neither edge includes the other entirely.
+	if (Events[0] != Events[3]->pOther)
+	{
+		DivideSegment(Events[0], Events[1]->x, Events[1]->y);
+		DivideSegment(Events[1], Events[2]->x, Events[2]->y);
+		return 3;
+	}
+
+	// One edge includes the other.
+	DivideSegment(Events[0], Events[1]->x, Events[1]->y);
+	DivideSegment(Events[3]->pOther, Events[2]->x, Events[2]->y);
+	return 3;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::Run <BR>
+\brief Sweeps all the edges then connects those in the result.
+<P>---------------------------------------------------------------------------*/
+void CSweep::Run(const CBooleanContours& Contours, C2DHoledPolyBaseSet& Result)
+{
+	const double dInf = numeric_limits<double>::max();
+	double SubjectBox[4] = { dInf, dInf, -dInf, -dInf };
+	double ClipBox[4] = { dInf, dInf, -dInf, -dInf };
+
+	MergeNearPoints(Contours);
+
+	unsigned int nContourId = 0;
+	for (unsigned int i = 0; i < Contours.Subject.size(); i++)
+		ProcessContour(Contours.Subject[i], true, nContourId++, SubjectBox);
+	for (unsigned int i = 0; i < Contours.Clip.size() && !m_bPositive; i++)
+		ProcessContour(Contours.Clip[i], false, nContourId++, ClipBox);
+
+	// Trivial intersection
+	if (m_eOp == CPolygonBoolean::Intersection &&
+		(SubjectBox[0] > ClipBox[2] || ClipBox[0] > SubjectBox[2] ||
+		 SubjectBox[1] > ClipBox[3] || ClipBox[1] > SubjectBox[3]))
+	{
+		return;
+	}
+
+	const double dRightBound = min(SubjectBox[2], ClipBox[2]);
+
+	m_Sorted.reserve(m_Queue.size());
+
+	// Each pair of input edges is split at most twice and each event is processed again
+	// at most once for each event before it at the same point. A sweep going beyond this
+	// is not making progress so give up rather than run on.
+	const double dEdges = m_Queue.size() / 2.0;
+	const double dMaxSteps = 16.0 * (dEdges + 1.0) * (dEdges + 1.0);
+	double dSteps = 0;
+
+	while (!m_Queue.empty())
+	{
+		if (++dSteps > dMaxSteps)
+			return;
+
+		sSweepEvent* pEvent = m_Queue.top();
+		m_Queue.pop();
+		m_pCurrent = pEvent;
+
+		// Nothing of interest beyond the bounding boxes.
+		if ((m_eOp == CPolygonBoolean::Intersection && pEvent->x > dRightBound) ||
+			(m_eOp == CPolygonBoolean::Difference && pEvent->x > SubjectBox[2]))
+		{
+			break;
+		}
+
+		m_Sorted.push_back(pEvent);
+
+		if (pEvent->bLeft)
+		{
+			pair<CStatusLine::iterator, bool> Ins = m_Status.insert(pEvent);
+			pEvent->PosSL = Ins.first;
+			pEvent->bInStatus = true;
+
+			CStatusLine::iterator Next = pEvent->PosSL;
+			++Next;
+			sSweepEvent* pNext = (Next != m_Status.end()) ? *Next : 0;
+			sSweepEvent* pPrev = 0;
+			CStatusLine::iterator Prev = pEvent->PosSL;
+			if (Prev != m_Status.begin())
+			{
+				--Prev;
+				pPrev = *Prev;
+			}
+
+			ComputeFields(pEvent, pPrev);
+
+			if (pNext)
+			{
+				if (PossibleIntersection(pEvent, pNext) == 2)
+				{
+					ComputeFields(pEvent, pPrev);
+					ComputeFields(pNext, pEvent);
+				}
+			}
+
+			if (pPrev)
+			{
+				if (PossibleIntersection(pPrev, pEvent) == 2)
+				{
+					sSweepEvent* pPrevPrev = 0;
+					if (Prev != m_Status.begin())
+					{
+						CStatusLine::iterator PrevPrev = Prev;
+						--PrevPrev;
+						pPrevPrev = *PrevPrev;
+					}
+					ComputeFields(pPrev, pPrevPrev);
+					ComputeFields(pEvent, pPrev);
+				}
+			}
+
+			// A neighbour split at the point of this edge, which can lie just off the
+			// neighbour, gives events there that should have been processed before this.
+			// Its fields are then wrong so take it out and process it again after them.
+			if (!m_Queue.empty() && m_Queue.top()->SamePoint(pEvent) && CompareEvents(m_Queue.top(), pEvent) < 0)
+			{
+				m_Status.erase(pEvent->PosSL);
+				pEvent->bInStatus = false;
+				m_Sorted.pop_back();
+				m_Queue.push(pEvent);
+			}
+		}
+		else
+		{
+			sSweepEvent* pLeft = pEvent->pOther;
+			if (pLeft->bInStatus)
+			{
+				CStatusLine::iterator Pos = pLeft->PosSL;
+				CStatusLine::iterator Next = Pos;
+				++Next;
+				sSweepEvent* pNext = (Next != m_Status.end()) ? *Next : 0;
+				sSweepEvent* pPrev = 0;
+				if (Pos != m_Status.begin())
+				{
+					CStatusLine::iterator Prev = Pos;
+					--Prev;
+					pPrev = *Prev;
+				}
+
+				m_Status.erase(Pos);
+				pLeft->bInStatus = false;
+
+				if (pNext && pPrev)
+					PossibleIntersection(pPrev, pNext);
+			}
+		}
+	}
+
+	ConnectEdges(Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+struct sOutContour
+\brief A contour of the result.
+<P>---------------------------------------------------------------------------*/
+struct sOutContour
+{
+	/// The points.
+	vector<sBoolPoint> Points;
+	/// The contours that are holes of this.
+	vector<int> HoleIds;
+	/// The exterior contour this is a hole of or -1.
+	int nHoleOf;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+IsOutgoing <BR>
+\brief True if the result edge of the event leaves the event point when the edges
+are directed with the result area on their left.
+<P>---------------------------------------------------------------------------*/
+static inline bool IsOutgoing(const sSweepEvent* pEvent)
+{
+	return pEvent->bLeft ? pEvent->nResultTransition > 0 : pEvent->pOther->nResultTransition < 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+ClockwiseHalf <BR>
+\brief Classifies the direction v->w by the clockwise angle from v->u. 0 for (0,180),
+1 for 180 and 2 for (180,360) degrees.
+<P>---------------------------------------------------------------------------*/
+static inline int ClockwiseHalf(const sSweepEvent* v, const sSweepEvent* u, const sSweepEvent* w)
+{
+	double dOrient = SignedArea(v, u, w);
+	if (dOrient < 0)
+		return 0;
+	if (dOrient > 0)
+		return 2;
+	return 1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakePolygon <BR>
+\brief Creates a polygon from the points.
+<P>---------------------------------------------------------------------------*/
+static C2DPolyBase* MakePolygon(const vector<sBoolPoint>& Points)
+{
+	unsigned int nCount = Points.size();
+
+	C2DLineBaseSet Lines;
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		const sBoolPoint& p1 = Points[i];
+		const sBoolPoint& p2 = Points[(i + 1) % nCount];
+		Lines.Add(new C2DLine(C2DPoint(p1.x, p1.y), C2DPoint(p2.x, p2.y)));
+	}
+
+	C2DPolyBase* pPoly = new C2DPolyBase;
+	pPoly->CreateDirect(Lines);
+	return pPoly;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSweep::ConnectEdges <BR>
+\brief Connects the result edges into closed contours. Each edge is directed so that
+the result area is on its left and at each point the contour turns onto the first
+edge clockwise from the one it arrived on, so contours touching at a point are kept
+apart. Rims are therefore counter clockwise and holes clockwise. The rim of each hole
+is found from the result edge immediately below its first point.
+<P>---------------------------------------------------------------------------*/
+void CSweep::ConnectEdges(C2DHoledPolyBaseSet& Result)
+{
+	vector<sSweepEvent*> ResultEvents;
+	for (unsigned int i = 0; i < m_Sorted.size(); i++)
+	{
+		sSweepEvent* pEvent = m_Sorted[i];
+		if ((pEvent->bLeft && pEvent->InResult()) || (!pEvent->bLeft && pEvent->pOther->InResult()))
+			ResultEvents.push_back(pEvent);
+	}
+
+	// Due to overlapping edges the events may not be wholly sorted. They are nearly
+	// sorted so use an insertion sort.
+	for (unsigned int i = 1; i < ResultEvents.size(); i++)
+	{
+		sSweepEvent* pEvent = ResultEvents[i];
+		unsigned int j = i;
+		while (j > 0 && CompareEvents(ResultEvents[j - 1], pEvent) == 1)
+		{
+			ResultEvents[j] = ResultEvents[j - 1];
+			j--;
+		}
+		ResultEvents[j] = pEvent;
+	}
+
+	unsigned int nLength = ResultEvents.size();
+
+	// The events at each point are now adjacent. Record where each group starts.
+	vector<unsigned int> GroupStart(nLength, 0);
+	for (unsigned int i = 0; i < nLength; i++)
+	{
+		ResultEvents[i]->nPos = i;
+		if (i > 0 && ResultEvents[i]->SamePoint(ResultEvents[i - 1]))
+			GroupStart[i] = GroupStart[i - 1];
+		else
+			GroupStart[i] = i;
+	}
+
+	vector<bool> Processed(nLength, false);
+	vector<sOutContour> Contours;
+
+	for (unsigned int i = 0; i < nLength; i++)
+	{
+		if (Processed[i])
+			continue;
+
+		// This is the lowest left edge of a new contour so the area above it is in
+		// the result for a rim and the area below it for a hole.
+		sSweepEvent* pFirst = ResultEvents[i];
+		int nContourId = (int)Contours.size();
+		Contours.push_back(sOutContour());
+		sOutContour& Contour = Contours.back();
+		Contour.nHoleOf = -1;
+
+		if (pFirst->bLeft && pFirst->nResultTransition < 0)
+		{
+			const sSweepEvent* pBelow = pFirst->pPrevInResult;
+			// An edge merged with coincident edges since may have left the result.
+			while (pBelow != 0 && !pBelow->InResult())
+				pBelow = pBelow->pPrevInResult;
+			if (pBelow != 0 && pBelow->nOutputContourId >= 0)
+			{
+				int nLowerId = pBelow->nOutputContourId;
+				int nParentId = Contours[nLowerId].nHoleOf >= 0 ? Contours[nLowerId].nHoleOf : nLowerId;
+				Contour.nHoleOf = nParentId;
+				Contours[nParentId].HoleIds.push_back(nContourId);
+			}
+		}
+
+		// Start with the first edge in its own direction.
+		sSweepEvent* pFrom = IsOutgoing(pFirst) ? pFirst : pFirst->pOther;
+		while (true)
+		{
+			unsigned int nFrom = pFrom->nPos;
+			unsigned int nTo = pFrom->pOther->nPos;
+			Processed[nFrom] = Processed[nTo] = true;
+			pFrom->nOutputContourId = pFrom->pOther->nOutputContourId = nContourId;
+
+			sBoolPoint Pt = { pFrom->x, pFrom->y };
+			Contour.Points.push_back(Pt);
+
+			// Choose the first outgoing edge clockwise from the way back.
+			const sSweepEvent* v = pFrom->pOther;
+			sSweepEvent* pNext = 0;
+			int nNextHalf = 0;
+			for (unsigned int j = GroupStart[nTo]; j < nLength && ResultEvents[j]->SamePoint(v); j++)
+			{
+				sSweepEvent* pCandidate = ResultEvents[j];
+				if (Processed[j] || !IsOutgoing(pCandidate))
+					continue;
+
+				int nHalf = ClockwiseHalf(v, pFrom, pCandidate->pOther);
+				if (pNext == 0 || nHalf < nNextHalf ||
+					(nHalf == nNextHalf && SignedArea(v, pNext->pOther, pCandidate->pOther) > 0))
+				{
+					pNext = pCandidate;
+					nNextHalf = nHalf;
+				}
+			}
+
+			if (pNext == 0)
+				break;
+			pFrom = pNext;
+		}
+	}
+
+	// Now form the holed polygons.
+	for (unsigned int i = 0; i < Contours.size(); i++)
+	{
+		const sOutContour& Contour = Contours[i];
+		if (Contour.nHoleOf >= 0 || Contour.Points.size() < 3)
+			continue;
+
+		C2DHoledPolyBase* pHoled = new C2DHoledPolyBase;
+		pHoled->SetRimDirect(MakePolygon(Contour.Points));
+
+		for (unsigned int h = 0; h < Contour.HoleIds.size(); h++)
+		{
+			const sOutContour& Hole = Contours[Contour.HoleIds[h]];
+			if (Hole.Points.size() >= 3)
+				pHoled->AddHoleDirect(MakePolygon(Hole.Points));
+		}
+
+		Result.Add(pHoled);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::CPolygonBoolean
+\brief Constructor.
+<P>---------------------------------------------------------------------------*/
+CPolygonBoolean::CPolygonBoolean(void)
+{
+	m_Contours = new CBooleanContours;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::~CPolygonBoolean
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CPolygonBoolean::~CPolygonBoolean(void)
+{
+	delete m_Contours;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::AddSubject
+\brief Adds the polygon to the subject.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::AddSubject(const C2DPolyBase& Poly)
+{
+	m_Contours->Add(Poly, true);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::AddSubject
+\brief Adds the holed polygon to the subject.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::AddSubject(const C2DHoledPolyBase& Poly)
+{
+	m_Contours->Add(Poly, true);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::AddSubject
+\brief Adds all the holed polygons to the subject.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::AddSubject(const C2DHoledPolyBaseSet& Polys)
+{
+	for (unsigned int i = 0; i < Polys.size(); i++)
+		m_Contours->Add(Polys[i], true);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::AddSubject
+\brief Adds a contour to the subject given as x and y for each point.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::AddSubject(const std::vector<double>& Coords)
+{
+	if (Coords.size() < 6)
+		return;
+
+	vector<sBoolPoint>& Contour = m_Contours->NewSubject();
+	Contour.resize(Coords.size() / 2);
+	for (unsigned int i = 0; i < Contour.size(); i++)
+	{
+		Contour[i].x = Coords[2 * i];
+		Contour[i].y = Coords[2 * i + 1];
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::AddClip
+\brief Adds the polygon to the clip.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::AddClip(const C2DPolyBase& Poly)
+{
+	m_Contours->Add(Poly, false);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::AddClip
+\brief Adds the holed polygon to the clip.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::AddClip(const C2DHoledPolyBase& Poly)
+{
+	m_Contours->Add(Poly, false);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::AddClip
+\brief Adds all the holed polygons to the clip.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::AddClip(const C2DHoledPolyBaseSet& Polys)
+{
+	for (unsigned int i = 0; i < Polys.size(); i++)
+		m_Contours->Add(Polys[i], false);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::Clear
+\brief Clears the subject and clip.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::Clear(void)
+{
+	m_Contours->Subject.clear();
+	m_Contours->Clip.clear();
+	m_Contours->Arcs.Clear();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::SetArcTolerance
+\brief Sets the tolerance to which arcs of the shapes added from now on are flattened.
+Runs of result edges on those arcs are then fitted with arcs again. At 0, the default,
+arcs are treated as their chords.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::SetArcTolerance(double dTolerance)
+{
+	m_Contours->Arcs.SetTolerance(dTolerance);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::GetArcTolerance
+\brief The tolerance to which arcs are flattened, 0 if they are treated as chords.
+<P>---------------------------------------------------------------------------*/
+double CPolygonBoolean::GetArcTolerance(void) const
+{
+	return m_Contours->Arcs.GetTolerance();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::Execute
+\brief Performs the operation adding the resulting shapes to the set provided.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::Execute(eOperation eOp, C2DHoledPolyBaseSet& Result) const
+{
+	const unsigned int nFrom = Result.size();
+	CSweep Sweep(eOp);
+	Sweep.Run(*m_Contours, Result);
+	m_Contours->Arcs.FitArcs(Result, nFrom);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::ExecutePositiveUnion
+\brief Adds the areas the subject contours wind around anticlockwise more often than
+clockwise to the set, as rims and holes. The clip is not used.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::ExecutePositiveUnion(C2DHoledPolyBaseSet& Result) const
+{
+	const unsigned int nFrom = Result.size();
+	CSweep Sweep(Union, true);
+	Sweep.Run(*m_Contours, Result);
+	m_Contours->Arcs.FitArcs(Result, nFrom);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::Compute
+\brief Performs the operation on the 2 holed polygons.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::Compute(const C2DHoledPolyBase& Subject, const C2DHoledPolyBase& Clip,
+							  eOperation eOp, C2DHoledPolyBaseSet& Result)
+{
+	CPolygonBoolean Boolean;
+	Boolean.AddSubject(Subject);
+	Boolean.AddClip(Clip);
+	Boolean.Execute(eOp, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonBoolean::Compute
+\brief Performs the operation on the 2 polygons.
+<P>---------------------------------------------------------------------------*/
+void CPolygonBoolean::Compute(const C2DPolyBase& Subject, const C2DPolyBase& Clip,
+							  eOperation eOp, C2DHoledPolyBaseSet& Result)
+{
+	CPolygonBoolean Boolean;
+	Boolean.AddSubject(Subject);
+	Boolean.AddClip(Clip);
+	Boolean.Execute(eOp, Result);
+}
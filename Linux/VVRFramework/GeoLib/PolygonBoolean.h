@@ -0,0 +1,108 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PolygonBoolean.h
+\brief Declaration file for the CPolygonBoolean class.
+
+Declaration file for CPolygonBoolean, a sweep line polygon Boolean engine.
+
+\class CPolygonBoolean
+\brief A sweep line (Martinez-Rueda) polygon Boolean engine.
+
+An alternative to C2DPolyBase::GetBoolean. All edges of the subject and clip
+shapes are swept from left to right, split at their intersections and classified
+as inside or outside the other shape as they are passed. Coincident edges are
+detected with the exact predicates in Predicates.h so no perturbation or grid
+snapping is needed. Only points within a few rounding errors of each other are
+merged, input points with each other and crossing points with the end points of
+their edges, as the crossing points found this close cannot be ordered reliably.
+The result edges are then connected into rims and holes. Should the sweep still not
+end within a number of steps of the order of the square of the number of edges it
+is abandoned and the result is left empty.
+
+Unlike GetBoolean, the result is the true Boolean result so e.g. the union of 2
+distinct shapes returns both shapes. The shapes within the subject (or clip)
+should not overlap each other as the inside is determined by the even-odd rule.
+Arcs are treated as their chords unless an arc tolerance is set, in which case they
+are flattened to it, using the flattening cached by each polygon, and runs of result
+edges on them are fitted with arcs again. The result is then within the tolerance of
+the true one.
+
+ExecutePositiveUnion instead counts how many times the subject contours wind
+around each area, anticlockwise adding 1 and clockwise subtracting 1, and returns
+the areas with a positive count. The subject contours may then overlap and cross
+themselves, e.g. the raw outlines made by offsetting a polygon.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CPOLYGONBOOLEAN_H
+#define _GEOLIB_CPOLYGONBOOLEAN_H
+
+#include "MemoryPool.h"
+
+class C2DPolyBase;
+class C2DHoledPolyBase;
+class C2DHoledPolyBaseSet;
+class CBooleanContours;
+
+class GeoLib_API CPolygonBoolean
+{
+public:
+	/// Enumeration for the Boolean operations.
+	enum eOperation
+	{
+		Intersection,
+		Union,
+		Difference,
+		Xor,
+	};
+
+	/// Constructor
+	CPolygonBoolean(void);
+	/// Destructor
+	~CPolygonBoolean(void);
+
+	/// Adds the polygon to the subject.
+	void AddSubject(const C2DPolyBase& Poly);
+	/// Adds the holed polygon to the subject.
+	void AddSubject(const C2DHoledPolyBase& Poly);
+	/// Adds all the holed polygons to the subject.
+	void AddSubject(const C2DHoledPolyBaseSet& Polys);
+	/// Adds a contour to the subject given as x and y for each point.
+	void AddSubject(const std::vector<double>& Coords);
+	/// Adds the polygon to the clip.
+	void AddClip(const C2DPolyBase& Poly);
+	/// Adds the holed polygon to the clip.
+	void AddClip(const C2DHoledPolyBase& Poly);
+	/// Adds all the holed polygons to the clip.
+	void AddClip(const C2DHoledPolyBaseSet& Polys);
+	/// Clears the subject and clip.
+	void Clear(void);
+	/// Sets the tolerance to which arcs of the shapes added from now on are flattened.
+	void SetArcTolerance(double dTolerance);
+	/// The tolerance to which arcs are flattened, 0 if they are treated as chords.
+	double GetArcTolerance(void) const;
+
+	/// Performs the operation adding the resulting shapes to the set provided.
+	void Execute(eOperation eOp, C2DHoledPolyBaseSet& Result) const;
+	/// Adds the areas the subject winds around anticlockwise more than clockwise to
+	/// the set. The clip is not used.
+	void ExecutePositiveUnion(C2DHoledPolyBaseSet& Result) const;
+
+	/// Performs the operation on the 2 shapes.
+	static void Compute(const C2DHoledPolyBase& Subject, const C2DHoledPolyBase& Clip,
+						eOperation eOp, C2DHoledPolyBaseSet& Result);
+	/// Performs the operation on the 2 shapes.
+	static void Compute(const C2DPolyBase& Subject, const C2DPolyBase& Clip,
+						eOperation eOp, C2DHoledPolyBaseSet& Result);
+
+private:
+	/// The subject and clip contours.
+	CBooleanContours* m_Contours;
+};
+
+#endif
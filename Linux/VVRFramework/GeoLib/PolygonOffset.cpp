@@ -0,0 +1,531 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PolygonOffset.cpp
+\brief Implementation file for the CPolygonOffset class.
+
+Implementation file for CPolygonOffset. The raw outline of each ring is made as in
+A. Johnson's Clipper library: the moved edges are joined across the gap at a convex
+corner and through the original corner at a concave one so that the outline winds
+positively around the whole offset area and not around the parts cut away.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "PolygonOffset.h"
+#include "PolygonBoolean.h"
+#include "Predicates.h"
+#include "C2DPolyBase.h"
+#include "C2DHoledPolyBase.h"
+#include "C2DHoledPolyBaseSet.h"
+#include "C2DLineBaseSet.h"
+#include "C2DLine.h"
+#include "C2DArc.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <thread>
+
+using namespace std;
+
+/// The default arc tolerance as a fraction of the distance.
+const double conDefaultArcTolerance = 0.001;
+/// The sine of the turn below which a corner is treated as straight.
+const double conStraightTurn = 1e-12;
+
+
+/**--------------------------------------------------------------------------<BR>
+Cross <BR>
+\brief The z component of the cross product of the vectors, positive if v is
+anticlockwise from u.
+<P>---------------------------------------------------------------------------*/
+static inline double Cross(const C2DVector& u, const C2DVector& v)
+{
+	return u.i * v.j - u.j * v.i;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::CPolygonOffset
+\brief Constructor, for round joins.
+<P>---------------------------------------------------------------------------*/
+CPolygonOffset::CPolygonOffset(void) : m_eJoin(Round), m_dMitreLimit(2.0),
+									   m_dArcTolerance(0), m_bArcOutput(false)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::CPolygonOffset
+\brief Constructor.
+<P>---------------------------------------------------------------------------*/
+CPolygonOffset::CPolygonOffset(eJoinType eJoin, double dMitreLimit, double dArcTolerance)
+	: m_eJoin(eJoin), m_dMitreLimit(1.0), m_dArcTolerance(dArcTolerance), m_bArcOutput(false)
+{
+	SetMitreLimit(dMitreLimit);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::~CPolygonOffset
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CPolygonOffset::~CPolygonOffset(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::SetMitreLimit
+\brief Sets the furthest a mitre can reach from the corner as a multiple of the
+distance. Sharper corners are squared off at this distance. At least 1.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::SetMitreLimit(double dLimit)
+{
+	m_dMitreLimit = max(1.0, dLimit);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::GetTolerance
+\brief The arc tolerance to use for the distance.
+<P>---------------------------------------------------------------------------*/
+double CPolygonOffset::GetTolerance(double dDistance) const
+{
+	if (m_dArcTolerance > 0)
+		return m_dArcTolerance;
+	return fabs(dDistance) * conDefaultArcTolerance;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::GetChordAngle
+\brief The greatest angle of a chord of a circle of the radius that is no further
+than the tolerance from the circle.
+<P>---------------------------------------------------------------------------*/
+double CPolygonOffset::GetChordAngle(double dRadius, double dTolerance)
+{
+	if (dTolerance <= 0 || dTolerance >= dRadius)
+		return conPI / 2;
+	return min(conPI / 2, 2 * acos(1 - dTolerance / dRadius));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::GetRing
+\brief Gets the points of the polygon in the direction required, following any arcs
+by chords within the tolerance. Repeated points are removed.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::GetRing(const C2DPolyBase& Poly, vector<C2DPoint>& Ring,
+							 bool bAnticlockwise, double dTolerance)
+{
+	// The flattening cached by the polygon is used if it is fine enough.
+	Ring = Poly.GetFlattened(dTolerance)->GetPoints();
+
+	unsigned int nCount = 0;
+	for (unsigned int i = 0; i < Ring.size(); i++)
+	{
+		if (nCount == 0 || Ring[i] != Ring[nCount - 1])
+			Ring[nCount++] = Ring[i];
+	}
+	while (nCount > 1 && Ring[nCount - 1] == Ring[0])
+		nCount--;
+	Ring.resize(nCount);
+
+	double dArea = 0;
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		const C2DPoint& p1 = Ring[i];
+		const C2DPoint& p2 = Ring[(i + 1) % nCount];
+		dArea += p1.x * p2.y - p2.x * p1.y;
+	}
+	if ((dArea > 0) != bAnticlockwise)
+		reverse(Ring.begin(), Ring.end());
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::AddRawRing
+\brief Adds the raw outline of the ring moved to the right by the distance to the
+engine. Each corner is joined across the gap if the moved edges separate there and
+through the corner itself if they overlap. The round joins are added to the set if
+they are to be output as arcs.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::AddRawRing(const vector<C2DPoint>& Ring, double dDistance,
+								CPolygonBoolean& Engine, vector<sRoundJoin>& Joins) const
+{
+	const unsigned int nCount = Ring.size();
+	if (nCount < 3)
+		return;
+
+	// The unit vector along each edge and the unit normal to its right.
+	vector<C2DVector> Along(nCount);
+	vector<C2DVector> Normal(nCount);
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		C2DVector v(Ring[i], Ring[(i + 1) % nCount]);
+		v.MakeUnit();
+		Along[i] = v;
+		Normal[i].Set(v.j, -v.i);
+	}
+
+	const double dChordAngle = GetChordAngle(fabs(dDistance), GetTolerance(dDistance));
+	const double dMitreLimit2 = m_dMitreLimit * m_dMitreLimit;
+
+	vector<double> Coords;
+	Coords.reserve(nCount * 6);
+
+	for (unsigned int k = 0; k < nCount; k++)
+	{
+		const unsigned int j = (k == 0) ? nCount - 1 : k - 1;
+		const C2DPoint& pt = Ring[k];
+		const C2DVector& nj = Normal[j];
+		const C2DVector& nk = Normal[k];
+		const double dSin = Cross(Along[j], Along[k]);
+		const double dCos = Along[j].Dot(Along[k]);
+
+		C2DPoint q1(pt.x + dDistance * nj.i, pt.y + dDistance * nj.j);
+		C2DPoint q2(pt.x + dDistance * nk.i, pt.y + dDistance * nk.j);
+
+		const bool bStraight = fabs(dSin) < conStraightTurn;
+		if (bStraight && dCos > 0)
+		{
+			Coords.push_back(q2.x);
+			Coords.push_back(q2.y);
+			continue;
+		}
+
+		if (!bStraight && dSin * dDistance < 0)
+		{
+			// The moved edges overlap so go through the corner.
+			Coords.push_back(q1.x);
+			Coords.push_back(q1.y);
+			Coords.push_back(pt.x);
+			Coords.push_back(pt.y);
+			Coords.push_back(q2.x);
+			Coords.push_back(q2.y);
+			continue;
+		}
+
+		// A gap to be joined. The turn from nj to nk; a reversal turns through the front.
+		const double dTurn = bStraight ? (dDistance > 0 ? conPI : -conPI) : atan2(dSin, dCos);
+
+		eJoinType eJoin = m_eJoin;
+		if (eJoin == Mitre && (bStraight || 2 > dMitreLimit2 * (1 + dCos)))
+			eJoin = Square;
+
+		if (eJoin == Mitre)
+		{
+			const double dScale = dDistance / (1 + dCos);
+			Coords.push_back(pt.x + (nj.i + nk.i) * dScale);
+			Coords.push_back(pt.y + (nj.j + nk.j) * dScale);
+		}
+		else if (eJoin == Square)
+		{
+			// Cut the corner square to the bisector at the distance, or at the mitre limit.
+			const double dCut = (m_eJoin == Mitre) ? m_dMitreLimit : 1.0;
+			const double dHalf = fabs(dTurn) / 2;
+			const double dStep = fabs(dDistance) * (dCut - cos(dHalf)) / sin(dHalf);
+			Coords.push_back(q1.x + Along[j].i * dStep);
+			Coords.push_back(q1.y + Along[j].j * dStep);
+			Coords.push_back(q2.x - Along[k].i * dStep);
+			Coords.push_back(q2.y - Along[k].j * dStep);
+		}
+		else
+		{
+			const unsigned int nSteps = max(1u, (unsigned int)ceil(fabs(dTurn) / dChordAngle));
+			const double dStepSin = sin(dTurn / nSteps);
+			const double dStepCos = cos(dTurn / nSteps);
+			double x = nj.i * dDistance;
+			double y = nj.j * dDistance;
+
+			const unsigned int nFirst = Coords.size();
+			Coords.push_back(q1.x);
+			Coords.push_back(q1.y);
+			for (unsigned int s = 1; s < nSteps; s++)
+			{
+				const double dx = x * dStepCos - y * dStepSin;
+				y = x * dStepSin + y * dStepCos;
+				x = dx;
+				Coords.push_back(pt.x + x);
+				Coords.push_back(pt.y + y);
+			}
+			Coords.push_back(q2.x);
+			Coords.push_back(q2.y);
+
+			if (m_bArcOutput)
+			{
+				Joins.push_back(sRoundJoin());
+				sRoundJoin& Join = Joins.back();
+				Join.Centre = pt;
+				for (unsigned int c = nFirst; c < Coords.size(); c += 2)
+					Join.Points.push_back(C2DPoint(Coords[c], Coords[c + 1]));
+			}
+		}
+	}
+
+	Engine.AddSubject(Coords);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+InSector <BR>
+\brief True if the direction w is between u and v, turning from u to v the shorter
+way.
+<P>---------------------------------------------------------------------------*/
+static bool InSector(const C2DVector& u, const C2DVector& v, const C2DVector& w)
+{
+	if (Cross(u, v) >= 0)
+		return Cross(u, w) >= 0 && Cross(w, v) >= 0;
+	return Cross(u, w) <= 0 && Cross(w, v) <= 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::MakeArcs
+\brief Replaces the chords of the round joins in the rings of the result from the
+index given by arcs. A result edge is part of a join if both its ends are points of
+the join or one is and the other lies on a chord of the join where the outline was
+cut. Each run of edges of the same join becomes a single arc.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::MakeArcs(const vector<sRoundJoin>& Joins, double dDistance,
+							  C2DHoledPolyBaseSet& Result, unsigned int nFrom) const
+{
+	if (Joins.empty())
+		return;
+
+	const double dRadius = fabs(dDistance);
+	const double dTolerance = GetTolerance(dDistance);
+
+	// The join each point of a join belongs to, found by its exact position.
+	map< pair<double, double>, unsigned int > JoinOf;
+	for (unsigned int i = 0; i < Joins.size(); i++)
+	{
+		const vector<C2DPoint>& Points = Joins[i].Points;
+		for (unsigned int j = 0; j < Points.size(); j++)
+			JoinOf[make_pair(Points[j].x, Points[j].y)] = i;
+	}
+
+	const unsigned int conNoJoin = 0xFFFFFFFF;
+
+	for (unsigned int p = nFrom; p < Result.size(); p++)
+	{
+		C2DHoledPolyBase* pHoled = Result.GetAt(p);
+		C2DHoledPolyBase* pNew = new C2DHoledPolyBase;
+
+		for (int r = -1; r < (int)pHoled->GetHoleCount(); r++)
+		{
+			const C2DPolyBase* pRing = (r < 0) ? pHoled->GetRim() : pHoled->GetHole(r);
+			const unsigned int nCount = pRing->GetLineCount();
+
+			vector<C2DPoint> Points(nCount);
+			vector<unsigned int> PointJoin(nCount, conNoJoin);
+			for (unsigned int i = 0; i < nCount; i++)
+			{
+				Points[i] = pRing->GetLine(i)->GetPointFrom();
+				map< pair<double, double>, unsigned int >::const_iterator It =
+					JoinOf.find(make_pair(Points[i].x, Points[i].y));
+				if (It != JoinOf.end())
+					PointJoin[i] = It->second;
+			}
+
+			// The join of each edge, if any.
+			vector<unsigned int> EdgeJoin(nCount, conNoJoin);
+			for (unsigned int i = 0; i < nCount; i++)
+			{
+				const unsigned int n = (i + 1) % nCount;
+				unsigned int nJoin = PointJoin[i];
+				unsigned int nOther = n;
+				if (nJoin == conNoJoin || (PointJoin[n] != conNoJoin && PointJoin[n] != nJoin))
+				{
+					nJoin = PointJoin[n];
+					nOther = i;
+				}
+				if (nJoin == conNoJoin)
+					continue;
+				if (PointJoin[nOther] == nJoin)
+				{
+					EdgeJoin[i] = nJoin;
+					continue;
+				}
+				// The other end is a cut point so must be on a chord within the join.
+				const sRoundJoin& Join = Joins[nJoin];
+				C2DVector w(Join.Centre, Points[nOther]);
+				const double dLength = w.GetLength();
+				if (dLength <= dRadius * (1 + 1e-9) && dLength >= dRadius - 2 * dTolerance &&
+					InSector(C2DVector(Join.Centre, Join.Points.front()),
+							 C2DVector(Join.Centre, Join.Points.back()), w))
+				{
+					EdgeJoin[i] = nJoin;
+				}
+			}
+
+			// Start at an edge which does not continue an arc from the one before.
+			unsigned int nStart = 0;
+			while (nStart < nCount && EdgeJoin[nStart] != conNoJoin &&
+				   EdgeJoin[(nStart + nCount - 1) % nCount] == EdgeJoin[nStart])
+			{
+				nStart++;
+			}
+			if (nStart == nCount)
+				nStart = 0;
+
+			C2DLineBaseSet Lines;
+			unsigned int i = 0;
+			while (i < nCount)
+			{
+				const unsigned int e = (nStart + i) % nCount;
+				const C2DPoint& PtFrom = Points[e];
+				if (EdgeJoin[e] == conNoJoin)
+				{
+					Lines.Add(new C2DLine(PtFrom, Points[(e + 1) % nCount]));
+					i++;
+					continue;
+				}
+
+				unsigned int nRun = 1;
+				while (i + nRun < nCount && EdgeJoin[(e + nRun) % nCount] == EdgeJoin[e])
+					nRun++;
+				const C2DPoint& PtTo = Points[(e + nRun) % nCount];
+				const C2DPoint& Centre = Joins[EdgeJoin[e]].Centre;
+
+				const bool bCentreOnRight = GeoPredicates::Orient2D(PtFrom.x, PtFrom.y,
+										PtTo.x, PtTo.y, Centre.x, Centre.y) < 0;
+				const double dArcRadius = max(dRadius, PtFrom.Distance(PtTo) / 2);
+				Lines.Add(new C2DArc(PtFrom, PtTo, dArcRadius, bCentreOnRight, !bCentreOnRight));
+				i += nRun;
+			}
+
+			C2DPolyBase* pPoly = new C2DPolyBase;
+			pPoly->CreateDirect(Lines);
+			if (r < 0)
+				pNew->SetRimDirect(pPoly);
+			else
+				pNew->AddHoleDirect(pPoly);
+		}
+
+		Result.DeleteAndSet(p, pNew);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::Offset
+\brief Offsets the rings, the rim anticlockwise and the holes clockwise, adding the
+result to the set.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::Offset(const vector< vector<C2DPoint> >& Rings, double dDistance,
+							C2DHoledPolyBaseSet& Result) const
+{
+	CPolygonBoolean Engine;
+	vector<sRoundJoin> Joins;
+
+	for (unsigned int r = 0; r < Rings.size(); r++)
+	{
+		if (dDistance != 0)
+		{
+			AddRawRing(Rings[r], dDistance, Engine, Joins);
+		}
+		else if (Rings[r].size() >= 3)
+		{
+			vector<double> Coords;
+			for (unsigned int i = 0; i < Rings[r].size(); i++)
+			{
+				Coords.push_back(Rings[r][i].x);
+				Coords.push_back(Rings[r][i].y);
+			}
+			Engine.AddSubject(Coords);
+		}
+	}
+
+	const unsigned int nFrom = Result.size();
+	Engine.ExecutePositiveUnion(Result);
+
+	if (m_bArcOutput && m_eJoin == Round)
+		MakeArcs(Joins, dDistance, Result, nFrom);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::Execute
+\brief Offsets the polygon by the distance, outwards if positive and inwards if
+negative, adding the resulting shapes to the set.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::Execute(const C2DPolyBase& Poly, double dDistance,
+							 C2DHoledPolyBaseSet& Result) const
+{
+	vector< vector<C2DPoint> > Rings(1);
+	GetRing(Poly, Rings[0], true, GetTolerance(dDistance));
+	Offset(Rings, dDistance, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::Execute
+\brief Offsets the holed polygon by the distance, outwards if positive and inwards
+if negative, adding the resulting shapes to the set. The holes shrink as the rim
+grows.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::Execute(const C2DHoledPolyBase& Poly, double dDistance,
+							 C2DHoledPolyBaseSet& Result) const
+{
+	if (Poly.GetRim() == 0)
+		return;
+
+	const double dTolerance = GetTolerance(dDistance);
+	vector< vector<C2DPoint> > Rings(Poly.GetHoleCount() + 1);
+	GetRing(*Poly.GetRim(), Rings[0], true, dTolerance);
+	for (unsigned int h = 0; h < Poly.GetHoleCount(); h++)
+		GetRing(*Poly.GetHole(h), Rings[h + 1], false, dTolerance);
+
+	Offset(Rings, dDistance, Result);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonOffset::Execute
+\brief Offsets each of the holed polygons by the distance, sharing them between
+nThreads threads (0 for one per hardware thread). The results are added to the set
+in the order of the shapes they came from.
+<P>---------------------------------------------------------------------------*/
+void CPolygonOffset::Execute(const C2DHoledPolyBaseSet& Polys, double dDistance,
+							 C2DHoledPolyBaseSet& Result, unsigned int nThreads) const
+{
+	const unsigned int nCount = Polys.size();
+	if (nCount == 0)
+		return;
+
+	if (nThreads == 0)
+		nThreads = max(1u, thread::hardware_concurrency());
+	const unsigned int nWorkers = min(nThreads, nCount);
+
+	vector<C2DHoledPolyBaseSet*> Results(nCount);
+	for (unsigned int i = 0; i < nCount; i++)
+		Results[i] = new C2DHoledPolyBaseSet;
+	atomic<unsigned int> nNext(0);
+
+	auto Worker = [&]()
+	{
+		unsigned int i;
+		while ((i = nNext++) < nCount)
+			Execute(Polys[i], dDistance, *Results[i]);
+	};
+
+	vector<thread> Threads;
+	for (unsigned int i = 1; i < nWorkers; i++)
+		Threads.push_back(thread(Worker));
+	Worker();
+	for (unsigned int i = 0; i < Threads.size(); i++)
+		Threads[i].join();
+
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		Result << *Results[i];
+		delete Results[i];
+	}
+}
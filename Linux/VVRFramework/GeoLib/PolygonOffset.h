@@ -0,0 +1,123 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PolygonOffset.h
+\brief Declaration file for the CPolygonOffset class.
+
+Declaration file for CPolygonOffset, a polygon offsetting (buffering) engine.
+
+\class CPolygonOffset
+\brief Offsets polygons and holed polygons outwards or inwards by a distance.
+
+Every edge of every ring is moved out by the distance, the rims being taken
+anticlockwise and the holes clockwise so that outwards is always to the right. Where
+the moved edges leave a gap at a corner they are joined by a mitre, a square or a
+round join. Where they overlap they are joined through the original corner. The raw
+outlines this gives may cross themselves and each other so they are resolved by the
+sweep line engine, CPolygonBoolean, keeping the areas they wind around positively.
+A negative distance shrinks the shape and may split it or remove it entirely.
+
+Arcs in the input are followed by chords no further than the arc tolerance from the
+arc. The round joins are output as chords too, or as arcs (C2DArc) if arc output is
+set.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CPOLYGONOFFSET_H
+#define _GEOLIB_CPOLYGONOFFSET_H
+
+#include "C2DPoint.h"
+
+class C2DPolyBase;
+class C2DHoledPolyBase;
+class C2DHoledPolyBaseSet;
+class CPolygonBoolean;
+
+class GeoLib_API CPolygonOffset
+{
+public:
+	/// The ways of joining the moved edges at a corner.
+	enum eJoinType
+	{
+		Mitre,
+		Round,
+		Square,
+	};
+
+	/// Constructor, for round joins.
+	CPolygonOffset(void);
+	/// Constructor.
+	CPolygonOffset(eJoinType eJoin, double dMitreLimit = 2.0, double dArcTolerance = 0);
+	/// Destructor.
+	~CPolygonOffset(void);
+
+	/// Sets the join type.
+	void SetJoinType(eJoinType eJoin) {m_eJoin = eJoin;}
+	/// The join type.
+	eJoinType GetJoinType(void) const {return m_eJoin;}
+	/// Sets the furthest a mitre can reach from the corner, as a multiple of the
+	/// distance, beyond which it is squared off. At least 1.
+	void SetMitreLimit(double dLimit);
+	/// The mitre limit.
+	double GetMitreLimit(void) const {return m_dMitreLimit;}
+	/// Sets the furthest the chords of arcs and round joins can be from the true curve.
+	/// 0 for a thousandth of the distance.
+	void SetArcTolerance(double dTolerance) {m_dArcTolerance = dTolerance;}
+	/// The arc tolerance.
+	double GetArcTolerance(void) const {return m_dArcTolerance;}
+	/// Sets whether the round joins are given as arcs rather than chords.
+	void SetArcOutput(bool bArcs) {m_bArcOutput = bArcs;}
+	/// True if the round joins are given as arcs.
+	bool GetArcOutput(void) const {return m_bArcOutput;}
+
+	/// Offsets the polygon by the distance, outwards if positive, adding the result to the set.
+	void Execute(const C2DPolyBase& Poly, double dDistance, C2DHoledPolyBaseSet& Result) const;
+	/// Offsets the holed polygon by the distance, outwards if positive, adding the result to the set.
+	void Execute(const C2DHoledPolyBase& Poly, double dDistance, C2DHoledPolyBaseSet& Result) const;
+	/// Offsets each of the holed polygons on nThreads threads (0 for one per hardware
+	/// thread), adding the results to the set in the same order.
+	void Execute(const C2DHoledPolyBaseSet& Polys, double dDistance, C2DHoledPolyBaseSet& Result,
+				unsigned int nThreads = 0) const;
+
+private:
+	/// A round join, kept to make the output arcs.
+	struct sRoundJoin
+	{
+		/// The corner.
+		C2DPoint Centre;
+		/// The points of the join.
+		std::vector<C2DPoint> Points;
+	};
+
+	/// Offsets the rings, the first being the rim, adding the result to the set.
+	void Offset(const std::vector< std::vector<C2DPoint> >& Rings, double dDistance,
+				C2DHoledPolyBaseSet& Result) const;
+	/// Adds the raw outline of the ring moved by the distance to the engine.
+	void AddRawRing(const std::vector<C2DPoint>& Ring, double dDistance, CPolygonBoolean& Engine,
+				std::vector<sRoundJoin>& Joins) const;
+	/// Replaces the chords of the round joins in the result from the index given by arcs.
+	void MakeArcs(const std::vector<sRoundJoin>& Joins, double dDistance,
+				C2DHoledPolyBaseSet& Result, unsigned int nFrom) const;
+	/// The arc tolerance to use for the distance.
+	double GetTolerance(double dDistance) const;
+	/// The greatest angle of a chord of a circle within the tolerance of the circle.
+	static double GetChordAngle(double dRadius, double dTolerance);
+	/// Gets the ring of points of the polygon, following any arcs by chords.
+	static void GetRing(const C2DPolyBase& Poly, std::vector<C2DPoint>& Ring,
+				bool bAnticlockwise, double dTolerance);
+
+	/// The join type.
+	eJoinType m_eJoin;
+	/// The mitre limit.
+	double m_dMitreLimit;
+	/// The arc tolerance.
+	double m_dArcTolerance;
+	/// True for round joins as arcs.
+	bool m_bArcOutput;
+};
+
+#endif
@@ -0,0 +1,1261 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PolygonTriangulator.cpp
+\brief Implementation file for the CPolygonTriangulator class.
+
+Implementation file for CPolygonTriangulator. The ear clipping follows the earcut
+algorithm (V. Agafonkin, Mapbox): z-order hashed ear tests, hole bridging by
+finding the visible rim vertex to the left of each hole and, if the clipping
+stalls, curing local self intersections and then splitting the ring along a valid
+diagonal.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "PolygonTriangulator.h"
+#include "Predicates.h"
+#include "C2DPolyBase.h"
+#include "C2DHoledPolyBase.h"
+#include "C2DLineBase.h"
+#include "C2DPolygon.h"
+#include "C2DPolygonSet.h"
+#include "C2DPointSet.h"
+#include "IndexSet.h"
+#include <deque>
+#include <algorithm>
+#include <unordered_map>
+#include <limits>
+
+using namespace std;
+
+/// Number of points above which the ear tests use the z-order index.
+const unsigned int conHashedEarThreshold = 80;
+
+
+/**--------------------------------------------------------------------------<BR>
+\struct sTriNode
+\brief A vertex in the rings being clipped.
+<P>---------------------------------------------------------------------------*/
+struct sTriNode
+{
+	/// The point index.
+	unsigned int i;
+	/// The coordinates.
+	double x;
+	double y;
+	/// The previous and next vertex in the ring.
+	sTriNode* prev;
+	sTriNode* next;
+	/// The z-order value and the previous and next vertex in z-order.
+	unsigned int z;
+	sTriNode* prevZ;
+	sTriNode* nextZ;
+	/// True for a hole of a single point.
+	bool steiner;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+\class CEarClipper
+\brief Triangulates a set of rings by ear clipping.
+<P>---------------------------------------------------------------------------*/
+class CEarClipper
+{
+public:
+	/// Constructor.
+	CEarClipper(const vector<double>& Coords, vector<unsigned int>& Triangles)
+		: m_Coords(Coords), m_Triangles(Triangles), m_dMinX(0), m_dMinY(0), m_dInvSize(0) {;}
+
+	/// Triangulates the rings, the first being the rim.
+	void Run(const vector<unsigned int>& RingStarts);
+
+private:
+	/// Makes a ring of nodes in the orientation required.
+	sTriNode* MakeRing(unsigned int nStart, unsigned int nEnd, bool bAnticlockwise);
+	/// Inserts a node after the last.
+	sTriNode* InsertNode(unsigned int i, sTriNode* pLast);
+	/// Removes a node from the rings.
+	static void RemoveNode(sTriNode* p);
+	/// Removes duplicate and collinear points.
+	static sTriNode* FilterPoints(sTriNode* pStart, sTriNode* pEnd = 0);
+	/// The main ear clipping loop.
+	void ClipEars(sTriNode* pEar, unsigned int nPass);
+	/// True if the node is an ear.
+	static bool IsEar(sTriNode* pEar);
+	/// True if the node is an ear using the z-order index.
+	bool IsEarHashed(sTriNode* pEar) const;
+	/// Clips the triangles formed by local self intersections.
+	sTriNode* CureLocalIntersections(sTriNode* pStart);
+	/// Splits the ring in 2 along a valid diagonal and clips both.
+	void SplitEarcut(sTriNode* pStart);
+	/// Links all the holes into the rim.
+	sTriNode* EliminateHoles(const vector<unsigned int>& RingStarts, sTriNode* pOuter);
+	/// Links the hole into the rim.
+	sTriNode* EliminateHole(sTriNode* pHole, sTriNode* pOuter);
+	/// Finds a rim vertex to connect the hole to.
+	static sTriNode* FindHoleBridge(sTriNode* pHole, sTriNode* pOuter);
+	/// Splits the ring along the diagonal a to b.
+	sTriNode* SplitPolygon(sTriNode* a, sTriNode* b);
+	/// Builds the z-order index.
+	void IndexCurve(sTriNode* pStart);
+	/// Sorts the z-order list.
+	static sTriNode* SortLinked(sTriNode* pList);
+	/// The z-order value of the point.
+	unsigned int ZOrder(double x, double y) const;
+	/// Adds a triangle.
+	void AddTriangle(const sTriNode* a, const sTriNode* b, const sTriNode* c);
+
+	/// Signed area of the triangle, negative if anticlockwise.
+	static double Area(const sTriNode* p, const sTriNode* q, const sTriNode* r)
+	{
+		return -GeoPredicates::Orient2D(p->x, p->y, q->x, q->y, r->x, r->y);
+	}
+	/// True if the nodes are at the same place.
+	static bool Equals(const sTriNode* p, const sTriNode* q) {return p->x == q->x && p->y == q->y;}
+	/// True if p is in the triangle a, b, c or on its edge.
+	static bool PointInTriangle(double ax, double ay, double bx, double by, double cx,
+		double cy, double px, double py);
+	/// True if the segments p1-q1 and p2-q2 intersect.
+	static bool Intersects(const sTriNode* p1, const sTriNode* q1, const sTriNode* p2, const sTriNode* q2);
+	/// True if q lies on the segment p-r given they are collinear.
+	static bool OnSegment(const sTriNode* p, const sTriNode* q, const sTriNode* r);
+	/// True if the diagonal a to b crosses an edge of the ring.
+	static bool IntersectsPolygon(const sTriNode* a, const sTriNode* b);
+	/// True if the diagonal a to b is locally inside the ring at a.
+	static bool LocallyInside(const sTriNode* a, const sTriNode* b);
+	/// True if the middle of the diagonal a to b is inside the ring.
+	static bool MiddleInside(const sTriNode* a, const sTriNode* b);
+	/// True if the diagonal a to b can be used to split the ring.
+	static bool IsValidDiagonal(const sTriNode* a, const sTriNode* b);
+	/// True if the sector at p is within the sector at m.
+	static bool SectorContainsSector(const sTriNode* m, const sTriNode* p);
+	/// Returns the leftmost node of the ring.
+	static sTriNode* GetLeftmost(sTriNode* pStart);
+	/// Sign of the value.
+	static int Sign(double d) {return d > 0 ? 1 : (d < 0 ? -1 : 0);}
+
+	/// The coordinates, x and y for each point.
+	const vector<double>& m_Coords;
+	/// The result.
+	vector<unsigned int>& m_Triangles;
+	/// The nodes.
+	deque<sTriNode> m_Nodes;
+	/// The z-order index parameters, no index is used if the size is 0.
+	double m_dMinX;
+	double m_dMinY;
+	double m_dInvSize;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::Run
+\brief Triangulates the rings, the first being the rim.
+<P>---------------------------------------------------------------------------*/
+void CEarClipper::Run(const vector<unsigned int>& RingStarts)
+{
+	unsigned int nCount = m_Coords.size() / 2;
+	unsigned int nOuterEnd = RingStarts.size() > 1 ? RingStarts[1] : nCount;
+
+	sTriNode* pOuter = MakeRing(0, nOuterEnd, true);
+	if (pOuter == 0 || pOuter->next == pOuter->prev)
+		return;
+
+	if (RingStarts.size() > 1)
+		pOuter = EliminateHoles(RingStarts, pOuter);
+
+	if (nCount > conHashedEarThreshold)
+	{
+		double dMaxX = m_Coords[0];
+		double dMaxY = m_Coords[1];
+		m_dMinX = dMaxX;
+		m_dMinY = dMaxY;
+		for (unsigned int i = 1; i < nOuterEnd; i++)
+		{
+			double x = m_Coords[2 * i];
+			double y = m_Coords[2 * i + 1];
+			if (x < m_dMinX) m_dMinX = x;
+			if (y < m_dMinY) m_dMinY = y;
+			if (x > dMaxX) dMaxX = x;
+			if (y > dMaxY) dMaxY = y;
+		}
+		double dSize = max(dMaxX - m_dMinX, dMaxY - m_dMinY);
+		m_dInvSize = dSize != 0 ? 32767.0 / dSize : 0;
+	}
+
+	ClipEars(pOuter, 0);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::MakeRing
+\brief Makes a ring of nodes from the points given in the orientation required.
+Returns the last node.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::MakeRing(unsigned int nStart, unsigned int nEnd, bool bAnticlockwise)
+{
+	if (nEnd <= nStart)
+		return 0;
+
+	double dSum = 0;
+	for (unsigned int i = nStart, j = nEnd - 1; i < nEnd; j = i++)
+		dSum += (m_Coords[2 * j] - m_Coords[2 * i]) * (m_Coords[2 * i + 1] + m_Coords[2 * j + 1]);
+
+	sTriNode* pLast = 0;
+	if (bAnticlockwise == (dSum > 0))
+	{
+		for (unsigned int i = nStart; i < nEnd; i++)
+			pLast = InsertNode(i, pLast);
+	}
+	else
+	{
+		for (unsigned int i = nEnd; i > nStart; i--)
+			pLast = InsertNode(i - 1, pLast);
+	}
+
+	if (pLast != 0 && Equals(pLast, pLast->next))
+	{
+		RemoveNode(pLast);
+		pLast = pLast->next;
+	}
+
+	return pLast;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::InsertNode
+\brief Inserts a node after the last.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::InsertNode(unsigned int i, sTriNode* pLast)
+{
+	sTriNode Node;
+	Node.i = i;
+	Node.x = m_Coords[2 * i];
+	Node.y = m_Coords[2 * i + 1];
+	Node.z = 0;
+	Node.prevZ = 0;
+	Node.nextZ = 0;
+	Node.steiner = false;
+	m_Nodes.push_back(Node);
+	sTriNode* p = &m_Nodes.back();
+
+	if (pLast == 0)
+	{
+		p->prev = p;
+		p->next = p;
+	}
+	else
+	{
+		p->next = pLast->next;
+		p->prev = pLast;
+		pLast->next->prev = p;
+		pLast->next = p;
+	}
+	return p;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::RemoveNode
+\brief Removes a node from the ring and the z-order list.
+<P>---------------------------------------------------------------------------*/
+void CEarClipper::RemoveNode(sTriNode* p)
+{
+	p->next->prev = p->prev;
+	p->prev->next = p->next;
+
+	if (p->prevZ != 0) p->prevZ->nextZ = p->nextZ;
+	if (p->nextZ != 0) p->nextZ->prevZ = p->prevZ;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::FilterPoints
+\brief Removes duplicate and collinear points from pStart up to pEnd.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::FilterPoints(sTriNode* pStart, sTriNode* pEnd)
+{
+	if (pStart == 0)
+		return pStart;
+	if (pEnd == 0)
+		pEnd = pStart;
+
+	sTriNode* p = pStart;
+	bool bAgain;
+	do
+	{
+		bAgain = false;
+
+		if (!p->steiner && (Equals(p, p->next) || Area(p->prev, p, p->next) == 0))
+		{
+			RemoveNode(p);
+			p = pEnd = p->prev;
+			if (p == p->next)
+				break;
+			bAgain = true;
+		}
+		else
+		{
+			p = p->next;
+		}
+	} while (bAgain || p != pEnd);
+
+	return pEnd;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::ClipEars
+\brief The main ear clipping loop. Pass 0 is the plain clipping, pass 1 first
+removes collinear points, pass 2 first cures local self intersections and
+if that fails the ring is split.
+<P>---------------------------------------------------------------------------*/
+void CEarClipper::ClipEars(sTriNode* pEar, unsigned int nPass)
+{
+	if (pEar == 0)
+		return;
+
+	if (nPass == 0 && m_dInvSize != 0)
+		IndexCurve(pEar);
+
+	sTriNode* pStop = pEar;
+
+	while (pEar->prev != pEar->next)
+	{
+		sTriNode* pPrev = pEar->prev;
+		sTriNode* pNext = pEar->next;
+
+		if (m_dInvSize != 0 ? IsEarHashed(pEar) : IsEar(pEar))
+		{
+			AddTriangle(pPrev, pEar, pNext);
+
+			RemoveNode(pEar);
+
+			// Skipping the next vertex leads to less sliver triangles.
+			pEar = pNext->next;
+			pStop = pNext->next;
+			continue;
+		}
+
+		pEar = pNext;
+
+		if (pEar == pStop)
+		{
+			if (nPass == 0)
+			{
+				ClipEars(FilterPoints(pEar), 1);
+			}
+			else if (nPass == 1)
+			{
+				pEar = CureLocalIntersections(FilterPoints(pEar));
+				ClipEars(pEar, 2);
+			}
+			else
+			{
+				SplitEarcut(pEar);
+			}
+			break;
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::IsEar
+\brief True if the node is convex and no other point is in its triangle.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::IsEar(sTriNode* pEar)
+{
+	const sTriNode* a = pEar->prev;
+	const sTriNode* b = pEar;
+	const sTriNode* c = pEar->next;
+
+	if (Area(a, b, c) >= 0)
+		return false;
+
+	double x0 = min(a->x, min(b->x, c->x));
+	double y0 = min(a->y, min(b->y, c->y));
+	double x1 = max(a->x, max(b->x, c->x));
+	double y1 = max(a->y, max(b->y, c->y));
+
+	const sTriNode* p = c->next;
+	while (p != a)
+	{
+		if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 &&
+			PointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+			Area(p->prev, p, p->next) >= 0)
+			return false;
+		p = p->next;
+	}
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::IsEarHashed
+\brief True if the node is an ear, only checks the points within the z-order range
+of the triangle.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::IsEarHashed(sTriNode* pEar) const
+{
+	const sTriNode* a = pEar->prev;
+	const sTriNode* b = pEar;
+	const sTriNode* c = pEar->next;
+
+	if (Area(a, b, c) >= 0)
+		return false;
+
+	double x0 = min(a->x, min(b->x, c->x));
+	double y0 = min(a->y, min(b->y, c->y));
+	double x1 = max(a->x, max(b->x, c->x));
+	double y1 = max(a->y, max(b->y, c->y));
+
+	unsigned int nMinZ = ZOrder(x0, y0);
+	unsigned int nMaxZ = ZOrder(x1, y1);
+
+	const sTriNode* p = pEar->prevZ;
+	const sTriNode* n = pEar->nextZ;
+
+	// Look both ways along the curve.
+	while (p != 0 && p->z >= nMinZ && n != 0 && n->z <= nMaxZ)
+	{
+		if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 && p != a && p != c &&
+			PointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+			Area(p->prev, p, p->next) >= 0)
+			return false;
+		p = p->prevZ;
+
+		if (n->x >= x0 && n->x <= x1 && n->y >= y0 && n->y <= y1 && n != a && n != c &&
+			PointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, n->x, n->y) &&
+			Area(n->prev, n, n->next) >= 0)
+			return false;
+		n = n->nextZ;
+	}
+
+	while (p != 0 && p->z >= nMinZ)
+	{
+		if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 && p != a && p != c &&
+			PointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+			Area(p->prev, p, p->next) >= 0)
+			return false;
+		p = p->prevZ;
+	}
+
+	while (n != 0 && n->z <= nMaxZ)
+	{
+		if (n->x >= x0 && n->x <= x1 && n->y >= y0 && n->y <= y1 && n != a && n != c &&
+			PointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, n->x, n->y) &&
+			Area(n->prev, n, n->next) >= 0)
+			return false;
+		n = n->nextZ;
+	}
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::CureLocalIntersections
+\brief Clips the triangles where 2 consecutive edges cross.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::CureLocalIntersections(sTriNode* pStart)
+{
+	sTriNode* p = pStart;
+	do
+	{
+		sTriNode* a = p->prev;
+		sTriNode* b = p->next->next;
+
+		if (!Equals(a, b) && Intersects(a, p, p->next, b) && LocallyInside(a, b) && LocallyInside(b, a))
+		{
+			AddTriangle(a, p, b);
+
+			RemoveNode(p);
+			RemoveNode(p->next);
+
+			p = pStart = b;
+		}
+		p = p->next;
+	} while (p != pStart);
+
+	return FilterPoints(p);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::SplitEarcut
+\brief Finds a valid diagonal, splits the ring along it and clips both parts.
+<P>---------------------------------------------------------------------------*/
+void CEarClipper::SplitEarcut(sTriNode* pStart)
+{
+	sTriNode* a = pStart;
+	do
+	{
+		sTriNode* b = a->next->next;
+		while (b != a->prev)
+		{
+			if (a->i != b->i && IsValidDiagonal(a, b))
+			{
+				sTriNode* c = SplitPolygon(a, b);
+
+				a = FilterPoints(a, a->next);
+				c = FilterPoints(c, c->next);
+
+				ClipEars(a, 0);
+				ClipEars(c, 0);
+				return;
+			}
+			b = b->next;
+		}
+		a = a->next;
+	} while (a != pStart);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::EliminateHoles
+\brief Links all the holes into the rim from left to right.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::EliminateHoles(const vector<unsigned int>& RingStarts, sTriNode* pOuter)
+{
+	unsigned int nCount = m_Coords.size() / 2;
+
+	vector<sTriNode*> Queue;
+	for (unsigned int h = 1; h < RingStarts.size(); h++)
+	{
+		unsigned int nEnd = h + 1 < RingStarts.size() ? RingStarts[h + 1] : nCount;
+		sTriNode* pList = MakeRing(RingStarts[h], nEnd, false);
+		if (pList == 0)
+			continue;
+		if (pList == pList->next)
+			pList->steiner = true;
+		Queue.push_back(GetLeftmost(pList));
+	}
+
+	sort(Queue.begin(), Queue.end(), [](const sTriNode* p, const sTriNode* q) {return p->x < q->x;});
+
+	for (unsigned int i = 0; i < Queue.size(); i++)
+		pOuter = EliminateHole(Queue[i], pOuter);
+
+	return pOuter;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::EliminateHole
+\brief Links the hole into the rim with a pair of coincident bridge edges.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::EliminateHole(sTriNode* pHole, sTriNode* pOuter)
+{
+	sTriNode* pBridge = FindHoleBridge(pHole, pOuter);
+	if (pBridge == 0)
+		return pOuter;
+
+	sTriNode* pBridgeReverse = SplitPolygon(pBridge, pHole);
+
+	FilterPoints(pBridgeReverse, pBridgeReverse->next);
+	return FilterPoints(pBridge, pBridge->next);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::FindHoleBridge
+\brief Finds a rim vertex visible from the leftmost point of the hole (D. Eberly).
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::FindHoleBridge(sTriNode* pHole, sTriNode* pOuter)
+{
+	sTriNode* p = pOuter;
+	double hx = pHole->x;
+	double hy = pHole->y;
+	double qx = -numeric_limits<double>::infinity();
+	sTriNode* m = 0;
+
+	// Find the segment to the left of the hole point crossed by a ray going left.
+	do
+	{
+		if (hy <= p->y && hy >= p->next->y && p->next->y != p->y)
+		{
+			double x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+			if (x <= hx && x > qx)
+			{
+				qx = x;
+				m = p->x < p->next->x ? p : p->next;
+				if (x == hx)
+					return m;
+			}
+		}
+		p = p->next;
+	} while (p != pOuter);
+
+	if (m == 0)
+		return 0;
+
+	// Look for points inside the triangle of the hole point, the segment intersection
+	// and the end point. If there are none then that is the bridge point, else choose
+	// the point of the minimum angle with the ray.
+	const sTriNode* pStop = m;
+	double mx = m->x;
+	double my = m->y;
+	double dTanMin = numeric_limits<double>::infinity();
+
+	p = m;
+	do
+	{
+		if (hx >= p->x && p->x >= mx && hx != p->x &&
+			PointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y))
+		{
+			double dTan = fabs(hy - p->y) / (hx - p->x);
+
+			if (LocallyInside(p, pHole) &&
+				(dTan < dTanMin || (dTan == dTanMin && (p->x > m->x || (p->x == m->x && SectorContainsSector(m, p))))))
+			{
+				m = p;
+				dTanMin = dTan;
+			}
+		}
+		p = p->next;
+	} while (p != pStop);
+
+	return m;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::SplitPolygon
+\brief Splits the ring in 2 along the diagonal a to b by duplicating a and b.
+Returns the copy of b which is in the ring not containing a.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::SplitPolygon(sTriNode* a, sTriNode* b)
+{
+	sTriNode* an = a->next;
+	sTriNode* bp = b->prev;
+
+	sTriNode* a2 = InsertNode(a->i, 0);
+	sTriNode* b2 = InsertNode(b->i, 0);
+
+	a->next = b;
+	b->prev = a;
+
+	a2->next = an;
+	an->prev = a2;
+
+	b2->next = a2;
+	a2->prev = b2;
+
+	bp->next = b2;
+	b2->prev = bp;
+
+	return b2;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::IndexCurve
+\brief Gives each node its z-order value and sorts them along the curve.
+<P>---------------------------------------------------------------------------*/
+void CEarClipper::IndexCurve(sTriNode* pStart)
+{
+	sTriNode* p = pStart;
+	do
+	{
+		if (p->z == 0)
+			p->z = ZOrder(p->x, p->y);
+		p->prevZ = p->prev;
+		p->nextZ = p->next;
+		p = p->next;
+	} while (p != pStart);
+
+	p->prevZ->nextZ = 0;
+	p->prevZ = 0;
+
+	SortLinked(p);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::SortLinked
+\brief Sorts the z-order list with a bottom up merge sort (S. Tatham).
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::SortLinked(sTriNode* pList)
+{
+	unsigned int nInSize = 1;
+	unsigned int nMerges;
+
+	do
+	{
+		sTriNode* p = pList;
+		sTriNode* pTail = 0;
+		pList = 0;
+		nMerges = 0;
+
+		while (p != 0)
+		{
+			nMerges++;
+			sTriNode* q = p;
+			unsigned int nPSize = 0;
+			for (unsigned int i = 0; i < nInSize; i++)
+			{
+				nPSize++;
+				q = q->nextZ;
+				if (q == 0)
+					break;
+			}
+			unsigned int nQSize = nInSize;
+
+			while (nPSize > 0 || (nQSize > 0 && q != 0))
+			{
+				sTriNode* e;
+				if (nPSize != 0 && (nQSize == 0 || q == 0 || p->z <= q->z))
+				{
+					e = p;
+					p = p->nextZ;
+					nPSize--;
+				}
+				else
+				{
+					e = q;
+					q = q->nextZ;
+					nQSize--;
+				}
+
+				if (pTail != 0)
+					pTail->nextZ = e;
+				else
+					pList = e;
+
+				e->prevZ = pTail;
+				pTail = e;
+			}
+			p = q;
+		}
+
+		pTail->nextZ = 0;
+		nInSize *= 2;
+
+	} while (nMerges > 1);
+
+	return pList;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::ZOrder
+\brief The z-order value of the point, the coordinates are scaled to 15 bits and
+their bits interleaved.
+<P>---------------------------------------------------------------------------*/
+unsigned int CEarClipper::ZOrder(double dx, double dy) const
+{
+	unsigned int x = (unsigned int)((dx - m_dMinX) * m_dInvSize);
+	unsigned int y = (unsigned int)((dy - m_dMinY) * m_dInvSize);
+
+	x = (x | (x << 8)) & 0x00FF00FF;
+	x = (x | (x << 4)) & 0x0F0F0F0F;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+
+	y = (y | (y << 8)) & 0x00FF00FF;
+	y = (y | (y << 4)) & 0x0F0F0F0F;
+	y = (y | (y << 2)) & 0x33333333;
+	y = (y | (y << 1)) & 0x55555555;
+
+	return x | (y << 1);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::AddTriangle
+\brief Adds a triangle to the result.
+<P>---------------------------------------------------------------------------*/
+void CEarClipper::AddTriangle(const sTriNode* a, const sTriNode* b, const sTriNode* c)
+{
+	m_Triangles.push_back(a->i);
+	m_Triangles.push_back(b->i);
+	m_Triangles.push_back(c->i);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::PointInTriangle
+\brief True if p is in the anticlockwise triangle a, b, c or on its edge.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::PointInTriangle(double ax, double ay, double bx, double by, double cx,
+		double cy, double px, double py)
+{
+	return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+		(ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+		(bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::Intersects
+\brief True if the segments p1-q1 and p2-q2 intersect or touch.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::Intersects(const sTriNode* p1, const sTriNode* q1, const sTriNode* p2, const sTriNode* q2)
+{
+	int o1 = Sign(Area(p1, q1, p2));
+	int o2 = Sign(Area(p1, q1, q2));
+	int o3 = Sign(Area(p2, q2, p1));
+	int o4 = Sign(Area(p2, q2, q1));
+
+	if (o1 != o2 && o3 != o4) return true;
+
+	if (o1 == 0 && OnSegment(p1, p2, q1)) return true;
+	if (o2 == 0 && OnSegment(p1, q2, q1)) return true;
+	if (o3 == 0 && OnSegment(p2, p1, q2)) return true;
+	if (o4 == 0 && OnSegment(p2, q1, q2)) return true;
+
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::OnSegment
+\brief True if q lies on the segment p-r given the 3 are collinear.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::OnSegment(const sTriNode* p, const sTriNode* q, const sTriNode* r)
+{
+	return q->x <= max(p->x, r->x) && q->x >= min(p->x, r->x) &&
+		q->y <= max(p->y, r->y) && q->y >= min(p->y, r->y);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::IntersectsPolygon
+\brief True if the diagonal a to b crosses an edge of the ring not touching a or b.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::IntersectsPolygon(const sTriNode* a, const sTriNode* b)
+{
+	const sTriNode* p = a;
+	do
+	{
+		if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i &&
+			Intersects(p, p->next, a, b))
+			return true;
+		p = p->next;
+	} while (p != a);
+
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::LocallyInside
+\brief True if the diagonal a to b is inside the ring near a.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::LocallyInside(const sTriNode* a, const sTriNode* b)
+{
+	return Area(a->prev, a, a->next) < 0 ?
+		Area(a, b, a->next) >= 0 && Area(a, a->prev, b) >= 0 :
+		Area(a, b, a->prev) < 0 || Area(a, a->next, b) < 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::MiddleInside
+\brief True if the middle of the diagonal a to b is inside the ring.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::MiddleInside(const sTriNode* a, const sTriNode* b)
+{
+	const sTriNode* p = a;
+	bool bInside = false;
+	double px = (a->x + b->x) / 2;
+	double py = (a->y + b->y) / 2;
+	do
+	{
+		if (((p->y > py) != (p->next->y > py)) && p->next->y != p->y &&
+			(px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x))
+			bInside = !bInside;
+		p = p->next;
+	} while (p != a);
+
+	return bInside;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::IsValidDiagonal
+\brief True if the diagonal a to b can be used to split the ring.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::IsValidDiagonal(const sTriNode* a, const sTriNode* b)
+{
+	if (a->next->i == b->i || a->prev->i == b->i || IntersectsPolygon(a, b))
+		return false;
+
+	// The diagonal is inside and does not make a zero area piece.
+	if (LocallyInside(a, b) && LocallyInside(b, a) && MiddleInside(a, b) &&
+		(Area(a->prev, a, b->prev) != 0 || Area(a, b->prev, b) != 0))
+		return true;
+
+	// Or a zero length diagonal between 2 convex points.
+	return Equals(a, b) && Area(a->prev, a, a->next) > 0 && Area(b->prev, b, b->next) > 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::SectorContainsSector
+\brief True if the sector at p is within the sector at m, both being the same point.
+<P>---------------------------------------------------------------------------*/
+bool CEarClipper::SectorContainsSector(const sTriNode* m, const sTriNode* p)
+{
+	return Area(m->prev, m, p->prev) < 0 && Area(p->next, m, m->next) < 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CEarClipper::GetLeftmost
+\brief Returns the leftmost node of the ring, the lowest if there are several.
+<P>---------------------------------------------------------------------------*/
+sTriNode* CEarClipper::GetLeftmost(sTriNode* pStart)
+{
+	sTriNode* p = pStart;
+	sTriNode* pLeftmost = pStart;
+	do
+	{
+		if (p->x < pLeftmost->x || (p->x == pLeftmost->x && p->y < pLeftmost->y))
+			pLeftmost = p;
+		p = p->next;
+	} while (p != pStart);
+
+	return pLeftmost;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GetRingCoords
+\brief Adds the start points of the lines of the polygon to the coordinates.
+<P>---------------------------------------------------------------------------*/
+static void GetRingCoords(const C2DPolyBase& Poly, vector<double>& Coords)
+{
+	unsigned int nCount = Poly.GetLineCount();
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		C2DPoint pt = Poly.GetLine(i)->GetPointFrom();
+		Coords.push_back(pt.x);
+		Coords.push_back(pt.y);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GetHoledCoords
+\brief Gets the coordinates of the rim and the holes and where each starts. False
+if there is no rim.
+<P>---------------------------------------------------------------------------*/
+static bool GetHoledCoords(const C2DHoledPolyBase& Poly, vector<double>& Coords,
+						   vector<unsigned int>& RingStarts)
+{
+	if (Poly.GetRim() == 0)
+		return false;
+
+	RingStarts.push_back(0);
+	GetRingCoords(*Poly.GetRim(), Coords);
+
+	for (unsigned int h = 0; h < Poly.GetHoleCount(); h++)
+	{
+		RingStarts.push_back(Coords.size() / 2);
+		GetRingCoords(*Poly.GetHole(h), Coords);
+	}
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::Triangulate
+\brief Triangulates the rings of coordinates given, the first being the rim.
+<P>---------------------------------------------------------------------------*/
+bool CPolygonTriangulator::Triangulate(const vector<double>& Coords,
+						const vector<unsigned int>& RingStarts,
+						vector<unsigned int>& Triangles)
+{
+	if (Coords.size() < 6 || RingStarts.empty())
+		return false;
+
+	CEarClipper Clipper(Coords, Triangles);
+	Clipper.Run(RingStarts);
+
+	return !Triangles.empty();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::Triangulate
+\brief Adds 3 point indexes for each triangle to the set, the points being the
+start points of the lines. False if it failed.
+<P>---------------------------------------------------------------------------*/
+bool CPolygonTriangulator::Triangulate(const C2DPolyBase& Poly, CIndexSet& Triangles)
+{
+	vector<double> Coords;
+	GetRingCoords(Poly, Coords);
+	vector<unsigned int> RingStarts(1, 0);
+
+	vector<unsigned int> Result;
+	if (!Triangulate(Coords, RingStarts, Result))
+		return false;
+
+	for (unsigned int i = 0; i < Result.size(); i++)
+		Triangles.Add(Result[i]);
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::Triangulate
+\brief Adds 3 point indexes for each triangle to the set, the points of the holes
+following on from those of the rim. False if it failed.
+<P>---------------------------------------------------------------------------*/
+bool CPolygonTriangulator::Triangulate(const C2DHoledPolyBase& Poly, CIndexSet& Triangles)
+{
+	vector<double> Coords;
+	vector<unsigned int> RingStarts;
+	if (!GetHoledCoords(Poly, Coords, RingStarts))
+		return false;
+
+	vector<unsigned int> Result;
+	if (!Triangulate(Coords, RingStarts, Result))
+		return false;
+
+	for (unsigned int i = 0; i < Result.size(); i++)
+		Triangles.Add(Result[i]);
+
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::MergeConvex
+\brief Merges the triangles across their diagonals wherever both corners of the
+merged piece at the diagonal stay convex.
+
+Each corner of each triangle is a vertex of a piece and the corners are linked
+around the pieces. Merging 2 pieces drops the 2 corners on one side of the
+diagonal, the dropped corners being mapped to those kept.
+<P>---------------------------------------------------------------------------*/
+void CPolygonTriangulator::MergeConvex(const vector<double>& Coords,
+						const vector<unsigned int>& Triangles,
+						vector< vector<unsigned int> >& Pieces)
+{
+	unsigned int nCorners = Triangles.size();
+
+	vector<unsigned int> Next(nCorners);
+	vector<unsigned int> Prev(nCorners);
+	vector<unsigned int> Alias(nCorners);
+	vector<unsigned int> Piece(nCorners / 3);
+
+	for (unsigned int c = 0; c < nCorners; c++)
+	{
+		unsigned int nBase = c - c % 3;
+		Next[c] = nBase + (c + 1) % 3;
+		Prev[c] = nBase + (c + 2) % 3;
+		Alias[c] = c;
+	}
+	for (unsigned int t = 0; t < Piece.size(); t++)
+		Piece[t] = t;
+
+	auto Find = [](vector<unsigned int>& Parent, unsigned int n)
+	{
+		while (Parent[n] != n)
+		{
+			Parent[n] = Parent[Parent[n]];
+			n = Parent[n];
+		}
+		return n;
+	};
+
+	auto Orient = [&Coords, &Triangles](unsigned int a, unsigned int b, unsigned int c)
+	{
+		unsigned int i = Triangles[a];
+		unsigned int j = Triangles[b];
+		unsigned int k = Triangles[c];
+		return GeoPredicates::Orient2D(Coords[2 * i], Coords[2 * i + 1],
+			Coords[2 * j], Coords[2 * j + 1], Coords[2 * k], Coords[2 * k + 1]);
+	};
+
+	// Find the diagonals as the edges which are in 2 triangles in opposite directions.
+	unordered_map<unsigned long long, unsigned int> Edges;
+	Edges.reserve(nCorners);
+	vector<unsigned int> Diagonals;
+	for (unsigned int c = 0; c < nCorners; c++)
+	{
+		unsigned long long a = Triangles[c];
+		unsigned long long b = Triangles[Next[c]];
+		if (a == b)
+			continue;
+
+		auto Found = Edges.find((b << 32) | a);
+		if (Found != Edges.end())
+		{
+			Diagonals.push_back(c);
+			Diagonals.push_back(Found->second);
+			Edges.erase(Found);
+		}
+		else
+		{
+			Edges[(a << 32) | b] = c;
+		}
+	}
+
+	for (unsigned int d = 0; d < Diagonals.size(); d += 2)
+	{
+		// The edge is a to b in the first piece and b to a in the second.
+		unsigned int ca1 = Find(Alias, Diagonals[d]);
+		unsigned int cb2 = Find(Alias, Diagonals[d + 1]);
+		unsigned int cb1 = Next[ca1];
+		unsigned int ca2 = Next[cb2];
+
+		unsigned int nPiece1 = Find(Piece, ca1 / 3);
+		unsigned int nPiece2 = Find(Piece, cb2 / 3);
+		if (nPiece1 == nPiece2)
+			continue;
+
+		if (Triangles[cb1] != Triangles[cb2] || Triangles[ca2] != Triangles[ca1])
+			continue;
+
+		if (Orient(Prev[ca1], ca1, Next[ca2]) < 0 || Orient(Prev[cb2], cb2, Next[cb1]) < 0)
+			continue;
+
+		// Keep a from the first piece and b from the second.
+		Next[ca1] = Next[ca2];
+		Prev[Next[ca2]] = ca1;
+		Next[cb2] = Next[cb1];
+		Prev[Next[cb1]] = cb2;
+		Alias[ca2] = ca1;
+		Alias[cb1] = cb2;
+
+		Piece[nPiece2] = nPiece1;
+	}
+
+	vector<bool> Done(nCorners, false);
+	for (unsigned int c = 0; c < nCorners; c++)
+	{
+		if (Done[c] || Alias[c] != c)
+			continue;
+
+		Pieces.push_back(vector<unsigned int>());
+		vector<unsigned int>& Ring = Pieces.back();
+		unsigned int n = c;
+		do
+		{
+			Done[n] = true;
+			Ring.push_back(Triangles[n]);
+			n = Next[n];
+		} while (n != c);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::MakePolygons
+\brief Converts the index pieces to polygons.
+<P>---------------------------------------------------------------------------*/
+void CPolygonTriangulator::MakePolygons(const vector<double>& Coords,
+						const vector< vector<unsigned int> >& Pieces,
+						C2DPolygonSet& Polygons)
+{
+	for (unsigned int p = 0; p < Pieces.size(); p++)
+	{
+		C2DPointSet Points;
+		for (unsigned int i = 0; i < Pieces[p].size(); i++)
+			Points.AddCopy(Coords[2 * Pieces[p][i]], Coords[2 * Pieces[p][i] + 1]);
+
+		C2DPolygon* pPiece = new C2DPolygon;
+		if (pPiece->Create(Points))
+			Polygons.Add(pPiece);
+		else
+			delete pPiece;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::GetConvexPartition
+\brief Adds the point indexes of each convex piece to the set. False if the
+triangulation failed.
+<P>---------------------------------------------------------------------------*/
+bool CPolygonTriangulator::GetConvexPartition(const C2DPolyBase& Poly,
+						vector< vector<unsigned int> >& Pieces)
+{
+	vector<double> Coords;
+	GetRingCoords(Poly, Coords);
+	vector<unsigned int> RingStarts(1, 0);
+
+	vector<unsigned int> Triangles;
+	if (!Triangulate(Coords, RingStarts, Triangles))
+		return false;
+
+	MergeConvex(Coords, Triangles, Pieces);
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::GetConvexPartition
+\brief Adds the point indexes of each convex piece to the set. False if the
+triangulation failed.
+<P>---------------------------------------------------------------------------*/
+bool CPolygonTriangulator::GetConvexPartition(const C2DHoledPolyBase& Poly,
+						vector< vector<unsigned int> >& Pieces)
+{
+	vector<double> Coords;
+	vector<unsigned int> RingStarts;
+	if (!GetHoledCoords(Poly, Coords, RingStarts))
+		return false;
+
+	vector<unsigned int> Triangles;
+	if (!Triangulate(Coords, RingStarts, Triangles))
+		return false;
+
+	MergeConvex(Coords, Triangles, Pieces);
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::GetConvexPartition
+\brief Adds the convex pieces to the set. False if the triangulation failed.
+<P>---------------------------------------------------------------------------*/
+bool CPolygonTriangulator::GetConvexPartition(const C2DPolyBase& Poly, C2DPolygonSet& Pieces)
+{
+	vector<double> Coords;
+	GetRingCoords(Poly, Coords);
+	vector<unsigned int> RingStarts(1, 0);
+
+	vector<unsigned int> Triangles;
+	if (!Triangulate(Coords, RingStarts, Triangles))
+		return false;
+
+	vector< vector<unsigned int> > IndexPieces;
+	MergeConvex(Coords, Triangles, IndexPieces);
+	MakePolygons(Coords, IndexPieces, Pieces);
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CPolygonTriangulator::GetConvexPartition
+\brief Adds the convex pieces to the set. False if the triangulation failed.
+<P>---------------------------------------------------------------------------*/
+bool CPolygonTriangulator::GetConvexPartition(const C2DHoledPolyBase& Poly, C2DPolygonSet& Pieces)
+{
+	vector<double> Coords;
+	vector<unsigned int> RingStarts;
+	if (!GetHoledCoords(Poly, Coords, RingStarts))
+		return false;
+
+	vector<unsigned int> Triangles;
+	if (!Triangulate(Coords, RingStarts, Triangles))
+		return false;
+
+	vector< vector<unsigned int> > IndexPieces;
+	MergeConvex(Coords, Triangles, IndexPieces);
+	MakePolygons(Coords, IndexPieces, Pieces);
+	return true;
+}
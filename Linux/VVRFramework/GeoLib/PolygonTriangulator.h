@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file PolygonTriangulator.h
+\brief Declaration file for the CPolygonTriangulator class.
+
+Declaration file for CPolygonTriangulator, a polygon triangulation engine.
+
+\class CPolygonTriangulator
+\brief Triangulates polygons and holed polygons by ear clipping and merges the
+triangles into convex pieces.
+
+Holes are bridged to the rim so the ear clipping works on a single ring. The ears
+are found using a z-order curve index of the vertices for large polygons so the
+cost is close to linear in practice. The convex partition merges the triangles
+across their diagonals wherever the result stays convex (Hertel-Mehlhorn) which
+gives at most 4 times the minimum number of pieces.
+
+The points are indexed in the order of the lines, the rim first followed by each
+hole in order. Arcs are treated as their chords. The triangles and pieces are
+anticlockwise.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CPOLYGONTRIANGULATOR_H
+#define _GEOLIB_CPOLYGONTRIANGULATOR_H
+
+class C2DPolyBase;
+class C2DHoledPolyBase;
+class C2DPolygonSet;
+class CIndexSet;
+
+class GeoLib_API CPolygonTriangulator
+{
+public:
+	/// Adds 3 point indexes for each triangle to the set. False if it failed.
+	static bool Triangulate(const C2DPolyBase& Poly, CIndexSet& Triangles);
+	/// Adds 3 point indexes for each triangle to the set. False if it failed.
+	static bool Triangulate(const C2DHoledPolyBase& Poly, CIndexSet& Triangles);
+
+	/// Adds the point indexes of each convex piece to the set.
+	static bool GetConvexPartition(const C2DPolyBase& Poly,
+						std::vector< std::vector<unsigned int> >& Pieces);
+	/// Adds the point indexes of each convex piece to the set.
+	static bool GetConvexPartition(const C2DHoledPolyBase& Poly,
+						std::vector< std::vector<unsigned int> >& Pieces);
+	/// Adds the convex pieces to the set.
+	static bool GetConvexPartition(const C2DPolyBase& Poly, C2DPolygonSet& Pieces);
+	/// Adds the convex pieces to the set.
+	static bool GetConvexPartition(const C2DHoledPolyBase& Poly, C2DPolygonSet& Pieces);
+
+private:
+	/// Constructor, not used.
+	CPolygonTriangulator(void);
+
+	/// Triangulates the rings of coordinates given, the first being the rim.
+	static bool Triangulate(const std::vector<double>& Coords,
+						const std::vector<unsigned int>& RingStarts,
+						std::vector<unsigned int>& Triangles);
+	/// Merges the triangles into convex pieces.
+	static void MergeConvex(const std::vector<double>& Coords,
+						const std::vector<unsigned int>& Triangles,
+						std::vector< std::vector<unsigned int> >& Pieces);
+	/// Converts the index pieces to polygons.
+	static void MakePolygons(const std::vector<double>& Coords,
+						const std::vector< std::vector<unsigned int> >& Pieces,
+						C2DPolygonSet& Polygons);
+};
+
+#endif
@@ -0,0 +1,400 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Predicates.cpp
+\brief Implementation file for the robust geometric predicates.
+
+The expansion arithmetic follows J. R. Shewchuk, "Adaptive Precision Floating-Point
+Arithmetic and Fast Robust Geometric Predicates". An expansion is a sum of doubles
+held in increasing order of magnitude with no overlapping bits so the sign of the
+sum is the sign of the largest component.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "Predicates.h"
+
+using namespace std;
+
+/// Machine epsilon for the rounding error bounds, 2^-53.
+const double conPredicateEpsilon = 1.1102230246251565e-16;
+/// Used to split a double into 2 non overlapping halves, 2^27 + 1.
+const double conPredicateSplitter = 134217729.0;
+/// Error bound for the fast orientation test.
+const double conOrientErrBound = (3.0 + 16.0 * conPredicateEpsilon) * conPredicateEpsilon;
+/// Error bound for the fast in circle test.
+const double conInCircleErrBound = (10.0 + 96.0 * conPredicateEpsilon) * conPredicateEpsilon;
+
+
+/**--------------------------------------------------------------------------<BR>
+TwoSum <BR>
+\brief Computes a + b exactly as x + y where x is the rounded sum.
+<P>---------------------------------------------------------------------------*/
+static inline void TwoSum(double a, double b, double& x, double& y)
+{
+	x = a + b;
+	double bVirtual = x - a;
+	double aVirtual = x - bVirtual;
+	double bRoundoff = b - bVirtual;
+	double aRoundoff = a - aVirtual;
+	y = aRoundoff + bRoundoff;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+FastTwoSum <BR>
+\brief Computes a + b exactly as x + y where x is the rounded sum, given |a| >= |b|.
+<P>---------------------------------------------------------------------------*/
+static inline void FastTwoSum(double a, double b, double& x, double& y)
+{
+	x = a + b;
+	double bVirtual = x - a;
+	y = b - bVirtual;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+TwoDiff <BR>
+\brief Computes a - b exactly as x + y where x is the rounded difference.
+<P>---------------------------------------------------------------------------*/
+static inline void TwoDiff(double a, double b, double& x, double& y)
+{
+	x = a - b;
+	double bVirtual = a - x;
+	double aVirtual = x + bVirtual;
+	double bRoundoff = bVirtual - b;
+	double aRoundoff = a - aVirtual;
+	y = aRoundoff + bRoundoff;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+Split <BR>
+\brief Splits a into 2 halves of 26 bits each.
+<P>---------------------------------------------------------------------------*/
+static inline void Split(double a, double& dHi, double& dLo)
+{
+	double c = conPredicateSplitter * a;
+	double aBig = c - a;
+	dHi = c - aBig;
+	dLo = a - dHi;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+TwoProduct <BR>
+\brief Computes a * b exactly as x + y where x is the rounded product.
+<P>---------------------------------------------------------------------------*/
+static inline void TwoProduct(double a, double b, double& x, double& y)
+{
+	x = a * b;
+	double aHi, aLo, bHi, bLo;
+	Split(a, aHi, aLo);
+	Split(b, bHi, bLo);
+	double dErr1 = x - (aHi * bHi);
+	double dErr2 = dErr1 - (aLo * bHi);
+	double dErr3 = dErr2 - (aHi * bLo);
+	y = (aLo * bLo) - dErr3;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GrowExpansion <BR>
+\brief Adds the double b to the expansion e (of length nLength) in place, removing
+zero components. Returns the new length. e must have room for one more component.
+<P>---------------------------------------------------------------------------*/
+static int GrowExpansion(int nLength, double* e, double b)
+{
+	double Q = b;
+	int nNew = 0;
+	for (int i = 0; i < nLength; i++)
+	{
+		double dSum, dTail;
+		TwoSum(Q, e[i], dSum, dTail);
+		Q = dSum;
+		if (dTail != 0.0)
+			e[nNew++] = dTail;
+	}
+	if (Q != 0.0 || nNew == 0)
+		e[nNew++] = Q;
+
+	return nNew;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+SumExpansions <BR>
+\brief Sets h to the sum of the expansions e and f by merging their components in
+order of magnitude, removing zero components. Neither may be empty.
+<P>---------------------------------------------------------------------------*/
+static void SumExpansions(const vector<double>& e, const vector<double>& f, vector<double>& h)
+{
+	h.clear();
+
+	unsigned int ei = 0;
+	unsigned int fi = 0;
+	double Q;
+	if ((f[0] > e[0]) == (f[0] > -e[0]))
+		Q = e[ei++];
+	else
+		Q = f[fi++];
+
+	while (ei < e.size() || fi < f.size())
+	{
+		double dNext;
+		if (fi == f.size() || (ei < e.size() && (f[fi] > e[ei]) == (f[fi] > -e[ei])))
+			dNext = e[ei++];
+		else
+			dNext = f[fi++];
+
+		double dSum, dTail;
+		TwoSum(Q, dNext, dSum, dTail);
+		Q = dSum;
+		if (dTail != 0.0)
+			h.push_back(dTail);
+	}
+
+	if (Q != 0.0 || h.empty())
+		h.push_back(Q);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+ScaleExpansion <BR>
+\brief Sets h to the expansion e multiplied by b, removing zero components.
+<P>---------------------------------------------------------------------------*/
+static void ScaleExpansion(const vector<double>& e, double b, vector<double>& h)
+{
+	h.clear();
+
+	double Q, dTail;
+	TwoProduct(e[0], b, Q, dTail);
+	if (dTail != 0.0)
+		h.push_back(dTail);
+
+	for (unsigned int i = 1; i < e.size(); i++)
+	{
+		double dProduct1, dProduct0, dSum;
+		TwoProduct(e[i], b, dProduct1, dProduct0);
+		TwoSum(Q, dProduct0, dSum, dTail);
+		if (dTail != 0.0)
+			h.push_back(dTail);
+		FastTwoSum(dProduct1, dSum, Q, dTail);
+		if (dTail != 0.0)
+			h.push_back(dTail);
+	}
+
+	if (Q != 0.0 || h.empty())
+		h.push_back(Q);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MultiplyExpansions <BR>
+\brief Sets h to the product of the expansions e and f.
+<P>---------------------------------------------------------------------------*/
+static void MultiplyExpansions(const vector<double>& e, const vector<double>& f, vector<double>& h)
+{
+	vector<double> Scaled, Sum;
+	ScaleExpansion(e, f[0], h);
+	for (unsigned int i = 1; i < f.size(); i++)
+	{
+		ScaleExpansion(e, f[i], Scaled);
+		SumExpansions(h, Scaled, Sum);
+		h.swap(Sum);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+NegateExpansion <BR>
+\brief Negates the expansion in place.
+<P>---------------------------------------------------------------------------*/
+static void NegateExpansion(vector<double>& e)
+{
+	for (unsigned int i = 0; i < e.size(); i++)
+		e[i] = -e[i];
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+DiffExpansion <BR>
+\brief Sets e to the exact difference a - b.
+<P>---------------------------------------------------------------------------*/
+static void DiffExpansion(double a, double b, vector<double>& e)
+{
+	double x, y;
+	TwoDiff(a, b, x, y);
+	e.clear();
+	if (y != 0.0)
+		e.push_back(y);
+	if (x != 0.0 || e.empty())
+		e.push_back(x);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoPredicates::Orient2D <BR>
+\brief Adaptive orientation test. Positive if counter clockwise.
+<P>---------------------------------------------------------------------------*/
+double GeoPredicates::Orient2D(double ax, double ay, double bx, double by, double cx, double cy)
+{
+	double dDetLeft = (ax - cx) * (by - cy);
+	double dDetRight = (ay - cy) * (bx - cx);
+	double dDet = dDetLeft - dDetRight;
+	double dDetSum;
+
+	if (dDetLeft > 0.0)
+	{
+		if (dDetRight <= 0.0)
+			return dDet;
+		dDetSum = dDetLeft + dDetRight;
+	}
+	else if (dDetLeft < 0.0)
+	{
+		if (dDetRight >= 0.0)
+			return dDet;
+		dDetSum = -dDetLeft - dDetRight;
+	}
+	else
+	{
+		return dDet;
+	}
+
+	double dErrBound = conOrientErrBound * dDetSum;
+	if (dDet >= dErrBound || -dDet >= dErrBound)
+		return dDet;
+
+	return Orient2DExact(ax, ay, bx, by, cx, cy);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoPredicates::Orient2DExact <BR>
+\brief Exact orientation test. The determinant is expanded into the 6 products of
+input coordinates, each of which is exact as 2 doubles, and these are summed exactly.
+<P>---------------------------------------------------------------------------*/
+double GeoPredicates::Orient2DExact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+	double Terms[12];
+	TwoProduct(ax, by, Terms[0], Terms[1]);
+	TwoProduct(-ax, cy, Terms[2], Terms[3]);
+	TwoProduct(-cx, by, Terms[4], Terms[5]);
+	TwoProduct(-ay, bx, Terms[6], Terms[7]);
+	TwoProduct(ay, cx, Terms[8], Terms[9]);
+	TwoProduct(cy, bx, Terms[10], Terms[11]);
+
+	double Expansion[13];
+	int nLength = 0;
+	for (int i = 0; i < 12; i++)
+	{
+		if (Terms[i] != 0.0)
+			nLength = GrowExpansion(nLength, Expansion, Terms[i]);
+	}
+
+	if (nLength == 0)
+		return 0.0;
+
+	// The largest component carries the sign.
+	return Expansion[nLength - 1];
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoPredicates::InCircle <BR>
+\brief Adaptive in circle test. Positive if d is inside the circle through the
+counter clockwise points a, b and c.
+<P>---------------------------------------------------------------------------*/
+double GeoPredicates::InCircle(double ax, double ay, double bx, double by, double cx, double cy,
+		double dx, double dy)
+{
+	double adx = ax - dx;
+	double bdx = bx - dx;
+	double cdx = cx - dx;
+	double ady = ay - dy;
+	double bdy = by - dy;
+	double cdy = cy - dy;
+
+	double bdxcdy = bdx * cdy;
+	double cdxbdy = cdx * bdy;
+	double dALift = adx * adx + ady * ady;
+
+	double cdxady = cdx * ady;
+	double adxcdy = adx * cdy;
+	double dBLift = bdx * bdx + bdy * bdy;
+
+	double adxbdy = adx * bdy;
+	double bdxady = bdx * ady;
+	double dCLift = cdx * cdx + cdy * cdy;
+
+	double dDet = dALift * (bdxcdy - cdxbdy) + dBLift * (cdxady - adxcdy) + 
+		dCLift * (adxbdy - bdxady);
+
+	double dPermanent = (fabs(bdxcdy) + fabs(cdxbdy)) * dALift + 
+		(fabs(cdxady) + fabs(adxcdy)) * dBLift + 
+		(fabs(adxbdy) + fabs(bdxady)) * dCLift;
+
+	double dErrBound = conInCircleErrBound * dPermanent;
+	if (dDet > dErrBound || -dDet > dErrBound)
+		return dDet;
+
+	return InCircleExact(ax, ay, bx, by, cx, cy, dx, dy);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoPredicates::InCircleExact <BR>
+\brief Exact in circle test. The differences from d are formed exactly as expansions
+and the determinant is then evaluated in expansion arithmetic. When the differences
+are exact, as for integer coordinates, the expansions stay short.
+<P>---------------------------------------------------------------------------*/
+double GeoPredicates::InCircleExact(double ax, double ay, double bx, double by, double cx, double cy,
+		double dx, double dy)
+{
+	vector<double> adx, ady, bdx, bdy, cdx, cdy;
+	DiffExpansion(ax, dx, adx);
+	DiffExpansion(ay, dy, ady);
+	DiffExpansion(bx, dx, bdx);
+	DiffExpansion(by, dy, bdy);
+	DiffExpansion(cx, dx, cdx);
+	DiffExpansion(cy, dy, cdy);
+
+	vector<double> Temp1, Temp2, Lift, Cross, Term, Det, Sum;
+
+	// The lift of p and the cross product of q and r.
+	auto AddTerm = [&](const vector<double>& px, const vector<double>& py, 
+		const vector<double>& qx, const vector<double>& qy, 
+		const vector<double>& rx, const vector<double>& ry)
+	{
+		MultiplyExpansions(px, px, Temp1);
+		MultiplyExpansions(py, py, Temp2);
+		SumExpansions(Temp1, Temp2, Lift);
+
+		MultiplyExpansions(qx, ry, Temp1);
+		MultiplyExpansions(rx, qy, Temp2);
+		NegateExpansion(Temp2);
+		SumExpansions(Temp1, Temp2, Cross);
+
+		MultiplyExpansions(Lift, Cross, Term);
+		if (Det.empty())
+		{
+			Det.swap(Term);
+		}
+		else
+		{
+			SumExpansions(Det, Term, Sum);
+			Det.swap(Sum);
+		}
+	};
+
+	AddTerm(adx, ady, bdx, bdy, cdx, cdy);
+	AddTerm(bdx, bdy, cdx, cdy, adx, ady);
+	AddTerm(cdx, cdy, adx, ady, bdx, bdy);
+
+	// The largest component carries the sign.
+	return Det.back();
+}
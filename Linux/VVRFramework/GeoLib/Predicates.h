@@ -0,0 +1,51 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Predicates.h
+\brief File for the robust geometric predicates.
+
+File for the adaptive precision geometric predicates used where the topology of
+a result must not depend on floating point rounding, e.g. the sweep line polygon
+Boolean engine. Each predicate first evaluates the determinant in ordinary
+floating point and only falls back to exact expansion arithmetic (after
+Shewchuk) when the result is within the rounding error bound. The sign of the
+returned value is therefore always exact.
+<P>---------------------------------------------------------------------------*/
+
+
+#ifndef _GEOLIB_PREDICATES_H
+#define _GEOLIB_PREDICATES_H
+
+#include "StdAfx.h"
+
+
+/**--------------------------------------------------------------------------<BR>
+\namespace GeoPredicates
+\brief Namespace for the robust geometric predicates.
+<P>---------------------------------------------------------------------------*/
+namespace GeoPredicates
+{
+	/// Returns a positive value if a, b and c are in counter clockwise order, negative if
+	/// clockwise and zero if collinear. The sign is exact.
+	GeoLib_API double Orient2D(double ax, double ay, double bx, double by, double cx, double cy);
+
+	/// Exact version of Orient2D, used when the fast version is within its error bound.
+	GeoLib_API double Orient2DExact(double ax, double ay, double bx, double by, double cx, double cy);
+
+	/// Returns a positive value if d is inside the circle through a, b and c, negative if
+	/// outside and zero if on it, given a, b and c are counter clockwise. The sign is exact.
+	GeoLib_API double InCircle(double ax, double ay, double bx, double by, double cx, double cy,
+		double dx, double dy);
+
+	/// Exact version of InCircle, used when the fast version is within its error bound.
+	GeoLib_API double InCircleExact(double ax, double ay, double bx, double by, double cx, double cy,
+		double dx, double dy);
+}
+
+
+#endif
@@ -0,0 +1,873 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file RTree.cpp
+\brief Implementation file for the CRTree class.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "RTree.h"
+#include "C2DBaseSet.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+using namespace std;
+
+/// No node.
+const unsigned int conNoNode = 0xFFFFFFFF;
+
+
+/**--------------------------------------------------------------------------<BR>
+struct sNearestItem
+\brief An item in the heap of a nearest search: a node, a rectangle or a shape whose
+distance has been found.
+<P>---------------------------------------------------------------------------*/
+struct sNearestItem
+{
+	/// The squared distance, at least that of anything under it.
+	double dDist2;
+	/// The node or id.
+	unsigned int nIndex;
+	/// 0 for a node, 1 for a rectangle and 2 for a shape.
+	unsigned char nType;
+
+	/// Orders the heap with the nearest on top.
+	bool operator<(const sNearestItem& Other) const {return dDist2 > Other.dDist2;}
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::CRTree
+\brief Constructor, for an empty tree with up to the number of entries in a node,
+which is at least 4.
+<P>---------------------------------------------------------------------------*/
+CRTree::CRTree(unsigned int nMaxChildren) : m_nRoot(conNoNode), m_nSize(0)
+{
+	m_nMaxChildren = max(4u, nMaxChildren);
+	m_nMinChildren = max(2u, m_nMaxChildren * 2 / 5);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::~CRTree
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CRTree::~CRTree(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Clear
+\brief Removes everything.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Clear(void)
+{
+	m_Nodes.clear();
+	m_FreeNodes.clear();
+	m_nRoot = conNoNode;
+	m_nSize = 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::MakeBox
+\brief The box of the rectangle, which may have its corners either way round.
+<P>---------------------------------------------------------------------------*/
+CRTree::sBox CRTree::MakeBox(const C2DRect& Rect)
+{
+	sBox Box;
+	Box.dMinX = min(Rect.GetLeft(), Rect.GetRight());
+	Box.dMaxX = max(Rect.GetLeft(), Rect.GetRight());
+	Box.dMinY = min(Rect.GetTop(), Rect.GetBottom());
+	Box.dMaxY = max(Rect.GetTop(), Rect.GetBottom());
+	return Box;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Combine
+\brief The box bounding both.
+<P>---------------------------------------------------------------------------*/
+CRTree::sBox CRTree::Combine(const sBox& a, const sBox& b)
+{
+	sBox Box;
+	Box.dMinX = min(a.dMinX, b.dMinX);
+	Box.dMinY = min(a.dMinY, b.dMinY);
+	Box.dMaxX = max(a.dMaxX, b.dMaxX);
+	Box.dMaxY = max(a.dMaxY, b.dMaxY);
+	return Box;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Distance2
+\brief The squared distance from the point to the box, 0 if inside.
+<P>---------------------------------------------------------------------------*/
+double CRTree::Distance2(const sBox& a, double x, double y)
+{
+	double dx = max(0.0, max(a.dMinX - x, x - a.dMaxX));
+	double dy = max(0.0, max(a.dMinY - y, y - a.dMaxY));
+	return dx * dx + dy * dy;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::NewNode
+\brief Makes a node at the level with no parent, reusing a free one if there is one.
+<P>---------------------------------------------------------------------------*/
+unsigned int CRTree::NewNode(unsigned int nLevel)
+{
+	unsigned int nNode;
+	if (!m_FreeNodes.empty())
+	{
+		nNode = m_FreeNodes.back();
+		m_FreeNodes.pop_back();
+	}
+	else
+	{
+		nNode = m_Nodes.size();
+		m_Nodes.push_back(sNode());
+	}
+	m_Nodes[nNode].Entries.clear();
+	m_Nodes[nNode].nParent = conNoNode;
+	m_Nodes[nNode].nLevel = nLevel;
+	return nNode;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::FreeNode
+\brief Frees the node for reuse.
+<P>---------------------------------------------------------------------------*/
+void CRTree::FreeNode(unsigned int nNode)
+{
+	m_Nodes[nNode].Entries.clear();
+	m_Nodes[nNode].nParent = conNoNode;
+	m_FreeNodes.push_back(nNode);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetNodeBox
+\brief The bounds of the entries of the node.
+<P>---------------------------------------------------------------------------*/
+CRTree::sBox CRTree::GetNodeBox(unsigned int nNode) const
+{
+	const vector<sEntry>& Entries = m_Nodes[nNode].Entries;
+	sBox Box = Entries[0].Box;
+	for (unsigned int i = 1; i < Entries.size(); i++)
+		Box = Combine(Box, Entries[i].Box);
+	return Box;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Build
+\brief Builds the tree from the rectangles and their ids, replacing any contents.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Build(const vector<C2DRect>& Rects, const vector<unsigned int>& Ids)
+{
+	assert(Rects.size() == Ids.size());
+	Clear();
+	if (Rects.empty())
+		return;
+
+	vector<sEntry> Entries(Rects.size());
+	for (unsigned int i = 0; i < Rects.size(); i++)
+	{
+		Entries[i].Box = MakeBox(Rects[i]);
+		Entries[i].nIndex = Ids[i];
+	}
+	m_nSize = Entries.size();
+
+	unsigned int nLevel = 0;
+	while (true)
+	{
+		Pack(Entries, nLevel);
+		if (Entries.size() == 1)
+			break;
+		nLevel++;
+	}
+	m_nRoot = Entries[0].nIndex;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Build
+\brief Builds the tree from the bounding rectangles of the shapes in the set, with
+their indices as ids.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Build(const C2DBaseSet& Shapes)
+{
+	vector<C2DRect> Rects(Shapes.size());
+	vector<unsigned int> Ids(Shapes.size());
+	for (unsigned int i = 0; i < Shapes.size(); i++)
+	{
+		Shapes.GetAt(i)->GetBoundingRect(Rects[i]);
+		Ids[i] = i;
+	}
+	Build(Rects, Ids);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Pack
+\brief Packs the entries into full nodes at the level by sort-tile-recursive: the
+entries are sorted by the x of their centres into about the square root of the number
+of nodes slices, each of which is sorted by y and cut into nodes. The entries are
+replaced by those of the nodes made, for the level above.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Pack(vector<sEntry>& Entries, unsigned int nLevel)
+{
+	const unsigned int nCount = Entries.size();
+	const unsigned int nNodes = (nCount + m_nMaxChildren - 1) / m_nMaxChildren;
+	const unsigned int nSlices = (unsigned int)ceil(sqrt((double)nNodes));
+	const unsigned int nSliceSize = ((nNodes + nSlices - 1) / nSlices) * m_nMaxChildren;
+
+	sort(Entries.begin(), Entries.end(), [](const sEntry& a, const sEntry& b)
+		{ return a.Box.dMinX + a.Box.dMaxX < b.Box.dMinX + b.Box.dMaxX; });
+
+	vector<sEntry> Parents;
+	Parents.reserve(nNodes);
+	for (unsigned int nSlice = 0; nSlice < nCount; nSlice += nSliceSize)
+	{
+		const unsigned int nSliceEnd = min(nCount, nSlice + nSliceSize);
+		sort(Entries.begin() + nSlice, Entries.begin() + nSliceEnd, [](const sEntry& a, const sEntry& b)
+			{ return a.Box.dMinY + a.Box.dMaxY < b.Box.dMinY + b.Box.dMaxY; });
+
+		for (unsigned int nFrom = nSlice; nFrom < nSliceEnd; nFrom += m_nMaxChildren)
+		{
+			const unsigned int nTo = min(nSliceEnd, nFrom + m_nMaxChildren);
+			const unsigned int nNode = NewNode(nLevel);
+			m_Nodes[nNode].Entries.assign(Entries.begin() + nFrom, Entries.begin() + nTo);
+			if (nLevel > 0)
+			{
+				for (unsigned int i = nFrom; i < nTo; i++)
+					m_Nodes[Entries[i].nIndex].nParent = nNode;
+			}
+			sEntry Parent;
+			Parent.Box = GetNodeBox(nNode);
+			Parent.nIndex = nNode;
+			Parents.push_back(Parent);
+		}
+	}
+	Entries.swap(Parents);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetHeight
+\brief The number of levels of nodes, 0 if empty.
+<P>---------------------------------------------------------------------------*/
+unsigned int CRTree::GetHeight(void) const
+{
+	return m_nRoot == conNoNode ? 0 : m_Nodes[m_nRoot].nLevel + 1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetBoundingRect
+\brief The bounding rectangle of everything, false if empty.
+<P>---------------------------------------------------------------------------*/
+bool CRTree::GetBoundingRect(C2DRect& Rect) const
+{
+	if (m_nRoot == conNoNode || m_Nodes[m_nRoot].Entries.empty())
+		return false;
+	sBox Box = GetNodeBox(m_nRoot);
+	Rect.Set(Box.dMinX, Box.dMaxY, Box.dMaxX, Box.dMinY);
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::FindInParent
+\brief Finds the position of the node in the entries of its parent.
+<P>---------------------------------------------------------------------------*/
+unsigned int CRTree::FindInParent(unsigned int nNode) const
+{
+	const vector<sEntry>& Entries = m_Nodes[m_Nodes[nNode].nParent].Entries;
+	for (unsigned int i = 0; i < Entries.size(); i++)
+	{
+		if (Entries[i].nIndex == nNode)
+			return i;
+	}
+	assert(0);
+	return 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::AdjustUp
+\brief Updates the bounds of the node in its parent and so on to the root.
+<P>---------------------------------------------------------------------------*/
+void CRTree::AdjustUp(unsigned int nNode)
+{
+	while (m_Nodes[nNode].nParent != conNoNode)
+	{
+		const unsigned int nParent = m_Nodes[nNode].nParent;
+		m_Nodes[nParent].Entries[FindInParent(nNode)].Box = GetNodeBox(nNode);
+		nNode = nParent;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Insert
+\brief Adds a rectangle with its id.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Insert(const C2DRect& Rect, unsigned int nId)
+{
+	sEntry Entry;
+	Entry.Box = MakeBox(Rect);
+	Entry.nIndex = nId;
+	if (m_nRoot == conNoNode)
+		m_nRoot = NewNode(0);
+	InsertEntry(Entry, 0);
+	m_nSize++;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::InsertEntry
+\brief Adds the entry to a node at the level, going down to the entry needing the
+least enlargement, then the smallest. A node which is too full is split and the new
+node added to the parent, which may split in turn up to the root.
+<P>---------------------------------------------------------------------------*/
+void CRTree::InsertEntry(const sEntry& Entry, unsigned int nLevel)
+{
+	unsigned int nNode = m_nRoot;
+	while (m_Nodes[nNode].nLevel > nLevel)
+	{
+		const vector<sEntry>& Entries = m_Nodes[nNode].Entries;
+		unsigned int nBest = 0;
+		double dBestGrowth = 0;
+		double dBestArea = 0;
+		for (unsigned int i = 0; i < Entries.size(); i++)
+		{
+			const double dArea = Area(Entries[i].Box);
+			const double dGrowth = Area(Combine(Entries[i].Box, Entry.Box)) - dArea;
+			if (i == 0 || dGrowth < dBestGrowth || (dGrowth == dBestGrowth && dArea < dBestArea))
+			{
+				nBest = i;
+				dBestGrowth = dGrowth;
+				dBestArea = dArea;
+			}
+		}
+		nNode = Entries[nBest].nIndex;
+	}
+
+	m_Nodes[nNode].Entries.push_back(Entry);
+	if (nLevel > 0)
+		m_Nodes[Entry.nIndex].nParent = nNode;
+
+	while (m_Nodes[nNode].Entries.size() > m_nMaxChildren)
+	{
+		const unsigned int nNew = Split(nNode);
+		sEntry NewEntry;
+		NewEntry.Box = GetNodeBox(nNew);
+		NewEntry.nIndex = nNew;
+
+		if (nNode == m_nRoot)
+		{
+			const unsigned int nRoot = NewNode(m_Nodes[nNode].nLevel + 1);
+			sEntry OldEntry;
+			OldEntry.Box = GetNodeBox(nNode);
+			OldEntry.nIndex = nNode;
+			m_Nodes[nRoot].Entries.push_back(OldEntry);
+			m_Nodes[nRoot].Entries.push_back(NewEntry);
+			m_Nodes[nNode].nParent = nRoot;
+			m_Nodes[nNew].nParent = nRoot;
+			m_nRoot = nRoot;
+			return;
+		}
+
+		const unsigned int nParent = m_Nodes[nNode].nParent;
+		m_Nodes[nParent].Entries[FindInParent(nNode)].Box = GetNodeBox(nNode);
+		m_Nodes[nParent].Entries.push_back(NewEntry);
+		m_Nodes[nNew].nParent = nParent;
+		nNode = nParent;
+	}
+	AdjustUp(nNode);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Split
+\brief Splits the node by the quadratic method: the 2 entries which would waste the
+most area together start the 2 groups, then the entry with the strongest preference
+is added to the group it enlarges least, until one group needs the rest to be big
+enough. The second group goes to a new node, which is returned.
+<P>---------------------------------------------------------------------------*/
+unsigned int CRTree::Split(unsigned int nNode)
+{
+	vector<sEntry> Entries;
+	Entries.swap(m_Nodes[nNode].Entries);
+	const unsigned int nCount = Entries.size();
+
+	unsigned int nSeedA = 0, nSeedB = 1;
+	double dWorst = -1;
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		for (unsigned int j = i + 1; j < nCount; j++)
+		{
+			double dWaste = Area(Combine(Entries[i].Box, Entries[j].Box)) -
+				Area(Entries[i].Box) - Area(Entries[j].Box);
+			if (dWaste > dWorst)
+			{
+				dWorst = dWaste;
+				nSeedA = i;
+				nSeedB = j;
+			}
+		}
+	}
+
+	vector<sEntry> GroupA(1, Entries[nSeedA]);
+	vector<sEntry> GroupB(1, Entries[nSeedB]);
+	sBox BoxA = Entries[nSeedA].Box;
+	sBox BoxB = Entries[nSeedB].Box;
+	vector<bool> Assigned(nCount, false);
+	Assigned[nSeedA] = Assigned[nSeedB] = true;
+	unsigned int nLeft = nCount - 2;
+
+	while (nLeft > 0)
+	{
+		if (GroupA.size() + nLeft <= m_nMinChildren || GroupB.size() + nLeft <= m_nMinChildren)
+		{
+			vector<sEntry>& Group = GroupA.size() + nLeft <= m_nMinChildren ? GroupA : GroupB;
+			for (unsigned int i = 0; i < nCount; i++)
+			{
+				if (!Assigned[i])
+					Group.push_back(Entries[i]);
+			}
+			break;
+		}
+
+		unsigned int nNext = 0;
+		double dBestDiff = -1;
+		double dGrowA = 0, dGrowB = 0;
+		for (unsigned int i = 0; i < nCount; i++)
+		{
+			if (Assigned[i])
+				continue;
+			double dA = Area(Combine(BoxA, Entries[i].Box)) - Area(BoxA);
+			double dB = Area(Combine(BoxB, Entries[i].Box)) - Area(BoxB);
+			if (fabs(dA - dB) > dBestDiff)
+			{
+				dBestDiff = fabs(dA - dB);
+				nNext = i;
+				dGrowA = dA;
+				dGrowB = dB;
+			}
+		}
+
+		bool bToA = dGrowA < dGrowB;
+		if (dGrowA == dGrowB)
+		{
+			if (Area(BoxA) != Area(BoxB))
+				bToA = Area(BoxA) < Area(BoxB);
+			else
+				bToA = GroupA.size() <= GroupB.size();
+		}
+		if (bToA)
+		{
+			GroupA.push_back(Entries[nNext]);
+			BoxA = Combine(BoxA, Entries[nNext].Box);
+		}
+		else
+		{
+			GroupB.push_back(Entries[nNext]);
+			BoxB = Combine(BoxB, Entries[nNext].Box);
+		}
+		Assigned[nNext] = true;
+		nLeft--;
+	}
+
+	const unsigned int nNew = NewNode(m_Nodes[nNode].nLevel);
+	m_Nodes[nNode].Entries.swap(GroupA);
+	m_Nodes[nNew].Entries.swap(GroupB);
+	if (m_Nodes[nNew].nLevel > 0)
+	{
+		for (unsigned int i = 0; i < m_Nodes[nNew].Entries.size(); i++)
+			m_Nodes[m_Nodes[nNew].Entries[i].nIndex].nParent = nNew;
+	}
+	return nNew;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::FindLeaf
+\brief Finds the leaf under the node holding the rectangle with the id, and its
+position in the leaf.
+<P>---------------------------------------------------------------------------*/
+bool CRTree::FindLeaf(unsigned int nNode, const sBox& Box, unsigned int nId,
+					  unsigned int& nLeaf, unsigned int& nPosition) const
+{
+	const sNode& Node = m_Nodes[nNode];
+	for (unsigned int i = 0; i < Node.Entries.size(); i++)
+	{
+		const sBox& EntryBox = Node.Entries[i].Box;
+		if (Node.nLevel == 0)
+		{
+			if (Node.Entries[i].nIndex == nId && EntryBox.dMinX == Box.dMinX && EntryBox.dMinY == Box.dMinY &&
+				EntryBox.dMaxX == Box.dMaxX && EntryBox.dMaxY == Box.dMaxY)
+			{
+				nLeaf = nNode;
+				nPosition = i;
+				return true;
+			}
+		}
+		else if (EntryBox.dMinX <= Box.dMinX && EntryBox.dMinY <= Box.dMinY &&
+				 EntryBox.dMaxX >= Box.dMaxX && EntryBox.dMaxY >= Box.dMaxY)
+		{
+			if (FindLeaf(Node.Entries[i].nIndex, Box, nId, nLeaf, nPosition))
+				return true;
+		}
+	}
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::TakeEntries
+\brief Adds the leaf entries under the node to the set and frees the nodes.
+<P>---------------------------------------------------------------------------*/
+void CRTree::TakeEntries(unsigned int nNode, vector<sEntry>& Entries)
+{
+	const sNode& Node = m_Nodes[nNode];
+	if (Node.nLevel == 0)
+		Entries.insert(Entries.end(), Node.Entries.begin(), Node.Entries.end());
+	else
+	{
+		for (unsigned int i = 0; i < Node.Entries.size(); i++)
+			TakeEntries(Node.Entries[i].nIndex, Entries);
+	}
+	FreeNode(nNode);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Remove
+\brief Removes the rectangle with the id, which must be the same as that inserted.
+Nodes left with too few entries on the way to the root are taken out and their
+rectangles inserted again. Returns false if the rectangle is not found.
+<P>---------------------------------------------------------------------------*/
+bool CRTree::Remove(const C2DRect& Rect, unsigned int nId)
+{
+	if (m_nRoot == conNoNode)
+		return false;
+
+	unsigned int nLeaf = 0, nPosition = 0;
+	if (!FindLeaf(m_nRoot, MakeBox(Rect), nId, nLeaf, nPosition))
+		return false;
+
+	m_Nodes[nLeaf].Entries.erase(m_Nodes[nLeaf].Entries.begin() + nPosition);
+	m_nSize--;
+
+	vector<sEntry> Orphans;
+	unsigned int nNode = nLeaf;
+	while (nNode != m_nRoot)
+	{
+		const unsigned int nParent = m_Nodes[nNode].nParent;
+		const unsigned int nInParent = FindInParent(nNode);
+		if (m_Nodes[nNode].Entries.size() < m_nMinChildren)
+		{
+			m_Nodes[nParent].Entries.erase(m_Nodes[nParent].Entries.begin() + nInParent);
+			TakeEntries(nNode, Orphans);
+		}
+		else
+			m_Nodes[nParent].Entries[nInParent].Box = GetNodeBox(nNode);
+		nNode = nParent;
+	}
+
+	// Shorten the tree while the root has a single child.
+	while (m_Nodes[m_nRoot].nLevel > 0 && m_Nodes[m_nRoot].Entries.size() == 1)
+	{
+		const unsigned int nChild = m_Nodes[m_nRoot].Entries[0].nIndex;
+		FreeNode(m_nRoot);
+		m_nRoot = nChild;
+		m_Nodes[m_nRoot].nParent = conNoNode;
+	}
+	if (m_Nodes[m_nRoot].Entries.empty())
+	{
+		FreeNode(m_nRoot);
+		m_nRoot = conNoNode;
+	}
+
+	for (unsigned int i = 0; i < Orphans.size(); i++)
+	{
+		if (m_nRoot == conNoNode)
+			m_nRoot = NewNode(0);
+		InsertEntry(Orphans[i], 0);
+	}
+
+	if (m_nRoot == conNoNode)
+		Clear();
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Search
+\brief Adds the ids of the rectangles under the node overlapping the box.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Search(unsigned int nNode, const sBox& Box, vector<unsigned int>& Ids) const
+{
+	const sNode& Node = m_Nodes[nNode];
+	for (unsigned int i = 0; i < Node.Entries.size(); i++)
+	{
+		if (!Overlaps(Node.Entries[i].Box, Box))
+			continue;
+		if (Node.nLevel == 0)
+			Ids.push_back(Node.Entries[i].nIndex);
+		else
+			Search(Node.Entries[i].nIndex, Box, Ids);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetOverlapping
+\brief Adds the ids of the rectangles which overlap or touch the rectangle to the set.
+<P>---------------------------------------------------------------------------*/
+void CRTree::GetOverlapping(const C2DRect& Rect, vector<unsigned int>& Ids) const
+{
+	if (m_nRoot != conNoNode)
+		Search(m_nRoot, MakeBox(Rect), Ids);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetContaining
+\brief Adds the ids of the rectangles which contain the point, or have it on their
+edge, to the set.
+<P>---------------------------------------------------------------------------*/
+void CRTree::GetContaining(const C2DPoint& Point, vector<unsigned int>& Ids) const
+{
+	if (m_nRoot == conNoNode)
+		return;
+	sBox Box;
+	Box.dMinX = Box.dMaxX = Point.x;
+	Box.dMinY = Box.dMaxY = Point.y;
+	Search(m_nRoot, Box, Ids);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetNearest
+\brief The id of the rectangle nearest the point and its distance, 0 if the point is
+inside. -1 if the tree is empty.
+<P>---------------------------------------------------------------------------*/
+int CRTree::GetNearest(const C2DPoint& Point, double& dDist) const
+{
+	if (m_nRoot == conNoNode)
+		return -1;
+
+	priority_queue<sNearestItem> Heap;
+	sNearestItem Root = { 0, m_nRoot, 0 };
+	Heap.push(Root);
+	while (!Heap.empty())
+	{
+		sNearestItem Item = Heap.top();
+		Heap.pop();
+		if (Item.nType == 1)
+		{
+			dDist = sqrt(Item.dDist2);
+			return (int)Item.nIndex;
+		}
+		const sNode& Node = m_Nodes[Item.nIndex];
+		for (unsigned int i = 0; i < Node.Entries.size(); i++)
+		{
+			sNearestItem Child = { Distance2(Node.Entries[i].Box, Point.x, Point.y),
+				Node.Entries[i].nIndex, (unsigned char)(Node.nLevel == 0 ? 1 : 0) };
+			Heap.push(Child);
+		}
+	}
+	return -1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetNearest
+\brief Adds the ids of the up to k rectangles nearest the point to the set, closest
+first. The nodes and rectangles are taken from a heap in order of distance, best
+first, so only nodes nearer than the kth rectangle are opened.
+<P>---------------------------------------------------------------------------*/
+void CRTree::GetNearest(const C2DPoint& Point, unsigned int k, vector<unsigned int>& Ids) const
+{
+	if (m_nRoot == conNoNode || k == 0)
+		return;
+
+	unsigned int nFound = 0;
+	priority_queue<sNearestItem> Heap;
+	sNearestItem Root = { 0, m_nRoot, 0 };
+	Heap.push(Root);
+	while (!Heap.empty() && nFound < k)
+	{
+		sNearestItem Item = Heap.top();
+		Heap.pop();
+		if (Item.nType == 1)
+		{
+			Ids.push_back(Item.nIndex);
+			nFound++;
+			continue;
+		}
+		const sNode& Node = m_Nodes[Item.nIndex];
+		for (unsigned int i = 0; i < Node.Entries.size(); i++)
+		{
+			sNearestItem Child = { Distance2(Node.Entries[i].Box, Point.x, Point.y),
+				Node.Entries[i].nIndex, (unsigned char)(Node.nLevel == 0 ? 1 : 0) };
+			Heap.push(Child);
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::GetNearest
+\brief The index of the shape of the set nearest the point, and its distance, the set
+being that the tree was built from. The distance is 0 if the point is inside the
+shape. Each rectangle taken from the heap has the distance to its shape found and is
+put back, so that only shapes whose rectangles are nearer than the nearest shape are
+measured. -1 if the tree is empty.
+<P>---------------------------------------------------------------------------*/
+int CRTree::GetNearest(const C2DPoint& Point, const C2DBaseSet& Shapes, double& dDist) const
+{
+	if (m_nRoot == conNoNode)
+		return -1;
+
+	priority_queue<sNearestItem> Heap;
+	sNearestItem Root = { 0, m_nRoot, 0 };
+	Heap.push(Root);
+	while (!Heap.empty())
+	{
+		sNearestItem Item = Heap.top();
+		Heap.pop();
+		if (Item.nType == 2)
+		{
+			dDist = sqrt(Item.dDist2);
+			return (int)Item.nIndex;
+		}
+		if (Item.nType == 1)
+		{
+			// Polygons give a negative distance inside.
+			double dShape = max(0.0, Shapes.GetAt(Item.nIndex)->Distance(Point));
+			sNearestItem Shape = { dShape * dShape, Item.nIndex, 2 };
+			Heap.push(Shape);
+			continue;
+		}
+		const sNode& Node = m_Nodes[Item.nIndex];
+		for (unsigned int i = 0; i < Node.Entries.size(); i++)
+		{
+			sNearestItem Child = { Distance2(Node.Entries[i].Box, Point.x, Point.y),
+				Node.Entries[i].nIndex, (unsigned char)(Node.nLevel == 0 ? 1 : 0) };
+			Heap.push(Child);
+		}
+	}
+	return -1;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Join
+\brief Adds the ids of each pair of rectangles, the first from this tree and the
+second from the other, which overlap or touch. The trees are descended together,
+only into pairs of nodes which overlap.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Join(const CRTree& Other, vector< pair<unsigned int, unsigned int> >& Pairs) const
+{
+	if (m_nRoot == conNoNode || Other.m_nRoot == conNoNode)
+		return;
+	const sBox Box = GetNodeBox(m_nRoot);
+	const sBox OtherBox = Other.GetNodeBox(Other.m_nRoot);
+	if (Overlaps(Box, OtherBox))
+		Join(m_nRoot, Box, Other, Other.m_nRoot, OtherBox, Pairs);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::Join
+\brief Joins the node of this with the node of the other, which overlap, going down
+the higher of the 2 first.
+<P>---------------------------------------------------------------------------*/
+void CRTree::Join(unsigned int nNode, const sBox& Box, const CRTree& Other, unsigned int nOther,
+				  const sBox& OtherBox, vector< pair<unsigned int, unsigned int> >& Pairs) const
+{
+	const sNode& Node = m_Nodes[nNode];
+	const sNode& OtherNode = Other.m_Nodes[nOther];
+
+	if (Node.nLevel == 0 && OtherNode.nLevel == 0)
+	{
+		for (unsigned int i = 0; i < Node.Entries.size(); i++)
+		{
+			if (!Overlaps(Node.Entries[i].Box, OtherBox))
+				continue;
+			for (unsigned int j = 0; j < OtherNode.Entries.size(); j++)
+			{
+				if (Overlaps(Node.Entries[i].Box, OtherNode.Entries[j].Box))
+					Pairs.push_back(make_pair(Node.Entries[i].nIndex, OtherNode.Entries[j].nIndex));
+			}
+		}
+	}
+	else if (Node.nLevel >= OtherNode.nLevel)
+	{
+		for (unsigned int i = 0; i < Node.Entries.size(); i++)
+		{
+			if (Overlaps(Node.Entries[i].Box, OtherBox))
+				Join(Node.Entries[i].nIndex, Node.Entries[i].Box, Other, nOther, OtherBox, Pairs);
+		}
+	}
+	else
+	{
+		for (unsigned int j = 0; j < OtherNode.Entries.size(); j++)
+		{
+			if (Overlaps(Box, OtherNode.Entries[j].Box))
+				Join(nNode, Box, Other, OtherNode.Entries[j].nIndex, OtherNode.Entries[j].Box, Pairs);
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::SelfJoin
+\brief Adds the ids of each pair of rectangles in the tree which overlap or touch,
+each pair once.
+<P>---------------------------------------------------------------------------*/
+void CRTree::SelfJoin(vector< pair<unsigned int, unsigned int> >& Pairs) const
+{
+	if (m_nRoot != conNoNode)
+		SelfJoin(m_nRoot, Pairs);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRTree::SelfJoin
+\brief Joins the node with itself: each child with itself and each overlapping pair
+of children with each other.
+<P>---------------------------------------------------------------------------*/
+void CRTree::SelfJoin(unsigned int nNode, vector< pair<unsigned int, unsigned int> >& Pairs) const
+{
+	const sNode& Node = m_Nodes[nNode];
+	for (unsigned int i = 0; i < Node.Entries.size(); i++)
+	{
+		const sEntry& a = Node.Entries[i];
+		if (Node.nLevel > 0)
+			SelfJoin(a.nIndex, Pairs);
+		for (unsigned int j = i + 1; j < Node.Entries.size(); j++)
+		{
+			const sEntry& b = Node.Entries[j];
+			if (!Overlaps(a.Box, b.Box))
+				continue;
+			if (Node.nLevel == 0)
+				Pairs.push_back(make_pair(a.nIndex, b.nIndex));
+			else
+				Join(a.nIndex, a.Box, *this, b.nIndex, b.Box, Pairs);
+		}
+	}
+}
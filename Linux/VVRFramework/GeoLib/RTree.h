@@ -0,0 +1,172 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file RTree.h
+\brief Declaration file for the CRTree class.
+
+Declaration file for CRTree, a spatial index of rectangles each with an id.
+
+\class CRTree
+\brief An R-tree of rectangles with ids, bulk loaded by sort-tile-recursive packing.
+
+Build packs the rectangles into full nodes: they are sorted into vertical slices by
+the x of their centres, each slice is sorted by y and cut into nodes, and the same is
+done with the nodes until there is one. The nodes overlap little and are full, so
+the tree is shallow. Rectangles can then be inserted, going to the node needing the
+least enlargement and splitting full nodes (quadratic split), and removed, in which
+case nodes left less than 40% full are taken out and their rectangles reinserted.
+
+Rectangles touching at an edge or corner are counted as overlapping, unlike
+C2DRect::Overlaps, so that no shape touching a query is missed. A set of shapes
+(rectangles, polygons, holed polygons...) can be indexed directly by their bounding
+rectangles, the ids being their indices in the set. Queries do not change the tree
+so they can be made from several threads at once.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CRTREE_H
+#define _GEOLIB_CRTREE_H
+
+#include "C2DRect.h"
+
+class C2DBaseSet;
+
+class GeoLib_API CRTree
+{
+public:
+	/// Constructor, for an empty tree with up to nMaxChildren in a node (at least 4).
+	CRTree(unsigned int nMaxChildren = 16);
+	/// Destructor.
+	~CRTree(void);
+
+	/// Builds the tree from the rectangles and their ids, replacing any contents.
+	void Build(const std::vector<C2DRect>& Rects, const std::vector<unsigned int>& Ids);
+	/// Builds the tree from the bounding rectangles of the shapes in the set, with
+	/// their indices as ids.
+	void Build(const C2DBaseSet& Shapes);
+	/// Adds a rectangle.
+	void Insert(const C2DRect& Rect, unsigned int nId);
+	/// Removes the rectangle with the id, which must be the same as that inserted.
+	/// Returns false if it is not found.
+	bool Remove(const C2DRect& Rect, unsigned int nId);
+	/// Removes everything.
+	void Clear(void);
+
+	/// The number of rectangles.
+	unsigned int GetSize(void) const {return m_nSize;}
+	/// The number of levels of nodes, 0 if empty.
+	unsigned int GetHeight(void) const;
+	/// The bounding rectangle of everything, false if empty.
+	bool GetBoundingRect(C2DRect& Rect) const;
+
+	/// Adds the ids of the rectangles which overlap or touch the rectangle to the set.
+	void GetOverlapping(const C2DRect& Rect, std::vector<unsigned int>& Ids) const;
+	/// Adds the ids of the rectangles which contain the point, or have it on their edge.
+	void GetContaining(const C2DPoint& Point, std::vector<unsigned int>& Ids) const;
+	/// The id of the rectangle nearest the point and its distance, -1 if empty.
+	int GetNearest(const C2DPoint& Point, double& dDist) const;
+	/// Adds the ids of the up to k rectangles nearest the point to the set, closest first.
+	void GetNearest(const C2DPoint& Point, unsigned int k, std::vector<unsigned int>& Ids) const;
+	/// The index of the shape of the set nearest the point, the set being that the tree
+	/// was built from, and its distance. 0 if the point is inside. -1 if empty.
+	int GetNearest(const C2DPoint& Point, const C2DBaseSet& Shapes, double& dDist) const;
+	/// Adds the ids of each pair of rectangles, one from each tree, which overlap or touch.
+	void Join(const CRTree& Other, std::vector< std::pair<unsigned int, unsigned int> >& Pairs) const;
+	/// Adds the ids of each pair of rectangles in the tree which overlap or touch, once.
+	void SelfJoin(std::vector< std::pair<unsigned int, unsigned int> >& Pairs) const;
+
+private:
+	/// Not copyable.
+	CRTree(const CRTree&);
+	/// Not copyable.
+	CRTree& operator=(const CRTree&);
+
+	/// A rectangle as its extent.
+	struct sBox
+	{
+		double dMinX;
+		double dMinY;
+		double dMaxX;
+		double dMaxY;
+	};
+
+	/// An entry of a node: a rectangle and its id in a leaf, or a node and its bounds.
+	struct sEntry
+	{
+		/// The bounds.
+		sBox Box;
+		/// The id in a leaf or the node.
+		unsigned int nIndex;
+	};
+
+	/// A node.
+	struct sNode
+	{
+		/// The entries.
+		std::vector<sEntry> Entries;
+		/// The parent node, or conNoNode for the root.
+		unsigned int nParent;
+		/// The level, 0 for a leaf.
+		unsigned int nLevel;
+	};
+
+	/// Makes a node, reusing a free one if there is one.
+	unsigned int NewNode(unsigned int nLevel);
+	/// Frees the node.
+	void FreeNode(unsigned int nNode);
+	/// Packs the entries into nodes at the level, giving the entries for the level above.
+	void Pack(std::vector<sEntry>& Entries, unsigned int nLevel);
+	/// The bounds of the entries of the node.
+	sBox GetNodeBox(unsigned int nNode) const;
+	/// Finds the position of the node in its parent.
+	unsigned int FindInParent(unsigned int nNode) const;
+	/// Updates the bounds of the node in its parent and so on to the root.
+	void AdjustUp(unsigned int nNode);
+	/// Adds the entry to a node at the level, splitting nodes as needed.
+	void InsertEntry(const sEntry& Entry, unsigned int nLevel);
+	/// Splits the node, giving the new node.
+	unsigned int Split(unsigned int nNode);
+	/// Finds the leaf holding the rectangle with the id and its position.
+	bool FindLeaf(unsigned int nNode, const sBox& Box, unsigned int nId,
+				unsigned int& nLeaf, unsigned int& nPosition) const;
+	/// Adds the leaf entries under the node to the set and frees the nodes.
+	void TakeEntries(unsigned int nNode, std::vector<sEntry>& Entries);
+	/// Searches the node for overlaps with the box.
+	void Search(unsigned int nNode, const sBox& Box, std::vector<unsigned int>& Ids) const;
+	/// Joins the node of this with the node of the other, given their bounds.
+	void Join(unsigned int nNode, const sBox& Box, const CRTree& Other, unsigned int nOther,
+				const sBox& OtherBox, std::vector< std::pair<unsigned int, unsigned int> >& Pairs) const;
+	/// Joins the node with itself.
+	void SelfJoin(unsigned int nNode, std::vector< std::pair<unsigned int, unsigned int> >& Pairs) const;
+
+	/// The box of the rectangle.
+	static sBox MakeBox(const C2DRect& Rect);
+	/// True if the boxes overlap or touch.
+	static bool Overlaps(const sBox& a, const sBox& b)
+		{return a.dMinX <= b.dMaxX && b.dMinX <= a.dMaxX && a.dMinY <= b.dMaxY && b.dMinY <= a.dMaxY;}
+	/// The box bounding both.
+	static sBox Combine(const sBox& a, const sBox& b);
+	/// The area.
+	static double Area(const sBox& a) {return (a.dMaxX - a.dMinX) * (a.dMaxY - a.dMinY);}
+	/// The squared distance from the point to the box, 0 if inside.
+	static double Distance2(const sBox& a, double x, double y);
+
+	/// The nodes, some of which may be free.
+	std::vector<sNode> m_Nodes;
+	/// The free nodes.
+	std::vector<unsigned int> m_FreeNodes;
+	/// The root, or conNoNode if empty.
+	unsigned int m_nRoot;
+	/// The number of rectangles.
+	unsigned int m_nSize;
+	/// The most entries in a node.
+	unsigned int m_nMaxChildren;
+	/// The fewest entries in a node, other than the root, after a removal.
+	unsigned int m_nMinChildren;
+};
+
+#endif
@@ -7,17 +7,153 @@ any modified versions of this cannot be resold to any other party.
 
 /**--------------------------------------------------------------------------<BR>
 \file RandomNumber.cpp
-\brief Implementation file for the CRandomNumber Class.
+\brief Implementation file for the CRandomGenerator and CRandomNumber Classes.
 
-Implementation file for CRandomNumber, a class which provides a simple mechanism
-for generating random numbers.
+Implementation file for CRandomGenerator, a fast seedable source of random bits, and
+CRandomNumber, a class which provides a simple mechanism for generating random numbers.
+The generator is xoshiro256** by D. Blackman and S. Vigna, "Scrambled linear
+pseudorandom number generators" (2021).
 <P>---------------------------------------------------------------------------*/
 
 #include "StdAfx.h"
 #include "RandomNumber.h"
+#include <mutex>
 
 using namespace std;
 
+/// The polynomial which advances the state by 2^128.
+static const unsigned long long conJump[4] =
+	{0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+/// The polynomial which advances the state by 2^192.
+static const unsigned long long conLongJump[4] =
+	{0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::CRandomGenerator
+\brief Constructor, with the seed.
+<P>---------------------------------------------------------------------------*/
+CRandomGenerator::CRandomGenerator(unsigned long long nSeed)
+{
+	Seed(nSeed);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::Seed
+\brief Sets the state from the seed by splitmix64, which never gives a state of all 0.
+<P>---------------------------------------------------------------------------*/
+void CRandomGenerator::Seed(unsigned long long nSeed)
+{
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		nSeed += 0x9e3779b97f4a7c15ULL;
+		unsigned long long z = nSeed;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		m_State[i] = z ^ (z >> 31);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::Fill
+\brief Fills the array with random numbers from 0 up to but not including 1.
+<P>---------------------------------------------------------------------------*/
+void CRandomGenerator::Fill(double* pOut, unsigned int nCount)
+{
+	for (unsigned int i = 0; i < nCount; i++)
+		pOut[i] = GetFraction();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::Fill
+\brief Fills the array with random numbers from the min up to the max.
+<P>---------------------------------------------------------------------------*/
+void CRandomGenerator::Fill(double* pOut, unsigned int nCount, double dMin, double dMax)
+{
+	Fill(pOut, nCount);
+	const double dRange = dMax - dMin;
+	for (unsigned int i = 0; i < nCount; i++)
+		pOut[i] = dMin + dRange * pOut[i];
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::Jump
+\brief Advances by 2^128 numbers, to start a stream which does not overlap this for
+2^128 numbers. Up to 2^128 such streams can be made by jumping again.
+<P>---------------------------------------------------------------------------*/
+void CRandomGenerator::Jump(void)
+{
+	Jump(conJump);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::LongJump
+\brief Advances by 2^192 numbers. Each of up to 2^64 streams made by long jumps can be
+split by Jump into 2^64 streams.
+<P>---------------------------------------------------------------------------*/
+void CRandomGenerator::LongJump(void)
+{
+	Jump(conLongJump);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::Jump
+\brief Advances by the polynomial given, as the sum of the states it selects.
+<P>---------------------------------------------------------------------------*/
+void CRandomGenerator::Jump(const unsigned long long* pPoly)
+{
+	unsigned long long State[4] = {0, 0, 0, 0};
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		for (unsigned int b = 0; b < 64; b++)
+		{
+			if (pPoly[i] & (1ULL << b))
+			{
+				for (unsigned int j = 0; j < 4; j++)
+					State[j] ^= m_State[j];
+			}
+			Next();
+		}
+	}
+	for (unsigned int j = 0; j < 4; j++)
+		m_State[j] = State[j];
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeThreadGenerator <BR>
+\brief Makes the generator of a new thread, a copy of the next stream, which then
+takes a LongJump on. The first is seeded with conDefaultSeed.
+<P>---------------------------------------------------------------------------*/
+static CRandomGenerator MakeThreadGenerator(void)
+{
+	static mutex Mutex;
+	static CRandomGenerator NextStream(CRandomGenerator::conDefaultSeed);
+
+	lock_guard<mutex> Lock(Mutex);
+	const CRandomGenerator Generator = NextStream;
+	NextStream.LongJump();
+	return Generator;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomGenerator::GetThreadGenerator
+\brief The generator of the calling thread, made when first used.
+<P>---------------------------------------------------------------------------*/
+CRandomGenerator& CRandomGenerator::GetThreadGenerator(void)
+{
+	static thread_local CRandomGenerator Generator = MakeThreadGenerator();
+	return Generator;
+}
+
+
 _MEMORY_POOL_IMPLEMENATION(CRandomNumber)
 
 /**--------------------------------------------------------------------------<BR>
@@ -28,6 +164,7 @@ CRandomNumber::CRandomNumber(void)
 {
 	m_dMin = 0;
 	m_dMax = 1;
+	m_pGenerator = 0;
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -40,12 +177,14 @@ CRandomNumber::~CRandomNumber(void)
 
 /**--------------------------------------------------------------------------<BR>
 CRandomNumber::CRandomNumber
-\brief Constructor, initialises to 2 double forming the bounds
+\brief Constructor, initialises to 2 double forming the bounds and the generator, 0 for
+the thread's.
 <P>---------------------------------------------------------------------------*/
-CRandomNumber::CRandomNumber(double dMin, double dMax)
+CRandomNumber::CRandomNumber(double dMin, double dMax, CRandomGenerator* pGenerator)
 {
 	m_dMin = dMin;
 	m_dMax = dMax;
+	m_pGenerator = pGenerator;
 }
 
 
@@ -66,8 +205,27 @@ CRandomNumber::Get
 <P>---------------------------------------------------------------------------*/
 double CRandomNumber::Get(void) const
 {
-	double dResult = m_dMin + (m_dMax - m_dMin) * CRandomNumber::GetFraction();
-	return dResult;
+	return GetGenerator().Get(m_dMin, m_dMax);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomNumber::Fill
+\brief Fills the array with random numbers between the bounds.
+<P>---------------------------------------------------------------------------*/
+void CRandomNumber::Fill(double* pOut, unsigned int nCount) const
+{
+	GetGenerator().Fill(pOut, nCount, m_dMin, m_dMax);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomNumber::GetGenerator
+\brief The generator given or, if none, the thread's.
+<P>---------------------------------------------------------------------------*/
+CRandomGenerator& CRandomNumber::GetGenerator(void) const
+{
+	return m_pGenerator ? *m_pGenerator : CRandomGenerator::GetThreadGenerator();
 }
 
 /**--------------------------------------------------------------------------<BR>
@@ -77,7 +235,7 @@ of e.g. 0.8 to 3.7 will become 1.0 to 3.0 allowing integers 1 and 2 only.
 <P>---------------------------------------------------------------------------*/
 int CRandomNumber::GetInt(void) const
 {
-    CRandomNumber Num(ceil(m_dMin), floor(m_dMax) + 1.0);
+    CRandomNumber Num(ceil(m_dMin), floor(m_dMax) + 1.0, m_pGenerator);
 	double dRes = Num.Get();
 	if (dRes == (int)Num.GetMax())
 		return (int) (dRes - 1);
@@ -87,12 +245,11 @@ int CRandomNumber::GetInt(void) const
 
 /**--------------------------------------------------------------------------<BR>
 CRandomNumber::GetFraction
-\brief Gets a random number between 0 and 1 inclusive.
+\brief Gets a random number from 0 up to but not including 1 from the thread's generator.
 <P>---------------------------------------------------------------------------*/
 double CRandomNumber::GetFraction(void)
 {
-	double dResult = (double) rand() / (double) ( RAND_MAX);
-	return dResult;
+	return CRandomGenerator::GetThreadGenerator().GetFraction();
 }
 
 
@@ -102,5 +259,16 @@ CRandomNumber::GetBool
 <P>---------------------------------------------------------------------------*/
 bool CRandomNumber::GetBool(void)
 {
-	return (CRandomNumber::GetFraction() > 0.5);
+	return CRandomGenerator::GetThreadGenerator().GetBool();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CRandomNumber::Seed
+\brief Seeds the thread's generator so that the numbers which follow on this thread
+are the same from run to run.
+<P>---------------------------------------------------------------------------*/
+void CRandomNumber::Seed(unsigned long long nSeed)
+{
+	CRandomGenerator::GetThreadGenerator().Seed(nSeed);
 }
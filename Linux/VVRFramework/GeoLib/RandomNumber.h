@@ -7,21 +7,111 @@ any modified versions of this cannot be resold to any other party.
 
 /**--------------------------------------------------------------------------<BR>
 \file RandomNumber.h
-\brief Declaration file for the CRandomNumber Class.
+\brief Declaration file for the CRandomGenerator and CRandomNumber Classes.
 
-Declaration file for CRandomNumber, a class which provides a simple mechanism
-for generating random numbers.
+Declaration file for CRandomGenerator, a fast seedable source of random bits, and
+CRandomNumber, a class which provides a simple mechanism for generating random numbers.
+
+\class CRandomGenerator
+\brief A fast seedable random number generator, xoshiro256**.
+
+Each generator has its own 256 bits of state so generators on different threads do
+not share anything. The seed is spread over the state by splitmix64. Jump advances
+the state by 2^128 numbers and LongJump by 2^192 so that streams made from one seed
+by jumping never overlap, e.g. a stream for each thread of a parallel task:
+
+	CRandomGenerator Stream(nSeed);
+	for (unsigned int t = 0; t < nThreads; t++)
+	{
+		Streams[t] = Stream;
+		Stream.Jump();
+	}
+
+It meets the needs of a uniform random bit generator so it can also be used with the
+distributions and algorithms of the standard library.
+
+Each thread has a generator of its own, GetThreadGenerator, which is used where no
+generator is given. The first thread's is seeded with conDefaultSeed and each new
+thread's is a LongJump further on, so the numbers are the same from run to run.
 
 \class CRandomNumber
 \brief A class which provides a simple mechanism for generating random numbers.
+
+The numbers come from the generator given or, if none, the thread's generator.
 <P>---------------------------------------------------------------------------*/
 
-#ifndef _GEOLIB_CRANDOMNUMBER_H 
+#ifndef _GEOLIB_CRANDOMNUMBER_H
 #define _GEOLIB_CRANDOMNUMBER_H
 
 
 #include "MemoryPool.h"
 
+class GeoLib_API CRandomGenerator
+{
+public:
+	/// The type of the numbers made.
+	typedef unsigned long long result_type;
+	/// The seed of the thread generators.
+	static const unsigned long long conDefaultSeed = 0x2545F4914F6CDD1DULL;
+
+	/// Constructor, with the seed.
+	CRandomGenerator(unsigned long long nSeed = conDefaultSeed);
+	/// Sets the state from the seed.
+	void Seed(unsigned long long nSeed);
+
+	/// The next 64 random bits.
+	unsigned long long Next(void)
+	{
+		const unsigned long long nResult = Rotate(m_State[1] * 5, 7) * 9;
+		const unsigned long long t = m_State[1] << 17;
+		m_State[2] ^= m_State[0];
+		m_State[3] ^= m_State[1];
+		m_State[1] ^= m_State[2];
+		m_State[0] ^= m_State[3];
+		m_State[2] ^= t;
+		m_State[3] = Rotate(m_State[3], 45);
+		return nResult;
+	}
+	/// The next 64 random bits.
+	result_type operator()(void) {return Next();}
+	/// The smallest number made.
+	static constexpr result_type min(void) {return 0;}
+	/// The largest number made.
+	static constexpr result_type max(void) {return ~0ULL;}
+
+	/// A random number from 0 up to but not including 1.
+	double GetFraction(void) {return (Next() >> 11) * (1.0 / 9007199254740992.0);}
+	/// A random number from the min up to the max.
+	double Get(double dMin, double dMax) {return dMin + (dMax - dMin) * GetFraction();}
+	/// A random integer from 0 up to but not including the count.
+	unsigned int GetInt(unsigned int nCount) {return (unsigned int)(((Next() >> 32) * nCount) >> 32);}
+	/// True or false.
+	bool GetBool(void) {return (Next() >> 63) != 0;}
+
+	/// Fills the array with random numbers from 0 up to but not including 1.
+	void Fill(double* pOut, unsigned int nCount);
+	/// Fills the array with random numbers from the min up to the max.
+	void Fill(double* pOut, unsigned int nCount, double dMin, double dMax);
+
+	/// Advances by 2^128 numbers, to start a stream which does not overlap this.
+	void Jump(void);
+	/// Advances by 2^192 numbers.
+	void LongJump(void);
+
+	/// The generator of the calling thread.
+	static CRandomGenerator& GetThreadGenerator(void);
+
+private:
+	/// Rotates the bits left.
+	static unsigned long long Rotate(unsigned long long x, int k) {return (x << k) | (x >> (64 - k));}
+	/// Advances by the polynomial given.
+	void Jump(const unsigned long long* pPoly);
+
+	/// The state.
+	unsigned long long m_State[4];
+};
+
+
 class GeoLib_API CRandomNumber
 {
 public:
@@ -29,8 +119,9 @@ public:
 
 	/// Constructor
 	CRandomNumber(void);
-	/// Constructor, initialises to 2 double forming the bounds
-	CRandomNumber(double dMin, double dMax);
+	/// Constructor, initialises to 2 double forming the bounds and the generator, 0 for
+	/// the thread's.
+	CRandomNumber(double dMin, double dMax, CRandomGenerator* pGenerator = 0);
 	/// Destructor.
 	~CRandomNumber(void);
 	/// Sets the random number bound to 2 doubles
@@ -43,21 +134,32 @@ public:
 	double GetMin(void) const {return m_dMin;}
 	/// Access to the max
 	double GetMax(void)  const {return m_dMax;}
+	/// Sets the generator, 0 for the thread's.
+	void SetGenerator(CRandomGenerator* pGenerator) {m_pGenerator = pGenerator;}
 	/// Gets a random number based on the settings
 	double Get(void) const;
+	/// Fills the array with random numbers based on the settings.
+	void Fill(double* pOut, unsigned int nCount) const;
 	/// Gets an integer based on the settings. Sets up temporary new boundaries so that an interval
 	/// of e.g. 0.8 to 3.7 will become 1.0 to 3.0 allowing integers 1 and 2 only.
 	int GetInt(void) const;
-	/// Returns a random number from 0 to 1 inclusive.
+	/// Returns a random number from 0 up to 1 from the thread's generator.
 	static double GetFraction(void);
-	/// Returns true or false;
+	/// Returns true or false from the thread's generator.
 	static bool GetBool(void);
+	/// Seeds the thread's generator.
+	static void Seed(unsigned long long nSeed);
 
 private:
+	/// The generator to use.
+	CRandomGenerator& GetGenerator(void) const;
+
 	/// The minimum possible value
 	double m_dMin;
 	/// The maximum possible value
 	double m_dMax;
+	/// The generator, 0 for the thread's.
+	CRandomGenerator* m_pGenerator;
 };
 
 #endif
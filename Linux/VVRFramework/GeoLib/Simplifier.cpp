@@ -0,0 +1,873 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Simplifier.cpp
+\brief Implementation file for the CSimplifier and CStreamSimplifier classes.
+
+Implementation file for CSimplifier and CStreamSimplifier. The topology test relies
+on the paths being valid to start with: a new line between 2 points of a path can
+then only cross another line if an end of that line is in the area the new line
+cuts off, so only the points need to be tested, which are held in a grid.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "Simplifier.h"
+#include "Predicates.h"
+#include "C2DRoute.h"
+#include "C2DPolygon.h"
+#include "C2DHoledPolyBase.h"
+#include "C2DLineBaseSet.h"
+#include "C2DLine.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+using namespace std;
+
+/// No point.
+const unsigned int conNoVertex = 0xFFFFFFFF;
+/// The greatest number of grid cells along each side.
+const unsigned int conMaxGridCells = 1024;
+
+
+/**--------------------------------------------------------------------------<BR>
+struct sSimplifyVertex
+\brief A point of a path being simplified.
+<P>---------------------------------------------------------------------------*/
+struct sSimplifyVertex
+{
+	/// The point.
+	C2DPoint Pt;
+	/// The previous and next points still in the path, or conNoVertex at the ends.
+	unsigned int nPrev;
+	unsigned int nNext;
+	/// The path.
+	unsigned int nPath;
+	/// For Visvalingam, the version of the heap entry for this point.
+	unsigned int nStamp;
+	/// True once removed.
+	bool bRemoved;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+struct sSection
+\brief For Douglas-Peucker, a part of a path between 2 positions with the point
+furthest from the line joining them.
+<P>---------------------------------------------------------------------------*/
+struct sSection
+{
+	/// The distance of the furthest point.
+	double dDistance;
+	/// The path.
+	unsigned int nPath;
+	/// The positions in the path of the ends and the furthest point. For a closed path
+	/// the end may be past the last point, wrapping round to the start.
+	unsigned int nFrom;
+	unsigned int nTo;
+	unsigned int nFurthest;
+
+	/// Orders the heap with the furthest on top.
+	bool operator<(const sSection& Other) const {return dDistance < Other.dDistance;}
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+struct sAreaEntry
+\brief For Visvalingam, a point in the heap with the area of its triangle.
+<P>---------------------------------------------------------------------------*/
+struct sAreaEntry
+{
+	/// The area.
+	double dArea;
+	/// The point.
+	unsigned int nVertex;
+	/// The version of the point this was made for.
+	unsigned int nStamp;
+
+	/// Orders the heap with the smallest on top.
+	bool operator<(const sAreaEntry& Other) const
+	{
+		if (dArea != Other.dArea)
+			return dArea > Other.dArea;
+		return nVertex > Other.nVertex;
+	}
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+DistanceToSegment <BR>
+\brief The distance from the point to the line segment a-b.
+<P>---------------------------------------------------------------------------*/
+static double DistanceToSegment(const C2DPoint& p, const C2DPoint& a, const C2DPoint& b)
+{
+	const double dx = b.x - a.x;
+	const double dy = b.y - a.y;
+	const double dLength2 = dx * dx + dy * dy;
+	double t = 0;
+	if (dLength2 > 0)
+		t = max(0.0, min(1.0, ((p.x - a.x) * dx + (p.y - a.y) * dy) / dLength2));
+	const double ex = p.x - (a.x + t * dx);
+	const double ey = p.y - (a.y + t * dy);
+	return sqrt(ex * ex + ey * ey);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+IsOnSegment <BR>
+\brief True if the point is on the line segment a-b. Exact.
+<P>---------------------------------------------------------------------------*/
+static bool IsOnSegment(const C2DPoint& p, const C2DPoint& a, const C2DPoint& b)
+{
+	return GeoPredicates::Orient2D(a.x, a.y, b.x, b.y, p.x, p.y) == 0 &&
+		p.x >= min(a.x, b.x) && p.x <= max(a.x, b.x) &&
+		p.y >= min(a.y, b.y) && p.y <= max(a.y, b.y);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+class CSimplifyPaths
+\brief The paths being simplified, linked through their points, with a grid of the
+points for the topology test.
+<P>---------------------------------------------------------------------------*/
+class CSimplifyPaths
+{
+public:
+	CSimplifyPaths(const vector< vector<C2DPoint> >& Paths, const vector<bool>& Closed);
+
+	/// Simplifies by Douglas-Peucker.
+	void DouglasPeucker(double dTolerance, bool bPreserveTopology);
+	/// Simplifies by Visvalingam-Whyatt.
+	void Visvalingam(double dTolerance, bool bPreserveTopology);
+	/// Sets the points to keep. Returns the number removed.
+	unsigned int GetKeep(vector< vector<bool> >& Keep) const;
+
+private:
+	/// The point at the position in the path, wrapping round for a closed path.
+	unsigned int GetVertex(unsigned int nPath, unsigned int nPos) const
+	{
+		return m_PathStart[nPath] + nPos % m_PathCount[nPath];
+	}
+	/// Finds the point furthest from the line joining the ends of the section.
+	void FindFurthest(sSection& Section) const;
+	/// The area of the triangle the point makes with its neighbours.
+	double GetArea(unsigned int nVertex) const;
+	/// Makes the grid of points.
+	void MakeGrid(void);
+	/// Adds the points in the grid cells covering the box to the set.
+	void FindInBox(double dMinX, double dMinY, double dMaxX, double dMaxY,
+				vector<unsigned int>& Found) const;
+	/// True if any other point lies between the section and the line joining its ends.
+	bool IsSectionBlocked(const sSection& Section) const;
+	/// True if any other point lies in the triangle the point makes with its neighbours.
+	bool IsTriangleBlocked(unsigned int nVertex) const;
+
+	/// The points.
+	vector<sSimplifyVertex> m_Vertices;
+	/// The index of the first point of each path.
+	vector<unsigned int> m_PathStart;
+	/// The number of points in each path.
+	vector<unsigned int> m_PathCount;
+	/// The number of points of each path not removed.
+	vector<unsigned int> m_PathLive;
+	/// True for each closed path.
+	vector<bool> m_PathClosed;
+
+	/// The grid of points, by row.
+	vector< vector<unsigned int> > m_Grid;
+	unsigned int m_nGridX;
+	unsigned int m_nGridY;
+	double m_dGridMinX;
+	double m_dGridMinY;
+	double m_dCellSize;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::CSimplifyPaths
+\brief Links the points of the paths.
+<P>---------------------------------------------------------------------------*/
+CSimplifyPaths::CSimplifyPaths(const vector< vector<C2DPoint> >& Paths, const vector<bool>& Closed)
+	: m_nGridX(0), m_nGridY(0), m_dGridMinX(0), m_dGridMinY(0), m_dCellSize(1)
+{
+	unsigned int nTotal = 0;
+	for (unsigned int p = 0; p < Paths.size(); p++)
+		nTotal += Paths[p].size();
+	m_Vertices.resize(nTotal);
+
+	unsigned int nIndex = 0;
+	for (unsigned int p = 0; p < Paths.size(); p++)
+	{
+		const unsigned int nCount = Paths[p].size();
+		const bool bClosed = p < Closed.size() && Closed[p];
+		m_PathStart.push_back(nIndex);
+		m_PathCount.push_back(nCount);
+		m_PathLive.push_back(nCount);
+		m_PathClosed.push_back(bClosed);
+
+		for (unsigned int i = 0; i < nCount; i++)
+		{
+			sSimplifyVertex& Vertex = m_Vertices[nIndex + i];
+			Vertex.Pt = Paths[p][i];
+			Vertex.nPath = p;
+			Vertex.nStamp = 0;
+			Vertex.bRemoved = false;
+			if (i > 0)
+				Vertex.nPrev = nIndex + i - 1;
+			else
+				Vertex.nPrev = bClosed ? nIndex + nCount - 1 : conNoVertex;
+			if (i + 1 < nCount)
+				Vertex.nNext = nIndex + i + 1;
+			else
+				Vertex.nNext = bClosed ? nIndex : conNoVertex;
+		}
+		nIndex += nCount;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::MakeGrid
+\brief Makes the grid of points with about 2 points to a cell.
+<P>---------------------------------------------------------------------------*/
+void CSimplifyPaths::MakeGrid(void)
+{
+	if (m_Vertices.empty())
+		return;
+
+	double dMinX = m_Vertices[0].Pt.x;
+	double dMaxX = dMinX;
+	double dMinY = m_Vertices[0].Pt.y;
+	double dMaxY = dMinY;
+	for (unsigned int i = 1; i < m_Vertices.size(); i++)
+	{
+		const C2DPoint& Pt = m_Vertices[i].Pt;
+		dMinX = min(dMinX, Pt.x);
+		dMaxX = max(dMaxX, Pt.x);
+		dMinY = min(dMinY, Pt.y);
+		dMaxY = max(dMaxY, Pt.y);
+	}
+
+	const double dWidth = dMaxX - dMinX;
+	const double dHeight = dMaxY - dMinY;
+	const double dSide = max(dWidth, dHeight);
+	m_dCellSize = dSide > 0 ? sqrt(max(dWidth * dHeight, dSide * dSide / conMaxGridCells) * 2 / m_Vertices.size()) : 1;
+	if (m_dCellSize <= 0)
+		m_dCellSize = dSide > 0 ? dSide : 1;
+
+	m_nGridX = min(conMaxGridCells, (unsigned int)(dWidth / m_dCellSize) + 1);
+	m_nGridY = min(conMaxGridCells, (unsigned int)(dHeight / m_dCellSize) + 1);
+	m_dCellSize = max(m_dCellSize, max(dWidth / m_nGridX, dHeight / m_nGridY));
+	m_dGridMinX = dMinX;
+	m_dGridMinY = dMinY;
+
+	m_Grid.assign(m_nGridX * m_nGridY, vector<unsigned int>());
+	for (unsigned int i = 0; i < m_Vertices.size(); i++)
+	{
+		const C2DPoint& Pt = m_Vertices[i].Pt;
+		unsigned int x = min(m_nGridX - 1, (unsigned int)((Pt.x - dMinX) / m_dCellSize));
+		unsigned int y = min(m_nGridY - 1, (unsigned int)((Pt.y - dMinY) / m_dCellSize));
+		m_Grid[y * m_nGridX + x].push_back(i);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::FindInBox
+\brief Adds the points not removed in the grid cells covering the box to the set.
+<P>---------------------------------------------------------------------------*/
+void CSimplifyPaths::FindInBox(double dMinX, double dMinY, double dMaxX, double dMaxY,
+							   vector<unsigned int>& Found) const
+{
+	const double dX0 = max(0.0, (dMinX - m_dGridMinX) / m_dCellSize);
+	const double dY0 = max(0.0, (dMinY - m_dGridMinY) / m_dCellSize);
+	const double dX1 = (dMaxX - m_dGridMinX) / m_dCellSize;
+	const double dY1 = (dMaxY - m_dGridMinY) / m_dCellSize;
+	if (dX1 < 0 || dY1 < 0)
+		return;
+
+	const unsigned int x0 = min(m_nGridX - 1, (unsigned int)dX0);
+	const unsigned int y0 = min(m_nGridY - 1, (unsigned int)dY0);
+	const unsigned int x1 = min(m_nGridX - 1, (unsigned int)dX1);
+	const unsigned int y1 = min(m_nGridY - 1, (unsigned int)dY1);
+
+	for (unsigned int y = y0; y <= y1; y++)
+	{
+		for (unsigned int x = x0; x <= x1; x++)
+		{
+			const vector<unsigned int>& Cell = m_Grid[y * m_nGridX + x];
+			for (unsigned int i = 0; i < Cell.size(); i++)
+			{
+				if (!m_Vertices[Cell[i]].bRemoved)
+					Found.push_back(Cell[i]);
+			}
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::FindFurthest
+\brief Finds the point of the section furthest from the line joining its ends.
+<P>---------------------------------------------------------------------------*/
+void CSimplifyPaths::FindFurthest(sSection& Section) const
+{
+	const C2DPoint& a = m_Vertices[GetVertex(Section.nPath, Section.nFrom)].Pt;
+	const C2DPoint& b = m_Vertices[GetVertex(Section.nPath, Section.nTo)].Pt;
+
+	Section.dDistance = -1;
+	Section.nFurthest = Section.nFrom;
+	for (unsigned int nPos = Section.nFrom + 1; nPos < Section.nTo; nPos++)
+	{
+		double dDistance = DistanceToSegment(m_Vertices[GetVertex(Section.nPath, nPos)].Pt, a, b);
+		if (dDistance > Section.dDistance)
+		{
+			Section.dDistance = dDistance;
+			Section.nFurthest = nPos;
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::IsSectionBlocked
+\brief True if any point, other than those of the section, is in the area between the
+section and the line joining its ends or on its edge. The area is within the
+distance of the furthest point from the line so only points within that are tested.
+<P>---------------------------------------------------------------------------*/
+bool CSimplifyPaths::IsSectionBlocked(const sSection& Section) const
+{
+	vector<C2DPoint> Region;
+	double dMinX = 0, dMinY = 0, dMaxX = 0, dMaxY = 0;
+	for (unsigned int nPos = Section.nFrom; nPos <= Section.nTo; nPos++)
+	{
+		const C2DPoint& Pt = m_Vertices[GetVertex(Section.nPath, nPos)].Pt;
+		if (Region.empty())
+		{
+			dMinX = dMaxX = Pt.x;
+			dMinY = dMaxY = Pt.y;
+		}
+		dMinX = min(dMinX, Pt.x);
+		dMaxX = max(dMaxX, Pt.x);
+		dMinY = min(dMinY, Pt.y);
+		dMaxY = max(dMaxY, Pt.y);
+		Region.push_back(Pt);
+	}
+
+	const C2DPoint& a = Region.front();
+	const C2DPoint& b = Region.back();
+	const unsigned int nStart = m_PathStart[Section.nPath];
+	const unsigned int nCount = m_PathCount[Section.nPath];
+
+	vector<unsigned int> Found;
+	FindInBox(dMinX, dMinY, dMaxX, dMaxY, Found);
+
+	for (unsigned int i = 0; i < Found.size(); i++)
+	{
+		const sSimplifyVertex& Vertex = m_Vertices[Found[i]];
+		const C2DPoint& p = Vertex.Pt;
+		if (p.x < dMinX || p.x > dMaxX || p.y < dMinY || p.y > dMaxY || p == a || p == b)
+			continue;
+		// Points of the section itself.
+		if (Vertex.nPath == Section.nPath &&
+			(Found[i] - nStart + nCount - Section.nFrom % nCount) % nCount <= Section.nTo - Section.nFrom)
+		{
+			continue;
+		}
+		if (DistanceToSegment(p, a, b) > Section.dDistance)
+			continue;
+
+		// Inside or on the edge of the area, counting crossings to the right.
+		bool bInside = false;
+		for (unsigned int j = 0; j < Region.size(); j++)
+		{
+			const C2DPoint& p1 = Region[j];
+			const C2DPoint& p2 = Region[(j + 1) % Region.size()];
+			if (IsOnSegment(p, p1, p2))
+				return true;
+			if ((p1.y > p.y) != (p2.y > p.y))
+			{
+				double dOrient = GeoPredicates::Orient2D(p1.x, p1.y, p2.x, p2.y, p.x, p.y);
+				if ((dOrient > 0) == (p2.y > p1.y))
+					bInside = !bInside;
+			}
+		}
+		if (bInside)
+			return true;
+	}
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::DouglasPeucker
+\brief Simplifies by Douglas-Peucker, splitting the section with the furthest point
+first. An open path starts as a single section and a closed path as 2, split at the
+point furthest from the first. A section within the tolerance is still split if it
+would leave a closed path with fewer than 3 points or is blocked.
+<P>---------------------------------------------------------------------------*/
+void CSimplifyPaths::DouglasPeucker(double dTolerance, bool bPreserveTopology)
+{
+	if (bPreserveTopology)
+		MakeGrid();
+
+	priority_queue<sSection> Heap;
+
+	for (unsigned int p = 0; p < m_PathCount.size(); p++)
+	{
+		const unsigned int nCount = m_PathCount[p];
+		if (m_PathClosed[p])
+		{
+			if (nCount <= 3)
+				continue;
+			// Split at the point furthest from the first.
+			const C2DPoint& First = m_Vertices[m_PathStart[p]].Pt;
+			unsigned int nFurthest = 0;
+			double dFurthest = 0;
+			for (unsigned int i = 1; i < nCount; i++)
+			{
+				double dDistance = First.Distance(m_Vertices[m_PathStart[p] + i].Pt);
+				if (dDistance > dFurthest)
+				{
+					dFurthest = dDistance;
+					nFurthest = i;
+				}
+			}
+			if (nFurthest == 0)
+				continue;
+
+			sSection Section;
+			Section.nPath = p;
+			Section.nFrom = 0;
+			Section.nTo = nFurthest;
+			if (nFurthest > 1)
+			{
+				FindFurthest(Section);
+				Heap.push(Section);
+			}
+			Section.nFrom = nFurthest;
+			Section.nTo = nCount;
+			if (nCount - nFurthest > 1)
+			{
+				FindFurthest(Section);
+				Heap.push(Section);
+			}
+		}
+		else if (nCount > 2)
+		{
+			sSection Section;
+			Section.nPath = p;
+			Section.nFrom = 0;
+			Section.nTo = nCount - 1;
+			FindFurthest(Section);
+			Heap.push(Section);
+		}
+	}
+
+	while (!Heap.empty())
+	{
+		sSection Section = Heap.top();
+		Heap.pop();
+
+		const unsigned int nInside = Section.nTo - Section.nFrom - 1;
+		bool bSplit = Section.dDistance > dTolerance;
+		if (!bSplit && m_PathClosed[Section.nPath] && m_PathLive[Section.nPath] - nInside < 3)
+			bSplit = true;
+		if (!bSplit && bPreserveTopology && IsSectionBlocked(Section))
+			bSplit = true;
+
+		if (bSplit)
+		{
+			sSection Part;
+			Part.nPath = Section.nPath;
+			Part.nFrom = Section.nFrom;
+			Part.nTo = Section.nFurthest;
+			if (Part.nTo - Part.nFrom > 1)
+			{
+				FindFurthest(Part);
+				Heap.push(Part);
+			}
+			Part.nFrom = Section.nFurthest;
+			Part.nTo = Section.nTo;
+			if (Part.nTo - Part.nFrom > 1)
+			{
+				FindFurthest(Part);
+				Heap.push(Part);
+			}
+		}
+		else
+		{
+			for (unsigned int nPos = Section.nFrom + 1; nPos < Section.nTo; nPos++)
+				m_Vertices[GetVertex(Section.nPath, nPos)].bRemoved = true;
+			m_PathLive[Section.nPath] -= nInside;
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::GetArea
+\brief The area of the triangle the point makes with its neighbours.
+<P>---------------------------------------------------------------------------*/
+double CSimplifyPaths::GetArea(unsigned int nVertex) const
+{
+	const sSimplifyVertex& Vertex = m_Vertices[nVertex];
+	const C2DPoint& a = m_Vertices[Vertex.nPrev].Pt;
+	const C2DPoint& b = Vertex.Pt;
+	const C2DPoint& c = m_Vertices[Vertex.nNext].Pt;
+	return fabs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) / 2;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::IsTriangleBlocked
+\brief True if any point, other than the neighbours, is inside or on the edge of the
+triangle the point makes with its neighbours.
+<P>---------------------------------------------------------------------------*/
+bool CSimplifyPaths::IsTriangleBlocked(unsigned int nVertex) const
+{
+	const sSimplifyVertex& Vertex = m_Vertices[nVertex];
+	const C2DPoint& a = m_Vertices[Vertex.nPrev].Pt;
+	const C2DPoint& b = Vertex.Pt;
+	const C2DPoint& c = m_Vertices[Vertex.nNext].Pt;
+
+	const double dMinX = min(a.x, min(b.x, c.x));
+	const double dMaxX = max(a.x, max(b.x, c.x));
+	const double dMinY = min(a.y, min(b.y, c.y));
+	const double dMaxY = max(a.y, max(b.y, c.y));
+
+	vector<unsigned int> Found;
+	FindInBox(dMinX, dMinY, dMaxX, dMaxY, Found);
+
+	for (unsigned int i = 0; i < Found.size(); i++)
+	{
+		const unsigned int nOther = Found[i];
+		if (nOther == nVertex || nOther == Vertex.nPrev || nOther == Vertex.nNext)
+			continue;
+		const C2DPoint& p = m_Vertices[nOther].Pt;
+		if (p.x < dMinX || p.x > dMaxX || p.y < dMinY || p.y > dMaxY || p == a || p == c)
+			continue;
+
+		const double o1 = GeoPredicates::Orient2D(a.x, a.y, b.x, b.y, p.x, p.y);
+		const double o2 = GeoPredicates::Orient2D(b.x, b.y, c.x, c.y, p.x, p.y);
+		const double o3 = GeoPredicates::Orient2D(c.x, c.y, a.x, a.y, p.x, p.y);
+		if ((o1 >= 0 && o2 >= 0 && o3 >= 0) || (o1 <= 0 && o2 <= 0 && o3 <= 0))
+			return true;
+	}
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::Visvalingam
+\brief Simplifies by Visvalingam-Whyatt, removing the point with the smallest triangle
+first. The area of a neighbour of a point removed is not allowed to fall below that
+of the point so that the points are removed in order. A blocked point is passed over
+until one of its neighbours is removed.
+<P>---------------------------------------------------------------------------*/
+void CSimplifyPaths::Visvalingam(double dTolerance, bool bPreserveTopology)
+{
+	if (bPreserveTopology)
+		MakeGrid();
+
+	priority_queue<sAreaEntry> Heap;
+	for (unsigned int i = 0; i < m_Vertices.size(); i++)
+	{
+		const sSimplifyVertex& Vertex = m_Vertices[i];
+		if (Vertex.nPrev == conNoVertex || Vertex.nNext == conNoVertex)
+			continue;
+		if (m_PathClosed[Vertex.nPath] && m_PathCount[Vertex.nPath] <= 3)
+			continue;
+		sAreaEntry Entry = { GetArea(i), i, 0 };
+		Heap.push(Entry);
+	}
+
+	while (!Heap.empty())
+	{
+		sAreaEntry Entry = Heap.top();
+		Heap.pop();
+
+		sSimplifyVertex& Vertex = m_Vertices[Entry.nVertex];
+		if (Vertex.bRemoved || Vertex.nStamp != Entry.nStamp)
+			continue;
+		if (Entry.dArea > dTolerance)
+			break;
+		if (m_PathClosed[Vertex.nPath] && m_PathLive[Vertex.nPath] <= 3)
+			continue;
+		if (bPreserveTopology && IsTriangleBlocked(Entry.nVertex))
+			continue;
+
+		Vertex.bRemoved = true;
+		m_PathLive[Vertex.nPath]--;
+		m_Vertices[Vertex.nPrev].nNext = Vertex.nNext;
+		m_Vertices[Vertex.nNext].nPrev = Vertex.nPrev;
+
+		const unsigned int Neighbours[2] = { Vertex.nPrev, Vertex.nNext };
+		for (unsigned int n = 0; n < 2; n++)
+		{
+			sSimplifyVertex& Neighbour = m_Vertices[Neighbours[n]];
+			if (Neighbour.nPrev == conNoVertex || Neighbour.nNext == conNoVertex)
+				continue;
+			Neighbour.nStamp++;
+			sAreaEntry Update = { max(Entry.dArea, GetArea(Neighbours[n])), Neighbours[n], Neighbour.nStamp };
+			Heap.push(Update);
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifyPaths::GetKeep
+\brief Sets the points to keep for each path. Returns the number removed.
+<P>---------------------------------------------------------------------------*/
+unsigned int CSimplifyPaths::GetKeep(vector< vector<bool> >& Keep) const
+{
+	unsigned int nRemoved = 0;
+	Keep.resize(m_PathCount.size());
+	for (unsigned int p = 0; p < m_PathCount.size(); p++)
+	{
+		Keep[p].resize(m_PathCount[p]);
+		for (unsigned int i = 0; i < m_PathCount[p]; i++)
+			Keep[p][i] = !m_Vertices[m_PathStart[p] + i].bRemoved;
+		nRemoved += m_PathCount[p] - m_PathLive[p];
+	}
+	return nRemoved;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifier::CSimplifier
+\brief Constructor, for Douglas-Peucker with a tolerance of 0 which only removes points
+on the line between their neighbours.
+<P>---------------------------------------------------------------------------*/
+CSimplifier::CSimplifier(void) : m_eMethod(DouglasPeucker), m_dTolerance(0), m_bPreserveTopology(true)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifier::CSimplifier
+\brief Constructor.
+<P>---------------------------------------------------------------------------*/
+CSimplifier::CSimplifier(eMethod eMeth, double dTolerance, bool bPreserveTopology)
+	: m_eMethod(eMeth), m_dTolerance(dTolerance), m_bPreserveTopology(bPreserveTopology)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifier::~CSimplifier
+\brief Destructor.
+<P>---------------------------------------------------------------------------*/
+CSimplifier::~CSimplifier(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifier::Simplify
+\brief Finds the points to keep of the paths given, open or closed, which are
+simplified together. The ends of open paths are always kept. Returns the number of
+points removed.
+<P>---------------------------------------------------------------------------*/
+unsigned int CSimplifier::Simplify(const vector< vector<C2DPoint> >& Paths,
+								   const vector<bool>& Closed, vector< vector<bool> >& Keep) const
+{
+	CSimplifyPaths Work(Paths, Closed);
+	if (m_eMethod == Visvalingam)
+		Work.Visvalingam(m_dTolerance, m_bPreserveTopology);
+	else
+		Work.DouglasPeucker(m_dTolerance, m_bPreserveTopology);
+	return Work.GetKeep(Keep);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifier::Simplify
+\brief Simplifies the route, keeping its ends. Returns the number of points removed.
+<P>---------------------------------------------------------------------------*/
+unsigned int CSimplifier::Simplify(C2DRoute& Route) const
+{
+	vector< vector<C2DPoint> > Paths(1);
+	for (int i = 0; i < Route.GetPointsCount(); i++)
+		Paths[0].push_back(Route.GetPoint(i));
+
+	vector< vector<bool> > Keep;
+	unsigned int nRemoved = Simplify(Paths, vector<bool>(1, false), Keep);
+	if (nRemoved == 0)
+		return 0;
+
+	Route.Clear();
+	for (unsigned int i = 0; i < Paths[0].size(); i++)
+	{
+		if (Keep[0][i])
+			Route.AddPoint(Paths[0][i]);
+	}
+	return nRemoved;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifier::Simplify
+\brief Simplifies the polygon. Returns the number of points removed.
+<P>---------------------------------------------------------------------------*/
+unsigned int CSimplifier::Simplify(C2DPolygon& Polygon) const
+{
+	vector< vector<C2DPoint> > Paths(1);
+	for (unsigned int i = 0; i < Polygon.GetLineCount(); i++)
+		Paths[0].push_back(Polygon.GetLine(i)->GetPointFrom());
+
+	vector< vector<bool> > Keep;
+	unsigned int nRemoved = Simplify(Paths, vector<bool>(1, true), Keep);
+	if (nRemoved == 0)
+		return 0;
+
+	vector<C2DPoint> Points;
+	for (unsigned int i = 0; i < Paths[0].size(); i++)
+	{
+		if (Keep[0][i])
+			Points.push_back(Paths[0][i]);
+	}
+	Polygon.Create(&Points[0], Points.size());
+	return nRemoved;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CSimplifier::Simplify
+\brief Simplifies the rim and holes together so that the holes stay inside the rim
+and apart. Rims or holes with arcs are left as they are and are not checked against.
+Returns the number of points removed.
+<P>---------------------------------------------------------------------------*/
+unsigned int CSimplifier::Simplify(C2DHoledPolyBase& Poly) const
+{
+	vector<C2DPolyBase*> Rings;
+	if (Poly.GetRim() != 0)
+		Rings.push_back(Poly.GetRim());
+	for (unsigned int h = 0; h < Poly.GetHoleCount(); h++)
+		Rings.push_back(Poly.GetHole(h));
+
+	vector<C2DPolyBase*> Straight;
+	vector< vector<C2DPoint> > Paths;
+	for (unsigned int r = 0; r < Rings.size(); r++)
+	{
+		if (Rings[r]->HasArcs())
+			continue;
+		Straight.push_back(Rings[r]);
+		Paths.push_back(vector<C2DPoint>());
+		for (unsigned int i = 0; i < Rings[r]->GetLineCount(); i++)
+			Paths.back().push_back(Rings[r]->GetLine(i)->GetPointFrom());
+	}
+
+	vector< vector<bool> > Keep;
+	unsigned int nRemoved = Simplify(Paths, vector<bool>(Paths.size(), true), Keep);
+	if (nRemoved == 0)
+		return 0;
+
+	for (unsigned int r = 0; r < Straight.size(); r++)
+	{
+		const vector<C2DPoint>& Path = Paths[r];
+		if (find(Keep[r].begin(), Keep[r].end(), false) == Keep[r].end())
+			continue;
+
+		vector<C2DPoint> Points;
+		for (unsigned int i = 0; i < Path.size(); i++)
+		{
+			if (Keep[r][i])
+				Points.push_back(Path[i]);
+		}
+		C2DLineBaseSet Lines;
+		for (unsigned int i = 0; i < Points.size(); i++)
+			Lines.Add(new C2DLine(Points[i], Points[(i + 1) % Points.size()]));
+		Straight[r]->CreateDirect(Lines);
+	}
+	return nRemoved;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CStreamSimplifier::CStreamSimplifier
+\brief Constructor. The points kept are added to the output route. The window is at
+least 4 points.
+<P>---------------------------------------------------------------------------*/
+CStreamSimplifier::CStreamSimplifier(const CSimplifier& Simplifier, C2DRoute& Output,
+									 unsigned int nWindow)
+	: m_Simplifier(Simplifier), m_Output(Output), m_nWindow(max(4u, nWindow)),
+	  m_nPointsIn(0), m_nPointsOut(0)
+{
+	m_Window.reserve(m_nWindow);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CStreamSimplifier::~CStreamSimplifier
+\brief Destructor. Points still held are not output.
+<P>---------------------------------------------------------------------------*/
+CStreamSimplifier::~CStreamSimplifier(void)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CStreamSimplifier::AddPoint
+\brief Adds the next point of the route, simplifying the window when it is full.
+<P>---------------------------------------------------------------------------*/
+void CStreamSimplifier::AddPoint(const C2DPoint& pt)
+{
+	m_nPointsIn++;
+	m_Window.push_back(pt);
+	if (m_Window.size() >= m_nWindow)
+		Process(false);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CStreamSimplifier::Flush
+\brief Simplifies the points held and adds them all to the output.
+<P>---------------------------------------------------------------------------*/
+void CStreamSimplifier::Flush(void)
+{
+	Process(true);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CStreamSimplifier::Process
+\brief Simplifies the window and outputs the points kept before the first kept in its
+second half, or all of them. That point is then the start of the next window.
+<P>---------------------------------------------------------------------------*/
+void CStreamSimplifier::Process(bool bAll)
+{
+	if (m_Window.empty())
+		return;
+
+	vector< vector<C2DPoint> > Paths(1);
+	Paths[0].swap(m_Window);
+	vector< vector<bool> > Keep;
+	m_Simplifier.Simplify(Paths, vector<bool>(1, false), Keep);
+	Paths[0].swap(m_Window);
+
+	unsigned int nEnd = m_Window.size();
+	if (!bAll)
+	{
+		// The last point is always kept.
+		nEnd = m_Window.size() / 2;
+		while (!Keep[0][nEnd])
+			nEnd++;
+	}
+
+	for (unsigned int i = 0; i < nEnd; i++)
+	{
+		if (Keep[0][i])
+		{
+			m_Output.AddPoint(m_Window[i]);
+			m_nPointsOut++;
+		}
+	}
+	m_Window.erase(m_Window.begin(), m_Window.begin() + nEnd);
+}
@@ -0,0 +1,144 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Simplifier.h
+\brief Declaration file for the CSimplifier and CStreamSimplifier classes.
+
+Declaration file for CSimplifier, which reduces the number of points of routes and
+polygons to within a tolerance, and CStreamSimplifier which does so for a route
+given a point at a time.
+
+\class CSimplifier
+\brief Simplifies routes and polygons by Douglas-Peucker or Visvalingam-Whyatt.
+
+Douglas-Peucker keeps splitting each part of a path at its furthest point from the
+line joining its ends, always taking the part with the furthest point next from a
+heap, until every point left out is within the tolerance (a distance) of the line
+that replaces it. Visvalingam-Whyatt keeps removing the point which makes the
+smallest triangle with its neighbours, again from a heap, until that is above the
+tolerance (an area).
+
+If the topology is preserved, which is the default, a part of a path is only
+replaced if no other point of any of the paths lies in the area between the part
+and its replacement. This keeps the paths from crossing themselves or each other
+and keeps holes inside their rims. Closed paths keep at least 3 points.
+
+\class CStreamSimplifier
+\brief Simplifies a route given a point at a time.
+
+The points are held until there are enough to fill the window. The window is then
+simplified and the points kept in its first half are added to the output route.
+Simplification goes on from the last point added so the output follows the input
+with a delay of at most the window. The topology is only preserved within the window.
+<P>---------------------------------------------------------------------------*/
+
+#ifndef _GEOLIB_CSIMPLIFIER_H
+#define _GEOLIB_CSIMPLIFIER_H
+
+#include "C2DPoint.h"
+
+class C2DRoute;
+class C2DPolygon;
+class C2DHoledPolyBase;
+
+class GeoLib_API CSimplifier
+{
+public:
+	/// The simplification methods.
+	enum eMethod
+	{
+		DouglasPeucker,
+		Visvalingam,
+	};
+
+	/// Constructor, for Douglas-Peucker with a tolerance of 0.
+	CSimplifier(void);
+	/// Constructor.
+	CSimplifier(eMethod eMeth, double dTolerance, bool bPreserveTopology = true);
+	/// Destructor.
+	~CSimplifier(void);
+
+	/// Sets the method.
+	void SetMethod(eMethod eMeth) {m_eMethod = eMeth;}
+	/// The method.
+	eMethod GetMethod(void) const {return m_eMethod;}
+	/// Sets the tolerance, a distance for Douglas-Peucker and an area for Visvalingam.
+	void SetTolerance(double dTolerance) {m_dTolerance = dTolerance;}
+	/// The tolerance.
+	double GetTolerance(void) const {return m_dTolerance;}
+	/// Sets whether the paths are kept from crossing.
+	void SetPreserveTopology(bool bPreserve) {m_bPreserveTopology = bPreserve;}
+	/// True if the paths are kept from crossing.
+	bool GetPreserveTopology(void) const {return m_bPreserveTopology;}
+
+	/// Finds the points to keep of the paths, which are simplified together. Returns the
+	/// number of points removed.
+	unsigned int Simplify(const std::vector< std::vector<C2DPoint> >& Paths,
+				const std::vector<bool>& Closed, std::vector< std::vector<bool> >& Keep) const;
+	/// Simplifies the route, keeping its ends. Returns the number of points removed.
+	unsigned int Simplify(C2DRoute& Route) const;
+	/// Simplifies the polygon. Returns the number of points removed.
+	unsigned int Simplify(C2DPolygon& Polygon) const;
+	/// Simplifies the rim and holes together. Rims or holes with arcs are left as they
+	/// are and are not checked against. Returns the number of points removed.
+	unsigned int Simplify(C2DHoledPolyBase& Poly) const;
+
+private:
+	/// The method.
+	eMethod m_eMethod;
+	/// The tolerance.
+	double m_dTolerance;
+	/// True if the paths are kept from crossing.
+	bool m_bPreserveTopology;
+};
+
+
+class GeoLib_API CStreamSimplifier
+{
+public:
+	/// Constructor. The points kept are added to the output route.
+	CStreamSimplifier(const CSimplifier& Simplifier, C2DRoute& Output, unsigned int nWindow = 256);
+	/// Destructor. Does not flush.
+	~CStreamSimplifier(void);
+
+	/// Adds the next point of the route.
+	void AddPoint(const C2DPoint& pt);
+	/// Adds the points held to the output. The route may then be continued.
+	void Flush(void);
+
+	/// The number of points given.
+	unsigned int GetPointsIn(void) const {return m_nPointsIn;}
+	/// The number of points added to the output.
+	unsigned int GetPointsOut(void) const {return m_nPointsOut;}
+	/// The number of points held waiting for the window to fill.
+	unsigned int GetPointsHeld(void) const {return m_Window.size();}
+
+private:
+	/// Not copyable.
+	CStreamSimplifier(const CStreamSimplifier&);
+	/// Not copyable.
+	CStreamSimplifier& operator=(const CStreamSimplifier&);
+
+	/// Simplifies the window and outputs the points kept in its first half, or all of them.
+	void Process(bool bAll);
+
+	/// The simplifier.
+	CSimplifier m_Simplifier;
+	/// The output.
+	C2DRoute& m_Output;
+	/// The window size.
+	unsigned int m_nWindow;
+	/// The points held.
+	std::vector<C2DPoint> m_Window;
+	/// The number of points given.
+	unsigned int m_nPointsIn;
+	/// The number of points added to the output.
+	unsigned int m_nPointsOut;
+};
+
+#endif
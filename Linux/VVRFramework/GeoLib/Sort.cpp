@@ -0,0 +1,98 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file Sort.cpp
+\brief Implementation file for the sorts which are not templates.
+<P>---------------------------------------------------------------------------*/
+
+#include "StdAfx.h"
+#include "Sort.h"
+#include <cstring>
+
+using namespace std;
+
+/// The number of bits sorted by each pass of the radix sort.
+const unsigned int conRadixBits = 11;
+/// The number of passes needed for 64 bits.
+const unsigned int conRadixPasses = (64 + conRadixBits - 1) / conRadixBits;
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoSort::GetSortOrder
+\brief Finds the order of the doubles between lo0 and hi0 inclusive. Order is set
+to the positions in the array of the items in ascending order, equal items in the
+order they are in the array. Uses a least significant digit radix sort on the bits 
+of the doubles, flipped so that they order as unsigned integers. Passes in which all 
+the keys have the same digit are skipped. Small ranges use the introsort.
+<P>---------------------------------------------------------------------------*/
+void GeoSort::GetSortOrder(const std::vector<double>& Array, int lo0, int hi0,
+						   std::vector<unsigned int>& Order)
+{
+	Order.clear();
+	if (lo0 > hi0)
+		return;
+
+	const unsigned int nCount = hi0 - lo0 + 1;
+	if (nCount < (unsigned int)conMinRadixSort)
+	{
+		GetSortOrder< std::vector<double> >(Array, lo0, hi0, Order);
+		return;
+	}
+
+	vector<unsigned long long> Keys(nCount);
+	vector<unsigned int> Count(conRadixPasses << conRadixBits, 0);
+	const unsigned long long nMask = (1ull << conRadixBits) - 1;
+	for (unsigned int i = 0; i < nCount; i++)
+	{
+		unsigned long long nBits;
+		memcpy(&nBits, &Array[lo0 + i], sizeof(nBits));
+		// Negatives reverse, positives go above them.
+		if (nBits >> 63)
+			nBits = ~nBits;
+		else
+			nBits |= 1ull << 63;
+		// -0 and 0 are equal.
+		if (nBits == 0x7fffffffffffffffull)
+			nBits = 1ull << 63;
+		Keys[i] = nBits;
+
+		for (unsigned int nPass = 0; nPass < conRadixPasses; nPass++)
+			Count[(nPass << conRadixBits) + ((nBits >> (nPass * conRadixBits)) & nMask)]++;
+	}
+
+	Order.resize(nCount);
+	for (unsigned int i = 0; i < nCount; i++)
+		Order[i] = i;
+
+	vector<unsigned int> Temp(nCount);
+	for (unsigned int nPass = 0; nPass < conRadixPasses; nPass++)
+	{
+		unsigned int* pCount = &Count[nPass << conRadixBits];
+		const unsigned int nShift = nPass * conRadixBits;
+		if (pCount[(Keys[0] >> nShift) & nMask] == nCount)
+			continue;
+
+		unsigned int nTotal = 0;
+		for (unsigned int d = 0; d <= nMask; d++)
+		{
+			unsigned int nDigitCount = pCount[d];
+			pCount[d] = nTotal;
+			nTotal += nDigitCount;
+		}
+
+		for (unsigned int i = 0; i < nCount; i++)
+		{
+			unsigned int nItem = Order[i];
+			Temp[pCount[(Keys[nItem] >> nShift) & nMask]++] = nItem;
+		}
+		Order.swap(Temp);
+	}
+
+	for (unsigned int i = 0; i < nCount; i++)
+		Order[i] += lo0;
+}
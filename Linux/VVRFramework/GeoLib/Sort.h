@@ -7,10 +7,9 @@ any modified versions of this cannot be resold to any other party.
 
 /**--------------------------------------------------------------------------<BR>
 \file Sort.h
-\brief File for the sorting templates, all of which use the quick sort algorithm.
+\brief File for the sorting templates.
 
-File for a number of sorting algothithms, all of which sort items using the 
-quick sort algorithm. Main algorithms as follows:
+File for a number of sorting algothithms. Main algorithms as follows:
 1. Simple sort which sorts items in ascending order.
 2. Parallel sort which sorts items according to one array whilst sorting another
 in Parallel.
@@ -19,32 +18,52 @@ in Parallel.
 first in the array.
 
 Any type of array can be sorted using the functions which ask to specify the
-limits of the sort (normally between the 0 and max element) but for convienience, 
-there are wrapper functions for all which sort between the 0 element and that 
-given by the size() function of the array less 1. 
+limits of the sort (normally between the 0 and max element) but for convienience,
+there are wrapper functions for all which sort between the 0 element and that
+given by the size() function of the array less 1.
+
+The sorts are done by an introsort i.e. a quick sort with a median of 3 pivot which
+switches to a heap sort if it goes too deep, so it cannot go quadratic or run out
+of stack whatever the order. Sorts 2 and 3 find the key of each item once, sort
+the keys with their positions and then move each item once. Keys which are doubles
+are sorted with a radix sort and large arrays are sorted on several threads. Equal
+keys keep their order in sorts 2 and 3.
 <P>---------------------------------------------------------------------------*/
 
 
-#ifndef _GEOLIB_SORT_H 
+#ifndef _GEOLIB_SORT_H
 #define _GEOLIB_SORT_H
 
+#include "StdAfx.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <type_traits>
 
 
 /**--------------------------------------------------------------------------<BR>
 \namespace GeoSort
-\brief Namespace for a number of sorting algothithms, all of which sort items 
-using variations of the quick sort algorithm.
+\brief Namespace for a number of sorting algothithms, all of which are based on
+the introsort or, for double keys, the radix sort.
 <P>---------------------------------------------------------------------------*/
 namespace GeoSort
 {
 
+/// Below this size ranges are finished with an insertion sort.
+const int conInsertionSortSize = 16;
+/// Below this size the sorts always run on one thread.
+const unsigned int conMinParallelSort = 65536;
+/// Below this size double keys are sorted by the introsort rather than the radix sort.
+const int conMinRadixSort = 256;
+
 
 /**--------------------------------------------------------------------------<BR>
 GeoSort::ReverseOrder
 \brief Reverses the order of an array.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE>  
-void ReverseOrder(ARRAY_TYPE& Array) 
+template<class ARRAY_TYPE, class TYPE>
+void ReverseOrder(ARRAY_TYPE& Array)
 {
 	TYPE Temp;
 	unsigned int nCount = (unsigned int) Array.size();
@@ -55,341 +74,440 @@ void ReverseOrder(ARRAY_TYPE& Array)
 		Temp = Array[i];
 		Array[i] = Array[nCount - 1 - i];
 		Array[nCount - 1 - i] = Temp;
-	}	
+	}
 }
 
-	
+
 /**--------------------------------------------------------------------------<BR>
-GeoSort::FQuickSort
-\brief Wrapper for the function call sort.
+GeoSort::sLess
+\brief Orders items with the < operator.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE, typename COMPTYPE>  
-void FQuickSort(ARRAY_TYPE& Array, COMPTYPE (TYPE::*pFunctionCall)(void) const) 
+template<class TYPE>
+struct sLess
 {
-	FQuickSort<ARRAY_TYPE, TYPE, COMPTYPE>(Array,  pFunctionCall , (int) 0, (int)(Array.size() - 1 ));
+	bool operator()(const TYPE& A, const TYPE& B) const {return A < B;}
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoSort::sKeyIndexLess
+\brief Orders key and position pairs by the key and then the position so equal
+keys keep their order.
+<P>---------------------------------------------------------------------------*/
+template<class TYPE>
+struct sKeyIndexLess
+{
+	bool operator()(const std::pair<TYPE, unsigned int>& A, const std::pair<TYPE, unsigned int>& B) const
+	{
+		if (A.first < B.first) return true;
+		if (B.first < A.first) return false;
+		return A.second < B.second;
+	}
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoSort::InsertionSort
+\brief Insertion sort between lo0 and hi0 inclusive. Used to finish the introsort.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE, class LESS>
+void InsertionSort(ARRAY_TYPE& Array, LESS& Less, int lo0, int hi0)
+{
+	for (int i = lo0 + 1; i <= hi0; i++)
+	{
+		if (!Less(Array[i], Array[i - 1]))
+			continue;
+
+		TYPE Item = Array[i];
+		int j = i;
+		do
+		{
+			Array[j] = Array[j - 1];
+			j--;
+		} while (j > lo0 && Less(Item, Array[j - 1]));
+		Array[j] = Item;
+	}
 }
 
+
 /**--------------------------------------------------------------------------<BR>
-GeoSort::FQuickSort
-\brief Sorts an array by calling a function for each object in the array e.g.
-GetLength().
+GeoSort::HeapSort
+\brief Heap sort between lo0 and hi0 inclusive. Used by the introsort when the
+quick sort goes too deep.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE, typename COMPTYPE>  
-void FQuickSort(ARRAY_TYPE& Array, COMPTYPE (TYPE::*pFunctionCall)(void) const , int lo0, int hi0)
+template<class ARRAY_TYPE, class TYPE, class LESS>
+void HeapSort(ARRAY_TYPE& Array, LESS& Less, int lo0, int hi0)
 {
-	int lo = lo0;
-	int hi = hi0;
-	if (lo >= hi)  return;
+	int nCount = hi0 - lo0 + 1;
 
-    else if( lo == hi - 1 )
+	// Moves the item at nRoot down until it is not less than its children.
+	struct sSift
 	{
-            // sort a two element list by swapping if necessary 
-            if ((Array[lo].*pFunctionCall)() > (Array[hi].*pFunctionCall)()) 
+		static void Down(ARRAY_TYPE& Array, LESS& Less, int lo0, int nRoot, int nCount)
+		{
+			TYPE Item = Array[lo0 + nRoot];
+			int nChild = 2 * nRoot + 1;
+			while (nChild < nCount)
 			{
-                TYPE T = Array[lo];
-                Array[lo] = Array[hi];
-                Array[hi] = T;
-            }
-            return;
+				if (nChild + 1 < nCount && Less(Array[lo0 + nChild], Array[lo0 + nChild + 1]))
+					nChild++;
+				if (!Less(Item, Array[lo0 + nChild]))
+					break;
+				Array[lo0 + nRoot] = Array[lo0 + nChild];
+				nRoot = nChild;
+				nChild = 2 * nRoot + 1;
+			}
+			Array[lo0 + nRoot] = Item;
+		}
+	};
+
+	for (int i = nCount / 2 - 1; i >= 0; i--)
+		sSift::Down(Array, Less, lo0, i, nCount);
+
+	for (int i = nCount - 1; i > 0; i--)
+	{
+		std::swap(Array[lo0], Array[lo0 + i]);
+		sSift::Down(Array, Less, lo0, 0, i);
 	}
+}
 
-    //  Pick a pivot and move it out of the way
 
-	TYPE pivot = Array[(lo + hi) / 2];
-        Array[(lo + hi) / 2] = Array[hi];
-        Array[hi] = pivot;
+/**--------------------------------------------------------------------------<BR>
+GeoSort::IntroSortLoop
+\brief The quick sort part of the introsort. Leaves ranges smaller than the
+insertion sort size unsorted and heap sorts ranges once nDepth reaches 0.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE, class LESS>
+void IntroSortLoop(ARRAY_TYPE& Array, LESS& Less, int lo0, int hi0, int nDepth)
+{
+	while (hi0 - lo0 + 1 > conInsertionSortSize)
+	{
+		if (nDepth == 0)
+		{
+			HeapSort<ARRAY_TYPE, TYPE, LESS>(Array, Less, lo0, hi0);
+			return;
+		}
+		nDepth--;
 
-   while( lo < hi ) 
-   {
-        //  Search forward from a[lo] until an element is found that
-        //  is greater than the pivot or lo >= hi 
-            
-		while ((Array[lo].*pFunctionCall)() <= (pivot.*pFunctionCall)() && lo < hi) 
+		// Median of 3 so sorted and reversed input splits evenly.
+		int nMid = lo0 + (hi0 - lo0) / 2;
+		if (Less(Array[nMid], Array[lo0]))
+			std::swap(Array[nMid], Array[lo0]);
+		if (Less(Array[hi0], Array[nMid]))
 		{
-			lo++;
+			std::swap(Array[hi0], Array[nMid]);
+			if (Less(Array[nMid], Array[lo0]))
+				std::swap(Array[nMid], Array[lo0]);
 		}
-		// Search backward from a[hi] until element is found that
-		//  is less than the pivot, or lo >= hi
-		     
-		while ((pivot.*pFunctionCall)() <= (Array[hi].*pFunctionCall)() && lo < hi ) 
+		TYPE Pivot = Array[nMid];
+
+		// Hoare partition which stops on equal items so many equal keys also split evenly.
+		int lo = lo0 - 1;
+		int hi = hi0 + 1;
+		while (true)
 		{
-			hi--;
+			do lo++; while (Less(Array[lo], Pivot));
+			do hi--; while (Less(Pivot, Array[hi]));
+			if (lo >= hi)
+				break;
+			std::swap(Array[lo], Array[hi]);
 		}
-        //  Swap elements a[lo] and a[hi]
-		if( lo < hi ) 
+
+		// Recurse on the smaller side and loop on the larger.
+		if (hi - lo0 < hi0 - hi)
+		{
+			IntroSortLoop<ARRAY_TYPE, TYPE, LESS>(Array, Less, lo0, hi, nDepth);
+			lo0 = hi + 1;
+		}
+		else
 		{
-			TYPE T = Array[lo];
-			Array[lo] = Array[hi];
-			Array[hi] = T;
+			IntroSortLoop<ARRAY_TYPE, TYPE, LESS>(Array, Less, hi + 1, hi0, nDepth);
+			hi0 = hi;
 		}
 	}
+}
+
 
-    //  Put the median in the "center" of the list
+/**--------------------------------------------------------------------------<BR>
+GeoSort::IntroSort
+\brief Sorts the array between lo0 and hi0 inclusive so that Less is false for
+each item and the one before.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE, class LESS>
+void IntroSort(ARRAY_TYPE& Array, LESS Less, int lo0, int hi0)
+{
+	if (lo0 >= hi0)
+		return;
 
-	Array[hi0] = Array[hi];
-	Array[hi] = pivot;
+	int nDepth = 0;
+	for (int n = hi0 - lo0 + 1; n > 1; n >>= 1)
+		nDepth += 2;
 
-  	//Recursive calls, elements a[lo0] to a[lo-1] are less than or
-	//equal to pivot, elements a[hi+1] to a[hi0] are greater than
-	//pivot.
-         
-	FQuickSort<ARRAY_TYPE, TYPE>(Array, pFunctionCall, lo0, lo-1);
-	FQuickSort<ARRAY_TYPE, TYPE>(Array, pFunctionCall, hi+1, hi0);
+	IntroSortLoop<ARRAY_TYPE, TYPE, LESS>(Array, Less, lo0, hi0, nDepth);
+	InsertionSort<ARRAY_TYPE, TYPE, LESS>(Array, Less, lo0, hi0);
 }
 
 
 /**--------------------------------------------------------------------------<BR>
-GeoSort::FQuickSort
-\brief Wrapper for the function based sort.
+GeoSort::IntroSort
+\brief Wrapper for the introsort.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE>  
-void FQuickSort(ARRAY_TYPE& Array, bool (*pSwitchIfTrue)(TYPE&, TYPE&)) 
+template<class ARRAY_TYPE, class TYPE, class LESS>
+void IntroSort(ARRAY_TYPE& Array, LESS Less)
 {
-	//  if pComparision returns true, the first element should be ordered after the second.
-	FQuickSort<ARRAY_TYPE, TYPE>(Array,  pSwitchIfTrue , (int) 0, (int)(Array.size() - 1 ));
+	IntroSort<ARRAY_TYPE, TYPE, LESS>(Array, Less, (int) 0, (int)(Array.size() - 1));
 }
 
 
 /**--------------------------------------------------------------------------<BR>
-GeoSort::FQuickSort
-\brief Sorts an array by calling a function which takes 2 objects in the array 
-and returns true if the first should be ordered after the second.
+GeoSort::ParallelSort
+\brief Sorts the array between lo0 and hi0 inclusive on nThreads threads, the
+number of cores if 0. Each thread introsorts a block of a copy of the array and
+the blocks are then merged in pairs, also on separate threads. Small arrays are
+sorted on one thread.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE>  
-void FQuickSort(ARRAY_TYPE& Array, bool (*pSwitchIfTrue)(TYPE&, TYPE&), int lo0, int hi0) 
+template<class ARRAY_TYPE, class TYPE, class LESS>
+void ParallelSort(ARRAY_TYPE& Array, LESS Less, int lo0, int hi0, unsigned int nThreads = 0)
 {
-	//  if pComparision returns true, the first element should be ordered after the second.
-	int lo = lo0;
-	int hi = hi0;
-	if (lo >= hi)  return;
-
-    else if( lo == hi - 1 )
+	if (lo0 >= hi0)
+		return;
+
+	unsigned int nCount = hi0 - lo0 + 1;
+	if (nThreads == 0)
+		nThreads = std::thread::hardware_concurrency();
+	if (nThreads > nCount / (conMinParallelSort / 2))
+		nThreads = nCount / (conMinParallelSort / 2);
+	if (nCount < conMinParallelSort || nThreads <= 1)
 	{
-            // sort a two element list by swapping if necessary 
-            if ( pSwitchIfTrue(Array[lo], Array[hi] )) /*Array[lo] > Array[hi])*/ 
-			{
-                TYPE T = Array[lo];
-                Array[lo] = Array[hi];
-                Array[hi] = T;
-            }
-            return;
+		IntroSort<ARRAY_TYPE, TYPE, LESS>(Array, Less, lo0, hi0);
+		return;
 	}
 
-    //  Pick a pivot and move it out of the way
+	std::vector<TYPE> Buffer(nCount);
+	for (unsigned int i = 0; i < nCount; i++)
+		Buffer[i] = Array[lo0 + i];
 
-	TYPE pivot = Array[(lo + hi) / 2];
-        Array[(lo + hi) / 2] = Array[hi];
-        Array[hi] = pivot;
+	std::vector<unsigned int> Starts(nThreads + 1);
+	for (unsigned int t = 0; t <= nThreads; t++)
+		Starts[t] = (unsigned int)((size_t)nCount * t / nThreads);
 
-   while( lo < hi ) 
-   {
-        //  Search forward from a[lo] until an element is found that
-        //  is greater than the pivot or lo >= hi 
-            
-		while ( !pSwitchIfTrue(Array[lo], pivot)   /*Array[lo] <= pivot*/ && lo < hi) 
-		{
-			lo++;
-		}
-		// Search backward from a[hi] until element is found that
-		//  is less than the pivot, or lo >= hi
-		     
-		while (!pSwitchIfTrue(pivot, Array[hi]) /*pivot <= Array[hi]*/ && lo < hi ) 
-		{
-			hi--;
-		}
-        //  Swap elements a[lo] and a[hi]
-		if( lo < hi ) 
+	std::vector<std::thread> Threads;
+	for (unsigned int t = 0; t < nThreads; t++)
+	{
+		int lo = Starts[t];
+		int hi = Starts[t + 1] - 1;
+		Threads.push_back(std::thread([&Buffer, Less, lo, hi]() 
+			{ IntroSort<std::vector<TYPE>, TYPE, LESS>(Buffer, Less, lo, hi); }));
+	}
+	for (unsigned int t = 0; t < nThreads; t++)
+		Threads[t].join();
+
+	// Merge neighbouring blocks until there is one.
+	std::vector<TYPE> Merged(nCount);
+	while (Starts.size() > 2)
+	{
+		std::vector<unsigned int> NewStarts;
+		Threads.clear();
+		for (unsigned int b = 0; b + 1 < Starts.size(); b += 2)
 		{
-			TYPE T = Array[lo];
-			Array[lo] = Array[hi];
-			Array[hi] = T;
+			NewStarts.push_back(Starts[b]);
+			typename std::vector<TYPE>::iterator Begin = Buffer.begin() + Starts[b];
+			if (b + 2 < Starts.size())
+			{
+				typename std::vector<TYPE>::iterator Mid = Buffer.begin() + Starts[b + 1];
+				typename std::vector<TYPE>::iterator End = Buffer.begin() + Starts[b + 2];
+				typename std::vector<TYPE>::iterator Out = Merged.begin() + Starts[b];
+				Threads.push_back(std::thread([=]() { std::merge(Begin, Mid, Mid, End, Out, Less); }));
+			}
+			else
+			{
+				std::copy(Begin, Buffer.begin() + Starts[b + 1], Merged.begin() + Starts[b]);
+			}
 		}
+		NewStarts.push_back(nCount);
+		for (unsigned int t = 0; t < Threads.size(); t++)
+			Threads[t].join();
+
+		Buffer.swap(Merged);
+		Starts.swap(NewStarts);
 	}
 
-    //  Put the median in the "center" of the list
+	for (unsigned int i = 0; i < nCount; i++)
+		Array[lo0 + i] = Buffer[i];
+}
 
-	Array[hi0] = Array[hi];
-	Array[hi] = pivot;
 
-  	//Recursive calls, elements a[lo0] to a[lo-1] are less than or
-	//equal to pivot, elements a[hi+1] to a[hi0] are greater than
-	//pivot.
-         
-	FQuickSort<ARRAY_TYPE, TYPE>(Array,  pSwitchIfTrue , lo0, lo-1);
-	FQuickSort<ARRAY_TYPE, TYPE>(Array, pSwitchIfTrue  , hi+1, hi0);
+/**--------------------------------------------------------------------------<BR>
+GeoSort::GetSortOrder
+\brief Finds the order of the items between lo0 and hi0 inclusive. Order is set
+to the positions in the array of the items in ascending order, equal items in
+the order they are in the array.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE>
+void GetSortOrder(const ARRAY_TYPE& Array, int lo0, int hi0, std::vector<unsigned int>& Order)
+{
+	typedef typename std::remove_cv<typename std::remove_reference<decltype(Array[0])>::type>::type TYPE;
+	typedef std::pair<TYPE, unsigned int> KEY_INDEX;
+
+	Order.clear();
+	if (lo0 > hi0)
+		return;
+
+	std::vector<KEY_INDEX> Keys;
+	Keys.reserve(hi0 - lo0 + 1);
+	for (int i = lo0; i <= hi0; i++)
+		Keys.push_back(KEY_INDEX(Array[i], (unsigned int) i));
+
+	ParallelSort<std::vector<KEY_INDEX>, KEY_INDEX, sKeyIndexLess<TYPE> >(Keys,
+		sKeyIndexLess<TYPE>(), 0, (int)Keys.size() - 1);
+
+	Order.resize(Keys.size());
+	for (unsigned int i = 0; i < Keys.size(); i++)
+		Order[i] = Keys[i].second;
 }
 
 
+/// Finds the order of the doubles between lo0 and hi0 inclusive using a radix sort.
+GeoLib_API void GetSortOrder(const std::vector<double>& Array, int lo0, int hi0,
+	std::vector<unsigned int>& Order);
+
+
 /**--------------------------------------------------------------------------<BR>
-GeoSort::SQuickSort
-\brief Wrapper for a simple quicksort.
+GeoSort::ApplyOrder
+\brief Rearranges the items between lo0 and hi0 inclusive to be in the order
+given, moving each item once.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE>  
-void SQuickSort(ARRAY_TYPE& Array)
+template<class ARRAY_TYPE, class TYPE>
+void ApplyOrder(ARRAY_TYPE& Array, const std::vector<unsigned int>& Order, int lo0)
 {
-	SQuickSort<ARRAY_TYPE, TYPE>(Array,(int) 0, (int)(Array.size() - 1 ));
+	std::vector<TYPE> Sorted;
+	Sorted.reserve(Order.size());
+	for (unsigned int i = 0; i < Order.size(); i++)
+		Sorted.push_back(Array[Order[i]]);
+
+	for (unsigned int i = 0; i < Order.size(); i++)
+		Array[lo0 + i] = Sorted[i];
 }
 
 
 /**--------------------------------------------------------------------------<BR>
-GeoSort::SQuickSort
-\brief Straight forward quicksort.
+GeoSort::FQuickSort
+\brief Sorts an array by calling a function for each object in the array e.g.
+GetLength(). The function is called once for each object.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE>
-void SQuickSort(ARRAY_TYPE& Array, int lo0, int hi0)
+template<class ARRAY_TYPE, class TYPE, typename COMPTYPE>
+void FQuickSort(ARRAY_TYPE& Array, COMPTYPE (TYPE::*pFunctionCall)(void) const , int lo0, int hi0)
 {
-	int lo = lo0;
-	int hi = hi0;
-	if (lo >= hi)  return;
+	if (lo0 >= hi0)  return;
 
-    else if( lo == hi - 1 )
-	{
-            // sort a two element list by swapping if necessary 
-            if (Array[lo] > Array[hi]) 
-			{
-                TYPE T = Array[lo];
-                Array[lo] = Array[hi];
-                Array[hi] = T;
-            }
-            return;
-	}
+	std::vector<COMPTYPE> Keys;
+	Keys.reserve(hi0 - lo0 + 1);
+	for (int i = lo0; i <= hi0; i++)
+		Keys.push_back((Array[i].*pFunctionCall)());
 
-    //  Pick a pivot and move it out of the way
+	std::vector<unsigned int> Order;
+	GetSortOrder(Keys, 0, (int)Keys.size() - 1, Order);
+	for (unsigned int i = 0; i < Order.size(); i++)
+		Order[i] += lo0;
 
-	TYPE pivot = Array[(lo + hi) / 2];
-        Array[(lo + hi) / 2] = Array[hi];
-        Array[hi] = pivot;
+	ApplyOrder<ARRAY_TYPE, TYPE>(Array, Order, lo0);
+}
 
-   while( lo < hi ) 
-   {
-        //  Search forward from a[lo] until an element is found that
-        //  is greater than the pivot or lo >= hi 
-            
-		while (Array[lo] <= pivot && lo < hi) 
-		{
-			lo++;
-		}
-		// Search backward from a[hi] until element is found that
-		//  is less than the pivot, or lo >= hi
-		     
-		while (pivot <= Array[hi] && lo < hi ) 
-		{
-			hi--;
-		}
-        //  Swap elements a[lo] and a[hi]
-		if( lo < hi ) 
-		{
-			TYPE T = Array[lo];
-			Array[lo] = Array[hi];
-			Array[hi] = T;
-		}
-	}
 
-    //  Put the median in the "center" of the list
+/**--------------------------------------------------------------------------<BR>
+GeoSort::FQuickSort
+\brief Wrapper for the function call sort.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE, typename COMPTYPE>
+void FQuickSort(ARRAY_TYPE& Array, COMPTYPE (TYPE::*pFunctionCall)(void) const)
+{
+	FQuickSort<ARRAY_TYPE, TYPE, COMPTYPE>(Array,  pFunctionCall , (int) 0, (int)(Array.size() - 1 ));
+}
+
+/**--------------------------------------------------------------------------<BR>
+GeoSort::sSwitchLess
+\brief Turns a function which returns true if the first should be ordered after
+the second into a less than.
+<P>---------------------------------------------------------------------------*/
+template<class TYPE>
+struct sSwitchLess
+{
+	sSwitchLess(bool (*pSwitchIfTrue)(TYPE&, TYPE&)) : m_pSwitchIfTrue(pSwitchIfTrue) {;}
+	bool operator()(TYPE& A, TYPE& B) const {return m_pSwitchIfTrue(B, A);}
+	bool (*m_pSwitchIfTrue)(TYPE&, TYPE&);
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoSort::FQuickSort
+\brief Sorts an array by calling a function which takes 2 objects in the array
+and returns true if the first should be ordered after the second.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE>
+void FQuickSort(ARRAY_TYPE& Array, bool (*pSwitchIfTrue)(TYPE&, TYPE&), int lo0, int hi0)
+{
+	//  if pComparision returns true, the first element should be ordered after the second.
+	IntroSort<ARRAY_TYPE, TYPE, sSwitchLess<TYPE> >(Array, sSwitchLess<TYPE>(pSwitchIfTrue), lo0, hi0);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoSort::FQuickSort
+\brief Wrapper for the function based sort.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE>
+void FQuickSort(ARRAY_TYPE& Array, bool (*pSwitchIfTrue)(TYPE&, TYPE&))
+{
+	//  if pComparision returns true, the first element should be ordered after the second.
+	FQuickSort<ARRAY_TYPE, TYPE>(Array,  pSwitchIfTrue , (int) 0, (int)(Array.size() - 1 ));
+}
 
-	Array[hi0] = Array[hi];
-	Array[hi] = pivot;
 
-  	//Recursive calls, elements a[lo0] to a[lo-1] are less than or
-	//equal to pivot, elements a[hi+1] to a[hi0] are greater than
-	//pivot.
-         
-	SQuickSort<ARRAY_TYPE, TYPE>(Array, lo0, lo-1);
-	SQuickSort<ARRAY_TYPE, TYPE>(Array, hi+1, hi0);
+/**--------------------------------------------------------------------------<BR>
+GeoSort::SQuickSort
+\brief Sorts the items in ascending order.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE>
+void SQuickSort(ARRAY_TYPE& Array, int lo0, int hi0)
+{
+	ParallelSort<ARRAY_TYPE, TYPE, sLess<TYPE> >(Array, sLess<TYPE>(), lo0, hi0);
 }
 
 
 /**--------------------------------------------------------------------------<BR>
 GeoSort::SQuickSort
-\brief Parallel quicksort which sorts the first array by its elements whilst
-also sorting the second in the same way.
+\brief Wrapper for a simple quicksort.
+<P>---------------------------------------------------------------------------*/
+template<class ARRAY_TYPE, class TYPE>
+void SQuickSort(ARRAY_TYPE& Array)
+{
+	SQuickSort<ARRAY_TYPE, TYPE>(Array,(int) 0, (int)(Array.size() - 1 ));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GeoSort::PQuickSort
+\brief Parallel sort which sorts the first array by its elements whilst also
+sorting the second in the same way.
 <P>---------------------------------------------------------------------------*/
 template<class ARRAY_TYPE, class TYPE, class PARRAY_TYPE, class PTYPE>
 void PQuickSort(ARRAY_TYPE& Array, PARRAY_TYPE& ParArray, int lo0, int hi0)
 {
-    int lo = lo0;
-    int hi = hi0;
-    if (lo >= hi)  return;
-
-    else if( lo == hi - 1 )
-    {
-            // sort a two element list by swapping if necessary
-            if (Array[lo] > Array[hi])
-            {
-                TYPE T = Array[lo];
-                Array[lo] = Array[hi];
-                Array[hi] = T;
-
-                PTYPE PAR = ParArray[lo];
-                ParArray[lo] = ParArray[hi];
-                ParArray[hi] = PAR;
-            }
-            return;
-    }
-
-    //  Pick a pivot and move it out of the way
-
-    TYPE pivot = Array[(lo + hi) / 2];
-        Array[(lo + hi) / 2] = Array[hi];
-        Array[hi] = pivot;
-
-    PTYPE ParPivot = ParArray[(lo + hi) / 2];
-        ParArray[(lo + hi) / 2] = ParArray[hi];
-        ParArray[hi] = ParPivot;
-
-
-   while( lo < hi )
-   {
-        //  Search forward from a[lo] until an element is found that
-        //  is greater than the pivot or lo >= hi
-
-        while (Array[lo] <= pivot && lo < hi)
-        {
-            lo++;
-        }
-        // Search backward from a[hi] until element is found that
-        //  is less than the pivot, or lo >= hi
-
-        while (pivot <= Array[hi] && lo < hi )
-        {
-            hi--;
-        }
-        //  Swap elements a[lo] and a[hi]
-        if( lo < hi )
-        {
-            TYPE T = Array[lo];
-            Array[lo] = Array[hi];
-            Array[hi] = T;
-
-            PTYPE PAR = ParArray[lo];
-            ParArray[lo] = ParArray[hi];
-            ParArray[hi] = PAR;
-
-        }
-    }
-
-    //  Put the median in the "center" of the list
-
-    Array[hi0] = Array[hi];
-    Array[hi] = pivot;
-
-    ParArray[hi0] = ParArray[hi];
-    ParArray[hi] = ParPivot;
-
-    //Recursive calls, elements a[lo0] to a[lo-1] are less than or
-    //equal to pivot, elements a[hi+1] to a[hi0] are greater than
-    //pivot.
-
-    PQuickSort< ARRAY_TYPE, TYPE, PARRAY_TYPE, PTYPE>(Array, ParArray, lo0, lo-1);
-    PQuickSort<ARRAY_TYPE, TYPE, PARRAY_TYPE, PTYPE>(Array, ParArray, hi+1, hi0);
+	if (lo0 >= hi0)  return;
+
+	std::vector<unsigned int> Order;
+	GetSortOrder(Array, lo0, hi0, Order);
+
+	ApplyOrder<ARRAY_TYPE, TYPE>(Array, Order, lo0);
+	ApplyOrder<PARRAY_TYPE, PTYPE>(ParArray, Order, lo0);
 }
 
 
 /**--------------------------------------------------------------------------<BR>
-GeoSort::SQuickSort
+GeoSort::PQuickSort
 \brief Wrapper for a Parallel quicksort.
 <P>---------------------------------------------------------------------------*/
-template<class ARRAY_TYPE, class TYPE, class PARRAY_TYPE, class PTYPE> 
+template<class ARRAY_TYPE, class TYPE, class PARRAY_TYPE, class PTYPE>
 void PQuickSort(ARRAY_TYPE& Array, PARRAY_TYPE& ParallelArray)
 {
     PQuickSort<ARRAY_TYPE, TYPE, PARRAY_TYPE, PTYPE>(Array, ParallelArray, (int) 0, (int)(Array.size() - 1));
@@ -401,7 +519,3 @@ void PQuickSort(ARRAY_TYPE& Array, PARRAY_TYPE& ParallelArray)
 
 
 #endif
-
-
-
-
@@ -16,6 +16,11 @@ The purpose of this class is to allow transformations to be defined outside the
 GeoLib main geometry library which can still be performed on GeoLib
 shapes. For example a polygon will be capable of taking an object derived
 from this and calling transform on all its points.
+
+Polygons pass all their points at once, as separate arrays of x and y, to
+TransformPoints. By default this transforms each point in turn, but a derived class
+can override it with a loop the compiler can vectorise, making one virtual call per
+polygon rather than two per line. See CAffineTransformation and CMercatorProjection.
 <P>---------------------------------------------------------------------------*/
 
 
@@ -32,5 +37,17 @@ public:
 	virtual void Transform(double& dx, double& dy) const = 0;
 	/// Inverse transform the given point.
 	virtual void InverseTransform(double& dx, double& dy) const = 0;
+	/// Transform the points given as arrays of x and y.
+	virtual void TransformPoints(double* pX, double* pY, unsigned int nCount) const
+	{
+		for (unsigned int i = 0; i < nCount; i++)
+			Transform(pX[i], pY[i]);
+	}
+	/// Inverse transform the points given as arrays of x and y.
+	virtual void InverseTransformPoints(double* pX, double* pY, unsigned int nCount) const
+	{
+		for (unsigned int i = 0; i < nCount; i++)
+			InverseTransform(pX[i], pY[i]);
+	}
 
 };
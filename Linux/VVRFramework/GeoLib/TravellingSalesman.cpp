@@ -18,7 +18,16 @@ to help minimise routes between points. Used by the polygon for reordering point
 #include "Sort.h"
 #include "C2DPoint.h"
 #include "C2DPointSet.h"
+#include "C2DRect.h"
+#include "PointKdTree.h"
 #include <list>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <thread>
+#include <cmath>
 
 using namespace std;
 
@@ -32,6 +41,411 @@ class CPointList : public std::list<C2DPoint*>
 };
 
 
+const unsigned int conKickSegmentLength = 50;
+const unsigned int conPointsPerKick = 100;
+
+
+/**--------------------------------------------------------------------------<BR>
+class CTour
+\brief An array based route for the local search. The route is held as a cycle in
+which the edge between the first and last points is fixed. Each point has a list 
+of its nearest neighbours and a "don't look" bit, held as whether it is queued.
+<P>---------------------------------------------------------------------------*/
+class CTour
+{
+public:
+	CTour(const vector<sKdPoint>& Points, const vector<unsigned int>& Neighbours, 
+		  unsigned int nNeighbours, double dMinGain);
+
+	/// Sets the route, from the first point to the last, queueing all the points if required.
+	void SetRoute(const vector<unsigned int>& Route, bool bQueueAll = true);
+	/// Gets the route from the first point to the last.
+	void GetRoute(vector<unsigned int>& Route) const;
+	/// Queues the point for improvement.
+	void Queue(unsigned int nPoint);
+	/// Applies improving moves until none of the queued points has one.
+	void Optimise(void);
+	/// The length of the route.
+	double GetLength(void) const;
+
+private:
+	unsigned int Next(unsigned int c) const { return m_Tour[m_Pos[c] + 1 == m_Tour.size() ? 0 : m_Pos[c] + 1]; }
+	unsigned int Prev(unsigned int c) const { return m_Tour[m_Pos[c] == 0 ? m_Tour.size() - 1 : m_Pos[c] - 1]; }
+	double Dist(unsigned int a, unsigned int b) const
+	{
+		double dx = m_Points[a].x - m_Points[b].x;
+		double dy = m_Points[a].y - m_Points[b].y;
+		return sqrt(dx * dx + dy * dy);
+	}
+	bool IsFixed(unsigned int a, unsigned int b) const
+	{
+		return (a == m_nFirst && b == m_nLast) || (a == m_nLast && b == m_nFirst);
+	}
+
+	void Reverse(unsigned int nFrom, unsigned int nTo);
+	void Move2Opt(unsigned int a, unsigned int b, unsigned int c);
+	bool Try2Opt(unsigned int a);
+	bool TryOrOpt(unsigned int a);
+
+	const vector<sKdPoint>& m_Points;
+	const vector<unsigned int>& m_Neighbours;
+	unsigned int m_nNeighbours;
+	double m_dMinGain;
+	/// The point at each position.
+	vector<unsigned int> m_Tour;
+	/// The position of each point.
+	vector<unsigned int> m_Pos;
+	/// The points to be looked at.
+	deque<unsigned int> m_Queue;
+	/// True if the point is in the queue.
+	vector<bool> m_Queued;
+	/// The ends of the route.
+	unsigned int m_nFirst;
+	unsigned int m_nLast;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::CTour
+\brief Constructor.
+<P>---------------------------------------------------------------------------*/
+CTour::CTour(const vector<sKdPoint>& Points, const vector<unsigned int>& Neighbours,
+			 unsigned int nNeighbours, double dMinGain) : 
+	m_Points(Points), m_Neighbours(Neighbours), m_nNeighbours(nNeighbours), m_dMinGain(dMinGain),
+	m_nFirst(0), m_nLast(0)
+{
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::SetRoute
+\brief Sets the route, from the first point to the last, queueing all the points if
+required.
+<P>---------------------------------------------------------------------------*/
+void CTour::SetRoute(const vector<unsigned int>& Route, bool bQueueAll)
+{
+	m_Tour = Route;
+	m_Pos.resize(Route.size());
+	for (unsigned int i = 0 ; i < Route.size(); i++)
+		m_Pos[Route[i]] = i;
+
+	m_nFirst = Route.front();
+	m_nLast = Route.back();
+
+	m_Queue.clear();
+	m_Queued.assign(Route.size(), false);
+	if (bQueueAll)
+	{
+		for (unsigned int i = 0 ; i < Route.size(); i++)
+			Queue(Route[i]);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::GetRoute
+\brief Gets the route from the first point to the last.
+<P>---------------------------------------------------------------------------*/
+void CTour::GetRoute(vector<unsigned int>& Route) const
+{
+	unsigned int nSize = m_Tour.size();
+	Route.resize(nSize);
+	// The fixed edge is either before or after the first point.
+	bool bForward = (Prev(m_nFirst) == m_nLast);
+	unsigned int nPos = m_Pos[m_nFirst];
+	for (unsigned int i = 0 ; i < nSize; i++)
+	{
+		Route[i] = m_Tour[nPos];
+		nPos = bForward ? (nPos + 1) % nSize : (nPos + nSize - 1) % nSize;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::Queue
+\brief Queues the point for improvement i.e. clears its "don't look" bit.
+<P>---------------------------------------------------------------------------*/
+void CTour::Queue(unsigned int nPoint)
+{
+	if (!m_Queued[nPoint])
+	{
+		m_Queued[nPoint] = true;
+		m_Queue.push_back(nPoint);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::GetLength
+\brief The length of the route, excluding the fixed edge.
+<P>---------------------------------------------------------------------------*/
+double CTour::GetLength(void) const
+{
+	double dLength = 0;
+	for (unsigned int i = 0 ; i < m_Tour.size(); i++)
+	{
+		unsigned int a = m_Tour[i];
+		unsigned int b = m_Tour[(i + 1) % m_Tour.size()];
+		if (!IsFixed(a, b))
+			dLength += Dist(a, b);
+	}
+	return dLength;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::Reverse
+\brief Reverses the points from position nFrom forward to nTo. If it is shorter 
+the rest of the cycle is reversed instead which gives the same edges.
+<P>---------------------------------------------------------------------------*/
+void CTour::Reverse(unsigned int nFrom, unsigned int nTo)
+{
+	unsigned int nSize = m_Tour.size();
+	unsigned int nLength = (nTo + nSize - nFrom) % nSize + 1;
+	if (2 * nLength > nSize)
+	{
+		unsigned int nTemp = nFrom;
+		nFrom = (nTo + 1) % nSize;
+		nTo = (nTemp + nSize - 1) % nSize;
+		nLength = nSize - nLength;
+	}
+
+	for (unsigned int i = 0 ; i < nLength / 2; i++)
+	{
+		unsigned int a = m_Tour[nFrom];
+		unsigned int b = m_Tour[nTo];
+		m_Tour[nFrom] = b;
+		m_Pos[b] = nFrom;
+		m_Tour[nTo] = a;
+		m_Pos[a] = nTo;
+		nFrom = (nFrom + 1) % nSize;
+		nTo = (nTo + nSize - 1) % nSize;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::Move2Opt
+\brief Replaces the edges a-b and c-d with a-c and b-d where, in one direction
+round the cycle, b follows a and d follows c. d is implied by the others so is not
+passed.
+<P>---------------------------------------------------------------------------*/
+void CTour::Move2Opt(unsigned int a, unsigned int b, unsigned int c)
+{
+	if (Next(a) == b)
+		Reverse(m_Pos[b], m_Pos[c]);
+	else
+		Reverse(m_Pos[c], m_Pos[b]);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::Try2Opt
+\brief Looks for a 2-opt move which replaces an edge from the point with an edge
+to one of its neighbours. The neighbours are sorted so the search stops as soon as 
+the new edge is no shorter than the old.
+<P>---------------------------------------------------------------------------*/
+bool CTour::Try2Opt(unsigned int a)
+{
+	const unsigned int* pNeighbours = &m_Neighbours[a * m_nNeighbours];
+
+	for (int nDir = 0 ; nDir < 2; nDir++)
+	{
+		unsigned int b = nDir == 0 ? Next(a) : Prev(a);
+		if (IsFixed(a, b))
+			continue;
+		double dAB = Dist(a, b);
+
+		for (unsigned int i = 0 ; i < m_nNeighbours; i++)
+		{
+			unsigned int c = pNeighbours[i];
+			double dAC = Dist(a, c);
+			if (dAC >= dAB)
+				break;
+
+			unsigned int d = nDir == 0 ? Next(c) : Prev(c);
+			if (c == b || d == a || IsFixed(c, d))
+				continue;
+
+			double dDelta = dAC + Dist(b, d) - dAB - Dist(c, d);
+			if (dDelta < -m_dMinGain)
+			{
+				if (nDir == 0)
+					Move2Opt(a, b, c);
+				else
+					Move2Opt(b, a, d);
+				Queue(a);
+				Queue(b);
+				Queue(c);
+				Queue(d);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::TryOrOpt
+\brief Looks for an Or-opt move which takes a segment of 1 to 3 points starting or 
+ending at the point and puts it, either way round, next to a neighbour of one of 
+its ends. Done as 2 or 3 2-opt moves.
+<P>---------------------------------------------------------------------------*/
+bool CTour::TryOrOpt(unsigned int a)
+{
+	const unsigned int nSize = m_Tour.size();
+
+	for (unsigned int nSegment = 1 ; nSegment <= 3 && nSegment + 4 <= nSize; nSegment++)
+	{
+		for (int nEnd = 0 ; nEnd < (nSegment == 1 ? 1 : 2); nEnd++)
+		{
+			// The segment s1..s2 runs forward in the array between p and n.
+			unsigned int s1 = a;
+			unsigned int s2 = a;
+			for (unsigned int i = 1 ; i < nSegment; i++)
+			{
+				if (nEnd == 0)
+					s2 = Next(s2);
+				else
+					s1 = Prev(s1);
+			}
+			unsigned int p = Prev(s1);
+			unsigned int n = Next(s2);
+			if (IsFixed(p, s1) || IsFixed(s2, n))
+				continue;
+
+			double dRemoveGain = Dist(p, s1) + Dist(s2, n) - Dist(p, n);
+			if (dRemoveGain <= m_dMinGain)
+				continue;
+
+			const unsigned int nStart = m_Pos[s1];
+
+			for (int nSide = 0 ; nSide < 2; nSide++)
+			{
+				unsigned int e = nSide == 0 ? s1 : s2;
+				unsigned int f = nSide == 0 ? s2 : s1;
+				const unsigned int* pNeighbours = &m_Neighbours[e * m_nNeighbours];
+
+				for (unsigned int i = 0 ; i < m_nNeighbours; i++)
+				{
+					unsigned int c = pNeighbours[i];
+					double dEC = Dist(e, c);
+					if (dEC >= dRemoveGain)
+						break;
+					if ((m_Pos[c] + nSize - nStart) % nSize < nSegment)
+						continue;
+
+					for (int nEdge = 0 ; nEdge < 2; nEdge++)
+					{
+						// The edge u-v, v following u, the segment is to go between.
+						unsigned int u = nEdge == 0 ? c : Prev(c);
+						unsigned int v = nEdge == 0 ? Next(c) : c;
+						if ((m_Pos[u] + nSize - nStart) % nSize < nSegment ||
+							(m_Pos[v] + nSize - nStart) % nSize < nSegment ||
+							u == n || v == p || IsFixed(u, v))
+							continue;
+
+						unsigned int nFirst = (u == c) ? e : f;
+						unsigned int nLast = (u == c) ? f : e;
+						double dDelta = Dist(u, nFirst) + Dist(nLast, v) - Dist(u, v) - dRemoveGain;
+						if (dDelta < -m_dMinGain)
+						{
+							// p s1..s2 n .. u v -> p u .. n s2..s1 v -> p n .. u s2..s1 v
+							Move2Opt(p, s1, u);
+							Move2Opt(p, u, n);
+							if (nFirst == s1 && s1 != s2)
+								Move2Opt(u, s2, s1);
+
+							Queue(p);
+							Queue(n);
+							Queue(s1);
+							Queue(s2);
+							Queue(u);
+							Queue(v);
+							return true;
+						}
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTour::Optimise
+\brief Applies improving moves until none of the queued points has one.
+<P>---------------------------------------------------------------------------*/
+void CTour::Optimise(void)
+{
+	if (m_Tour.size() < 5)
+		return;
+
+	while (!m_Queue.empty())
+	{
+		unsigned int a = m_Queue.front();
+		m_Queue.pop_front();
+		m_Queued[a] = false;
+
+		while (Try2Opt(a) || TryOrOpt(a))
+		{
+			;
+		}
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GetNeighbourLists
+\brief Finds the nearest neighbours of every point.
+<P>---------------------------------------------------------------------------*/
+static void GetNeighbourLists(const vector<sKdPoint>& Points, unsigned int nNeighbours,
+							  vector<unsigned int>& Neighbours)
+{
+	CPointKdTree Tree(Points);
+	Neighbours.resize(Points.size() * nNeighbours);
+	for (unsigned int i = 0 ; i < Points.size(); i++)
+		Tree.GetNearest(i, nNeighbours, &Neighbours[i * nNeighbours]);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+Kick
+\brief Perturbs the route with random segment double bridges, A B C D -> A C B D 
+where B and C are short, queueing the points at the changed edges. The ends of the
+route are not moved.
+<P>---------------------------------------------------------------------------*/
+static void Kick(vector<unsigned int>& Route, unsigned int nKicks, mt19937& Random,
+				 vector<unsigned int>& Changed)
+{
+	unsigned int nSize = Route.size();
+	if (nSize < 8)
+		return;
+
+	unsigned int nMaxSegment = min(conKickSegmentLength, (nSize - 2) / 2);
+	vector<unsigned int> Temp;
+	for (unsigned int k = 0 ; k < nKicks; k++)
+	{
+		unsigned int nLength1 = 1 + Random() % nMaxSegment;
+		unsigned int nLength2 = 1 + Random() % nMaxSegment;
+		unsigned int nStart = 1 + Random() % (nSize - 1 - nLength1 - nLength2);
+
+		vector<unsigned int>::iterator B = Route.begin() + nStart;
+		vector<unsigned int>::iterator C = B + nLength1;
+		vector<unsigned int>::iterator D = C + nLength2;
+		Changed.push_back(*(B - 1));
+		Changed.push_back(*B);
+		Changed.push_back(*(C - 1));
+		Changed.push_back(*C);
+		Changed.push_back(*(D - 1));
+		Changed.push_back(*D);
+		rotate(B, C, D);
+	}
+}
+
+
 _MEMORY_POOL_IMPLEMENATION(CTravellingSalesman)
 
 
@@ -428,3 +842,220 @@ void CTravellingSalesman::Refine2(void)
 
 	}
 }
+
+
+/**--------------------------------------------------------------------------<BR>
+GetTourPoints
+\brief Copies the points of the list into arrays for the local search.
+<P>---------------------------------------------------------------------------*/
+static void GetTourPoints(const CPointList& List, vector<C2DPoint*>& Pointers, 
+						  vector<sKdPoint>& Points, double& dMinGain)
+{
+	Pointers.assign(List.begin(), List.end());
+	Points.resize(Pointers.size());
+
+	C2DRect Rect;
+	for (unsigned int i = 0 ; i < Pointers.size(); i++)
+	{
+		Points[i].x = Pointers[i]->x;
+		Points[i].y = Pointers[i]->y;
+		if (i == 0)
+			Rect.Set(*Pointers[i]);
+		else
+			Rect.ExpandToInclude(*Pointers[i]);
+	}
+	// Ignore gains which are just rounding errors.
+	dMinGain = Rect.GetTopLeft().Distance(Rect.GetBottomRight()) * 1e-12;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+SetTourPoints
+\brief Puts the points back in the list in the order of the route.
+<P>---------------------------------------------------------------------------*/
+static void SetTourPoints(CPointList& List, const vector<C2DPoint*>& Pointers,
+						  const vector<unsigned int>& Route)
+{
+	List.clear();
+	for (unsigned int i = 0 ; i < Route.size(); i++)
+		List.push_back(Pointers[Route[i]]);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTravellingSalesman::BuildNearestNeighbour
+\brief Reorders the points by going from the first point to the nearest point not 
+yet visited until only the last is left. Uses a kd-tree so is fast for large sets
+and gives a good start for RefineLocalSearch.
+<P>---------------------------------------------------------------------------*/
+void CTravellingSalesman::BuildNearestNeighbour(void)
+{
+	if (m_Points->size() < 4)
+		return;
+
+	vector<C2DPoint*> Pointers;
+	vector<sKdPoint> Points;
+	double dMinGain;
+	GetTourPoints(*m_Points, Pointers, Points, dMinGain);
+
+	const unsigned int nLast = Points.size() - 1;
+	CPointKdTree Tree(Points);
+	Tree.Remove(0);
+	Tree.Remove(nLast);
+
+	vector<unsigned int> Route;
+	Route.reserve(Points.size());
+	Route.push_back(0);
+	int nNext = Tree.GetNearestRemaining(Points[0].x, Points[0].y);
+	while (nNext >= 0)
+	{
+		Route.push_back(nNext);
+		Tree.Remove(nNext);
+		nNext = Tree.GetNearestRemaining(Points[nNext].x, Points[nNext].y);
+	}
+	Route.push_back(nLast);
+
+	SetTourPoints(*m_Points, Pointers, Route);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTravellingSalesman::RefineLocalSearch
+\brief Improves the current route with 2-opt and Or-opt moves until there are none
+left. Only moves which join a point to one of its nearest nNeighbours are tried and
+points are only looked at again when an edge next to them changes so this is close 
+to linear in the number of points. The first and last points stay where they are.
+<P>---------------------------------------------------------------------------*/
+void CTravellingSalesman::RefineLocalSearch(unsigned int nNeighbours)
+{
+	if (m_Points->size() < 5 || nNeighbours == 0)
+		return;
+
+	vector<C2DPoint*> Pointers;
+	vector<sKdPoint> Points;
+	double dMinGain;
+	GetTourPoints(*m_Points, Pointers, Points, dMinGain);
+
+	nNeighbours = min(nNeighbours, (unsigned int)Points.size() - 1);
+	vector<unsigned int> Neighbours;
+	GetNeighbourLists(Points, nNeighbours, Neighbours);
+
+	vector<unsigned int> Route(Points.size());
+	for (unsigned int i = 0 ; i < Route.size(); i++)
+		Route[i] = i;
+
+	CTour Tour(Points, Neighbours, nNeighbours, dMinGain);
+	Tour.SetRoute(Route);
+	Tour.Optimise();
+	Tour.GetRoute(Route);
+
+	SetTourPoints(*m_Points, Pointers, Route);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTravellingSalesman::RefineMultiStart
+\brief Runs RefineLocalSearch and then tries nStarts - 1 random perturbations of
+the result, each followed by the local search, keeping the shortest route found. 
+The starts are shared between nThreads threads, the number of cores if 0. Each 
+start is seeded by its number so the result does not depend on the threads.
+<P>---------------------------------------------------------------------------*/
+void CTravellingSalesman::RefineMultiStart(unsigned int nStarts, unsigned int nThreads, 
+										   unsigned int nNeighbours)
+{
+	if (m_Points->size() < 5 || nNeighbours == 0)
+		return;
+
+	vector<C2DPoint*> Pointers;
+	vector<sKdPoint> Points;
+	double dMinGain;
+	GetTourPoints(*m_Points, Pointers, Points, dMinGain);
+
+	nNeighbours = min(nNeighbours, (unsigned int)Points.size() - 1);
+	vector<unsigned int> Neighbours;
+	GetNeighbourLists(Points, nNeighbours, Neighbours);
+
+	vector<unsigned int> Start(Points.size());
+	for (unsigned int i = 0 ; i < Start.size(); i++)
+		Start[i] = i;
+
+	CTour Tour(Points, Neighbours, nNeighbours, dMinGain);
+	Tour.SetRoute(Start);
+	Tour.Optimise();
+	Tour.GetRoute(Start);
+
+	if (nStarts > 1)
+	{
+		if (nThreads == 0)
+			nThreads = max(1u, thread::hardware_concurrency());
+		nThreads = min(nThreads, nStarts - 1);
+
+		const unsigned int nKicks = 1 + Points.size() / conPointsPerKick;
+
+		// Each thread keeps its own best so there is nothing to lock.
+		vector< vector<unsigned int> > BestRoutes(nThreads, Start);
+		vector<double> BestLengths(nThreads, Tour.GetLength());
+
+		auto Worker = [&](unsigned int nThread)
+		{
+			CTour ThreadTour(Points, Neighbours, nNeighbours, dMinGain);
+			vector<unsigned int> Route;
+			vector<unsigned int> Changed;
+			for (unsigned int s = 1 + nThread ; s < nStarts; s += nThreads)
+			{
+				mt19937 Random(s);
+				Route = Start;
+				Changed.clear();
+				Kick(Route, nKicks, Random, Changed);
+
+				ThreadTour.SetRoute(Route, false);
+				for (unsigned int i = 0 ; i < Changed.size(); i++)
+					ThreadTour.Queue(Changed[i]);
+				ThreadTour.Optimise();
+
+				double dLength = ThreadTour.GetLength();
+				if (dLength < BestLengths[nThread])
+				{
+					BestLengths[nThread] = dLength;
+					ThreadTour.GetRoute(BestRoutes[nThread]);
+				}
+			}
+		};
+
+		vector<thread> Threads;
+		for (unsigned int t = 1 ; t < nThreads; t++)
+			Threads.push_back(thread(Worker, t));
+		Worker(0);
+		for (unsigned int t = 0 ; t < Threads.size(); t++)
+			Threads[t].join();
+
+		unsigned int nBest = 0;
+		for (unsigned int t = 1 ; t < nThreads; t++)
+		{
+			if (BestLengths[t] < BestLengths[nBest])
+				nBest = t;
+		}
+		Start.swap(BestRoutes[nBest]);
+	}
+
+	SetTourPoints(*m_Points, Pointers, Start);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CTravellingSalesman::GetLength
+\brief Returns the length of the route from the first point to the last.
+<P>---------------------------------------------------------------------------*/
+double CTravellingSalesman::GetLength(void) const
+{
+	double dLength = 0;
+	if (m_Points->empty())
+		return dLength;
+
+	CPointList::const_iterator It = m_Points->begin();
+	CPointList::const_iterator ItNext = It;
+	for (++ItNext ; ItNext != m_Points->end(); ++It, ++ItNext)
+		dLength += (*It)->Distance(**ItNext);
+
+	return dLength;
+}
@@ -15,6 +15,11 @@ to help minimise routes between points. Used by the polygon for reordering point
 \class CTravellingSalesman
 \brief A class which uses heuristic methods to help minimise routes between points. 
 Used by the polygon for reordering points.
+
+The route always runs from the first point to the last, these are never moved. 
+For large numbers of points use BuildNearestNeighbour followed by RefineLocalSearch
+or RefineMultiStart which work on an array with near neighbour lists rather than 
+the list.
 <P>---------------------------------------------------------------------------*/
 
 #ifndef _CTRAVELLINGSALESMAN_H 
@@ -49,6 +54,14 @@ public:
 	void SimpleReorder(void);
 	/// Optimises the position of the points
 	void Optimize(void);
+	/// Reorders the points by going to the nearest point not yet visited.
+	void BuildNearestNeighbour(void);
+	/// 2-opt and Or-opt local search using the nearest neighbours of each point.
+	void RefineLocalSearch(unsigned int nNeighbours = 10);
+	/// Local search followed by perturbed restarts on several threads, keeping the best.
+	void RefineMultiStart(unsigned int nStarts, unsigned int nThreads = 0, unsigned int nNeighbours = 10);
+	/// Returns the length of the route.
+	double GetLength(void) const;
 	/// Deletes all
 	void DeleteAll(void);
 
@@ -0,0 +1,689 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file BooleanComparison.cpp
+\brief Compares the sweep line Boolean engine with C2DPolyBase::GetBoolean.
+
+Each case is checked by sampling points. A point must be inside exactly one shape of
+the result if the operation on whether it is inside each input says so, and inside
+none otherwise. Both engines are checked the same way, but only failures of the
+sweep line engine fail the run: GetBoolean is known to fail with coincident edges,
+which is what the sweep line engine is for. GetBoolean is only checked on shapes that
+overlap, as it returns nothing for the union of distinct shapes. It is run with the
+default degenerate handling. Sets of overlapping stars are unified with UnifyCascaded
+and UnifyProgressive, each checked the same way and their areas compared. A positive
+union of 2 triangles is checked the same way by its winding. The times of both
+engines are then compared on shapes of increasing size.
+
+Build with GEOLIB_TESTS_EXECUTABLE. The optional argument is the random seed.
+<P>---------------------------------------------------------------------------*/
+
+#include "GeoLib.h"
+#include "PolygonBoolean.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+/// The names of the operations, in the order of CPolygonBoolean::eOperation.
+static const char* conOpNames[] = { "intersection", "union", "difference", "xor" };
+
+
+/**--------------------------------------------------------------------------<BR>
+Random <BR>
+\brief A random number from 0 to 1.
+<P>---------------------------------------------------------------------------*/
+static double Random(void)
+{
+	return rand() / (double)RAND_MAX;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+InRing <BR>
+\brief True if the point is inside the ring, by counting the crossings of a ray to
+the right. Arcs are treated as their chords.
+<P>---------------------------------------------------------------------------*/
+static bool InRing(const C2DPolyBase& Ring, const C2DPoint& pt)
+{
+	bool bIn = false;
+	const unsigned int nLines = Ring.GetLineCount();
+	for (unsigned int i = 0; i < nLines; i++)
+	{
+		const C2DPoint a = Ring.GetLine(i)->GetPointFrom();
+		const C2DPoint b = Ring.GetLine(i)->GetPointTo();
+		if ((a.y > pt.y) != (b.y > pt.y))
+		{
+			const double x = a.x + (pt.y - a.y) * (b.x - a.x) / (b.y - a.y);
+			if (pt.x < x)
+				bIn = !bIn;
+		}
+	}
+	return bIn;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+InShape <BR>
+\brief True if the point is inside the rim of the shape and outside its holes.
+<P>---------------------------------------------------------------------------*/
+static bool InShape(const C2DHoledPolyBase& Shape, const C2DPoint& pt)
+{
+	if (Shape.GetRim() == 0 || !InRing(*Shape.GetRim(), pt))
+		return false;
+	for (unsigned int h = 0; h < Shape.GetHoleCount(); h++)
+	{
+		if (InRing(*Shape.GetHole(h), pt))
+			return false;
+	}
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+IsCorrect <BR>
+\brief True if each point is inside exactly one shape of the result where the
+operation says it should be, and inside none elsewhere.
+<P>---------------------------------------------------------------------------*/
+static bool IsCorrect(const C2DHoledPolyBase& A, const C2DHoledPolyBase& B,
+					CPolygonBoolean::eOperation eOp, const C2DHoledPolyBaseSet& Result,
+					const vector<C2DPoint>& Samples)
+{
+	for (unsigned int i = 0; i < Samples.size(); i++)
+	{
+		const bool bA = InShape(A, Samples[i]);
+		const bool bB = InShape(B, Samples[i]);
+		bool bExpected = false;
+		switch (eOp)
+		{
+		case CPolygonBoolean::Intersection: bExpected = bA && bB; break;
+		case CPolygonBoolean::Union: bExpected = bA || bB; break;
+		case CPolygonBoolean::Difference: bExpected = bA && !bB; break;
+		case CPolygonBoolean::Xor: bExpected = bA != bB; break;
+		}
+
+		unsigned int nInside = 0;
+		for (unsigned int s = 0; s < Result.size(); s++)
+		{
+			if (InShape(Result[s], Samples[i]))
+				nInside++;
+		}
+		if (nInside != (bExpected ? 1u : 0u))
+			return false;
+	}
+	return true;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+OldBoolean <BR>
+\brief Performs the operation with GetBoolean, xor being the 2 differences.
+<P>---------------------------------------------------------------------------*/
+static void OldBoolean(const C2DHoledPolyBase& A, const C2DHoledPolyBase& B,
+					CPolygonBoolean::eOperation eOp, C2DHoledPolyBaseSet& Result)
+{
+	switch (eOp)
+	{
+	case CPolygonBoolean::Intersection:
+		A.GetBoolean(B, Result, true, true);
+		break;
+	case CPolygonBoolean::Union:
+		A.GetBoolean(B, Result, false, false);
+		break;
+	case CPolygonBoolean::Difference:
+		A.GetBoolean(B, Result, false, true);
+		break;
+	case CPolygonBoolean::Xor:
+		A.GetBoolean(B, Result, false, true);
+		B.GetBoolean(A, Result, false, true);
+		break;
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeStar <BR>
+\brief A polygon with the number of points at random distances around the centre.
+<P>---------------------------------------------------------------------------*/
+static C2DPolygon MakeStar(double dx, double dy, double dRadius, unsigned int nPoints)
+{
+	vector<C2DPoint> Points(nPoints);
+	for (unsigned int i = 0; i < nPoints; i++)
+	{
+		const double dAngle = 2 * conPI * i / nPoints;
+		const double dDist = dRadius * (0.5 + 0.5 * Random());
+		Points[i].Set(dx + dDist * cos(dAngle), dy + dDist * sin(dAngle));
+	}
+	C2DPolygon Poly;
+	Poly.Create(&Points[0], nPoints);
+	return Poly;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeHoled <BR>
+\brief A holed polygon with the rim given and no holes.
+<P>---------------------------------------------------------------------------*/
+static C2DHoledPolygon MakeHoled(const C2DPolygon& Rim)
+{
+	C2DHoledPolygon Holed;
+	Holed.SetRim(Rim);
+	return Holed;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+Orient <BR>
+\brief Twice the signed area of the triangle, exact for points on a small integer grid.
+<P>---------------------------------------------------------------------------*/
+static double Orient(const C2DPoint& a, const C2DPoint& b, const C2DPoint& c)
+{
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+OnEdge <BR>
+\brief True if the point is on the edge from a to b.
+<P>---------------------------------------------------------------------------*/
+static bool OnEdge(const C2DPoint& a, const C2DPoint& b, const C2DPoint& pt)
+{
+	return Orient(a, b, pt) == 0 && min(a.x, b.x) <= pt.x && pt.x <= max(a.x, b.x) &&
+		min(a.y, b.y) <= pt.y && pt.y <= max(a.y, b.y);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+EdgesTouch <BR>
+\brief True if the edge from a to b crosses or touches the edge from c to d.
+<P>---------------------------------------------------------------------------*/
+static bool EdgesTouch(const C2DPoint& a, const C2DPoint& b, const C2DPoint& c, const C2DPoint& d)
+{
+	const double o1 = Orient(a, b, c);
+	const double o2 = Orient(a, b, d);
+	const double o3 = Orient(c, d, a);
+	const double o4 = Orient(c, d, b);
+	if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0)))
+		return true;
+	return OnEdge(a, b, c) || OnEdge(a, b, d) || OnEdge(c, d, a) || OnEdge(c, d, b);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeGridPolygon <BR>
+\brief A polygon through random distinct points of an integer grid, in order of
+their angle around a point near its centre, so edges and points of 2 such polygons
+often coincide. Returns false if the polygon is not simple or has no area.
+<P>---------------------------------------------------------------------------*/
+static bool MakeGridPolygon(C2DPolygon& Poly, int nGrid)
+{
+	const double cx = nGrid / 2.0 + 0.1;
+	const double cy = nGrid / 2.0 + 0.2;
+	const unsigned int nTries = 3 + rand() % 8;
+	vector<C2DPoint> Points;
+	vector<double> Angles;
+	for (unsigned int i = 0; i < nTries; i++)
+	{
+		const C2DPoint pt(rand() % (nGrid + 1), rand() % (nGrid + 1));
+		const double dAngle = atan2(pt.y - cy, pt.x - cx);
+		bool bDuplicate = false;
+		for (unsigned int j = 0; j < Points.size(); j++)
+			bDuplicate = bDuplicate || Points[j] == pt;
+		if (bDuplicate)
+			continue;
+
+		// Insertion by angle.
+		unsigned int nPos = (unsigned int)Points.size();
+		while (nPos > 0 && Angles[nPos - 1] > dAngle)
+			nPos--;
+		Points.insert(Points.begin() + nPos, pt);
+		Angles.insert(Angles.begin() + nPos, dAngle);
+	}
+	if (Points.size() < 3)
+		return false;
+
+	// Simple if no 2 edges other than neighbours touch and no neighbours fold back.
+	const unsigned int n = (unsigned int)Points.size();
+	for (unsigned int i = 0; i < n; i++)
+	{
+		const C2DPoint& a = Points[i];
+		const C2DPoint& b = Points[(i + 1) % n];
+		const C2DPoint& c = Points[(i + 2) % n];
+		if (Orient(a, b, c) == 0 && (c.x - b.x) * (a.x - b.x) + (c.y - b.y) * (a.y - b.y) > 0)
+			return false;
+		for (unsigned int j = i + 2; j < n; j++)
+		{
+			if (i == 0 && j == n - 1)
+				continue;
+			if (EdgesTouch(a, b, Points[j], Points[(j + 1) % n]))
+				return false;
+		}
+	}
+
+	Poly.Create(&Points[0], n);
+	return fabs(Poly.GetArea()) > 0;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeRect <BR>
+\brief A rectangle with random integer corners on a grid, which often shares edges
+with another one.
+<P>---------------------------------------------------------------------------*/
+static C2DPolygon MakeRect(int nGrid)
+{
+	const int x1 = rand() % nGrid;
+	const int y1 = rand() % nGrid;
+	const int x2 = x1 + 1 + rand() % (nGrid - x1);
+	const int y2 = y1 + 1 + rand() % (nGrid - y1);
+	const double Coords[] = { (double)x1, (double)y1, (double)x2, (double)y1,
+							(double)x2, (double)y2, (double)x1, (double)y2 };
+	C2DPolygon Poly;
+	Poly.Create(Coords, 4);
+	return Poly;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeNearTriangles <BR>
+\brief 2 random triangles sharing a vertex where a second vertex of the first is
+moved by one unit in the last place to make the second. Rounding the points where
+their edges cross used to stop the sweep from ending.
+<P>---------------------------------------------------------------------------*/
+static void MakeNearTriangles(C2DPolygon& A, C2DPolygon& B)
+{
+	C2DPoint P0[3];
+	for (unsigned int i = 0; i < 3; i++)
+		P0[i].Set(100 * Random(), 100 * Random());
+
+	C2DPoint P1[3];
+	P1[0].Set(P0[0].x, P0[0].y);
+	P1[1].Set(P0[1].x, P0[1].y);
+	P1[2].Set(100 * Random(), 100 * Random());
+	double& dMove = (rand() % 2 == 0) ? P1[1].x : P1[1].y;
+	dMove = nextafter(dMove, (rand() % 2 == 0) ? 1000.0 : -1000.0);
+	if (rand() % 2 == 0)
+		swap(P1[1], P1[2]);
+
+	A.Create(P0, 3);
+	B.Create(P1, 3);
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeSamples <BR>
+\brief Random points within the rectangle.
+<P>---------------------------------------------------------------------------*/
+static void MakeSamples(const C2DRect& Rect, unsigned int nSamples, vector<C2DPoint>& Samples)
+{
+	Samples.resize(nSamples);
+	for (unsigned int i = 0; i < nSamples; i++)
+	{
+		Samples[i].Set(Rect.GetLeft() + Rect.Width() * Random(),
+					Rect.GetBottom() + Rect.Height() * Random());
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+class CComparison
+\brief The number of cases and failures of each engine in a group of cases.
+<P>---------------------------------------------------------------------------*/
+class CComparison
+{
+public:
+	CComparison(const char* sName) : m_sName(sName), m_nCases(0), m_nSweepFailures(0),
+		m_nOldCases(0), m_nOldFailures(0) {;}
+
+	/// Runs all 4 operations on the shapes and checks both engines.
+	void Run(const C2DHoledPolyBase& A, const C2DHoledPolyBase& B)
+	{
+		C2DRect Rect;
+		A.GetBoundingRect(Rect);
+		C2DRect RectB;
+		B.GetBoundingRect(RectB);
+		Rect.ExpandToInclude(RectB);
+		Rect.Grow(1.1);
+		vector<C2DPoint> Samples;
+		MakeSamples(Rect, 400, Samples);
+		const bool bOverlap = A.Overlaps(B);
+
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			const CPolygonBoolean::eOperation eOp = (CPolygonBoolean::eOperation)i;
+			m_nCases++;
+
+			C2DHoledPolyBaseSet Sweep;
+			A.GetBooleanSweep(B, Sweep, eOp);
+			if (!IsCorrect(A, B, eOp, Sweep, Samples))
+			{
+				m_nSweepFailures++;
+				printf("  sweep failed %s of %s case %u\n", conOpNames[i], m_sName, m_nCases / 4);
+			}
+
+			if (!bOverlap)
+				continue;
+			m_nOldCases++;
+			C2DHoledPolyBaseSet Old;
+			OldBoolean(A, B, eOp, Old);
+			if (!IsCorrect(A, B, eOp, Old, Samples))
+				m_nOldFailures++;
+		}
+	}
+
+	/// Prints the results.
+	void Print(void) const
+	{
+		printf("%-16s sweep failed %4u of %5u, GetBoolean failed %4u of %5u\n",
+			m_sName, m_nSweepFailures, m_nCases, m_nOldFailures, m_nOldCases);
+	}
+
+	/// The failures of the sweep line engine.
+	unsigned int GetSweepFailures(void) const {return m_nSweepFailures;}
+
+private:
+	const char* m_sName;
+	unsigned int m_nCases;
+	unsigned int m_nSweepFailures;
+	unsigned int m_nOldCases;
+	unsigned int m_nOldFailures;
+};
+
+
+/**--------------------------------------------------------------------------<BR>
+Milliseconds <BR>
+\brief The time since the start in milliseconds.
+<P>---------------------------------------------------------------------------*/
+static double Milliseconds(const chrono::steady_clock::time_point& Start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - Start).count();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CompareSpeed <BR>
+\brief Prints the mean time of the union and intersection of 2 overlapping stars
+with each engine.
+<P>---------------------------------------------------------------------------*/
+static void CompareSpeed(unsigned int nPoints, unsigned int nRepeats)
+{
+	double dSweep = 0;
+	double dOld = 0;
+	for (unsigned int r = 0; r < nRepeats; r++)
+	{
+		const C2DHoledPolygon A = MakeHoled(MakeStar(0, 0, 10, nPoints));
+		const C2DHoledPolygon B = MakeHoled(MakeStar(3, 2, 10, nPoints));
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			const CPolygonBoolean::eOperation eOp = (CPolygonBoolean::eOperation)i;
+			chrono::steady_clock::time_point Start = chrono::steady_clock::now();
+			{
+				C2DHoledPolyBaseSet Result;
+				A.GetBooleanSweep(B, Result, eOp);
+			}
+			dSweep += Milliseconds(Start);
+
+			Start = chrono::steady_clock::now();
+			{
+				C2DHoledPolyBaseSet Result;
+				OldBoolean(A, B, eOp, Result);
+			}
+			dOld += Milliseconds(Start);
+		}
+	}
+	printf("%5u points: sweep %9.3f ms, GetBoolean %9.3f ms\n", nPoints,
+		dSweep / (2 * nRepeats), dOld / (2 * nRepeats));
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CheckPositiveUnion <BR>
+\brief The positive union of 2 triangles sharing a vertex, a second vertex of each
+being one unit in the last place apart, which used not to end. Returns the number of
+sampled points inside the wrong number of result shapes, a point being in the result
+if the triangles wind around it anticlockwise more than clockwise.
+<P>---------------------------------------------------------------------------*/
+static unsigned int CheckPositiveUnion(void)
+{
+	// Given in hexadecimal to be exact.
+	const char* Coords[2][6] = {
+		{ "0x1.12e29bf14af46p+6", "-0x1.403712c5d1614p+3", "0x1.375842d728d21p+6",
+		  "-0x1.21b868adfda07p+3", "0x1.f8b11fdfb9739p+5", "-0x1.0298dc4bbaf49p+1" },
+		{ "0x1.12e29bf14af46p+6", "-0x1.403712c5d1614p+3", "0x1.f8b11fdfb9739p+5",
+		  "-0x1.0298dc4bbaf48p+1", "0x1.fa22315f79179p+5", "-0x1.2959ab1c7b55fp+4" } };
+
+	CPolygonBoolean Engine;
+	C2DPoint Points[2][3];
+	for (unsigned int t = 0; t < 2; t++)
+	{
+		vector<double> Triangle(6);
+		for (unsigned int i = 0; i < 6; i++)
+			Triangle[i] = strtod(Coords[t][i], 0);
+		for (unsigned int i = 0; i < 3; i++)
+			Points[t][i].Set(Triangle[2 * i], Triangle[2 * i + 1]);
+		Engine.AddSubject(Triangle);
+	}
+
+	C2DHoledPolyBaseSet Result;
+	Engine.ExecutePositiveUnion(Result);
+
+	C2DPolygon Triangles[2];
+	int Winds[2];
+	C2DRect Rect;
+	for (unsigned int t = 0; t < 2; t++)
+	{
+		Triangles[t].Create(Points[t], 3);
+		Winds[t] = Orient(Points[t][0], Points[t][1], Points[t][2]) > 0 ? 1 : -1;
+		C2DRect TriangleRect;
+		Triangles[t].GetBoundingRect(TriangleRect);
+		if (t == 0)
+			Rect = TriangleRect;
+		else
+			Rect.ExpandToInclude(TriangleRect);
+	}
+	Rect.Grow(1.1);
+
+	vector<C2DPoint> Samples;
+	MakeSamples(Rect, 10000, Samples);
+	unsigned int nFailures = 0;
+	for (unsigned int i = 0; i < Samples.size(); i++)
+	{
+		int nWind = 0;
+		for (unsigned int t = 0; t < 2; t++)
+		{
+			if (InRing(Triangles[t], Samples[i]))
+				nWind += Winds[t];
+		}
+
+		unsigned int nInside = 0;
+		for (unsigned int s = 0; s < Result.size(); s++)
+		{
+			if (InShape(Result[s], Samples[i]))
+				nInside++;
+		}
+		if (nInside != (nWind > 0 ? 1u : 0u))
+			nFailures++;
+	}
+
+	printf("positive union   failed %4u of %5u sampled points\n", nFailures, (unsigned int)Samples.size());
+	return nFailures;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+GetSetArea <BR>
+\brief The area of the shapes, less that of their holes.
+<P>---------------------------------------------------------------------------*/
+static double GetSetArea(const C2DHoledPolyBaseSet& Shapes)
+{
+	double dArea = 0;
+	for (unsigned int s = 0; s < Shapes.size(); s++)
+	{
+		dArea += Shapes[s].GetRim()->GetArea();
+		for (unsigned int h = 0; h < Shapes[s].GetHoleCount(); h++)
+			dArea -= Shapes[s].GetHole(h)->GetArea();
+	}
+	return dArea;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CountWrong <BR>
+\brief The number of points not inside exactly one shape of the result where they
+are inside any of the input, or inside any of the result where they are not.
+<P>---------------------------------------------------------------------------*/
+static unsigned int CountWrong(const C2DHoledPolyBaseSet& Input, const C2DHoledPolyBaseSet& Result,
+							   const vector<C2DPoint>& Samples)
+{
+	unsigned int nWrong = 0;
+	for (unsigned int i = 0; i < Samples.size(); i++)
+	{
+		bool bExpected = false;
+		for (unsigned int s = 0; s < Input.size() && !bExpected; s++)
+			bExpected = InShape(Input[s], Samples[i]);
+
+		unsigned int nInside = 0;
+		for (unsigned int s = 0; s < Result.size(); s++)
+		{
+			if (InShape(Result[s], Samples[i]))
+				nInside++;
+		}
+		if (nInside != (bExpected ? 1u : 0u))
+			nWrong++;
+	}
+	return nWrong;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+CompareUnify <BR>
+\brief Unifies sets of overlapping random stars with UnifyCascaded and with
+UnifyProgressive and checks each by sampling points. A case fails if the cascaded
+result is wrong at a sample or, where the progressive result is right at all of them,
+if their areas differ by more than rounding. Returns the number of failed cases.
+<P>---------------------------------------------------------------------------*/
+static unsigned int CompareUnify(unsigned int nCases)
+{
+	unsigned int nFailures = 0;
+	unsigned int nProgressiveFailures = 0;
+	for (unsigned int c = 0; c < nCases; c++)
+	{
+		C2DHoledPolyBaseSet Input;
+		const unsigned int nStars = 5 + rand() % 40;
+		for (unsigned int i = 0; i < nStars; i++)
+			Input.Add(new C2DHoledPolygon(MakeHoled(MakeStar(40 * Random(), 40 * Random(), 6, 5 + rand() % 30))));
+
+		C2DHoledPolyBaseSet Cascaded;
+		Cascaded.AddCopy(Input);
+		Cascaded.UnifyCascaded();
+		C2DHoledPolyBaseSet Progressive;
+		Progressive.AddCopy(Input);
+		Progressive.UnifyProgressive();
+
+		C2DRect Rect;
+		Input.GetBoundingRect(Rect);
+		Rect.Grow(1.1);
+		vector<C2DPoint> Samples;
+		MakeSamples(Rect, 1000, Samples);
+
+		const bool bProgressiveRight = CountWrong(Input, Progressive, Samples) == 0;
+		if (!bProgressiveRight)
+			nProgressiveFailures++;
+
+		const double dCascaded = GetSetArea(Cascaded);
+		const double dProgressive = GetSetArea(Progressive);
+		if (CountWrong(Input, Cascaded, Samples) != 0 ||
+			(bProgressiveRight && fabs(dCascaded - dProgressive) > 1e-9 * dCascaded))
+		{
+			nFailures++;
+			printf("  cascaded union failed case %u, area %.12g, progressive %.12g\n", c,
+				dCascaded, dProgressive);
+		}
+	}
+
+	printf("cascaded union   failed %4u of %5u, UnifyProgressive failed %4u of %5u\n",
+		nFailures, nCases, nProgressiveFailures, nCases);
+	return nFailures;
+}
+
+
+int main(int argc, char** argv)
+{
+	srand(argc > 1 ? atoi(argv[1]) : 1);
+
+	printf("Correctness of intersection, union, difference and xor:\n");
+	CComparison Stars("random stars");
+	for (unsigned int i = 0; i < 300; i++)
+	{
+		const C2DHoledPolygon A = MakeHoled(MakeStar(0, 0, 10, 5 + rand() % 60));
+		const C2DHoledPolygon B = MakeHoled(MakeStar(10 * Random() - 5, 10 * Random() - 5, 10, 5 + rand() % 60));
+		Stars.Run(A, B);
+	}
+	Stars.Print();
+
+	CComparison Grid("grid polygons");
+	for (unsigned int i = 0; i < 2000; i++)
+	{
+		C2DPolygon A, B;
+		if (MakeGridPolygon(A, 6) && MakeGridPolygon(B, 6))
+			Grid.Run(MakeHoled(A), MakeHoled(B));
+	}
+	Grid.Print();
+
+	CComparison Rects("shared edges");
+	for (unsigned int i = 0; i < 500; i++)
+		Rects.Run(MakeHoled(MakeRect(4)), MakeHoled(MakeRect(4)));
+	Rects.Print();
+
+	CComparison Holed("holed polygons");
+	for (unsigned int i = 0; i < 300; i++)
+	{
+		const double Rim[] = { 0, 0, 8, 0, 8, 8, 0, 8 };
+		const double Hole[] = { 2, 2, 2, 6, 6, 6, 6, 2 };
+		C2DPolygon RimPoly, HolePoly;
+		RimPoly.Create(Rim, 4);
+		HolePoly.Create(Hole, 4);
+		C2DHoledPolygon A;
+		A.SetRim(RimPoly);
+		A.AddHole(HolePoly);
+
+		C2DHoledPolygon B = MakeHoled(MakeRect(8));
+		if (i % 2 == 1)
+			B.SetRim(MakeStar(8 * Random(), 8 * Random(), 4, 5 + rand() % 20));
+		Holed.Run(A, B);
+	}
+	Holed.Print();
+
+	CComparison Near("shared vertices");
+	for (unsigned int i = 0; i < 3000; i++)
+	{
+		C2DPolygon A, B;
+		MakeNearTriangles(A, B);
+		Near.Run(MakeHoled(A), MakeHoled(B));
+	}
+	Near.Print();
+
+	const unsigned int nUnifyFailures = CompareUnify(100);
+	const unsigned int nPositiveFailures = CheckPositiveUnion();
+
+	printf("\nMean time of union and intersection of 2 stars:\n");
+	CompareSpeed(20, 200);
+	CompareSpeed(100, 100);
+	CompareSpeed(300, 20);
+	CompareSpeed(1000, 4);
+
+	const unsigned int nFailures = Stars.GetSweepFailures() + Grid.GetSweepFailures() +
+		Rects.GetSweepFailures() + Holed.GetSweepFailures() + Near.GetSweepFailures() +
+		nUnifyFailures + nPositiveFailures;
+	printf("\n%s\n", nFailures == 0 ? "Passed" : "FAILED");
+	return nFailures == 0 ? 0 : 1;
+}
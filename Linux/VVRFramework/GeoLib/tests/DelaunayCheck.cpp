@@ -0,0 +1,158 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file DelaunayCheck.cpp
+\brief Checks that CDelaunay uses every distinct point.
+
+Each case is triangulated and must use every distinct input point, have each
+triangle anticlockwise, have each half edge opposite one running the other way, and
+have no point inside the circle of a triangle next to it. The cases are points on a
+line with one off it, whose order by distance from the seed puts points inside the
+hull so far, random points with duplicates and points on a grid, which are
+cocircular and collinear.
+
+Build with GEOLIB_TESTS_EXECUTABLE. The optional argument is the random seed.
+<P>---------------------------------------------------------------------------*/
+
+#include "GeoLib.h"
+#include "Delaunay.h"
+#include "Predicates.h"
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+
+/**--------------------------------------------------------------------------<BR>
+Random <BR>
+\brief A random number from 0 to 1.
+<P>---------------------------------------------------------------------------*/
+static double Random(void)
+{
+	return rand() / (double)RAND_MAX;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+Check <BR>
+\brief Triangulates the points and prints the faults found. Returns true if there
+are none.
+<P>---------------------------------------------------------------------------*/
+static bool Check(const char* szName, const vector<double>& Coords)
+{
+	CDelaunay Delaunay;
+	Delaunay.Create(Coords);
+
+	const vector<unsigned int>& Triangles = Delaunay.GetTriangles();
+	const vector<unsigned int>& HalfEdges = Delaunay.GetHalfEdges();
+	const unsigned int nCount = Coords.size() / 2;
+
+	set< pair<double, double> > Distinct;
+	for (unsigned int i = 0; i < nCount; i++)
+		Distinct.insert(make_pair(Coords[2 * i], Coords[2 * i + 1]));
+
+	set< pair<double, double> > Used;
+	for (unsigned int e = 0; e < Triangles.size(); e++)
+		Used.insert(make_pair(Coords[2 * Triangles[e]], Coords[2 * Triangles[e] + 1]));
+
+	unsigned int nClockwise = 0;
+	unsigned int nUnlinked = 0;
+	unsigned int nIllegal = 0;
+	for (unsigned int e = 0; e < Triangles.size(); e++)
+	{
+		const unsigned int p = Triangles[e];
+		const unsigned int q = Triangles[CDelaunay::NextHalfEdge(e)];
+		const unsigned int r = Triangles[CDelaunay::PrevHalfEdge(e)];
+		if (e % 3 == 0 && GeoPredicates::Orient2D(Coords[2 * p], Coords[2 * p + 1],
+			Coords[2 * q], Coords[2 * q + 1], Coords[2 * r], Coords[2 * r + 1]) <= 0)
+			nClockwise++;
+
+		const unsigned int b = HalfEdges[e];
+		if (b == conNoHalfEdge)
+			continue;
+		if (HalfEdges[b] != e || Triangles[b] != q || Triangles[CDelaunay::NextHalfEdge(b)] != p)
+		{
+			nUnlinked++;
+			continue;
+		}
+		const unsigned int s = Triangles[CDelaunay::PrevHalfEdge(b)];
+		if (GeoPredicates::InCircle(Coords[2 * p], Coords[2 * p + 1], Coords[2 * q], Coords[2 * q + 1],
+			Coords[2 * r], Coords[2 * r + 1], Coords[2 * s], Coords[2 * s + 1]) > 0)
+			nIllegal++;
+	}
+
+	const bool bPassed = Used.size() == Distinct.size() && nClockwise == 0 && nUnlinked == 0 &&
+		nIllegal == 0;
+	printf("%-24s %u of %u distinct points used, %u clockwise, %u unlinked, %u not Delaunay%s\n",
+		szName, (unsigned int)Used.size(), (unsigned int)Distinct.size(), nClockwise, nUnlinked,
+		nIllegal, bPassed ? "" : "  FAILED");
+	return bPassed;
+}
+
+
+int main(int argc, char** argv)
+{
+	srand(argc > 1 ? atoi(argv[1]) : 1);
+
+	unsigned int nFailures = 0;
+
+	// All but the last on a line, which reaches far beyond the seed.
+	vector<double> Line;
+	for (unsigned int k = 0; k <= 90; k++)
+	{
+		Line.push_back(k / 100.0);
+		Line.push_back(0.5 * k / 100.0 + 3);
+	}
+	if (!Check("line", Line))
+		nFailures++;
+	Line.push_back(0.45);
+	Line.push_back(2);
+	if (!Check("line and a point", Line))
+		nFailures++;
+
+	for (unsigned int i = 0; i < 20; i++)
+	{
+		vector<double> Coords;
+		const unsigned int nPoints = 3 + rand() % 2000;
+		for (unsigned int j = 0; j < nPoints; j++)
+		{
+			if (j > 0 && rand() % 10 == 0)
+			{
+				const unsigned int nCopy = rand() % j;
+				Coords.push_back(Coords[2 * nCopy]);
+				Coords.push_back(Coords[2 * nCopy + 1]);
+				continue;
+			}
+			Coords.push_back(100 * Random());
+			Coords.push_back(100 * Random());
+		}
+		if (!Check("random with duplicates", Coords))
+			nFailures++;
+	}
+
+	for (unsigned int nGrid = 2; nGrid <= 40; nGrid += 19)
+	{
+		vector<double> Coords;
+		for (unsigned int x = 0; x < nGrid; x++)
+		{
+			for (unsigned int y = 0; y < nGrid; y++)
+			{
+				Coords.push_back(x);
+				Coords.push_back(y);
+			}
+		}
+		if (!Check("grid", Coords))
+			nFailures++;
+	}
+
+	printf("\n%s\n", nFailures == 0 ? "Passed" : "FAILED");
+	return nFailures == 0 ? 0 : 1;
+}
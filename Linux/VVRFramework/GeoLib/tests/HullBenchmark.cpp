@@ -0,0 +1,121 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file HullBenchmark.cpp
+\brief Times C2DPointSet::ExtractConvexHull and GetMinimumEnclosingCircle.
+
+Random points in a disc, from 1 thousand to 10 million of them, are given to
+ExtractConvexHull on 1 thread and on all the cores and to GetMinimumEnclosingCircle.
+The mean time of each is printed with the hull size and the circle radius. The 10
+million points take about a gigabyte of memory.
+
+Build with GEOLIB_TESTS_EXECUTABLE. The optional argument is the largest number of
+points, 10 million by default.
+<P>---------------------------------------------------------------------------*/
+
+#include "GeoLib.h"
+#include "RandomNumber.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+
+/**--------------------------------------------------------------------------<BR>
+Milliseconds <BR>
+\brief The time since the start in milliseconds.
+<P>---------------------------------------------------------------------------*/
+static double Milliseconds(const chrono::steady_clock::time_point& Start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - Start).count();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+MakeDisc <BR>
+\brief Fills the set with random points in a disc of radius 1 about the origin.
+<P>---------------------------------------------------------------------------*/
+static void MakeDisc(unsigned int nPoints, CRandomGenerator& Generator, C2DPointSet& Points)
+{
+	Points.DeleteAll();
+	while (Points.size() < nPoints)
+	{
+		const double x = Generator.Get(-1, 1);
+		const double y = Generator.Get(-1, 1);
+		if (x * x + y * y <= 1)
+			Points.AddCopy(x, y);
+	}
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+TimeHull <BR>
+\brief The mean time of extracting the hull on the threads given. The hull is put
+back after each extraction so each repeat has the same points. Sets the hull size.
+<P>---------------------------------------------------------------------------*/
+static double TimeHull(C2DPointSet& Points, unsigned int nThreads, unsigned int nRepeats,
+					   unsigned int& nHullSize)
+{
+	double dTime = 0;
+	for (unsigned int r = 0; r < nRepeats; r++)
+	{
+		C2DPointSet Hull;
+		const chrono::steady_clock::time_point Start = chrono::steady_clock::now();
+		Hull.ExtractConvexHull(Points, nThreads);
+		dTime += Milliseconds(Start);
+		nHullSize = Hull.size();
+		Points << Hull;
+	}
+	return dTime / nRepeats;
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+TimeCircle <BR>
+\brief The mean time of finding the minimum enclosing circle. Sets the circle.
+<P>---------------------------------------------------------------------------*/
+static double TimeCircle(const C2DPointSet& Points, unsigned int nRepeats, C2DCircle& Circle)
+{
+	double dTime = 0;
+	for (unsigned int r = 0; r < nRepeats; r++)
+	{
+		const chrono::steady_clock::time_point Start = chrono::steady_clock::now();
+		Points.GetMinimumEnclosingCircle(Circle);
+		dTime += Milliseconds(Start);
+	}
+	return dTime / nRepeats;
+}
+
+
+int main(int argc, char** argv)
+{
+	const unsigned int nMaxPoints = argc > 1 ? (unsigned int)atoi(argv[1]) : 10000000;
+
+	CRandomGenerator Generator;
+	printf("Mean times of random points in a disc:\n");
+	for (unsigned int nPoints = 1000; nPoints <= nMaxPoints; nPoints *= 10)
+	{
+		C2DPointSet Points;
+		MakeDisc(nPoints, Generator, Points);
+
+		// About a second of work at each size.
+		const unsigned int nRepeats = nPoints >= 1000000 ? 3 : 10000000 / nPoints;
+
+		unsigned int nHullSize = 0;
+		const double dSerial = TimeHull(Points, 1, nRepeats, nHullSize);
+		const double dParallel = TimeHull(Points, 0, nRepeats, nHullSize);
+		C2DCircle Circle;
+		const double dCircle = TimeCircle(Points, nRepeats, Circle);
+
+		printf("%8u points: hull %9.3f ms on 1 thread, %9.3f ms on all (%u points), "
+			"enclosing circle %9.3f ms (radius %.6f)\n", nPoints, dSerial, dParallel,
+			nHullSize, dCircle, Circle.GetRadius());
+	}
+	return 0;
+}
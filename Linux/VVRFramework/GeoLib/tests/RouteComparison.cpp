@@ -0,0 +1,124 @@
+/*---------------------------------------------------------------------------
+Copyright (C) GeoLib.
+This code is used under license from GeoLib (www.geolib.co.uk). This or
+any modified versions of this cannot be resold to any other party.
+---------------------------------------------------------------------------*/
+
+
+/**--------------------------------------------------------------------------<BR>
+\file RouteComparison.cpp
+\brief Compares the route refinements of CTravellingSalesman.
+
+Each set of random points is made into a closed route, from the first point back
+to it, 3 ways: as C2DPolygon::Reorder does, by InsertOptimally into the convex hull
+followed by Refine, and by BuildNearestNeighbour followed by RefineLocalSearch or
+by RefineMultiStart. The length of each route and the time taken are printed.
+
+Build with GEOLIB_TESTS_EXECUTABLE. The optional arguments are the random seed and
+the largest number of points, 10000 by default.
+<P>---------------------------------------------------------------------------*/
+
+#include "GeoLib.h"
+#include "RandomNumber.h"
+#include "TravellingSalesman.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+/// The starts given to RefineMultiStart.
+const unsigned int conStarts = 16;
+
+
+/**--------------------------------------------------------------------------<BR>
+Milliseconds <BR>
+\brief The time since the start in milliseconds.
+<P>---------------------------------------------------------------------------*/
+static double Milliseconds(const chrono::steady_clock::time_point& Start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - Start).count();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+InsertAndRefine <BR>
+\brief Makes the route as C2DPolygon::Reorder does, inserting the points into the
+closed convex hull starting with those nearest the centre and then refining it.
+Returns the length.
+<P>---------------------------------------------------------------------------*/
+static double InsertAndRefine(const C2DPointSet& Input)
+{
+	C2DPointSet Points;
+	Points.AddCopy(Input);
+
+	C2DPointSet Hull;
+	Hull.ExtractConvexHull(Points);
+	Hull.AddCopy(Hull[0]);
+	C2DRect Rect;
+	Hull.GetBoundingRect(Rect);
+	Points.SortByDistance(Rect.GetCentre(), false);
+
+	CTravellingSalesman TS;
+	TS.SetPointsDirect(Hull);
+	while (Points.size() > 0)
+		TS.InsertOptimally(Points.ExtractLast());
+	TS.Refine();
+	return TS.GetLength();
+}
+
+
+/**--------------------------------------------------------------------------<BR>
+NearestAndSearch <BR>
+\brief Makes the route from the first point back to it by the nearest neighbour and
+then refines it by local search, with restarts if nStarts is more than 1. Returns
+the length.
+<P>---------------------------------------------------------------------------*/
+static double NearestAndSearch(const C2DPointSet& Input, unsigned int nStarts)
+{
+	C2DPointSet Points;
+	Points.AddCopy(Input);
+	Points.AddCopy(Input[0]);
+
+	CTravellingSalesman TS;
+	TS.SetPointsDirect(Points);
+	TS.BuildNearestNeighbour();
+	if (nStarts > 1)
+		TS.RefineMultiStart(nStarts);
+	else
+		TS.RefineLocalSearch();
+	return TS.GetLength();
+}
+
+
+int main(int argc, char** argv)
+{
+	CRandomGenerator Generator(argc > 1 ? strtoull(argv[1], 0, 10) : 1);
+	const unsigned int nMaxPoints = argc > 2 ? (unsigned int)atoi(argv[2]) : 10000;
+
+	printf("Route lengths and times of random points in a unit square:\n");
+	const unsigned int Sizes[] = { 100, 300, 1000, 3000, 10000, 30000, 100000 };
+	for (unsigned int s = 0; s < sizeof(Sizes) / sizeof(Sizes[0]) && Sizes[s] <= nMaxPoints; s++)
+	{
+		C2DPointSet Points;
+		for (unsigned int i = 0; i < Sizes[s]; i++)
+			Points.AddCopy(Generator.GetFraction(), Generator.GetFraction());
+
+		chrono::steady_clock::time_point Start = chrono::steady_clock::now();
+		const double dInsert = InsertAndRefine(Points);
+		const double dInsertTime = Milliseconds(Start);
+
+		Start = chrono::steady_clock::now();
+		const double dLocal = NearestAndSearch(Points, 1);
+		const double dLocalTime = Milliseconds(Start);
+
+		Start = chrono::steady_clock::now();
+		const double dMulti = NearestAndSearch(Points, conStarts);
+		const double dMultiTime = Milliseconds(Start);
+
+		printf("%6u points: InsertOptimally + Refine %9.3f in %9.1f ms, "
+			"RefineLocalSearch %9.3f in %9.1f ms, RefineMultiStart(%u) %9.3f in %9.1f ms\n",
+			Sizes[s], dInsert, dInsertTime, dLocal, dLocalTime, conStarts, dMulti, dMultiTime);
+	}
+	return 0;
+}
@@ -316,6 +316,11 @@ endif()
 if (MATH_TESTS_EXECUTABLE)
 	add_definitions(-DMATH_TESTS_EXECUTABLE)
 
+	# Also build the benchmarks that take minutes and gigabytes of memory to run.
+	if (MATH_LARGE_BENCHMARKS)
+		add_definitions(-DMATH_LARGE_BENCHMARKS)
+	endif()
+
 	if (BUILD_FOR_GCOV)
 		if (IS_GCC_LIKE)
 			add_definitions(-fprofile-arcs -ftest-coverage)
@@ -14,14 +14,32 @@
 
 /** @file GJK.cpp
 	@author Jukka Jylnki
-	@brief Implementation of the Gilbert-Johnson-Keerthi (GJK) convex polyhedron intersection test. */
+	@brief Implementation of the Gilbert-Johnson-Keerthi (GJK) convex polyhedron intersection test, distance query
+		and Expanding Polytope Algorithm (EPA) penetration query. */
 #include "GJK.h"
 #include "../Geometry/LineSegment.h"
 #include "../Geometry/Triangle.h"
 #include "../Geometry/Plane.h"
+#include "../Math/MathFunc.h"
+
+// The closest point of the GJK simplex to the origin is solved in double precision. The simplices near the end of
+// the search are nearly degenerate, and in single precision the search stalls before it reaches the closest point.
+#define MATH_GJK_DOUBLE_PRECISION
+
+#ifdef MATH_GJK_DOUBLE_PRECISION
+#include "../Math/float4d.h"
+#endif
 
 MATH_BEGIN_NAMESPACE
 
+#ifdef MATH_GJK_DOUBLE_PRECISION
+typedef float4d cv;
+typedef double cs;
+#else
+typedef vec cv;
+typedef float cs;
+#endif
+
 /// This function examines the simplex defined by the array of points in s, and calculates which voronoi region
 /// of that simplex the origin is closest to. Based on that information, the function constructs a new simplex
 /// that will be used to continue the search, and returns a new search direction for the GJK algorithm.
@@ -347,4 +365,528 @@ vec UpdateSimplex(vec *s, int &n)
 	}
 }
 
+/// A point of a GJK simplex or an EPA polytope.
+struct GJKVertex
+{
+	vec p; ///< The support point of the Minkowski difference, a - b.
+	vec a; ///< The support point of the first object.
+	vec b; ///< The support point of the second object.
+	vec dir; ///< The search direction that produced this point.
+};
+
+static const int maxGJKIterations = 64;
+static const int maxEPAIterations = 64;
+static const int maxEPAVertices = 4 + maxEPAIterations;
+static const int maxEPAFaces = 2 * maxEPAVertices; // A convex polytope of V vertices has 2*V-4 triangles.
+
+static GJKVertex SupportVertex(GJKSupportFunc support, const void *a, const void *b, const vec &dir)
+{
+	GJKVertex v;
+	v.p = support(a, b, dir, v.a, v.b);
+	v.dir = dir;
+	return v;
+}
+
+#ifdef MATH_GJK_DOUBLE_PRECISION
+static inline cv ToCv(const vec &v) { return cv(DIR_TO_FLOAT4(v)); }
+static inline vec FromCv(const cv &v) { return FLOAT4_TO_DIR(v.ToFloat4()); }
+#else
+static inline cv ToCv(const vec &v) { return v; }
+static inline vec FromCv(const cv &v) { return v; }
+#endif
+
+/// The point of a sub-simplex closest to the origin.
+struct SimplexClosestPoint
+{
+	int idx[4]; ///< The indices of the points of the sub-simplex.
+	float w[4]; ///< The barycentric coordinates of the closest point with respect to the sub-simplex.
+	int n; ///< The number of points in the sub-simplex.
+	cv p;
+	cs distSq;
+};
+
+static void ClosestPointOnSegment(const cv *s, int i, int j, SimplexClosestPoint &r)
+{
+	cv ab = s[j] - s[i];
+	cs lenSq = ab.Dot(ab);
+	cs t = (lenSq > 0) ? -s[i].Dot(ab) / lenSq : 0;
+	if (t <= 0)
+	{
+		r.n = 1; r.idx[0] = i; r.w[0] = 1.f;
+		r.p = s[i];
+	}
+	else if (t >= 1)
+	{
+		r.n = 1; r.idx[0] = j; r.w[0] = 1.f;
+		r.p = s[j];
+	}
+	else
+	{
+		r.n = 2; r.idx[0] = i; r.idx[1] = j; r.w[0] = (float)(1 - t); r.w[1] = (float)t;
+		r.p = s[i] + t * ab;
+	}
+	r.distSq = r.p.Dot(r.p);
+}
+
+/// Finds the point of the triangle s[i], s[j], s[k] closest to the origin.
+/** The barycentric coordinates of the projection of the origin to the plane of the triangle are computed from the
+	signed areas of the triangles that the origin forms with each edge. Unlike the dot product formulation of the
+	voronoi region tests, this does not lose precision when the triangle is long and thin, as the simplices of
+	the Minkowski difference of two thin boxes are. */
+static void ClosestPointOnTriangle(const cv *s, int i, int j, int k, SimplexClosestPoint &r)
+{
+	const cv &a = s[i];
+	const cv &b = s[j];
+	const cv &c = s[k];
+	cv ab = b - a;
+	cv ac = c - a;
+	cv normal = ab.Cross(ac);
+	cs normalLengthSq = normal.Dot(normal);
+	if (normalLengthSq > (cs)1e-12 * ab.Dot(ab) * ac.Dot(ac))
+	{
+		cs wa = b.Cross(c).Dot(normal);
+		cs wb = c.Cross(a).Dot(normal);
+		cs wc = a.Cross(b).Dot(normal);
+		if (wa >= 0 && wb >= 0 && wc >= 0)
+		{
+			cs invSum = 1 / normalLengthSq;
+			r.n = 3; r.idx[0] = i; r.idx[1] = j; r.idx[2] = k;
+			r.w[0] = (float)(wa * invSum); r.w[1] = (float)(wb * invSum); r.w[2] = 1.f - r.w[0] - r.w[1];
+			r.p = (a.Dot(normal) * invSum) * normal;
+			r.distSq = r.p.Dot(r.p);
+			return;
+		}
+	}
+
+	// The origin projects outside the triangle, or the triangle is degenerate. The closest point is on one of its edges.
+	ClosestPointOnSegment(s, i, j, r);
+	SimplexClosestPoint r2;
+	ClosestPointOnSegment(s, j, k, r2);
+	if (r2.distSq < r.distSq)
+		r = r2;
+	ClosestPointOnSegment(s, i, k, r2);
+	if (r2.distSq < r.distSq)
+		r = r2;
+}
+
+/// Computes the point of the simplex s closest to the origin, and reduces s to the smallest sub-simplex that contains it.
+/** @param outLambda [out] Receives the barycentric coordinates of the closest point with respect to the reduced simplex.
+	@return True if the origin is inside the tetrahedron s. */
+static bool ClosestPointOfSimplex(GJKVertex *s, int &n, float *outLambda, vec &outClosestPoint)
+{
+	if (n == 1)
+	{
+		outLambda[0] = 1.f;
+		outClosestPoint = s[0].p;
+		return false;
+	}
+
+	cv p[4];
+	for(int i = 0; i < n; ++i)
+		p[i] = ToCv(s[i].p);
+	SimplexClosestPoint r;
+	if (n == 2)
+		ClosestPointOnSegment(p, 0, 1, r);
+	else if (n == 3)
+		ClosestPointOnTriangle(p, 0, 1, 2, r);
+	else
+	{
+		assert(n == 4);
+		// The origin is inside the tetrahedron if it is on the same side of each face as the opposite vertex.
+		// Otherwise the closest point is the closest of the closest points of the faces. All the faces are tested
+		// instead of only the ones the origin is outside of, since the side tests are not reliable for the nearly
+		// flat tetrahedra that GJK produces when converging on curved objects.
+		static const int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 3, 1 }, { 1, 2, 3, 0 } };
+		cv ab = p[1] - p[0];
+		cv ac = p[2] - p[0];
+		cv ad = p[3] - p[0];
+		cs volume = ad.Dot(ab.Cross(ac));
+		bool inside = volume * volume > (cs)1e-12 * ab.Dot(ab) * ac.Dot(ac) * ad.Dot(ad);
+		r.distSq = FLOAT_INF;
+		for(int i = 0; i < 4; ++i)
+		{
+			const cv &v0 = p[faces[i][0]];
+			cv normal = (p[faces[i][1]] - v0).Cross(p[faces[i][2]] - v0);
+			cs sideOrigin = -v0.Dot(normal);
+			cs sideOpposite = (p[faces[i][3]] - v0).Dot(normal);
+			if (sideOrigin * sideOpposite < 0)
+				inside = false;
+			SimplexClosestPoint f;
+			ClosestPointOnTriangle(p, faces[i][0], faces[i][1], faces[i][2], f);
+			if (f.distSq < r.distSq)
+				r = f;
+		}
+		if (inside)
+		{
+			outClosestPoint = vec::zero;
+			return true;
+		}
+	}
+
+	GJKVertex reduced[4];
+	for(int i = 0; i < r.n; ++i)
+	{
+		reduced[i] = s[r.idx[i]];
+		outLambda[i] = r.w[i];
+	}
+	for(int i = 0; i < r.n; ++i)
+		s[i] = reduced[i];
+	n = r.n;
+	outClosestPoint = FromCv(r.p);
+	return false;
+}
+
+/// Runs GJK on the Minkowski difference a-b.
+/** @param s [out] Receives the final simplex. Must have room for 4 points.
+	@param n [out] Receives the number of points in s.
+	@return True if the objects intersect. */
+static bool RunGJK(GJKSupportFunc support, const void *a, const void *b, const vec &initialDirection, const GJKSimplex *warmStart,
+	GJKVertex *s, int &n, vec &outPointA, vec &outPointB)
+{
+	n = 0;
+	if (warmStart)
+		for(int i = 0; i < warmStart->numPoints; ++i)
+		{
+			GJKVertex w = SupportVertex(support, a, b, warmStart->directions[i]);
+			bool duplicate = false;
+			for(int j = 0; j < n; ++j)
+				if (w.p.DistanceSq(s[j].p) <= 1e-12f)
+					duplicate = true;
+			if (!duplicate)
+				s[n++] = w;
+		}
+	if (n == 0)
+		s[n++] = SupportVertex(support, a, b, initialDirection.LengthSq() > 1e-12f ? initialDirection : DIR_VEC(1.f, 0.f, 0.f));
+
+	float lambda[4];
+	vec v;
+	float prevDistSq = FLOAT_INF;
+	bool intersects = false;
+	for(int iter = 0; iter < maxGJKIterations; ++iter)
+	{
+		if (ClosestPointOfSimplex(s, n, lambda, v))
+		{
+			intersects = true;
+			break;
+		}
+		float distSq = v.LengthSq();
+		float maxLengthSq = 0.f;
+		for(int i = 0; i < n; ++i)
+			maxLengthSq = Max(maxLengthSq, s[i].p.LengthSq());
+		if (distSq <= 1e-9f * maxLengthSq)
+		{
+			// The origin is on the simplex, up to the floating point precision of its points: the objects touch.
+			intersects = true;
+			break;
+		}
+		if (distSq >= prevDistSq)
+			break; // No more progress can be made at this floating point precision.
+		prevDistSq = distSq;
+
+		GJKVertex w = SupportVertex(support, a, b, -v);
+		// If the new support point does not get any closer to the origin in the search direction, v is the closest
+		// point of the Minkowski difference.
+		if (distSq - Dot(v, w.p) <= 1e-5f * distSq)
+			break;
+		bool duplicate = false;
+		for(int j = 0; j < n; ++j)
+			if (w.p.DistanceSq(s[j].p) <= 1e-12f)
+				duplicate = true;
+		if (duplicate || iter + 1 == maxGJKIterations)
+			break;
+		s[n++] = w;
+	}
+
+	if (intersects && n == 4)
+	{
+		// Report the centroid of the simplex as a common point of the objects, if EPA is not run.
+		outPointA = 0.25f * (s[0].a + s[1].a + s[2].a + s[3].a);
+		outPointB = outPointA;
+		return true;
+	}
+	outPointA = lambda[0] * s[0].a;
+	outPointB = lambda[0] * s[0].b;
+	for(int i = 1; i < n; ++i)
+	{
+		outPointA += lambda[i] * s[i].a;
+		outPointB += lambda[i] * s[i].b;
+	}
+	if (intersects)
+		outPointB = outPointA;
+	return intersects;
+}
+
+/// A triangle of the EPA polytope. The vertices are in counter-clockwise order when viewed from outside.
+struct EPAFace
+{
+	int v[3];
+	int adj[3]; ///< The face on the other side of the edge v[i] -> v[(i+1)%3].
+	int adjEdge[3]; ///< The index of that edge in the adjacent face.
+	vec normal; ///< The outward unit normal.
+	float dist; ///< The distance of the plane of this face from the origin.
+	bool removed;
+};
+
+static bool MakeEPAFace(const GJKVertex *verts, int i, int j, int k, EPAFace &face)
+{
+	face.v[0] = i;
+	face.v[1] = j;
+	face.v[2] = k;
+	face.removed = false;
+	vec normal = Cross(verts[j].p - verts[i].p, verts[k].p - verts[i].p);
+	float len = normal.Length();
+	if (!(len > 1e-12f))
+		return false;
+	face.normal = normal / len;
+	face.dist = Dot(face.normal, verts[i].p);
+	return true;
+}
+
+/// Links the edge e of face f and the edge e2 of face f2 as adjacent.
+static void LinkEPAFaces(EPAFace *faces, int f, int e, int f2, int e2)
+{
+	faces[f].adj[e] = f2;
+	faces[f].adjEdge[e] = e2;
+	faces[f2].adj[e2] = f;
+	faces[f2].adjEdge[e2] = e;
+}
+
+/// Removes the faces of the EPA polytope that the point w sees, starting from the edge e of face f, and collects
+/// the edges of the hole that they leave, the horizon, as (face, edge) pairs of the faces that remain.
+/** Walking the faces depth-first from the closest face removes only the faces connected to it, so that the hole
+	stays a topological disk even if floating point imprecision makes some other face appear visible. The faces
+	that w is within epsilon of the plane of are removed as well, as w could be on the line of one of their edges,
+	which would give a degenerate new face. */
+static void EPASilhouette(EPAFace *faces, const GJKVertex *verts, int f, int e, const vec &w, float epsilon, int (*horizon)[2], int &numHorizon, int *freeFaces, int &numFreeFaces)
+{
+	EPAFace &face = faces[f];
+	if (face.removed)
+		return;
+	if (Dot(face.normal, w - verts[face.v[0]].p) <= -epsilon)
+	{
+		horizon[numHorizon][0] = f;
+		horizon[numHorizon][1] = e;
+		++numHorizon;
+		return;
+	}
+	face.removed = true;
+	freeFaces[numFreeFaces++] = f;
+	EPASilhouette(faces, verts, face.adj[(e+1)%3], face.adjEdge[(e+1)%3], w, epsilon, horizon, numHorizon, freeFaces, numFreeFaces);
+	EPASilhouette(faces, verts, face.adj[(e+2)%3], face.adjEdge[(e+2)%3], w, epsilon, horizon, numHorizon, freeFaces, numFreeFaces);
+}
+
+/// Extends the simplex s of n points that contains the origin into a tetrahedron.
+/** @return False if the Minkowski difference is flat around the origin, i.e. the objects only touch. */
+static bool ExtendToTetrahedron(GJKSupportFunc support, const void *a, const void *b, GJKVertex *s, int &n)
+{
+	const vec axes[3] = { DIR_VEC(1.f, 0.f, 0.f), DIR_VEC(0.f, 1.f, 0.f), DIR_VEC(0.f, 0.f, 1.f) };
+	if (n == 1)
+	{
+		for(int i = 0; i < 6 && n == 1; ++i)
+		{
+			GJKVertex w = SupportVertex(support, a, b, (i & 1) ? -axes[i/2] : axes[i/2]);
+			if (w.p.DistanceSq(s[0].p) > 1e-8f)
+				s[n++] = w;
+		}
+		if (n == 1)
+			return false;
+	}
+	if (n == 2)
+	{
+		vec e = s[1].p - s[0].p;
+		int minAxis = (Abs(e.x) < Abs(e.y)) ? (Abs(e.x) < Abs(e.z) ? 0 : 2) : (Abs(e.y) < Abs(e.z) ? 1 : 2);
+		vec perp1 = Cross(e, axes[minAxis]);
+		vec perp2 = Cross(e, perp1);
+		const vec dirs[4] = { perp1, -perp1, perp2, -perp2 };
+		float eLenSq = e.LengthSq();
+		for(int i = 0; i < 4 && n == 2; ++i)
+		{
+			GJKVertex w = SupportVertex(support, a, b, dirs[i]);
+			if (Cross(e, w.p - s[0].p).LengthSq() > 1e-8f * eLenSq)
+				s[n++] = w;
+		}
+		if (n == 2)
+			return false;
+	}
+	if (n == 3)
+	{
+		vec normal = Cross(s[1].p - s[0].p, s[2].p - s[0].p);
+		float normalLen = normal.Length();
+		if (!(normalLen > 0.f))
+			return false;
+		for(int i = 0; i < 2 && n == 3; ++i)
+		{
+			GJKVertex w = SupportVertex(support, a, b, i ? -normal : normal);
+			if (Abs(Dot(w.p - s[0].p, normal)) > 1e-4f * normalLen)
+				s[n++] = w;
+		}
+		if (n == 3)
+			return false;
+	}
+	return true;
+}
+
+/// Runs EPA on the Minkowski difference a-b, starting from the simplex s of n points that contains the origin.
+static bool RunEPA(GJKSupportFunc support, const void *a, const void *b, const GJKVertex *s, int n,
+	vec &outNormal, float &outDepth, vec &outPointA, vec &outPointB)
+{
+	GJKVertex verts[maxEPAVertices];
+	for(int i = 0; i < n; ++i)
+		verts[i] = s[i];
+	if (!ExtendToTetrahedron(support, a, b, verts, n))
+		return false;
+
+	// Wind the faces of the tetrahedron counter-clockwise when viewed from outside.
+	if (Dot(verts[3].p - verts[0].p, Cross(verts[1].p - verts[0].p, verts[2].p - verts[0].p)) > 0.f)
+		Swap(verts[0], verts[1]);
+	EPAFace faces[maxEPAFaces];
+	int numFaces = 4; // The number of face slots in use, including removed faces.
+	int numVerts = 4;
+	if (!MakeEPAFace(verts, 0, 1, 2, faces[0]) || !MakeEPAFace(verts, 0, 3, 1, faces[1])
+		|| !MakeEPAFace(verts, 0, 2, 3, faces[2]) || !MakeEPAFace(verts, 1, 3, 2, faces[3]))
+		return false;
+	LinkEPAFaces(faces, 0, 0, 1, 2);
+	LinkEPAFaces(faces, 0, 1, 3, 2);
+	LinkEPAFaces(faces, 0, 2, 2, 0);
+	LinkEPAFaces(faces, 1, 0, 2, 2);
+	LinkEPAFaces(faces, 1, 1, 3, 0);
+	LinkEPAFaces(faces, 2, 1, 3, 1);
+
+	int freeFaces[maxEPAFaces];
+	int numFreeFaces = 0;
+	// The closest face is a lower bound on the penetration depth, and the support distance in the direction of its
+	// normal an upper bound, which separates the objects when moved along that normal. On a curved shape, the bounds
+	// may not meet before the iteration limit, so report the face that gave the smallest upper bound.
+	EPAFace face = faces[0];
+	float supportDist = FLOAT_INF;
+	for(int iter = 0; ; ++iter)
+	{
+		int closest = -1;
+		for(int i = 0; i < numFaces; ++i)
+			if (!faces[i].removed && (closest < 0 || faces[i].dist < faces[closest].dist))
+				closest = i;
+
+		GJKVertex w = SupportVertex(support, a, b, faces[closest].normal);
+		float d = Dot(w.p, faces[closest].normal);
+		if (d < supportDist)
+		{
+			face = faces[closest];
+			supportDist = d;
+		}
+		// If the new support point does not reach farther than the closest face, that face is on the boundary
+		// of the Minkowski difference.
+		if (supportDist - faces[closest].dist <= 1e-4f * Max(1.f, supportDist)
+			|| iter >= maxEPAIterations || numVerts >= maxEPAVertices)
+			break;
+		verts[numVerts] = w;
+
+		// Remove the faces that the new point sees, and close the hole with a fan of faces from its horizon
+		// to the new point.
+		int horizon[maxEPAFaces][2];
+		int numHorizon = 0;
+		faces[closest].removed = true;
+		freeFaces[numFreeFaces++] = closest;
+		for(int e = 0; e < 3; ++e)
+			EPASilhouette(faces, verts, faces[closest].adj[e], faces[closest].adjEdge[e], w.p, 1e-5f * Max(1.f, d), horizon, numHorizon, freeFaces, numFreeFaces);
+
+		int newFaces[maxEPAFaces];
+		bool ok = true;
+		for(int h = 0; h < numHorizon && ok; ++h)
+		{
+			if (numFreeFaces == 0 && numFaces == maxEPAFaces)
+			{
+				ok = false;
+				break;
+			}
+			newFaces[h] = (numFreeFaces > 0) ? freeFaces[--numFreeFaces] : numFaces++;
+			const EPAFace &neighbor = faces[horizon[h][0]];
+			int e = horizon[h][1];
+			ok = MakeEPAFace(verts, neighbor.v[(e+1)%3], neighbor.v[e], numVerts, faces[newFaces[h]]);
+			LinkEPAFaces(faces, newFaces[h], 0, horizon[h][0], e);
+		}
+		// Link the new faces to each other: the edge v[1] -> w of each is the edge w -> v[0] of another.
+		for(int h = 0; h < numHorizon && ok; ++h)
+		{
+			int next = -1;
+			for(int h2 = 0; h2 < numHorizon; ++h2)
+				if (faces[newFaces[h2]].v[0] == faces[newFaces[h]].v[1])
+					next = h2;
+			ok = (next >= 0);
+			if (ok)
+				LinkEPAFaces(faces, newFaces[h], 1, newFaces[next], 2);
+		}
+		// A degenerate new face means that the polytope cannot be expanded further at this floating point
+		// precision. Report the closest face so far.
+		if (!ok)
+			break;
+		++numVerts;
+	}
+
+	outNormal = face.normal;
+	outDepth = Max(0.f, supportDist);
+
+	// Express the point of the closest face nearest to the origin in barycentric coordinates of the face, and
+	// map it to the points of the objects.
+	const GJKVertex &v0 = verts[face.v[0]];
+	const GJKVertex &v1 = verts[face.v[1]];
+	const GJKVertex &v2 = verts[face.v[2]];
+	vec p = face.normal * Max(0.f, face.dist);
+	vec e0 = v1.p - v0.p;
+	vec e1 = v2.p - v0.p;
+	vec e2 = p - v0.p;
+	float d00 = Dot(e0, e0);
+	float d01 = Dot(e0, e1);
+	float d11 = Dot(e1, e1);
+	float d20 = Dot(e2, e0);
+	float d21 = Dot(e2, e1);
+	float denom = d00 * d11 - d01 * d01;
+	float u = 0.f, v = 0.f;
+	if (denom > 0.f)
+	{
+		u = Clamp01((d11 * d20 - d01 * d21) / denom);
+		v = Clamp01((d00 * d21 - d01 * d20) / denom);
+		if (u + v > 1.f)
+		{
+			float sum = u + v;
+			u /= sum;
+			v /= sum;
+		}
+	}
+	outPointA = (1.f - u - v) * v0.a + u * v1.a + v * v2.a;
+	outPointB = (1.f - u - v) * v0.b + u * v1.b + v * v2.b;
+	return true;
+}
+
+GJKContact GJKComputeContact(GJKSupportFunc support, const void *a, const void *b, const vec &initialDirection, bool computePenetration, GJKSimplex *simplex)
+{
+	GJKVertex s[4];
+	int n;
+	GJKContact contact;
+	contact.intersects = RunGJK(support, a, b, initialDirection, simplex, s, n, contact.pointA, contact.pointB);
+	if (simplex)
+	{
+		simplex->numPoints = n;
+		for(int i = 0; i < n; ++i)
+			simplex->directions[i] = s[i].dir;
+	}
+
+	if (!contact.intersects)
+	{
+		vec d = contact.pointB - contact.pointA;
+		contact.distance = d.Length();
+		contact.normal = (contact.distance > 0.f) ? d / contact.distance : DIR_VEC(1.f, 0.f, 0.f);
+		return contact;
+	}
+
+	contact.distance = 0.f;
+	contact.normal = DIR_VEC(1.f, 0.f, 0.f);
+	if (computePenetration)
+	{
+		float depth;
+		if (RunEPA(support, a, b, s, n, contact.normal, depth, contact.pointA, contact.pointB))
+			contact.distance = -depth;
+	}
+	return contact;
+}
+
 MATH_END_NAMESPACE
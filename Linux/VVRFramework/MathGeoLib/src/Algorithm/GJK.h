@@ -14,7 +14,8 @@
 
 /** @file GJK.h
 	@author Jukka Jylanki
-	@brief Implementation of the Gilbert-Johnson-Keerthi (GJK) convex polyhedron intersection test. */
+	@brief Implementation of the Gilbert-Johnson-Keerthi (GJK) convex polyhedron intersection test, distance query
+		and Expanding Polytope Algorithm (EPA) penetration query. */
 #pragma once
 
 #include "../MathGeoLibFwd.h"
@@ -60,4 +61,121 @@ bool GJKIntersect(const A &a, const B &b)
 	return false; // Report no intersection.
 }
 
+/// The simplex that a GJK query ended with, for warm-starting the next query of the same pair of objects.
+/** Pass the same GJKSimplex to each query of a pair of objects, e.g. once per frame of a physics simulation.
+	The query then starts from the support points in the directions that ended the previous query, which
+	converges in fewer iterations when the objects have moved only a little since. A default-constructed
+	GJKSimplex makes the query start from scratch. */
+struct GJKSimplex
+{
+	GJKSimplex():numPoints(0) {}
+
+	/// The search directions that produced the points of the simplex.
+	vec directions[4];
+	/// The number of points in the simplex, [0, 4].
+	int numPoints;
+};
+
+/// The result of GJKComputeContact().
+struct GJKContact
+{
+	/// The distance between the two objects, or if they intersect, the negated penetration depth.
+	float distance;
+	/// The unit direction from the first object towards the second. If the objects intersect, moving the second
+	/// object by normal * -distance separates them.
+	vec normal;
+	/// The point of the first object closest to the second, or if the objects intersect, the point of the first
+	/// object deepest inside the second.
+	vec pointA;
+	/// The point of the second object closest to the first, or if the objects intersect, the point of the second
+	/// object deepest inside the first. pointB - pointA == normal * distance.
+	vec pointB;
+	/// True if the objects intersect.
+	bool intersects;
+};
+
+/// Computes the support point of the Minkowski difference a-b in the given direction.
+/** @param outPointA [out] Receives the extreme point of a in the given direction.
+	@param outPointB [out] Receives the extreme point of b in the opposite direction.
+	@return outPointA - outPointB. */
+typedef vec (*GJKSupportFunc)(const void *a, const void *b, const vec &direction, vec &outPointA, vec &outPointB);
+
+template<typename A, typename B>
+vec GJKSupport(const void *a, const void *b, const vec &direction, vec &outPointA, vec &outPointB)
+{
+	float maxS, minS;
+	outPointA = reinterpret_cast<const A*>(a)->ExtremePoint(direction, maxS);
+	outPointB = reinterpret_cast<const B*>(b)->ExtremePoint(-direction, minS);
+	return outPointA - outPointB;
+}
+
+/// Runs GJK on the Minkowski difference of a and b given by the support function, and if the objects intersect, EPA.
+/** This is the type-independent implementation of GJKDistance() and GJKComputeContact().
+	@param initialDirection The direction to search for the first support point, if simplex is null or empty.
+	@param computePenetration If true and the objects intersect, runs EPA to compute the penetration depth, normal and points.
+	@param simplex [in, out] If not null, warm-starts the query and receives the simplex the query ended with. */
+GJKContact GJKComputeContact(GJKSupportFunc support, const void *a, const void *b, const vec &initialDirection, bool computePenetration, GJKSimplex *simplex);
+
+/// Computes the distance between the two convex objects a and b, and their closest points.
+/** Unlike GJKIntersect(), this function does not assert if GJK does not converge, but returns the best result found.
+	@param outClosestPointA [out] Receives the point of a closest to b.
+	@param outClosestPointB [out] Receives the point of b closest to a.
+	@param simplex [in, out] If not null, warm-starts the query from the simplex of the previous query of these objects,
+		and receives the simplex of this query.
+	@return The distance between a and b, or 0 if they intersect. If they intersect, the closest points are
+		some common point of both.
+	@see GJKComputeContact(), GJKSimplex. */
+template<typename A, typename B>
+float GJKDistance(const A &a, const B &b, vec &outClosestPointA, vec &outClosestPointB, GJKSimplex *simplex = 0)
+{
+	GJKContact contact = GJKComputeContact(&GJKSupport<A, B>, &a, &b, b.AnyPointFast() - a.AnyPointFast(), false, simplex);
+	outClosestPointA = contact.pointA;
+	outClosestPointB = contact.pointB;
+	return contact.distance;
+}
+
+/// Computes the penetration depth and normal of the two convex objects a and b with the Expanding Polytope Algorithm.
+/** @param outNormal [out] Receives the unit direction that the object b must be moved to separate it from a.
+	@param outDepth [out] Receives the distance that the object b must be moved to separate it from a.
+	@param outPointA [out] Receives the point of a deepest inside b.
+	@param outPointB [out] Receives the point of b deepest inside a.
+	@param simplex [in, out] If not null, warm-starts the query. See GJKSimplex.
+	@return True if a and b intersect. If false, the outputs are not written to.
+	@see GJKComputeContact(). */
+template<typename A, typename B>
+bool EPAPenetration(const A &a, const B &b, vec &outNormal, float &outDepth, vec &outPointA, vec &outPointB, GJKSimplex *simplex = 0)
+{
+	GJKContact contact = GJKComputeContact(&GJKSupport<A, B>, &a, &b, b.AnyPointFast() - a.AnyPointFast(), true, simplex);
+	if (!contact.intersects)
+		return false;
+	outNormal = contact.normal;
+	outDepth = -contact.distance;
+	outPointA = contact.pointA;
+	outPointB = contact.pointB;
+	return true;
+}
+
+/// Computes the contact between the two convex objects a and b: their distance and closest points if they are
+/// separated, or their penetration depth and deepest points if they intersect.
+/** The types A and B can be any of AABB, OBB, Sphere, Capsule, LineSegment, Triangle, Polygon, Polyhedron and Frustum.
+	@param simplex [in, out] If not null, warm-starts the query. See GJKSimplex.
+	@see GJKDistance(), EPAPenetration(), GJKComputeContacts(). */
+template<typename A, typename B>
+GJKContact GJKComputeContact(const A &a, const B &b, GJKSimplex *simplex = 0)
+{
+	return GJKComputeContact(&GJKSupport<A, B>, &a, &b, b.AnyPointFast() - a.AnyPointFast(), true, simplex);
+}
+
+/// Computes the contacts of the pairs of objects (a[i], b[i]), i in [0, numPairs[.
+/** @param outContacts [out] Receives the contact of each pair. Must have room for numPairs contacts.
+	@param simplices [in, out] If not null, an array of numPairs simplices that warm-start the query of each pair
+		and receive the simplex of each pair for the next call, e.g. on the next frame.
+	@see GJKComputeContact(). */
+template<typename A, typename B>
+void GJKComputeContacts(const A *a, const B *b, int numPairs, GJKContact *outContacts, GJKSimplex *simplices = 0)
+{
+	for(int i = 0; i < numPairs; ++i)
+		outContacts[i] = GJKComputeContact(&GJKSupport<A, B>, a+i, b+i, b[i].AnyPointFast() - a[i].AnyPointFast(), true, simplices ? simplices+i : 0);
+}
+
 MATH_END_NAMESPACE
@@ -0,0 +1,184 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file ThreadPool.cpp
+	@author Jukka Jylnki
+	@brief A pool of worker threads that run the iterations of parallel loops. */
+#include "ThreadPool.h"
+#include "../Math/myassert.h"
+
+#ifndef MATH_NO_THREADS
+#include <atomic>
+#endif
+
+MATH_BEGIN_NAMESPACE
+
+#ifndef MATH_NO_THREADS
+
+/// The iterations [begin, end[ that a thread has left, packed into one 64-bit word as (begin << 32) | end.
+/** The owner takes iterations from the front and thieves take them from the back, both with a compare-and-swap
+	of the whole range. Each range is on its own cache line, so that the threads do not contend on them. */
+struct ThreadPool::TaskRange
+{
+	std::atomic<u64> range;
+	char padding[64 - sizeof(std::atomic<u64>)];
+
+	static u64 Pack(u32 begin, u32 end) { return ((u64)begin << 32) | end; }
+	static u32 Begin(u64 range) { return (u32)(range >> 32); }
+	static u32 End(u64 range) { return (u32)range; }
+};
+
+ThreadPool::ThreadPool(int numThreads_)
+:numThreads(numThreads_ > 0 ? numThreads_ : (int)std::thread::hardware_concurrency()),
+task(0), context(0), generation(0), numBusy(0), quit(false)
+{
+	if (numThreads <= 0)
+		numThreads = 1; // hardware_concurrency() returns 0 if it cannot tell.
+	ranges = new TaskRange[numThreads];
+	for(int i = 0; i < numThreads; ++i)
+		ranges[i].range.store(0);
+	for(int i = 1; i < numThreads; ++i)
+		threads.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for(size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+	delete[] ranges;
+}
+
+void ThreadPool::ParallelFor(int numTasks, TaskFunc task_, void *context_)
+{
+	if (numTasks <= 0)
+		return;
+	if (numThreads == 1 || numTasks == 1)
+	{
+		for(int i = 0; i < numTasks; ++i)
+			task_(context_, i);
+		return;
+	}
+
+	std::lock_guard<std::mutex> run(runMutex);
+	for(int i = 0; i < numThreads; ++i)
+		ranges[i].range.store(TaskRange::Pack((u32)((s64)numTasks * i / numThreads), (u32)((s64)numTasks * (i+1) / numThreads)));
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = task_;
+		context = context_;
+		numBusy = numThreads - 1;
+		++generation;
+	}
+	wake.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while(numBusy > 0)
+		done.wait(lock);
+}
+
+void ThreadPool::WorkerMain(int threadIndex)
+{
+	u64 seenGeneration = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	for(;;)
+	{
+		while(!quit && generation == seenGeneration)
+			wake.wait(lock);
+		if (quit)
+			return;
+		seenGeneration = generation;
+
+		lock.unlock();
+		RunTasks(threadIndex);
+		lock.lock();
+
+		if (--numBusy == 0)
+			done.notify_one();
+	}
+}
+
+void ThreadPool::RunTasks(int threadIndex)
+{
+	std::atomic<u64> &own = ranges[threadIndex].range;
+	for(;;)
+	{
+		// Run the iterations of our own range, front to back.
+		u64 r = own.load();
+		while(TaskRange::Begin(r) < TaskRange::End(r))
+		{
+			if (own.compare_exchange_weak(r, TaskRange::Pack(TaskRange::Begin(r) + 1, TaskRange::End(r))))
+			{
+				task(context, (int)TaskRange::Begin(r));
+				r = own.load();
+			}
+		}
+
+		// Steal the back half of the iterations of another thread. No one steals from our range while it is empty,
+		// so the stolen iterations can be stored into it directly.
+		bool stole = false;
+		for(int i = 1; i < numThreads && !stole; ++i)
+		{
+			std::atomic<u64> &victim = ranges[(threadIndex + i) % numThreads].range;
+			u64 v = victim.load();
+			while(TaskRange::Begin(v) < TaskRange::End(v))
+			{
+				u32 begin = TaskRange::Begin(v);
+				u32 end = TaskRange::End(v);
+				u32 newEnd = end - (end - begin + 1) / 2;
+				if (victim.compare_exchange_weak(v, TaskRange::Pack(begin, newEnd)))
+				{
+					own.store(TaskRange::Pack(newEnd, end));
+					stole = true;
+					break;
+				}
+			}
+		}
+		if (!stole)
+			return;
+	}
+}
+
+#else
+
+ThreadPool::ThreadPool(int)
+:numThreads(1)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+}
+
+void ThreadPool::ParallelFor(int numTasks, TaskFunc task, void *context)
+{
+	for(int i = 0; i < numTasks; ++i)
+		task(context, i);
+}
+
+#endif
+
+ThreadPool &ThreadPool::Default()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+MATH_END_NAMESPACE
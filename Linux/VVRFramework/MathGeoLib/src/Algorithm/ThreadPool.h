@@ -0,0 +1,97 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file ThreadPool.h
+	@author Jukka Jylnki
+	@brief A pool of worker threads that run the iterations of parallel loops. */
+#pragma once
+
+#include "../MathBuildConfig.h"
+#include "../MathGeoLibFwd.h"
+#include "../Math/MathTypes.h"
+
+#ifndef MATH_NO_THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#endif
+
+MATH_BEGIN_NAMESPACE
+
+/// A pool of worker threads that run the iterations of parallel loops.
+/** ParallelFor() splits the iterations evenly over the threads. A thread that runs out of iterations steals
+	half of the remaining iterations of another thread, so the threads stay busy even if some iterations
+	take much longer than others. The thread that calls ParallelFor() runs iterations too.
+	If MATH_NO_THREADS is defined, all iterations run on the calling thread. */
+class ThreadPool
+{
+public:
+	/// @param numThreads The number of threads that run the iterations, counting the thread that calls ParallelFor().
+	///	If 0, one thread is used for each hardware thread.
+	explicit ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	/// Returns the number of threads that run the iterations, counting the thread that calls ParallelFor().
+	int NumThreads() const { return numThreads; }
+
+	/// The function that runs a single iteration of a loop.
+	typedef void (*TaskFunc)(void *context, int taskIndex);
+
+	/// Calls task(context, i) for each i in [0, numTasks[, spread over the threads of this pool.
+	/** Returns when all the iterations have finished. Calls from several threads at once run one after another,
+		so an iteration must not call ParallelFor() on the same pool. */
+	void ParallelFor(int numTasks, TaskFunc task, void *context);
+
+	/// Calls func(i) for each i in [0, numTasks[, spread over the threads of this pool.
+	template<typename Func>
+	void ParallelFor(int numTasks, Func &func) { ParallelFor(numTasks, &CallFunc<Func>, &func); }
+
+	/// Returns a pool with one thread for each hardware thread, shared by all the users of MathGeoLib.
+	/** The threads are started on the first call. */
+	static ThreadPool &Default();
+
+private:
+	template<typename Func>
+	static void CallFunc(void *context, int taskIndex) { (*reinterpret_cast<Func*>(context))(taskIndex); }
+
+	ThreadPool(const ThreadPool &); // Not implemented.
+	void operator =(const ThreadPool &); // Not implemented.
+
+	int numThreads;
+
+#ifndef MATH_NO_THREADS
+	/// The iterations a thread has left, stored so that the thread and the thieves can update them atomically.
+	struct TaskRange;
+
+	TaskRange *ranges; // One for each thread. The calling thread of ParallelFor() uses ranges[0].
+	std::vector<std::thread> threads;
+
+	std::mutex runMutex; // Held for the duration of ParallelFor().
+	std::mutex mutex; // Guards the fields below.
+	std::condition_variable wake;
+	std::condition_variable done;
+	TaskFunc task;
+	void *context;
+	u64 generation; // Incremented on each ParallelFor() call that wakes the worker threads.
+	int numBusy; // The number of worker threads still running iterations of the current loop.
+	bool quit;
+
+	void WorkerMain(int threadIndex);
+	/// Runs iterations on the given thread until there are none left to run or to steal.
+	void RunTasks(int threadIndex);
+#endif
+};
+
+MATH_END_NAMESPACE
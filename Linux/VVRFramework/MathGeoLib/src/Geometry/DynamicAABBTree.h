@@ -0,0 +1,194 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file DynamicAABBTree.h
+	@author Jukka Jylnki
+	@brief A bounding volume hierarchy of AABBs for the broad phase of collision detection between moving objects. */
+#pragma once
+
+#include "../MathGeoLibFwd.h"
+#include "AABB.h"
+#include <vector>
+#include <utility>
+
+MATH_BEGIN_NAMESPACE
+
+/// A balanced binary tree of AABBs for the broad phase of collision detection between moving objects.
+/** Each object is a leaf of the tree, and is bounded by a "fat" AABB that is larger than the object by a margin
+	on each side. The inner nodes bound their two children. When an object moves, Update() does nothing as long as
+	the object stays inside its fat AABB. Otherwise the leaf is removed and inserted back with a new fat AABB.
+	Leaves are inserted next to the node that increases the surface area of the tree the least, and the nodes on
+	the path from the leaf to the root are rotated when the heights of their children differ by more than one, which
+	keeps the height of the tree close to logarithmic in the number of objects.
+
+	FindOverlappingPairs() finds the pairs of objects whose AABBs overlap. These are the candidates for the
+	narrow phase, e.g. Intersects() or GJKIntersect() on the objects themselves.
+
+	To place objects of type T into a DynamicAABBTree, define a function AABB GetAABB(const T &object) that
+	returns the bounds of the object, e.g. AABB GetAABB(const OBB *obb) { return obb->MinimalEnclosingAABB(); }.
+	The tree refers to its objects by the handles returned by Add().
+	@see SweepAndPrune. */
+template<typename T>
+class DynamicAABBTree
+{
+public:
+	/// Identifies an object in the tree. Stays valid until the object is removed.
+	typedef int ObjectHandle;
+
+	struct Node
+	{
+		/// For a leaf, the fat AABB of its object. For an inner node, the AABB that encloses its children.
+		AABB aabb;
+		/// The index of the parent node, or -1 if this node is the root.
+		int parent;
+		/// The indices of the child nodes, or -1 if this node is a leaf.
+		int children[2];
+		/// For a leaf, its object. -1 for inner nodes.
+		ObjectHandle object;
+		/// The number of levels of nodes below this node. Zero for leaves, -1 for nodes that are free.
+		int height;
+
+		bool IsLeaf() const { return children[0] == -1; }
+	};
+
+	/// @param margin The distance that the fat AABB of each object extends beyond the object on each side. The larger
+	///	the margin, the less often moving objects are reinserted, and the more pairs of objects that do not touch are
+	///	reported by FindOverlappingPairs().
+	explicit DynamicAABBTree(float margin = 0.1f);
+
+	/// Removes all objects and nodes in this tree.
+	void Clear();
+
+	/// Specifies the margin of the fat AABBs of the objects that are added or reinserted from now on.
+	void SetMargin(float margin) { assert(margin >= 0.f); this->margin = margin; }
+	float Margin() const { return margin; }
+
+	/// Adds the given object into the tree at the bounds given by GetAABB(object).
+	/// @return The handle that identifies the object in the tree.
+	ObjectHandle Add(const T &object);
+
+	/// Moves the given object in the tree to the bounds given by GetAABB() of it, after the object has moved.
+	/// @return True if the object left its fat AABB and was reinserted into the tree.
+	bool Update(ObjectHandle object);
+
+	/// Removes the given object from the tree.
+	void Remove(ObjectHandle object);
+
+	/// Returns the given object.
+	/// @note If the object is modified so that its bounds change, call Update() on it afterwards.
+	T &Object(ObjectHandle object) { assert(IsValid(object)); return objects[object].object; }
+	const T &Object(ObjectHandle object) const { assert(IsValid(object)); return objects[object].object; }
+
+	/// Returns the bounds of the given object when it was last added or updated.
+	const AABB &ObjectAABB(ObjectHandle object) const { assert(IsValid(object)); return objects[object].aabb; }
+
+	/// Returns the fat AABB of the given object, which contains ObjectAABB(object).
+	const AABB &FatAABB(ObjectHandle object) const { assert(IsValid(object)); return nodes[objects[object].leaf].aabb; }
+
+	/// Returns true if the given handle identifies an object in this tree.
+	bool IsValid(ObjectHandle object) const { return object >= 0 && object < (int)objects.size() && objects[object].leaf >= 0; }
+
+	/// @return The topmost node in the tree, or null if the tree is empty.
+	const Node *Root() const { return rootNodeIndex >= 0 ? &nodes[rootNodeIndex] : 0; }
+
+	/// Returns the given node.
+	const Node &GetNode(int nodeIndex) const { assert(nodeIndex >= 0 && nodeIndex < (int)nodes.size()); return nodes[nodeIndex]; }
+
+	/// Returns the number of objects in the tree. Runs in constant time.
+	int NumObjects() const { return numObjects; }
+
+	/// Returns the number of nodes in the tree, 2*NumObjects()-1 if the tree is not empty. Runs in constant time.
+	int NumNodes() const { return numNodes; }
+
+	/// Returns the number of levels of inner nodes in the tree. Runs in constant time.
+	int Height() const { return rootNodeIndex >= 0 ? nodes[rootNodeIndex].height : 0; }
+
+	/// Performs an AABB intersection query in this tree, and calls the given callback function for each object whose
+	/// bounds intersect the given AABB.
+	/** @param callback A function or a function object of prototype
+			bool callbackFunction(DynamicAABBTree<T> &tree, const AABB &queryAABB, DynamicAABBTree<T>::ObjectHandle object);
+		If the callback function returns true, the execution of the query is stopped and this function immediately
+		returns afterwards. If the callback function returns false, the execution of the query continues. */
+	template<typename Func>
+	inline void AABBQuery(const AABB &aabb, Func &callback);
+
+	/// Finds the pairs of objects in this tree whose bounds intersect, and calls the given callback function for each.
+	/** The tree is traversed against itself, so only the subtrees whose AABBs overlap are visited. The pairs are
+		tested with the fat AABBs, and reported if the bounds of the objects themselves intersect.
+		@param callback A function or a function object of prototype
+			bool callbackFunction(DynamicAABBTree<T> &tree, DynamicAABBTree<T>::ObjectHandle a, DynamicAABBTree<T>::ObjectHandle b);
+		Each pair is reported once, in an unspecified order. If the callback function returns true, the execution
+		of the query is stopped and this function immediately returns afterwards. */
+	template<typename Func>
+	inline void FindOverlappingPairs(Func &callback);
+
+	/// Appends the pairs of objects in this tree whose bounds intersect to the given array.
+	void FindOverlappingPairs(std::vector<std::pair<ObjectHandle, ObjectHandle> > &outPairs);
+
+	/// Performs various consistency checks on the whole tree. Use only for debugging purposes.
+	void DebugSanityCheck() const;
+
+private:
+	struct ObjectEntry
+	{
+		T object;
+		AABB aabb;
+		/// The leaf node of the object, or -1 if this entry is free.
+		int leaf;
+		/// For a free entry, the index of the next free entry, or -1.
+		int nextFree;
+	};
+
+	std::vector<Node> nodes;
+	int firstFreeNode; // The first free node of the above array, or -1. Free nodes are linked through their parent field.
+	std::vector<ObjectEntry> objects;
+	int firstFreeObject; // The first free entry of the above array, or -1.
+
+	int rootNodeIndex;
+	float margin;
+	int numObjects;
+	int numNodes;
+
+	std::vector<std::pair<int, int> > pairStack; // The node pairs left to visit in FindOverlappingPairs().
+
+	AABB FatAABB(const AABB &aabb) const;
+
+	int AllocateNode();
+	void FreeNode(int node);
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	/// Rotates the given node with one of its children if the heights of its children differ by more than one.
+	/// @return The node that took the place of the given node in the tree.
+	int Balance(int node);
+	/// Recomputes the height and AABB of each node from the given node up to the root, rebalancing them on the way.
+	void RefitAncestors(int node);
+
+	int DebugSanityCheckNode(int node) const;
+
+	/// A callback for FindOverlappingPairs() that appends the pairs to an array.
+	struct PairCollector
+	{
+		std::vector<std::pair<ObjectHandle, ObjectHandle> > *pairs;
+		bool operator()(DynamicAABBTree<T> & /*tree*/, ObjectHandle a, ObjectHandle b)
+		{
+			pairs->push_back(std::make_pair(a, b));
+			return false;
+		}
+	};
+};
+
+MATH_END_NAMESPACE
+
+#include "DynamicAABBTree.inl"
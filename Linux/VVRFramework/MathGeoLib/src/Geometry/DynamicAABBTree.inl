@@ -0,0 +1,433 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file DynamicAABBTree.inl
+	@author Jukka Jylnki
+	@brief Implementation for the DynamicAABBTree object. */
+#pragma once
+
+#include "../Math/MathFunc.h"
+
+MATH_BEGIN_NAMESPACE
+
+template<typename T>
+DynamicAABBTree<T>::DynamicAABBTree(float margin)
+:firstFreeNode(-1), firstFreeObject(-1), rootNodeIndex(-1), margin(margin), numObjects(0), numNodes(0)
+{
+	assert(margin >= 0.f);
+}
+
+template<typename T>
+void DynamicAABBTree<T>::Clear()
+{
+	nodes.clear();
+	objects.clear();
+	firstFreeNode = -1;
+	firstFreeObject = -1;
+	rootNodeIndex = -1;
+	numObjects = 0;
+	numNodes = 0;
+}
+
+template<typename T>
+AABB DynamicAABBTree<T>::FatAABB(const AABB &aabb) const
+{
+	return AABB(aabb.minPoint - DIR_VEC_SCALAR(margin), aabb.maxPoint + DIR_VEC_SCALAR(margin));
+}
+
+template<typename T>
+typename DynamicAABBTree<T>::ObjectHandle DynamicAABBTree<T>::Add(const T &object)
+{
+	ObjectEntry e;
+	e.object = object;
+	e.aabb = GetAABB(object);
+	e.leaf = -1;
+	e.nextFree = -1;
+	assert(e.aabb.IsFinite());
+
+	ObjectHandle handle;
+	if (firstFreeObject >= 0)
+	{
+		handle = firstFreeObject;
+		firstFreeObject = objects[handle].nextFree;
+		objects[handle] = e;
+	}
+	else
+	{
+		handle = (ObjectHandle)objects.size();
+		objects.push_back(e);
+	}
+
+	const int leaf = AllocateNode();
+	nodes[leaf].aabb = FatAABB(e.aabb);
+	nodes[leaf].object = handle;
+	nodes[leaf].height = 0;
+	objects[handle].leaf = leaf;
+	InsertLeaf(leaf);
+	++numObjects;
+	return handle;
+}
+
+template<typename T>
+bool DynamicAABBTree<T>::Update(ObjectHandle object)
+{
+	assert(IsValid(object));
+	ObjectEntry &e = objects[object];
+	e.aabb = GetAABB(e.object);
+	assert(e.aabb.IsFinite());
+
+	const int leaf = e.leaf;
+	if (nodes[leaf].aabb.Contains(e.aabb))
+		return false;
+
+	RemoveLeaf(leaf);
+	nodes[leaf].aabb = FatAABB(e.aabb);
+	InsertLeaf(leaf);
+	return true;
+}
+
+template<typename T>
+void DynamicAABBTree<T>::Remove(ObjectHandle object)
+{
+	assert(IsValid(object));
+	ObjectEntry &e = objects[object];
+	RemoveLeaf(e.leaf);
+	FreeNode(e.leaf);
+
+	e.object = T();
+	e.leaf = -1;
+	e.nextFree = firstFreeObject;
+	firstFreeObject = object;
+	--numObjects;
+}
+
+template<typename T>
+int DynamicAABBTree<T>::AllocateNode()
+{
+	int index;
+	if (firstFreeNode >= 0)
+	{
+		index = firstFreeNode;
+		firstFreeNode = nodes[index].parent;
+	}
+	else
+	{
+		index = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+	Node &n = nodes[index];
+	n.parent = -1;
+	n.children[0] = n.children[1] = -1;
+	n.object = -1;
+	n.height = 0;
+	++numNodes;
+	return index;
+}
+
+template<typename T>
+void DynamicAABBTree<T>::FreeNode(int node)
+{
+	Node &n = nodes[node];
+	n.parent = firstFreeNode;
+	n.children[0] = n.children[1] = -1;
+	n.object = -1;
+	n.height = -1;
+	firstFreeNode = node;
+	--numNodes;
+}
+
+template<typename T>
+void DynamicAABBTree<T>::InsertLeaf(int leaf)
+{
+	if (rootNodeIndex < 0)
+	{
+		rootNodeIndex = leaf;
+		nodes[leaf].parent = -1;
+		return;
+	}
+
+	// Descend to the node that the leaf is cheapest to pair with, by the increase in the surface area of the tree.
+	// Pairing the leaf with a node costs the area of the new parent, and grows the area of each ancestor.
+	const AABB leafAABB = nodes[leaf].aabb;
+	int sibling = rootNodeIndex;
+	while(!nodes[sibling].IsLeaf())
+	{
+		const Node &n = nodes[sibling];
+		AABB combined = n.aabb;
+		combined.Enclose(leafAABB);
+		const float combinedArea = combined.SurfaceArea();
+		const float cost = 2.f * combinedArea;
+		const float inheritedCost = 2.f * (combinedArea - n.aabb.SurfaceArea());
+
+		float childCost[2];
+		for(int i = 0; i < 2; ++i)
+		{
+			const Node &child = nodes[n.children[i]];
+			AABB aabb = child.aabb;
+			aabb.Enclose(leafAABB);
+			childCost[i] = aabb.SurfaceArea() + inheritedCost;
+			if (!child.IsLeaf())
+				childCost[i] -= child.aabb.SurfaceArea();
+		}
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+		sibling = n.children[childCost[0] <= childCost[1] ? 0 : 1];
+	}
+
+	// Note: nodes may be reallocated here, so take the references only after this.
+	const int newParent = AllocateNode();
+	Node &p = nodes[newParent];
+	Node &s = nodes[sibling];
+	const int oldParent = s.parent;
+	p.parent = oldParent;
+	p.aabb = s.aabb;
+	p.aabb.Enclose(leafAABB);
+	p.height = s.height + 1;
+	p.children[0] = sibling;
+	p.children[1] = leaf;
+	s.parent = newParent;
+	nodes[leaf].parent = newParent;
+	if (oldParent >= 0)
+	{
+		Node &op = nodes[oldParent];
+		op.children[op.children[0] == sibling ? 0 : 1] = newParent;
+	}
+	else
+		rootNodeIndex = newParent;
+
+	RefitAncestors(oldParent);
+}
+
+template<typename T>
+void DynamicAABBTree<T>::RemoveLeaf(int leaf)
+{
+	if (leaf == rootNodeIndex)
+	{
+		rootNodeIndex = -1;
+		return;
+	}
+
+	// Replace the parent of the leaf with the sibling of the leaf.
+	const int parent = nodes[leaf].parent;
+	const int grandParent = nodes[parent].parent;
+	const int sibling = nodes[parent].children[nodes[parent].children[0] == leaf ? 1 : 0];
+	nodes[sibling].parent = grandParent;
+	if (grandParent >= 0)
+	{
+		Node &gp = nodes[grandParent];
+		gp.children[gp.children[0] == parent ? 0 : 1] = sibling;
+	}
+	else
+		rootNodeIndex = sibling;
+	FreeNode(parent);
+	nodes[leaf].parent = -1;
+
+	RefitAncestors(grandParent);
+}
+
+template<typename T>
+void DynamicAABBTree<T>::RefitAncestors(int node)
+{
+	while(node >= 0)
+	{
+		node = Balance(node);
+		Node &n = nodes[node];
+		const Node &c0 = nodes[n.children[0]];
+		const Node &c1 = nodes[n.children[1]];
+		n.height = 1 + Max(c0.height, c1.height);
+		n.aabb = c0.aabb;
+		n.aabb.Enclose(c1.aabb);
+		node = n.parent;
+	}
+}
+
+template<typename T>
+int DynamicAABBTree<T>::Balance(int a)
+{
+	Node &A = nodes[a];
+	if (A.IsLeaf() || A.height < 2)
+		return a;
+
+	// If one child is more than one level taller than the other, it takes the place of A, and A takes the
+	// place of one of the children of the taller child. A keeps the shorter grandchild.
+	const int tallerSide = nodes[A.children[1]].height > nodes[A.children[0]].height ? 1 : 0;
+	const int shorterSide = 1 - tallerSide;
+	const int b = A.children[tallerSide];
+	Node &B = nodes[b];
+	if (B.height - nodes[A.children[shorterSide]].height <= 1)
+		return a;
+
+	const int f = B.children[0];
+	const int g = B.children[1];
+	Node &F = nodes[f];
+	Node &G = nodes[g];
+
+	B.children[0] = a;
+	B.parent = A.parent;
+	A.parent = b;
+	if (B.parent >= 0)
+	{
+		Node &p = nodes[B.parent];
+		p.children[p.children[0] == a ? 0 : 1] = b;
+	}
+	else
+		rootNodeIndex = b;
+
+	const Node &C = nodes[A.children[shorterSide]];
+	const int taller = F.height > G.height ? f : g;
+	const int shorter = taller == f ? g : f;
+	B.children[1] = taller;
+	A.children[tallerSide] = shorter;
+	nodes[shorter].parent = a;
+
+	A.aabb = C.aabb;
+	A.aabb.Enclose(nodes[shorter].aabb);
+	A.height = 1 + Max(C.height, nodes[shorter].height);
+	B.aabb = A.aabb;
+	B.aabb.Enclose(nodes[taller].aabb);
+	B.height = 1 + Max(A.height, nodes[taller].height);
+	return b;
+}
+
+template<typename T>
+template<typename Func>
+inline void DynamicAABBTree<T>::AABBQuery(const AABB &aabb, Func &callback)
+{
+	if (rootNodeIndex < 0)
+		return;
+	std::vector<int> stack;
+	stack.push_back(rootNodeIndex);
+	while(!stack.empty())
+	{
+		const int nodeIndex = stack.back();
+		stack.pop_back();
+		const Node &n = nodes[nodeIndex];
+		if (!aabb.Intersects(n.aabb))
+			continue;
+		if (n.IsLeaf())
+		{
+			if (aabb.Intersects(objects[n.object].aabb) && callback(*this, aabb, n.object))
+				return;
+		}
+		else
+		{
+			stack.push_back(n.children[0]);
+			stack.push_back(n.children[1]);
+		}
+	}
+}
+
+template<typename T>
+template<typename Func>
+inline void DynamicAABBTree<T>::FindOverlappingPairs(Func &callback)
+{
+	if (rootNodeIndex < 0)
+		return;
+	// A pair (i, i) stands for the pairs of objects within the subtree of node i.
+	pairStack.clear();
+	pairStack.push_back(std::make_pair(rootNodeIndex, rootNodeIndex));
+	while(!pairStack.empty())
+	{
+		const int a = pairStack.back().first;
+		const int b = pairStack.back().second;
+		pairStack.pop_back();
+		const Node &A = nodes[a];
+		const Node &B = nodes[b];
+		if (a == b)
+		{
+			if (!A.IsLeaf())
+			{
+				pairStack.push_back(std::make_pair(A.children[0], A.children[0]));
+				pairStack.push_back(std::make_pair(A.children[1], A.children[1]));
+				pairStack.push_back(std::make_pair(A.children[0], A.children[1]));
+			}
+			continue;
+		}
+		if (!A.aabb.Intersects(B.aabb))
+			continue;
+		if (A.IsLeaf() && B.IsLeaf())
+		{
+			if (objects[A.object].aabb.Intersects(objects[B.object].aabb) && callback(*this, A.object, B.object))
+				return;
+		}
+		else if (B.IsLeaf() || (!A.IsLeaf() && A.height >= B.height))
+		{
+			pairStack.push_back(std::make_pair(A.children[0], b));
+			pairStack.push_back(std::make_pair(A.children[1], b));
+		}
+		else
+		{
+			pairStack.push_back(std::make_pair(a, B.children[0]));
+			pairStack.push_back(std::make_pair(a, B.children[1]));
+		}
+	}
+}
+
+template<typename T>
+void DynamicAABBTree<T>::FindOverlappingPairs(std::vector<std::pair<ObjectHandle, ObjectHandle> > &outPairs)
+{
+	PairCollector collector = { &outPairs };
+	FindOverlappingPairs(collector);
+}
+
+template<typename T>
+int DynamicAABBTree<T>::DebugSanityCheckNode(int node) const
+{
+	const Node &n = nodes[node];
+	assert(n.height >= 0);
+	if (n.IsLeaf())
+	{
+		assert(n.height == 0);
+		assert(n.children[1] == -1);
+		assert(IsValid(n.object));
+		assert(objects[n.object].leaf == node);
+		assert(n.aabb.Contains(objects[n.object].aabb));
+		return 1;
+	}
+	assert(n.object == -1);
+	const Node &c0 = nodes[n.children[0]];
+	const Node &c1 = nodes[n.children[1]];
+	assert(c0.parent == node);
+	assert(c1.parent == node);
+	assert(n.height == 1 + Max(c0.height, c1.height));
+	assert(n.aabb.Contains(c0.aabb));
+	assert(n.aabb.Contains(c1.aabb));
+	MARK_UNUSED(c0);
+	MARK_UNUSED(c1);
+	return 1 + DebugSanityCheckNode(n.children[0]) + DebugSanityCheckNode(n.children[1]);
+}
+
+template<typename T>
+void DynamicAABBTree<T>::DebugSanityCheck() const
+{
+	int numNodesInTree = 0;
+	if (rootNodeIndex >= 0)
+	{
+		assert(nodes[rootNodeIndex].parent == -1);
+		numNodesInTree = DebugSanityCheckNode(rootNodeIndex);
+	}
+	assert(numNodesInTree == numNodes);
+	assert(numNodes == (numObjects > 0 ? 2 * numObjects - 1 : 0));
+	int numFreeNodes = 0;
+	for(int i = firstFreeNode; i >= 0; i = nodes[i].parent)
+	{
+		assert(nodes[i].height == -1);
+		++numFreeNodes;
+	}
+	assert(numFreeNodes + numNodes == (int)nodes.size());
+	MARK_UNUSED(numNodesInTree);
+	MARK_UNUSED(numFreeNodes);
+}
+
+MATH_END_NAMESPACE
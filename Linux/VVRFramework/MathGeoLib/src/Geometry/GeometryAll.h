@@ -29,12 +29,14 @@
 #include "AABB2D.h"
 #include "Capsule.h"
 #include "Circle.h"
+#include "DynamicAABBTree.h"
 #include "Frustum.h"
 #include "GeometryAll.h"
 #include "HitInfo.h"
 #include "KDTree.h"
 #include "Line.h"
 #include "LineSegment.h"
+#include "LooseQuadTree.h"
 #include "OBB.h"
 #include "Plane.h"
 #include "Polygon.h"
@@ -42,6 +44,7 @@
 #include "QuadTree.h"
 #include "Ray.h"
 #include "Sphere.h"
+#include "SweepAndPrune.h"
 #include "Triangle.h"
 #include "TriangleMesh.h"
 #include "GeomType.h"
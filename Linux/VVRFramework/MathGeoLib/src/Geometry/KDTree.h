@@ -20,10 +20,10 @@
 #include "../Math/MathTypes.h"
 #include "../Math/myassert.h"
 #include "Triangle.h"
-
-#ifdef MATH_CONTAINERLIB_SUPPORT
-#include "Container/MaxHeap.h"
-#endif
+#include "AABB.h"
+#include "OBB.h"
+#include <vector>
+#include <algorithm>
 
 MATH_BEGIN_NAMESPACE
 
@@ -59,6 +59,137 @@ struct KdTreeNode
 	CardinalAxis SplitAxis() const { return (CardinalAxis)splitAxis; }
 };
 
+/// Specifies how KdTree::Build() chooses the split plane of each node.
+enum KdTreeSplitMethod
+{
+	/// Splits the longest axis of the objects in the node at its centre. Fast to build, but the tree is
+	/// far from optimal for ray queries when the objects are not spread evenly.
+	KdTreeSplitMidpoint = 0,
+	/// Chooses the plane of least cost by the surface area heuristic, trying a number of evenly spaced
+	/// planes on each axis. Slower to build, but ray queries through the tree visit far fewer objects.
+	KdTreeSplitSAH
+};
+
+/// Specifies the parameters KdTree::Build() constructs the tree with.
+struct KdTreeBuildParams
+{
+	/// Constructs the parameters the given split method is used with by default.
+	explicit KdTreeBuildParams(KdTreeSplitMethod splitMethod_ = KdTreeSplitSAH)
+	:splitMethod(splitMethod_),
+	maxLeafObjects(splitMethod_ == KdTreeSplitMidpoint ? 16 : 2),
+	maxDepth(splitMethod_ == KdTreeSplitMidpoint ? 30 : 0),
+	numBins(32),
+	traversalCost(1.f),
+	emptySpaceBonus(0.2f),
+	numThreads(0),
+	minParallelObjects(4096)
+	{
+	}
+
+	KdTreeSplitMethod splitMethod;
+
+	/// A node with at most this many objects is made a leaf. With KdTreeSplitSAH, nodes with more objects
+	/// are also made leaves if no split is cheaper than the leaf.
+	int maxLeafObjects;
+
+	/// The maximum depth of a leaf, the root being at depth 1. If 0, the depth is limited to 8 + 1.3 * log2(n)
+	/// for n objects. Clamped to KdTree<T>::maxTreeDepth.
+	int maxDepth;
+
+	/// The number of bins along each axis that KdTreeSplitSAH places the objects of a node in. The planes
+	/// between the bins are the candidate split planes.
+	int numBins;
+
+	/// The cost of traversing through an inner node relative to the cost of testing a single object.
+	float traversalCost;
+
+	/// The fraction of its cost that is taken off a split which leaves one child empty, in the range [0, 1[.
+	/// Cutting off empty space early lets rays skip it.
+	float emptySpaceBonus;
+
+	/// The number of threads that the subtrees are built on. If 0, one thread is used for each hardware thread.
+	/// Has no effect if MATH_NO_THREADS is defined.
+	int numThreads;
+
+	/// A subtree is only handed off to another thread if both children of its parent have at least this many objects.
+	int minParallelObjects;
+};
+
+/// A bounded priority queue of objects by their distance to a point, which keeps the given number of nearest objects
+/// pushed to it. The objects are kept in a max-heap, so that the farthest one is the first to be replaced.
+class KdTreeNearestObjectsQueue
+{
+public:
+	/// Constructs a queue which keeps at most maxObjects objects, none farther than maxDistance.
+	explicit KdTreeNearestObjectsQueue(int maxObjects_, float maxDistance_ = FLOAT_INF)
+	:maxObjects(maxObjects_), maxDistance(maxDistance_)
+	{
+		heap.reserve(maxObjects > 0 ? maxObjects : 0);
+	}
+
+	/// Adds the given object to the queue, unless it is farther than MaxDistance() or already in the queue.
+	/// The same object can be pushed several times, since an object may lie in several leaves of a kD-tree.
+	void Push(u32 objectIndex, float distance)
+	{
+		if (!(distance <= MaxDistance()) || maxObjects <= 0)
+			return;
+		for(size_t i = 0; i < heap.size(); ++i)
+			if (heap[i].objectIndex == objectIndex)
+				return;
+		Entry e;
+		e.distance = distance;
+		e.objectIndex = objectIndex;
+		if ((int)heap.size() == maxObjects)
+		{
+			if (distance >= heap.front().distance)
+				return;
+			std::pop_heap(heap.begin(), heap.end());
+			heap.back() = e;
+		}
+		else
+			heap.push_back(e);
+		std::push_heap(heap.begin(), heap.end());
+	}
+
+	/// Returns the distance an object may have at most to be kept: the distance of the farthest object kept if the
+	/// queue is full, and otherwise the maximum distance the queue was constructed with.
+	float MaxDistance() const { return (int)heap.size() == maxObjects ? heap.front().distance : maxDistance; }
+
+	/// Returns the number of objects in the queue.
+	int Size() const { return (int)heap.size(); }
+
+	/// Outputs the objects in the queue sorted by increasing distance and empties the queue.
+	/** @param outObjectIndices [out] Receives Size() object indices.
+		@param outDistances [out] If not null, receives the Size() distances of the objects.
+		@return The number of objects output. */
+	int PopSorted(u32 *outObjectIndices, float *outDistances)
+	{
+		std::sort_heap(heap.begin(), heap.end());
+		const int numObjects = (int)heap.size();
+		for(int i = 0; i < numObjects; ++i)
+		{
+			outObjectIndices[i] = heap[i].objectIndex;
+			if (outDistances)
+				outDistances[i] = heap[i].distance;
+		}
+		heap.clear();
+		return numObjects;
+	}
+
+private:
+	struct Entry
+	{
+		float distance;
+		u32 objectIndex;
+
+		bool operator <(const Entry &rhs) const { return distance < rhs.distance || (distance == rhs.distance && objectIndex < rhs.objectIndex); }
+	};
+
+	std::vector<Entry> heap;
+	int maxObjects;
+	float maxDistance;
+};
+
 /// Type T must have a member function bool T.Intersects(const AABB &) const;
 template<typename T>
 class KdTree
@@ -81,10 +212,14 @@ public:
 	/// call Build() to create the tree data structure.
 	void AddObjects(const T *objects, int numObjects);
 
-	/// Creates the kD-tree data structure based on all the objects added to the tree.
-	/// After Build() has been called, do *not* call AddObjects() again.
+	/// Creates the kD-tree data structure based on all the objects added to the tree, by splitting each node
+	/// at its midpoint. After Build() has been called, do *not* call AddObjects() again.
 	void Build();
 
+	/// Creates the kD-tree data structure based on all the objects added to the tree, with the given parameters.
+	/// After Build() has been called, do *not* call AddObjects() again.
+	void Build(const KdTreeBuildParams &params);
+
 	/// Empties the whole kD-tree of all objects.
 	/// Call this function if you want to reuse this structure for rebuilding another kD-tree, after first
 	/// having called AddObjects/Build to build a previous tree.
@@ -92,6 +227,7 @@ public:
 
 	/// Returns an object bucket by the given bucket index.
 	/// An object bucket is a contiguous C array of object indices, terminated with a sentinel value BUCKET_SENTINEL.
+	/// The bucket of index 0 is the bucket of the empty leaves, which holds only the sentinel.
 	/// To fetch the actual object based on an object index, call the Object() method.
 	u32 *Bucket(int bucketIndex);
 	const u32 *Bucket(int bucketIndex) const;
@@ -141,6 +277,27 @@ public:
 	template<typename Func>
 	inline void RayQuery(const Ray &r, Func &leafCallback);
 
+	/// Traverses a packet of N rays through this kD-tree together, and calls the given leafCallback function for
+	/// each leaf of the tree that some ray of the packet passes through.
+	/** The rays share one traversal: each node is visited once for all the rays whose interval reaches it, and is
+		culled when no active ray passes through it. When the rays go in opposite directions along the split axis,
+		the packet is split in two. This is faster than N calls to RayQuery() when the rays are coherent, e.g. the
+		primary rays of neighbouring pixels.
+		@param rays An array of N rays. N may be at most 32.
+		@param rayMask The rays of the packet to trace, bit i for rays[i].
+		@param leafCallback A function or a function object of prototype
+			u32 LeafCallbackFunction(KdTree<T> &tree, const KdTreeNode &leaf, const Ray *rays, const float *tNear, const float *tFar, u32 rayMask);
+			rayMask holds the rays that pass through the leaf, and tNear[i] and tFar[i] the interval of rays[i] inside it.
+			The callback returns the mask of the rays whose traversal is finished. These are not passed to any further leaves. */
+	template<int N, typename Func>
+	inline void RayPacketQuery(const Ray *rays, u32 rayMask, Func &leafCallback);
+
+	/// Finds the nearest hit of each of the given rays with the triangles of this tree. T must be Triangle.
+	/** The rays are traced in packets with RayPacketQuery(), so rays next to each other in the array should be
+		coherent for best performance.
+		@param outHits [out] Receives the hit of each ray. Must have room for numRays hits. */
+	void IntersectRays(const Ray *rays, int numRays, RayTriangleHit *outHits);
+
 	/// Performs an AABB intersection query in this kD-tree, and calls the given leafCallback function for each leaf
 	/// of the tree which intersects the given AABB.
 	/** @param aabb The axis-aligned bounding box to query through this kD-tree.
@@ -151,45 +308,94 @@ public:
 	template<typename Func>
 	inline void AABBQuery(const AABB &aabb, Func &leafCallback);
 
-#if 0 ///\bug Doesn't work properly. Fix up!
 	/// Performs an intersection query of this kD-tree against a given kD-tree, and calls the given
-	/// leafCallback function for each leaf pair that intersect each other.
-	/// @param leafCallback A function or a function object of prototype
-	///    bool LeafCallbackFunction(KdTree<T> &thisTree, KdTreeNode &thisLeaf, const AABB &thisLeafAABB,
-	///                              KdTree<T> &tree2, KdTreeNode &tree2Leaf, const OBB &tree2LeafOBB);
-	///    If the callback function returns true, the execution of the query is stopped and this function immediately
-	///    returns afterwards. If the callback function returns false, the execution of the query continues.
+	/// leafCallback function for each pair of nonempty leaves whose boxes intersect each other.
+	/** The query is done in the local space of this tree: the leaves of tree2 are passed as OBBs transformed
+		from the local space of tree2 into the local space of this tree.
+		@param thisWorldTransform The local-to-world transform of this tree. Must be invertible.
+		@param tree2WorldTransform The local-to-world transform of tree2.
+		@param leafCallback A function or a function object of prototype
+			bool LeafCallbackFunction(KdTree<T> &thisTree, KdTreeNode &thisLeaf, const AABB &thisLeafAABB,
+			                          KdTree<T> &tree2, KdTreeNode &tree2Leaf, const OBB &tree2LeafOBB);
+			If the callback function returns true, the execution of the query is stopped and this function immediately
+			returns afterwards. If the callback function returns false, the execution of the query continues. */
 	template<typename Func>
 	inline void KdTreeQuery(KdTree<T> &tree2, const float3x4 &thisWorldTransform, const float3x4 &tree2WorldTransform, Func &leafCallback);
-#endif
 
-#ifdef MATH_CONTAINERLIB_SUPPORT
-	/// Performs a nearest neighbor search on this kD-tree.
+	/// Performs a nearest neighbor search on this kD-tree. The nonempty leaves are passed to the callback in the
+	/// order of increasing distance to the given point.
 	/// @param leafCallback A function or a function object of prototype
-	///    bool LeafCallbackFunction(KdTree<T> &tree, const float3 &point, KdTreeNode &leaf, const AABB &aabb, float minDistance);
+	///    bool LeafCallbackFunction(KdTree<T> &tree, const vec &point, KdTreeNode &leaf, const AABB &aabb, float minDistance);
 	///    If the callback function returns true, the execution of the query is stopped and this function immediately
 	///    returns afterwards. If the callback function returns false, the execution of the query continues.
 	///	   minDistance is the minimum distance the objects in this leaf (and all future leaves to be passed to the
 	///    callback) have to the point that is being queried.
 	template<typename Func>
 	inline void NearestObjects(const vec &point, Func &leafCallback);
-#endif
 
-private:
-	static const int maxNodes = 256 * 1024;
-	static const int maxTreeDepth = 30;
+	/// Finds the k objects nearest to the given point. Type T must have a member function float T.Distance(const vec &) const.
+	/** @param outObjectIndices [out] Receives the indices of the objects found, sorted by increasing distance. Must have room for k indices.
+		@param outDistances [out] If not null, receives the distances of the objects found. Must have room for k distances.
+		@param maxDistance Objects farther than this from the point are not considered.
+		@return The number of objects found, at most k. */
+	int KNearestObjects(const vec &point, int k, u32 *outObjectIndices, float *outDistances = 0, float maxDistance = FLOAT_INF);
+
+	/// Finds all objects which are at most maxDistance away from the given point. Type T must have a member function
+	/// float T.Distance(const vec &) const.
+	/** @param outObjectIndices [out] The indices of the objects found are appended to this vector in increasing order. */
+	void ObjectsWithinDistance(const vec &point, float maxDistance, std::vector<u32> &outObjectIndices);
+
+	/// The maximum depth of a tree. The traversal stacks of the queries are sized by this.
+	static const int maxTreeDepth = 64;
 
+private:
 	std::vector<KdTreeNode> nodes;
 	std::vector<u8, AlignedAllocator<u8, 16> > objects;
-	std::vector<u32*> buckets;
+	/// The object indices of all the buckets one after another, each bucket terminated with BUCKET_SENTINEL.
+	/// A bucket index is the offset of the bucket in this array.
+	std::vector<u32> buckets;
+
+	/// The nodes and buckets of a subtree under construction. Each subtree built on a thread of its own
+	/// has its own, which are appended to those of the parent when done. Index 0 of nodes is an unused
+	/// dummy node and the root is at index 1, as in the tree itself.
+	struct Subtree
+	{
+		std::vector<KdTreeNode> nodes;
+		std::vector<u32> buckets;
+
+		Subtree();
+	};
 
-	int AllocateNodePair();
+	/// A pair of nodes, one of each tree, in the stack of KdTreeQuery().
+	struct NodePair
+	{
+		KdTreeNode *thisNode;
+		KdTreeNode *tree2Node;
+		AABB thisAABB;
+		AABB tree2AABB;
+		OBB tree2OBB;
+	};
 
-	void FreeBuckets();
+	static int AllocateNodePair(std::vector<KdTreeNode> &nodes);
 
 	AABB BoundingAABB(const u32 *bucket) const;
 
-	void SplitLeaf(int nodeIndex, const AABB &nodeAABB, int numObjectsInBucket, int leafDepth);
+	/// Splits the given node of the subtree, or makes it a leaf, and recursively the children.
+	/// The object indices of the node are freed before recursing.
+	void BuildNode(Subtree &subtree, int nodeIndex, std::vector<u32> &nodeObjects, const AABB &nodeAABB, int depth,
+		int numThreads, const KdTreeBuildParams &params, const AABB *objectAABBs) const;
+
+	/// Entry point of a thread which builds a subtree.
+	static void BuildSubtreeThread(const KdTree<T> *tree, Subtree *subtree, std::vector<u32> *nodeObjects,
+		const AABB *nodeAABB, int depth, int numThreads, const KdTreeBuildParams *params, const AABB *objectAABBs);
+
+	/// Appends the nodes and buckets of the given subtree to the destination, its root replacing the given node.
+	static void AppendSubtree(Subtree &dst, int nodeIndex, const Subtree &src);
+
+	/// Finds the split plane of least surface area heuristic cost for the given node. Returns false if no split
+	/// is cheaper than making the node a leaf.
+	static bool FindSAHSplit(const std::vector<u32> &nodeObjects, const AABB &nodeAABB, const KdTreeBuildParams &params,
+		const AABB *objectAABBs, CardinalAxis &splitAxis, float &splitPos);
 
 	///\todo Implement support for deep copying.
 	KdTree(const KdTree &);
@@ -242,6 +448,107 @@ struct TriangleKdTreeRayQueryNearestHitVisitor
 	}
 };
 
+/// Finds the nearest hit of each ray of a packet with a KdTree<Triangle> with KdTree<Triangle>::RayPacketQuery().
+template<int N>
+struct TriangleKdTreeRayPacketNearestHitVisitor
+{
+	RayTriangleHit hits[N];
+
+	TriangleKdTreeRayPacketNearestHitVisitor()
+	{
+		for(int i = 0; i < N; ++i)
+			hits[i].SetMiss();
+	}
+
+	u32 operator()(KdTree<Triangle> &tree, const KdTreeNode &leaf, const Ray *rays, const float *tNear, const float *tFar, u32 rayMask)
+	{
+		const float epsilon = 1e-4f;
+		for(const u32 *bucket = tree.Bucket(leaf.bucketIndex); *bucket != KdTree<Triangle>::BUCKET_SENTINEL; ++bucket)
+		{
+			// The Moller-Trumbore test of Triangle::IntersectLineTri(), with the edge vectors computed once for the packet.
+			const Triangle &tri = tree.Object(*bucket);
+			const vec e1 = tri.b - tri.a;
+			const vec e2 = tri.c - tri.a;
+			for(int i = 0; i < N; ++i)
+			{
+				if ((rayMask & (1u << i)) == 0)
+					continue;
+				const vec p = rays[i].dir.Cross(e2);
+				const float det = e1.Dot(p);
+				if (Abs(det) <= epsilon)
+					continue;
+				const float recipDet = 1.f / det;
+				const vec s = rays[i].pos - tri.a;
+				const float u = s.Dot(p) * recipDet;
+				if (u < -epsilon || u > 1.f + epsilon)
+					continue;
+				const vec q = s.Cross(e1);
+				const float v = rays[i].dir.Dot(q) * recipDet;
+				if (v < -epsilon || u + v > 1.f + epsilon)
+					continue;
+				const float t = e2.Dot(q) * recipDet;
+				// The leaf intervals are computed in floating point, so accept hits just outside them, or a hit on
+				// a triangle that only touches the split plane could be missed by both leaves.
+				const float tolerance = epsilon * Max(1.f, t);
+				if (t >= 0.f && t >= tNear[i] - tolerance && t <= tFar[i] + tolerance && t < hits[i].t)
+				{
+					hits[i].t = t;
+					hits[i].triangleIndex = (int)*bucket;
+					hits[i].u = u;
+					hits[i].v = v;
+				}
+			}
+		}
+		// A ray which hit a triangle in this leaf need not visit any farther leaves.
+		u32 finished = 0;
+		for(int i = 0; i < N; ++i)
+			if (hits[i].t <= tFar[i] + epsilon * Max(1.f, tFar[i]))
+				finished |= 1u << i;
+		return finished & rayMask;
+	}
+};
+
+/// Finds the k objects of a KdTree<T> nearest to a point with KdTree<T>::NearestObjects().
+/// Type T must have a member function float T.Distance(const vec &) const.
+template<typename T>
+struct KdTreeNearestObjectsVisitor
+{
+	KdTreeNearestObjectsQueue queue;
+
+	KdTreeNearestObjectsVisitor(int k, float maxDistance = FLOAT_INF):queue(k, maxDistance) {}
+
+	bool operator()(KdTree<T> &tree, const vec &point, const KdTreeNode &leaf, const AABB & /*aabb*/, float minDistance)
+	{
+		if (minDistance > queue.MaxDistance())
+			return true; // This leaf and all the leaves after it are farther than the objects found, so stop.
+		for(const u32 *bucket = tree.Bucket(leaf.bucketIndex); *bucket != KdTree<T>::BUCKET_SENTINEL; ++bucket)
+			queue.Push(*bucket, tree.Object(*bucket).Distance(point));
+		return false;
+	}
+};
+
+/// Finds the objects of a KdTree<T> at most a given distance away from a point with KdTree<T>::NearestObjects().
+/// Type T must have a member function float T.Distance(const vec &) const. An object may be found more than once
+/// if it lies in several leaves.
+template<typename T>
+struct KdTreeObjectsWithinDistanceVisitor
+{
+	float maxDistance;
+	std::vector<u32> objectIndices;
+
+	explicit KdTreeObjectsWithinDistanceVisitor(float maxDistance_):maxDistance(maxDistance_) {}
+
+	bool operator()(KdTree<T> &tree, const vec &point, const KdTreeNode &leaf, const AABB & /*aabb*/, float minDistance)
+	{
+		if (minDistance > maxDistance)
+			return true; // This leaf and all the leaves after it are too far, so stop.
+		for(const u32 *bucket = tree.Bucket(leaf.bucketIndex); *bucket != KdTree<T>::BUCKET_SENTINEL; ++bucket)
+			if (tree.Object(*bucket).Distance(point) <= maxDistance)
+				objectIndices.push_back(*bucket);
+		return false;
+	}
+};
+
 MATH_END_NAMESPACE
 
 #include "KDTree.inl"
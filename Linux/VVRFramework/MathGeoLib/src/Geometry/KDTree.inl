@@ -23,28 +23,46 @@
 #include "../Math/assume.h"
 #include "../Math/MathFunc.h"
 
+#ifndef MATH_NO_THREADS
+#include <thread>
+#endif
+
 MATH_BEGIN_NAMESPACE
 
 template<typename T>
-int KdTree<T>::AllocateNodePair()
+const u32 KdTree<T>::BUCKET_SENTINEL;
+
+template<typename T>
+const int KdTree<T>::maxTreeDepth;
+
+template<typename T>
+KdTree<T>::Subtree::Subtree()
+{
+	// Allocate a dummy node to be stored at index 0 (for safety).
+	KdTreeNode dummy;
+	dummy.splitAxis = AxisNone;
+	dummy.childIndex = 0;
+	dummy.bucketIndex = 0;
+	nodes.push_back(dummy); // Index 0 - dummy unused node, "null pointer".
+
+	// Bucket index 0 denotes an empty leaf. It still holds the sentinel so that leaf callbacks need not test for it.
+	buckets.push_back(BUCKET_SENTINEL);
+}
+
+template<typename T>
+int KdTree<T>::AllocateNodePair(std::vector<KdTreeNode> &nodes)
 {
 	int index = (int)nodes.size();
+	assume(index + 2 <= (1 << 30) && "KdTree: Too many nodes for the 30 bits of KdTreeNode::childIndex!");
 	KdTreeNode n;
 	n.splitAxis = AxisNone; // The newly allocated nodes will be leaves.
+	n.childIndex = 0;
 	n.bucketIndex = 0;
 	nodes.push_back(n);
 	nodes.push_back(n);
 	return index;
 }
 
-template<typename T>
-void KdTree<T>::FreeBuckets()
-{
-	for(size_t i = 0; i < buckets.size(); ++i)
-		delete[] buckets[i];
-	buckets.clear();
-}
-
 template<typename T>
 AABB KdTree<T>::BoundingAABB(const u32 *bucket) const
 {
@@ -60,113 +78,234 @@ AABB KdTree<T>::BoundingAABB(const u32 *bucket) const
 }
 
 template<typename T>
-void KdTree<T>::SplitLeaf(int nodeIndex, const AABB &nodeAABB, int numObjectsInBucket, int leafDepth)
+bool KdTree<T>::FindSAHSplit(const std::vector<u32> &nodeObjects, const AABB &nodeAABB, const KdTreeBuildParams &params,
+	const AABB *objectAABBs, CardinalAxis &splitAxis, float &splitPos)
 {
-	if (leafDepth >= maxTreeDepth)
-		return; // Exceeded max depth - disallow splitting.
+	const int numObjects = (int)nodeObjects.size();
+	const vec nodeSize = nodeAABB.Size();
+	const float nodeArea = nodeAABB.SurfaceArea();
+	if (!(nodeArea > 0.f))
+		return false;
 
-	KdTreeNode *node = &nodes[nodeIndex];
-	assert(node->IsLeaf());
-	// Choose the longest axis for the split and convert the node from a leaf to an inner node.
-	int curBucketIndex = node->bucketIndex; // The existing objects.
-	assert(curBucketIndex != 0); // The leaf must contain some objects, otherwise this function should never be called!
-	CardinalAxis splitAxis = (CardinalAxis)nodeAABB.Size().MaxElementIndex();
-	float splitPos = nodeAABB.CenterPoint()[splitAxis];
+	// Place the objects in bins over the part of the node they occupy, so that no bins are wasted on empty space.
+	AABB objectsAABB;
+	objectsAABB.SetNegativeInfinity();
+	for(int i = 0; i < numObjects; ++i)
+		objectsAABB.Enclose(objectAABBs[nodeObjects[i]]);
+	objectsAABB = objectsAABB.Intersection(nodeAABB);
 
-	// Compute the new bounding boxes for the left and right children.
-	AABB leftAABB = nodeAABB;
-	AABB rightAABB = nodeAABB;
-	leftAABB.maxPoint[splitAxis] = splitPos;
-	rightAABB.minPoint[splitAxis] = splitPos;
-
-	// Sort all objects into the left and right children.
-	u32 *leftBucket = new u32[numObjectsInBucket+1];
-	u32 *rightBucket = new u32[numObjectsInBucket+1];
-
-	u32 *curObject = buckets[curBucketIndex];
-	u32 *l = leftBucket;
-	u32 *r = rightBucket;
-	int numObjectsLeft = 0;
-	int numObjectsRight = 0;
-	while(*curObject != BUCKET_SENTINEL)
+	const int numBins = Max(params.numBins, 2);
+	std::vector<int> minCounts(numBins);
+	std::vector<int> maxCounts(numBins);
+
+	float bestCost = (float)numObjects; // The cost of making this node a leaf.
+	bool found = false;
+	for(int axis = 0; axis < 3; ++axis)
 	{
-		AABB aabb = Object(*curObject).BoundingAABB();
-		bool left = leftAABB.Intersects(aabb);
-		bool right = rightAABB.Intersects(aabb);
-		if (!left && !right)
-			left = right = true; // Numerical precision issues: bounding box doesn't intersect either anymore, so place into both children.
-		if (left)
+		const float lo = objectsAABB.minPoint[axis];
+		const float hi = objectsAABB.maxPoint[axis];
+		if (!(hi > lo))
+			continue;
+
+		// Count the objects starting and ending in each bin.
+		const float binSize = (hi - lo) / numBins;
+		const float toBin = numBins / (hi - lo);
+		std::fill(minCounts.begin(), minCounts.end(), 0);
+		std::fill(maxCounts.begin(), maxCounts.end(), 0);
+		for(int i = 0; i < numObjects; ++i)
 		{
-			*l++ = *curObject;
-			++numObjectsLeft;
+			const AABB &aabb = objectAABBs[nodeObjects[i]];
+			++minCounts[Clamp((int)((aabb.minPoint[axis] - lo) * toBin), 0, numBins-1)];
+			++maxCounts[Clamp((int)((aabb.maxPoint[axis] - lo) * toBin), 0, numBins-1)];
 		}
-		if (right)
+
+		// The surface area of a box of the node's size with the length along the split axis given is
+		// a0 + a1 * length.
+		const int axis2 = (axis + 1) % 3;
+		const int axis3 = (axis + 2) % 3;
+		const float a0 = 2.f * nodeSize[axis2] * nodeSize[axis3];
+		const float a1 = 2.f * (nodeSize[axis2] + nodeSize[axis3]);
+
+		// Plane i lies between bins i-1 and i. The objects which start below it go to the left and the
+		// objects which end above it go to the right. The outermost planes cut off the empty space
+		// around the objects, if there is any.
+		int numLeft = 0;
+		int numRight = numObjects;
+		for(int i = 0; i <= numBins; ++i)
+		{
+			if (i > 0)
+			{
+				numLeft += minCounts[i-1];
+				numRight -= maxCounts[i-1];
+			}
+			const float pos = (i == numBins) ? hi : lo + i * binSize;
+			if (!(pos > nodeAABB.minPoint[axis] && pos < nodeAABB.maxPoint[axis]))
+				continue;
+			const float leftArea = a0 + a1 * (pos - nodeAABB.minPoint[axis]);
+			const float rightArea = a0 + a1 * (nodeAABB.maxPoint[axis] - pos);
+			float cost = (leftArea * numLeft + rightArea * numRight) / nodeArea;
+			if (numLeft == 0 || numRight == 0)
+				cost *= 1.f - params.emptySpaceBonus;
+			cost += params.traversalCost;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				splitAxis = (CardinalAxis)axis;
+				splitPos = pos;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+template<typename T>
+void KdTree<T>::BuildNode(Subtree &subtree, int nodeIndex, std::vector<u32> &nodeObjects, const AABB &nodeAABB, int depth,
+	int numThreads, const KdTreeBuildParams &params, const AABB *objectAABBs) const
+{
+	const int numObjects = (int)nodeObjects.size();
+	CardinalAxis splitAxis = AxisNone;
+	float splitPos = 0.f;
+	if (numObjects > params.maxLeafObjects && depth < params.maxDepth)
+	{
+		if (params.splitMethod == KdTreeSplitSAH)
+			FindSAHSplit(nodeObjects, nodeAABB, params, objectAABBs, splitAxis, splitPos);
+		else
 		{
-			*r++ = *curObject;
-			++numObjectsRight;
+			// Choose the longest axis of the objects in this node and split at its centre.
+			AABB objectsAABB;
+			objectsAABB.SetNegativeInfinity();
+			for(int i = 0; i < numObjects; ++i)
+				objectsAABB.Enclose(objectAABBs[nodeObjects[i]]);
+			splitAxis = (CardinalAxis)objectsAABB.Size().MaxElementIndex();
+			splitPos = objectsAABB.CenterPoint()[splitAxis];
 		}
-		++curObject;
 	}
-	*l = BUCKET_SENTINEL;
-	*r = BUCKET_SENTINEL;
 
-	// If we cannot split according to the given split axis, abort the whole process.
-	if (numObjectsLeft == numObjectsInBucket || numObjectsRight == numObjectsInBucket)
+	std::vector<u32> leftObjects;
+	std::vector<u32> rightObjects;
+	if (splitAxis != AxisNone)
 	{
-		delete[] leftBucket;
-		delete[] rightBucket;
-		return;
+		// Sort all objects into the left and right children.
+		for(int i = 0; i < numObjects; ++i)
+		{
+			const AABB &aabb = objectAABBs[nodeObjects[i]];
+			bool left = aabb.minPoint[splitAxis] < splitPos;
+			bool right = aabb.maxPoint[splitAxis] > splitPos;
+			if (!left && !right)
+				left = right = true; // The object lies on the split plane (or is NaN), so place into both children.
+			if (left)
+				leftObjects.push_back(nodeObjects[i]);
+			if (right)
+				rightObjects.push_back(nodeObjects[i]);
+		}
+
+		// If the split does not separate anything, make this node a leaf.
+		if ((int)leftObjects.size() == numObjects && (int)rightObjects.size() == numObjects)
+			splitAxis = AxisNone;
+		// The midpoint split does not cut off empty space, so it needs to separate some objects to progress.
+		else if (params.splitMethod == KdTreeSplitMidpoint && ((int)leftObjects.size() == numObjects || (int)rightObjects.size() == numObjects))
+			splitAxis = AxisNone;
 	}
 
-	// Ok to split. Turn this leaf node into an inner node.
-	node->splitAxis = splitAxis;
-	node->splitPos = splitPos;
+	if (splitAxis == AxisNone)
+	{
+		// Make this node a leaf. Its objects are stored as a bucket of their own, empty leaves share bucket 0.
+		KdTreeNode &leaf = subtree.nodes[nodeIndex];
+		leaf.splitAxis = AxisNone;
+		leaf.childIndex = 0;
+		leaf.bucketIndex = 0;
+		if (numObjects > 0)
+		{
+			leaf.bucketIndex = (u32)subtree.buckets.size();
+			subtree.buckets.insert(subtree.buckets.end(), nodeObjects.begin(), nodeObjects.end());
+			subtree.buckets.push_back(BUCKET_SENTINEL);
+		}
+		return;
+	}
 
-	// Allocate nodes for the children.
-	int childIndex = AllocateNodePair();
-	node = &nodes[nodeIndex]; // AllocateNodePair() above invalidates the 'node' pointer! Recompute it.
-	node->childIndex = childIndex;
+	// Turn this node into an inner node.
+	int childIndex = AllocateNodePair(subtree.nodes);
+	KdTreeNode &node = subtree.nodes[nodeIndex];
+	node.splitAxis = splitAxis;
+	node.childIndex = childIndex;
+	node.splitPos = splitPos;
+	std::vector<u32>().swap(nodeObjects); // Free the memory of this node before recursing.
 
-	// Recompute tighter AABB's for the children which have now been populated with objects.
-	leftAABB = BoundingAABB(leftBucket);
-	rightAABB = BoundingAABB(rightBucket);
+	AABB leftAABB = nodeAABB;
+	AABB rightAABB = nodeAABB;
+	if (params.splitMethod == KdTreeSplitSAH)
+	{
+		leftAABB.maxPoint[splitAxis] = splitPos;
+		rightAABB.minPoint[splitAxis] = splitPos;
+	}
 
-	// For the left child, reuse the bucket index the parent had. (free the bucket of the parent)
-	KdTreeNode *leftChild = &nodes[childIndex];
-	delete[] buckets[curBucketIndex];
-	buckets[curBucketIndex] = leftBucket;
-	leftChild->bucketIndex = curBucketIndex;
+#ifndef MATH_NO_THREADS
+	// Build the right child on another thread if there is work enough for both.
+	if (numThreads > 1 && (int)leftObjects.size() >= params.minParallelObjects && (int)rightObjects.size() >= params.minParallelObjects)
+	{
+		Subtree rightSubtree;
+		std::thread thread(&KdTree<T>::BuildSubtreeThread, this, &rightSubtree, &rightObjects, &rightAABB, depth + 1,
+			numThreads / 2, &params, objectAABBs);
+		BuildNode(subtree, childIndex, leftObjects, leftAABB, depth + 1, numThreads - numThreads / 2, params, objectAABBs);
+		thread.join();
+		AppendSubtree(subtree, childIndex + 1, rightSubtree);
+		return;
+	}
+#endif
 
-	// For the right child, allocate a new bucket.
-	KdTreeNode *rightChild = &nodes[childIndex+1];
-	rightChild->bucketIndex = (u32)buckets.size();
-	buckets.push_back(rightBucket);
+	BuildNode(subtree, childIndex, leftObjects, leftAABB, depth + 1, numThreads, params, objectAABBs);
+	BuildNode(subtree, childIndex + 1, rightObjects, rightAABB, depth + 1, numThreads, params, objectAABBs);
+}
 
-	assert(numObjectsLeft < numObjectsInBucket && numObjectsRight < numObjectsInBucket);
+template<typename T>
+void KdTree<T>::BuildSubtreeThread(const KdTree<T> *tree, Subtree *subtree, std::vector<u32> *nodeObjects,
+	const AABB *nodeAABB, int depth, int numThreads, const KdTreeBuildParams *params, const AABB *objectAABBs)
+{
+	AllocateNodePair(subtree->nodes); // Index 1 is the root, index 2 is unused.
+	subtree->nodes.pop_back();
+	tree->BuildNode(*subtree, 1, *nodeObjects, *nodeAABB, depth, numThreads, *params, objectAABBs);
+}
 
-	// Recursively split children.
-	if (numObjectsLeft > 16)
-		SplitLeaf(childIndex, leftAABB, numObjectsLeft, leafDepth + 1);
-	if (numObjectsRight > 16)
-		SplitLeaf(childIndex+1, rightAABB, numObjectsRight, leafDepth + 1);
+template<typename T>
+void KdTree<T>::AppendSubtree(Subtree &dst, int nodeIndex, const Subtree &src)
+{
+	// The nodes of the source from index 2 onwards are appended in order and the buckets from index 1 onwards,
+	// so the indices into them move by a constant offset.
+	const u32 nodeOffset = (u32)dst.nodes.size() - 2;
+	const u32 bucketOffset = (u32)dst.buckets.size() - 1;
+	assume(dst.nodes.size() + src.nodes.size() <= (1 << 30) && "KdTree: Too many nodes for the 30 bits of KdTreeNode::childIndex!");
+	dst.nodes.reserve(dst.nodes.size() + src.nodes.size() - 2);
+	for(size_t i = 1; i < src.nodes.size(); ++i)
+	{
+		KdTreeNode n = src.nodes[i];
+		if (!n.IsLeaf())
+			n.childIndex += nodeOffset;
+		else if (n.bucketIndex != 0)
+			n.bucketIndex += bucketOffset;
+		if (i == 1)
+			dst.nodes[nodeIndex] = n;
+		else
+			dst.nodes.push_back(n);
+	}
+	dst.buckets.insert(dst.buckets.end(), src.buckets.begin() + 1, src.buckets.end());
 }
 
 template<typename T>
 KdTree<T>::~KdTree()
 {
-	FreeBuckets();
 }
 
 template<typename T>
 u32 *KdTree<T>::Bucket(int bucketIndex)
 {
-	return buckets[bucketIndex];
+	return &buckets[bucketIndex];
 }
 
 template<typename T>
 const u32 *KdTree<T>::Bucket(int bucketIndex) const
 {
-	return buckets[bucketIndex];
+	return &buckets[bucketIndex];
 }
 
 template<typename T>
@@ -245,38 +384,44 @@ void KdTree<T>::AddObjects(const T *objects_, int numObjects)
 template<typename T>
 void KdTree<T>::Build()
 {
-	nodes.clear();
-	FreeBuckets();
-
-	// Allocate a dummy node to be stored at index 0 (for safety).
-	KdTreeNode dummy;
-	dummy.splitAxis = AxisNone;
-	dummy.childIndex = 0;
-	dummy.bucketIndex = 0;
-	nodes.push_back(dummy); // Index 0 - dummy unused node, "null pointer".
-
-	// Allocate a dummy bucket at index 0, to denote that a leaf is empty.
-	buckets.push_back(0);
+	Build(KdTreeBuildParams(KdTreeSplitMidpoint));
+}
 
-	// Add a root node for the tree.
-	KdTreeNode rootNode;
-	rootNode.splitAxis = AxisNone;
-	rootNode.childIndex = 0;
-	rootNode.bucketIndex = 1;
-	nodes.push_back(rootNode);
+template<typename T>
+void KdTree<T>::Build(const KdTreeBuildParams &params_)
+{
+	const int numObjects = NumObjects();
+
+	KdTreeBuildParams params = params_;
+	if (params.maxDepth <= 0)
+		params.maxDepth = 8 + (int)(1.3f * Log2((float)Max(numObjects, 1)));
+	params.maxDepth = Min(params.maxDepth, (int)maxTreeDepth);
+	int numThreads = params.numThreads;
+#ifndef MATH_NO_THREADS
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+#endif
+	numThreads = Max(numThreads, 1);
 
-	// Initially, add all objects to the root node.
-	u32 *rootBucket = new u32[NumObjects()+1];
-	for(int i = 0; i < NumObjects(); ++i)
-		rootBucket[i] = (u32)i;
-	rootBucket[NumObjects()] = BUCKET_SENTINEL;
-	buckets.push_back(rootBucket);
+	// The bounding boxes of the objects are needed at every level, so compute them once.
+	std::vector<AABB> objectAABBs(numObjects);
+	rootAABB.SetNegativeInfinity();
+	for(int i = 0; i < numObjects; ++i)
+	{
+		objectAABBs[i] = Object(i).BoundingAABB();
+		rootAABB.Enclose(objectAABBs[i]);
+	}
 
-	rootAABB = BoundingAABB(rootBucket);
+	// Initially, add all objects to the root node, and recursively subdivide until the whole tree is built.
+	std::vector<u32> rootObjects(numObjects);
+	for(int i = 0; i < numObjects; ++i)
+		rootObjects[i] = (u32)i;
 
-	// We now have a single root leaf node which is unsplit and contains all the objects
-	// in the kD-tree. Now recursively subdivide until the whole tree is built.
-	SplitLeaf(1, rootAABB, NumObjects(), 1);
+	Subtree tree;
+	tree.nodes.reserve(numObjects > 0 ? 2 * numObjects : 2);
+	BuildSubtreeThread(this, &tree, &rootObjects, &rootAABB, 1, numThreads, &params, numObjects > 0 ? &objectAABBs[0] : 0);
+	nodes.swap(tree.nodes);
+	buckets.swap(tree.buckets);
 
 #ifdef _DEBUG
 	needsBuilding = false;
@@ -356,7 +501,7 @@ inline void KdTree<T>::RayQuery(const Ray &r, Func &nodeProcessFunc)
 		StackPtr prev; // index (pointer) to the previous item in stack.
 	};
 
-	const int cMaxStackItems = 50*2;
+	const int cMaxStackItems = maxTreeDepth*2;
 	StackElem stack[cMaxStackItems];
 
 	KdTreeNode *farChild;
@@ -448,6 +593,155 @@ inline void KdTree<T>::RayQuery(const Ray &r, Func &nodeProcessFunc)
 	}
 }
 
+template<typename T>
+template<int N, typename Func>
+inline void KdTree<T>::RayPacketQuery(const Ray *rays, u32 rayMask, Func &leafCallback)
+{
+	assume(N > 0 && N <= 32);
+	assume(rootAABB.IsFinite());
+	assume(!rootAABB.IsDegenerate());
+#ifdef _DEBUG
+	assume(!needsBuilding);
+#endif
+
+	struct StackElem
+	{
+		int nodeIndex;
+		u32 rayMask; // The rays which still have to visit this node.
+		float tNear[N];
+		float tFar[N];
+	};
+
+	// Each node on the path to the current node has pushed at most a far child and a deferred half of the packet.
+	const int cMaxStackItems = maxTreeDepth*2+2;
+	StackElem stack[cMaxStackItems];
+
+	// The origins and inverse directions of the rays, one array per axis. A zero direction component is replaced
+	// by a large number, so that the distances to the planes along that axis are huge but not NaN.
+	float pos[3][N];
+	float invDir[3][N];
+	u32 negDir[3] = { 0, 0, 0 }; // The rays with a negative direction along each axis.
+
+	// Clip the rays to the root box.
+	StackElem &root = stack[0];
+	root.nodeIndex = 1;
+	root.rayMask = 0;
+	for(int i = 0; i < N; ++i)
+	{
+		float tNear = 0.f, tFar = FLOAT_INF;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			pos[axis][i] = rays[i].pos[axis];
+			invDir[axis][i] = (rays[i].dir[axis] != 0.f) ? 1.f / rays[i].dir[axis] : 1e30f;
+			if (invDir[axis][i] < 0.f)
+				negDir[axis] |= 1u << i;
+			const float t1 = (rootAABB.minPoint[axis] - pos[axis][i]) * invDir[axis][i];
+			const float t2 = (rootAABB.maxPoint[axis] - pos[axis][i]) * invDir[axis][i];
+			tNear = Max(tNear, Min(t1, t2));
+			tFar = Min(tFar, Max(t1, t2));
+		}
+		root.tNear[i] = tNear;
+		root.tFar[i] = tFar;
+		if ((rayMask & (1u << i)) != 0 && tNear <= tFar)
+			root.rayMask |= 1u << i;
+	}
+
+	u32 finished = 0;
+	int stackSize = (root.rayMask != 0) ? 1 : 0;
+	while(stackSize > 0)
+	{
+		StackElem cur = stack[--stackSize];
+		cur.rayMask &= ~finished;
+		if (!cur.rayMask)
+			continue; // Every ray of this node has already hit something nearer.
+
+		while(!nodes[cur.nodeIndex].IsLeaf())
+		{
+			const KdTreeNode &node = nodes[cur.nodeIndex];
+			const int axis = node.splitAxis;
+			u32 neg = cur.rayMask & negDir[axis];
+			if (neg != 0 && neg != cur.rayMask)
+			{
+				// The rays go in opposite directions along the split axis, so they visit the children in
+				// opposite orders. Continue with the positive rays and trace the negative ones later.
+				assert(stackSize < cMaxStackItems);
+				StackElem &deferred = stack[stackSize++];
+				deferred = cur;
+				deferred.rayMask = neg;
+				cur.rayMask &= ~neg;
+				neg = 0;
+			}
+			const int nearChild = neg ? node.RightChildIndex() : node.LeftChildIndex();
+			const int farChild = neg ? node.LeftChildIndex() : node.RightChildIndex();
+
+			float tSplit[N];
+			u32 nearMask = 0, farMask = 0;
+			for(int i = 0; i < N; ++i)
+			{
+				tSplit[i] = (node.splitPos - pos[axis][i]) * invDir[axis][i];
+				if (cur.tNear[i] <= tSplit[i])
+					nearMask |= 1u << i;
+				if (cur.tFar[i] >= tSplit[i])
+					farMask |= 1u << i;
+			}
+			nearMask &= cur.rayMask;
+			farMask &= cur.rayMask;
+
+			if (!farMask)
+				cur.nodeIndex = nearChild;
+			else if (!nearMask)
+				cur.nodeIndex = farChild;
+			else
+			{
+				// Some rays pass through both children. Visit the near child first and the far one later.
+				assert(stackSize < cMaxStackItems);
+				StackElem &farElem = stack[stackSize++];
+				farElem.nodeIndex = farChild;
+				farElem.rayMask = farMask;
+				for(int i = 0; i < N; ++i)
+				{
+					farElem.tNear[i] = Max(cur.tNear[i], tSplit[i]);
+					farElem.tFar[i] = cur.tFar[i];
+					cur.tFar[i] = Min(cur.tFar[i], tSplit[i]);
+				}
+				cur.nodeIndex = nearChild;
+				cur.rayMask = nearMask;
+			}
+		}
+
+		const KdTreeNode &leaf = nodes[cur.nodeIndex];
+		if (!leaf.IsEmptyLeaf())
+			finished |= leafCallback(*this, leaf, rays, cur.tNear, cur.tFar, cur.rayMask) & cur.rayMask;
+	}
+}
+
+template<typename T>
+void KdTree<T>::IntersectRays(const Ray *rays, int numRays, RayTriangleHit *outHits)
+{
+#ifdef MATH_AVX
+	const int N = 8;
+#else
+	const int N = 4;
+#endif
+	Ray packet[N];
+	for(int i = 0; i < numRays; i += N)
+	{
+		const int n = Min(N, numRays - i);
+		const Ray *packetRays = rays + i;
+		if (n < N)
+		{
+			// Pad the last packet with copies of its last ray, which are masked out.
+			for(int j = 0; j < N; ++j)
+				packet[j] = rays[i + Min(j, n-1)];
+			packetRays = packet;
+		}
+		TriangleKdTreeRayPacketNearestHitVisitor<N> visitor;
+		RayPacketQuery<N>(packetRays, (1u << n) - 1, visitor);
+		for(int j = 0; j < n; ++j)
+			outHits[i+j] = visitor.hits[j];
+	}
+}
+
 template<typename T>
 template<typename Func>
 inline void KdTree<T>::AABBQuery(const AABB &aabb, Func &leafCallback)
@@ -462,6 +756,12 @@ inline void KdTree<T>::AABBQuery(const AABB &aabb, Func &leafCallback)
 	if (!aabb.Intersects(BoundingAABB()))
 		return;
 
+	if (stack[0]->IsLeaf()) // The whole tree is a single leaf.
+	{
+		leafCallback(*this, *stack[0], aabb);
+		return;
+	}
+
 	while(stackSize > 0)
 	{
 		KdTreeNode *cur = stack[--stackSize];
@@ -498,175 +798,76 @@ inline void KdTree<T>::AABBQuery(const AABB &aabb, Func &leafCallback)
 	}
 }
 
-#if 0 ///\bug Doesn't work properly. Fix up!
-
-struct StackElem
-{
-	KdTreeNode *thisNode;
-	KdTreeNode *tree2Node;
-	AABB thisAABB;
-	AABB tree2AABB;
-	OBB tree2OBB;
-};
-
-///\todo Fix up thread-safety!
-const int cMaxStackItems = 50*2;
-StackElem stack[cMaxStackItems*1000];
-
-
 template<typename T>
 template<typename Func>
 inline void KdTree<T>::KdTreeQuery(KdTree<T> &tree2, const float3x4 &thisWorldTransform, const float3x4 &tree2WorldTransform, Func &leafCallback)
 {
-	float3x4 tree2Transform = thisWorldTransform.Inverted() * tree2WorldTransform;
+	if (!Root() || !tree2.Root())
+		return;
 
-	int stackSize = 1;
-	stack[0].thisNode = Root();
-	stack[0].thisAABB = BoundingAABB();
-	stack[0].tree2Node = tree2.Root();
-	stack[0].tree2AABB = tree2.BoundingAABB();	
-	OBB tree2OBB = stack[0].tree2AABB.Transform(tree2Transform);
-	stack[0].tree2OBB = tree2OBB;
-
-	if (!stack[0].thisAABB.Intersects(tree2OBB))
+	// Transforms from the local space of tree2 to the local space of this tree.
+	const float3x4 tree2Transform = thisWorldTransform.Inverted() * tree2WorldTransform;
+
+	std::vector<NodePair, AlignedAllocator<NodePair, 16> > stack;
+	NodePair root;
+	root.thisNode = Root();
+	root.thisAABB = BoundingAABB();
+	root.tree2Node = tree2.Root();
+	root.tree2AABB = tree2.BoundingAABB();
+	root.tree2OBB = root.tree2AABB.Transform(tree2Transform);
+	if (!root.thisAABB.Intersects(root.tree2OBB))
 		return;
+	stack.push_back(root);
 
-	while(stackSize > 0)
+	while(!stack.empty())
 	{
-		assert(stackSize < cMaxStackItems*100);
-		--stackSize;
-		KdTreeNode *thisNode = stack[stackSize].thisNode;
-		KdTreeNode *tree2Node = stack[stackSize].tree2Node;
-		AABB thisAABB = stack[stackSize].thisAABB;
-		AABB tree2AABB = stack[stackSize].tree2AABB;
-		OBB tree2OBB = stack[stackSize].tree2OBB;
-
-		if (thisNode->IsLeaf() && tree2Node->IsLeaf())
-		{
-			if (leafCallback(*this, *thisNode, thisAABB, tree2, *tree2Node, tree2OBB, tree2Transform))
-				return;
-		}
-		else if (thisNode->IsLeaf())
-		{
-			if (thisNode->IsEmptyLeaf())
-				continue; // We hit an empty leaf, no need to test this against tree2.
-
-			// Test this leaf node against both children of the tree2 inner node.
-			KdTreeNode *tree2LeftChild = &tree2.nodes[tree2Node->LeftChildIndex()];
-			KdTreeNode *tree2RightChild = &tree2.nodes[tree2Node->RightChildIndex()];
-			AABB tree2LeftAABB = tree2AABB;
-			AABB tree2RightAABB = tree2AABB;
-			tree2LeftAABB.maxPoint[tree2Node->splitAxis] = tree2Node->splitPos;
-			tree2RightAABB.minPoint[tree2Node->splitAxis] = tree2Node->splitPos;
-			OBB tree2LeftOBB = tree2LeftAABB.Transform(tree2Transform);
-			OBB tree2RightOBB = tree2RightAABB.Transform(tree2Transform);
-		//	if (thisAABB.Intersects(tree2LeftOBB))
-			{
-				stack[stackSize].tree2Node = tree2LeftChild;
-				stack[stackSize].tree2AABB = tree2LeftAABB;
-				stack[stackSize].tree2OBB = tree2LeftOBB;
-				++stackSize;
-			}
-		//	if (thisAABB.Intersects(tree2RightOBB))
-			{
-				stack[stackSize].thisNode = thisNode;
-				stack[stackSize].thisAABB = thisAABB;
-				stack[stackSize].tree2Node = tree2RightChild;
-				stack[stackSize].tree2AABB = tree2RightAABB;
-				stack[stackSize].tree2OBB = tree2RightOBB;
-				++stackSize;
-			}
-		}
-		else if (tree2Node->IsLeaf())
+		const NodePair cur = stack.back();
+		stack.pop_back();
+
+		if (cur.thisNode->IsLeaf() && cur.tree2Node->IsLeaf())
 		{
-			if (tree2Node->IsEmptyLeaf())
-				continue; // We hit an empty leaf, no need to test the node against this tree further.
-
-			// Test both children of this inner node against the tree2 leaf node.
-			KdTreeNode *leftChild = &nodes[thisNode->LeftChildIndex()];
-			KdTreeNode *rightChild = &nodes[thisNode->RightChildIndex()];
-			AABB leftAABB = thisAABB;
-			AABB rightAABB = thisAABB;
-			leftAABB.maxPoint[thisNode->splitAxis] = thisNode->splitPos;
-			rightAABB.minPoint[thisNode->splitAxis] = thisNode->splitPos;
-		//	if (leftAABB.Intersects(tree2OBB))
-			{
-				stack[stackSize].thisNode = leftChild;
-				stack[stackSize].thisAABB = leftAABB;
-				++stackSize;
-			}
-		//	if (rightAABB.Intersects(tree2OBB))
-			{
-				stack[stackSize].thisNode = rightChild;
-				stack[stackSize].thisAABB = rightAABB;
-				stack[stackSize].tree2Node = tree2Node;
-				stack[stackSize].tree2AABB = tree2AABB;
-				stack[stackSize].tree2OBB = tree2OBB;
-				++stackSize;
-			}
+			if (!cur.thisNode->IsEmptyLeaf() && !cur.tree2Node->IsEmptyLeaf()
+				&& leafCallback(*this, *cur.thisNode, cur.thisAABB, tree2, *cur.tree2Node, cur.tree2OBB))
+				return; // The callback requested to terminate the query, so quit.
+			continue;
 		}
-		else
+
+		// Descend into the larger of the two nodes, so that the boxes tested stay of similar size.
+		const bool splitThis = cur.tree2Node->IsLeaf() || (!cur.thisNode->IsLeaf() && cur.thisAABB.Volume() >= cur.tree2AABB.Volume());
+		NodePair child = cur;
+		for(int i = 0; i < 2; ++i)
 		{
-			// Test all child node pairs.
-			KdTreeNode *leftChild = &nodes[thisNode->LeftChildIndex()];
-			KdTreeNode *rightChild = &nodes[thisNode->RightChildIndex()];
-			AABB leftAABB = thisAABB;
-			AABB rightAABB = thisAABB;
-			leftAABB.maxPoint[thisNode->splitAxis] = thisNode->splitPos;
-			rightAABB.minPoint[thisNode->splitAxis] = thisNode->splitPos;
-
-			KdTreeNode *tree2LeftChild = &tree2.nodes[tree2Node->LeftChildIndex()];
-			KdTreeNode *tree2RightChild = &tree2.nodes[tree2Node->RightChildIndex()];
-			AABB tree2LeftAABB = tree2AABB;
-			AABB tree2RightAABB = tree2AABB;
-			tree2LeftAABB.maxPoint[tree2Node->splitAxis] = tree2Node->splitPos;
-			tree2RightAABB.minPoint[tree2Node->splitAxis] = tree2Node->splitPos;
-			OBB tree2LeftOBB = tree2LeftAABB.Transform(tree2Transform);
-			OBB tree2RightOBB = tree2RightAABB.Transform(tree2Transform);
-
-			if (leftAABB.Intersects(tree2LeftOBB))
+			if (splitThis)
 			{
-				stack[stackSize].thisNode = leftChild;
-				stack[stackSize].thisAABB = leftAABB;
-				stack[stackSize].tree2Node = tree2LeftChild;
-				stack[stackSize].tree2AABB = tree2LeftAABB;
-				stack[stackSize].tree2OBB = tree2LeftOBB;
-				++stackSize;
-			}
-			if (rightAABB.Intersects(tree2LeftOBB))
-			{
-				stack[stackSize].thisNode = rightChild;
-				stack[stackSize].thisAABB = rightAABB;
-				stack[stackSize].tree2Node = tree2LeftChild;
-				stack[stackSize].tree2AABB = tree2LeftAABB;
-				stack[stackSize].tree2OBB = tree2LeftOBB;
-				++stackSize;
-			}
-			if (leftAABB.Intersects(tree2RightOBB))
-			{
-				stack[stackSize].thisNode = leftChild;
-				stack[stackSize].thisAABB = leftAABB;
-				stack[stackSize].tree2Node = tree2RightChild;
-				stack[stackSize].tree2AABB = tree2RightAABB;
-				stack[stackSize].tree2OBB = tree2RightOBB;
-				++stackSize;
+				const KdTreeNode *node = cur.thisNode;
+				child.thisNode = &nodes[i == 0 ? node->LeftChildIndex() : node->RightChildIndex()];
+				child.thisAABB = cur.thisAABB;
+				if (i == 0)
+					child.thisAABB.maxPoint[node->splitAxis] = node->splitPos;
+				else
+					child.thisAABB.minPoint[node->splitAxis] = node->splitPos;
+				if (child.thisNode->IsLeaf() && child.thisNode->IsEmptyLeaf())
+					continue;
 			}
-			if (rightAABB.Intersects(tree2RightOBB))
+			else
 			{
-				stack[stackSize].thisNode = rightChild;
-				stack[stackSize].thisAABB = rightAABB;
-				stack[stackSize].tree2Node = tree2RightChild;
-				stack[stackSize].tree2AABB = tree2RightAABB;
-				stack[stackSize].tree2OBB = tree2RightOBB;
-				++stackSize;
+				const KdTreeNode *node = cur.tree2Node;
+				child.tree2Node = &tree2.nodes[i == 0 ? node->LeftChildIndex() : node->RightChildIndex()];
+				child.tree2AABB = cur.tree2AABB;
+				if (i == 0)
+					child.tree2AABB.maxPoint[node->splitAxis] = node->splitPos;
+				else
+					child.tree2AABB.minPoint[node->splitAxis] = node->splitPos;
+				if (child.tree2Node->IsLeaf() && child.tree2Node->IsEmptyLeaf())
+					continue;
+				child.tree2OBB = child.tree2AABB.Transform(tree2Transform);
 			}
+			if (child.thisAABB.Intersects(child.tree2OBB))
+				stack.push_back(child);
 		}
 	}
 }
 
-#endif
-
-#ifdef MATH_CONTAINERLIB_SUPPORT
 struct NearestObjectsTraversalNode
 {
 	float d;
@@ -680,20 +881,28 @@ template<typename T>
 template<typename Func>
 inline void KdTree<T>::NearestObjects(const vec &point, Func &leafCallback)
 {
-	MaxHeap<NearestObjectsTraversalNode> queue;
+	if (!Root())
+		return;
+
+	// A min-heap of the nodes to visit by their distance to the point.
+	std::vector<NearestObjectsTraversalNode, AlignedAllocator<NearestObjectsTraversalNode, 16> > queue;
 	NearestObjectsTraversalNode t;
-	t.d = 0.f;
+	t.d = BoundingAABB().Distance(point);
 	t.aabb = BoundingAABB();
 	t.node = Root();
-	queue.Insert(t);
+	queue.push_back(t);
 
-	while(queue.Size() > 0)
+	while(!queue.empty())
 	{
-		t = queue.Front();
-		queue.PopFront();
+		std::pop_heap(queue.begin(), queue.end());
+		t = queue.back();
+		queue.pop_back();
 
 		if (t.node->IsLeaf())
-			leafCallback(*this, point, *t.node, t.aabb, t.d);
+		{
+			if (!t.node->IsEmptyLeaf() && leafCallback(*this, point, *t.node, t.aabb, t.d))
+				return; // The callback requested to terminate the query, so quit.
+		}
 		else
 		{
 			NearestObjectsTraversalNode n;
@@ -702,18 +911,37 @@ inline void KdTree<T>::NearestObjects(const vec &point, Func &leafCallback)
 			n.aabb = t.aabb;
 			n.aabb.maxPoint[t.node->splitAxis] = t.node->splitPos;
 			n.node = &nodes[t.node->LeftChildIndex()];
-			n.d = n.aabb.Distance(point);
-			queue.Insert(n);
+			n.d = Max(t.d, n.aabb.Distance(point));
+			queue.push_back(n);
+			std::push_heap(queue.begin(), queue.end());
 
 			// Insert right child node to the traversal queue.
 			n.aabb.maxPoint[t.node->splitAxis] = t.aabb.maxPoint[t.node->splitAxis]; /// Restore the change done above.
 			n.aabb.minPoint[t.node->splitAxis] = t.node->splitPos;
 			n.node = &nodes[t.node->RightChildIndex()];
-			n.d = n.aabb.Distance(point);
-			queue.Insert(n);
+			n.d = Max(t.d, n.aabb.Distance(point));
+			queue.push_back(n);
+			std::push_heap(queue.begin(), queue.end());
 		}
 	}
 }
-#endif
+
+template<typename T>
+int KdTree<T>::KNearestObjects(const vec &point, int k, u32 *outObjectIndices, float *outDistances, float maxDistance)
+{
+	KdTreeNearestObjectsVisitor<T> visitor(k, maxDistance);
+	NearestObjects(point, visitor);
+	return visitor.queue.PopSorted(outObjectIndices, outDistances);
+}
+
+template<typename T>
+void KdTree<T>::ObjectsWithinDistance(const vec &point, float maxDistance, std::vector<u32> &outObjectIndices)
+{
+	KdTreeObjectsWithinDistanceVisitor<T> visitor(maxDistance);
+	NearestObjects(point, visitor);
+	std::sort(visitor.objectIndices.begin(), visitor.objectIndices.end());
+	visitor.objectIndices.erase(std::unique(visitor.objectIndices.begin(), visitor.objectIndices.end()), visitor.objectIndices.end());
+	outObjectIndices.insert(outObjectIndices.end(), visitor.objectIndices.begin(), visitor.objectIndices.end());
+}
 
 MATH_END_NAMESPACE
@@ -0,0 +1,167 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file LooseQuadTree.h
+	@author Jukka Jylnki
+	@brief A loose QuadTree for objects that move every frame. */
+#pragma once
+
+#include "../Math/float2.h"
+#include "AABB2D.h"
+#include "../Math/MathTypes.h"
+#include <vector>
+
+MATH_BEGIN_NAMESPACE
+
+/// A loose QuadTree for objects that move every frame, e.g. the particles of a 2D simulation.
+/** Each node is a square, and holds the objects whose center lies inside the square and which are too large for
+	its children. The objects of a node may reach out of the square by up to its half side length, so each node
+	bounds its objects by its "loose" square of twice the side length. The node of an object depends only on its
+	center and size, and not on the other objects in the tree, so an object that moves only a little stays in
+	its node and Update() takes constant time. An object that moves to another node is moved from the nearest
+	common ancestor of the nodes, and the nodes are allocated from a pool, so Update() and Remove() run in
+	amortized constant time for objects that move a bounded distance per update.
+
+	The root grows to cover any object that is added or moved outside it. Unlike QuadTree, the nodes store their
+	extents, and refer to each other by index, so the tree has no limit on the number of nodes.
+
+	To place objects of type T into a LooseQuadTree, define a function AABB2D GetAABB2D(const T &object) that
+	returns the bounds of the object. The tree refers to its objects by the handles returned by Add(). */
+template<typename T>
+class LooseQuadTree
+{
+public:
+	/// Identifies an object in the tree. Stays valid until the object is removed.
+	typedef int ObjectHandle;
+
+	struct Node
+	{
+		Node():center(0.f, 0.f), radius(0.f), parent(-1), numChildren(0)
+		{
+			children[0] = children[1] = children[2] = children[3] = -1;
+		}
+
+		/// The center of the square of this node.
+		float2 center;
+		/// Half the side length of the square of this node. The objects of this node lie within 2*radius of center.
+		float radius;
+		/// The index of the parent node, or -1 if this node is the root.
+		int parent;
+		/// The indices of the child nodes, or -1 for the children that have not been allocated. In the order
+		/// top-left (-x, -y), top-right (+x, -y), bottom-left (-x, +y), bottom-right (+x, +y), as in QuadTree.
+		int children[4];
+		/// The number of children of this node that are not -1.
+		int numChildren;
+		/// The objects in this node.
+		std::vector<ObjectHandle> objects;
+
+		/// Returns the square that bounds the objects of this node.
+		AABB2D LooseAABB() const { return AABB2D(center - float2(2.f * radius), center + float2(2.f * radius)); }
+	};
+
+	LooseQuadTree();
+
+	/// Removes all objects and nodes in this tree, and reinitializes the root node to cover the given rectangle.
+	/** The root grows later on if objects are placed outside it, so the rectangle need not be exact.
+		@param minNodeSize The side length of the smallest nodes. Objects smaller than this, e.g. points, are placed in
+			nodes of this size. */
+	void Clear(const float2 &minXY = float2(-1.f, -1.f), const float2 &maxXY = float2(1.f, 1.f), float minNodeSize = 0.05f);
+
+	/// Adds the given object into the tree at the bounds given by GetAABB2D(object).
+	/// @return The handle that identifies the object in the tree.
+	ObjectHandle Add(const T &object);
+
+	/// Moves the given object in the tree to the bounds given by GetAABB2D() of it, after the object has moved.
+	void Update(ObjectHandle object);
+
+	/// Removes the given object from the tree.
+	void Remove(ObjectHandle object);
+
+	/// Returns the given object.
+	/// @note If the object is modified so that its bounds change, call Update() on it afterwards.
+	T &Object(ObjectHandle object) { assert(IsValid(object)); return objects[object].object; }
+	const T &Object(ObjectHandle object) const { assert(IsValid(object)); return objects[object].object; }
+
+	/// Returns the bounds of the given object when it was last added or updated.
+	const AABB2D &ObjectAABB(ObjectHandle object) const { assert(IsValid(object)); return objects[object].aabb; }
+
+	/// Returns the node that the given object is in.
+	const Node &ObjectNode(ObjectHandle object) const { assert(IsValid(object)); return nodes[objects[object].node]; }
+
+	/// Returns true if the given handle identifies an object in this tree.
+	bool IsValid(ObjectHandle object) const { return object >= 0 && object < (int)objects.size() && objects[object].node >= 0; }
+
+	/// Returns the square of the root node. Objects in the tree may reach out of it, but their centers do not.
+	AABB2D BoundingAABB() const;
+
+	/// @return The topmost node in the tree.
+	const Node *Root() const { return rootNodeIndex >= 0 ? &nodes[rootNodeIndex] : 0; }
+
+	/// Returns the number of objects in the tree. Runs in constant time.
+	int NumObjects() const { return numObjects; }
+
+	/// Returns the number of nodes in the tree. Runs in constant time.
+	int NumNodes() const { return (int)nodes.size() - (int)freeNodes.size(); }
+
+	/// Performs an AABB intersection query in this tree, and calls the given callback function for each object whose
+	/// bounds intersect the given AABB.
+	/** @param callback A function or a function object of prototype
+			bool callbackFunction(LooseQuadTree<T> &tree, const AABB2D &queryAABB, LooseQuadTree<T>::ObjectHandle object);
+		If the callback function returns true, the execution of the query is stopped and this function immediately
+		returns afterwards. If the callback function returns false, the execution of the query continues. */
+	template<typename Func>
+	inline void AABBQuery(const AABB2D &aabb, Func &callback);
+
+	/// Performs various consistency checks on the whole tree. Use only for debugging purposes.
+	void DebugSanityCheck() const;
+
+private:
+	struct ObjectEntry
+	{
+		T object;
+		AABB2D aabb;
+		/// The node the object is in, or -1 if this entry is free.
+		int node;
+		/// The index of the object in the objects array of its node. For a free entry, the index of the next free entry, or -1.
+		int slot;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> freeNodes; // Indices of the nodes in the above array that are free to reuse.
+	std::vector<ObjectEntry> objects;
+	int firstFreeObject; // The first free entry of the above array, or -1.
+
+	int rootNodeIndex;
+	float minNodeRadius;
+	int numObjects;
+
+	/// Returns true if an object with the given center and half size belongs to the given node or one of its descendants.
+	bool Fits(const Node &node, const float2 &center, float halfSize) const;
+
+	/// Adds the given object to the tree, starting from the given node, which the object must fit in.
+	void Place(ObjectHandle object, int startNode);
+	/// Removes the given object from the objects of its node.
+	void Detach(ObjectHandle object);
+	/// Frees the given node and its ancestors for as long as they have no objects and no children.
+	void Prune(int node);
+
+	int AllocateNode(int parent, int quadrant);
+	void GrowRoot(const float2 &towards);
+
+	static void ObjectBounds(const AABB2D &aabb, float2 &outCenter, float &outHalfSize);
+};
+
+MATH_END_NAMESPACE
+
+#include "LooseQuadTree.inl"
@@ -0,0 +1,346 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file LooseQuadTree.inl
+	@author Jukka Jylnki
+	@brief Implementation for the LooseQuadTree object. */
+#pragma once
+
+#include "../Math/MathFunc.h"
+
+MATH_BEGIN_NAMESPACE
+
+template<typename T>
+LooseQuadTree<T>::LooseQuadTree()
+:firstFreeObject(-1), rootNodeIndex(-1), minNodeRadius(0.025f), numObjects(0)
+{
+}
+
+template<typename T>
+void LooseQuadTree<T>::Clear(const float2 &minXY, const float2 &maxXY, float minNodeSize)
+{
+	assert(minNodeSize > 0.f);
+	nodes.clear();
+	freeNodes.clear();
+	objects.clear();
+	firstFreeObject = -1;
+	numObjects = 0;
+	minNodeRadius = minNodeSize * 0.5f;
+
+	rootNodeIndex = AllocateNode(-1, 0);
+	Node &root = nodes[rootNodeIndex];
+	root.center = (minXY + maxXY) * 0.5f;
+	root.radius = Max(Max(maxXY.x - minXY.x, maxXY.y - minXY.y) * 0.5f, minNodeRadius);
+}
+
+template<typename T>
+AABB2D LooseQuadTree<T>::BoundingAABB() const
+{
+	assert(Root());
+	const Node &root = nodes[rootNodeIndex];
+	return AABB2D(root.center - float2(root.radius), root.center + float2(root.radius));
+}
+
+template<typename T>
+void LooseQuadTree<T>::ObjectBounds(const AABB2D &aabb, float2 &outCenter, float &outHalfSize)
+{
+	assert(!aabb.HasNegativeVolume());
+	outCenter = (aabb.minPoint + aabb.maxPoint) * 0.5f;
+	outHalfSize = Max(aabb.maxPoint.x - aabb.minPoint.x, aabb.maxPoint.y - aabb.minPoint.y) * 0.5f;
+}
+
+template<typename T>
+bool LooseQuadTree<T>::Fits(const Node &node, const float2 &center, float halfSize) const
+{
+	return halfSize <= node.radius
+		&& center.x >= node.center.x - node.radius && center.x <= node.center.x + node.radius
+		&& center.y >= node.center.y - node.radius && center.y <= node.center.y + node.radius;
+}
+
+template<typename T>
+typename LooseQuadTree<T>::ObjectHandle LooseQuadTree<T>::Add(const T &object)
+{
+	assert(Root() && "Error: LooseQuadTree has not been initialized with a root node! Call LooseQuadTree::Clear() to initialize the root node.");
+
+	ObjectEntry e;
+	e.object = object;
+	e.aabb = GetAABB2D(object);
+	e.node = -1;
+	e.slot = -1;
+	assert(e.aabb.IsFinite());
+
+	ObjectHandle handle;
+	if (firstFreeObject >= 0)
+	{
+		handle = firstFreeObject;
+		firstFreeObject = objects[handle].slot;
+		objects[handle] = e;
+	}
+	else
+	{
+		handle = (ObjectHandle)objects.size();
+		objects.push_back(e);
+	}
+
+	float2 center;
+	float halfSize;
+	ObjectBounds(e.aabb, center, halfSize);
+	while(!Fits(nodes[rootNodeIndex], center, halfSize))
+		GrowRoot(center);
+	Place(handle, rootNodeIndex);
+	++numObjects;
+	return handle;
+}
+
+template<typename T>
+void LooseQuadTree<T>::Update(ObjectHandle object)
+{
+	assert(IsValid(object));
+	ObjectEntry &e = objects[object];
+	e.aabb = GetAABB2D(e.object);
+	assert(e.aabb.IsFinite());
+
+	float2 center;
+	float halfSize;
+	ObjectBounds(e.aabb, center, halfSize);
+
+	// The object stays in its node if its center is still inside the square of the node, and it is still too
+	// large for the children of the node.
+	const int oldNode = e.node;
+	const Node &n = nodes[oldNode];
+	const float childRadius = n.radius * 0.5f;
+	if (Fits(n, center, halfSize) && (halfSize > childRadius || childRadius < minNodeRadius))
+		return;
+
+	// Otherwise go up to the nearest ancestor the object fits in, and place the object from there down.
+	// The old node is pruned only after that, so that the ancestor is not freed in between.
+	int start = oldNode;
+	while(start != rootNodeIndex && !Fits(nodes[start], center, halfSize))
+		start = nodes[start].parent;
+	if (start == rootNodeIndex)
+		while(!Fits(nodes[rootNodeIndex], center, halfSize))
+		{
+			GrowRoot(center);
+			start = rootNodeIndex;
+		}
+
+	Detach(object);
+	Place(object, start);
+	Prune(oldNode);
+}
+
+template<typename T>
+void LooseQuadTree<T>::Remove(ObjectHandle object)
+{
+	assert(IsValid(object));
+	const int node = objects[object].node;
+	Detach(object);
+	Prune(node);
+
+	ObjectEntry &e = objects[object];
+	e.object = T();
+	e.node = -1;
+	e.slot = firstFreeObject;
+	firstFreeObject = object;
+	--numObjects;
+}
+
+template<typename T>
+void LooseQuadTree<T>::Place(ObjectHandle object, int node)
+{
+	float2 center;
+	float halfSize;
+	ObjectBounds(objects[object].aabb, center, halfSize);
+	assert(Fits(nodes[node], center, halfSize));
+
+	// Descend for as long as the object fits in the child that contains its center.
+	for(;;)
+	{
+		const float childRadius = nodes[node].radius * 0.5f;
+		if (halfSize > childRadius || childRadius < minNodeRadius)
+			break;
+		const int quadrant = (center.x >= nodes[node].center.x ? 1 : 0) + (center.y >= nodes[node].center.y ? 2 : 0);
+		int child = nodes[node].children[quadrant];
+		if (child < 0)
+			child = AllocateNode(node, quadrant);
+		node = child;
+	}
+
+	Node &n = nodes[node];
+	objects[object].node = node;
+	objects[object].slot = (int)n.objects.size();
+	n.objects.push_back(object);
+}
+
+template<typename T>
+void LooseQuadTree<T>::Detach(ObjectHandle object)
+{
+	ObjectEntry &e = objects[object];
+	std::vector<ObjectHandle> &nodeObjects = nodes[e.node].objects;
+	assert(nodeObjects[e.slot] == object);
+	const ObjectHandle last = nodeObjects.back();
+	nodeObjects[e.slot] = last;
+	objects[last].slot = e.slot;
+	nodeObjects.pop_back();
+}
+
+template<typename T>
+void LooseQuadTree<T>::Prune(int node)
+{
+	while(node != rootNodeIndex && nodes[node].objects.empty() && nodes[node].numChildren == 0)
+	{
+		Node &n = nodes[node];
+		Node &parent = nodes[n.parent];
+		for(int i = 0; i < 4; ++i)
+			if (parent.children[i] == node)
+				parent.children[i] = -1;
+		--parent.numChildren;
+		freeNodes.push_back(node);
+		node = n.parent;
+		n.parent = -1;
+	}
+}
+
+template<typename T>
+int LooseQuadTree<T>::AllocateNode(int parent, int quadrant)
+{
+	int index;
+	if (!freeNodes.empty())
+	{
+		index = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else
+	{
+		index = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+	// Note: nodes may have been reallocated above, so take the references only now.
+	Node &n = nodes[index];
+	n.parent = parent;
+	for(int i = 0; i < 4; ++i)
+		n.children[i] = -1;
+	n.numChildren = 0;
+	n.radius = 0.f;
+	assert(n.objects.empty()); // A reused node keeps the capacity of its object array.
+	if (parent >= 0)
+	{
+		Node &p = nodes[parent];
+		n.radius = p.radius * 0.5f;
+		n.center.x = p.center.x + ((quadrant & 1) ? n.radius : -n.radius);
+		n.center.y = p.center.y + ((quadrant & 2) ? n.radius : -n.radius);
+		assert(p.children[quadrant] == -1);
+		p.children[quadrant] = index;
+		++p.numChildren;
+	}
+	return index;
+}
+
+template<typename T>
+void LooseQuadTree<T>::GrowRoot(const float2 &towards)
+{
+	// Make a root of twice the size that extends toward the given point, with the old root as one of its quadrants.
+	const int oldRoot = rootNodeIndex;
+	const float2 oldCenter = nodes[oldRoot].center;
+	const float oldRadius = nodes[oldRoot].radius;
+	if (nodes[oldRoot].objects.empty() && nodes[oldRoot].numChildren == 0)
+	{
+		// The tree is empty, so just move the root.
+		nodes[oldRoot].radius = oldRadius * 2.f;
+		nodes[oldRoot].center.x = oldCenter.x + (towards.x < oldCenter.x ? -oldRadius : oldRadius);
+		nodes[oldRoot].center.y = oldCenter.y + (towards.y < oldCenter.y ? -oldRadius : oldRadius);
+		return;
+	}
+	const int newRoot = AllocateNode(-1, 0);
+	Node &root = nodes[newRoot];
+	root.radius = oldRadius * 2.f;
+	root.center.x = oldCenter.x + (towards.x < oldCenter.x ? -oldRadius : oldRadius);
+	root.center.y = oldCenter.y + (towards.y < oldCenter.y ? -oldRadius : oldRadius);
+	const int quadrant = (oldCenter.x >= root.center.x ? 1 : 0) + (oldCenter.y >= root.center.y ? 2 : 0);
+	root.children[quadrant] = oldRoot;
+	root.numChildren = 1;
+	nodes[oldRoot].parent = newRoot;
+	rootNodeIndex = newRoot;
+}
+
+template<typename T>
+template<typename Func>
+inline void LooseQuadTree<T>::AABBQuery(const AABB2D &aabb, Func &callback)
+{
+	if (rootNodeIndex < 0)
+		return;
+	std::vector<int> stack;
+	stack.push_back(rootNodeIndex);
+	while(!stack.empty())
+	{
+		const int nodeIndex = stack.back();
+		stack.pop_back();
+		const Node &n = nodes[nodeIndex];
+		const float looseRadius = 2.f * n.radius;
+		if (aabb.maxPoint.x < n.center.x - looseRadius || aabb.minPoint.x > n.center.x + looseRadius
+			|| aabb.maxPoint.y < n.center.y - looseRadius || aabb.minPoint.y > n.center.y + looseRadius)
+			continue;
+
+		for(size_t i = 0; i < n.objects.size(); ++i)
+			if (aabb.Intersects(objects[n.objects[i]].aabb) && callback(*this, aabb, n.objects[i]))
+				return;
+
+		for(int i = 0; i < 4; ++i)
+			if (n.children[i] >= 0)
+				stack.push_back(n.children[i]);
+	}
+}
+
+template<typename T>
+void LooseQuadTree<T>::DebugSanityCheck() const
+{
+	int numObjectsInNodes = 0;
+	std::vector<bool> isFree(nodes.size(), false);
+	for(size_t i = 0; i < freeNodes.size(); ++i)
+		isFree[freeNodes[i]] = true;
+	assert(!isFree[rootNodeIndex]);
+	assert(nodes[rootNodeIndex].parent == -1);
+	for(size_t i = 0; i < nodes.size(); ++i)
+	{
+		if (isFree[i])
+			continue;
+		const Node &n = nodes[i];
+		int numChildren = 0;
+		for(int c = 0; c < 4; ++c)
+			if (n.children[c] >= 0)
+			{
+				++numChildren;
+				assert(!isFree[n.children[c]]);
+				assert(nodes[n.children[c]].parent == (int)i);
+				assert(EqualAbs(nodes[n.children[c]].radius, n.radius * 0.5f));
+			}
+		assert(numChildren == n.numChildren);
+		assert((int)i == rootNodeIndex || !n.objects.empty() || n.numChildren > 0);
+		const AABB2D loose = n.LooseAABB();
+		for(size_t j = 0; j < n.objects.size(); ++j)
+		{
+			const ObjectEntry &e = objects[n.objects[j]];
+			assert(e.node == (int)i);
+			assert(e.slot == (int)j);
+			assert(loose.Contains(e.aabb));
+			MARK_UNUSED(e);
+			MARK_UNUSED(loose);
+		}
+		numObjectsInNodes += (int)n.objects.size();
+	}
+	assert(numObjectsInNodes == numObjects);
+	MARK_UNUSED(numObjectsInNodes);
+}
+
+MATH_END_NAMESPACE
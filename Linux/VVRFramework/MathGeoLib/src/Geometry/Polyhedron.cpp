@@ -22,6 +22,8 @@
 #include <list>
 #include <sstream>
 #include <stdlib.h>
+#include <float.h>
+#include <algorithm>
 #include "../Math/assume.h"
 #include "../Math/MathFunc.h"
 #include "../Math/float3x3.h"
@@ -40,6 +42,7 @@
 #include "Sphere.h"
 #include "Capsule.h"
 #include "../Algorithm/Random/LCG.h"
+#include "../Algorithm/ThreadPool.h"
 #include "../Time/Clock.h"
 
 #if __cplusplus > 199711L // Is C++11 or newer?
@@ -342,6 +345,13 @@ vec Polyhedron::ExtremePoint(const vec &direction) const
 	return Vertex(ExtremeVertex(direction));
 }
 
+vec Polyhedron::ExtremePoint(const vec &direction, float &projectionDistance) const
+{
+	vec extremePoint = ExtremePoint(direction);
+	projectionDistance = extremePoint.Dot(direction);
+	return extremePoint;
+}
+
 int Polyhedron::ExtremeVertexConvex(const std::vector<std::vector<int> > &adjacencyData, const vec &direction, 
 	std::vector<unsigned int> &floodFillVisited, unsigned int floodFillVisitColor,
 	float &mostExtremeDistance, int startingVertex) const
@@ -1608,9 +1618,7 @@ int LexFloat3CmpV(const void *a, const void *b) { return LexFloat3Cmp(*reinterpr
 
 Polyhedron Polyhedron::ConvexHull(const vec *pointArray, int numPoints)
 {
-	//LCG rng(Clock::TickU32());
-	LCG rng(123);
-	return ConvexHull(pointArray, numPoints, rng);
+	return QuickHull(pointArray, numPoints);
 }
 
 //#define CONVEXHULL_VERBOSE
@@ -2253,6 +2261,579 @@ Polyhedron Polyhedron::ConvexHull(const vec *pointArray, int numPoints, LCG &rng
 #endif
 }
 
+namespace
+{
+	/// A triangle of the convex hull that QuickHullBuilder builds.
+	struct QuickHullFace
+	{
+		/// The outwards facing normal of the face. The face lies on the plane normal.Dot(x) == d.
+		cv normal;
+		cs d;
+		/// The vertices of the face, in counter-clockwise order when viewed from outside the hull.
+		int v[3];
+		/// adj[i] is the face on the other side of the edge v[i] -> v[(i+1)%3].
+		int adj[3];
+		/// The points outside this face are conflictPool[conflictBegin, conflictEnd[.
+		int conflictBegin;
+		int conflictEnd;
+		/// The point in the conflict list that is farthest outside this face, or -1 if the list is empty.
+		int farthestPoint;
+		/// The last iteration in which the search for the horizon visited this face.
+		int visited;
+		bool deleted;
+
+		cs SignedDistance(const cv &point) const { return normal.Dot(point) - d; }
+
+		/// Returns the index of the edge of this face that starts at the given vertex.
+		int EdgeFrom(int vertex) const
+		{
+			assert(v[0] == vertex || v[1] == vertex || v[2] == vertex);
+			return v[0] == vertex ? 0 : (v[1] == vertex ? 1 : 2);
+		}
+	};
+
+	/// A point in a conflict list of QuickHullBuilder. The coordinates are stored in the list, so that reassigning
+	/// the points of a list to new faces reads memory in order, and not from all over the input array.
+	struct QuickHullPoint
+	{
+		float x, y, z;
+		int index; // The index of the point in the input array.
+	};
+
+	/// Finds the first of a range of faces that each point of an array is outside of, one chunk of points at a time.
+	struct QuickHullAssignTask
+	{
+		static const int chunkSize = 4096;
+
+		const QuickHullPoint *points;
+		int numPoints;
+		const QuickHullFace *faces;
+		int firstFace;
+		int endFace;
+		cs epsilon;
+		int *outFace; // Receives the face, or -1 if the point is not outside any of the faces.
+		cs *outDistance; // Receives the distance of the point from the face.
+
+		void operator()(int chunk) const
+		{
+			const int end = Min(numPoints, (chunk + 1) * chunkSize);
+			for(int i = chunk * chunkSize; i < end; ++i)
+			{
+				const cv point((cs)points[i].x, (cs)points[i].y, (cs)points[i].z, 0);
+				outFace[i] = -1;
+				for(int j = firstFace; j < endFace; ++j)
+				{
+					cs d = faces[j].SignedDistance(point);
+					if (d > epsilon)
+					{
+						outFace[i] = j;
+						outDistance[i] = d;
+						break;
+					}
+				}
+			}
+		}
+	};
+
+	/// A point of a planar point set, in the coordinates of the plane.
+	struct QuickHullPlanarPoint
+	{
+		cs x, y;
+		int index; // The index of the point in the input array.
+
+		bool operator <(const QuickHullPlanarPoint &rhs) const { return x < rhs.x || (x == rhs.x && y < rhs.y); }
+	};
+
+	/// Computes the convex hull of a point set for Polyhedron::QuickHull().
+	class QuickHullBuilder
+	{
+	public:
+		QuickHullBuilder(const vec *points, int numPoints, ThreadPool *threadPool)
+		:points(points), numPoints(numPoints), threadPool(threadPool), epsilon(0), visibleEpsilon(0), numConflicts(0),
+		planar(false), planeOrigin(-1)
+		{
+		}
+
+		/// @return False if the points do not span a volume, or if the hull could not be built due to numerical
+		///	problems. In that case outHull is left untouched.
+		bool Build(Polyhedron &outHull);
+
+		/// Computes the convex polygon of a point set that Build() found to lie on a plane.
+		/** The hull is output as a polyhedron of two faces with opposite winding orders, which is how
+			Polyhedron::ConvexHull() outputs a triangle.
+			@return False if Build() did not find the points to be planar. In that case outHull is left untouched. */
+		bool BuildPlanar(Polyhedron &outHull) const;
+
+	private:
+		const vec *points;
+		int numPoints;
+		ThreadPool *threadPool; // May be null, in which case the points are assigned to faces on this thread.
+		cs epsilon; // A point closer than this to the plane of a face is on the inner side of the face.
+		cs visibleEpsilon; // A face sees a point that is farther than this from its plane. Covers the rounding errors of doubles.
+
+		std::vector<QuickHullFace> faces; // Contains also the deleted faces.
+		std::vector<QuickHullPoint> conflictPool; // The conflict lists of the faces, one after another.
+		int numConflicts; // The number of elements in conflictPool that belong to the conflict lists of live faces.
+
+		std::vector<QuickHullPoint> unassigned; // The points that are assigned to the faces next.
+		std::vector<int> assignedFace;
+		std::vector<cs> assignedDistance;
+		std::vector<cs> farthestDistance;
+
+		struct HorizonEdge
+		{
+			int face; // A face that the eye point sees,
+			int edge; // and the edge of it next to a face that the eye point does not see.
+		};
+		struct HorizonVisit
+		{
+			int face;
+			int nextEdge;
+			int numEdgesLeft;
+		};
+		std::vector<HorizonEdge> horizon;
+		std::vector<HorizonVisit> visitStack;
+		std::vector<int> visibleFaces;
+
+		bool planar; // If true, CreateInitialTetrahedron() found the points to lie on the plane through planeOrigin
+		int planeOrigin; // that is spanned by planeU and planeV, which are orthonormal.
+		cv planeU;
+		cv planeV;
+
+		cv Point(int i) const { return cv(DIR_TO_FLOAT4(points[i])); }
+
+		bool CreateInitialTetrahedron();
+		void AddFace(int v0, int v1, int v2, int adj0, int adj1, int adj2);
+		/// Assigns each point in the unassigned array to the conflict list of the first face from firstFace onwards
+		/// that it is outside of.
+		void AssignConflicts(int firstFace);
+		/// Removes the conflict lists of the deleted faces from the conflict pool.
+		void CompactConflictPool();
+		/// Finds the faces that the given point sees, and the edges of the horizon around them in counter-clockwise order.
+		void FindHorizon(int face, int eye, int iteration);
+		bool AddPoint(int face, int iteration);
+	};
+
+	void QuickHullBuilder::AddFace(int v0, int v1, int v2, int adj0, int adj1, int adj2)
+	{
+		QuickHullFace f;
+		f.v[0] = v0; f.v[1] = v1; f.v[2] = v2;
+		f.adj[0] = adj0; f.adj[1] = adj1; f.adj[2] = adj2;
+		const cv a = Point(v0);
+		f.normal = (Point(v1) - a).Cross(Point(v2) - a);
+		f.normal.Normalize();
+		f.d = f.normal.Dot(a);
+		f.conflictBegin = f.conflictEnd = (int)conflictPool.size();
+		f.farthestPoint = -1;
+		f.visited = 0;
+		f.deleted = false;
+		faces.push_back(f);
+	}
+
+	bool QuickHullBuilder::CreateInitialTetrahedron()
+	{
+		// Find the extreme points along the coordinate axes. NaNs never compare as extreme.
+		int minI[3] = { -1, -1, -1 };
+		int maxI[3] = { -1, -1, -1 };
+		float minV[3] = { FLOAT_INF, FLOAT_INF, FLOAT_INF };
+		float maxV[3] = { -FLOAT_INF, -FLOAT_INF, -FLOAT_INF };
+		for(int i = 0; i < numPoints; ++i)
+			for(int j = 0; j < 3; ++j)
+			{
+				const float c = points[i][j];
+				if (c < minV[j]) { minV[j] = c; minI[j] = i; }
+				if (c > maxV[j]) { maxV[j] = c; maxI[j] = i; }
+			}
+		if (minI[0] < 0 || minI[1] < 0 || minI[2] < 0)
+			return false;
+
+		// The points are floats, so the planes of the faces are no more precise than floats either, even though
+		// the distances are computed in double precision. Scale the tolerance by the magnitude of the coordinates,
+		// as in Barber, Dobkin and Huhdanpaa, The Quickhull Algorithm for Convex Hulls, 1996.
+		const cs scale = (cs)Max(Abs(minV[0]), Abs(maxV[0])) + Max(Abs(minV[1]), Abs(maxV[1])) + Max(Abs(minV[2]), Abs(maxV[2]));
+		epsilon = 3 * FLT_EPSILON * scale;
+		visibleEpsilon = 8 * DBL_EPSILON * scale;
+		if (!IsFinite(epsilon))
+			return false;
+
+		// The first two vertices are the extremes along the axis along which the points spread the most,
+		int axis = 0;
+		for(int j = 1; j < 3; ++j)
+			if (maxV[j] - minV[j] > maxV[axis] - minV[axis])
+				axis = j;
+		if (maxV[axis] - minV[axis] <= epsilon)
+			return false;
+		const int v0 = minI[axis];
+		int v1 = maxI[axis];
+		const cv p0 = Point(v0);
+		cv lineDir = Point(v1) - p0;
+		lineDir.Normalize();
+
+		// the third vertex is the point farthest from the line through them,
+		int v2 = -1;
+		cs farthestD = epsilon * epsilon;
+		for(int i = 0; i < numPoints; ++i)
+		{
+			cv cross = (Point(i) - p0).Cross(lineDir);
+			cs dSq = cross.Dot(cross);
+			if (dSq > farthestD)
+			{
+				farthestD = dSq;
+				v2 = i;
+			}
+		}
+		if (v2 < 0)
+			return false;
+
+		// and the fourth vertex is the point farthest from the plane through the first three.
+		cv normal = (Point(v1) - p0).Cross(Point(v2) - p0);
+		normal.Normalize();
+		int v3 = -1;
+		farthestD = epsilon;
+		for(int i = 0; i < numPoints; ++i)
+		{
+			cs d = Abs(normal.Dot(Point(i) - p0));
+			if (d > farthestD)
+			{
+				farthestD = d;
+				v3 = i;
+			}
+		}
+		if (v3 < 0)
+		{
+			planar = true;
+			planeOrigin = v0;
+			planeU = lineDir;
+			planeV = normal.Cross(lineDir);
+			return false;
+		}
+
+		// Wind the base triangle v0, v1, v2 so that it faces away from v3.
+		if (normal.Dot(Point(v3) - p0) > 0)
+			Swap(v1, v2);
+
+		AddFace(v0, v1, v2, 1, 2, 3);
+		AddFace(v1, v0, v3, 0, 3, 2);
+		AddFace(v2, v1, v3, 0, 1, 3);
+		AddFace(v0, v2, v3, 0, 2, 1);
+
+		unassigned.reserve(numPoints - 4);
+		for(int i = 0; i < numPoints; ++i)
+			if (i != v0 && i != v1 && i != v2 && i != v3)
+			{
+				QuickHullPoint point = { points[i].x, points[i].y, points[i].z, i };
+				unassigned.push_back(point);
+			}
+		AssignConflicts(0);
+		return true;
+	}
+
+	void QuickHullBuilder::AssignConflicts(int firstFace)
+	{
+		const int n = (int)unassigned.size();
+		const int endFace = (int)faces.size();
+		assignedFace.resize(n);
+		assignedDistance.resize(n);
+		if (n > 0)
+		{
+			QuickHullAssignTask task = { &unassigned[0], n, &faces[0], firstFace, endFace, epsilon, &assignedFace[0], &assignedDistance[0] };
+			const int numChunks = (n + QuickHullAssignTask::chunkSize - 1) / QuickHullAssignTask::chunkSize;
+			if (threadPool && numChunks > 1)
+				threadPool->ParallelFor(numChunks, task);
+			else
+				for(int i = 0; i < numChunks; ++i)
+					task(i);
+		}
+
+		// Count the points of each face, and lay out the conflict lists of the faces one after another at the end of
+		// the pool.
+		for(int j = firstFace; j < endFace; ++j)
+			faces[j].conflictEnd = 0;
+		for(int i = 0; i < n; ++i)
+			if (assignedFace[i] >= 0)
+				++faces[assignedFace[i]].conflictEnd;
+		int begin = (int)conflictPool.size();
+		for(int j = firstFace; j < endFace; ++j)
+		{
+			const int count = faces[j].conflictEnd;
+			faces[j].conflictBegin = faces[j].conflictEnd = begin;
+			begin += count;
+		}
+		numConflicts += begin - (int)conflictPool.size();
+		conflictPool.resize(begin);
+
+		farthestDistance.assign(endFace - firstFace, -FLOAT_INF);
+		for(int i = 0; i < n; ++i)
+		{
+			const int j = assignedFace[i];
+			if (j < 0)
+				continue;
+			conflictPool[faces[j].conflictEnd++] = unassigned[i];
+			if (assignedDistance[i] > farthestDistance[j - firstFace])
+			{
+				farthestDistance[j - firstFace] = assignedDistance[i];
+				faces[j].farthestPoint = unassigned[i].index;
+			}
+		}
+		unassigned.clear();
+	}
+
+	void QuickHullBuilder::CompactConflictPool()
+	{
+		// The faces are created in order, and their conflict lists are appended to the pool in the same order, so
+		// moving each list down over the lists of the deleted faces never overwrites a list that is still to be moved.
+		int end = 0;
+		for(size_t j = 0; j < faces.size(); ++j)
+		{
+			QuickHullFace &f = faces[j];
+			if (f.deleted)
+				continue;
+			assert(f.conflictBegin >= end);
+			std::copy(conflictPool.begin() + f.conflictBegin, conflictPool.begin() + f.conflictEnd, conflictPool.begin() + end);
+			f.conflictEnd = end + f.conflictEnd - f.conflictBegin;
+			f.conflictBegin = end;
+			end = f.conflictEnd;
+		}
+		assert(end == numConflicts);
+		conflictPool.resize(end);
+	}
+
+	void QuickHullBuilder::FindHorizon(int face, int eye, int iteration)
+	{
+		// Visit the faces that the eye point sees depth-first. When entering a face through an edge, continue with
+		// the next edge of that face counter-clockwise. This visits the edges of the horizon in counter-clockwise order.
+		// A face that the eye point is outside of by less than epsilon still counts as visible, because otherwise the
+		// new faces would fold slightly inwards at the horizon. Such folds grow when further points are added next to
+		// them, until the hull is no longer convex.
+		const cv eyePoint = Point(eye);
+		horizon.clear();
+		visibleFaces.clear();
+		faces[face].visited = iteration;
+		visibleFaces.push_back(face);
+		HorizonVisit start = { face, 0, 3 };
+		visitStack.push_back(start);
+		while(!visitStack.empty())
+		{
+			HorizonVisit &top = visitStack.back();
+			if (top.numEdgesLeft == 0)
+			{
+				visitStack.pop_back();
+				continue;
+			}
+			const int f = top.face;
+			const int edge = top.nextEdge;
+			top.nextEdge = (edge + 1) % 3;
+			--top.numEdgesLeft;
+
+			const int adj = faces[f].adj[edge];
+			if (faces[adj].visited == iteration)
+				continue; // The edge is between two faces that the eye point sees.
+			if (faces[adj].SignedDistance(eyePoint) > visibleEpsilon)
+			{
+				faces[adj].visited = iteration;
+				visibleFaces.push_back(adj);
+				const int entryEdge = faces[adj].EdgeFrom(faces[f].v[(edge + 1) % 3]);
+				assert(faces[adj].adj[entryEdge] == f);
+				HorizonVisit next = { adj, (entryEdge + 1) % 3, 2 };
+				visitStack.push_back(next);
+			}
+			else
+			{
+				HorizonEdge h = { f, edge };
+				horizon.push_back(h);
+			}
+		}
+	}
+
+	bool QuickHullBuilder::AddPoint(int face, int iteration)
+	{
+		const int eye = faces[face].farthestPoint;
+		FindHorizon(face, eye, iteration);
+
+		// If the tolerance makes the faces that the eye point sees not a disc, the horizon is not a single loop.
+		const int numNewFaces = (int)horizon.size();
+		if (numNewFaces < 3)
+			return false;
+		for(int k = 0; k < numNewFaces; ++k)
+		{
+			const HorizonEdge &h = horizon[k];
+			const HorizonEdge &next = horizon[(k + 1) % numNewFaces];
+			if (faces[h.face].v[(h.edge + 1) % 3] != faces[next.face].v[next.edge])
+				return false;
+		}
+
+		// Connect each edge of the horizon to the eye point with a new face.
+		const int firstNewFace = (int)faces.size();
+		for(int k = 0; k < numNewFaces; ++k)
+		{
+			const HorizonEdge h = horizon[k];
+			const int a = faces[h.face].v[h.edge];
+			const int b = faces[h.face].v[(h.edge + 1) % 3];
+			const int outside = faces[h.face].adj[h.edge];
+			QuickHullFace &o = faces[outside];
+			assert(o.adj[o.EdgeFrom(b)] == h.face);
+			o.adj[o.EdgeFrom(b)] = firstNewFace + k;
+			AddFace(a, b, eye, outside, firstNewFace + (k + 1) % numNewFaces, firstNewFace + (k + numNewFaces - 1) % numNewFaces);
+			if (!faces.back().normal.IsFinite())
+				return false; // The eye point is on the line of the edge to within rounding.
+		}
+
+		// Delete the faces that the eye point sees, and reassign the points outside them to the new faces.
+		for(size_t i = 0; i < visibleFaces.size(); ++i)
+		{
+			QuickHullFace &f = faces[visibleFaces[i]];
+			for(int j = f.conflictBegin; j < f.conflictEnd; ++j)
+				if (conflictPool[j].index != eye)
+					unassigned.push_back(conflictPool[j]);
+			numConflicts -= f.conflictEnd - f.conflictBegin;
+			f.deleted = true;
+		}
+		AssignConflicts(firstNewFace);
+
+		// Compacting takes time in proportion to the number of faces and points, so wait until there is at least
+		// as much garbage in the pool.
+		if (conflictPool.size() - numConflicts > numConflicts + faces.size() + QuickHullAssignTask::chunkSize)
+			CompactConflictPool();
+		return true;
+	}
+
+	bool QuickHullBuilder::Build(Polyhedron &outHull)
+	{
+		if (!points || numPoints < 4 || !CreateInitialTetrahedron())
+			return false;
+
+		std::vector<int> workStack;
+		for(int j = 0; j < 4; ++j)
+			workStack.push_back(j);
+		int iteration = 0;
+		while(!workStack.empty())
+		{
+			const int face = workStack.back();
+			workStack.pop_back();
+			if (faces[face].deleted || faces[face].conflictBegin == faces[face].conflictEnd)
+				continue;
+			const int firstNewFace = (int)faces.size();
+			if (!AddPoint(face, ++iteration))
+				return false;
+			for(int j = firstNewFace; j < (int)faces.size(); ++j)
+				workStack.push_back(j);
+		}
+
+		// Output the live faces, and the points that are their vertices.
+		std::vector<int> vertices;
+		for(size_t j = 0; j < faces.size(); ++j)
+			if (!faces[j].deleted)
+				vertices.insert(vertices.end(), faces[j].v, faces[j].v + 3);
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+		Polyhedron p;
+		p.v.reserve(vertices.size());
+		for(size_t i = 0; i < vertices.size(); ++i)
+			p.v.push_back(points[vertices[i]]);
+		Polyhedron::Face face;
+		face.v.resize(3);
+		for(size_t j = 0; j < faces.size(); ++j)
+		{
+			if (faces[j].deleted)
+				continue;
+			for(int k = 0; k < 3; ++k)
+				face.v[k] = (int)(std::lower_bound(vertices.begin(), vertices.end(), faces[j].v[k]) - vertices.begin());
+			p.f.push_back(face);
+		}
+
+		assert(p.FaceIndicesValid());
+#ifdef MATH_ASSERT_CORRECTNESS
+		assume(p.IsClosed());
+		assume(p.EulerFormulaHolds());
+		assume(p.IsConvex());
+#endif
+		outHull.v.swap(p.v);
+		outHull.f.swap(p.f);
+		return true;
+	}
+
+	bool QuickHullBuilder::BuildPlanar(Polyhedron &outHull) const
+	{
+		if (!planar)
+			return false;
+
+		// Project the points to the plane, and find their hull with Andrew's monotone chain algorithm. A point closer
+		// than epsilon to the line through an edge is on the edge, as with the faces in 3D.
+		const cv p0 = Point(planeOrigin);
+		std::vector<QuickHullPlanarPoint> sorted(numPoints);
+		for(int i = 0; i < numPoints; ++i)
+		{
+			const cv d = Point(i) - p0;
+			sorted[i].x = planeU.Dot(d);
+			sorted[i].y = planeV.Dot(d);
+			sorted[i].index = i;
+		}
+		std::sort(sorted.begin(), sorted.end());
+
+		std::vector<QuickHullPlanarPoint> hull(2 * numPoints);
+		int k = 0;
+		for(int pass = 0; pass < 2; ++pass) // The lower hull from left to right, and then the upper hull back.
+		{
+			const int chainStart = k;
+			for(int j = 0; j < numPoints; ++j)
+			{
+				const QuickHullPlanarPoint &p = sorted[pass == 0 ? j : numPoints - 1 - j];
+				while(k >= chainStart + 2)
+				{
+					const QuickHullPlanarPoint &a = hull[k-2];
+					const QuickHullPlanarPoint &b = hull[k-1];
+					const cs ex = b.x - a.x;
+					const cs ey = b.y - a.y;
+					if (ex * (p.y - a.y) - ey * (p.x - a.x) > epsilon * (cs)sqrt(ex*ex + ey*ey))
+						break;
+					--k;
+				}
+				hull[k++] = p;
+			}
+			--k; // The last point of each chain is the first point of the other.
+		}
+		if (k < 3)
+			return false;
+
+		Polyhedron p;
+		Polyhedron::Face face;
+		for(int i = 0; i < k; ++i)
+		{
+			p.v.push_back(points[hull[i].index]);
+			face.v.push_back(i);
+		}
+		p.f.push_back(face);
+		face.FlipWindingOrder();
+		p.f.push_back(face);
+		outHull.v.swap(p.v);
+		outHull.f.swap(p.f);
+		return true;
+	}
+}
+
+static Polyhedron QuickHullOrFallback(const vec *pointArray, int numPoints, ThreadPool *threadPool)
+{
+	Polyhedron p;
+	QuickHullBuilder builder(pointArray, numPoints, threadPool);
+	if (builder.Build(p) || builder.BuildPlanar(p))
+		return p;
+
+	// The incremental algorithm handles the other degenerate point sets.
+	LCG rng(123);
+	return Polyhedron::ConvexHull(pointArray, numPoints, rng);
+}
+
+Polyhedron Polyhedron::QuickHull(const vec *pointArray, int numPoints)
+{
+	return QuickHullOrFallback(pointArray, numPoints, 0);
+}
+
+Polyhedron Polyhedron::QuickHull(const vec *pointArray, int numPoints, ThreadPool &threadPool)
+{
+	return QuickHullOrFallback(pointArray, numPoints, &threadPool);
+}
+
 /// See http://paulbourke.net/geometry/platonic/
 Polyhedron Polyhedron::Tetrahedron(const vec &centerPos, float scale, bool ccwIsFrontFacing)
 {
@@ -152,6 +152,10 @@ public:
 			corner point of this Polyhedron.
 		@see CornerPoint(). */
 	vec ExtremePoint(const vec &direction) const;
+	vec ExtremePoint(const vec &direction, float &projectionDistance) const;
+
+	/// Quickly returns an arbitrary point inside this Polyhedron. Used in GJK intersection test.
+	vec AnyPointFast() const { return !v.empty() ? Vertex(0) : vec::nan; }
 
 	// Computes the most extreme point of this convex Polyhedron into the given direction.
 	/** @param adjacencyData A precomputed data structure that specifies the adjacency information between the vertices of this Polyhedron.
@@ -414,12 +418,30 @@ public:
 	void Transform(const Quat &transform);
 
 	/// Creates a Polyhedron object that represents the convex hull of the given point array.
-	/// \todo This function is strongly WIP!
+	/** The versions that take no random number generator compute the hull with QuickHull(). The versions that take
+		one add the points to the hull one at a time in a random order.
+		\todo The random incremental version is strongly WIP!
+		@see QuickHull(). */
 	static Polyhedron ConvexHull(const VecArray &points) { return !points.empty() ? ConvexHull((const vec*)&points[0], (int)points.size()) : Polyhedron(); }
 	static Polyhedron ConvexHull(const VecArray &points, LCG &rng) { return !points.empty() ? ConvexHull((const vec*)&points[0], (int)points.size(), rng) : Polyhedron(); }
 	static Polyhedron ConvexHull(const vec *pointArray, int numPoints);
 	static Polyhedron ConvexHull(const vec *pointArray, int numPoints, LCG &rng);
 
+	/// Creates a Polyhedron object that represents the convex hull of the given point array, using the Quickhull algorithm.
+	/** Each face of the hull under construction keeps a list of the points outside it. The point farthest outside
+		a face is added to the hull next, and the points outside the faces that it replaces are reassigned to the new
+		faces. A point closer than a small tolerance to a face counts as inside it. The tolerance is relative to the
+		magnitude of the coordinates of the points, so the hull contains each point to within the precision of floats.
+		The faces of the hull are triangles, and its vertices are the input points that are on the hull.
+		If all the points lie on a plane, the hull is their convex polygon, output as two faces with opposite winding
+		orders. If they lie on a line, this function falls back to the random incremental algorithm.
+		@param threadPool If specified, the points are assigned to the faces on the threads of this pool. This must
+			not be called from an iteration of a ParallelFor() on the same pool.
+		@see ConvexHull(). */
+	static Polyhedron QuickHull(const VecArray &points) { return !points.empty() ? QuickHull((const vec*)&points[0], (int)points.size()) : Polyhedron(); }
+	static Polyhedron QuickHull(const vec *pointArray, int numPoints);
+	static Polyhedron QuickHull(const vec *pointArray, int numPoints, ThreadPool &threadPool);
+
 	static Polyhedron Tetrahedron(const vec &centerPos = POINT_VEC_SCALAR(0.f), float scale = 1.f, bool ccwIsFrontFacing = true);
 	static Polyhedron Octahedron(const vec &centerPos = POINT_VEC_SCALAR(0.f), float scale = 1.f, bool ccwIsFrontFacing = true);
 	static Polyhedron Hexahedron(const vec &centerPos = POINT_VEC_SCALAR(0.f), float scale = 1.f, bool ccwIsFrontFacing = true);
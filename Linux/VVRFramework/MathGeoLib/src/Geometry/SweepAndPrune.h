@@ -0,0 +1,155 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file SweepAndPrune.h
+	@author Jukka Jylnki
+	@brief Sweep-and-prune for the broad phase of collision detection between moving objects. */
+#pragma once
+
+#include "../MathGeoLibFwd.h"
+#include "AABB.h"
+#include <vector>
+#include <utility>
+
+MATH_BEGIN_NAMESPACE
+
+/// Finds the pairs of objects whose AABBs overlap by sorting the AABBs along an axis and sweeping through them.
+/** The AABBs are kept in an array sorted by their minimum along the sort axis. FindOverlappingPairs() walks the
+	array, and tests each AABB against the following AABBs up to where they start past its maximum along the axis.
+	The array is kept from one call to the next, and resorted incrementally with an insertion sort. When the objects
+	move only a little between the calls, the array is nearly sorted, and the sort takes linear time.
+
+	The sort axis is the axis along which the centers of the objects are spread the most, since that separates
+	the most pairs. It is measured during each sweep, and the array is resorted from scratch if the best axis
+	changes.
+
+	The objects are reported in pairs, which are the candidates for the narrow phase, e.g. Intersects() or
+	GJKIntersect() on the objects themselves. SweepAndPrune suits objects that are spread out along some axis, and
+	that all move every frame. For objects that are clustered, or of which only a few move per frame, use a
+	DynamicAABBTree.
+
+	To place objects of type T into a SweepAndPrune, define a function AABB GetAABB(const T &object) that returns
+	the bounds of the object, e.g. AABB GetAABB(const OBB *obb) { return obb->MinimalEnclosingAABB(); }.
+	The objects are referred to by the handles returned by Add().
+	@see DynamicAABBTree. */
+template<typename T>
+class SweepAndPrune
+{
+public:
+	/// Identifies an object. Stays valid until the object is removed.
+	typedef int ObjectHandle;
+
+	SweepAndPrune();
+
+	/// Removes all objects.
+	void Clear();
+
+	/// Adds the given object at the bounds given by GetAABB(object).
+	/// @return The handle that identifies the object.
+	ObjectHandle Add(const T &object);
+
+	/// Moves the given object to the bounds given by GetAABB() of it, after the object has moved. Runs in constant
+	/// time. The sort order is restored in the next call to FindOverlappingPairs().
+	void Update(ObjectHandle object);
+
+	/// Removes the given object.
+	void Remove(ObjectHandle object);
+
+	/// Returns the given object.
+	/// @note If the object is modified so that its bounds change, call Update() on it afterwards.
+	T &Object(ObjectHandle object) { assert(IsValid(object)); return objects[object].object; }
+	const T &Object(ObjectHandle object) const { assert(IsValid(object)); return objects[object].object; }
+
+	/// Returns the bounds of the given object when it was last added or updated.
+	AABB ObjectAABB(ObjectHandle object) const;
+
+	/// Returns true if the given handle identifies an object.
+	bool IsValid(ObjectHandle object) const { return object >= 0 && object < (int)objects.size() && objects[object].entry >= 0; }
+
+	/// Returns the number of objects. Runs in constant time.
+	int NumObjects() const { return numObjects; }
+
+	/// Returns the axis the AABBs are sorted along: 0 for x, 1 for y and 2 for z.
+	int SortAxis() const { return axis; }
+
+	/// Finds the pairs of objects whose bounds intersect, and calls the given callback function for each.
+	/** @param callback A function or a function object of prototype
+			bool callbackFunction(SweepAndPrune<T> &sap, SweepAndPrune<T>::ObjectHandle a, SweepAndPrune<T>::ObjectHandle b);
+		Each pair is reported once, in an unspecified order. If the callback function returns true, the execution
+		of the query is stopped and this function immediately returns afterwards. */
+	template<typename Func>
+	inline void FindOverlappingPairs(Func &callback);
+
+	/// Appends the pairs of objects whose bounds intersect to the given array.
+	void FindOverlappingPairs(std::vector<std::pair<ObjectHandle, ObjectHandle> > &outPairs);
+
+	/// Performs various consistency checks. Use only for debugging purposes.
+	void DebugSanityCheck() const;
+
+private:
+	/// The AABB of an object in the sorted array. The AABBs are copied here so that the sweep reads the memory in order.
+	struct Entry
+	{
+		float minPoint[3];
+		float maxPoint[3];
+		/// The object of this entry, or -1 if the object has been removed.
+		ObjectHandle object;
+	};
+
+	struct ObjectEntry
+	{
+		T object;
+		/// The index of the object in the sorted array, or -1 if this entry is free.
+		int entry;
+		/// For a free entry, the index of the next free entry, or -1.
+		int nextFree;
+	};
+
+	std::vector<Entry> entries; // Sorted by minPoint[axis], except for the changes since the last sort.
+	std::vector<ObjectEntry> objects;
+	int firstFreeObject; // The first free entry of the above array, or -1.
+
+	int numObjects;
+	int numRemoved; // The number of entries of removed objects in the sorted array.
+	int numAdded; // The number of entries added to the end of the sorted array since the last sort.
+	int axis;
+	bool needsFullSort;
+
+	void SetEntryAABB(Entry &e, const AABB &aabb);
+
+	/// Removes the entries of the removed objects from the sorted array, and sorts it.
+	void Sort();
+
+	/// A callback for FindOverlappingPairs() that appends the pairs to an array.
+	struct PairCollector
+	{
+		std::vector<std::pair<ObjectHandle, ObjectHandle> > *pairs;
+		bool operator()(SweepAndPrune<T> & /*sap*/, ObjectHandle a, ObjectHandle b)
+		{
+			pairs->push_back(std::make_pair(a, b));
+			return false;
+		}
+	};
+
+	/// Orders the entries by their minimum along the sort axis.
+	struct EntryLess
+	{
+		int axis;
+		bool operator()(const Entry &a, const Entry &b) const { return a.minPoint[axis] < b.minPoint[axis]; }
+	};
+};
+
+MATH_END_NAMESPACE
+
+#include "SweepAndPrune.inl"
@@ -0,0 +1,239 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file SweepAndPrune.inl
+	@author Jukka Jylnki
+	@brief Implementation for the SweepAndPrune object. */
+#pragma once
+
+#include "../Math/MathFunc.h"
+#include <algorithm>
+
+MATH_BEGIN_NAMESPACE
+
+template<typename T>
+SweepAndPrune<T>::SweepAndPrune()
+:firstFreeObject(-1), numObjects(0), numRemoved(0), numAdded(0), axis(0), needsFullSort(false)
+{
+}
+
+template<typename T>
+void SweepAndPrune<T>::Clear()
+{
+	entries.clear();
+	objects.clear();
+	firstFreeObject = -1;
+	numObjects = 0;
+	numRemoved = 0;
+	numAdded = 0;
+	needsFullSort = false;
+}
+
+template<typename T>
+void SweepAndPrune<T>::SetEntryAABB(Entry &e, const AABB &aabb)
+{
+	assert(aabb.IsFinite());
+	for(int i = 0; i < 3; ++i)
+	{
+		e.minPoint[i] = aabb.minPoint[i];
+		e.maxPoint[i] = aabb.maxPoint[i];
+	}
+}
+
+template<typename T>
+AABB SweepAndPrune<T>::ObjectAABB(ObjectHandle object) const
+{
+	assert(IsValid(object));
+	const Entry &e = entries[objects[object].entry];
+	return AABB(POINT_VEC(e.minPoint[0], e.minPoint[1], e.minPoint[2]), POINT_VEC(e.maxPoint[0], e.maxPoint[1], e.maxPoint[2]));
+}
+
+template<typename T>
+typename SweepAndPrune<T>::ObjectHandle SweepAndPrune<T>::Add(const T &object)
+{
+	ObjectEntry o;
+	o.object = object;
+	o.entry = (int)entries.size();
+	o.nextFree = -1;
+
+	ObjectHandle handle;
+	if (firstFreeObject >= 0)
+	{
+		handle = firstFreeObject;
+		firstFreeObject = objects[handle].nextFree;
+		objects[handle] = o;
+	}
+	else
+	{
+		handle = (ObjectHandle)objects.size();
+		objects.push_back(o);
+	}
+
+	Entry e;
+	SetEntryAABB(e, GetAABB(object));
+	e.object = handle;
+	entries.push_back(e);
+	++numAdded;
+	++numObjects;
+	return handle;
+}
+
+template<typename T>
+void SweepAndPrune<T>::Update(ObjectHandle object)
+{
+	assert(IsValid(object));
+	SetEntryAABB(entries[objects[object].entry], GetAABB(objects[object].object));
+}
+
+template<typename T>
+void SweepAndPrune<T>::Remove(ObjectHandle object)
+{
+	assert(IsValid(object));
+	ObjectEntry &o = objects[object];
+	entries[o.entry].object = -1; // The entry is removed from the sorted array in the next sort.
+	++numRemoved;
+
+	o.object = T();
+	o.entry = -1;
+	o.nextFree = firstFreeObject;
+	firstFreeObject = object;
+	--numObjects;
+}
+
+template<typename T>
+void SweepAndPrune<T>::Sort()
+{
+	if (numRemoved > 0)
+	{
+		size_t numKept = 0;
+		for(size_t i = 0; i < entries.size(); ++i)
+			if (entries[i].object >= 0)
+				entries[numKept++] = entries[i];
+		entries.resize(numKept);
+		numRemoved = 0;
+	}
+
+	// Each added entry may have to move through the whole array in an insertion sort, so after adding more than a
+	// few objects, sort from scratch.
+	const int maxIncrementalAdds = 32;
+	if (needsFullSort || numAdded > maxIncrementalAdds)
+	{
+		EntryLess less = { axis };
+		std::sort(entries.begin(), entries.end(), less);
+	}
+	else
+	{
+		for(size_t i = 1; i < entries.size(); ++i)
+		{
+			if (!(entries[i].minPoint[axis] < entries[i-1].minPoint[axis]))
+				continue;
+			const Entry e = entries[i];
+			size_t j = i;
+			do
+			{
+				entries[j] = entries[j-1];
+				--j;
+			} while(j > 0 && e.minPoint[axis] < entries[j-1].minPoint[axis]);
+			entries[j] = e;
+		}
+	}
+	for(size_t i = 0; i < entries.size(); ++i)
+		objects[entries[i].object].entry = (int)i;
+	numAdded = 0;
+	needsFullSort = false;
+}
+
+template<typename T>
+template<typename Func>
+inline void SweepAndPrune<T>::FindOverlappingPairs(Func &callback)
+{
+	Sort();
+
+	const int a0 = axis;
+	const int a1 = (axis + 1) % 3;
+	const int a2 = (axis + 2) % 3;
+	float sum[3] = { 0.f, 0.f, 0.f };
+	float sumSq[3] = { 0.f, 0.f, 0.f };
+	const size_t n = entries.size();
+	for(size_t i = 0; i < n; ++i)
+	{
+		const Entry &e = entries[i];
+		for(int k = 0; k < 3; ++k)
+		{
+			const float center = (e.minPoint[k] + e.maxPoint[k]) * 0.5f;
+			sum[k] += center;
+			sumSq[k] += center * center;
+		}
+
+		// The entries after e start at or after it along the sort axis. The overlap tests are the same as in
+		// AABB::Intersects(), so that touching AABBs are not reported.
+		for(size_t j = i + 1; j < n && entries[j].minPoint[a0] < e.maxPoint[a0]; ++j)
+		{
+			const Entry &f = entries[j];
+			if (e.minPoint[a0] < f.maxPoint[a0]
+				&& e.minPoint[a1] < f.maxPoint[a1] && f.minPoint[a1] < e.maxPoint[a1]
+				&& e.minPoint[a2] < f.maxPoint[a2] && f.minPoint[a2] < e.maxPoint[a2]
+				&& callback(*this, e.object, f.object))
+				return;
+		}
+	}
+
+	// Sort along the axis of the largest variance of the centers from now on.
+	int bestAxis = axis;
+	float bestVariance = -FLOAT_INF;
+	for(int k = 0; k < 3 && n > 0; ++k)
+	{
+		const float variance = sumSq[k] - sum[k] * sum[k] / n;
+		if (variance > bestVariance)
+		{
+			bestVariance = variance;
+			bestAxis = k;
+		}
+	}
+	if (bestAxis != axis)
+	{
+		axis = bestAxis;
+		needsFullSort = true;
+	}
+}
+
+template<typename T>
+void SweepAndPrune<T>::FindOverlappingPairs(std::vector<std::pair<ObjectHandle, ObjectHandle> > &outPairs)
+{
+	PairCollector collector = { &outPairs };
+	FindOverlappingPairs(collector);
+}
+
+template<typename T>
+void SweepAndPrune<T>::DebugSanityCheck() const
+{
+	int numValidEntries = 0;
+	for(size_t i = 0; i < entries.size(); ++i)
+	{
+		const Entry &e = entries[i];
+		if (e.object < 0)
+			continue;
+		++numValidEntries;
+		assert(IsValid(e.object));
+		assert(objects[e.object].entry == (int)i);
+		for(int k = 0; k < 3; ++k)
+			assert(e.minPoint[k] <= e.maxPoint[k]);
+		MARK_UNUSED(e);
+	}
+	assert(numValidEntries == numObjects);
+	assert((int)entries.size() == numObjects + numRemoved);
+	MARK_UNUSED(numValidEntries);
+}
+
+MATH_END_NAMESPACE
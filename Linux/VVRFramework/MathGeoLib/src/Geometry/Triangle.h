@@ -1,4 +1,4 @@
-/* Copyright Jukka Jylnki
+/* Copyright Jukka Jyl�nki
 
    Licensed under the Apache License, Version 2.0 (the "License");
    you may not use this file except in compliance with the License.
@@ -13,7 +13,7 @@
    limitations under the License. */
 
 /** @file Triangle.h
-	@author Jukka Jylnki
+	@author Jukka Jyl�nki
 	@brief The Triangle geometry object. */
 #pragma once
 
@@ -408,6 +408,21 @@ struct Triangle_storage
 };
 #define TRIANGLE(x) (*(Triangle*)&x)
 
+/// The nearest hit of a ray with a set of triangles, as returned by the batch ray queries
+/// TriangleMesh::IntersectRays() and KdTree<Triangle>::IntersectRays().
+struct RayTriangleHit
+{
+	/// The distance along the ray to the hit, or FLOAT_INF if the ray did not hit anything.
+	float t;
+	/// The index of the triangle that was hit, or -1 if the ray did not hit anything.
+	int triangleIndex;
+	/// The barycentric (u,v) coordinates of the hit on the triangle.
+	float u, v;
+
+	/// Resets this to denote a miss.
+	void SetMiss() { t = FLOAT_INF; triangleIndex = -1; u = v = 0.f; }
+};
+
 #ifdef MATH_QT_INTEROP
 Q_DECLARE_METATYPE(Triangle)
 Q_DECLARE_METATYPE(Triangle*)
@@ -25,9 +25,12 @@
 #include "../MathGeoLibFwd.h"
 #include "../Math/MathConstants.h"
 #include "../Math/myassert.h"
+#include "../Math/MathFunc.h"
+#include "../Algorithm/ThreadPool.h"
 #include "../../tests/SystemInfo.h"
 
 #include <vector>
+#include <algorithm>
 
 #include "../Math/SSEMath.h"
 
@@ -168,10 +171,7 @@ SIMDCapability DetectSIMDCapability()
 const int simdCapability = DetectSIMDCapability();
 
 TriangleMesh::TriangleMesh()
-:data(0), numTriangles(0), vertexSizeBytes(0)
-#ifdef _DEBUG
-, vertexDataLayout(0)
-#endif
+:data(0), numTriangles(0), vertexSizeBytes(0), vertexDataLayout(0), useBVH(true), bvhData(0)
 {
 
 }
@@ -179,13 +179,11 @@ TriangleMesh::TriangleMesh()
 TriangleMesh::~TriangleMesh()
 {
 	AlignedFree(data);
+	AlignedFree(bvhData);
 }
 
 TriangleMesh::TriangleMesh(const TriangleMesh &rhs)
-:data(0), numTriangles(0), vertexSizeBytes(0)
-#ifdef _DEBUG
-, vertexDataLayout(0)
-#endif
+:data(0), numTriangles(0), vertexSizeBytes(0), vertexDataLayout(0), useBVH(true), bvhData(0)
 {
 	*this = rhs;
 }
@@ -195,12 +193,20 @@ TriangleMesh &TriangleMesh::operator =(const TriangleMesh &rhs)
 	if (this == &rhs)
 		return *this;
 
-#ifdef _DEBUG
 	vertexDataLayout = rhs.vertexDataLayout;
-#endif
+	useBVH = rhs.useBVH;
 	ReallocVertexBuffer(rhs.numTriangles, rhs.vertexSizeBytes);
 	memcpy(data, rhs.data, numTriangles*3*vertexSizeBytes);
 
+	if (rhs.HasBVH())
+	{
+		bvhNodes = rhs.bvhNodes;
+		bvhTriangleIndices = rhs.bvhTriangleIndices;
+		const size_t bvhDataSize = bvhTriangleIndices.size() * 3 * vertexSizeBytes;
+		bvhData = (float*)AlignedMalloc(bvhDataSize, 32);
+		memcpy(bvhData, rhs.bvhData, bvhDataSize);
+	}
+
 	return *this;
 }
 
@@ -232,6 +238,13 @@ void TriangleMesh::Set(const float *triangleMesh, int numTriangles, int vertexSi
 
 float TriangleMesh::IntersectRay(const Ray &ray) const
 {
+	if (HasBVH())
+	{
+		int triangleIndex;
+		float u, v;
+		return IntersectRay_BVH(ray, triangleIndex, u, v);
+	}
+
 #ifndef MATH_AUTOMATIC_SSE // TODO: Restore support for this when MATH_AUTOMATIC_SSE is defined!
 #ifdef MATH_AVX
 	if (simdCapability == SIMD_AVX)
@@ -253,6 +266,12 @@ float TriangleMesh::IntersectRay(const Ray &ray) const
 
 float TriangleMesh::IntersectRay_TriangleIndex(const Ray &ray, int &outTriangleIndex) const
 {
+	if (HasBVH())
+	{
+		float u, v;
+		return IntersectRay_BVH(ray, outTriangleIndex, u, v);
+	}
+
 #ifndef MATH_AUTOMATIC_SSE // TODO: Restore support for this when MATH_AUTOMATIC_SSE is defined!
 #ifdef MATH_AVX
 	if (simdCapability == SIMD_AVX)
@@ -273,6 +292,9 @@ float TriangleMesh::IntersectRay_TriangleIndex(const Ray &ray, int &outTriangleI
 
 float TriangleMesh::IntersectRay_TriangleIndex_UV(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
 {
+	if (HasBVH())
+		return IntersectRay_BVH(ray, outTriangleIndex, outU, outV);
+
 #ifndef MATH_AUTOMATIC_SSE // TODO: Restore support for this when MATH_AUTOMATIC_SSE is defined!
 #ifdef MATH_AVX
 	if (simdCapability == SIMD_AVX)
@@ -291,8 +313,75 @@ float TriangleMesh::IntersectRay_TriangleIndex_UV(const Ray &ray, int &outTriang
 	return IntersectRay_TriangleIndex_UV_CPP(ray, outTriangleIndex, outU, outV);
 }
 
+void TriangleMesh::IntersectRays(const Ray *rays, int numRays, RayTriangleHit *outHits) const
+{
+	if (HasBVH())
+		return IntersectRays_BVH(rays, numRays, outHits);
+
+#ifndef MATH_AUTOMATIC_SSE // TODO: Restore support for this when MATH_AUTOMATIC_SSE is defined!
+#ifdef MATH_AVX
+	if (simdCapability == SIMD_AVX)
+		return IntersectRays_AVX(rays, numRays, outHits);
+#endif
+#ifdef MATH_SSE41
+	if (simdCapability == SIMD_SSE41)
+		return IntersectRays_SSE41(rays, numRays, outHits);
+#endif
+#ifdef MATH_SSE2
+	if (simdCapability == SIMD_SSE2)
+		return IntersectRays_SSE2(rays, numRays, outHits);
+#endif
+#endif
+
+	IntersectRays_CPP(rays, numRays, outHits);
+}
+
+/// Traces one tile of the rays of TriangleMesh::IntersectRaysParallel().
+struct RayTileTask
+{
+	const TriangleMesh *mesh;
+	const Ray *rays;
+	int numRays;
+	float *outT;
+	int *outTriangleIndex;
+	float *outU;
+	float *outV;
+
+	void operator()(int tile) const
+	{
+		const int first = tile * TriangleMesh::rayTileSize;
+		const int n = Min(TriangleMesh::rayTileSize, numRays - first);
+		RayTriangleHit hits[TriangleMesh::rayTileSize];
+		mesh->IntersectRays(rays + first, n, hits);
+		for(int i = 0; i < n; ++i)
+		{
+			outT[first+i] = hits[i].t;
+			if (outTriangleIndex)
+				outTriangleIndex[first+i] = hits[i].triangleIndex;
+			if (outU)
+				outU[first+i] = hits[i].u;
+			if (outV)
+				outV[first+i] = hits[i].v;
+		}
+	}
+};
+
+void TriangleMesh::IntersectRaysParallel(const Ray *rays, int numRays, float *outT, int *outTriangleIndex, float *outU, float *outV, ThreadPool &threadPool) const
+{
+	assert(outT);
+
+	RayTileTask task = { this, rays, numRays, outT, outTriangleIndex, outU, outV };
+	threadPool.ParallelFor((numRays + rayTileSize - 1) / rayTileSize, task);
+}
+
+void TriangleMesh::IntersectRaysParallel(const Ray *rays, int numRays, float *outT, int *outTriangleIndex, float *outU, float *outV) const
+{
+	IntersectRaysParallel(rays, numRays, outT, outTriangleIndex, outU, outV, ThreadPool::Default());
+}
+
 void TriangleMesh::ReallocVertexBuffer(int numTris, int vertexSizeBytes_)
 {
+	FreeBVH();
 	AlignedFree(data);
 	vertexSizeBytes = vertexSizeBytes_;
 	data = (float*)AlignedMalloc(numTris * 3 * vertexSizeBytes, 32);
@@ -302,19 +391,16 @@ void TriangleMesh::ReallocVertexBuffer(int numTris, int vertexSizeBytes_)
 void TriangleMesh::SetAoS(const float *vertexData, int numTriangles, int vertexSizeBytes)
 {
 	ReallocVertexBuffer(numTriangles, vertexSizeBytes);
-#ifdef _DEBUG
 	vertexDataLayout = 0; // AoS
-#endif
 
 	memcpy(data, vertexData, numTriangles * 3 * vertexSizeBytes);
+	BuildBVH();
 }
 
 void TriangleMesh::SetSoA4(const float *vertexData, int numTriangles, int vertexSizeBytes)
 {
 	ReallocVertexBuffer(numTriangles, 3*sizeof(float));
-#ifdef _DEBUG
 	vertexDataLayout = 1; // SoA4
-#endif
 
 	assert(vertexSizeBytes % 4 == 0);
 	int vertexSizeFloats = vertexSizeBytes / 4;
@@ -354,14 +440,13 @@ void TriangleMesh::SetSoA4(const float *vertexData, int numTriangles, int vertex
 		o += 36;
 	}
 #endif
+	BuildBVH();
 }
 
 void TriangleMesh::SetSoA8(const float *vertexData, int numTriangles, int vertexSizeBytes)
 {
 	ReallocVertexBuffer(numTriangles, 3*sizeof(float));
-#ifdef _DEBUG
 	vertexDataLayout = 2; // SoA8
-#endif
 
 	assert(vertexSizeBytes % 4 == 0);
 	int vertexSizeFloats = vertexSizeBytes / 4;
@@ -405,20 +490,26 @@ void TriangleMesh::SetSoA8(const float *vertexData, int numTriangles, int vertex
 		o += 72;
 	}
 #endif
+	BuildBVH();
 }
 
 float TriangleMesh::IntersectRay_TriangleIndex_UV_CPP(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
 {
-	assert(sizeof(float3) == 3*sizeof(float));
-	assert(sizeof(Triangle) == 3*sizeof(vec));
 #ifdef _DEBUG
 	assert(vertexDataLayout == 0); // Must be AoS structured!
 #endif
+	return IntersectTriangles_TriangleIndex_UV_CPP(ray, data, numTriangles, outTriangleIndex, outU, outV);
+}
+
+float TriangleMesh::IntersectTriangles_TriangleIndex_UV_CPP(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV)
+{
+	assert(sizeof(float3) == 3*sizeof(float));
+	assert(sizeof(Triangle) == 3*sizeof(vec));
 
 	float nearestD = FLOAT_INF;
 
-	const Triangle *tris = reinterpret_cast<const Triangle*>(data);
-	for(int i = 0; i < numTriangles; ++i)
+	const Triangle *tris = reinterpret_cast<const Triangle*>(triangleData);
+	for(int i = 0; i < numTris; ++i)
 	{
 		float u, v;
 		float d = Triangle::IntersectLineTri(ray.pos, ray.dir, tris->a, tris->b, tris->c, u, v);
@@ -435,6 +526,630 @@ float TriangleMesh::IntersectRay_TriangleIndex_UV_CPP(const Ray &ray, int &outTr
 	return nearestD;
 }
 
+void TriangleMesh::IntersectRays_CPP(const Ray *rays, int numRays, RayTriangleHit *outHits) const
+{
+	for(int i = 0; i < numRays; ++i)
+	{
+		outHits[i].SetMiss();
+		outHits[i].t = IntersectRay_TriangleIndex_UV_CPP(rays[i], outHits[i].triangleIndex, outHits[i].u, outHits[i].v);
+	}
+}
+
+#ifdef MATH_SSE2
+float TriangleMesh::IntersectRay_SSE2(const Ray &ray) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	return IntersectTriangles_SSE2(ray, data, numTriangles);
+}
+
+float TriangleMesh::IntersectRay_TriangleIndex_SSE2(const Ray &ray, int &outTriangleIndex) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	return IntersectTriangles_TriangleIndex_SSE2(ray, data, numTriangles, outTriangleIndex);
+}
+
+float TriangleMesh::IntersectRay_TriangleIndex_UV_SSE2(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	return IntersectTriangles_TriangleIndex_UV_SSE2(ray, data, numTriangles, outTriangleIndex, outU, outV);
+}
+
+void TriangleMesh::IntersectRays_SSE2(const Ray *rays, int numRays, RayTriangleHit *outHits) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	IntersectTrianglesPacket_SSE2(rays, numRays, data, numTriangles, outHits);
+}
+#endif
+
+#ifdef MATH_SSE41
+float TriangleMesh::IntersectRay_SSE41(const Ray &ray) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	return IntersectTriangles_SSE41(ray, data, numTriangles);
+}
+
+float TriangleMesh::IntersectRay_TriangleIndex_SSE41(const Ray &ray, int &outTriangleIndex) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	return IntersectTriangles_TriangleIndex_SSE41(ray, data, numTriangles, outTriangleIndex);
+}
+
+float TriangleMesh::IntersectRay_TriangleIndex_UV_SSE41(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	return IntersectTriangles_TriangleIndex_UV_SSE41(ray, data, numTriangles, outTriangleIndex, outU, outV);
+}
+
+void TriangleMesh::IntersectRays_SSE41(const Ray *rays, int numRays, RayTriangleHit *outHits) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 1); // Must be SoA4 structured!
+#endif
+	IntersectTrianglesPacket_SSE41(rays, numRays, data, numTriangles, outHits);
+}
+#endif
+
+#ifdef MATH_AVX
+float TriangleMesh::IntersectRay_AVX(const Ray &ray) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 2); // Must be SoA8 structured!
+#endif
+	return IntersectTriangles_AVX(ray, data, numTriangles);
+}
+
+float TriangleMesh::IntersectRay_TriangleIndex_AVX(const Ray &ray, int &outTriangleIndex) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 2); // Must be SoA8 structured!
+#endif
+	return IntersectTriangles_TriangleIndex_AVX(ray, data, numTriangles, outTriangleIndex);
+}
+
+float TriangleMesh::IntersectRay_TriangleIndex_UV_AVX(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 2); // Must be SoA8 structured!
+#endif
+	return IntersectTriangles_TriangleIndex_UV_AVX(ray, data, numTriangles, outTriangleIndex, outU, outV);
+}
+
+void TriangleMesh::IntersectRays_AVX(const Ray *rays, int numRays, RayTriangleHit *outHits) const
+{
+#ifdef _DEBUG
+	assert(vertexDataLayout == 2); // Must be SoA8 structured!
+#endif
+	IntersectTrianglesPacket_AVX(rays, numRays, data, numTriangles, outHits);
+}
+#endif
+
+int TriangleMesh::LayoutWidth() const
+{
+	return vertexDataLayout == 2 ? 8 : (vertexDataLayout == 1 ? 4 : 1);
+}
+
+bool TriangleMesh::LayoutSupported() const
+{
+	switch(vertexDataLayout)
+	{
+#ifdef MATH_SSE2
+	case 1: return true;
+#endif
+#ifdef MATH_AVX
+	case 2: return true;
+#endif
+	case 0: return true;
+	default: return false;
+	}
+}
+
+float TriangleMesh::IntersectTriangles(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV) const
+{
+#ifdef MATH_AVX
+	if (vertexDataLayout == 2)
+		return IntersectTriangles_TriangleIndex_UV_AVX(ray, triangleData, numTris, outTriangleIndex, outU, outV);
+#endif
+#ifdef MATH_SSE41
+	if (vertexDataLayout == 1)
+		return IntersectTriangles_TriangleIndex_UV_SSE41(ray, triangleData, numTris, outTriangleIndex, outU, outV);
+#elif defined(MATH_SSE2)
+	if (vertexDataLayout == 1)
+		return IntersectTriangles_TriangleIndex_UV_SSE2(ray, triangleData, numTris, outTriangleIndex, outU, outV);
+#endif
+	assert(vertexDataLayout == 0);
+	return IntersectTriangles_TriangleIndex_UV_CPP(ray, triangleData, numTris, outTriangleIndex, outU, outV);
+}
+
+void TriangleMesh::IntersectTrianglesPacket(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits) const
+{
+#ifdef MATH_AVX
+	if (vertexDataLayout == 2)
+		return IntersectTrianglesPacket_AVX(rays, numRays, triangleData, numTris, outHits);
+#endif
+#ifdef MATH_SSE41
+	if (vertexDataLayout == 1)
+		return IntersectTrianglesPacket_SSE41(rays, numRays, triangleData, numTris, outHits);
+#elif defined(MATH_SSE2)
+	if (vertexDataLayout == 1)
+		return IntersectTrianglesPacket_SSE2(rays, numRays, triangleData, numTris, outHits);
+#endif
+	assert(vertexDataLayout == 0);
+	for(int i = 0; i < numRays; ++i)
+	{
+		outHits[i].SetMiss();
+		outHits[i].t = IntersectTriangles_TriangleIndex_UV_CPP(rays[i], triangleData, numTris, outHits[i].triangleIndex, outHits[i].u, outHits[i].v);
+	}
+}
+
+void TriangleMesh::SetUseBVH(bool useBVH_)
+{
+	useBVH = useBVH_;
+	if (useBVH)
+		BuildBVH();
+	else
+		FreeBVH();
+}
+
+void TriangleMesh::FreeBVH()
+{
+	AlignedFree(bvhData);
+	bvhData = 0;
+	bvhNodes.clear();
+	bvhTriangleIndices.clear();
+}
+
+/// The BVH is never built deeper than this, which bounds the size of the traversal stacks.
+static const int maxBVHDepth = 48;
+/// The number of bins the surface area heuristic (SAH) considers on each axis.
+static const int numSAHBins = 16;
+
+/// Per-triangle data used while building the BVH.
+struct BVHBuildTriangle
+{
+	float3 minPoint;
+	float3 maxPoint;
+	float3 centroid;
+	int index;
+};
+
+/// Tells whether a triangle falls in the given bin or a bin before it on the given axis.
+struct BinPredicate
+{
+	BinPredicate(int axis_, float minCentroid_, float scale_, int bin_):axis(axis_), minCentroid(minCentroid_), scale(scale_), bin(bin_) {}
+	bool operator()(const BVHBuildTriangle &t) const { return Min((int)((t.centroid[axis] - minCentroid) * scale), numSAHBins - 1) <= bin; }
+	int axis;
+	float minCentroid;
+	float scale;
+	int bin;
+};
+
+/// Orders triangles by their centroid on the given axis.
+struct CentroidLess
+{
+	explicit CentroidLess(int axis_):axis(axis_) {}
+	bool operator()(const BVHBuildTriangle &a, const BVHBuildTriangle &b) const { return a.centroid[axis] < b.centroid[axis]; }
+	int axis;
+};
+
+static inline float HalfSurfaceArea(const float3 &minPoint, const float3 &maxPoint)
+{
+	float3 d = maxPoint - minPoint;
+	return d.x*d.y + d.y*d.z + d.z*d.x;
+}
+
+/// Returns the number of groups of width triangles needed to store n triangles.
+static inline int NumGroups(int n, int width)
+{
+	return (n + width - 1) / width;
+}
+
+/// Returns the vertices of the given triangle of a mesh stored in the layout of the given width (1 = AoS).
+static void LoadTriangle(const float *data, int width, int vertexSizeBytes, int i, float3 &a, float3 &b, float3 &c)
+{
+	if (width == 1)
+	{
+		const int vertexSizeFloats = vertexSizeBytes / 4;
+		const float *v = data + i * 3 * vertexSizeFloats;
+		a = float3(v[0], v[1], v[2]);
+		v += vertexSizeFloats;
+		b = float3(v[0], v[1], v[2]);
+		v += vertexSizeFloats;
+		c = float3(v[0], v[1], v[2]);
+		return;
+	}
+	const float *v = data + (i / width) * 9 * width + (i % width);
+	a = float3(v[0], v[width], v[2*width]);
+	b = float3(v[3*width], v[4*width], v[5*width]);
+	c = float3(v[6*width], v[7*width], v[8*width]);
+#ifdef SOA_HAS_EDGES
+	b += a;
+	c += a;
+#endif
+}
+
+/// Computes the distance along the ray at which it enters the given box, if it enters the box before maxDistance.
+/** @param invDir The reciprocal of the direction of the ray, with a large value in place of each division by zero. */
+static inline bool RayEntersBox(const float3 &minPoint, const float3 &maxPoint, const float3 &pos, const float3 &invDir, float maxDistance, float &outNear)
+{
+	float t1 = (minPoint.x - pos.x) * invDir.x;
+	float t2 = (maxPoint.x - pos.x) * invDir.x;
+	float tNear = Min(t1, t2);
+	float tFar = Max(t1, t2);
+	t1 = (minPoint.y - pos.y) * invDir.y;
+	t2 = (maxPoint.y - pos.y) * invDir.y;
+	tNear = Max(tNear, Min(t1, t2));
+	tFar = Min(tFar, Max(t1, t2));
+	t1 = (minPoint.z - pos.z) * invDir.z;
+	t2 = (maxPoint.z - pos.z) * invDir.z;
+	tNear = Max(tNear, Min(t1, t2));
+	tFar = Min(tFar, Max(t1, t2));
+	outNear = Max(tNear, 0.f);
+	return outNear <= Min(tFar, maxDistance);
+}
+
+static inline float3 SafeInverseDir(const vec &dir)
+{
+	return float3(dir.x != 0.f ? 1.f / dir.x : 1e30f,
+		dir.y != 0.f ? 1.f / dir.y : 1e30f,
+		dir.z != 0.f ? 1.f / dir.z : 1e30f);
+}
+
+void TriangleMesh::BuildBVH()
+{
+	if (!useBVH || numTriangles < minBVHTriangles || !LayoutSupported() || HasBVH())
+		return;
+
+	const int width = LayoutWidth();
+	const int triangleSizeFloats = 3 * vertexSizeBytes / 4;
+	const int leafSize = (width == 1) ? 2 : width;
+
+	// Gather the bounds of each triangle. Degenerate triangles, such as the ones Set(Polyhedron) pads
+	// the mesh with, can never be hit and are left out.
+	std::vector<BVHBuildTriangle> tris;
+	tris.reserve(numTriangles);
+	for(int i = 0; i < numTriangles; ++i)
+	{
+		float3 a, b, c;
+		LoadTriangle(data, width, vertexSizeBytes, i, a, b, c);
+		if (!a.IsFinite() || !b.IsFinite() || !c.IsFinite())
+			continue;
+		BVHBuildTriangle t;
+		t.minPoint = Min(Min(a, b), c);
+		t.maxPoint = Max(Max(a, b), c);
+		// The ray-triangle tests accept hits a small distance outside the triangle, so pad the bounds a bit.
+		float pad = 1e-4f * (1.f + (t.maxPoint - t.minPoint).MaxElement()) + 1e-6f * Max(t.minPoint.Abs().MaxElement(), t.maxPoint.Abs().MaxElement());
+		t.minPoint -= float3(pad, pad, pad);
+		t.maxPoint += float3(pad, pad, pad);
+		t.centroid = (t.minPoint + t.maxPoint) * 0.5f;
+		t.index = i;
+		tris.push_back(t);
+	}
+
+	bvhNodes.reserve(2 * NumGroups((int)tris.size(), leafSize) + 1);
+	bvhNodes.push_back(BVHNode());
+
+	struct BuildTask
+	{
+		int node;
+		int begin;
+		int end;
+		int depth;
+	};
+	std::vector<BuildTask> tasks;
+	BuildTask root = { 0, 0, (int)tris.size(), 0 };
+	tasks.push_back(root);
+	while(!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+		const int n = task.end - task.begin;
+
+		float3 minPoint = float3::inf;
+		float3 maxPoint = -float3::inf;
+		float3 minCentroid = float3::inf;
+		float3 maxCentroid = -float3::inf;
+		for(int i = task.begin; i < task.end; ++i)
+		{
+			minPoint = Min(minPoint, tris[i].minPoint);
+			maxPoint = Max(maxPoint, tris[i].maxPoint);
+			minCentroid = Min(minCentroid, tris[i].centroid);
+			maxCentroid = Max(maxCentroid, tris[i].centroid);
+		}
+		if (n == 0) // Only happens if every triangle of the mesh is degenerate.
+			minPoint = maxPoint = float3::zero;
+		bvhNodes[task.node].minPoint = minPoint;
+		bvhNodes[task.node].maxPoint = maxPoint;
+
+		// Find the binned split with the smallest SAH cost. The leaves are tested width triangles at a time,
+		// so the cost of a leaf is the number of groups of width triangles in it.
+		int bestAxis = -1;
+		int bestBin = 0;
+		float bestCost = (float)NumGroups(n, width);
+		if (n > leafSize && task.depth < maxBVHDepth)
+		{
+			const float invArea = 1.f / Max(HalfSurfaceArea(minPoint, maxPoint), 1e-30f);
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				const float extent = maxCentroid[axis] - minCentroid[axis];
+				if (extent <= 0.f)
+					continue;
+				int binCount[numSAHBins] = {};
+				float3 binMin[numSAHBins];
+				float3 binMax[numSAHBins];
+				for(int b = 0; b < numSAHBins; ++b)
+				{
+					binMin[b] = float3::inf;
+					binMax[b] = -float3::inf;
+				}
+				const float scale = numSAHBins / extent;
+				for(int i = task.begin; i < task.end; ++i)
+				{
+					int b = Min((int)((tris[i].centroid[axis] - minCentroid[axis]) * scale), numSAHBins - 1);
+					++binCount[b];
+					binMin[b] = Min(binMin[b], tris[i].minPoint);
+					binMax[b] = Max(binMax[b], tris[i].maxPoint);
+				}
+
+				// Sweep from the right to get the cost of the right side of each split.
+				float rightCost[numSAHBins];
+				float3 rMin = float3::inf;
+				float3 rMax = -float3::inf;
+				int rCount = 0;
+				for(int b = numSAHBins - 1; b > 0; --b)
+				{
+					rMin = Min(rMin, binMin[b]);
+					rMax = Max(rMax, binMax[b]);
+					rCount += binCount[b];
+					rightCost[b] = rCount > 0 ? HalfSurfaceArea(rMin, rMax) * NumGroups(rCount, width) : 0.f;
+				}
+				float3 lMin = float3::inf;
+				float3 lMax = -float3::inf;
+				int lCount = 0;
+				for(int b = 0; b < numSAHBins - 1; ++b)
+				{
+					lMin = Min(lMin, binMin[b]);
+					lMax = Max(lMax, binMax[b]);
+					lCount += binCount[b];
+					if (lCount == 0 || lCount == n)
+						continue;
+					float cost = 1.f + (HalfSurfaceArea(lMin, lMax) * NumGroups(lCount, width) + rightCost[b+1]) * invArea;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+					}
+				}
+			}
+		}
+
+		int mid = -1;
+		if (bestAxis >= 0)
+		{
+			const int axis = bestAxis;
+			const float minC = minCentroid[axis];
+			const float scale = numSAHBins / (maxCentroid[axis] - minC);
+			BVHBuildTriangle *m = std::partition(&tris[0] + task.begin, &tris[0] + task.end, BinPredicate(axis, minC, scale, bestBin));
+			mid = (int)(m - &tris[0]);
+		}
+		else if (n > 16 * width && task.depth < maxBVHDepth)
+		{
+			// No split pays off by the SAH, but the leaf would be large: split at the median on the longest axis.
+			float3 extent = maxCentroid - minCentroid;
+			const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+			if (extent[axis] > 0.f)
+			{
+				mid = task.begin + n / 2;
+				std::nth_element(&tris[0] + task.begin, &tris[0] + mid, &tris[0] + task.end, CentroidLess(axis));
+			}
+		}
+
+		if (mid > task.begin && mid < task.end)
+		{
+			const int left = (int)bvhNodes.size();
+			bvhNodes.push_back(BVHNode());
+			bvhNodes.push_back(BVHNode());
+			bvhNodes[task.node].first = left;
+			bvhNodes[task.node].numTriangles = 0;
+			BuildTask leftTask = { left, task.begin, mid, task.depth + 1 };
+			BuildTask rightTask = { left + 1, mid, task.end, task.depth + 1 };
+			tasks.push_back(rightTask);
+			tasks.push_back(leftTask);
+		}
+		else
+		{
+			// Make a leaf, padded to a whole number of groups. An empty leaf still gets one group, as a node
+			// without triangles would be taken for an inner node.
+			const int numSlots = Max(NumGroups(n, width), 1) * width;
+			bvhNodes[task.node].first = (int)bvhTriangleIndices.size();
+			bvhNodes[task.node].numTriangles = numSlots;
+			for(int i = task.begin; i < task.end; ++i)
+				bvhTriangleIndices.push_back(tris[i].index);
+			for(int i = n; i < numSlots; ++i)
+				bvhTriangleIndices.push_back(-1);
+		}
+	}
+
+	// Store the triangles of the leaves in the layout of the mesh. The padding slots get zero triangles,
+	// which the ray-triangle tests reject since their determinant is zero.
+	const int numSlots = (int)bvhTriangleIndices.size();
+	bvhData = (float*)AlignedMalloc(numSlots * triangleSizeFloats * sizeof(float), 32);
+	memset(bvhData, 0, numSlots * triangleSizeFloats * sizeof(float));
+	for(int s = 0; s < numSlots; ++s)
+	{
+		const int i = bvhTriangleIndices[s];
+		if (i < 0)
+			continue;
+		if (width == 1)
+			memcpy(bvhData + s * triangleSizeFloats, data + i * triangleSizeFloats, triangleSizeFloats * sizeof(float));
+		else
+		{
+			const float *src = data + (i / width) * 9 * width + (i % width);
+			float *dst = bvhData + (s / width) * 9 * width + (s % width);
+			for(int c = 0; c < 9; ++c)
+				dst[c*width] = src[c*width];
+		}
+	}
+}
+
+float TriangleMesh::IntersectRay_BVH(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
+{
+	assert(HasBVH());
+	const int triangleSizeFloats = 3 * vertexSizeBytes / 4;
+	const float3 pos = POINT_TO_FLOAT3(ray.pos);
+	const float3 invDir = SafeInverseDir(ray.dir);
+
+	float nearestD = FLOAT_INF;
+
+	struct StackEntry
+	{
+		int node;
+		float tNear;
+	};
+	StackEntry stack[maxBVHDepth + 2];
+	int stackSize = 0;
+
+	float tNear;
+	if (!RayEntersBox(bvhNodes[0].minPoint, bvhNodes[0].maxPoint, pos, invDir, FLOAT_INF, tNear))
+		return FLOAT_INF;
+	stack[0].node = 0;
+	stack[0].tNear = tNear;
+	stackSize = 1;
+
+	while(stackSize > 0)
+	{
+		const StackEntry top = stack[--stackSize];
+		if (top.tNear > nearestD)
+			continue;
+		const BVHNode &node = bvhNodes[top.node];
+		if (node.numTriangles > 0)
+		{
+			int triangleIndex = -1;
+			float u = 0.f, v = 0.f;
+			float d = IntersectTriangles(ray, bvhData + node.first * triangleSizeFloats, node.numTriangles, triangleIndex, u, v);
+			if (d < nearestD)
+			{
+				nearestD = d;
+				outTriangleIndex = bvhTriangleIndices[node.first + triangleIndex];
+				outU = u;
+				outV = v;
+			}
+			continue;
+		}
+
+		const BVHNode &left = bvhNodes[node.first];
+		const BVHNode &right = bvhNodes[node.first + 1];
+		float tLeft, tRight;
+		bool hitLeft = RayEntersBox(left.minPoint, left.maxPoint, pos, invDir, nearestD, tLeft);
+		bool hitRight = RayEntersBox(right.minPoint, right.maxPoint, pos, invDir, nearestD, tRight);
+		// Push the farther child first, so that the nearer one is visited first.
+		if (hitLeft && hitRight && tLeft < tRight)
+		{
+			stack[stackSize].node = node.first + 1;
+			stack[stackSize++].tNear = tRight;
+			hitRight = false;
+		}
+		if (hitLeft)
+		{
+			stack[stackSize].node = node.first;
+			stack[stackSize++].tNear = tLeft;
+		}
+		if (hitRight)
+		{
+			stack[stackSize].node = node.first + 1;
+			stack[stackSize++].tNear = tRight;
+		}
+		assert(stackSize <= maxBVHDepth + 2);
+	}
+	return nearestD;
+}
+
+void TriangleMesh::IntersectRays_BVH(const Ray *rays, int numRays, RayTriangleHit *outHits) const
+{
+	assert(HasBVH());
+	if (vertexDataLayout == 0)
+	{
+		for(int i = 0; i < numRays; ++i)
+		{
+			outHits[i].SetMiss();
+			outHits[i].t = IntersectRay_BVH(rays[i], outHits[i].triangleIndex, outHits[i].u, outHits[i].v);
+		}
+		return;
+	}
+
+	// Trace the rays in packets of the width of the layout. A node is visited if any ray of the packet
+	// enters it before its nearest hit so far, and each leaf is tested with all the rays of the packet.
+	const int packetSize = LayoutWidth();
+	const int triangleSizeFloats = 3 * vertexSizeBytes / 4;
+	for(int r = 0; r < numRays; r += packetSize)
+	{
+		const Ray *packet = rays + r;
+		RayTriangleHit *hits = outHits + r;
+		const int n = Min(packetSize, numRays - r);
+		float3 pos[8];
+		float3 invDir[8];
+		for(int j = 0; j < n; ++j)
+		{
+			hits[j].SetMiss();
+			pos[j] = POINT_TO_FLOAT3(packet[j].pos);
+			invDir[j] = SafeInverseDir(packet[j].dir);
+		}
+
+		int stack[maxBVHDepth + 2];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize > 0)
+		{
+			const BVHNode &node = bvhNodes[stack[--stackSize]];
+			float tNear;
+			bool entered = false;
+			for(int j = 0; j < n && !entered; ++j)
+				entered = RayEntersBox(node.minPoint, node.maxPoint, pos[j], invDir[j], hits[j].t, tNear);
+			if (!entered)
+				continue;
+
+			if (node.numTriangles > 0)
+			{
+				RayTriangleHit leafHits[8];
+				IntersectTrianglesPacket(packet, n, bvhData + node.first * triangleSizeFloats, node.numTriangles, leafHits);
+				for(int j = 0; j < n; ++j)
+					if (leafHits[j].t < hits[j].t)
+					{
+						hits[j] = leafHits[j];
+						hits[j].triangleIndex = bvhTriangleIndices[node.first + leafHits[j].triangleIndex];
+					}
+				continue;
+			}
+
+			// Visit first the child that is nearer along the direction of the first ray on the axis where the
+			// children are the farthest apart.
+			const BVHNode &left = bvhNodes[node.first];
+			const BVHNode &right = bvhNodes[node.first + 1];
+			float3 d = (right.minPoint + right.maxPoint) - (left.minPoint + left.maxPoint);
+			float3 dir = DIR_TO_FLOAT3(packet[0].dir);
+			int axis = (Abs(d.x) >= Abs(d.y) && Abs(d.x) >= Abs(d.z)) ? 0 : (Abs(d.y) >= Abs(d.z) ? 1 : 2);
+			bool leftFirst = (d[axis] * dir[axis] >= 0.f);
+			stack[stackSize++] = leftFirst ? node.first + 1 : node.first;
+			stack[stackSize++] = leftFirst ? node.first : node.first + 1;
+			assert(stackSize <= maxBVHDepth + 2);
+		}
+	}
+}
+
 MATH_END_NAMESPACE
 
 #ifdef MATH_SSE2
@@ -449,6 +1164,9 @@ MATH_END_NAMESPACE
 #define MATH_GEN_TRIANGLEINDEX
 #define MATH_GEN_UV
 #include "TriangleMesh_IntersectRay_SSE.inl"
+
+#define MATH_GEN_SSE2
+#include "TriangleMesh_IntersectRays_SSE.inl"
 #endif
 
 #ifdef MATH_SSE41
@@ -463,6 +1181,9 @@ MATH_END_NAMESPACE
 #define MATH_GEN_TRIANGLEINDEX
 #define MATH_GEN_UV
 #include "TriangleMesh_IntersectRay_SSE.inl"
+
+#define MATH_GEN_SSE41
+#include "TriangleMesh_IntersectRays_SSE.inl"
 #endif
 
 #ifdef MATH_AVX
@@ -477,4 +1198,6 @@ MATH_END_NAMESPACE
 #define MATH_GEN_TRIANGLEINDEX
 #define MATH_GEN_UV
 #include "TriangleMesh_IntersectRay_AVX.inl"
+
+#include "TriangleMesh_IntersectRays_AVX.inl"
 #endif
@@ -20,11 +20,17 @@
 #include "../MathGeoLibFwd.h"
 #include "../Math/float3.h"
 #include "Triangle.h"
+#include <vector>
 
 MATH_BEGIN_NAMESPACE
 
 /// Represents an unindiced triangle mesh.
-/** This class stores a triangle mesh as flat array, optimized for ray intersections. */
+/** This class stores a triangle mesh as flat array, optimized for ray intersections.
+	Meshes of at least minBVHTriangles triangles are also given a bounding volume hierarchy (BVH), which
+	IntersectRay(), IntersectRay_TriangleIndex(), IntersectRay_TriangleIndex_UV() and IntersectRays() use
+	to test only the triangles near each ray. The leaves of the BVH store their triangles in the same
+	layout as the flat array, so they are tested with the same SSE/AVX routines. The functions with an
+	instruction set suffix, e.g. IntersectRay_AVX(), always test every triangle of the flat array. */
 class TriangleMesh
 {
 public:
@@ -47,38 +53,132 @@ public:
 	float IntersectRay_TriangleIndex(const Ray &ray, int &outTriangleIndex) const;
 	float IntersectRay_TriangleIndex_UV(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const;
 
+	/// Finds the nearest hit of each of the given rays with this mesh.
+	/** With SIMD, the rays are traced in packets of 4 (SSE) or 8 (AVX), so that each group of triangles of the
+		SoA4/SoA8 layout is loaded once per packet and not once per ray. Prefer this over calling IntersectRay()
+		in a loop when there are many rays, e.g. all the rays of a tile of an image.
+		@param outHits [out] Receives the hit of each ray. Must have room for numRays hits. */
+	void IntersectRays(const Ray *rays, int numRays, RayTriangleHit *outHits) const;
+
+	/// Finds the nearest hit of each of the given rays with this mesh, on all the threads of the given pool.
+	/** The rays are split into tiles of rayTileSize rays, which the threads of the pool take and steal from each
+		other, and each tile is traced with IntersectRays(). Use this
+		for large batches of rays, e.g. the shadow rays of a frame or the rays of a visibility map. Keep rays that
+		are near each other in the array next to each other, so that the rays of each tile are coherent.
+		@param outT [out] Receives the distance along each ray to its hit, or FLOAT_INF if the ray misses the mesh.
+		@param outTriangleIndex [out] Receives the index of the triangle each ray hits, or -1. May be null.
+		@param outU [out] Receives the barycentric U coordinate of each hit, or 0. May be null.
+		@param outV [out] Receives the barycentric V coordinate of each hit, or 0. May be null.
+		@see ThreadPool::Default(). */
+	void IntersectRaysParallel(const Ray *rays, int numRays, float *outT, int *outTriangleIndex, float *outU, float *outV, ThreadPool &threadPool) const;
+	/// Like above, on the threads of ThreadPool::Default().
+	void IntersectRaysParallel(const Ray *rays, int numRays, float *outT, int *outTriangleIndex = 0, float *outU = 0, float *outV = 0) const;
+
+	/// The number of rays IntersectRaysParallel() gives to a thread at a time.
+	static const int rayTileSize = 64;
+
+	/// The number of triangles from which on the ray queries use a BVH.
+	static const int minBVHTriangles = 64;
+
+	/// Specifies whether the ray queries use a BVH for meshes of at least minBVHTriangles triangles. On by default.
+	/** The BVH is built when the mesh is set, or here if the mesh was set without one, so that the const ray
+		queries never modify the mesh and can be run from several threads at once. */
+	void SetUseBVH(bool useBVH);
+
+	/// Returns true if the BVH has been built.
+	bool HasBVH() const { return !bvhNodes.empty(); }
+
 	void SetAoS(const float *vertexData, int numTriangles, int vertexSizeBytes);
 	void SetSoA4(const float *vertexData, int numTriangles, int vertexSizeBytes);
 	void SetSoA8(const float *vertexData, int numTriangles, int vertexSizeBytes);
 
 	float IntersectRay_TriangleIndex_UV_CPP(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const;
+	void IntersectRays_CPP(const Ray *rays, int numRays, RayTriangleHit *outHits) const;
 
 #ifdef MATH_SSE2
 	float IntersectRay_SSE2(const Ray &ray) const;
 	float IntersectRay_TriangleIndex_SSE2(const Ray &ray, int &outTriangleIndex) const;
 	float IntersectRay_TriangleIndex_UV_SSE2(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const;
+	void IntersectRays_SSE2(const Ray *rays, int numRays, RayTriangleHit *outHits) const;
 #endif
 
 #ifdef MATH_SSE41
 	float IntersectRay_SSE41(const Ray &ray) const;
 	float IntersectRay_TriangleIndex_SSE41(const Ray &ray, int &outTriangleIndex) const;
 	float IntersectRay_TriangleIndex_UV_SSE41(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const;
+	void IntersectRays_SSE41(const Ray *rays, int numRays, RayTriangleHit *outHits) const;
 #endif
 
 #ifdef MATH_AVX
 	float IntersectRay_AVX(const Ray &ray) const;
 	float IntersectRay_TriangleIndex_AVX(const Ray &ray, int &outTriangleIndex) const;
 	float IntersectRay_TriangleIndex_UV_AVX(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const;
+	void IntersectRays_AVX(const Ray *rays, int numRays, RayTriangleHit *outHits) const;
 #endif
 
 private:
+	/// A node of the BVH.
+	struct BVHNode
+	{
+		float3 minPoint;
+		float3 maxPoint;
+		/// If this is an inner node, the index of the left child. The right child follows it.
+		/// If this is a leaf, the index of the first triangle of the leaf in bvhData.
+		int first;
+		/// If this is a leaf, the number of triangles in it, padded to the width of the layout. Zero for inner nodes.
+		int numTriangles;
+	};
+
 	float *data; // This is always allocated to tightly-packed numTriangles*3*vertexSizeBytes bytes.
 	int numTriangles;
 	int vertexSizeBytes;
-#ifdef _DEBUG
 	int vertexDataLayout; // 0 - AoS, 1 - SoA4, 2 - SoA8
-#endif
+	bool useBVH;
+
+	std::vector<BVHNode> bvhNodes; // The root is node 0.
+	float *bvhData; // The triangles of the leaves one after another, in the layout of data.
+	std::vector<int> bvhTriangleIndices; // The index in data of each triangle of bvhData, -1 for padding.
+
 	void ReallocVertexBuffer(int numTriangles, int vertexSizeBytes);
+
+	/// Builds the BVH, if the ray queries use one and it is not built yet.
+	void BuildBVH();
+	void FreeBVH();
+	/// Returns the number of triangles stored together in the current layout: 1, 4 or 8.
+	int LayoutWidth() const;
+	/// Returns true if there is a routine for intersecting rays with the triangles of the current layout.
+	bool LayoutSupported() const;
+
+	float IntersectRay_BVH(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const;
+	void IntersectRays_BVH(const Ray *rays, int numRays, RayTriangleHit *outHits) const;
+
+	/// Tests the ray against the given triangles in the current layout.
+	float IntersectTriangles(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV) const;
+	/// Tests the rays against the given triangles in the current layout.
+	void IntersectTrianglesPacket(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits) const;
+
+	static float IntersectTriangles_TriangleIndex_UV_CPP(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV);
+
+#ifdef MATH_SSE2
+	static float IntersectTriangles_SSE2(const Ray &ray, const float *triangleData, int numTris);
+	static float IntersectTriangles_TriangleIndex_SSE2(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex);
+	static float IntersectTriangles_TriangleIndex_UV_SSE2(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV);
+	static void IntersectTrianglesPacket_SSE2(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits);
+#endif
+
+#ifdef MATH_SSE41
+	static float IntersectTriangles_SSE41(const Ray &ray, const float *triangleData, int numTris);
+	static float IntersectTriangles_TriangleIndex_SSE41(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex);
+	static float IntersectTriangles_TriangleIndex_UV_SSE41(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV);
+	static void IntersectTrianglesPacket_SSE41(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits);
+#endif
+
+#ifdef MATH_AVX
+	static float IntersectTriangles_AVX(const Ray &ray, const float *triangleData, int numTris);
+	static float IntersectTriangles_TriangleIndex_AVX(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex);
+	static float IntersectTriangles_TriangleIndex_UV_AVX(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV);
+	static void IntersectTrianglesPacket_AVX(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits);
+#endif
 };
 
 MATH_END_NAMESPACE
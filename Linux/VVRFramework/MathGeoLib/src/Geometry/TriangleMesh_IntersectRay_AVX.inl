@@ -21,21 +21,17 @@
 MATH_BEGIN_NAMESPACE
 
 #if !defined(MATH_GEN_TRIANGLEINDEX)
-float TriangleMesh::IntersectRay_AVX(const Ray &ray) const
+float TriangleMesh::IntersectTriangles_AVX(const Ray &ray, const float *triangleData, int numTris)
 #elif defined(MATH_GEN_TRIANGLEINDEX) && !defined(MATH_GEN_UV)
-float TriangleMesh::IntersectRay_TriangleIndex_AVX(const Ray &ray, int &outTriangleIndex) const
+float TriangleMesh::IntersectTriangles_TriangleIndex_AVX(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex)
 #elif defined(MATH_GEN_TRIANGLEINDEX) && defined(MATH_GEN_UV)
-float TriangleMesh::IntersectRay_TriangleIndex_UV_AVX(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
+float TriangleMesh::IntersectTriangles_TriangleIndex_UV_AVX(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV)
 #endif
 {
 //	std::cout << numTris << " tris: ";
 //	TRACESTART(RayTriMeshIntersectAVX);
 
 	assert(sizeof(float3) == 3*sizeof(float));
-	assert(sizeof(Triangle) == 3*sizeof(vec));
-#ifdef _DEBUG
-	assert(vertexDataLayout == 2); // Must be SoA8 structured!
-#endif
 
 //	hitTriangleIndex = -1;
 //	float3 pt;
@@ -61,11 +57,11 @@ float TriangleMesh::IntersectRay_TriangleIndex_UV_AVX(const Ray &ray, int &outTr
 	const __m256 zero = _mm256_setzero_ps();
 	const __m256 one = _mm256_set1_ps(1.f);
 
-	assert(((uintptr_t)data & 0x1F) == 0);
+	assert(((uintptr_t)triangleData & 0x1F) == 0);
 
-	const float *tris = reinterpret_cast<const float*>(data);
+	const float *tris = triangleData;
 
-	for(int i = 0; i+8 <= numTriangles; i += 8)
+	for(int i = 0; i+8 <= numTris; i += 8)
 	{
 		__m256 v0x = _mm256_load_ps(tris);
 		__m256 v0y = _mm256_load_ps(tris+8);
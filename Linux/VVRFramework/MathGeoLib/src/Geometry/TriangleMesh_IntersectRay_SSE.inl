@@ -18,27 +18,23 @@
 MATH_BEGIN_NAMESPACE
 
 #if defined(MATH_GEN_SSE2) && !defined(MATH_GEN_TRIANGLEINDEX)
-float TriangleMesh::IntersectRay_SSE2(const Ray &ray) const
+float TriangleMesh::IntersectTriangles_SSE2(const Ray &ray, const float *triangleData, int numTris)
 #elif defined(MATH_GEN_SSE2) && defined(MATH_GEN_TRIANGLEINDEX) && !defined(MATH_GEN_UV)
-float TriangleMesh::IntersectRay_TriangleIndex_SSE2(const Ray &ray, int &outTriangleIndex) const
+float TriangleMesh::IntersectTriangles_TriangleIndex_SSE2(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex)
 #elif defined(MATH_GEN_SSE2) && defined(MATH_GEN_TRIANGLEINDEX) && defined(MATH_GEN_UV)
-float TriangleMesh::IntersectRay_TriangleIndex_UV_SSE2(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
+float TriangleMesh::IntersectTriangles_TriangleIndex_UV_SSE2(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV)
 #elif defined(MATH_GEN_SSE41) && !defined(MATH_GEN_TRIANGLEINDEX)
-float TriangleMesh::IntersectRay_SSE41(const Ray &ray) const
+float TriangleMesh::IntersectTriangles_SSE41(const Ray &ray, const float *triangleData, int numTris)
 #elif defined(MATH_GEN_SSE41) && defined(MATH_GEN_TRIANGLEINDEX) && !defined(MATH_GEN_UV)
-float TriangleMesh::IntersectRay_TriangleIndex_SSE41(const Ray &ray, int &outTriangleIndex) const
+float TriangleMesh::IntersectTriangles_TriangleIndex_SSE41(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex)
 #elif defined(MATH_GEN_SSE41) && defined(MATH_GEN_TRIANGLEINDEX) && defined(MATH_GEN_UV)
-float TriangleMesh::IntersectRay_TriangleIndex_UV_SSE41(const Ray &ray, int &outTriangleIndex, float &outU, float &outV) const
+float TriangleMesh::IntersectTriangles_TriangleIndex_UV_SSE41(const Ray &ray, const float *triangleData, int numTris, int &outTriangleIndex, float &outU, float &outV)
 #endif
 {
 //	std::cout << numTris << " tris: ";
 //	TRACESTART(RayTriMeshIntersectSSE);
 
 	assert(sizeof(float3) == 3*sizeof(float));
-	assert(sizeof(Triangle) == 3*sizeof(float3));
-#ifdef _DEBUG
-	assert(vertexDataLayout == 1); // Must be SoA4 structured!
-#endif
 	
 	const float inf = FLOAT_INF;
 	__m128 nearestD = _mm_set1_ps(inf);
@@ -64,11 +60,11 @@ float TriangleMesh::IntersectRay_TriangleIndex_UV_SSE41(const Ray &ray, int &out
 
     const __m128 sign_mask = _mm_set1_ps(-0.f); // -0.f = 1 << 31
 
-	assert(((uintptr_t)data & 0xF) == 0);
+	assert(((uintptr_t)triangleData & 0xF) == 0);
 
-	const float *tris = reinterpret_cast<const float*>(data);
+	const float *tris = triangleData;
 
-	for(int i = 0; i+4 <= numTriangles; i += 4)
+	for(int i = 0; i+4 <= numTris; i += 4)
 	{
 		__m128 v0x = _mm_load_ps(tris);
 		__m128 v0y = _mm_load_ps(tris+4);
@@ -0,0 +1,173 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file TriangleMesh_IntersectRays_AVX.inl
+	@author Jukka Jylnki
+	@brief AVX implementation of ray packet-mesh intersection routines. */
+
+#include "../Math/SSEMath.h"
+
+MATH_BEGIN_NAMESPACE
+
+void TriangleMesh::IntersectTrianglesPacket_AVX(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits)
+{
+	assert(sizeof(float3) == 3*sizeof(float));
+
+	const __m256 epsilon = _mm256_set1_ps(1e-4f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.f);
+
+	assert(((uintptr_t)triangleData & 0x1F) == 0);
+
+	// The rays are processed in packets of 8, one ray in each lane. Each triangle is broadcast to all
+	// lanes, so that the data of each triangle is read only once per packet.
+	for(int r = 0; r < numRays; r += 8)
+	{
+		ALIGN32 float packet[6][8];
+		for(int j = 0; j < 8; ++j)
+		{
+			const Ray &ray = rays[r+j < numRays ? r+j : numRays-1]; // Pad a partial packet with the last ray.
+			packet[0][j] = ray.pos.x;
+			packet[1][j] = ray.pos.y;
+			packet[2][j] = ray.pos.z;
+			packet[3][j] = ray.dir.x;
+			packet[4][j] = ray.dir.y;
+			packet[5][j] = ray.dir.z;
+		}
+		const __m256 lX = _mm256_load_ps(packet[0]);
+		const __m256 lY = _mm256_load_ps(packet[1]);
+		const __m256 lZ = _mm256_load_ps(packet[2]);
+
+		const __m256 dX = _mm256_load_ps(packet[3]);
+		const __m256 dY = _mm256_load_ps(packet[4]);
+		const __m256 dZ = _mm256_load_ps(packet[5]);
+
+		__m256 nearestD = _mm256_set1_ps(FLOAT_INF);
+		__m256 nearestU = zero;
+		__m256 nearestV = zero;
+		__m256i nearestIndex = _mm256_set1_epi32(-1);
+
+		const float *tris = triangleData;
+
+		for(int i = 0; i+8 <= numTris; i += 8)
+		{
+			for(int k = 0; k < 8; ++k)
+			{
+				__m256 v0x = _mm256_broadcast_ss(tris+k);
+				__m256 v0y = _mm256_broadcast_ss(tris+8+k);
+				__m256 v0z = _mm256_broadcast_ss(tris+16+k);
+
+#ifdef SOA_HAS_EDGES
+				__m256 e1x = _mm256_broadcast_ss(tris+24+k);
+				__m256 e1y = _mm256_broadcast_ss(tris+32+k);
+				__m256 e1z = _mm256_broadcast_ss(tris+40+k);
+
+				__m256 e2x = _mm256_broadcast_ss(tris+48+k);
+				__m256 e2y = _mm256_broadcast_ss(tris+56+k);
+				__m256 e2z = _mm256_broadcast_ss(tris+64+k);
+#else
+				// Edge vectors
+				__m256 e1x = _mm256_sub_ps(_mm256_broadcast_ss(tris+24+k), v0x);
+				__m256 e1y = _mm256_sub_ps(_mm256_broadcast_ss(tris+32+k), v0y);
+				__m256 e1z = _mm256_sub_ps(_mm256_broadcast_ss(tris+40+k), v0z);
+
+				__m256 e2x = _mm256_sub_ps(_mm256_broadcast_ss(tris+48+k), v0x);
+				__m256 e2y = _mm256_sub_ps(_mm256_broadcast_ss(tris+56+k), v0y);
+				__m256 e2z = _mm256_sub_ps(_mm256_broadcast_ss(tris+64+k), v0z);
+#endif
+
+				// begin calculating determinant - also used to calculate U parameter
+				__m256 px = _mm256_sub_ps(_mm256_mul_ps(dY, e2z), _mm256_mul_ps(dZ, e2y));
+				__m256 py = _mm256_sub_ps(_mm256_mul_ps(dZ, e2x), _mm256_mul_ps(dX, e2z));
+				__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dX, e2y), _mm256_mul_ps(dY, e2x));
+
+				// If det < 0, intersecting backfacing tri, > 0, intersecting frontfacing tri, 0, parallel to plane.
+				__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+
+				// If determinant is near zero, ray lies in plane of triangle.
+				__m256 recipDet = _mm256_rcp_ps(det);
+
+				__m256 absdet = abs_ps256(det);
+				__m256 out = _mm256_cmp_ps(absdet, epsilon, _CMP_LT_OQ);
+
+				// Calculate distance from v0 to ray origin
+				__m256 tx = _mm256_sub_ps(lX, v0x);
+				__m256 ty = _mm256_sub_ps(lY, v0y);
+				__m256 tz = _mm256_sub_ps(lZ, v0z);
+
+				// Output barycentric u
+				__m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, px), _mm256_mul_ps(ty, py)), _mm256_mul_ps(tz, pz)), recipDet);
+
+				__m256 out2 = _mm256_cmp_ps(u, zero, _CMP_LT_OQ);
+				out = _mm256_or_ps(out, out2);
+				out2 = _mm256_cmp_ps(u, one, _CMP_GT_OQ);
+				out = _mm256_or_ps(out, out2);
+
+				// Prepare to test V parameter
+				__m256 qx = _mm256_sub_ps(_mm256_mul_ps(ty, e1z), _mm256_mul_ps(tz, e1y));
+				__m256 qy = _mm256_sub_ps(_mm256_mul_ps(tz, e1x), _mm256_mul_ps(tx, e1z));
+				__m256 qz = _mm256_sub_ps(_mm256_mul_ps(tx, e1y), _mm256_mul_ps(ty, e1x));
+
+				// Output barycentric v
+				__m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dX, qx), _mm256_mul_ps(dY, qy)), _mm256_mul_ps(dZ, qz)), recipDet);
+
+				out2 = _mm256_cmp_ps(v, zero, _CMP_LT_OQ);
+				out = _mm256_or_ps(out, out2);
+				__m256 uv = _mm256_add_ps(u, v);
+				out2 = _mm256_cmp_ps(uv, one, _CMP_GT_OQ);
+				out = _mm256_or_ps(out, out2);
+
+				// Output signed distance from ray to triangle.
+				__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), recipDet);
+
+				// t < 0?
+				out2 = _mm256_cmp_ps(t, zero, _CMP_LT_OQ);
+				out = _mm256_or_ps(out, out2);
+
+				// Not better than previous result? This is also true if t is NaN, e.g. for the degenerate
+				// triangles the mesh may be padded with.
+				out2 = _mm256_cmp_ps(t, nearestD, _CMP_NLT_UQ);
+				out = _mm256_or_ps(out, out2);
+
+				// The mask 'out' now contains 0xFF in all lanes which are worse than previous, and
+				// 0x00 in lanes which are better.
+				__m256i hitIndex = _mm256_set1_epi32(i+k);
+				nearestD = _mm256_blendv_ps(t, nearestD, out);
+				nearestU = _mm256_blendv_ps(u, nearestU, out);
+				nearestV = _mm256_blendv_ps(v, nearestV, out);
+				nearestIndex = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(hitIndex), _mm256_castsi256_ps(nearestIndex), out));
+			}
+			tris += 72;
+		}
+
+		ALIGN32 float d[8];
+		ALIGN32 float u[8];
+		ALIGN32 float v[8];
+		ALIGN32 int idx[8];
+		_mm256_store_ps(d, nearestD);
+		_mm256_store_ps(u, nearestU);
+		_mm256_store_ps(v, nearestV);
+		_mm256_store_si256((__m256i*)idx, nearestIndex);
+		for(int j = 0; j < 8 && r+j < numRays; ++j)
+		{
+			RayTriangleHit &hit = outHits[r+j];
+			hit.t = d[j];
+			hit.triangleIndex = idx[j];
+			hit.u = u[j];
+			hit.v = v[j];
+		}
+	}
+}
+
+MATH_END_NAMESPACE
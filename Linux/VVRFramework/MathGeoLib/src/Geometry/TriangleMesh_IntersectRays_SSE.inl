@@ -0,0 +1,191 @@
+/* Copyright Jukka Jylnki
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+/** @file TriangleMesh_IntersectRays_SSE.inl
+	@author Jukka Jylnki
+	@brief SSE implementation of ray packet-mesh intersection routines. */
+MATH_BEGIN_NAMESPACE
+
+#if defined(MATH_GEN_SSE2)
+void TriangleMesh::IntersectTrianglesPacket_SSE2(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits)
+#elif defined(MATH_GEN_SSE41)
+void TriangleMesh::IntersectTrianglesPacket_SSE41(const Ray *rays, int numRays, const float *triangleData, int numTris, RayTriangleHit *outHits)
+#endif
+{
+	assert(sizeof(float3) == 3*sizeof(float));
+
+	const __m128 epsilon = _mm_set1_ps(1e-4f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+
+	const __m128 sign_mask = _mm_set1_ps(-0.f); // -0.f = 1 << 31
+
+	assert(((uintptr_t)triangleData & 0xF) == 0);
+
+	// The rays are processed in packets of 4, one ray in each lane. Each triangle is broadcast to all
+	// lanes, so that the data of each triangle is read only once per packet.
+	for(int r = 0; r < numRays; r += 4)
+	{
+		ALIGN16 float packet[6][4];
+		for(int j = 0; j < 4; ++j)
+		{
+			const Ray &ray = rays[r+j < numRays ? r+j : numRays-1]; // Pad a partial packet with the last ray.
+			packet[0][j] = ray.pos.x;
+			packet[1][j] = ray.pos.y;
+			packet[2][j] = ray.pos.z;
+			packet[3][j] = ray.dir.x;
+			packet[4][j] = ray.dir.y;
+			packet[5][j] = ray.dir.z;
+		}
+		const __m128 lX = _mm_load_ps(packet[0]);
+		const __m128 lY = _mm_load_ps(packet[1]);
+		const __m128 lZ = _mm_load_ps(packet[2]);
+
+		const __m128 dX = _mm_load_ps(packet[3]);
+		const __m128 dY = _mm_load_ps(packet[4]);
+		const __m128 dZ = _mm_load_ps(packet[5]);
+
+		__m128 nearestD = _mm_set1_ps(FLOAT_INF);
+		__m128 nearestU = zero;
+		__m128 nearestV = zero;
+		__m128i nearestIndex = _mm_set1_epi32(-1);
+
+		const float *tris = triangleData;
+
+		for(int i = 0; i+4 <= numTris; i += 4)
+		{
+			for(int k = 0; k < 4; ++k)
+			{
+				__m128 v0x = _mm_load1_ps(tris+k);
+				__m128 v0y = _mm_load1_ps(tris+4+k);
+				__m128 v0z = _mm_load1_ps(tris+8+k);
+
+#ifdef SOA_HAS_EDGES
+				__m128 e1x = _mm_load1_ps(tris+12+k);
+				__m128 e1y = _mm_load1_ps(tris+16+k);
+				__m128 e1z = _mm_load1_ps(tris+20+k);
+
+				__m128 e2x = _mm_load1_ps(tris+24+k);
+				__m128 e2y = _mm_load1_ps(tris+28+k);
+				__m128 e2z = _mm_load1_ps(tris+32+k);
+#else
+				// Edge vectors
+				__m128 e1x = _mm_sub_ps(_mm_load1_ps(tris+12+k), v0x);
+				__m128 e1y = _mm_sub_ps(_mm_load1_ps(tris+16+k), v0y);
+				__m128 e1z = _mm_sub_ps(_mm_load1_ps(tris+20+k), v0z);
+
+				__m128 e2x = _mm_sub_ps(_mm_load1_ps(tris+24+k), v0x);
+				__m128 e2y = _mm_sub_ps(_mm_load1_ps(tris+28+k), v0y);
+				__m128 e2z = _mm_sub_ps(_mm_load1_ps(tris+32+k), v0z);
+#endif
+
+				// begin calculating determinant - also used to calculate U parameter
+				__m128 px = _mm_sub_ps(_mm_mul_ps(dY, e2z), _mm_mul_ps(dZ, e2y));
+				__m128 py = _mm_sub_ps(_mm_mul_ps(dZ, e2x), _mm_mul_ps(dX, e2z));
+				__m128 pz = _mm_sub_ps(_mm_mul_ps(dX, e2y), _mm_mul_ps(dY, e2x));
+
+				// If det < 0, intersecting backfacing tri, > 0, intersecting frontfacing tri, 0, parallel to plane.
+				__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+
+				// If determinant is near zero, ray lies in plane of triangle.
+				__m128 recipDet = _mm_rcp_ps(det);
+
+				__m128 absdet = _mm_andnot_ps(sign_mask, det);
+				__m128 out = _mm_cmple_ps(absdet, epsilon);
+
+				// Calculate distance from v0 to ray origin
+				__m128 tx = _mm_sub_ps(lX, v0x);
+				__m128 ty = _mm_sub_ps(lY, v0y);
+				__m128 tz = _mm_sub_ps(lZ, v0z);
+
+				// Output barycentric u
+				__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), recipDet);
+
+				__m128 out2 = _mm_cmplt_ps(u, zero);
+				out = _mm_or_ps(out, out2);
+				out2 = _mm_cmpgt_ps(u, one);
+				out = _mm_or_ps(out, out2);
+
+				// Prepare to test V parameter
+				__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+				__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+				__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+				// Output barycentric v
+				__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dX, qx), _mm_mul_ps(dY, qy)), _mm_mul_ps(dZ, qz)), recipDet);
+
+				out2 = _mm_cmplt_ps(v, zero);
+				out = _mm_or_ps(out, out2);
+				__m128 uv = _mm_add_ps(u, v);
+				out2 = _mm_cmpgt_ps(uv, one);
+				out = _mm_or_ps(out, out2);
+
+				// Output signed distance from ray to triangle.
+				__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), recipDet);
+
+				// t < 0?
+				out2 = _mm_cmplt_ps(t, zero);
+				out = _mm_or_ps(out, out2);
+
+				// Not better than previous result? This is also true if t is NaN, e.g. for the degenerate
+				// triangles the mesh may be padded with.
+				out2 = _mm_cmpnlt_ps(t, nearestD);
+				out = _mm_or_ps(out, out2);
+
+				// The mask 'out' now contains 0xFF in all lanes which are worse than previous, and
+				// 0x00 in lanes which are better.
+				__m128i hitIndex = _mm_set1_epi32(i+k);
+#ifdef MATH_GEN_SSE41
+				nearestD = _mm_blendv_ps(t, nearestD, out);
+				nearestU = _mm_blendv_ps(u, nearestU, out);
+				nearestV = _mm_blendv_ps(v, nearestV, out);
+				nearestIndex = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(hitIndex), _mm_castsi128_ps(nearestIndex), out));
+#else
+				// If SSE 4.1 is not available:
+				nearestD = _mm_or_ps(_mm_and_ps(out, nearestD), _mm_andnot_ps(out, t));
+				nearestU = _mm_or_ps(_mm_and_ps(out, nearestU), _mm_andnot_ps(out, u));
+				nearestV = _mm_or_ps(_mm_and_ps(out, nearestV), _mm_andnot_ps(out, v));
+				nearestIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(out), nearestIndex), _mm_andnot_si128(_mm_castps_si128(out), hitIndex));
+#endif
+			}
+			tris += 36;
+		}
+
+		ALIGN16 float d[4];
+		ALIGN16 float u[4];
+		ALIGN16 float v[4];
+		ALIGN16 int idx[4];
+		_mm_store_ps(d, nearestD);
+		_mm_store_ps(u, nearestU);
+		_mm_store_ps(v, nearestV);
+		_mm_store_si128((__m128i*)idx, nearestIndex);
+		for(int j = 0; j < 4 && r+j < numRays; ++j)
+		{
+			RayTriangleHit &hit = outHits[r+j];
+			hit.t = d[j];
+			hit.triangleIndex = idx[j];
+			hit.u = u[j];
+			hit.v = v[j];
+		}
+	}
+}
+
+#ifdef MATH_GEN_SSE2
+#undef MATH_GEN_SSE2
+#endif
+#ifdef MATH_GEN_SSE41
+#undef MATH_GEN_SSE41
+#endif
+
+MATH_END_NAMESPACE
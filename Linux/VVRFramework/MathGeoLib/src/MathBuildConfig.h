@@ -79,6 +79,14 @@
 #define MATH_ENABLE_STL_SUPPORT
 #endif
 
+// If MATH_NO_THREADS is defined, MathGeoLib never starts threads of its own, e.g. KdTree::Build() builds
+// all subtrees on the calling thread. Defined by default on platforms that do not have std::thread.
+#ifndef MATH_NO_THREADS
+#if defined(__EMSCRIPTEN__) || defined(__native_client__) || defined(__FLASHPLAYER__) || (defined(_MSC_VER) && _MSC_VER < 1700)
+#define MATH_NO_THREADS
+#endif
+#endif
+
 // If MATH_TINYXML_INTEROP is defined, MathGeoLib integrates with TinyXML to provide
 // serialization and deserialization to XML for the data structures.
 #ifndef MATH_TINYXML_INTEROP
@@ -21,4 +21,5 @@
 #include "Geometry/GeometryAll.h"
 #include "Math/MathAll.h"
 #include "Algorithm/Random/LCG.h"
+#include "Algorithm/ThreadPool.h"
 #include "Time/Clock.h"
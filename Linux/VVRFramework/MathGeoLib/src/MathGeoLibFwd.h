@@ -98,6 +98,7 @@ class Torus;
 class ScaleOp;
 class Triangle;
 class LCG;
+class ThreadPool;
 
 struct float4_storage;
 
@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "../src/MathGeoLib.h"
+#include "../src/Math/myassert.h"
+#include "../src/Geometry/DynamicAABBTree.h"
+#include "../src/Geometry/SweepAndPrune.h"
+#include "../src/Algorithm/SAT.h"
+#include "TestRunner.h"
+#include "TestData.h"
+
+using namespace TestData;
+
+MATH_IGNORE_UNUSED_VARS_WARNING
+
+namespace
+{
+	/// A moving body of a 3D simulation, placed into the broad phase structures by pointer.
+	struct TestBody
+	{
+		OBB obb;
+		vec velocity;
+	};
+
+	AABB GetAABB(const TestBody *b)
+	{
+		return b->obb.MinimalEnclosingAABB();
+	}
+}
+
+typedef std::vector<std::pair<int, int> > PairArray;
+
+static std::vector<TestBody> RandomBodies(LCG &lcg, int numBodies, float worldSize)
+{
+	std::vector<TestBody> bodies(numBodies);
+	for(int i = 0; i < numBodies; ++i)
+	{
+		float3x3 rot = float3x3::RandomRotation(lcg);
+		vec pos = POINT_VEC(lcg.Float(-worldSize, worldSize), lcg.Float(-worldSize, worldSize), lcg.Float(-worldSize, worldSize));
+		vec r = DIR_VEC(lcg.Float(0.1f, 1.f), lcg.Float(0.1f, 1.f), lcg.Float(0.1f, 1.f));
+		bodies[i].obb = OBB(pos, r, DIR_VEC(rot.Col(0)), DIR_VEC(rot.Col(1)), DIR_VEC(rot.Col(2)));
+		bodies[i].velocity = DIR_VEC(lcg.Float(-1.f, 1.f), lcg.Float(-1.f, 1.f), lcg.Float(-1.f, 1.f));
+	}
+	return bodies;
+}
+
+/// Moves the bodies one step, bouncing them off the walls of the world.
+static void StepBodies(std::vector<TestBody> &bodies, float worldSize, float dt)
+{
+	for(size_t i = 0; i < bodies.size(); ++i)
+	{
+		TestBody &b = bodies[i];
+		b.obb.pos += b.velocity * dt;
+		for(int j = 0; j < 3; ++j)
+			if (Abs(b.obb.pos[j]) > worldSize)
+				b.velocity[j] = -b.velocity[j];
+	}
+}
+
+/// Returns the pairs of bodies whose AABBs overlap, as sorted pairs of indices to the bodies array.
+static PairArray BruteForcePairs(const std::vector<TestBody> &bodies)
+{
+	PairArray pairs;
+	for(size_t i = 0; i < bodies.size(); ++i)
+		for(size_t j = i + 1; j < bodies.size(); ++j)
+			if (GetAABB(&bodies[i]).Intersects(GetAABB(&bodies[j])))
+				pairs.push_back(std::make_pair((int)i, (int)j));
+	return pairs;
+}
+
+/// Converts the pairs of handles reported by the given broad phase to sorted pairs of indices to the bodies array.
+template<typename BroadPhase>
+static PairArray BodyIndexPairs(const BroadPhase &broadPhase, const std::vector<TestBody> &bodies, const PairArray &handlePairs)
+{
+	PairArray pairs;
+	for(size_t i = 0; i < handlePairs.size(); ++i)
+	{
+		int a = (int)(broadPhase.Object(handlePairs[i].first) - &bodies[0]);
+		int b = (int)(broadPhase.Object(handlePairs[i].second) - &bodies[0]);
+		pairs.push_back(std::make_pair(Min(a, b), Max(a, b)));
+	}
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
+
+/// Moves the bodies for a number of steps, and checks after each step that the broad phase reports the same pairs
+/// as testing all pairs of bodies, and that filtering the pairs with SATIntersect() finds all the intersecting bodies.
+/// OBB::Intersects() is not used, since it pads the OBBs by an epsilon, past their AABBs.
+template<typename BroadPhase>
+static void TestBroadPhaseMatchesBruteForce(BroadPhase &broadPhase, std::vector<TestBody> &bodies, float worldSize)
+{
+	std::vector<typename BroadPhase::ObjectHandle> handles(bodies.size());
+	for(size_t i = 0; i < bodies.size(); ++i)
+		handles[i] = broadPhase.Add(&bodies[i]);
+	assert(broadPhase.NumObjects() == (int)bodies.size());
+	broadPhase.DebugSanityCheck();
+
+	for(int step = 0; step < 10; ++step)
+	{
+		// Every few steps, move the bodies a lot, so that the order of the sweep changes completely.
+		StepBodies(bodies, worldSize, step % 4 == 3 ? 5.f : 0.2f);
+		for(size_t i = 0; i < handles.size(); ++i)
+			broadPhase.Update(handles[i]);
+		broadPhase.DebugSanityCheck();
+
+		PairArray handlePairs;
+		broadPhase.FindOverlappingPairs(handlePairs);
+		PairArray pairs = BodyIndexPairs(broadPhase, bodies, handlePairs);
+		PairArray expected = BruteForcePairs(bodies);
+		assert2(pairs == expected, (int)pairs.size(), (int)expected.size());
+
+		// The narrow phase on the candidate pairs finds all the pairs of bodies that intersect.
+		int numIntersecting = 0;
+		for(size_t i = 0; i < pairs.size(); ++i)
+			if (SATIntersect(bodies[pairs[i].first].obb, bodies[pairs[i].second].obb))
+				++numIntersecting;
+		int numIntersectingBruteForce = 0;
+		for(size_t i = 0; i < bodies.size(); ++i)
+			for(size_t j = i + 1; j < bodies.size(); ++j)
+				if (SATIntersect(bodies[i].obb, bodies[j].obb))
+					++numIntersectingBruteForce;
+		assert2(numIntersecting == numIntersectingBruteForce, numIntersecting, numIntersectingBruteForce);
+		MARK_UNUSED(numIntersecting);
+		MARK_UNUSED(numIntersectingBruteForce);
+	}
+
+	// Remove every other body, and add some back.
+	for(size_t i = 0; i < bodies.size(); i += 2)
+	{
+		broadPhase.Remove(handles[i]);
+		assert(!broadPhase.IsValid(handles[i]));
+	}
+	assert(broadPhase.NumObjects() == (int)bodies.size() / 2);
+	broadPhase.DebugSanityCheck();
+	for(size_t i = 0; i < bodies.size(); i += 4)
+	{
+		handles[i] = broadPhase.Add(&bodies[i]);
+		assert(broadPhase.Object(handles[i]) == &bodies[i]);
+	}
+	broadPhase.DebugSanityCheck();
+
+	std::vector<TestBody> remainingBodies;
+	for(size_t i = 0; i < bodies.size(); ++i)
+		if (i % 4 == 0 || i % 2 == 1)
+			remainingBodies.push_back(bodies[i]);
+	PairArray handlePairs;
+	broadPhase.FindOverlappingPairs(handlePairs);
+	assert2(handlePairs.size() == BruteForcePairs(remainingBodies).size(), (int)handlePairs.size(), (int)BruteForcePairs(remainingBodies).size());
+
+	for(size_t i = 0; i < bodies.size(); ++i)
+		if (i % 4 == 0 || i % 2 == 1)
+			broadPhase.Remove(handles[i]);
+	assert(broadPhase.NumObjects() == 0);
+	broadPhase.DebugSanityCheck();
+}
+
+RANDOMIZED_TEST(DynamicAABBTreePairsMatchBruteForce)
+{
+	const float worldSize = 10.f;
+	std::vector<TestBody> bodies = RandomBodies(rng, 300, worldSize);
+	DynamicAABBTree<TestBody *> tree(0.2f);
+	TestBroadPhaseMatchesBruteForce(tree, bodies, worldSize);
+	assert(tree.NumNodes() == 0);
+}
+
+RANDOMIZED_TEST(SweepAndPrunePairsMatchBruteForce)
+{
+	const float worldSize = 10.f;
+	std::vector<TestBody> bodies = RandomBodies(rng, 300, worldSize);
+	// Spread the bodies along the y axis, so that the sweep switches to it from the x axis.
+	for(size_t i = 0; i < bodies.size(); ++i)
+		bodies[i].obb.pos.y *= 5.f;
+	SweepAndPrune<TestBody *> sap;
+	TestBroadPhaseMatchesBruteForce(sap, bodies, worldSize);
+}
+
+namespace
+{
+	struct CountQueryHits
+	{
+		int numHits;
+		bool operator()(DynamicAABBTree<TestBody *> & /*tree*/, const AABB & /*queryAABB*/, DynamicAABBTree<TestBody *>::ObjectHandle /*object*/)
+		{
+			++numHits;
+			return false;
+		}
+	};
+}
+
+RANDOMIZED_TEST(DynamicAABBTreeAABBQueryMatchesBruteForce)
+{
+	const float worldSize = 10.f;
+	std::vector<TestBody> bodies = RandomBodies(rng, 500, worldSize);
+	DynamicAABBTree<TestBody *> tree;
+	for(size_t i = 0; i < bodies.size(); ++i)
+		tree.Add(&bodies[i]);
+	tree.DebugSanityCheck();
+	assert(tree.Height() <= 2 * (int)(Log2(bodies.size()) + 1)); // The tree is balanced.
+
+	for(int q = 0; q < 20; ++q)
+	{
+		vec c = POINT_VEC(rng.Float(-worldSize, worldSize), rng.Float(-worldSize, worldSize), rng.Float(-worldSize, worldSize));
+		vec halfSize = DIR_VEC(rng.Float(0.f, 5.f), rng.Float(0.f, 5.f), rng.Float(0.f, 5.f));
+		AABB aabb(c - halfSize, c + halfSize);
+		CountQueryHits hits = { 0 };
+		tree.AABBQuery(aabb, hits);
+		int numHits = 0;
+		for(size_t i = 0; i < bodies.size(); ++i)
+			if (aabb.Intersects(GetAABB(&bodies[i])))
+				++numHits;
+		assert2(hits.numHits == numHits, hits.numHits, numHits);
+		MARK_UNUSED(numHits);
+	}
+}
+
+UNIQUE_TEST(DynamicAABBTreeUpdateWithinMarginDoesNotReinsert)
+{
+	TestBody b;
+	b.obb = OBB(AABB(POINT_VEC(-1.f, -1.f, -1.f), POINT_VEC(1.f, 1.f, 1.f)));
+	DynamicAABBTree<TestBody *> tree(0.5f);
+	DynamicAABBTree<TestBody *>::ObjectHandle h = tree.Add(&b);
+	assert(tree.FatAABB(h).Equals(AABB(POINT_VEC(-1.5f, -1.5f, -1.5f), POINT_VEC(1.5f, 1.5f, 1.5f))));
+	b.obb.pos = POINT_VEC(0.4f, -0.4f, 0.2f);
+	assert(!tree.Update(h));
+	assert(tree.ObjectAABB(h).Equals(GetAABB(&b)));
+	b.obb.pos = POINT_VEC(0.6f, 0.f, 0.f);
+	assert(tree.Update(h));
+	assert(tree.FatAABB(h).Contains(GetAABB(&b)));
+	tree.DebugSanityCheck();
+}
+
+namespace
+{
+	/// Counts the pairs that a broad phase reports.
+	struct CountPairs
+	{
+		int numPairs;
+		template<typename BroadPhase>
+		bool operator()(BroadPhase & /*broadPhase*/, int /*a*/, int /*b*/)
+		{
+			++numPairs;
+			return false;
+		}
+	};
+}
+
+/// Returns the half size of a world in which the given number of bodies are as dense as the 1000 bodies of the
+/// smallest benchmark.
+static float BenchmarkWorldSize(int numBodies)
+{
+	return 10.f * Pow((float)numBodies / 1000.f, 1.f / 3.f);
+}
+
+static std::vector<TestBody> &BenchmarkBodies(int numBodies)
+{
+	static std::vector<TestBody> bodies[3];
+	std::vector<TestBody> &b = bodies[numBodies >= 100000 ? 2 : (numBodies >= 10000 ? 1 : 0)];
+	if (b.empty())
+	{
+		LCG lcg(1357);
+		b = RandomBodies(lcg, numBodies, BenchmarkWorldSize(numBodies));
+	}
+	return b;
+}
+
+/// Moves the benchmark bodies one step, updates them in the given broad phase, and counts the overlapping pairs.
+template<typename BroadPhase>
+static int BroadPhaseFrame(BroadPhase &broadPhase, std::vector<typename BroadPhase::ObjectHandle> &handles, int numBodies)
+{
+	std::vector<TestBody> &bodies = BenchmarkBodies(numBodies);
+	if (handles.empty())
+		for(size_t i = 0; i < bodies.size(); ++i)
+			handles.push_back(broadPhase.Add(&bodies[i]));
+	StepBodies(bodies, BenchmarkWorldSize(numBodies), 0.05f);
+	for(size_t i = 0; i < handles.size(); ++i)
+		broadPhase.Update(handles[i]);
+	CountPairs counter = { 0 };
+	broadPhase.FindOverlappingPairs(counter);
+	return counter.numPairs;
+}
+
+BENCHMARK_ITERS(BruteForcePairs1kMovingBodies, 10, 1, "Testing all pairs of AABBs of 1000 moving bodies per frame")
+{
+	std::vector<TestBody> &bodies = BenchmarkBodies(1000);
+	StepBodies(bodies, BenchmarkWorldSize(1000), 0.05f);
+	std::vector<AABB> aabbs(bodies.size());
+	for(size_t i = 0; i < bodies.size(); ++i)
+		aabbs[i] = GetAABB(&bodies[i]);
+	for(size_t i = 0; i < aabbs.size(); ++i)
+		for(size_t j = i + 1; j < aabbs.size(); ++j)
+			if (aabbs[i].Intersects(aabbs[j]))
+				++dummyResultInt;
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(SweepAndPrune1kMovingBodies, 10, 1, "SweepAndPrune Update() and FindOverlappingPairs() of 1000 moving bodies per frame")
+{
+	static SweepAndPrune<TestBody *> sap;
+	static std::vector<SweepAndPrune<TestBody *>::ObjectHandle> handles;
+	dummyResultInt += BroadPhaseFrame(sap, handles, 1000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(DynamicAABBTree1kMovingBodies, 10, 1, "DynamicAABBTree Update() and FindOverlappingPairs() of 1000 moving bodies per frame")
+{
+	static DynamicAABBTree<TestBody *> tree(0.1f);
+	static std::vector<DynamicAABBTree<TestBody *>::ObjectHandle> handles;
+	dummyResultInt += BroadPhaseFrame(tree, handles, 1000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(SweepAndPrune10kMovingBodies, 10, 1, "SweepAndPrune Update() and FindOverlappingPairs() of 10000 moving bodies per frame")
+{
+	static SweepAndPrune<TestBody *> sap;
+	static std::vector<SweepAndPrune<TestBody *>::ObjectHandle> handles;
+	dummyResultInt += BroadPhaseFrame(sap, handles, 10000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(DynamicAABBTree10kMovingBodies, 10, 1, "DynamicAABBTree Update() and FindOverlappingPairs() of 10000 moving bodies per frame")
+{
+	static DynamicAABBTree<TestBody *> tree(0.1f);
+	static std::vector<DynamicAABBTree<TestBody *>::ObjectHandle> handles;
+	dummyResultInt += BroadPhaseFrame(tree, handles, 10000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(SweepAndPrune100kMovingBodies, 3, 1, "SweepAndPrune Update() and FindOverlappingPairs() of 100000 moving bodies per frame")
+{
+	static SweepAndPrune<TestBody *> sap;
+	static std::vector<SweepAndPrune<TestBody *>::ObjectHandle> handles;
+	dummyResultInt += BroadPhaseFrame(sap, handles, 100000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(DynamicAABBTree100kMovingBodies, 3, 1, "DynamicAABBTree Update() and FindOverlappingPairs() of 100000 moving bodies per frame")
+{
+	static DynamicAABBTree<TestBody *> tree(0.1f);
+	static std::vector<DynamicAABBTree<TestBody *>::ObjectHandle> handles;
+	dummyResultInt += BroadPhaseFrame(tree, handles, 100000);
+}
+BENCHMARK_ITERS_END
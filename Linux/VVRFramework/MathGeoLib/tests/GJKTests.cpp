@@ -5,6 +5,7 @@
 #include "../src/Math/myassert.h"
 #include "TestRunner.h"
 #include "../src/Algorithm/GJK.h"
+#include "../src/Algorithm/SAT.h"
 #include "ObjectGenerators.h"
 
 MATH_IGNORE_UNUSED_VARS_WARNING
@@ -569,3 +570,205 @@ RANDOMIZED_TEST(GJKTriangleTriangleNoIntersect)
 	Triangle b = RandomTriangleInHalfspace(p);
 	assert(!GJKIntersect(a, b));
 }
+
+/// Returns true if the contact of the separated objects a and b has its closest points on a and b, the given distance apart,
+/// and the planes through the closest points perpendicular to the normal separate a and b.
+template<typename A, typename B>
+bool IsValidSeparatedContact(const A &a, const B &b, const GJKContact &c)
+{
+	float eps = 1e-2f * Max(1.f, c.distance);
+	return !c.intersects && c.distance > 0.f && c.normal.IsNormalized(1e-3f)
+		&& a.Distance(c.pointA) <= eps && b.Distance(c.pointB) <= eps
+		&& (c.pointA + c.normal * c.distance).Equals(c.pointB, eps)
+		&& Dot(a.ExtremePoint(c.normal) - c.pointA, c.normal) <= eps
+		&& Dot(b.ExtremePoint(-c.normal) - c.pointB, c.normal) >= -eps;
+}
+
+template<typename A, typename B>
+bool ExactIntersects(const A &a, const B &b) { return a.Intersects(b); }
+
+// OBB::Intersects(OBB) pads the boxes by an epsilon, which would report boxes that the penetration normal has just
+// separated as intersecting.
+bool ExactIntersects(const OBB &a, const OBB &b) { return SATIntersect(a, b); }
+
+/// Returns true if moving b along the normal of the contact by a little more than the penetration depth separates it
+/// from a, and by a little less does not.
+template<typename A, typename B>
+bool IsValidPenetration(const A &a, const B &b, const GJKContact &c)
+{
+	if (!c.intersects || c.distance > 0.f || !c.normal.IsNormalized(1e-3f))
+		return false;
+	float depth = -c.distance;
+	float eps = 1e-2f * Max(1.f, depth);
+	B separated = b;
+	separated.Translate(c.normal * (depth + eps));
+	B intersecting = b;
+	intersecting.Translate(c.normal * (depth - eps));
+	return !ExactIntersects(a, separated) && ExactIntersects(a, intersecting);
+}
+
+RANDOMIZED_TEST(GJKDistanceSphereSphere)
+{
+	Plane p(vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE)), vec::RandomDir(rng));
+	Sphere a = RandomSphereInHalfspace(p, 10.f);
+	p.ReverseNormal();
+	Sphere b = RandomSphereInHalfspace(p, 10.f);
+	GJKContact c = GJKComputeContact(a, b);
+	assert(IsValidSeparatedContact(a, b, c));
+	assert2(EqualAbs(c.distance, a.Distance(b), 1e-2f), c.distance, a.Distance(b));
+	vec pointA, pointB;
+	float d = GJKDistance(a, b, pointA, pointB);
+	assert(EqualAbs(d, c.distance, 1e-3f));
+}
+
+RANDOMIZED_TEST(GJKDistanceOBBSphere)
+{
+	Plane p(vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE)), vec::RandomDir(rng));
+	OBB a = RandomOBBInHalfspace(p, 10.f);
+	p.ReverseNormal();
+	Sphere b = RandomSphereInHalfspace(p, 10.f);
+	GJKContact c = GJKComputeContact(a, b);
+	assert(IsValidSeparatedContact(a, b, c));
+	assert2(EqualAbs(c.distance, b.Distance(a), 1e-2f), c.distance, b.Distance(a));
+}
+
+RANDOMIZED_TEST(GJKDistanceCapsuleCapsule)
+{
+	Plane p(vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE)), vec::RandomDir(rng));
+	Capsule a = RandomCapsuleInHalfspace(p);
+	p.ReverseNormal();
+	Capsule b = RandomCapsuleInHalfspace(p);
+	GJKContact c = GJKComputeContact(a, b);
+	assert(IsValidSeparatedContact(a, b, c));
+	assert2(EqualAbs(c.distance, a.Distance(b), 1e-2f * Max(1.f, c.distance)), c.distance, a.Distance(b));
+}
+
+RANDOMIZED_TEST(GJKDistanceOBBPolyhedron)
+{
+	Plane p(vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE)), vec::RandomDir(rng));
+	OBB a = RandomOBBInHalfspace(p, 10.f);
+	p.ReverseNormal();
+	OBB b = RandomOBBInHalfspace(p, 10.f);
+	Polyhedron poly = b.ToPolyhedron();
+	GJKContact c = GJKComputeContact(a, poly);
+	assert(IsValidSeparatedContact(a, poly, c));
+	GJKContact c2 = GJKComputeContact(a, b);
+	assert2(EqualAbs(c.distance, c2.distance, 1e-2f * Max(1.f, c.distance)), c.distance, c2.distance);
+}
+
+RANDOMIZED_TEST(GJKDistanceFrustumSphere)
+{
+	Plane p(vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE)), vec::RandomDir(rng));
+	Frustum a = RandomFrustumInHalfspace(p);
+	p.ReverseNormal();
+	Sphere b = RandomSphereInHalfspace(p, 10.f);
+	// Frustum::Distance() goes through Polyhedron::ClosestPoint(), which is not exact enough to compare against, so
+	// this relies on the separating planes that IsValidSeparatedContact() tests.
+	assert(IsValidSeparatedContact(a, b, GJKComputeContact(a, b)));
+}
+
+RANDOMIZED_TEST(EPAPenetrationSphereSphere)
+{
+	vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+	Sphere a(pt, rng.Float(1.f, 10.f));
+	float r = rng.Float(1.f, 10.f);
+	vec dir = vec::RandomDir(rng);
+	float dist = rng.Float(1.f, a.r + r - 1.f);
+	Sphere b(pt + dir * dist, r);
+	vec normal, pointA, pointB;
+	float depth;
+	bool intersects = EPAPenetration(a, b, normal, depth, pointA, pointB);
+	assert(intersects);
+	float expected = a.r + b.r - dist;
+	assert2(EqualAbs(depth, expected, 1e-2f * Max(1.f, expected)), depth, expected);
+	assert2(Dot(normal, dir) > 0.95f, normal, dir);
+	assert(a.Distance(pointA) <= 1e-2f && b.Distance(pointB) <= 1e-2f);
+	assert(IsValidPenetration(a, b, GJKComputeContact(a, b)));
+}
+
+RANDOMIZED_TEST(EPAPenetrationAlignedOBBs)
+{
+	vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+	OBB a = RandomOBBContainingPoint(pt, 10.f);
+	OBB b = a;
+	float offset = rng.Float(0.f, 1.9f * a.r.x);
+	b.Translate(a.axis[0] * offset);
+	GJKContact c = GJKComputeContact(a, b);
+	float expected = Min(2.f * a.r.x - offset, 2.f * a.r.y, 2.f * a.r.z);
+	assert(c.intersects);
+	assert2(EqualAbs(-c.distance, expected, 1e-2f * Max(1.f, expected)), -c.distance, expected);
+	assert(IsValidPenetration(a, b, c));
+}
+
+RANDOMIZED_TEST(EPAPenetrationOBBOBB)
+{
+	vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+	OBB a = RandomOBBContainingPoint(pt, 10.f);
+	OBB b = RandomOBBContainingPoint(pt, 10.f);
+	assert(IsValidPenetration(a, b, GJKComputeContact(a, b)));
+}
+
+RANDOMIZED_TEST(EPAPenetrationOBBCapsule)
+{
+	vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+	OBB a = RandomOBBContainingPoint(pt, 10.f);
+	Capsule b = RandomCapsuleContainingPoint(pt);
+	assert(IsValidPenetration(a, b, GJKComputeContact(a, b)));
+}
+
+RANDOMIZED_TEST(EPAPenetrationFrustumSphere)
+{
+	vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+	Frustum a = RandomFrustumContainingPoint(rng, pt);
+	Sphere b = RandomSphereContainingPoint(pt, 10.f);
+	assert(IsValidPenetration(a, b, GJKComputeContact(a, b)));
+}
+
+RANDOMIZED_TEST(EPAPenetrationPolyhedronSphere)
+{
+	vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+	Polyhedron a = RandomOBBContainingPoint(pt, 10.f).ToPolyhedron();
+	Sphere b = RandomSphereContainingPoint(pt, 10.f);
+	assert(IsValidPenetration(a, b, GJKComputeContact(a, b)));
+}
+
+RANDOMIZED_TEST(GJKWarmStartMatchesColdStart)
+{
+	vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+	OBB a = RandomOBBContainingPoint(pt, 10.f);
+	OBB b = RandomOBBContainingPoint(pt, 10.f);
+	vec velocity = vec::RandomDir(rng, 1.f);
+	GJKSimplex simplex;
+	// Move b through a and out the other side, so that the pair goes from intersecting to separated.
+	for(int frame = 0; frame < 30; ++frame)
+	{
+		GJKContact warm = GJKComputeContact(a, b, &simplex);
+		GJKContact cold = GJKComputeContact(a, b);
+		assert(warm.intersects == cold.intersects || Abs(cold.distance) < 1e-2f);
+		assert2(EqualAbs(warm.distance, cold.distance, 1e-2f * Max(1.f, Abs(cold.distance))), warm.distance, cold.distance);
+		b.Translate(velocity);
+	}
+}
+
+RANDOMIZED_TEST(GJKComputeContactsMatchesGJKComputeContact)
+{
+	const int numPairs = 16;
+	Sphere a[numPairs];
+	Capsule b[numPairs];
+	for(int i = 0; i < numPairs; ++i)
+	{
+		vec pt = vec::RandomBox(rng, POINT_VEC_SCALAR(-SCALE), POINT_VEC_SCALAR(SCALE));
+		a[i] = RandomSphereContainingPoint(pt, 10.f);
+		b[i] = RandomCapsuleContainingPoint(pt + vec::RandomDir(rng, rng.Float(1.f, 30.f)));
+	}
+	GJKContact contacts[numPairs];
+	GJKSimplex simplices[numPairs];
+	GJKComputeContacts(a, b, numPairs, contacts, simplices);
+	for(int i = 0; i < numPairs; ++i)
+	{
+		GJKContact c = GJKComputeContact(a[i], b[i]);
+		assert(contacts[i].intersects == c.intersects);
+		assert(EqualAbs(contacts[i].distance, c.distance, 1e-3f * Max(1.f, Abs(c.distance))));
+		assert(simplices[i].numPoints > 0);
+	}
+}
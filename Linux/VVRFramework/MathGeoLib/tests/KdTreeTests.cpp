@@ -0,0 +1,447 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/MathGeoLib.h"
+#include "../src/Math/myassert.h"
+#include "../src/Geometry/KDTree.h"
+#include "TestRunner.h"
+#include "TestData.h"
+
+MATH_IGNORE_UNUSED_VARS_WARNING
+
+MATH_BEGIN_NAMESPACE
+
+using namespace TestData;
+
+// Generates a closed, bumpy surface of a sphere, with the triangles packed much more densely on one side,
+// like the surfaces reconstructed from a 3D scan.
+static std::vector<Triangle> GenerateScanMesh(int numRings, int numSegments)
+{
+	LCG lcg(1234);
+	std::vector<vec> pts;
+	for(int r = 0; r <= numRings; ++r)
+		for(int s = 0; s < numSegments; ++s)
+		{
+			float v = (float)r / numRings;
+			float u = (float)s / numSegments;
+			float theta = pi * v * v; // Denser near the top pole.
+			float phi = 2.f * pi * u;
+			float radius = 50.f + lcg.Float(-0.5f, 0.5f) + 2.f * Sin(8.f * phi) * Sin(6.f * theta);
+			pts.push_back(POINT_VEC(radius * Sin(theta) * Cos(phi), radius * Cos(theta), radius * Sin(theta) * Sin(phi)));
+		}
+
+	std::vector<Triangle> tris;
+	for(int r = 0; r < numRings; ++r)
+		for(int s = 0; s < numSegments; ++s)
+		{
+			const vec &a = pts[r*numSegments + s];
+			const vec &b = pts[r*numSegments + (s+1) % numSegments];
+			const vec &c = pts[(r+1)*numSegments + s];
+			const vec &d = pts[(r+1)*numSegments + (s+1) % numSegments];
+			tris.push_back(Triangle(a, b, c));
+			tris.push_back(Triangle(b, d, c));
+		}
+	return tris;
+}
+
+static const std::vector<Triangle> &ScanMesh()
+{
+	static std::vector<Triangle> mesh = GenerateScanMesh(160, 160);
+	return mesh;
+}
+
+// Rays from around the mesh towards random points near its centre.
+static const std::vector<Ray> &ScanMeshRays()
+{
+	static std::vector<Ray> rays;
+	if (rays.empty())
+	{
+		LCG lcg(5678);
+		for(int i = 0; i < 1024; ++i)
+		{
+			vec pos = POINT_VEC_SCALAR(0.f) + vec::RandomDir(lcg, 100.f);
+			vec target = vec::RandomBox(lcg, -20.f, 20.f);
+			rays.push_back(Ray(pos, (target - pos).Normalized()));
+		}
+	}
+	return rays;
+}
+
+static void BuildScanMeshTree(KdTree<Triangle> &tree, const KdTreeBuildParams &params)
+{
+	const std::vector<Triangle> &mesh = ScanMesh();
+	tree.Clear();
+	tree.AddObjects(&mesh[0], (int)mesh.size());
+	tree.Build(params);
+}
+
+static u32 BruteForceNearestHit(const std::vector<Triangle> &tris, const Ray &ray, float &nearestT)
+{
+	u32 nearest = KdTree<Triangle>::BUCKET_SENTINEL;
+	nearestT = FLOAT_INF;
+	for(size_t i = 0; i < tris.size(); ++i)
+	{
+		float u, v;
+		float t = Triangle::IntersectLineTri(ray.pos, ray.dir, tris[i].a, tris[i].b, tris[i].c, u, v);
+		if (t >= 0.f && t < nearestT)
+		{
+			nearestT = t;
+			nearest = (u32)i;
+		}
+	}
+	return nearest;
+}
+
+static std::vector<Triangle> RandomTriangles(int numTriangles, float maxSize)
+{
+	std::vector<Triangle> tris;
+	for(int i = 0; i < numTriangles; ++i)
+	{
+		vec a = vec::RandomBox(rng, -SCALE, SCALE);
+		const vec size = DIR_VEC_SCALAR(maxSize);
+		tris.push_back(Triangle(a, vec::RandomBox(rng, a - size, a + size), vec::RandomBox(rng, a - size, a + size)));
+	}
+	return tris;
+}
+
+RANDOMIZED_TEST(KdTreeSAHRayQueryMatchesBruteForce)
+{
+	std::vector<Triangle> tris = RandomTriangles(300, 10.f);
+	KdTree<Triangle> tree;
+	tree.AddObjects(&tris[0], (int)tris.size());
+	tree.Build(KdTreeBuildParams(KdTreeSplitSAH));
+
+	for(int i = 0; i < 20; ++i)
+	{
+		Ray ray(vec::RandomBox(rng, -SCALE, SCALE), vec::RandomDir(rng));
+		TriangleKdTreeRayQueryNearestHitVisitor result;
+		tree.RayQuery(ray, result);
+		float t;
+		u32 expected = BruteForceNearestHit(tris, ray, t);
+		if (expected == KdTree<Triangle>::BUCKET_SENTINEL)
+			assert(result.triangleIndex == KdTree<Triangle>::BUCKET_SENTINEL);
+		else
+		{
+			assert(result.triangleIndex != KdTree<Triangle>::BUCKET_SENTINEL);
+			assert(EqualAbs(result.rayT, t, 1e-3f * Max(1.f, t)));
+		}
+	}
+}
+
+UNIQUE_TEST(KdTreeParallelBuildMatchesSerial)
+{
+	KdTreeBuildParams params(KdTreeSplitSAH);
+	params.numThreads = 1;
+	KdTree<Triangle> serial;
+	BuildScanMeshTree(serial, params);
+
+	params.numThreads = 4;
+	params.minParallelObjects = 256;
+	KdTree<Triangle> parallel;
+	BuildScanMeshTree(parallel, params);
+
+	assert(serial.NumNodes() == parallel.NumNodes());
+	assert(serial.NumLeaves() == parallel.NumLeaves());
+	assert(serial.TreeHeight() == parallel.TreeHeight());
+
+	const std::vector<Ray> &rays = ScanMeshRays();
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		TriangleKdTreeRayQueryNearestHitVisitor a, b;
+		serial.RayQuery(rays[i], a);
+		parallel.RayQuery(rays[i], b);
+		assert(a.triangleIndex == b.triangleIndex);
+		assert(a.triangleIndex != KdTree<Triangle>::BUCKET_SENTINEL);
+	}
+}
+
+struct CountObjectsAABBQueryVisitor
+{
+	int numObjects;
+	CountObjectsAABBQueryVisitor():numObjects(0) {}
+	bool operator()(KdTree<Triangle> &tree, const KdTreeNode &leaf, const AABB & /*aabb*/)
+	{
+		for(const u32 *bucket = tree.Bucket(leaf.bucketIndex); *bucket != KdTree<Triangle>::BUCKET_SENTINEL; ++bucket)
+			++numObjects;
+		return false;
+	}
+};
+
+UNIQUE_TEST(KdTreeAABBQuerySingleLeaf)
+{
+	Triangle tri(POINT_VEC(0,0,0), POINT_VEC(1,0,0), POINT_VEC(0,1,0));
+	KdTree<Triangle> tree;
+	tree.AddObjects(&tri, 1);
+	tree.Build(KdTreeBuildParams(KdTreeSplitSAH));
+	assert(tree.Root()->IsLeaf());
+
+	CountObjectsAABBQueryVisitor visitor;
+	tree.AABBQuery(AABB(POINT_VEC_SCALAR(-1.f), POINT_VEC_SCALAR(2.f)), visitor);
+	assert(visitor.numObjects == 1);
+}
+
+RANDOMIZED_TEST(KdTreeKNearestObjectsMatchesBruteForce)
+{
+	std::vector<Triangle> tris = RandomTriangles(300, 10.f);
+	KdTree<Triangle> tree;
+	tree.AddObjects(&tris[0], (int)tris.size());
+	tree.Build(KdTreeBuildParams(rng.Int(0, 1) == 0 ? KdTreeSplitMidpoint : KdTreeSplitSAH));
+
+	vec pt = vec::RandomBox(rng, -SCALE, SCALE);
+	std::vector<float> distances;
+	for(size_t i = 0; i < tris.size(); ++i)
+		distances.push_back(tris[i].Distance(pt));
+	std::sort(distances.begin(), distances.end());
+
+	const int k = 8;
+	u32 indices[k];
+	float dists[k];
+	int numFound = tree.KNearestObjects(pt, k, indices, dists);
+	assert(numFound == k);
+	for(int i = 0; i < numFound; ++i)
+	{
+		assert(EqualAbs(dists[i], distances[i], 1e-3f));
+		assert(EqualAbs(tris[indices[i]].Distance(pt), dists[i], 1e-3f));
+		for(int j = 0; j < i; ++j)
+			assert(indices[i] != indices[j]);
+	}
+
+	// With a maximum distance, only the objects within it are found.
+	numFound = tree.KNearestObjects(pt, k, indices, dists, distances[2]);
+	assert(numFound >= 3);
+	assert(numFound <= k);
+	for(int i = 0; i < numFound; ++i)
+		assert(dists[i] <= distances[2]);
+}
+
+RANDOMIZED_TEST(KdTreeObjectsWithinDistanceMatchesBruteForce)
+{
+	std::vector<Triangle> tris = RandomTriangles(300, 10.f);
+	KdTree<Triangle> tree;
+	tree.AddObjects(&tris[0], (int)tris.size());
+	tree.Build(KdTreeBuildParams(KdTreeSplitSAH));
+
+	vec pt = vec::RandomBox(rng, -SCALE, SCALE);
+	float maxDistance = rng.Float(0.f, SCALE);
+	std::vector<u32> expected;
+	for(size_t i = 0; i < tris.size(); ++i)
+		if (tris[i].Distance(pt) <= maxDistance)
+			expected.push_back((u32)i);
+
+	std::vector<u32> found;
+	tree.ObjectsWithinDistance(pt, maxDistance, found);
+	assert(found == expected);
+}
+
+struct TriangleKdTreeIntersectingPairsVisitor
+{
+	float3x4 tree2Transform;
+	std::vector<std::pair<u32, u32> > pairs;
+
+	bool operator()(KdTree<Triangle> &tree, KdTreeNode &leaf, const AABB & /*leafAABB*/,
+		KdTree<Triangle> &tree2, KdTreeNode &tree2Leaf, const OBB & /*tree2LeafOBB*/)
+	{
+		for(const u32 *a = tree.Bucket(leaf.bucketIndex); *a != KdTree<Triangle>::BUCKET_SENTINEL; ++a)
+			for(const u32 *b = tree2.Bucket(tree2Leaf.bucketIndex); *b != KdTree<Triangle>::BUCKET_SENTINEL; ++b)
+			{
+				Triangle t2 = tree2.Object(*b);
+				t2.Transform(tree2Transform);
+				if (tree.Object(*a).Intersects(t2))
+					pairs.push_back(std::make_pair(*a, *b));
+			}
+		return false;
+	}
+};
+
+RANDOMIZED_TEST(KdTreeQueryMatchesBruteForce)
+{
+	std::vector<Triangle> tris = RandomTriangles(200, 20.f);
+	std::vector<Triangle> tris2 = RandomTriangles(200, 20.f);
+	KdTree<Triangle> tree, tree2;
+	tree.AddObjects(&tris[0], (int)tris.size());
+	tree.Build(KdTreeBuildParams(KdTreeSplitSAH));
+	tree2.AddObjects(&tris2[0], (int)tris2.size());
+	tree2.Build(KdTreeBuildParams(KdTreeSplitMidpoint));
+
+	float3x4 world = float3x4::FromTRS(float3::RandomBox(rng, -10.f, 10.f), float3x4::RandomRotation(rng), float3(1.f, 1.f, 1.f));
+	float3x4 world2 = float3x4::FromTRS(float3::RandomBox(rng, -10.f, 10.f), float3x4::RandomRotation(rng), float3(1.f, 1.f, 1.f));
+
+	TriangleKdTreeIntersectingPairsVisitor visitor;
+	visitor.tree2Transform = world.Inverted() * world2;
+	tree.KdTreeQuery(tree2, world, world2, visitor);
+	std::sort(visitor.pairs.begin(), visitor.pairs.end());
+	visitor.pairs.erase(std::unique(visitor.pairs.begin(), visitor.pairs.end()), visitor.pairs.end());
+
+	std::vector<std::pair<u32, u32> > expected;
+	for(size_t i = 0; i < tris.size(); ++i)
+		for(size_t j = 0; j < tris2.size(); ++j)
+		{
+			Triangle t2 = tris2[j];
+			t2.Transform(visitor.tree2Transform);
+			if (tris[i].Intersects(t2))
+				expected.push_back(std::make_pair((u32)i, (u32)j));
+		}
+	assert(!expected.empty());
+	assert(visitor.pairs == expected);
+}
+
+BENCHMARK_ITERS(KdTreeBuildMidpoint, 5, 1, "KdTree<Triangle>::Build() midpoint, 51k triangles")
+{
+	KdTree<Triangle> tree;
+	BuildScanMeshTree(tree, KdTreeBuildParams(KdTreeSplitMidpoint));
+	dummyResultInt += tree.NumNodes();
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(KdTreeBuildSAH, 5, 1, "KdTree<Triangle>::Build() SAH, 51k triangles, one thread")
+{
+	KdTreeBuildParams params(KdTreeSplitSAH);
+	params.numThreads = 1;
+	KdTree<Triangle> tree;
+	BuildScanMeshTree(tree, params);
+	dummyResultInt += tree.NumNodes();
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(KdTreeBuildSAHParallel, 5, 1, "KdTree<Triangle>::Build() SAH, 51k triangles, all hardware threads")
+{
+	KdTree<Triangle> tree;
+	BuildScanMeshTree(tree, KdTreeBuildParams(KdTreeSplitSAH));
+	dummyResultInt += tree.NumNodes();
+}
+BENCHMARK_ITERS_END
+
+static KdTree<Triangle> *ScanMeshTree(KdTreeSplitMethod splitMethod)
+{
+	static KdTree<Triangle> trees[2];
+	if (trees[splitMethod].NumNodes() <= 0)
+		BuildScanMeshTree(trees[splitMethod], KdTreeBuildParams(splitMethod));
+	return &trees[splitMethod];
+}
+
+BENCHMARK(KdTreeRayQueryMidpoint, "KdTree<Triangle>::RayQuery nearest hit, midpoint tree")
+{
+	const std::vector<Ray> &rays = ScanMeshRays();
+	TriangleKdTreeRayQueryNearestHitVisitor result;
+	ScanMeshTree(KdTreeSplitMidpoint)->RayQuery(rays[i % rays.size()], result);
+	dummyResultInt += result.triangleIndex;
+}
+BENCHMARK_END
+
+BENCHMARK(KdTreeRayQuerySAH, "KdTree<Triangle>::RayQuery nearest hit, SAH tree")
+{
+	const std::vector<Ray> &rays = ScanMeshRays();
+	TriangleKdTreeRayQueryNearestHitVisitor result;
+	ScanMeshTree(KdTreeSplitSAH)->RayQuery(rays[i % rays.size()], result);
+	dummyResultInt += result.triangleIndex;
+}
+BENCHMARK_END
+
+// The primary rays of a 32x32 pixel image of the mesh, in scanline order so that neighbouring rays are coherent.
+static const std::vector<Ray> &ScanMeshCameraRays()
+{
+	static std::vector<Ray> rays;
+	if (rays.empty())
+	{
+		const vec eye = POINT_VEC(0.f, 30.f, -120.f);
+		for(int y = 0; y < 32; ++y)
+			for(int x = 0; x < 32; ++x)
+			{
+				vec target = POINT_VEC(-60.f + 120.f * x / 31.f, 90.f - 120.f * y / 31.f, 0.f);
+				rays.push_back(Ray(eye, (target - eye).Normalized()));
+			}
+	}
+	return rays;
+}
+
+static bool HitsMatch(const RayTriangleHit &hit, float expectedT)
+{
+	if (expectedT == FLOAT_INF)
+		return hit.t == FLOAT_INF && hit.triangleIndex == -1;
+	return hit.triangleIndex >= 0 && EqualAbs(hit.t, expectedT, 1e-3f * Max(1.f, expectedT));
+}
+
+UNIQUE_TEST(KdTreeIntersectRaysMatchesRayQuery)
+{
+	for(int method = KdTreeSplitMidpoint; method <= KdTreeSplitSAH; ++method)
+	{
+		KdTree<Triangle> &tree = *ScanMeshTree((KdTreeSplitMethod)method);
+		const std::vector<Ray> *rayArrays[2] = { &ScanMeshRays(), &ScanMeshCameraRays() };
+		for(int r = 0; r < 2; ++r)
+		{
+			const std::vector<Ray> &rays = *rayArrays[r];
+			std::vector<RayTriangleHit> hits(rays.size());
+			tree.IntersectRays(&rays[0], (int)rays.size(), &hits[0]);
+			for(size_t i = 0; i < rays.size(); ++i)
+			{
+				TriangleKdTreeRayQueryNearestHitVisitor result;
+				tree.RayQuery(rays[i], result);
+				bool matches = HitsMatch(hits[i], result.rayT);
+				assert(matches);
+			}
+		}
+	}
+}
+
+// Rays in all directions, some parallel to the axes, and a number of rays that is not a multiple of the packet size.
+RANDOMIZED_TEST(KdTreeIntersectRaysMatchesBruteForce)
+{
+	std::vector<Triangle> tris = RandomTriangles(200, SCALE * 0.1f);
+	KdTree<Triangle> tree;
+	tree.AddObjects(&tris[0], (int)tris.size());
+	tree.Build(KdTreeBuildParams(KdTreeSplitSAH));
+
+	std::vector<Ray> rays;
+	for(int i = 0; i < 37; ++i)
+	{
+		vec dir = vec::RandomDir(rng);
+		if (i % 3 == 0)
+		{
+			dir = DIR_VEC(0.f, 0.f, 0.f);
+			dir[rng.Int(0, 2)] = (rng.Int(0, 1) == 0) ? 1.f : -1.f;
+		}
+		rays.push_back(Ray(vec::RandomBox(rng, -SCALE, SCALE), dir));
+	}
+	std::vector<RayTriangleHit> hits(rays.size());
+	tree.IntersectRays(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		float nearestT;
+		BruteForceNearestHit(tris, rays[i], nearestT);
+		bool matches = HitsMatch(hits[i], nearestT);
+		assert(matches);
+	}
+}
+
+BENCHMARK(KdTreeRayQueryCameraRays, "KdTree<Triangle>::RayQuery nearest hit of 8 coherent rays, SAH tree")
+{
+	const std::vector<Ray> &rays = ScanMeshCameraRays();
+	const int first = (i * 8) % (int)rays.size();
+	for(int j = first; j < first + 8; ++j)
+	{
+		TriangleKdTreeRayQueryNearestHitVisitor result;
+		ScanMeshTree(KdTreeSplitSAH)->RayQuery(rays[j], result);
+		dummyResultInt += result.triangleIndex;
+	}
+}
+BENCHMARK_END
+
+BENCHMARK(KdTreeIntersectRaysCameraRays, "KdTree<Triangle>::IntersectRays nearest hit of 8 coherent rays, SAH tree")
+{
+	const std::vector<Ray> &rays = ScanMeshCameraRays();
+	const int first = (i * 8) % (int)rays.size();
+	RayTriangleHit hits[8];
+	ScanMeshTree(KdTreeSplitSAH)->IntersectRays(&rays[first], 8, hits);
+	dummyResultInt += hits[0].triangleIndex + hits[7].triangleIndex;
+}
+BENCHMARK_END
+
+BENCHMARK(KdTreeKNearestObjects, "KdTree<Triangle>::KNearestObjects k=8, SAH tree")
+{
+	const std::vector<Ray> &rays = ScanMeshRays();
+	u32 indices[8];
+	dummyResultInt += ScanMeshTree(KdTreeSplitSAH)->KNearestObjects(rays[i % rays.size()].GetPoint(50.f), 8, indices);
+}
+BENCHMARK_END
+
+MATH_END_NAMESPACE
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/MathGeoLib.h"
+#include "../src/Math/myassert.h"
+#include "TestRunner.h"
+#include "TestData.h"
+
+using namespace TestData;
+
+MATH_IGNORE_UNUSED_VARS_WARNING
+
+namespace
+{
+	/// A particle of a 2D simulation, placed into the trees by pointer.
+	struct TestParticle
+	{
+		float2 pos;
+		float2 velocity;
+		float radius;
+	};
+
+	AABB2D GetAABB2D(const TestParticle *p)
+	{
+		return AABB2D(p->pos - float2(p->radius), p->pos + float2(p->radius));
+	}
+
+	// QuadTree<T> needs these to be defined for its objects.
+	float MinX(const TestParticle *p) { return p->pos.x - p->radius; }
+	float MaxX(const TestParticle *p) { return p->pos.x + p->radius; }
+	float MinY(const TestParticle *p) { return p->pos.y - p->radius; }
+	float MaxY(const TestParticle *p) { return p->pos.y + p->radius; }
+	void AssociateQuadTreeNode(TestParticle *, QuadTree<TestParticle *>::Node *) {}
+
+	std::vector<TestParticle> RandomParticles(LCG &lcg, int numParticles, float worldSize)
+	{
+		std::vector<TestParticle> particles(numParticles);
+		for(int i = 0; i < numParticles; ++i)
+		{
+			particles[i].pos = float2(lcg.Float(-worldSize, worldSize), lcg.Float(-worldSize, worldSize));
+			particles[i].velocity = float2(lcg.Float(-1.f, 1.f), lcg.Float(-1.f, 1.f));
+			particles[i].radius = lcg.Float(0.f, 0.5f) * lcg.Float(0.f, 1.f); // Mostly small particles, some larger ones.
+		}
+		return particles;
+	}
+
+	/// Moves the particles one step, bouncing them off the walls of the world.
+	void StepParticles(std::vector<TestParticle> &particles, float worldSize, float dt)
+	{
+		for(size_t i = 0; i < particles.size(); ++i)
+		{
+			TestParticle &p = particles[i];
+			p.pos += p.velocity * dt;
+			if (Abs(p.pos.x) > worldSize)
+				p.velocity.x = -p.velocity.x;
+			if (Abs(p.pos.y) > worldSize)
+				p.velocity.y = -p.velocity.y;
+		}
+	}
+
+	struct CountQueryHits
+	{
+		int numHits;
+		bool operator()(LooseQuadTree<TestParticle *> & /*tree*/, const AABB2D & /*queryAABB*/, LooseQuadTree<TestParticle *>::ObjectHandle /*object*/)
+		{
+			++numHits;
+			return false;
+		}
+	};
+
+	int BruteForceQueryHits(const std::vector<TestParticle> &particles, const AABB2D &aabb)
+	{
+		int numHits = 0;
+		for(size_t i = 0; i < particles.size(); ++i)
+			if (aabb.Intersects(GetAABB2D(&particles[i])))
+				++numHits;
+		return numHits;
+	}
+}
+
+RANDOMIZED_TEST(LooseQuadTreeUpdateMatchesBruteForce)
+{
+	const float worldSize = 20.f;
+	std::vector<TestParticle> particles = RandomParticles(rng, 500, worldSize);
+	LooseQuadTree<TestParticle *> tree;
+	tree.Clear(float2(-1.f, -1.f), float2(1.f, 1.f)); // Much smaller than the world, so that the root has to grow.
+	std::vector<LooseQuadTree<TestParticle *>::ObjectHandle> handles(particles.size());
+	for(size_t i = 0; i < particles.size(); ++i)
+		handles[i] = tree.Add(&particles[i]);
+	assert(tree.NumObjects() == (int)particles.size());
+	assert(tree.BoundingAABB().Contains(float2(worldSize, worldSize)) || tree.BoundingAABB().Contains(float2(-worldSize, -worldSize)));
+	tree.DebugSanityCheck();
+
+	for(int step = 0; step < 20; ++step)
+	{
+		// Move some particles a lot, out of the current root too.
+		StepParticles(particles, worldSize, step % 5 == 4 ? 10.f : 0.1f);
+		for(size_t i = 0; i < particles.size(); ++i)
+			tree.Update(handles[i]);
+		tree.DebugSanityCheck();
+
+		for(int q = 0; q < 10; ++q)
+		{
+			float2 c(rng.Float(-worldSize, worldSize), rng.Float(-worldSize, worldSize));
+			AABB2D aabb(c - float2(rng.Float(0.f, 5.f)), c + float2(rng.Float(0.f, 5.f)));
+			CountQueryHits hits = { 0 };
+			tree.AABBQuery(aabb, hits);
+			int numHits = BruteForceQueryHits(particles, aabb);
+			assert(hits.numHits == numHits);
+			MARK_UNUSED(numHits);
+		}
+	}
+
+	// Remove every other particle, and add some back.
+	for(size_t i = 0; i < particles.size(); i += 2)
+	{
+		tree.Remove(handles[i]);
+		assert(!tree.IsValid(handles[i]));
+	}
+	assert(tree.NumObjects() == (int)particles.size() / 2);
+	tree.DebugSanityCheck();
+	for(size_t i = 0; i < particles.size(); i += 4)
+	{
+		handles[i] = tree.Add(&particles[i]);
+		assert(tree.Object(handles[i]) == &particles[i]);
+	}
+	tree.DebugSanityCheck();
+
+	for(size_t i = 0; i < particles.size(); ++i)
+		if (i % 4 == 0 || i % 2 == 1)
+			tree.Remove(handles[i]);
+	assert(tree.NumObjects() == 0);
+	assert(tree.NumNodes() == 1); // All the nodes but the root are pruned when empty.
+	tree.DebugSanityCheck();
+}
+
+UNIQUE_TEST(LooseQuadTreeObjectsStayInTheirNodeWhenMovingLittle)
+{
+	TestParticle p;
+	p.pos = float2(0.3f, 0.3f);
+	p.radius = 0.01f;
+	LooseQuadTree<TestParticle *> tree;
+	tree.Clear(float2(-10.f, -10.f), float2(10.f, 10.f), 1.f);
+	LooseQuadTree<TestParticle *>::ObjectHandle h = tree.Add(&p);
+	const LooseQuadTree<TestParticle *>::Node *node = &tree.ObjectNode(h);
+	assert(EqualAbs(node->radius, 0.625f)); // The smallest node at least 1.f wide.
+	p.pos = float2(0.4f, 0.35f);
+	tree.Update(h);
+	assert(&tree.ObjectNode(h) == node);
+	assert(tree.ObjectAABB(h).Contains(p.pos));
+	p.pos = float2(-0.4f, 0.35f);
+	tree.Update(h);
+	assert(&tree.ObjectNode(h) != node);
+	tree.DebugSanityCheck();
+}
+
+static const float benchmarkWorldSize = 100.f;
+
+static std::vector<TestParticle> &BenchmarkParticles()
+{
+	static std::vector<TestParticle> particles;
+	if (particles.empty())
+	{
+		LCG lcg(2468);
+		particles = RandomParticles(lcg, 10000, benchmarkWorldSize);
+	}
+	return particles;
+}
+
+BENCHMARK_ITERS(LooseQuadTreeUpdateMovingObjects, 20, 10, "LooseQuadTree::Update() of 10000 moving particles per frame")
+{
+	static LooseQuadTree<TestParticle *> tree;
+	static std::vector<LooseQuadTree<TestParticle *>::ObjectHandle> handles;
+	std::vector<TestParticle> &particles = BenchmarkParticles();
+	if (handles.empty())
+	{
+		tree.Clear(float2(-benchmarkWorldSize), float2(benchmarkWorldSize), 0.5f);
+		for(size_t i = 0; i < particles.size(); ++i)
+			handles.push_back(tree.Add(&particles[i]));
+	}
+	StepParticles(particles, benchmarkWorldSize, 0.05f);
+	for(size_t i = 0; i < handles.size(); ++i)
+		tree.Update(handles[i]);
+	dummyResultInt += tree.NumNodes();
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(QuadTreeRebuildMovingObjects, 20, 10, "QuadTree::Clear() and Add() of 10000 moving particles per frame")
+{
+	static QuadTree<TestParticle *> tree;
+	std::vector<TestParticle> &particles = BenchmarkParticles();
+	StepParticles(particles, benchmarkWorldSize, 0.05f);
+	tree.Clear(float2(-benchmarkWorldSize - 1.f), float2(benchmarkWorldSize + 1.f));
+	for(size_t i = 0; i < particles.size(); ++i)
+		tree.Add(&particles[i]);
+	dummyResultInt += tree.NumNodes();
+}
+BENCHMARK_ITERS_END
@@ -52,6 +52,28 @@ BENCHMARK(OBBIntersectsOBB_SAT, "OBB::Intersects(OBB)_SAT")
 }
 BENCHMARK_END
 
+BENCHMARK(OBBDistanceOBB_GJK, "GJKDistance(OBB, OBB)")
+{
+	vec pointA, pointB;
+	uf[i] = GJKDistance(obb[i], obb[i+1], pointA, pointB);
+}
+BENCHMARK_END
+
+BENCHMARK(OBBContactOBB_GJK_EPA, "GJKComputeContact(OBB, OBB)")
+{
+	uf[i] = GJKComputeContact(obb[i], obb[i+1]).distance;
+}
+BENCHMARK_END
+
+BENCHMARK(OBBContactOBB_GJK_EPA_WarmStart, "GJKComputeContact(OBB, OBB) warm-started")
+{
+	// Each round of the benchmark starts from the simplices of the previous round, like a simulation does from the
+	// previous frame.
+	static GJKSimplex simplices[testrunner_numItersPerTest];
+	uf[i] = GJKComputeContact(obb[i], obb[i+1], &simplices[i]).distance;
+}
+BENCHMARK_END
+
 BENCHMARK(OBBContains, "OBB::Contains(point)")
 {
 	uf[i] = obb[i].Contains(ve[i]) ? 1.f : 0.f;
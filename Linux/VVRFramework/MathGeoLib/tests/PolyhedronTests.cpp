@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #include "../src/MathGeoLib.h"
 #include "../src/Math/myassert.h"
 #include "TestRunner.h"
+#include "TestData.h"
+
+using namespace TestData;
 
 Polyhedron RandomPolyhedronContainingPoint(const vec &pt);
 
@@ -169,3 +173,249 @@ UNIQUE_TEST(Polyhedron_ConvexHull_case3)
 	for(int i = 0; i < n; ++i)
 		assert1(convexHull.ContainsConvex(points[i]), convexHull.Distance(points[i]));
 }
+
+/// Tests that the given polyhedron is closed and convex, and contains each of the given points.
+static void AssertIsConvexHullOf(const Polyhedron &hull, const vec *points, int numPoints)
+{
+	assert(hull.FaceIndicesValid());
+	assert(hull.IsClosed());
+	assert(hull.EulerFormulaHolds());
+	assert(hull.IsConvex());
+	for(int i = 0; i < numPoints; ++i)
+		assert1(hull.ContainsConvex(points[i]), hull.Distance(points[i]));
+}
+
+RANDOMIZED_TEST(Polyhedron_QuickHull)
+{
+	// Points in a box, in a ball, and on a sphere, where all points are on the hull.
+	const int n = rng.Int(4, 1000);
+	const int distribution = rng.Int(0, 2);
+	VecArray points(n);
+	for(int i = 0; i < n; ++i)
+		points[i] = distribution == 0 ? vec::RandomBox(rng, -50.f, 50.f)
+			: (distribution == 1 ? Sphere::RandomPointInside(rng, POINT_VEC_SCALAR(0.f), 50.f)
+			: Sphere::RandomPointOnSurface(rng, POINT_VEC_SCALAR(0.f), 50.f));
+	if (n > 4 && rng.Int(0, 1) == 0)
+		points[rng.Int(1, n-1)] = points[0];
+
+	// A convex polyhedron that contains all the points, and whose vertices are some of the points, is their convex hull.
+	Polyhedron hull = Polyhedron::QuickHull(points);
+	AssertIsConvexHullOf(hull, &points[0], n);
+}
+
+UNIQUE_TEST(Polyhedron_QuickHull_Lattice)
+{
+	// Most of the points are on the faces and edges of the hull, and many are coplanar with the initial tetrahedron.
+	VecArray points;
+	for(int x = 0; x < 10; ++x)
+		for(int y = 0; y < 10; ++y)
+			for(int z = 0; z < 10; ++z)
+				points.push_back(POINT_VEC((float)x, (float)y, (float)z));
+
+	Polyhedron hull = Polyhedron::QuickHull(points);
+	AssertIsConvexHullOf(hull, &points[0], (int)points.size());
+	assert1(hull.NumVertices() == 8, hull.NumVertices());
+	assert1(EqualAbs(hull.Volume(), 9.f*9.f*9.f, 1e-3f), hull.Volume());
+}
+
+static bool LessXY(const float2 &a, const float2 &b)
+{
+	return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+/// Returns the signed double area of the triangle abc, positive if it winds counter-clockwise.
+static double Cross2D(const float2 &a, const float2 &b, const float2 &c)
+{
+	return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+}
+
+/// Returns the vertices of the convex hull of the given points in counter-clockwise order, computed with
+/// Andrew's monotone chain algorithm.
+static std::vector<float2> MonotoneChainHull(std::vector<float2> points)
+{
+	std::sort(points.begin(), points.end(), LessXY);
+	std::vector<float2> hull(2 * points.size());
+	int k = 0;
+	for(size_t i = 0; i < points.size(); ++i) // The lower hull.
+	{
+		while(k >= 2 && Cross2D(hull[k-2], hull[k-1], points[i]) <= 0.0)
+			--k;
+		hull[k++] = points[i];
+	}
+	const int lowerSize = k + 1;
+	for(int i = (int)points.size() - 2; i >= 0; --i) // The upper hull.
+	{
+		while(k >= lowerSize && Cross2D(hull[k-2], hull[k-1], points[i]) <= 0.0)
+			--k;
+		hull[k++] = points[i];
+	}
+	hull.resize(k - 1); // The last point is the first one.
+	return hull;
+}
+
+UNIQUE_TEST(Polyhedron_QuickHull_Planar)
+{
+	// Planar point sets are handled by the incremental algorithm. Check the result against a 2D hull.
+	VecArray points;
+	std::vector<float2> points2D;
+	LCG lcg(1234);
+	for(int i = 0; i < 100; ++i)
+	{
+		points2D.push_back(float2(lcg.Float(-10.f, 10.f), lcg.Float(-10.f, 10.f)));
+		points.push_back(POINT_VEC(points2D.back().x, points2D.back().y, 5.f));
+	}
+
+	Polyhedron hull = Polyhedron::QuickHull(points);
+	std::vector<float2> hull2D = MonotoneChainHull(points2D);
+	assert2(hull.NumVertices() == (int)hull2D.size(), hull.NumVertices(), (int)hull2D.size());
+	for(size_t i = 0; i < hull2D.size(); ++i)
+	{
+		bool found = false;
+		for(int j = 0; j < hull.NumVertices(); ++j)
+			if (hull.Vertex(j).x == hull2D[i].x && hull.Vertex(j).y == hull2D[i].y && hull.Vertex(j).z == 5.f)
+				found = true;
+		assert(found);
+		MARK_UNUSED(found);
+	}
+
+	double area2D = 0.0;
+	for(size_t i = 0; i < hull2D.size(); ++i)
+		area2D += Cross2D(float2(0.f, 0.f), hull2D[i], hull2D[(i + 1) % hull2D.size()]);
+	area2D *= 0.5;
+	for(int i = 0; i < hull.NumFaces(); ++i)
+		assert2(EqualRel(hull.FacePolygon(i).Area(), (float)area2D, 1e-4f), hull.FacePolygon(i).Area(), (float)area2D);
+
+	// The points on the edges of a planar hull are not vertices of it.
+	VecArray lattice;
+	for(int x = 0; x < 10; ++x)
+		for(int y = 0; y < 10; ++y)
+			lattice.push_back(POINT_VEC((float)x, 5.f, (float)y));
+	Polyhedron latticeHull = Polyhedron::QuickHull(lattice);
+	assert1(latticeHull.NumVertices() == 4, latticeHull.NumVertices());
+	assert1(latticeHull.NumFaces() == 2, latticeHull.NumFaces());
+	assert1(EqualAbs(latticeHull.FacePolygon(0).Area(), 81.f, 1e-3f), latticeHull.FacePolygon(0).Area());
+}
+
+UNIQUE_TEST(Polyhedron_QuickHull_Parallel)
+{
+	// Assigning the points to faces on several threads gives the same hull as on one thread.
+	LCG lcg(4321);
+	VecArray points(20000);
+	for(size_t i = 0; i < points.size(); ++i)
+		points[i] = Sphere::RandomPointInside(lcg, POINT_VEC_SCALAR(0.f), 100.f);
+
+	ThreadPool threadPool(4);
+	Polyhedron hull = Polyhedron::QuickHull(&points[0], (int)points.size(), threadPool);
+	Polyhedron serialHull = Polyhedron::QuickHull(points);
+	AssertIsConvexHullOf(hull, &points[0], (int)points.size());
+	assert(hull.NumVertices() == serialHull.NumVertices());
+	assert(hull.NumFaces() == serialHull.NumFaces());
+	for(int i = 0; i < hull.NumVertices(); ++i)
+		assert(hull.Vertex(i).BitEquals(serialHull.Vertex(i)));
+	for(int i = 0; i < hull.NumFaces(); ++i)
+		assert(hull.f[i].v == serialHull.f[i].v);
+}
+
+/// Returns the given number of points in a ball. Only the last requested set is kept between the calls, so
+/// the memory of a set is freed when a benchmark of another size runs.
+static const VecArray &ConvexHullBenchmarkPoints(int numPoints)
+{
+	static VecArray points;
+	if ((int)points.size() != numPoints)
+	{
+		VecArray().swap(points);
+		LCG lcg(5678);
+		points.resize(numPoints);
+		for(int i = 0; i < numPoints; ++i)
+			points[i] = Sphere::RandomPointInside(lcg, POINT_VEC_SCALAR(0.f), 100.f);
+	}
+	return points;
+}
+
+static int IncrementalConvexHullBenchmark(int numPoints)
+{
+	const VecArray &points = ConvexHullBenchmarkPoints(numPoints);
+	LCG rng(123);
+	return Polyhedron::ConvexHull(&points[0], numPoints, rng).NumVertices();
+}
+
+static int QuickHullBenchmark(int numPoints)
+{
+	const VecArray &points = ConvexHullBenchmarkPoints(numPoints);
+	return Polyhedron::QuickHull(&points[0], numPoints).NumVertices();
+}
+
+static int ParallelQuickHullBenchmark(int numPoints)
+{
+	const VecArray &points = ConvexHullBenchmarkPoints(numPoints);
+	return Polyhedron::QuickHull(&points[0], numPoints, ThreadPool::Default()).NumVertices();
+}
+
+BENCHMARK_ITERS(Polyhedron_ConvexHull_Incremental_1k, 10, 1, "Polyhedron::ConvexHull(LCG) of 1000 points in a ball")
+{
+	dummyResultInt += IncrementalConvexHullBenchmark(1000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_QuickHull_1k, 10, 1, "Polyhedron::QuickHull() of 1000 points in a ball")
+{
+	dummyResultInt += QuickHullBenchmark(1000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_ConvexHull_Incremental_10k, 5, 1, "Polyhedron::ConvexHull(LCG) of 10000 points in a ball")
+{
+	dummyResultInt += IncrementalConvexHullBenchmark(10000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_QuickHull_10k, 10, 1, "Polyhedron::QuickHull() of 10000 points in a ball")
+{
+	dummyResultInt += QuickHullBenchmark(10000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_ConvexHull_Incremental_100k, 3, 1, "Polyhedron::ConvexHull(LCG) of 100000 points in a ball")
+{
+	dummyResultInt += IncrementalConvexHullBenchmark(100000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_QuickHull_100k, 10, 1, "Polyhedron::QuickHull() of 100000 points in a ball")
+{
+	dummyResultInt += QuickHullBenchmark(100000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_QuickHull_Parallel_100k, 10, 1, "Polyhedron::QuickHull(ThreadPool) of 100000 points in a ball")
+{
+	dummyResultInt += ParallelQuickHullBenchmark(100000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_QuickHull_1M, 5, 1, "Polyhedron::QuickHull() of 1000000 points in a ball")
+{
+	dummyResultInt += QuickHullBenchmark(1000000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_QuickHull_Parallel_1M, 5, 1, "Polyhedron::QuickHull(ThreadPool) of 1000000 points in a ball")
+{
+	dummyResultInt += ParallelQuickHullBenchmark(1000000);
+}
+BENCHMARK_ITERS_END
+
+#ifdef MATH_LARGE_BENCHMARKS
+// The 10 million point benchmarks take about a minute, so are only built on request.
+BENCHMARK_ITERS(Polyhedron_QuickHull_10M, 3, 1, "Polyhedron::QuickHull() of 10000000 points in a ball")
+{
+	dummyResultInt += QuickHullBenchmark(10000000);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(Polyhedron_QuickHull_Parallel_10M, 3, 1, "Polyhedron::QuickHull(ThreadPool) of 10000000 points in a ball")
+{
+	dummyResultInt += ParallelQuickHullBenchmark(10000000);
+}
+BENCHMARK_ITERS_END
+#endif
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/MathGeoLib.h"
+#include "../src/Math/myassert.h"
+#include "TestRunner.h"
+
+MATH_IGNORE_UNUSED_VARS_WARNING
+
+/// Counts the runs of each iteration. Iterations with a larger index take longer, so that the threads
+/// that get them fall behind and the others have to steal from them.
+struct CountingTask
+{
+	std::vector<int> *counts;
+
+	void operator()(int i) const
+	{
+		volatile int sink = 0;
+		for(int j = 0; j < i * 10; ++j)
+			sink += j;
+		++(*counts)[i];
+	}
+};
+
+UNIQUE_TEST(ThreadPoolRunsEachTaskOnce)
+{
+	ThreadPool pool(4);
+	assert(pool.NumThreads() == 4);
+	const int numTasks[] = { 0, 1, 3, 4, 5, 1000 };
+	for(int n = 0; n < (int)(sizeof(numTasks)/sizeof(numTasks[0])); ++n)
+	{
+		std::vector<int> counts(numTasks[n] + 1, 0);
+		CountingTask task = { &counts };
+		pool.ParallelFor(numTasks[n], task);
+		for(int i = 0; i < numTasks[n]; ++i)
+			assert(counts[i] == 1);
+		assert(counts[numTasks[n]] == 0);
+	}
+}
+
+UNIQUE_TEST(ThreadPoolRunsLoopsOneAfterAnother)
+{
+	ThreadPool pool(3);
+	std::vector<int> counts(500, 0);
+	CountingTask task = { &counts };
+	for(int i = 0; i < 50; ++i)
+		pool.ParallelFor((int)counts.size(), task);
+	for(size_t i = 0; i < counts.size(); ++i)
+		assert(counts[i] == 50);
+}
@@ -1,6 +1,11 @@
 #include "../src/Math/myassert.h"
 #include "../src/MathGeoLib.h"
 #include "../tests/TestRunner.h"
+#include "../tests/TestData.h"
+
+using namespace TestData;
+
+MATH_IGNORE_UNUSED_VARS_WARNING
 
 UNIQUE_TEST(TriangleMeshSet)
 {
@@ -46,3 +51,438 @@ TEST(TriangleMeshSet3)
 	triangleMesh->Set((Triangle*)p, 12);
 	delete triangleMesh;
 }
+
+static std::vector<Triangle> RandomMeshTriangles(LCG &lcg, int numTriangles)
+{
+	std::vector<Triangle> tris;
+	for(int i = 0; i < numTriangles; ++i)
+	{
+		vec a = vec::RandomBox(lcg, -10.f, 10.f);
+		const vec size = DIR_VEC_SCALAR(3.f);
+		tris.push_back(Triangle(a, vec::RandomBox(lcg, a - size, a + size), vec::RandomBox(lcg, a - size, a + size)));
+	}
+	return tris;
+}
+
+static std::vector<Ray> RandomMeshRays(LCG &lcg, int numRays)
+{
+	std::vector<Ray> rays;
+	for(int i = 0; i < numRays; ++i)
+	{
+		vec pos = POINT_VEC_SCALAR(0.f) + vec::RandomDir(lcg, 20.f);
+		rays.push_back(Ray(pos, (vec::RandomBox(lcg, -10.f, 10.f) - pos).Normalized()));
+	}
+	return rays;
+}
+
+static bool RayTriangleHitsEqual(const RayTriangleHit &hit, float t, int triangleIndex)
+{
+	if (t == FLOAT_INF)
+		return hit.t == FLOAT_INF && hit.triangleIndex == -1;
+	return EqualAbs(hit.t, t, 1e-3f * Max(1.f, t)) && hit.triangleIndex == triangleIndex;
+}
+
+RANDOMIZED_TEST(TriangleMeshIntersectRaysMatchesIntersectRay)
+{
+	std::vector<Triangle> tris = RandomMeshTriangles(rng, 64);
+	std::vector<Ray> rays = RandomMeshRays(rng, 29);
+	std::vector<RayTriangleHit> hits(rays.size());
+
+	TriangleMesh m;
+	m.Set(&tris[0], (int)tris.size());
+	m.IntersectRays(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex_UV(rays[i], index, u, v);
+		bool matches = RayTriangleHitsEqual(hits[i], t, index);
+		assert(matches);
+	}
+
+	// Test each of the packet implementations against its single ray counterpart over the same layout.
+#ifdef MATH_SSE2
+	m.SetSoA4((const float*)&tris[0], (int)tris.size(), sizeof(Triangle)/3);
+	m.IntersectRays_SSE2(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex_UV_SSE2(rays[i], index, u, v);
+		bool matches = RayTriangleHitsEqual(hits[i], t, index);
+		assert(matches);
+	}
+#endif
+#ifdef MATH_SSE41
+	m.IntersectRays_SSE41(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex_UV_SSE41(rays[i], index, u, v);
+		bool matches = RayTriangleHitsEqual(hits[i], t, index);
+		assert(matches);
+	}
+#endif
+#ifdef MATH_AVX
+	m.SetSoA8((const float*)&tris[0], (int)tris.size(), sizeof(Triangle)/3);
+	m.IntersectRays_AVX(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex_UV_AVX(rays[i], index, u, v);
+		bool matches = RayTriangleHitsEqual(hits[i], t, index);
+		assert(matches);
+	}
+#endif
+}
+
+static const float *BenchmarkMeshTriangles()
+{
+	static std::vector<Triangle> tris;
+	if (tris.empty())
+	{
+		LCG lcg(1234);
+		tris = RandomMeshTriangles(lcg, 1024);
+	}
+	return (const float*)&tris[0];
+}
+
+static const TriangleMesh &BenchmarkMesh()
+{
+	static TriangleMesh mesh;
+	static bool initialized = false;
+	if (!initialized)
+	{
+		mesh.Set((const Triangle*)BenchmarkMeshTriangles(), 1024);
+		initialized = true;
+	}
+	return mesh;
+}
+
+static const std::vector<Ray> &BenchmarkMeshRays()
+{
+	static std::vector<Ray> rays;
+	if (rays.empty())
+	{
+		LCG lcg(5678);
+		rays = RandomMeshRays(lcg, 8);
+	}
+	return rays;
+}
+
+BENCHMARK(TriangleMeshIntersectRay, "TriangleMesh::IntersectRay_TriangleIndex_UV of 8 rays, 1024 triangles")
+{
+	const std::vector<Ray> &rays = BenchmarkMeshRays();
+	for(int j = 0; j < 8; ++j)
+	{
+		int index;
+		float u, v;
+		dummyResultInt += (int)BenchmarkMesh().IntersectRay_TriangleIndex_UV(rays[j], index, u, v);
+	}
+}
+BENCHMARK_END
+
+BENCHMARK(TriangleMeshIntersectRays, "TriangleMesh::IntersectRays of 8 rays, 1024 triangles")
+{
+	const std::vector<Ray> &rays = BenchmarkMeshRays();
+	RayTriangleHit hits[8];
+	BenchmarkMesh().IntersectRays(&rays[0], 8, hits);
+	dummyResultInt += hits[0].triangleIndex + hits[7].triangleIndex;
+}
+BENCHMARK_END
+
+#ifdef MATH_AVX
+static const TriangleMesh &BenchmarkMeshSoA8()
+{
+	static TriangleMesh mesh;
+	static bool initialized = false;
+	if (!initialized)
+	{
+		mesh.SetSoA8(BenchmarkMeshTriangles(), 1024, sizeof(Triangle)/3);
+		initialized = true;
+	}
+	return mesh;
+}
+
+BENCHMARK(TriangleMeshIntersectRay_AVX, "TriangleMesh::IntersectRay_TriangleIndex_UV_AVX of 8 rays, 1024 triangles")
+{
+	const std::vector<Ray> &rays = BenchmarkMeshRays();
+	for(int j = 0; j < 8; ++j)
+	{
+		int index;
+		float u, v;
+		dummyResultInt += (int)BenchmarkMeshSoA8().IntersectRay_TriangleIndex_UV_AVX(rays[j], index, u, v);
+	}
+}
+BENCHMARK_END
+
+BENCHMARK(TriangleMeshIntersectRays_AVX, "TriangleMesh::IntersectRays_AVX of 8 rays, 1024 triangles")
+{
+	const std::vector<Ray> &rays = BenchmarkMeshRays();
+	RayTriangleHit hits[8];
+	BenchmarkMeshSoA8().IntersectRays_AVX(&rays[0], 8, hits);
+	dummyResultInt += hits[0].triangleIndex + hits[7].triangleIndex;
+}
+BENCHMARK_END
+#endif
+
+RANDOMIZED_TEST(TriangleMeshBVHMatchesLinearScan)
+{
+	std::vector<Triangle> tris = RandomMeshTriangles(rng, 296); // The SoA layouts need a multiple of 8 triangles.
+	std::vector<Ray> rays = RandomMeshRays(rng, 37);
+	std::vector<RayTriangleHit> hits(rays.size());
+
+	TriangleMesh m;
+	m.Set(&tris[0], (int)tris.size());
+	assert(m.HasBVH()); // Built by Set(), so that the const queries never modify the mesh.
+	TriangleMesh linear = m;
+	assert(linear.HasBVH());
+	linear.SetUseBVH(false);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1, linearIndex = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex_UV(rays[i], index, u, v);
+		float linearT = linear.IntersectRay_TriangleIndex_UV(rays[i], linearIndex, u, v);
+		RayTriangleHit hit;
+		hit.SetMiss();
+		hit.t = t;
+		if (t != FLOAT_INF)
+			hit.triangleIndex = index;
+		bool matches = RayTriangleHitsEqual(hit, linearT, linearIndex);
+		assert(matches);
+	}
+	assert(m.HasBVH());
+	assert(!linear.HasBVH());
+
+	m.IntersectRays(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1;
+		float u, v;
+		float t = linear.IntersectRay_TriangleIndex_UV(rays[i], index, u, v);
+		bool matches = RayTriangleHitsEqual(hits[i], t, index);
+		assert(matches);
+	}
+
+	// The BVH stores its leaves in the layout of the mesh, and tests them with the routines of that layout.
+#ifdef MATH_SSE2
+	m.SetSoA4((const float*)&tris[0], (int)tris.size(), sizeof(Triangle)/3);
+	m.IntersectRays(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex_UV_SSE2(rays[i], index, u, v);
+		bool matches = RayTriangleHitsEqual(hits[i], t, index);
+		assert(matches);
+	}
+	assert(m.HasBVH());
+#endif
+#ifdef MATH_AVX
+	m.SetSoA8((const float*)&tris[0], (int)tris.size(), sizeof(Triangle)/3);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1, linearIndex = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex(rays[i], index);
+		float linearT = m.IntersectRay_TriangleIndex_UV_AVX(rays[i], linearIndex, u, v);
+		RayTriangleHit hit;
+		hit.SetMiss();
+		hit.t = t;
+		if (t != FLOAT_INF)
+			hit.triangleIndex = index;
+		bool matches = RayTriangleHitsEqual(hit, linearT, linearIndex);
+		assert(matches);
+	}
+	m.IntersectRays(&rays[0], (int)rays.size(), &hits[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		int index = -1;
+		float u, v;
+		float t = m.IntersectRay_TriangleIndex_UV_AVX(rays[i], index, u, v);
+		bool matches = RayTriangleHitsEqual(hits[i], t, index);
+		assert(matches);
+	}
+	assert(m.HasBVH());
+#endif
+}
+
+/// Returns a heightfield mesh of 2*gridSize*gridSize triangles over the square [-10, 10] x [-10, 10] of the XZ plane.
+static std::vector<Triangle> HeightfieldTriangles(int gridSize)
+{
+	std::vector<Triangle> tris;
+	tris.reserve(2 * gridSize * gridSize);
+	const float cellSize = 20.f / gridSize;
+	for(int z = 0; z < gridSize; ++z)
+		for(int x = 0; x < gridSize; ++x)
+		{
+			vec p[4];
+			for(int i = 0; i < 4; ++i)
+			{
+				float px = -10.f + (x + (i & 1)) * cellSize;
+				float pz = -10.f + (z + (i >> 1)) * cellSize;
+				p[i] = POINT_VEC(px, Sin(px * 0.7f) * Cos(pz * 0.5f) * 2.f, pz);
+			}
+			tris.push_back(Triangle(p[0], p[1], p[2]));
+			tris.push_back(Triangle(p[1], p[3], p[2]));
+		}
+	return tris;
+}
+
+/// Returns a heightfield mesh with 2*gridSize*gridSize triangles. gridSize must be 32, 128 or 512.
+static const TriangleMesh &BenchmarkHeightfield(int gridSize, bool useBVH)
+{
+	static TriangleMesh meshes[3][2];
+	static bool initialized[3][2] = {};
+	const int i = (gridSize == 32) ? 0 : (gridSize == 128 ? 1 : 2);
+	if (!initialized[i][useBVH])
+	{
+		std::vector<Triangle> tris = HeightfieldTriangles(gridSize);
+		meshes[i][useBVH].SetUseBVH(useBVH);
+		meshes[i][useBVH].Set(&tris[0], (int)tris.size());
+		initialized[i][useBVH] = true;
+	}
+	return meshes[i][useBVH];
+}
+
+static const std::vector<Ray> &BenchmarkHeightfieldRays()
+{
+	static std::vector<Ray> rays;
+	if (rays.empty())
+	{
+		LCG lcg(4321);
+		for(int i = 0; i < 8; ++i)
+		{
+			vec pos = POINT_VEC(lcg.Float(-10.f, 10.f), 15.f, lcg.Float(-10.f, 10.f));
+			vec target = POINT_VEC(lcg.Float(-10.f, 10.f), 0.f, lcg.Float(-10.f, 10.f));
+			rays.push_back(Ray(pos, (target - pos).Normalized()));
+		}
+	}
+	return rays;
+}
+
+static void IntersectHeightfield(int gridSize, bool useBVH)
+{
+	const std::vector<Ray> &rays = BenchmarkHeightfieldRays();
+	const TriangleMesh &mesh = BenchmarkHeightfield(gridSize, useBVH);
+	for(int j = 0; j < 8; ++j)
+	{
+		int index;
+		float u, v;
+		dummyResultInt += (int)mesh.IntersectRay_TriangleIndex_UV(rays[j], index, u, v);
+	}
+}
+
+BENCHMARK(TriangleMeshIntersectRayBVH_2k, "TriangleMesh::IntersectRay_TriangleIndex_UV with a BVH, 8 rays, 2048 triangles")
+{
+	IntersectHeightfield(32, true);
+}
+BENCHMARK_END
+
+BENCHMARK_ITERS(TriangleMeshIntersectRayLinear_2k, 20, 100, "TriangleMesh::IntersectRay_TriangleIndex_UV without a BVH, 8 rays, 2048 triangles")
+{
+	IntersectHeightfield(32, false);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK(TriangleMeshIntersectRayBVH_32k, "TriangleMesh::IntersectRay_TriangleIndex_UV with a BVH, 8 rays, 32k triangles")
+{
+	IntersectHeightfield(128, true);
+}
+BENCHMARK_END
+
+BENCHMARK_ITERS(TriangleMeshIntersectRayLinear_32k, 10, 10, "TriangleMesh::IntersectRay_TriangleIndex_UV without a BVH, 8 rays, 32k triangles")
+{
+	IntersectHeightfield(128, false);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK(TriangleMeshIntersectRayBVH_512k, "TriangleMesh::IntersectRay_TriangleIndex_UV with a BVH, 8 rays, 512k triangles")
+{
+	IntersectHeightfield(512, true);
+}
+BENCHMARK_END
+
+BENCHMARK_ITERS(TriangleMeshIntersectRayLinear_512k, 3, 1, "TriangleMesh::IntersectRay_TriangleIndex_UV without a BVH, 8 rays, 512k triangles")
+{
+	IntersectHeightfield(512, false);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(TriangleMeshBuildBVH_512k, 3, 1, "TriangleMesh::SetUseBVH(true) building the BVH, 512k triangles")
+{
+	TriangleMesh mesh = BenchmarkHeightfield(512, false);
+	mesh.SetUseBVH(true);
+	dummyResultInt += mesh.HasBVH() ? 1 : 0;
+}
+BENCHMARK_ITERS_END
+
+RANDOMIZED_TEST(TriangleMeshIntersectRaysParallelMatchesIntersectRays)
+{
+	std::vector<Triangle> tris = RandomMeshTriangles(rng, 200);
+	std::vector<Ray> rays = RandomMeshRays(rng, 3 * TriangleMesh::rayTileSize + 17);
+	std::vector<RayTriangleHit> hits(rays.size());
+	std::vector<float> t(rays.size()), u(rays.size()), v(rays.size());
+	std::vector<int> index(rays.size());
+
+	TriangleMesh m;
+	m.Set(&tris[0], (int)tris.size());
+	m.IntersectRays(&rays[0], (int)rays.size(), &hits[0]);
+
+	ThreadPool pool(4);
+	m.IntersectRaysParallel(&rays[0], (int)rays.size(), &t[0], &index[0], &u[0], &v[0], pool);
+	for(size_t i = 0; i < rays.size(); ++i)
+	{
+		assert(t[i] == hits[i].t);
+		assert(index[i] == hits[i].triangleIndex);
+		assert(u[i] == hits[i].u);
+		assert(v[i] == hits[i].v);
+	}
+
+	// The outputs other than the distances are optional.
+	std::fill(t.begin(), t.end(), -1.f);
+	m.IntersectRaysParallel(&rays[0], (int)rays.size(), &t[0]);
+	for(size_t i = 0; i < rays.size(); ++i)
+		assert(t[i] == hits[i].t);
+}
+
+/// Returns a grid of 256x256 rays looking down at the 32k triangle heightfield, as rays of a visibility map.
+static const std::vector<Ray> &BenchmarkVisibilityRays()
+{
+	static std::vector<Ray> rays;
+	if (rays.empty())
+	{
+		const vec eye = POINT_VEC(0.f, 25.f, -25.f);
+		for(int y = 0; y < 256; ++y)
+			for(int x = 0; x < 256; ++x)
+			{
+				vec target = POINT_VEC(-10.f + x * 20.f / 255.f, 0.f, -10.f + y * 20.f / 255.f);
+				rays.push_back(Ray(eye, (target - eye).Normalized()));
+			}
+	}
+	return rays;
+}
+
+static void CastVisibilityRays(ThreadPool &pool)
+{
+	static std::vector<float> t(256*256);
+	const std::vector<Ray> &rays = BenchmarkVisibilityRays();
+	BenchmarkHeightfield(128, true).IntersectRaysParallel(&rays[0], (int)rays.size(), &t[0], 0, 0, 0, pool);
+	dummyResultInt += (int)t[0];
+}
+
+BENCHMARK_ITERS(TriangleMeshIntersectRaysParallel_1Thread, 10, 1, "TriangleMesh::IntersectRaysParallel on one thread, 64k rays, 32k triangles")
+{
+	static ThreadPool pool(1);
+	CastVisibilityRays(pool);
+}
+BENCHMARK_ITERS_END
+
+BENCHMARK_ITERS(TriangleMeshIntersectRaysParallel, 10, 1, "TriangleMesh::IntersectRaysParallel on all hardware threads, 64k rays, 32k triangles")
+{
+	CastVisibilityRays(ThreadPool::Default());
+}
+BENCHMARK_ITERS_END